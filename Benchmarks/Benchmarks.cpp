@@ -0,0 +1,304 @@
+#include <catch2/catch_all.hpp>
+
+// Workaround for naming issue on windows
+#include <juce_graphics/juce_graphics.h>
+#define Rectangle juce::Rectangle
+
+#include <PluginProcessor.h>
+#include <PluginEditor.h>
+#include <Canvas.h>
+#include <Connection.h>
+
+#include "PatchGenerator.h"
+
+#include <juce_core/system/juce_TargetPlatform.h>
+#include <Standalone/PlugDataApp.cpp>
+
+// Run with "Benchmarks --benchmark-samples 50" or filter by tag, for example "Benchmarks [canvas]"
+// Compare against a baseline with "--reporter xml --out baseline.xml"
+
+#if JUCE_MAC
+extern void stopLoop();
+#endif
+
+extern juce::JUCEApplicationBase* juce_CreateApplication();
+
+#define StartApplication juce::JUCEApplicationBase::createInstance = &::juce_CreateApplication; \
+                         juce::ScopedJuceInitialiser_GUI gui; \
+                         PlugDataApp app; \
+                         app.initialise(""); \
+                         auto editor = dynamic_cast<PlugDataPluginEditor*>(app.getWindow()->getContentComponent()->getChildComponent(0))
+
+// The benchmarks run on the message thread, the app quits once they are done
+#if JUCE_MAC
+#define StopApplicationAfter(MS)     Timer::callAfterDelay(MS, [&app](){ \
+                                app.quit(); \
+                            }); \
+                            MessageManager::getInstance()->runDispatchLoop(); \
+                            stopLoop();
+#else
+#define StopApplicationAfter(MS)     Timer::callAfterDelay(MS, [&app](){ \
+                                app.quit(); \
+                            }); \
+                            MessageManager::getInstance()->runDispatchLoop();
+#endif
+
+// Fills the current canvas with a grid of objects, every other one connected to the one before it
+static void createObjects(Canvas* cnv, int numObjects)
+{
+    void* previous = nullptr;
+    for (int i = 0; i < numObjects; i++) {
+        auto* obj = cnv->patch.createObject(i % 2 ? "+ 1" : "f", 20 + (i % 40) * 60, 20 + (i / 40) * 30);
+        if (previous && i % 2) {
+            cnv->patch.createConnection(previous, 0, obj, 0);
+        }
+        previous = obj;
+    }
+}
+
+static void clearCanvas(Canvas* cnv)
+{
+    for (auto* obj : cnv->patch.getObjects()) {
+        cnv->patch.removeObject(obj);
+    }
+    cnv->synchronise();
+}
+
+TEST_CASE("Audio callback", "[audio]")
+{
+    StartApplication;
+
+    MessageManager::callAsync([=]() {
+        auto& pd = editor->pd;
+        auto* cnv = editor->getCurrentCanvas();
+
+        // A small signal chain, so the benchmark includes some dsp besides the overhead of the callback itself
+        auto* osc = cnv->patch.createObject("osc~ 440", 20, 20);
+        auto* gain = cnv->patch.createObject("*~ 0.1", 20, 60);
+        auto* dac = cnv->patch.createObject("dac~", 20, 100);
+        cnv->patch.createConnection(osc, 0, gain, 0);
+        cnv->patch.createConnection(gain, 0, dac, 0);
+        cnv->patch.createConnection(gain, 0, dac, 1);
+        cnv->synchronise();
+
+        for (int blockSize : { 64, 256, 1024 }) {
+            pd.prepareToPlay(44100, blockSize);
+
+            AudioBuffer<float> buffer(std::max(pd.getTotalNumInputChannels(), pd.getTotalNumOutputChannels()), blockSize);
+            MidiBuffer midi;
+
+            BENCHMARK("processBlock " + std::to_string(blockSize) + " samples")
+            {
+                pd.processBlock(buffer, midi);
+                return buffer.getSample(0, 0);
+            };
+        }
+
+        pd.releaseResources();
+        clearCanvas(cnv);
+    });
+
+    StopApplicationAfter(500);
+}
+
+TEST_CASE("Message queue", "[queue]")
+{
+    StartApplication;
+
+    MessageManager::callAsync([=]() {
+        auto& pd = editor->pd;
+        auto* cnv = editor->getCurrentCanvas();
+
+        cnv->patch.createObject("r benchmark", 20, 20);
+        cnv->synchronise();
+
+        auto* dest = pd.generateSymbol("benchmark");
+
+        // No budget, so a single call drains everything that was queued
+        pd.setMessageBudget(std::numeric_limits<int>::max(), 0);
+
+        for (int numMessages : { 16, 256, 4096 }) {
+            BENCHMARK_ADVANCED("sendMessagesFromQueue " + std::to_string(numMessages) + " messages")
+            (Catch::Benchmark::Chronometer meter)
+            {
+                t_atom atom;
+                SETFLOAT(&atom, 1.0f);
+
+                for (int i = 0; i < numMessages * meter.runs(); i++) {
+                    pd.enqueueMessage(dest, &s_float, 1, &atom);
+                }
+
+                meter.measure([&pd]() {
+                    pd.sendMessagesFromQueue();
+                });
+            };
+        }
+
+        clearCanvas(cnv);
+    });
+
+    StopApplicationAfter(500);
+}
+
+TEST_CASE("Canvas synchronise", "[canvas]")
+{
+    StartApplication;
+
+    MessageManager::callAsync([=]() {
+        auto* cnv = editor->getCurrentCanvas();
+
+        for (int numObjects : { 100, 1000, 10000 }) {
+            createObjects(cnv, numObjects);
+
+            // First one creates the components, after that there is nothing to change
+            cnv->synchronise();
+
+            BENCHMARK("synchronise unchanged " + std::to_string(numObjects) + " objects")
+            {
+                cnv->synchronise();
+            };
+
+            BENCHMARK("synchronise moved " + std::to_string(numObjects) + " objects")
+            {
+                auto* obj = cnv->patch.getObjects().front();
+                cnv->patch.moveObjects({ obj }, 1, 0);
+                cnv->synchronise();
+            };
+
+            clearCanvas(cnv);
+        }
+    });
+
+    StopApplicationAfter(500);
+}
+
+TEST_CASE("Object autocomplete", "[library]")
+{
+    StartApplication;
+
+    MessageManager::callAsync([=]() {
+        auto& library = editor->pd.objectLibrary;
+
+        for (auto const* query : { "o", "osc", "metro", "list-" }) {
+            BENCHMARK("autocomplete \"" + std::string(query) + "\"")
+            {
+                return library.autocomplete(query, 20).size();
+            };
+        }
+    });
+
+    StopApplicationAfter(500);
+}
+
+TEST_CASE("Connection path", "[connection]")
+{
+    // Doesn't need the application, the path finder only looks at rectangles
+    std::vector<Rectangle<int>> obstacles;
+    for (int x = 0; x < 10; x++) {
+        for (int y = 0; y < 10; y++) {
+            obstacles.emplace_back(80 + x * 120, 60 + y * 80, 60, 24);
+        }
+    }
+
+    BENCHMARK("computePath open")
+    {
+        return Connection::computePath({ 10, 10 }, { 40, 600 }, {}).size();
+    };
+
+    BENCHMARK("computePath through 100 objects")
+    {
+        return Connection::computePath({ 10, 10 }, { 1300, 900 }, obstacles).size();
+    };
+
+    BENCHMARK("computePath going up through 100 objects")
+    {
+        return Connection::computePath({ 1300, 900 }, { 10, 10 }, obstacles).size();
+    };
+}
+
+TEST_CASE("Stress patches", "[stress]")
+{
+    StartApplication;
+
+    MessageManager::callAsync([=]() {
+        auto& pd = editor->pd;
+        auto* cnv = editor->getCurrentCanvas();
+        auto& patch = cnv->patch;
+
+        auto const patchFile = File::getSpecialLocation(File::tempDirectory).getChildFile("plugdata-stress.pd");
+
+        struct Variant {
+            std::string name;
+            PatchGenerator::Options options;
+        };
+
+        std::vector<Variant> variants;
+        for (int numObjects : { 1000, 5000 }) {
+            auto const size = std::to_string(numObjects);
+            variants.push_back({ size + " objects", { numObjects, numObjects } });
+            variants.push_back({ size + " objects, nested", { numObjects, numObjects, 3 } });
+            variants.push_back({ size + " objects, GUI", { numObjects, numObjects, 0, true } });
+            variants.push_back({ size + " objects, message loops", { numObjects, numObjects, 0, false, 50 } });
+        }
+
+        for (auto const& variant : variants) {
+            // Building the patch and creating its components only happens once, so these are timed directly
+            auto start = Time::getMillisecondCounterHiRes();
+            PatchGenerator(variant.options).generate(patch);
+            auto const generateTime = Time::getMillisecondCounterHiRes() - start;
+
+            start = Time::getMillisecondCounterHiRes();
+            cnv->synchronise();
+            auto const firstSynchroniseTime = Time::getMillisecondCounterHiRes() - start;
+
+            UNSCOPED_INFO(variant.name << ": generate " << generateTime << " ms, first synchronise " << firstSynchroniseTime << " ms");
+            CHECK(cnv->objects.size() > 0);
+
+            BENCHMARK(variant.name + ": synchronise")
+            {
+                cnv->synchronise();
+            };
+
+            BENCHMARK(variant.name + ": move, undo")
+            {
+                patch.moveObjects(patch.getObjects(), 10, 0);
+                pd.sendMessagesFromQueue();
+                patch.undo();
+                pd.sendMessagesFromQueue();
+                cnv->synchronise();
+            };
+
+            BENCHMARK(variant.name + ": duplicate all, undo")
+            {
+                patch.deselectAll();
+                for (auto* obj : patch.getObjects()) {
+                    patch.selectObject(obj);
+                }
+                patch.duplicate();
+                pd.sendMessagesFromQueue();
+                cnv->synchronise();
+
+                patch.undo();
+                pd.sendMessagesFromQueue();
+                cnv->synchronise();
+            };
+
+            BENCHMARK(variant.name + ": save")
+            {
+                patch.savePatch(patchFile);
+            };
+
+            BENCHMARK(variant.name + ": open, close")
+            {
+                auto opened = pd.openPatch(patchFile);
+                opened.close();
+            };
+
+            clearCanvas(cnv);
+        }
+
+        patchFile.deleteFile();
+    });
+
+    StopApplicationAfter(500);
+}
@@ -0,0 +1,178 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+// Workaround for naming issue on windows
+#include <juce_graphics/juce_graphics.h>
+#define Rectangle juce::Rectangle
+
+#include <PluginProcessor.h>
+
+#include <numeric>
+
+// Renders every patch of the corpus without a GUI and writes the throughput as JSON, so CI can track it over time
+// Usage: DspBenchmark [--corpus Corpus.txt] [--root <repo>] [--seconds 10] [--samplerates 44100,96000] [--block 512] [--out results.json]
+
+struct BenchmarkResult {
+    String patch;
+    double sampleRate;
+    int blockSize;
+    int64 samples;
+    double seconds;
+    double meanBlockMicroseconds;
+    double p99BlockMicroseconds;
+    double maxBlockMicroseconds;
+};
+
+static StringArray readCorpus(File const& corpus)
+{
+    StringArray patches;
+    for (auto line : StringArray::fromLines(corpus.loadFileAsString())) {
+        line = line.trim();
+        if (line.isNotEmpty() && !line.startsWith("#"))
+            patches.add(line);
+    }
+    return patches;
+}
+
+static BenchmarkResult renderPatch(PlugDataAudioProcessor& processor, File const& patchFile, double sampleRate, int blockSize, double secondsToRender)
+{
+    BenchmarkResult result { patchFile.getFileName(), sampleRate, blockSize, 0, 0.0, 0.0, 0.0, 0.0 };
+
+    // Nothing should be skipped because the patch happens to be silent
+    processor.autoSleep = false;
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    auto* patch = processor.loadPatch(patchFile);
+    if (!patch) {
+        processor.releaseResources();
+        return result;
+    }
+
+    AudioBuffer<float> buffer(std::max(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels()), blockSize);
+    MidiBuffer midi;
+
+    auto const numBlocks = static_cast<int>(std::ceil(secondsToRender * sampleRate / blockSize));
+    std::vector<double> blockTimes;
+    blockTimes.reserve(numBlocks);
+
+    // Let the loadbangs and the first dsp sort settle before measuring
+    for (int i = 0; i < 16; i++) {
+        buffer.clear();
+        processor.processBlock(buffer, midi);
+        midi.clear();
+    }
+
+    auto const ticksToMicroseconds = 1e6 / static_cast<double>(Time::getHighResolutionTicksPerSecond());
+
+    for (int i = 0; i < numBlocks; i++) {
+        buffer.clear();
+
+        auto const start = Time::getHighResolutionTicks();
+        processor.processBlock(buffer, midi);
+        auto const end = Time::getHighResolutionTicks();
+
+        midi.clear();
+        blockTimes.push_back(static_cast<double>(end - start) * ticksToMicroseconds);
+    }
+
+    processor.releaseResources();
+
+    processor.setThis();
+    patch->close();
+    processor.patches.removeObject(patch);
+
+    auto const total = std::accumulate(blockTimes.begin(), blockTimes.end(), 0.0);
+    std::sort(blockTimes.begin(), blockTimes.end());
+
+    result.samples = static_cast<int64>(numBlocks) * blockSize;
+    result.seconds = total / 1e6;
+    result.meanBlockMicroseconds = blockTimes.empty() ? 0.0 : total / blockTimes.size();
+    result.p99BlockMicroseconds = blockTimes.empty() ? 0.0 : blockTimes[std::min(blockTimes.size() - 1, static_cast<size_t>(blockTimes.size() * 0.99))];
+    result.maxBlockMicroseconds = blockTimes.empty() ? 0.0 : blockTimes.back();
+
+    return result;
+}
+
+static var toJSON(BenchmarkResult const& result)
+{
+    auto* object = new DynamicObject();
+    object->setProperty("patch", result.patch);
+    object->setProperty("samplerate", result.sampleRate);
+    object->setProperty("blocksize", result.blockSize);
+    object->setProperty("samples", result.samples);
+    object->setProperty("seconds", result.seconds);
+    object->setProperty("samples_per_second", result.seconds > 0.0 ? result.samples / result.seconds : 0.0);
+    object->setProperty("realtime_factor", result.seconds > 0.0 ? (result.samples / result.sampleRate) / result.seconds : 0.0);
+    object->setProperty("block_mean_us", result.meanBlockMicroseconds);
+    object->setProperty("block_p99_us", result.p99BlockMicroseconds);
+    object->setProperty("block_max_us", result.maxBlockMicroseconds);
+    object->setProperty("failed", result.samples == 0);
+    return var(object);
+}
+
+int main(int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI gui;
+
+    ArgumentList args(argc, argv);
+
+    auto const root = args.containsOption("--root") ? args.getExistingFolderForOption("--root") : File::getCurrentWorkingDirectory();
+    auto const corpus = args.containsOption("--corpus") ? args.getExistingFileForOption("--corpus") : root.getChildFile("Benchmarks/Corpus.txt");
+    auto const seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 10.0;
+    auto const blockSize = args.containsOption("--block") ? args.getValueForOption("--block").getIntValue() : 512;
+
+    Array<double> sampleRates;
+    for (auto const& rate : StringArray::fromTokens(args.containsOption("--samplerates") ? args.getValueForOption("--samplerates") : "44100,96000", ",", ""))
+        sampleRates.add(rate.getDoubleValue());
+
+    auto const patches = readCorpus(corpus);
+    if (patches.isEmpty()) {
+        std::cerr << "No patches in " << corpus.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<PlugDataAudioProcessor> processor(dynamic_cast<PlugDataAudioProcessor*>(createPluginFilter()));
+
+    // The processor opens an empty patch by default, it shouldn't add to the measurements
+    processor->setThis();
+    for (auto* patch : processor->patches)
+        patch->close();
+    processor->patches.clear();
+
+    Array<var> results;
+    int failures = 0;
+
+    for (auto const& path : patches) {
+        auto const patchFile = root.getChildFile(path);
+
+        for (auto const sampleRate : sampleRates) {
+            auto const result = renderPatch(*processor, patchFile, sampleRate, blockSize, seconds);
+            failures += result.samples == 0;
+
+            std::cerr << result.patch << " @ " << sampleRate << " Hz: "
+                      << (result.seconds > 0.0 ? result.samples / result.seconds : 0.0) << " samples/s, p99 "
+                      << result.p99BlockMicroseconds << " us" << std::endl;
+
+            results.add(toJSON(result));
+        }
+    }
+
+    auto* report = new DynamicObject();
+    report->setProperty("version", ProjectInfo::versionString);
+    report->setProperty("seconds", seconds);
+    report->setProperty("results", results);
+
+    auto const json = JSON::toString(var(report));
+
+    if (args.containsOption("--out")) {
+        args.getFileForOption("--out").replaceWithText(json);
+    } else {
+        std::cout << json << std::endl;
+    }
+
+    return failures > 0 ? 1 : 0;
+}
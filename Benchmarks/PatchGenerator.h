@@ -0,0 +1,103 @@
+#pragma once
+
+// Builds synthetic patches of a given size through the normal editing functions, to reproduce slowdowns on big patches
+// The layout and connections only depend on the seed, so runs with the same options are comparable
+struct PatchGenerator {
+    struct Options {
+        int numObjects = 100;
+        int numConnections = 100;
+        int subpatchDepth = 0;      // every subpatch level gets an equal share of the objects
+        bool guiHeavy = false;      // mostly iemgui objects instead of text objects
+        int numMessageLoops = 0;    // [metro 1] driven counters that keep the scheduler busy
+        int64 seed = 1;
+    };
+
+    explicit PatchGenerator(Options const& generatorOptions)
+        : options(generatorOptions)
+        , random(generatorOptions.seed)
+    {
+    }
+
+    // Returns all objects that were created, including the subpatches
+    std::vector<void*> generate(pd::Patch& patch)
+    {
+        std::vector<void*> created;
+        generateLevel(patch, options.numObjects, options.numConnections, options.subpatchDepth, created);
+
+        for (int i = 0; i < options.numMessageLoops; i++) {
+            auto const y = 20 + i * 30;
+            auto* metro = patch.createObject("metro 1", 2500, y);
+            auto* counter = patch.createObject("f", 2560, y);
+            auto* increment = patch.createObject("+ 1", 2600, y);
+            auto* start = patch.createObject("r generator-start", 2400, y);
+
+            patch.createConnection(start, 0, metro, 0);
+            patch.createConnection(metro, 0, counter, 0);
+            patch.createConnection(counter, 0, increment, 0);
+            patch.createConnection(increment, 0, counter, 1);
+
+            created.insert(created.end(), { metro, counter, increment, start });
+        }
+
+        // Loadbangs don't fire for objects that are created while editing
+        if (options.numMessageLoops > 0) {
+            patch.instance->sendBang("generator-start");
+        }
+
+        return created;
+    }
+
+private:
+    void generateLevel(pd::Patch& patch, int numObjects, int numConnections, int depth, std::vector<void*>& created)
+    {
+        auto const objectsHere = depth > 0 ? numObjects / (depth + 1) : numObjects;
+        auto const connectionsHere = depth > 0 ? numConnections / (depth + 1) : numConnections;
+
+        std::vector<void*> objects;
+        objects.reserve(objectsHere);
+
+        for (int i = 0; i < objectsHere; i++) {
+            auto const x = 20 + (i % 40) * 60;
+            auto const y = 20 + (i / 40) * 40;
+
+            if (auto* obj = patch.createObject(getObjectText(), x, y)) {
+                objects.push_back(obj);
+            }
+        }
+
+        // Only connect forward, so the patch doesn't contain any message loops that would recurse forever
+        for (int i = 0; i < connectionsHere && objects.size() > 1; i++) {
+            auto const source = random.nextInt(static_cast<int>(objects.size()) - 1);
+            auto const sink = source + 1 + random.nextInt(std::min<int>(8, static_cast<int>(objects.size()) - source - 1));
+            patch.createConnection(objects[source], 0, objects[sink], 0);
+        }
+
+        created.insert(created.end(), objects.begin(), objects.end());
+
+        if (depth > 0) {
+            auto* subpatchObject = patch.createObject("pd level" + String(depth), 20, 40 + (objectsHere / 40 + 1) * 40);
+            if (!subpatchObject)
+                return;
+
+            created.push_back(subpatchObject);
+
+            auto subpatch = pd::Patch(subpatchObject, patch.instance);
+            generateLevel(subpatch, numObjects - objectsHere, numConnections - connectionsHere, depth - 1, created);
+        }
+    }
+
+    String getObjectText()
+    {
+        static StringArray const textObjects = { "f", "+ 1", "* 2", "t b f", "moses 10", "sel 0", "route 1 2", "pack f f", "unpack f f", "list append", "spigot", "change" };
+        static StringArray const guiObjects = { "tgl", "bng", "hsl", "vsl", "nbx", "hradio", "vradio", "vu", "cnv" };
+
+        if (options.guiHeavy && random.nextFloat() < 0.75f) {
+            return guiObjects[random.nextInt(guiObjects.size())];
+        }
+
+        return textObjects[random.nextInt(textObjects.size())];
+    }
+
+    Options options;
+    Random random;
+};
@@ -3,6 +3,7 @@
 #define COEFFS 5   // number of coeffs per filter stage
 #define MAX_COEFFS 250 // defining max number of coeffs to take
 #define STAGES 50 // number of stages = MAX_COEFFS/COEFFS
+#define CHUNK 64 // samples processed per section at a time
 
 static t_class *biquads_class;
 
@@ -60,37 +61,45 @@ static t_int * biquads_perform(t_int *w){
     int nblock = (int)(w[2]);
     t_float *in = (t_float *)(w[3]);
     t_float *out = (t_float *)(w[4]);
-    t_int bypass = x->x_bypass;
     int numfilt = x->x_numfilt;
-    while(nblock--){
-      if(bypass)
-          *out++ = *in++;
-      else{
-          double xn = *in++;
-          int curfilt = 0; // filter section counter
-          while(curfilt < numfilt){
-              int curidx = COEFFS*curfilt; // current starting index
-              double b1 = x->x_coeff[curidx];
-              double b2 = x->x_coeff[curidx+1];
-              double a0 = x->x_coeff[curidx+2];
-              double a1 = x->x_coeff[curidx+3];
-              double a2 = x->x_coeff[curidx+4];
-              double xnm1 = x->x_xnm1[curfilt];
-              double xnm2 = x->x_xnm2[curfilt];
-              double ynm1 = x->x_ynm1[curfilt];
-              double ynm2 = x->x_ynm2[curfilt];
-              double yn = a0*xn + a1*xnm1 + a2*xnm2 + b1*ynm1 + b2*ynm2; // biquad section
-              x->x_xnm2[curfilt] = xnm1;
-              x->x_xnm1[curfilt] = xn;
-              x->x_ynm2[curfilt] = ynm1;
-              x->x_ynm1[curfilt] = yn;
-              xn = yn; // next stage's xn is previous yn!
-              curfilt++; // iterate the filter section counter
-        };
-        *out++ = xn; // xn is the cascaded output
-      };
-  };
-  return(w + 5);
+    if(x->x_bypass){
+        while(nblock--)
+            *out++ = *in++;
+        return(w + 5);
+    }
+// run each section over a chunk of samples so its coefficients and state stay in
+// registers, the chunk is kept in double so the output matches a per-sample cascade
+    double buf[CHUNK];
+    while(nblock > 0){
+        int n = nblock < CHUNK ? nblock : CHUNK;
+        for(int i = 0; i < n; i++)
+            buf[i] = in[i];
+        for(int curfilt = 0; curfilt < numfilt; curfilt++){
+            double *coeff = x->x_coeff + COEFFS*curfilt;
+            double b1 = coeff[0], b2 = coeff[1], a0 = coeff[2], a1 = coeff[3], a2 = coeff[4];
+            double xnm1 = x->x_xnm1[curfilt];
+            double xnm2 = x->x_xnm2[curfilt];
+            double ynm1 = x->x_ynm1[curfilt];
+            double ynm2 = x->x_ynm2[curfilt];
+            for(int i = 0; i < n; i++){
+                double xn = buf[i];
+                double yn = a0*xn + a1*xnm1 + a2*xnm2 + b1*ynm1 + b2*ynm2; // biquad section
+                xnm2 = xnm1;
+                xnm1 = xn;
+                ynm2 = ynm1;
+                ynm1 = yn;
+                buf[i] = yn; // next stage's xn is previous yn!
+            }
+            x->x_xnm1[curfilt] = (PD_BIGORSMALL(xnm1) ? 0. : xnm1);
+            x->x_xnm2[curfilt] = (PD_BIGORSMALL(xnm2) ? 0. : xnm2);
+            x->x_ynm1[curfilt] = (PD_BIGORSMALL(ynm1) ? 0. : ynm1);
+            x->x_ynm2[curfilt] = (PD_BIGORSMALL(ynm2) ? 0. : ynm2);
+        }
+        for(int i = 0; i < n; i++)
+            out[i] = buf[i];
+        in += n, out += n, nblock -= n;
+    }
+    return(w + 5);
 }
 
 static void biquads_dsp(t_biquads *x, t_signal **sp){
@@ -73,7 +73,9 @@ static t_float tri(const t_polyblep* x){
 }
 
 static t_int* bltri_perform(t_int *w) {
-    t_polyblep* x      = (t_polyblep*)(w[1]);
+    t_polyblep* state  = (t_polyblep*)(w[1]);
+    t_polyblep p       = *state; // local copy, so writing the output can't alias it
+    t_polyblep* x      = &p;
     t_int n            = (t_int)(w[2]);
     t_float* freq_vec  = (t_float *)(w[3]);
     t_float* sync_vec  = (t_float *)(w[4]);
@@ -101,6 +103,7 @@ static t_int* bltri_perform(t_int *w) {
         x->last_phase_offset = phase_offset;
         *out++ = y;  // Send to output
     }
+    *state = p;
     return(w+7);
 }
 
@@ -31,15 +31,13 @@ static t_int *brown_perform(t_int *w){
     int nblock = (t_int)(w[2]);
     t_sample *in = (t_sample *)(w[3]);
     t_sample *out = (t_sample *)(w[4]);
-    uint32_t *s1 = &x->x_rstate.s1;
-    uint32_t *s2 = &x->x_rstate.s2;
-    uint32_t *s3 = &x->x_rstate.s3;
+    uint32_t s1 = x->x_rstate.s1, s2 = x->x_rstate.s2, s3 = x->x_rstate.s3;
     t_float lastout = x->x_lastout;
     while(nblock--){
         if(x->x_inmode){
             t_float impulse = (*in++ != 0);
             if(impulse){
-                t_float noise = random_frand(s1, s2, s3);
+                t_float noise = random_frand(&s1, &s2, &s3);
                 lastout += (noise * x->x_step);
                 if(lastout > 1)
                     lastout = 2 - lastout;
@@ -49,7 +47,7 @@ static t_int *brown_perform(t_int *w){
             *out++ = lastout;
         }
         else{
-            t_float noise = random_frand(s1, s2, s3);
+            t_float noise = random_frand(&s1, &s2, &s3);
             lastout += (noise * x->x_step);
             if(lastout > 1)
                 lastout = 2 - lastout;
@@ -58,6 +56,7 @@ static t_int *brown_perform(t_int *w){
             *out++ = lastout;
         }
     }
+    x->x_rstate.s1 = s1, x->x_rstate.s2 = s2, x->x_rstate.s3 = s3;
     x->x_lastout = lastout;
     return(w+5);
 }
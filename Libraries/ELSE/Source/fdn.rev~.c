@@ -45,12 +45,13 @@ typedef struct fdnctl{
     t_float *c_buf;
     t_float *c_gain_in;
     t_float *c_gain_state;
-    t_int   *c_tap;         // cirular feed: N+1 pointers: 1 read, (N-1)r/w, 1 write
+    t_int   *c_tap;         // cirular feed: N+1 offsets from c_pos: 1 read, (N-1)r/w, 1 write
+    t_int    c_pos;         // all taps move together, so only this one advances
     t_float *c_time_ms;
     t_int    c_bufsize;
-    t_float *c_vector[2];
+    t_float *c_state;       // filtered output of each line from the previous sample
+    t_float *c_read;        // scratch for the line outputs of the current sample
     t_float *c_vectorbuffer;
-    t_int    c_curvector;
 }t_fdnctl;
 
 typedef struct fdn{
@@ -95,15 +96,14 @@ static void fdn_time(t_fdn *x, t_float f){
 
 static void fdn_delsizes(t_fdn *x){
     t_int mask = x->x_ctl.c_bufsize - 1;
-    t_int start = x->x_ctl.c_tap[0];
     t_int *tap = x->x_ctl.c_tap;
-    tap[0] = (start & mask);
+    tap[0] = 0;
     float *length = x->x_ctl.c_time_ms;
     float scale = sys_getsr() * .001f;
     t_int sum = 0;
     for(t_int t = 1; t <= x->x_ctl.c_order; t++){
         sum += (t_int)(length[t-1] * scale); // delay time in samples
-        tap[t] = (start+sum)&mask;
+        tap[t] = sum&mask;
     }
     if(sum > mask)
         post("[fdn.rev~]: not enough delay memory (this could lead to instability)");
@@ -205,68 +205,44 @@ static t_int *fdn_perform(t_int *w){
     t_float *outr       = (float *)(w[5]);
     t_float *gain_in    = ctl->c_gain_in;
     t_float *gain_state = ctl->c_gain_state;
+    t_float *state      = ctl->c_state;
+    t_float *z          = ctl->c_read;
+    t_float leak        = ctl->c_leak;
     t_int order         = ctl->c_order;
     t_int *tap          = ctl->c_tap;
     t_float *buf        = ctl->c_buf;
     t_int mask          = ctl->c_bufsize - 1;
+    t_int pos           = ctl->c_pos;
     t_int i, j;
-    t_float x, y, left, right, z;
-    t_float *cvec, *lvec;
+    t_float x, y, left, right;
     t_float save;
     for(i = 0; i < n; i++){
         x = *in++;
-        y = 0;
-        left = 0;
-        right = 0;
-// get temporary vector buffers
-        cvec = ctl->c_vector[ctl->c_curvector];
-        lvec = ctl->c_vector[ctl->c_curvector ^ 1];
-        ctl->c_curvector ^= 1;
-// read input vector + get sum and left/right output
-        for(j = 0; j < order;){
-            z = buf[tap[j]];
-            cvec[j] = z;
-            y     += z;
-            left  += z;
-            right += z;
-            j++;
-            z = buf[tap[j]];
-            cvec[j] = z;
-            y     += z;
-            left  -= z;
-            right += z;
-            j++;
-            z = buf[tap[j]];
-            cvec[j] = z;
-            y     += z;
-            left  += z;
-            right -= z;
-            j++;
-            z = buf[tap[j]];
-            cvec[j] = z;
-            y     += z;
-            left  -= z;
-            right -= z;
-            j++;
+// gather the line outputs, then sum them in groups of 4 so this vectorizes
+        for(j = 0; j < order; j++)
+            z[j] = buf[(pos + tap[j]) & mask];
+        y = left = right = 0;
+        for(j = 0; j < order; j += 4){
+            y     += z[j] + z[j+1] + z[j+2] + z[j+3];
+            left  += z[j] - z[j+1] + z[j+2] - z[j+3];
+            right += z[j] + z[j+1] - z[j+2] - z[j+3];
         }
         *outl++ = left;
         *outr++ = right;
-        y *=  ctl->c_leak; // y == leak to all inputs
-// perform feedback (todo: decouple feedback & permutation)
-        save = cvec[0];
-        for(j = 0; j < order-1; j++)
-            cvec[j] = cvec[j+1] + y + x;
-        cvec[order-1] = save + y + x;
-// apply gain + store result vector in delay lines + increment taps
-        tap[0] = (tap[0] + 1)&mask;
-        for(j = 0; j < order; j++){
-            save = gain_in[j] * cvec[j] + gain_state[j] * lvec[j];
-            save = denorm_check(save) ? 0 : save;
-            cvec[j] = save;
-            buf[tap[j+1]] = save;
-            tap[j+1] = (tap[j+1] + 1) & mask;
+        y *= leak; // y == leak to all inputs
+// householder feedback with a rotation by one line, then the decay filter
+        for(j = 0; j < order-1; j++){
+            save = gain_in[j] * (z[j+1] + y + x) + gain_state[j] * state[j];
+            state[j] = denorm_check(save) ? 0 : save;
         }
+        save = gain_in[j] * (z[0] + y + x) + gain_state[j] * state[j];
+        state[j] = denorm_check(save) ? 0 : save;
+// store result vector in delay lines
+        for(j = 0; j < order; j++)
+            buf[(pos + tap[j+1]) & mask] = state[j];
+        pos = (pos + 1) & mask;
     }
+    ctl->c_pos = pos;
     return(w+6);
 }
 
@@ -389,9 +365,9 @@ static void *fdn_new(t_symbol *s, int ac, t_atom *av){
     x->x_ctl.c_gain_state = (t_float *)malloc(order * sizeof(t_float));
     x->x_ctl.c_vectorbuffer = (t_float *)malloc(order * 2 * sizeof(float));
     memset(x->x_ctl.c_vectorbuffer, 0, order * 2 * sizeof(float));
-    x->x_ctl.c_curvector = 0;
-    x->x_ctl.c_vector[0] = &x->x_ctl.c_vectorbuffer[0];
-    x->x_ctl.c_vector[1] = &x->x_ctl.c_vectorbuffer[order];
+    x->x_ctl.c_pos = 0;
+    x->x_ctl.c_state = &x->x_ctl.c_vectorbuffer[0];
+    x->x_ctl.c_read = &x->x_ctl.c_vectorbuffer[order];
 // default input list
     t_atom at[8];
     SETFLOAT(at, 7.f);
@@ -2,6 +2,7 @@
 
 #include "m_pd.h"
 #include <math.h>
+#include "simd.h"
 
 static t_class *floor_class;
 
@@ -23,7 +24,23 @@ static t_int * floor_perform(t_int *w){
     return (w + 5);
 }
 
+#ifdef ELSE_SIMD
+static t_int *floor_perform_simd(t_int *w){
+    int n = (int)(w[2]);
+    t_float *in = (t_float *)(w[3]);
+    t_float *out = (t_float *)(w[4]);
+    for(int i = 0; i < n; i += 4)
+        else_v4f_store(out + i, else_v4f_floor(else_v4f_load(in + i)));
+    return(w+5);
+}
+#endif
+
 static void floor_dsp(t_floor *x, t_signal **sp){
+#ifdef ELSE_SIMD
+    if(!(sp[0]->s_n & 3))
+        dsp_add(floor_perform_simd, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
+    else
+#endif
     dsp_add(floor_perform, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
 }
 
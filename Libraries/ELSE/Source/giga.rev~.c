@@ -25,14 +25,16 @@
 #include <math.h>
 #include <string.h>
 
+// all lines are power of 2 sized, so their indices wrap with a mask
 typedef struct{
-    int    size;
+    int    mask;
     int    idx;
     float *buf;
 }t_fixeddelay;
 
 typedef struct{
-    int    size;
+    int    size; // delay in samples
+    int    mask;
     float  coeff;
     int    idx;
     float *buf;
@@ -56,21 +58,25 @@ typedef struct{
     float           x_decay;        // decay time in seconds
     float           x_maxdelay;
     float           x_largestdelay;
-    t_damper       *x_in_damper;
-    t_damper      **x_fdndamps;
-    t_fixeddelay  **x_fdndels;
-    t_fixeddelay   *x_tapdelay;
-    float          *x_fdngains;
-    int            *x_fdnlens;
+    t_damper        x_in_damper;
+    t_damper        x_fdndamps[4];
+    t_fixeddelay    x_fdndels[4];
+    t_fixeddelay    x_tapdelay;
+    float           x_fdngains[4];
+    int             x_fdnlens[4];
     float           x_fdndamp;
-    t_diffuser    **x_ldifs;
-    t_diffuser    **x_rdifs;
-    int            *x_taps;
-    float          *x_tapgains;
-    float          *x_d;
-    float          *x_u;
-    float          *x_f;
+    t_diffuser      x_ldifs[4];
+    t_diffuser      x_rdifs[4];
+    int             x_taps[4];
+    float           x_tapgains[4];
+    float           x_d[4];
+    float           x_u[4];
+    float           x_f[4];
     double          x_alpha;
+    float          *x_delaymem;     // one block for the fdn and tapped delay lines
+    int             x_delaymemsize;
+    float          *x_difmem;       // one block for all diffusers
+    int             x_difmemsize;
 }t_gverb;
 
 void *gverb_class;
@@ -103,23 +109,23 @@ static inline void gverb_fdn_matrix(float *a, float *b){
 }
 
 static inline float diffuser_do(t_diffuser *d, float f){
-    f = f - d->buf[d->idx]*d->coeff;
+    float z = d->buf[(d->idx - d->size) & d->mask];
+    f = f - z*d->coeff;
     if(PD_BADFLOAT(f)) f = 0.0f;
-    float y = d->buf[d->idx] + f*d->coeff;
+    float y = z + f*d->coeff;
     d->buf[d->idx] = f;
-    d->idx = (d->idx + 1) % d->size;
+    d->idx = (d->idx + 1) & d->mask;
     return(y);
 }
 
 static inline float fixeddelay_read(t_fixeddelay *d, int n){
-    int i = (d->idx - n + d->size) % d->size;
-    return(d->buf[i]);
+    return(d->buf[(d->idx - n) & d->mask]);
 }
 
 static inline void fixeddelay_write(t_fixeddelay *d, float f){
     if(PD_BADFLOAT(f)) f = 0.0f;
     d->buf[d->idx] = f;
-    d->idx = (d->idx + 1) % d->size;
+    d->idx = (d->idx + 1) & d->mask;
 }
 
 static inline void damper_set(t_damper *d, float f){
@@ -136,14 +142,14 @@ static inline void gverb_do(t_gverb *x, float in, float *l, float *r){
     unsigned int i;
     float lsum, rsum, sum, sign;
     if(PD_BADFLOAT(in) || fabsf(in) > 100000.0f) in = 0.0f;
-    z = damper_do(x->x_in_damper, in);
-    z = diffuser_do(x->x_ldifs[0], z);
+    z = damper_do(&x->x_in_damper, in);
+    z = diffuser_do(&x->x_ldifs[0], z);
     for(i = 0; i < 4; i++)
-        x->x_u[i] = x->x_tapgains[i]*fixeddelay_read(x->x_tapdelay,x->x_taps[i]);
-    fixeddelay_write(x->x_tapdelay, z);
+        x->x_u[i] = x->x_tapgains[i]*fixeddelay_read(&x->x_tapdelay,x->x_taps[i]);
+    fixeddelay_write(&x->x_tapdelay, z);
     for(i = 0; i < 4; i++){
-        x->x_d[i] = damper_do(x->x_fdndamps[i],
-                            x->x_fdngains[i]*fixeddelay_read(x->x_fdndels[i],
+        x->x_d[i] = damper_do(&x->x_fdndamps[i],
+                            x->x_fdngains[i]*fixeddelay_read(&x->x_fdndels[i],
                                                            x->x_fdnlens[i]));
     }
     sum = 0.0f;
@@ -155,13 +161,13 @@ static inline void gverb_do(t_gverb *x, float in, float *l, float *r){
     lsum = rsum = (sum += in*x->x_early);
     gverb_fdn_matrix(x->x_d, x->x_f);
     for(i = 0; i < 4; i++)
-        fixeddelay_write(x->x_fdndels[i], x->x_u[i]+x->x_f[i]);
-    lsum = diffuser_do(x->x_ldifs[1], lsum);
-    lsum = diffuser_do(x->x_ldifs[2], lsum);
-    lsum = diffuser_do(x->x_ldifs[3], lsum);
-    rsum = diffuser_do(x->x_rdifs[1], rsum);
-    rsum = diffuser_do(x->x_rdifs[2], rsum);
-    rsum = diffuser_do(x->x_rdifs[3], rsum);
+        fixeddelay_write(&x->x_fdndels[i], x->x_u[i]+x->x_f[i]);
+    lsum = diffuser_do(&x->x_ldifs[1], lsum);
+    lsum = diffuser_do(&x->x_ldifs[2], lsum);
+    lsum = diffuser_do(&x->x_ldifs[3], lsum);
+    rsum = diffuser_do(&x->x_rdifs[1], rsum);
+    rsum = diffuser_do(&x->x_rdifs[2], rsum);
+    rsum = diffuser_do(&x->x_rdifs[3], rsum);
     *l = lsum;
     *r = rsum;
 }
@@ -196,104 +202,82 @@ int ff_round(float f){ // Round float to int (faster than f_trunc)
     return *((int*)&f) - 0x4b400000;
 }
 
-t_diffuser *diffuser_make(int size, float coeff){
-    t_diffuser *d = (t_diffuser *)t_getbytes(sizeof(t_diffuser));
-    if(!d) return (NULL);
+static int gverb_pow2(int n){ // smallest power of 2 that holds n samples
+    int size = 1;
+    while(size < n)
+        size <<= 1;
+    return(size);
+}
+
+static float *diffuser_init(t_diffuser *d, float *mem, int size, float coeff){
     d->size = size;
+    d->mask = gverb_pow2(size) - 1;
     d->coeff = coeff;
     d->idx = 0;
-    d->buf = (float *)t_getbytes(size*sizeof(float));
-    if(!d->buf) return (NULL);
-    for(int i = 0; i < size; i++) d->buf[i] = 0.0;
-    return(d);
-}
-
-void diffuser_free(t_diffuser *d){
-    t_freebytes(d->buf, d->size*sizeof(float));
-    t_freebytes(d, sizeof(t_diffuser));
-}
-
-void diffuser_clear(t_diffuser *d){
-    memset(d->buf, 0, d->size * sizeof(float));
-}
-
-t_damper *damper_make(float f){
-    t_damper *d = (t_damper *)t_getbytes(sizeof(t_damper));
-    if(!d) return (NULL);
-    d->damp = f;
-    d->delay = 0.0;
-    return(d);
-}
-
-void damper_free(t_damper *d){
-    t_freebytes(d, sizeof(t_damper));
+    d->buf = mem;
+    return(mem + d->mask + 1);
 }
 
-void damper_clear(t_damper *d){
-    d->delay = 0.0f;
-}
-
-void fixeddelay_clear(t_fixeddelay *d){
-    memset(d->buf, 0, d->size * sizeof(float));
-}
-
-t_fixeddelay *fixeddelay_make(int size){
-    t_fixeddelay *d = (t_fixeddelay *)t_getbytes(sizeof(t_fixeddelay));
-    if(!d) return (NULL);
-    d->size = size;
+static float *fixeddelay_init(t_fixeddelay *d, float *mem, int size){
+    d->mask = gverb_pow2(size) - 1;
     d->idx = 0;
-    d->buf = (float *)t_getbytes(size*sizeof(float));
-    if(!d->buf) return (NULL);
-    for(int i = 0; i < size; i++)
-        d->buf[i] = 0.0;
-    return(d);
+    d->buf = mem;
+    return(mem + d->mask + 1);
 }
 
-void fixeddelay_free(t_fixeddelay *d){
-    t_freebytes(d->buf, d->size*sizeof(float));
-    t_freebytes(d, sizeof(t_diffuser));
+static inline void damper_clear(t_damper *d){
+    d->delay = 0.0f;
 }
 
-// METHODS!!!
-
-static inline void gverb_spread(t_gverb *x, t_floatarg f){
-    float spread1 = (f < 0 ? 0 : f > 1 ? 1 : f) * 100;
-    float spread2 = 3.0*spread1;
-    int a, b = 210, c, cc, d, dd, e;
-// Diffuser section
+// (re)allocates all diffusers in one zeroed block, spread goes from 0 to 100
+static int gverb_diffusers(t_gverb *x, float spread){
+    float spread1 = spread;
+    float spread2 = 3.0*spread;
+    int a, b = 210, c, d;
+    int sizes[8];
+    float coeffs[4] = {0.75, 0.75, 0.625, 0.625};
     float diffscale = (float)x->x_fdnlens[3]/(210+159+562+410);
 // Left
     a = spread1*0.125541f;
     c = 159+a+b;
-    cc = c-b;
     a = spread2*0.854046f;
     d = 159+562+a+b;
-    dd = d-c;
-    e = 1341-d;
-    x->x_ldifs[0] = diffuser_make((int)(diffscale*b), 0.75);
-    x->x_ldifs[1] = diffuser_make((int)(diffscale*cc), 0.75);
-    x->x_ldifs[2] = diffuser_make((int)(diffscale*dd), 0.625);
-    x->x_ldifs[3] = diffuser_make((int)(diffscale*e), 0.625);
-    if(!x->x_ldifs[0] || !x->x_ldifs[1] || !x->x_ldifs[2] || !x->x_ldifs[3]){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return;
-    }
+    sizes[0] = (int)(diffscale*b);
+    sizes[1] = (int)(diffscale*(c-b));
+    sizes[2] = (int)(diffscale*(d-c));
+    sizes[3] = (int)(diffscale*(1341-d));
 // Right
     a = spread1*-0.568366f;
     c = 159+a+b;
-    cc = c-b;
     a = spread2*-0.126815f;
     d = 159+562+a+b;
-    dd = d-c;
-    e = 1341-d;
-    x->x_rdifs[0] = diffuser_make((int)(diffscale*b), 0.75);
-    x->x_rdifs[1] = diffuser_make((int)(diffscale*cc), 0.75);
-    x->x_rdifs[2] = diffuser_make((int)(diffscale*dd), 0.625);
-    x->x_rdifs[3] = diffuser_make((int)(diffscale*e), 0.625);
-    if(!x->x_rdifs[0] || !x->x_rdifs[1] || !x->x_rdifs[2] || !x->x_rdifs[3]){
+    sizes[4] = (int)(diffscale*b);
+    sizes[5] = (int)(diffscale*(c-b));
+    sizes[6] = (int)(diffscale*(d-c));
+    sizes[7] = (int)(diffscale*(1341-d));
+    int total = 0;
+    for(int i = 0; i < 8; i++)
+        total += gverb_pow2(sizes[i]);
+    float *mem = (float *)t_getbytes(total*sizeof(float));
+    if(!mem){
         pd_error(x, "[giga.rev~]: out of memory");
-        return;
+        return(0);
     }
+    if(x->x_difmem)
+        t_freebytes(x->x_difmem, x->x_difmemsize*sizeof(float));
+    x->x_difmem = mem;
+    x->x_difmemsize = total;
+    for(int i = 0; i < 4; i++)
+        mem = diffuser_init(&x->x_ldifs[i], mem, sizes[i], coeffs[i]);
+    for(int i = 0; i < 4; i++)
+        mem = diffuser_init(&x->x_rdifs[i], mem, sizes[i+4], coeffs[i]);
+    return(1);
+}
+
+// METHODS!!!
+
+static inline void gverb_spread(t_gverb *x, t_floatarg f){
+    gverb_diffusers(x, (f < 0 ? 0 : f > 1 ? 1 : f) * 100);
 }
 
 static inline void gverb_size(t_gverb *x, t_floatarg f){
@@ -327,12 +311,12 @@ static inline void gverb_decay(t_gverb *x, t_floatarg f){
 static inline void gverb_damp(t_gverb *x, t_floatarg f){
     x->x_fdndamp = f < 0.0f ? 0.0f : f > 1.0f ? 1.0f : f;
     for(int i = 0; i < 4; i++)
-        damper_set(x->x_fdndamps[i], x->x_fdndamp);
+        damper_set(&x->x_fdndamps[i], x->x_fdndamp);
 }
 
 static inline void gverb_bw(t_gverb *x, t_floatarg f){
     x->x_in_bw = f < 0.0f ? 0.0f : f > 1.0f ? 1.0f : f;
-    damper_set(x->x_in_damper, 1.0f - x->x_in_bw);
+    damper_set(&x->x_in_damper, 1.0f - x->x_in_bw);
 }
 
 static inline void gverb_dry(t_gverb *x, t_floatarg f){
@@ -352,17 +336,14 @@ static inline void gverb_late(t_gverb *x, t_floatarg f){
 }
 
 void gverb_clear(t_gverb *x){
-    damper_clear(x->x_in_damper);
-    for(int i = 0; i < 4; i++){
-        fixeddelay_clear(x->x_fdndels[i]);
-        damper_clear(x->x_fdndamps[i]);
-        diffuser_clear(x->x_ldifs[i]);
-        diffuser_clear(x->x_rdifs[i]);
-    }
+    damper_clear(&x->x_in_damper);
+    for(int i = 0; i < 4; i++)
+        damper_clear(&x->x_fdndamps[i]);
+    memset(x->x_delaymem, 0, x->x_delaymemsize * sizeof(float));
+    memset(x->x_difmem, 0, x->x_difmemsize * sizeof(float));
     memset(x->x_d, 0, 4 * sizeof(float));
     memset(x->x_u, 0, 4 * sizeof(float));
     memset(x->x_f, 0, 4 * sizeof(float));
-    fixeddelay_clear(x->x_tapdelay);
 }
 
 t_int *gverb_perform(t_int *w){
@@ -403,25 +384,10 @@ void gverb_print(t_gverb *x){
 }
 
 void gverb_free(t_gverb *x){
-    damper_free(x->x_in_damper);
-    for(int i = 0; i < 4; i++){
-        fixeddelay_free(x->x_fdndels[i]);
-        damper_free(x->x_fdndamps[i]);
-        diffuser_free(x->x_ldifs[i]);
-        diffuser_free(x->x_rdifs[i]);
-    }
-    t_freebytes(x->x_fdndels, 4*sizeof(t_fixeddelay *));
-    t_freebytes(x->x_fdngains, 4*sizeof(float));
-    t_freebytes(x->x_fdnlens, 4*sizeof(int));
-    t_freebytes(x->x_fdndamps, 4*sizeof(t_damper *));
-    t_freebytes(x->x_d, 4*sizeof(float));
-    t_freebytes(x->x_u, 4*sizeof(float));
-    t_freebytes(x->x_f, 4*sizeof(float));
-    t_freebytes(x->x_ldifs, 4*sizeof(t_diffuser *));
-    t_freebytes(x->x_rdifs, 4*sizeof(t_diffuser *));
-    t_freebytes(x->x_taps, 4*sizeof(int));
-    t_freebytes(x->x_tapgains, 4*sizeof(float));
-    fixeddelay_free(x->x_tapdelay);
+    if(x->x_delaymem)
+        t_freebytes(x->x_delaymem, x->x_delaymemsize*sizeof(float));
+    if(x->x_difmem)
+        t_freebytes(x->x_difmem, x->x_difmemsize*sizeof(float));
 }
 
 t_gverb *gverb_new(t_symbol *s, short ac, t_atom *av){
@@ -506,10 +472,6 @@ t_gverb *gverb_new(t_symbol *s, short ac, t_atom *av){
 /////////////////////////////////////////////////////////////////////////////////////
     float ga, gb, gt;
     int i, n;
-    float r;
-    float diffscale;
-    int a, b, c, cc, d, dd, e;
-    float spread1, spread2;
     x->x_sr = sys_getsr();
     x->x_fdndamp = damp;
     x->x_maxsize = maxsize;
@@ -525,38 +487,23 @@ t_gverb *gverb_new(t_symbol *s, short ac, t_atom *av){
     outlet_new(&x->x_obj, gensym("signal"));
 // Input damper
     x->x_in_bw = in_bw;
-    x->x_in_damper = damper_make(1.0 - x->x_in_bw);
-// FDN section
-    x->x_fdndels = (t_fixeddelay **)t_getbytes(4*sizeof(t_fixeddelay *));
-    if(!x->x_fdndels){
+    damper_set(&x->x_in_damper, 1.0 - x->x_in_bw);
+// FDN and tapped delay lines share one block
+    int fdnsize = gverb_pow2((int)x->x_maxdelay+1000);
+    int tapsize = gverb_pow2(44000);
+    x->x_delaymemsize = 4*fdnsize + tapsize;
+    x->x_delaymem = (float *)t_getbytes(x->x_delaymemsize*sizeof(float));
+    if(!x->x_delaymem){
         pd_error(x, "[giga.rev~]: out of memory");
         return (NULL);
     }
-    for(i = 0; i < 4; i++){
-        x->x_fdndels[i] = fixeddelay_make((int)x->x_maxdelay+1000);
-        if(!x->x_fdndels[i]){
-            pd_error(x, "[giga.rev~]: out of memory");
-            return (NULL);
-        }
-    }
-    x->x_fdngains = (float *)t_getbytes(4*sizeof(float));
-    x->x_fdnlens = (int *)t_getbytes(4*sizeof(int));
-    if(!x->x_fdngains || !x->x_fdnlens){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
-    x->x_fdndamps = (t_damper **)t_getbytes(4*sizeof(t_damper *));
-    if(!x->x_fdndamps){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
-    for(i = 0; i < 4; i++){
-        x->x_fdndamps[i] = damper_make(x->x_fdndamp);
-        if(!x->x_fdndamps[i]){
-            pd_error(x, "[giga.rev~]: out of memory");
-            return (NULL);
-        }
-    }
+    float *mem = x->x_delaymem;
+    for(i = 0; i < 4; i++)
+        mem = fixeddelay_init(&x->x_fdndels[i], mem, fdnsize);
+    fixeddelay_init(&x->x_tapdelay, mem, tapsize);
+// FDN section
+    for(i = 0; i < 4; i++)
+        damper_set(&x->x_fdndamps[i], x->x_fdndamp);
     ga = 60.0;
     gt = x->x_decay;
     ga = pow(10.0,-ga/20.0);
@@ -571,71 +518,10 @@ t_gverb *gverb_new(t_symbol *s, short ac, t_atom *av){
         x->x_fdnlens[i] = (int)gb;
         x->x_fdngains[i] = -powf((float)x->x_alpha, x->x_fdnlens[i]);
     }
-    x->x_d = (float *)t_getbytes(4*sizeof(float));
-    x->x_u = (float *)t_getbytes(4*sizeof(float));
-    x->x_f = (float *)t_getbytes(4*sizeof(float));
-    if(!x->x_d || !x->x_u || !x->x_f){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
 // Diffuser section
-    diffscale = (float)x->x_fdnlens[3]/(210+159+562+410);
-    spread1 = spread;
-    spread2 = 3.0*spread;
-    b = 210;
-    r = 0.125541f;
-    a = spread1*r;
-    c = 210+159+a;
-    cc = c-b;
-    r = 0.854046f;
-    a = spread2*r;
-    d = 210+159+562+a;
-    dd = d-c;
-    e = 1341-d;
-    x->x_ldifs = (t_diffuser **)t_getbytes(4*sizeof(t_diffuser *));
-    if(!x->x_ldifs){
-        pd_error(x, "[giga.rev~]: out of memory");
+    if(!gverb_diffusers(x, spread))
         return (NULL);
-    }
-    x->x_ldifs[0] = diffuser_make((int)(diffscale*b), 0.75);
-    x->x_ldifs[1] = diffuser_make((int)(diffscale*cc), 0.75);
-    x->x_ldifs[2] = diffuser_make((int)(diffscale*dd), 0.625);
-    x->x_ldifs[3] = diffuser_make((int)(diffscale*e), 0.625);
-    if(!x->x_ldifs[0] || !x->x_ldifs[1] || !x->x_ldifs[2] || !x->x_ldifs[3]){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
-    b = 210;
-    r = -0.568366f;
-    a = spread1*r;
-    c = 210+159+a;
-    cc = c-b;
-    r = -0.126815f;
-    a = spread2*r;
-    d = 210+159+562+a;
-    dd = d-c;
-    e = 1341-d;
-    x->x_rdifs = (t_diffuser **)t_getbytes(4*sizeof(t_diffuser *));
-    if(!x->x_rdifs){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
-    x->x_rdifs[0] = diffuser_make((int)(diffscale*b), 0.75);
-    x->x_rdifs[1] = diffuser_make((int)(diffscale*cc), 0.75);
-    x->x_rdifs[2] = diffuser_make((int)(diffscale*dd), 0.625);
-    x->x_rdifs[3] = diffuser_make((int)(diffscale*e), 0.625);
-    if(!x->x_rdifs[0] || !x->x_rdifs[1] || !x->x_rdifs[2] || !x->x_rdifs[3]){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
 // Tapped delay section
-    x->x_tapdelay = fixeddelay_make(44000);
-    x->x_taps = (int *)t_getbytes(4*sizeof(int));
-    x->x_tapgains = (float *)t_getbytes(4*sizeof(float));
-    if(!x->x_tapdelay || !x->x_taps || !x->x_tapgains){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
     x->x_taps[0] = 5+0.410*x->x_largestdelay;
     x->x_taps[1] = 5+0.300*x->x_largestdelay;
     x->x_taps[2] = 5+0.155*x->x_largestdelay;
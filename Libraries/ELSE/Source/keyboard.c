@@ -140,10 +140,20 @@ static void keyboard_get_snd_rcv(t_keyboard* x){
         x->x_rcv_raw = gensym("empty");
 }
 
+static void keyboard_gui_updated(void *client, t_glist *glist){
+    client = NULL, glist = NULL;
+}
+
+// Tells the GUI which keyboard's notes changed, so it doesn't have to poll them
+static void keyboard_notes_changed(t_keyboard* x){
+    sys_queuegui(x, x->x_glist, keyboard_gui_updated);
+}
+
 static void keyboard_play_tgl(t_keyboard* x, int note){ // TOGGLE MODE
     int i = note - x->x_first_c;
     t_canvas *cv =  glist_getcanvas(x->x_glist);
     int on = x->x_tgl_notes[note] = x->x_tgl_notes[note] ? 0 : 1;
+    keyboard_notes_changed(x);
     short key = i % 12;
     if(key == 1 || key == 3 || key == 6 || key == 8 || key == 10) // black
         sys_vgui(".x%lx.c itemconfigure %xrrk%d -fill %s\n", cv, x, i, on ? BLACK_ON : BLACK_OFF);
@@ -337,6 +347,7 @@ void keyboard_float(t_keyboard *x, t_floatarg f){
     if(x->x_vel_in > 127)
         x->x_vel_in = 127;
     int on = x->x_tgl_notes[note] = x->x_vel_in > 0;
+    keyboard_notes_changed(x);
     t_atom at[2];
     SETFLOAT(at, note);
     SETFLOAT(at+1, x->x_vel_in);
@@ -368,6 +379,7 @@ static void keyboard_set(t_keyboard *x, t_floatarg f1, t_floatarg f2){
     int note = (int)f1;
     x->x_vel_in = f2 < 0 ? 0 : f2 > 127 ? 127 : (int)f2;
     int on = x->x_tgl_notes[note] = x->x_vel_in > 0;
+    keyboard_notes_changed(x);
     if(x->x_glist->gl_havewindow){
         t_canvas *cv =  glist_getcanvas(x->x_glist);
         if(note >= x->x_first_c && note < x->x_first_c + (x->x_octaves * 12)){
@@ -507,6 +519,7 @@ static void keyboard_flush(t_keyboard* x){
                 pd_list(x->x_send->s_thing, &s_list, 2, at);
         }
     }
+    keyboard_notes_changed(x);
 }
 
 static void edit_proxy_any(t_edit_proxy *p, t_symbol *s, int ac, t_atom *av){
@@ -87,10 +87,10 @@ static t_int *lowpass_perform(t_int *w){
             ynm1 = yn;
         }
     }
-    x->x_xnm1 = xnm1;
-    x->x_xnm2 = xnm2;
-    x->x_ynm1 = ynm1;
-    x->x_ynm2 = ynm2;
+    x->x_xnm1 = (PD_BIGORSMALL(xnm1) ? 0. : xnm1);
+    x->x_xnm2 = (PD_BIGORSMALL(xnm2) ? 0. : xnm2);
+    x->x_ynm1 = (PD_BIGORSMALL(ynm1) ? 0. : ynm1);
+    x->x_ynm2 = (PD_BIGORSMALL(ynm2) ? 0. : ynm2);
     return(w+7);
 }
 
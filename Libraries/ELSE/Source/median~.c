@@ -14,34 +14,45 @@ typedef struct _median {
     t_outlet    *x_outlet;
 }t_median;
 
-void median_sort(t_float *a, int n) {
-    if(n < 2)
-        return;
-    t_float p = a[n / 2];
-    t_float *l = a;
-    t_float *r = a + n - 1;
-    while(l <= r){
-        while(*l < p)
-            l++;
-        while(*r > p)
-            r--;
-        if(l <= r){
-            t_float t = *l;
-            *l++ = *r;
-            *r-- = t;
+// puts the k-th smallest value at a[k], with smaller or equal values before it and bigger or equal ones after
+// only the side holding k is partitioned further, so it takes linear time instead of sorting everything
+static void median_select(t_float *a, int n, int k){
+    int lo = 0, hi = n - 1;
+    while(lo < hi){
+        t_float p = a[(lo + hi) / 2];
+        int l = lo, r = hi;
+        while(l <= r){
+            while(a[l] < p)
+                l++;
+            while(a[r] > p)
+                r--;
+            if(l <= r){
+                t_float t = a[l];
+                a[l++] = a[r];
+                a[r--] = t;
+            }
         }
+        if(k <= r)
+            hi = r;
+        else if(k >= l)
+            lo = l;
+        else
+            return;
     }
-    median_sort(a, r - a + 1);
-    median_sort(l, a + n - l);
 }
 
 t_float median_calculate(t_float * array, int begin, int end){
-    median_sort(array + begin, end - begin + 1);
+    t_float *a = array + begin;
     int qtd = end - begin + 1;
-    t_float median = 0;
-    median = (qtd%2 == 1) ? array[begin + ((qtd - 1)/2)] :
-        (array[begin + qtd / 2 - 1] + array[begin + qtd / 2])/2.0f;
-    return(median);
+    int k = qtd / 2;
+    median_select(a, qtd, k);
+    if(qtd%2 == 1)
+        return(a[k]);
+    t_float below = a[0]; // the other middle value is the biggest one before a[k]
+    for(int i = 1; i < k; i++)
+        if(a[i] > below)
+            below = a[i];
+    return((below + a[k])/2.0f);
 }
 
 static t_int * median_perform(t_int *w){
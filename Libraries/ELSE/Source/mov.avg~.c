@@ -11,6 +11,7 @@ typedef struct _mavg{
     unsigned int    x_last_n;                   // last # of samples for moving average
     unsigned int    x_count;                    // for 1st round of accumulation
     double          x_accum;                    // accumulation
+    double          x_fresh;                    // sum of the inputs since bufrd last looped
     double         *x_buf;                      // buffer pointer
     double          x_stack[MAVG_DEF_BUFSIZE];  // buffer
     int             x_alloc;                    // if x_buf is allocated or stack ?????
@@ -22,7 +23,7 @@ typedef struct _mavg{
 static t_class *mavg_class;
 
 static void mavg_clear(t_mavg * x){ // clear buffer and reset things to 0
-    x->x_count = x->x_accum = x->x_bufrd = 0;;
+    x->x_count = x->x_accum = x->x_fresh = x->x_bufrd = 0;;
     for(unsigned int i = 0; i < x->x_size; i++)
         x->x_buf[i] = 0.;
 };
@@ -78,8 +79,14 @@ static t_int *mavg_perform(t_int *w){
             else // subtract first sample out of bounds from the moving sum
                 x->x_accum -= x->x_buf[x->x_bufrd];
             x->x_buf[x->x_bufrd++] = input; // store input, increment bufrd
-            if(x->x_bufrd >= n) // loop bufrd
+            x->x_fresh += input;
+            if(x->x_bufrd >= n){ // loop bufrd
                 x->x_bufrd = 0;
+                // the buffer now holds exactly what was summed since the last loop, so the rounding
+                // errors of adding and subtracting don't pile up over long runs with big windows
+                x->x_accum = x->x_fresh;
+                x->x_fresh = 0;
+            }
             result = x->x_accum/(double)n; // get average
         }
         else // npoints = 1, just pass through
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <math.h>
 #include "m_pd.h"
+#include "simd.h"
 
 #define mtx_DEFGAIN  1.
 #define mtx_DEFfade  10.
@@ -160,6 +161,37 @@ static void mtx_fade(t_mtx *x, t_floatarg f){
     }
 }
 
+// out += in * coef, 4 samples at a time where there's SIMD
+static void mtx_addgain(t_float *out, t_float *in, float coef, int n){
+#ifdef ELSE_SIMD
+    else_v4f vcoef = else_v4f_set(coef);
+    for(; n >= 4; n -= 4, in += 4, out += 4)
+        else_v4f_store(out, else_v4f_add(else_v4f_load(out), else_v4f_mul(else_v4f_load(in), vcoef)));
+#endif
+    while(n--)
+        *out++ += *in++ * coef;
+}
+
+// out += in * coef while coef moves by incr every sample, the caller keeps track of where the fade is
+static void mtx_addramp(t_float *out, t_float *in, float coef, float incr, int n){
+#ifdef ELSE_SIMD
+    if(n >= 4){
+        t_float start[4] = {coef, coef + incr, coef + 2*incr, coef + 3*incr};
+        else_v4f vcoef = else_v4f_load(start);
+        else_v4f vincr = else_v4f_set(4*incr);
+        int nvec = n & ~3;
+        for(int i = 0; i < nvec; i += 4, in += 4, out += 4){
+            else_v4f_store(out, else_v4f_add(else_v4f_load(out), else_v4f_mul(else_v4f_load(in), vcoef)));
+            vcoef = else_v4f_add(vcoef, vincr);
+        }
+        coef += nvec * incr;
+        n -= nvec;
+    }
+#endif
+    while(n--)
+        *out++ += *in++ * coef, coef += incr;
+}
+
 static t_int *mtx_perform(t_int *w){
     t_mtx *x = (t_mtx *)(w[1]);
     int nblock = (int)(w[2]);
@@ -190,29 +222,24 @@ static t_int *mtx_perform(t_int *w){
                 *coefp = (*cellp ? *gainp : 0.);
             else
                 *coefp += *bigincrp;
-            while (sndx--)
-                    *out++ += *in++ * coef, coef += incr;
+            mtx_addramp(out, in, coef, incr, sndx);
         }
         else if (nleft > 0){
             float coef = *coefp;
             float incr = *incrp;
-            sndx -= nleft;
-            do{
-                *out++ += *in++ * coef, coef += incr;
-            }while (--nleft);
+            int nramp = nleft;
+            sndx -= nramp;
+            mtx_addramp(out, in, coef, incr, nramp);
             if (*cellp){
                 coef = *coefp = *gainp;
-                while (sndx--)
-                    *out++ += *in++ * coef;
+                mtx_addgain(out + nramp, in + nramp, coef, sndx);
             }
             else
                 *coefp = 0.;
             *nleftp = 0;
         }
-        else if (*cellp){
-            float coef = *coefp;
-            while (sndx--)
-                *out++ += *in++ * coef;
+        else if (*cellp && *coefp != 0){ // cells that are on with a gain of 0 are skipped too
+            mtx_addgain(out, in, *coefp, sndx);
         }
         cellp++;
         ovecp++;
@@ -2,6 +2,7 @@
 
 #include "m_pd.h"
 #include "math.h"
+#include "simd.h"
 
 static t_class  *op_class;
 
@@ -70,6 +71,55 @@ static t_int *op_perform(t_int *w){
     return(w+6);
 }
 
+#ifdef ELSE_SIMD
+// Comparisons and logic run 4 samples at a time, bitwise operators and % stay scalar
+static t_int *op_perform_simd(t_int *w){
+    t_op *x = (t_op *)(w[1]);
+    t_sample *in1 = (t_sample *)(w[2]);
+    t_sample *in2 = (t_sample *)(w[3]);
+    t_sample *out = (t_sample *)(w[4]);
+    int n = (int)(w[5]);
+    int i;
+    switch(x->x_op){
+        case 0: // lt
+            for(i = 0; i < n; i += 4)
+                else_v4f_store(out + i, else_v4f_lt(else_v4f_load(in1 + i), else_v4f_load(in2 + i)));
+            break;
+        case 1: // gt
+            for(i = 0; i < n; i += 4)
+                else_v4f_store(out + i, else_v4f_gt(else_v4f_load(in1 + i), else_v4f_load(in2 + i)));
+            break;
+        case 2: // le
+            for(i = 0; i < n; i += 4)
+                else_v4f_store(out + i, else_v4f_le(else_v4f_load(in1 + i), else_v4f_load(in2 + i)));
+            break;
+        case 3: // ge
+            for(i = 0; i < n; i += 4)
+                else_v4f_store(out + i, else_v4f_ge(else_v4f_load(in1 + i), else_v4f_load(in2 + i)));
+            break;
+        case 4: // ne
+            for(i = 0; i < n; i += 4)
+                else_v4f_store(out + i, else_v4f_ne(else_v4f_load(in1 + i), else_v4f_load(in2 + i)));
+            break;
+        case 5: // eq
+            for(i = 0; i < n; i += 4)
+                else_v4f_store(out + i, else_v4f_eq(else_v4f_load(in1 + i), else_v4f_load(in2 + i)));
+            break;
+        case 6: // and
+            for(i = 0; i < n; i += 4)
+                else_v4f_store(out + i, else_v4f_and(else_v4f_load(in1 + i), else_v4f_load(in2 + i)));
+            break;
+        case 7: // or
+            for(i = 0; i < n; i += 4)
+                else_v4f_store(out + i, else_v4f_or(else_v4f_load(in1 + i), else_v4f_load(in2 + i)));
+            break;
+        default:
+            return(op_perform(w));
+    }
+    return(w+6);
+}
+#endif
+
 static void op_lt(t_op *x){
     x->x_op = 0;
 }
@@ -132,6 +182,12 @@ static void op_mod(t_op *x){
 }
 
 static void op_dsp(t_op *x, t_signal **sp){
+#ifdef ELSE_SIMD
+    // The operator can change while dsp is running, the vector routine falls back to the scalar one itself
+    if(!(sp[0]->s_n & 3))
+        dsp_add(op_perform_simd, 5, x, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec, sp[0]->s_n);
+    else
+#endif
     dsp_add(op_perform, 5, x, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec, sp[0]->s_n);
 }
 
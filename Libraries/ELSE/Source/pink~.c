@@ -52,22 +52,21 @@ static t_int *pink_perform(t_int *w){
     float *signals = (float*)(w[4]);
     t_sample *out = (t_sample *)(w[5]);
     float total = x->x_total;
-    uint32_t *s1 = &rstate->s1;
-    uint32_t *s2 = &rstate->s2;
-    uint32_t *s3 = &rstate->s3;
+    uint32_t s1 = rstate->s1, s2 = rstate->s2, s3 = rstate->s3;
     while(n--){
-    	uint32_t rcounter = random_trand(s1, s2, s3);
-    	float newrand = random_frand(s1, s2, s3);
+    	uint32_t rcounter = random_trand(&s1, &s2, &s3);
+    	float newrand = random_frand(&s1, &s2, &s3);
     	int k = (CLZ(rcounter));
     	if(k < (x->x_octaves-1)){
     		float prevrand = signals[k];
     		signals[k] = newrand;
     		total += (newrand - prevrand);
     	}
-    	newrand = (random_frand(s1, s2, s3));
+    	newrand = (random_frand(&s1, &s2, &s3));
     	*out++ = (t_float)(total+newrand)/x->x_octaves;
 	}
 	x->x_total = total;
+    rstate->s1 = s1, rstate->s2 = s2, rstate->s3 = s3;
     return(w+6);
 }
 
@@ -2,6 +2,7 @@
 
 #include "m_pd.h"
 #include "math.h"
+#include "simd.h"
 
 static t_class *rint_class;
 
@@ -18,8 +19,24 @@ static t_int * rint_perform(t_int *w){
     return (w + 5);
 }
 
+#ifdef ELSE_SIMD
+static t_int *rint_perform_simd(t_int *w){
+    int n = (int)(w[2]);
+    t_float *in = (t_float *)(w[3]);
+    t_float *out = (t_float *)(w[4]);
+    for(int i = 0; i < n; i += 4)
+        else_v4f_store(out + i, else_v4f_rint(else_v4f_load(in + i)));
+    return(w+5);
+}
+#endif
+
 static void rint_dsp(t_rint *x, t_signal **sp){
-   dsp_add(rint_perform, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
+#ifdef ELSE_SIMD
+    if(!(sp[0]->s_n & 3))
+        dsp_add(rint_perform_simd, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
+    else
+#endif
+    dsp_add(rint_perform, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
 }
 
 void * rint_new(void){
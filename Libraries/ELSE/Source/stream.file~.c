@@ -0,0 +1,399 @@
+// Streams a sound file from disk, a reader thread keeps a ring buffer filled
+// so files never need to fit in memory. Supports RIFF WAVE files (8/16/24/32
+// bit integer, 32/64 bit float), no resampling is done.
+
+#include <stdio.h>
+#include "m_pd.h"
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef _MSC_VER
+#include <windows.h>
+#define STREAMFILE_BARRIER() MemoryBarrier()
+#define streamfile_fseek _fseeki64
+#else
+#define STREAMFILE_BARRIER() __sync_synchronize()
+#define streamfile_fseek fseeko
+#endif
+
+#define MAXCH      64
+#define RINGFRAMES 65536   // power of 2, about 1.4 seconds at 48kHz
+#define CHUNK      4096    // frames read from disk at a time
+
+// requests from Pd to the reader thread
+#define REQ_NONE   0
+#define REQ_OPEN   1
+#define REQ_SEEK   2
+#define REQ_CLOSE  3
+
+static t_class *streamfile_class;
+
+typedef struct _streamfile{
+    t_object            x_obj;
+    t_canvas           *x_canvas;
+    t_outlet           *x_bang;
+    t_clock            *x_clock;
+    t_sample          **x_outs;
+    int                 x_nch;
+    int                 x_playing;
+    int                 x_loop;
+    int                 x_open;         // a file was requested and not closed
+// ring buffer, the reader only writes x_head and Pd only writes x_tail
+    t_float            *x_ring;
+    volatile uint32_t   x_head;
+    volatile uint32_t   x_tail;
+    volatile int        x_doneid;       // last request the reader finished, the ring is only valid once this catches up with x_reqid
+    volatile int        x_eof;
+    volatile int        x_failed;
+// shared with the reader, guarded by the mutex
+    pthread_t           x_thread;
+    pthread_mutex_t     x_mutex;
+    pthread_cond_t      x_cond;
+    int                 x_request;
+    int                 x_reqid;
+    int                 x_quit;
+    char                x_path[MAXPDSTRING];
+    double              x_seekframe;
+// reader side only
+    FILE               *x_fp;
+    int                 x_filech;
+    int                 x_bytes;        // bytes per sample
+    int                 x_float;
+    int64_t             x_dataonset;
+    int64_t             x_nframes;
+    int64_t             x_frame;        // next frame to read
+    float               x_filesr;
+    unsigned char      *x_raw;
+    char                x_readpath[MAXPDSTRING];
+}t_streamfile;
+
+static uint32_t streamfile_le32(unsigned char *p){
+    return(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+static void streamfile_closefile(t_streamfile *x){
+    if(x->x_fp)
+        sys_fclose(x->x_fp);
+    x->x_fp = NULL;
+    x->x_nframes = x->x_frame = 0;
+}
+
+// parses the WAVE header, runs on the reader thread
+static int streamfile_openfile(t_streamfile *x){
+    unsigned char buf[40];
+    streamfile_closefile(x);
+    if(!(x->x_fp = sys_fopen(x->x_readpath, "rb")))
+        return(0);
+    if(fread(buf, 1, 12, x->x_fp) < 12 || memcmp(buf, "RIFF", 4) || memcmp(buf + 8, "WAVE", 4))
+        goto fail;
+    int gotformat = 0;
+    while(fread(buf, 1, 8, x->x_fp) == 8){
+        uint32_t size = streamfile_le32(buf + 4);
+        if(!memcmp(buf, "fmt ", 4)){
+            uint32_t got = size < 40 ? size : 40;
+            if(size < 16 || fread(buf, 1, got, x->x_fp) < got)
+                goto fail;
+            int format = buf[0] | (buf[1] << 8);
+            if(format == 0xFFFE && size >= 26) // WAVE_FORMAT_EXTENSIBLE, subformat has the real tag
+                format = buf[24] | (buf[25] << 8);
+            x->x_filech = buf[2] | (buf[3] << 8);
+            x->x_filesr = streamfile_le32(buf + 4);
+            x->x_bytes = (buf[14] | (buf[15] << 8)) / 8;
+            x->x_float = format == 3;
+            if((format != 1 && format != 3) || x->x_filech < 1 || x->x_filech > MAXCH
+            || (x->x_float && x->x_bytes != 4 && x->x_bytes != 8)
+            || (!x->x_float && (x->x_bytes < 1 || x->x_bytes > 4)))
+                goto fail;
+            gotformat = 1;
+            streamfile_fseek(x->x_fp, size - got + (size & 1), SEEK_CUR);
+        }
+        else if(!memcmp(buf, "data", 4)){
+            if(!gotformat)
+                goto fail;
+            x->x_dataonset = ftell(x->x_fp);
+            x->x_nframes = size / (x->x_filech * x->x_bytes);
+            x->x_frame = 0;
+            return(1);
+        }
+        else
+            streamfile_fseek(x->x_fp, size + (size & 1), SEEK_CUR);
+    }
+fail:
+    streamfile_closefile(x);
+    return(0);
+}
+
+static void streamfile_seekfile(t_streamfile *x, int64_t frame){
+    if(frame < 0 || frame >= x->x_nframes)
+        frame = 0;
+    x->x_frame = frame;
+    streamfile_fseek(x->x_fp, x->x_dataonset + frame * x->x_filech * x->x_bytes, SEEK_SET);
+}
+
+// reads and converts up to 'n' frames into the ring, returns the number of frames read
+static int streamfile_readchunk(t_streamfile *x, int n){
+    int filech = x->x_filech, bytes = x->x_bytes, nch = x->x_nch;
+    if(n > x->x_nframes - x->x_frame)
+        n = (int)(x->x_nframes - x->x_frame);
+    n = (int)fread(x->x_raw, filech * bytes, n, x->x_fp);
+    unsigned char *p = x->x_raw;
+    uint32_t head = x->x_head;
+    for(int i = 0; i < n; i++){
+        t_float *frame = x->x_ring + ((head + i) & (RINGFRAMES - 1)) * nch;
+        for(int ch = 0; ch < filech; ch++, p += bytes){
+            if(ch >= nch)
+                continue;
+            t_float f;
+            if(x->x_float){
+                if(bytes == 4){
+                    uint32_t u = streamfile_le32(p);
+                    float v;
+                    memcpy(&v, &u, 4);
+                    f = v;
+                }
+                else{
+                    uint64_t u = streamfile_le32(p) | ((uint64_t)streamfile_le32(p + 4) << 32);
+                    double v;
+                    memcpy(&v, &u, 8);
+                    f = v;
+                }
+            }
+            else if(bytes == 1)
+                f = (p[0] - 128) * (1. / 128.);
+            else if(bytes == 2)
+                f = (int16_t)(p[0] | (p[1] << 8)) * (1. / 32768.);
+            else if(bytes == 3)
+                f = (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24)) * (1. / 2147483648.);
+            else
+                f = (int32_t)streamfile_le32(p) * (1. / 2147483648.);
+            frame[ch] = f;
+        }
+        for(int ch = filech; ch < nch; ch++)
+            frame[ch] = 0;
+    }
+    x->x_frame += n;
+    STREAMFILE_BARRIER(); // samples must be visible before the new head
+    x->x_head = head + n;
+    return(n);
+}
+
+static void *streamfile_child(void *z){
+    t_streamfile *x = (t_streamfile *)z;
+    pthread_mutex_lock(&x->x_mutex);
+    while(!x->x_quit){
+        if(x->x_request != REQ_NONE){
+            int request = x->x_request, id = x->x_reqid;
+            double seekframe = x->x_seekframe;
+            if(request == REQ_OPEN)
+                strcpy(x->x_readpath, x->x_path);
+            x->x_request = REQ_NONE;
+            pthread_mutex_unlock(&x->x_mutex);
+            int ok = 1;
+            if(request == REQ_OPEN)
+                ok = streamfile_openfile(x);
+            else if(request == REQ_CLOSE)
+                streamfile_closefile(x);
+            if(request != REQ_CLOSE && x->x_fp)
+                streamfile_seekfile(x, (int64_t)seekframe);
+            x->x_head = x->x_tail = 0;
+            x->x_eof = !x->x_fp;
+            x->x_failed = !ok;
+            STREAMFILE_BARRIER();
+            x->x_doneid = id;
+            pthread_mutex_lock(&x->x_mutex);
+            continue;
+        }
+        uint32_t space = RINGFRAMES - (x->x_head - x->x_tail);
+        if(x->x_fp && !x->x_eof && space >= CHUNK){
+            pthread_mutex_unlock(&x->x_mutex);
+            int n = streamfile_readchunk(x, CHUNK);
+            if(x->x_frame >= x->x_nframes || n == 0){
+                if(x->x_loop && x->x_nframes > 0) // prefetch from the loop point straight away
+                    streamfile_seekfile(x, 0);
+                else{
+                    STREAMFILE_BARRIER();
+                    x->x_eof = 1;
+                }
+            }
+            pthread_mutex_lock(&x->x_mutex);
+            continue;
+        }
+        pthread_cond_wait(&x->x_cond, &x->x_mutex);
+    }
+    pthread_mutex_unlock(&x->x_mutex);
+    return(NULL);
+}
+
+static void streamfile_request(t_streamfile *x, int request, double frame){
+    pthread_mutex_lock(&x->x_mutex);
+    x->x_reqid++;
+    x->x_request = request;
+    x->x_seekframe = frame;
+    pthread_cond_signal(&x->x_cond);
+    pthread_mutex_unlock(&x->x_mutex);
+}
+
+static void streamfile_tick(t_streamfile *x){
+    if(x->x_failed){
+        x->x_failed = 0;
+        pd_error(x, "[stream.file~]: can't open '%s' (only WAVE files are supported)", x->x_path);
+        return;
+    }
+    outlet_bang(x->x_bang);
+}
+
+static t_int *streamfile_perform(t_int *w){
+    t_streamfile *x = (t_streamfile *)(w[1]);
+    int n = (int)(w[2]);
+    int nch = x->x_nch, done = 0;
+    int pending = x->x_doneid != x->x_reqid;
+    if(x->x_failed && !pending)
+        clock_delay(x->x_clock, 0);
+    if(x->x_playing && !pending){
+        int eof = x->x_eof;
+        STREAMFILE_BARRIER(); // read the head after eof, and the samples after the head
+        uint32_t tail = x->x_tail;
+        uint32_t avail = x->x_head - tail;
+        done = avail < (uint32_t)n ? (int)avail : n;
+        for(int i = 0; i < done; i++){
+            t_float *frame = x->x_ring + ((tail + i) & (RINGFRAMES - 1)) * nch;
+            for(int ch = 0; ch < nch; ch++)
+                x->x_outs[ch][i] = frame[ch];
+        }
+        STREAMFILE_BARRIER();
+        x->x_tail = tail + done;
+        pthread_cond_signal(&x->x_cond); // wake the reader, it refills once there's room for a chunk
+        if(done < n && eof && avail == (uint32_t)done){
+            x->x_playing = 0;
+            clock_delay(x->x_clock, 0);
+        }
+    }
+    for(int ch = 0; ch < nch; ch++)
+        memset(x->x_outs[ch] + done, 0, (n - done) * sizeof(t_sample));
+    return(w+3);
+}
+
+static void streamfile_dsp(t_streamfile *x, t_signal **sp){
+    for(int i = 0; i < x->x_nch; i++)
+        x->x_outs[i] = sp[i]->s_vec;
+    dsp_add(streamfile_perform, 2, x, sp[0]->s_n);
+}
+
+static void streamfile_open(t_streamfile *x, t_symbol *s){
+    char dir[MAXPDSTRING], *name;
+    int fd = canvas_open(x->x_canvas, s->s_name, "", dir, &name, MAXPDSTRING, 1);
+    if(fd < 0){
+        pd_error(x, "[stream.file~]: can't find '%s'", s->s_name);
+        return;
+    }
+    sys_close(fd);
+    x->x_playing = 0;
+    x->x_open = 1;
+    pthread_mutex_lock(&x->x_mutex);
+    snprintf(x->x_path, MAXPDSTRING, "%s/%s", dir, name);
+    pthread_mutex_unlock(&x->x_mutex);
+    streamfile_request(x, REQ_OPEN, 0);
+}
+
+static void streamfile_start(t_streamfile *x){
+    if(!x->x_open){
+        pd_error(x, "[stream.file~]: no file opened");
+        return;
+    }
+    if(x->x_eof && x->x_head == x->x_tail) // finished, start over
+        streamfile_request(x, REQ_SEEK, 0);
+    x->x_playing = 1;
+}
+
+static void streamfile_pause(t_streamfile *x){
+    x->x_playing = 0;
+}
+
+static void streamfile_stop(t_streamfile *x){
+    x->x_playing = 0;
+    if(x->x_open) // rewind and prefetch the beginning again
+        streamfile_request(x, REQ_SEEK, 0);
+}
+
+static void streamfile_float(t_streamfile *x, t_floatarg f){
+    f != 0 ? streamfile_start(x) : streamfile_stop(x);
+}
+
+// seeks in ms, playback continues from there once the reader has refilled the ring
+static void streamfile_seek(t_streamfile *x, t_floatarg f){
+    if(x->x_open)
+        streamfile_request(x, REQ_SEEK, f * 0.001 * (x->x_filesr > 0 ? x->x_filesr : sys_getsr()));
+}
+
+static void streamfile_loop(t_streamfile *x, t_floatarg f){
+    x->x_loop = (f != 0);
+}
+
+static void streamfile_close(t_streamfile *x){
+    x->x_playing = x->x_open = 0;
+    streamfile_request(x, REQ_CLOSE, 0);
+}
+
+static void streamfile_free(t_streamfile *x){
+    pthread_mutex_lock(&x->x_mutex);
+    x->x_quit = 1;
+    pthread_cond_signal(&x->x_cond);
+    pthread_mutex_unlock(&x->x_mutex);
+    pthread_join(x->x_thread, NULL);
+    pthread_cond_destroy(&x->x_cond);
+    pthread_mutex_destroy(&x->x_mutex);
+    streamfile_closefile(x);
+    clock_free(x->x_clock);
+    freebytes(x->x_ring, RINGFRAMES * x->x_nch * sizeof(t_float));
+    freebytes(x->x_raw, CHUNK * MAXCH * 8);
+    freebytes(x->x_outs, x->x_nch * sizeof(t_sample *));
+}
+
+static void *streamfile_new(t_symbol *s, int ac, t_atom *av){
+    s = NULL;
+    t_streamfile *x = (t_streamfile *)pd_new(streamfile_class);
+    t_symbol *file = NULL;
+    int nch = 1;
+    while(ac){
+        if(av->a_type == A_FLOAT)
+            nch = (int)av->a_w.w_float;
+        else if(av->a_type == A_SYMBOL){
+            if(av->a_w.w_symbol == gensym("-loop"))
+                x->x_loop = 1;
+            else
+                file = av->a_w.w_symbol;
+        }
+        ac--, av++;
+    }
+    x->x_nch = nch < 1 ? 1 : nch > MAXCH ? MAXCH : nch;
+    x->x_canvas = canvas_getcurrent();
+    x->x_outs = (t_sample **)getbytes(x->x_nch * sizeof(t_sample *));
+    x->x_ring = (t_float *)getbytes(RINGFRAMES * x->x_nch * sizeof(t_float));
+    x->x_raw = (unsigned char *)getbytes(CHUNK * MAXCH * 8); // largest frame: 64 channels of doubles, files with more channels are refused
+    for(int i = 0; i < x->x_nch; i++)
+        outlet_new(&x->x_obj, &s_signal);
+    x->x_bang = outlet_new(&x->x_obj, &s_bang);
+    x->x_clock = clock_new(x, (t_method)streamfile_tick);
+    x->x_eof = 1;
+    pthread_mutex_init(&x->x_mutex, NULL);
+    pthread_cond_init(&x->x_cond, NULL);
+    pthread_create(&x->x_thread, NULL, streamfile_child, x);
+    if(file)
+        streamfile_open(x, file);
+    return(x);
+}
+
+void setup_stream0x2efile_tilde(void){
+    streamfile_class = class_new(gensym("stream.file~"), (t_newmethod)streamfile_new,
+        (t_method)streamfile_free, sizeof(t_streamfile), 0, A_GIMME, 0);
+    class_addfloat(streamfile_class, streamfile_float);
+    class_addbang(streamfile_class, streamfile_start);
+    class_addmethod(streamfile_class, (t_method)streamfile_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(streamfile_class, (t_method)streamfile_open, gensym("open"), A_SYMBOL, 0);
+    class_addmethod(streamfile_class, (t_method)streamfile_start, gensym("start"), 0);
+    class_addmethod(streamfile_class, (t_method)streamfile_stop, gensym("stop"), 0);
+    class_addmethod(streamfile_class, (t_method)streamfile_pause, gensym("pause"), 0);
+    class_addmethod(streamfile_class, (t_method)streamfile_seek, gensym("seek"), A_FLOAT, 0);
+    class_addmethod(streamfile_class, (t_method)streamfile_loop, gensym("loop"), A_FLOAT, 0);
+    class_addmethod(streamfile_class, (t_method)streamfile_close, gensym("close"), 0);
+}
@@ -2,6 +2,7 @@
 
 #include "m_pd.h"
 #include "math.h"
+#include "simd.h"
 
 static t_class *trunc_tilde_class;
 
@@ -18,8 +19,24 @@ static t_int *trunc_tilde_perform(t_int *w){
     return(w+5);
 }
 
+#ifdef ELSE_SIMD
+static t_int *trunc_tilde_perform_simd(t_int *w){
+    int n = (int)(w[2]);
+    t_float *in = (t_float *)(w[3]);
+    t_float *out = (t_float *)(w[4]);
+    for(int i = 0; i < n; i += 4)
+        else_v4f_store(out + i, else_v4f_trunc(else_v4f_load(in + i)));
+    return(w+5);
+}
+#endif
+
 static void trunc_tilde_dsp(t_trunc_tilde *x, t_signal **sp){
-   dsp_add(trunc_tilde_perform, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
+#ifdef ELSE_SIMD
+    if(!(sp[0]->s_n & 3))
+        dsp_add(trunc_tilde_perform_simd, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
+    else
+#endif
+    dsp_add(trunc_tilde_perform, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
 }
 
 void * trunc_tilde_new(void){
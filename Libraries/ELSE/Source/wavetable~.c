@@ -65,8 +65,13 @@ static t_int *wavetable_perform(t_int *w){
     double phase = x->x_phase;
     double last_phase_offset = x->x_last_phase_offset;
     double sr = x->x_sr;
+// these don't change within a block, read them once instead of per sample
+    int playable = x->x_buffer->c_playable;
+    int hasfeeders = x->x_hasfeeders;
+    int interp = x->x_interp;
+    int size = (t_int)(x->x_buffer->c_npts);
     while(n--){
-        if(x->x_buffer->c_playable){
+        if(playable){
             double hz = *in1++;
             double phase_offset = (double)*in3++;
             double phase_step = hz / sr; // phase_step
@@ -74,7 +79,7 @@ static t_int *wavetable_perform(t_int *w){
             double phase_dev = phase_offset - last_phase_offset;
             if(phase_dev >= 1 || phase_dev <= -1)
                 phase_dev = fmod(phase_dev, 1); // wrap
-            if(x->x_hasfeeders){ // signal connected, no magic
+            if(hasfeeders){ // signal connected, no magic
                 t_float trig = *in2++;
                 if(trig > 0 && trig <= 1)
                     phase = trig;
@@ -85,18 +90,17 @@ static t_int *wavetable_perform(t_int *w){
             if(phase >= 1)
                 phase -= 1.; // wrap deviated phase
             if(vector){
-                int size = (t_int)(x->x_buffer->c_npts);
-                if(x->x_interp == 0){
+                if(interp == 0){
                     int ndx = (int)(phase*(double)size);
                     *out++ = (double)vector[ndx].w_float;
                 }
-                else if(x->x_interp == 3){
+                else if(interp == 3){
                     INDEX_4PT()
                     *out++ = interp_lagrange(frac, a, b, c, d);
                 }
                 else{
                     INDEX_2PT()
-                    *out++ = x->x_interp ? interp_cos(frac, b, c) : interp_lin(frac, b, c);
+                    *out++ = interp ? interp_cos(frac, b, c) : interp_lin(frac, b, c);
                 }
             }
             else // ??? maybe we dont need "playable"?
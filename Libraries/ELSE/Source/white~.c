@@ -26,14 +26,12 @@ static t_int *white_perform(t_int *w){
     int n = (t_int)(w[2]);
     t_random_state *rstate = (t_random_state *)(w[3]);
     t_sample *out = (t_sample *)(w[4]);
-    uint32_t *s1 = &rstate->s1;
-    uint32_t *s2 = &rstate->s2;
-    uint32_t *s3 = &rstate->s3;
-    while(n--){
-        t_float noise = (t_float)(random_frand(s1, s2, s3));
-        if(x->x_clip)
-            noise = noise > 0 ? 1 : -1;
-        *out++ = noise;
+    random_frand_block(rstate, out, n);
+    if(x->x_clip){
+        while(n--){
+            *out = *out > 0 ? 1 : -1;
+            out++;
+        }
     }
     return(w+5);
 }
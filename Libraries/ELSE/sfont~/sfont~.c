@@ -58,6 +58,11 @@ typedef struct _sfont{
     int                 x_tune_bank;
     int                 x_tune_prog;
     int                 x_ch;
+    int                 x_cores;
+    int                 x_blocksize;    // internal render block, 0 renders Pd's block directly
+    int                 x_bufpos;
+    float              *x_bufl;
+    float              *x_bufr;
     int                 x_verbosity;
     int                 x_count;
     int                 x_ready;
@@ -542,7 +547,29 @@ t_int *sfont_perform(t_int *w){
     t_sample *left = (t_sample *)(w[2]);
     t_sample *right = (t_sample *)(w[3]);
     int n = (int)(w[4]);
-    fluid_synth_write_float(x->x_synth, n, left, 0, 1, right, 0, 1);
+    if(x->x_blocksize <= n){
+        fluid_synth_write_float(x->x_synth, n, left, 0, 1, right, 0, 1);
+        return(w+5);
+    }
+// render ahead in larger blocks so fluidsynth's mixer threads get more
+// than one 64 sample block of work per wakeup, at the cost of latency
+    while(n){
+        if(x->x_bufpos >= x->x_blocksize){
+            fluid_synth_write_float(x->x_synth, x->x_blocksize,
+                x->x_bufl, 0, 1, x->x_bufr, 0, 1);
+            x->x_bufpos = 0;
+        }
+        int chunk = x->x_blocksize - x->x_bufpos;
+        if(chunk > n)
+            chunk = n;
+        float *l = x->x_bufl + x->x_bufpos, *r = x->x_bufr + x->x_bufpos;
+        for(int i = 0; i < chunk; i++){
+            *left++ = l[i];
+            *right++ = r[i];
+        }
+        x->x_bufpos += chunk;
+        n -= chunk;
+    }
     return(w+5);
 }
 
@@ -557,6 +584,8 @@ static void sfont_free(t_sfont *x){
         delete_fluid_settings(x->x_settings);
     if(x->x_elsefilehandle)
         elsefile_free(x->x_elsefilehandle);
+    if(x->x_bufl)
+        freebytes(x->x_bufl, 2 * x->x_blocksize * sizeof(float));
 }
 
 static void *sfont_new(t_symbol *s, int ac, t_atom *av){
@@ -565,6 +594,9 @@ static void *sfont_new(t_symbol *s, int ac, t_atom *av){
     x->x_elsefilehandle = elsefile_new((t_pd *)x, sfont_readhook, 0);
     x->x_synth = NULL;
     x->x_settings = NULL;
+    x->x_bufl = x->x_bufr = NULL;
+    x->x_blocksize = x->x_bufpos = 0;
+    x->x_cores = 1;
     x->x_sfname = NULL;
     x->x_tune_name = gensym("custom-tuning");
     x->x_base = 60;
@@ -582,7 +614,7 @@ static void *sfont_new(t_symbol *s, int ac, t_atom *av){
         return(NULL);
     }
     x->x_ch = 16;
-    int arg = 0;
+    int arg = 0, lazy = 0;
     double g = 0.4;
     t_symbol *filename = NULL;
     while(ac){
@@ -606,6 +638,30 @@ static void *sfont_new(t_symbol *s, int ac, t_atom *av){
                 else
                     goto errstate;
             }
+            else if(sym == gensym("-lazy") && !arg){
+                lazy = 1;
+                ac--, av++;
+            }
+            else if(sym == gensym("-cores") && !arg){
+                ac--, av++;
+                if(ac && av->a_type == A_FLOAT){
+                    int cores = atom_getfloatarg(0, ac, av);
+                    x->x_cores = cores < 1 ? 1 : cores > 256 ? 256 : cores;
+                    ac--, av++;
+                }
+                else
+                    goto errstate;
+            }
+            else if(sym == gensym("-block") && !arg){
+                ac--, av++;
+                if(ac && av->a_type == A_FLOAT){
+                    int size = atom_getfloatarg(0, ac, av);
+                    x->x_blocksize = size < 64 ? 0 : size > 8192 ? 8192 : size;
+                    ac--, av++;
+                }
+                else
+                    goto errstate;
+            }
             else if(sym == gensym("-g") && !arg){
                 ac--, av++;
                 if(ac && av->a_type == A_FLOAT){
@@ -635,6 +691,11 @@ static void *sfont_new(t_symbol *s, int ac, t_atom *av){
     fluid_settings_setnum(x->x_settings, "synth.gain", g);
     fluid_settings_setnum(x->x_settings, "synth.sample-rate", sys_getsr());
     fluid_settings_setnum(x->x_settings, "synth.sample-rate", sys_getsr());
+    fluid_settings_setint(x->x_settings, "synth.cpu-cores", x->x_cores);
+// samples go through fluidsynth's process wide cache either way, so instances
+// with the same file share memory; lazy loading only reads the samples of
+// presets that are selected on a channel, when the program change arrives
+    fluid_settings_setint(x->x_settings, "synth.dynamic-sample-loading", lazy);
 //  fluid_settings_setint(x->x_settings, "synth.polyphony", 256);
 //    fluid_settings_setstr(x->x_settings, "synth.midi-bank-select", "gs");
     x->x_synth = new_fluid_synth(x->x_settings); // Create fluidsynth instance:
@@ -642,6 +703,11 @@ static void *sfont_new(t_symbol *s, int ac, t_atom *av){
         pd_error(x, "[sfont~]: bug couldn't create fluidsynth instance");
         return(NULL);
     }
+    if(x->x_blocksize){
+        x->x_bufl = (float *)getbytes(2 * x->x_blocksize * sizeof(float));
+        x->x_bufr = x->x_bufl + x->x_blocksize;
+        x->x_bufpos = x->x_blocksize;
+    }
     if(filename)
         fluid_do_load(x, filename);
     return(x);
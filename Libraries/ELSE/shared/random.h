@@ -1,6 +1,10 @@
 // random number generator from supercollider
 // coded by matt barber
 
+#ifndef ELSE_RANDOM_H
+#define ELSE_RANDOM_H
+
+#include "m_pd.h"
 #include <stdint.h>
 #include <time.h>
 
@@ -13,8 +17,26 @@ typedef struct _random_state{
 int random_get_id(void);
 void random_init(t_random_state* rstate, int seed);
 int get_seed(t_symbol *s, int ac, t_atom *av, int n);
-uint32_t random_trand(uint32_t* s1, uint32_t* s2, uint32_t* s3);
-float random_frand(uint32_t* s1, uint32_t* s2, uint32_t* s3);
+
+// Provided for speed in inner loops where the state variables are loaded into registers.
+// Thus updating the instance variables can be postponed until the end of the loop.
+// They're inline so the state can stay in registers when perform routines copy it to locals
+static inline uint32_t random_trand(uint32_t *s1, uint32_t *s2, uint32_t *s3){
+    *s1 = ((*s1 & (uint32_t)- 2) << 12) ^ (((*s1 << 13) ^ *s1) >> 19);
+    *s2 = ((*s2 & (uint32_t)- 8) <<  4) ^ (((*s2 <<  2) ^ *s2) >> 25);
+    *s3 = ((*s3 & (uint32_t)-16) << 17) ^ (((*s3 <<  3) ^ *s3) >> 11);
+    return(*s1 ^ *s2 ^ *s3);
+}
+
+static inline float random_frand(uint32_t *s1, uint32_t *s2, uint32_t *s3){
+    // return a float from -1.0 to +0.999...
+    union { uint32_t i; float f; } u; // union for floating point conversion of result
+    u.i = 0x40000000 | (random_trand(s1, s2, s3) >> 9);
+    return(u.f - 3.f);
+}
+
+// Fills a block with what n calls to random_frand() would give, so seeded objects sound the same
+void random_frand_block(t_random_state* rstate, t_sample *out, int n);
 
 // These are for [pink~]
 
@@ -84,3 +106,5 @@ static __inline__ int32_t CLZ(int32_t arg){
 }
 
 #endif
+
+#endif
@@ -0,0 +1,112 @@
+// 4 wide float vectors for element-wise signal objects, with SSE2 or NEON
+// ELSE_SIMD is only defined when t_float is a 32 bit float and one of those is available
+// Objects pick their vector perform routine when the block length is a multiple of 4
+
+#ifndef ELSE_SIMD_H
+#define ELSE_SIMD_H
+
+#include "m_pd.h"
+
+#if PD_FLOATSIZE == 32
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ELSE_SIMD 1
+#define ELSE_SIMD_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define ELSE_SIMD 1
+#define ELSE_SIMD_NEON 1
+#endif
+#endif
+
+#ifdef ELSE_SIMD
+
+#ifdef ELSE_SIMD_SSE2
+
+typedef __m128 else_v4f;
+
+static inline else_v4f else_v4f_load(const t_float *p){return(_mm_loadu_ps(p));}
+static inline void else_v4f_store(t_float *p, else_v4f v){_mm_storeu_ps(p, v);}
+static inline else_v4f else_v4f_set(float f){return(_mm_set1_ps(f));}
+static inline else_v4f else_v4f_add(else_v4f a, else_v4f b){return(_mm_add_ps(a, b));}
+static inline else_v4f else_v4f_mul(else_v4f a, else_v4f b){return(_mm_mul_ps(a, b));}
+
+// Comparisons give 1 or 0, like the scalar versions
+static inline else_v4f else_v4f_lt(else_v4f a, else_v4f b){return(_mm_and_ps(_mm_cmplt_ps(a, b), _mm_set1_ps(1.f)));}
+static inline else_v4f else_v4f_gt(else_v4f a, else_v4f b){return(_mm_and_ps(_mm_cmpgt_ps(a, b), _mm_set1_ps(1.f)));}
+static inline else_v4f else_v4f_le(else_v4f a, else_v4f b){return(_mm_and_ps(_mm_cmple_ps(a, b), _mm_set1_ps(1.f)));}
+static inline else_v4f else_v4f_ge(else_v4f a, else_v4f b){return(_mm_and_ps(_mm_cmpge_ps(a, b), _mm_set1_ps(1.f)));}
+static inline else_v4f else_v4f_ne(else_v4f a, else_v4f b){return(_mm_and_ps(_mm_cmpneq_ps(a, b), _mm_set1_ps(1.f)));}
+static inline else_v4f else_v4f_eq(else_v4f a, else_v4f b){return(_mm_and_ps(_mm_cmpeq_ps(a, b), _mm_set1_ps(1.f)));}
+static inline else_v4f else_v4f_and(else_v4f a, else_v4f b){
+    __m128 zero = _mm_setzero_ps();
+    return(_mm_and_ps(_mm_and_ps(_mm_cmpneq_ps(a, zero), _mm_cmpneq_ps(b, zero)), _mm_set1_ps(1.f)));
+}
+static inline else_v4f else_v4f_or(else_v4f a, else_v4f b){
+    __m128 zero = _mm_setzero_ps();
+    return(_mm_and_ps(_mm_or_ps(_mm_cmpneq_ps(a, zero), _mm_cmpneq_ps(b, zero)), _mm_set1_ps(1.f)));
+}
+
+// SSE2 has no rounding instructions, values from 2^23 on are integers already and are passed as they are, so is nan
+static inline else_v4f else_v4f_select_integral(else_v4f x, else_v4f rounded){
+    __m128 abs = _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)));
+    __m128 small = _mm_cmplt_ps(abs, _mm_set1_ps(8388608.f));
+    // keep the sign, so -0.5 gives -0 like the libm functions
+    rounded = _mm_or_ps(rounded, _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x80000000))));
+    return(_mm_or_ps(_mm_and_ps(small, rounded), _mm_andnot_ps(small, x)));
+}
+static inline else_v4f else_v4f_trunc(else_v4f x){
+    return(else_v4f_select_integral(x, _mm_cvtepi32_ps(_mm_cvttps_epi32(x))));
+}
+static inline else_v4f else_v4f_rint(else_v4f x){ // uses the current rounding mode, like rint()
+    return(else_v4f_select_integral(x, _mm_cvtepi32_ps(_mm_cvtps_epi32(x))));
+}
+static inline else_v4f else_v4f_floor(else_v4f x){
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    t = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.f)));
+    return(else_v4f_select_integral(x, t));
+}
+static inline else_v4f else_v4f_ceil(else_v4f x){
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    t = _mm_add_ps(t, _mm_and_ps(_mm_cmplt_ps(t, x), _mm_set1_ps(1.f)));
+    return(else_v4f_select_integral(x, t));
+}
+
+#else // ELSE_SIMD_NEON
+
+typedef float32x4_t else_v4f;
+
+static inline else_v4f else_v4f_load(const t_float *p){return(vld1q_f32(p));}
+static inline void else_v4f_store(t_float *p, else_v4f v){vst1q_f32(p, v);}
+static inline else_v4f else_v4f_set(float f){return(vdupq_n_f32(f));}
+static inline else_v4f else_v4f_add(else_v4f a, else_v4f b){return(vaddq_f32(a, b));}
+static inline else_v4f else_v4f_mul(else_v4f a, else_v4f b){return(vmulq_f32(a, b));}
+
+static inline else_v4f else_v4f_mask(uint32x4_t m){
+    return(vreinterpretq_f32_u32(vandq_u32(m, vreinterpretq_u32_f32(vdupq_n_f32(1.f)))));
+}
+static inline else_v4f else_v4f_lt(else_v4f a, else_v4f b){return(else_v4f_mask(vcltq_f32(a, b)));}
+static inline else_v4f else_v4f_gt(else_v4f a, else_v4f b){return(else_v4f_mask(vcgtq_f32(a, b)));}
+static inline else_v4f else_v4f_le(else_v4f a, else_v4f b){return(else_v4f_mask(vcleq_f32(a, b)));}
+static inline else_v4f else_v4f_ge(else_v4f a, else_v4f b){return(else_v4f_mask(vcgeq_f32(a, b)));}
+static inline else_v4f else_v4f_ne(else_v4f a, else_v4f b){return(else_v4f_mask(vmvnq_u32(vceqq_f32(a, b))));}
+static inline else_v4f else_v4f_eq(else_v4f a, else_v4f b){return(else_v4f_mask(vceqq_f32(a, b)));}
+static inline else_v4f else_v4f_and(else_v4f a, else_v4f b){
+    float32x4_t zero = vdupq_n_f32(0.f);
+    return(else_v4f_mask(vandq_u32(vmvnq_u32(vceqq_f32(a, zero)), vmvnq_u32(vceqq_f32(b, zero)))));
+}
+static inline else_v4f else_v4f_or(else_v4f a, else_v4f b){
+    float32x4_t zero = vdupq_n_f32(0.f);
+    return(else_v4f_mask(vorrq_u32(vmvnq_u32(vceqq_f32(a, zero)), vmvnq_u32(vceqq_f32(b, zero)))));
+}
+
+static inline else_v4f else_v4f_trunc(else_v4f x){return(vrndq_f32(x));}
+static inline else_v4f else_v4f_rint(else_v4f x){return(vrndxq_f32(x));}
+static inline else_v4f else_v4f_floor(else_v4f x){return(vrndmq_f32(x));}
+static inline else_v4f else_v4f_ceil(else_v4f x){return(vrndpq_f32(x));}
+
+#endif
+
+#endif // ELSE_SIMD
+
+#endif // ELSE_SIMD_H
@@ -12,6 +12,7 @@
 #include "m_pd.h"
 #include <common/api.h>
 #include <math.h>
+#include "signal/fastmath.h"
 
 static t_class *atodb_class;
 
@@ -19,6 +20,7 @@ typedef struct _atodb{
   t_object x_obj;
   t_inlet *x_inlet;
   t_outlet *x_outlet;
+  int x_fast;
 }t_atodb;
 
 static t_int * atodb_perform(t_int *w){
@@ -26,6 +28,15 @@ static t_int * atodb_perform(t_int *w){
     int n = (int)(w[2]);
     t_float *in = (t_float *)(w[3]);
     t_float *out = (t_float *)(w[4]);
+    if(x->x_fast){ // 20*log10(a) = 20*log10(2) * log2(a), 0 and below give the -999 floor
+        for(int i = 0; i < n; i++){
+            float a = in[i];
+            float output = 6.02059991328f * fastmath_log2(a > 0 ? a : 1.f);
+            output = output < -999 ? -999 : output;
+            out[i] = a > 0 ? output : -999;
+        }
+        return(w+5);
+    }
     while(n--){
         t_float output = (20*log10(*in++));
         if(output < -999)
@@ -35,6 +46,10 @@ static t_int * atodb_perform(t_int *w){
     return(w+5);
 }
 
+static void atodb_fast(t_atodb *x, t_floatarg f){
+  x->x_fast = (f != 0);
+}
+
 static void atodb_dsp(t_atodb *x, t_signal **sp){
   dsp_add(atodb_perform, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
 }
@@ -50,4 +65,5 @@ CYCLONE_OBJ_API void atodb_tilde_setup(void) {
        (t_newmethod) atodb_new, 0, sizeof (t_atodb), CLASS_DEFAULT, 0);
   class_addmethod(atodb_class, nullfn, gensym("signal"), 0);
   class_addmethod(atodb_class, (t_method) atodb_dsp, gensym("dsp"), A_CANT, 0);
+  class_addmethod(atodb_class, (t_method) atodb_fast, gensym("fast"), A_FLOAT, 0);
 }
@@ -9,6 +9,7 @@
 
 #define BUFFIR_DEFSIZE    0
 #define BUFFIR_MAXSIZE  4096
+#define BUFFIR_FFTMAXSIZE  (1 << 22) /* about 95 seconds at 44.1kHz */
 
 typedef struct _buffir
 {
@@ -22,6 +23,21 @@ typedef struct _buffir
     t_float *x_histhi;
     t_float  x_histbuf[2 * BUFFIR_MAXSIZE];
     int      x_checked;
+    /* uniformly partitioned convolution, one partition per block */
+    int      x_fft;
+    int      x_nblock;     /* block size of the last dsp call */
+    int      x_blocksize;  /* block size the partitions were allocated for */
+    int      x_maxparts;   /* partitions allocated */
+    int      x_fdlhead;    /* newest slot in the frequency domain delay line */
+    int      x_irstale;
+    int      x_iroff;      /* range the ir partitions were computed for */
+    int      x_irsize;
+    int      x_irparts;
+    t_float *x_fftbuf;     /* 2 * blocksize */
+    t_float *x_prev;       /* previous input block */
+    t_float *x_acc;        /* spectra are stored split: re[0..n], im[0..n] */
+    t_float *x_irspec;
+    t_float *x_fdl;
 } t_buffir;
 
 static t_class *buffir_class;
@@ -45,12 +61,152 @@ static void buffir_clear(t_buffir *x)
     memset(x->x_histlo, 0, 2 * BUFFIR_MAXSIZE * sizeof(*x->x_histlo));
     x->x_lohead = x->x_histlo;
     x->x_hihead = x->x_histhi = x->x_histlo + BUFFIR_MAXSIZE;
+    if (x->x_fdl)
+    {
+	memset(x->x_prev, 0, x->x_blocksize * sizeof(t_float));
+	memset(x->x_fdl, 0,
+	    x->x_maxparts * (x->x_blocksize + 1) * 2 * sizeof(t_float));
+    }
+}
+
+/* spectrum size for one partition, split into x_blocksize + 1 real and imaginary bins */
+#define BUFFIR_SPECSIZE(x)  (((x)->x_blocksize + 1) * 2)
+
+static void buffir_fftfree(t_buffir *x)
+{
+    int specsize = BUFFIR_SPECSIZE(x);
+    if (x->x_fftbuf)
+    {
+	freebytes(x->x_fftbuf, 2 * x->x_blocksize * sizeof(t_float));
+	freebytes(x->x_prev, x->x_blocksize * sizeof(t_float));
+	freebytes(x->x_acc, specsize * sizeof(t_float));
+	freebytes(x->x_irspec, x->x_maxparts * specsize * sizeof(t_float));
+	freebytes(x->x_fdl, x->x_maxparts * specsize * sizeof(t_float));
+    }
+    x->x_fftbuf = x->x_prev = x->x_acc = x->x_irspec = x->x_fdl = 0;
+    x->x_maxparts = 0;
+}
+
+/* allocates enough partitions to cover the whole buffer, so offset and size
+   changes at run time never need memory */
+static void buffir_fftalloc(t_buffir *x, int blocksize)
+{
+    int npts = x->x_cybuf->c_npts;
+    if (npts > BUFFIR_FFTMAXSIZE)
+	npts = BUFFIR_FFTMAXSIZE;
+    int maxparts = (npts + blocksize - 1) / blocksize;
+    if (maxparts < 1)
+	maxparts = 1;
+    if (x->x_fftbuf && blocksize == x->x_blocksize && maxparts == x->x_maxparts)
+    {
+	x->x_irstale = 1;
+	return;
+    }
+    buffir_fftfree(x);
+    x->x_blocksize = blocksize;
+    int specsize = BUFFIR_SPECSIZE(x);
+    x->x_fftbuf = getbytes(2 * blocksize * sizeof(t_float));
+    x->x_prev = getbytes(blocksize * sizeof(t_float));
+    x->x_acc = getbytes(specsize * sizeof(t_float));
+    x->x_irspec = getbytes(maxparts * specsize * sizeof(t_float));
+    x->x_fdl = getbytes(maxparts * specsize * sizeof(t_float));
+    x->x_maxparts = maxparts;
+    x->x_fdlhead = 0;
+    x->x_irstale = 1;
+}
+
+/* real fft of x_fftbuf, stored split into re[0..n] and im[0..n] */
+static void buffir_forward(t_buffir *x, t_float *spec)
+{
+    int n = x->x_blocksize, fftsize = 2 * n;
+    t_float *buf = x->x_fftbuf, *re = spec, *im = spec + n + 1;
+    mayer_realfft(fftsize, buf);
+    re[0] = buf[0], im[0] = 0;
+    for (int k = 1; k < n; k++)
+	re[k] = buf[k], im[k] = buf[fftsize - k];
+    re[n] = buf[n], im[n] = 0;
+}
+
+static void buffir_computeir(t_buffir *x, t_word *vec, int off, int npts)
+{
+    int n = x->x_blocksize, specsize = BUFFIR_SPECSIZE(x);
+    int nparts = (npts + n - 1) / n;
+    if (nparts > x->x_maxparts)
+	nparts = x->x_maxparts;
+    for (int p = 0; p < nparts; p++)
+    {
+	int start = p * n, count = npts - start < n ? npts - start : n;
+	for (int i = 0; i < count; i++)
+	    x->x_fftbuf[i] = vec[off + start + i].w_float;
+	memset(x->x_fftbuf + count, 0, (2 * n - count) * sizeof(t_float));
+	buffir_forward(x, x->x_irspec + p * specsize);
+    }
+    x->x_iroff = off;
+    x->x_irsize = npts;
+    x->x_irparts = nparts;
+    x->x_irstale = 0;
+}
+
+/* overlap-save: each block's spectrum of [previous block, this block] is kept in
+   a delay line and multiplied with the ir partition of the same age */
+static void buffir_fftperform(t_buffir *x, t_float *xin, t_float *out,
+    t_word *vec, int off, int npts)
+{
+    int n = x->x_blocksize, fftsize = 2 * n, specsize = BUFFIR_SPECSIZE(x);
+    if (x->x_irstale || off != x->x_iroff || npts != x->x_irsize)
+	buffir_computeir(x, vec, off, npts);
+    memcpy(x->x_fftbuf, x->x_prev, n * sizeof(t_float));
+    memcpy(x->x_fftbuf + n, xin, n * sizeof(t_float));
+    memcpy(x->x_prev, xin, n * sizeof(t_float));
+    t_float *head = x->x_fdl + x->x_fdlhead * specsize;
+    buffir_forward(x, head);
+    t_float *acc = x->x_acc;
+    memset(acc, 0, specsize * sizeof(t_float));
+    for (int p = 0, slot = x->x_fdlhead; p < x->x_irparts; p++)
+    {
+	t_float *xr = x->x_fdl + slot * specsize, *xi = xr + n + 1;
+	t_float *hr = x->x_irspec + p * specsize, *hi = hr + n + 1;
+	t_float *ar = acc, *ai = acc + n + 1;
+	for (int k = 0; k <= n; k++)
+	{
+	    ar[k] += xr[k] * hr[k] - xi[k] * hi[k];
+	    ai[k] += xr[k] * hi[k] + xi[k] * hr[k];
+	}
+	if (--slot < 0)
+	    slot = x->x_maxparts - 1;
+    }
+    if (++x->x_fdlhead >= x->x_maxparts)
+	x->x_fdlhead = 0;
+    t_float *buf = x->x_fftbuf;
+    buf[0] = acc[0];
+    for (int k = 1; k < n; k++)
+	buf[k] = acc[k], buf[fftsize - k] = acc[n + 1 + k];
+    buf[n] = acc[n];
+    mayer_realifft(fftsize, buf);
+    t_float scale = 1. / fftsize;
+    for (int i = 0; i < n; i++)
+	out[i] = buf[n + i] * scale;
 }
 
 static void buffir_set(t_buffir *x, t_symbol *s, t_floatarg f1, t_floatarg f2)
 {
     cybuf_setarray(x->x_cybuf, s);
     buffir_setrange(x, f1, f2);
+    if (x->x_fft && x->x_nblock)
+	buffir_fftalloc(x, x->x_nblock);
+}
+
+/* 'fft 1' switches to partitioned convolution for long impulse responses;
+   offset and size are then read once per block, send it again after
+   changing the buffer contents */
+static void buffir_fftmode(t_buffir *x, t_floatarg f)
+{
+    x->x_fft = (f != 0);
+    if (x->x_fft && x->x_nblock)
+    {
+	cybuf_checkdsp(x->x_cybuf);
+	buffir_fftalloc(x, x->x_nblock);
+    }
 }
 
 
@@ -68,6 +224,25 @@ static t_int *buffir_perform(t_int *w)
     t_float *lohead = x->x_lohead;
     t_float *hihead = x->x_hihead;
     t_cybuf *c = x->x_cybuf;
+    if (x->x_fft && x->x_fftbuf && nblock == x->x_blocksize)
+    {
+	int off = (int)*(t_float *)(w[4]);
+	int npts = (int)*(t_float *)(w[5]);
+	if (off < 0)
+	    off = 0;
+	if (npts > BUFFIR_FFTMAXSIZE)
+	    npts = BUFFIR_FFTMAXSIZE;
+	if (npts > c->c_npts - off)
+	    npts = c->c_npts - off;
+	if (c->c_playable && npts > 0)
+	    buffir_fftperform(x, xin, out, c->c_vectors[0], off, npts);
+	else
+	{
+	    memcpy(x->x_prev, xin, nblock * sizeof(t_float));
+	    memset(out, 0, nblock * sizeof(t_float));
+	}
+	return (w + 7);
+    }
     if (c->c_playable)
     {	
 
@@ -135,6 +310,9 @@ static void buffir_dsp(t_buffir *x, t_signal **sp)
 {
 	x->x_checked = 0;
     cybuf_checkdsp(x->x_cybuf); 
+    x->x_nblock = sp[0]->s_n;
+    if (x->x_fft)
+	buffir_fftalloc(x, x->x_nblock);
     dsp_add(buffir_perform, 6, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec);
 }
 
@@ -143,6 +321,7 @@ static void buffir_free(t_buffir *x)
     inlet_free(x->x_offlet);
     inlet_free(x->x_sizlet);
     cybuf_free(x->x_cybuf);
+    buffir_fftfree(x);
 }
 
 static void *buffir_new(t_symbol *s, t_floatarg f1, t_floatarg f2)
@@ -181,4 +360,5 @@ CYCLONE_OBJ_API void buffir_tilde_setup(void)
     class_addmethod(buffir_class, (t_method)buffir_clear, gensym("clear"), 0);
     class_addmethod(buffir_class, (t_method)buffir_set, gensym("set"), A_SYMBOL,
                     A_DEFFLOAT, A_DEFFLOAT, 0);
+    class_addmethod(buffir_class, (t_method)buffir_fftmode, gensym("fft"), A_FLOAT, 0);
 }
@@ -10,6 +10,7 @@
 */
 #include "m_pd.h"
 #include <common/api.h>
+#include "signal/fastmath.h"
 #include <math.h>
 
 static t_class *dbtoa_class;
@@ -18,6 +19,7 @@ typedef struct _dbtoa {
   t_object x_obj;
   t_inlet *x_inlet;
   t_outlet *x_outlet;
+  int x_fast;
 } t_dbtoa;
 
 static t_int * dbtoa_perform(t_int *w)
@@ -26,12 +28,23 @@ static t_int * dbtoa_perform(t_int *w)
   int n = (int)(w[2]);
   t_float *in = (t_float *)(w[3]);
   t_float *out = (t_float *)(w[4]);
+
+  if(x->x_fast){ // 10^(db/20) = 2^(db * log2(10)/20)
+    for(int i = 0; i < n; i++)
+      out[i] = fastmath_exp2(in[i] * 0.166096404744f);
+    return (w + 5);
+  }
     
   while(n--)
     *out++ = pow(10.,*in++/20);
   return (w + 5);
 }
 
+static void dbtoa_fast(t_dbtoa *x, t_floatarg f)
+{
+  x->x_fast = (f != 0);
+}
+
 
 static void dbtoa_dsp(t_dbtoa *x, t_signal **sp)
 {
@@ -54,5 +67,6 @@ CYCLONE_OBJ_API void dbtoa_tilde_setup(void) {
 			  0);
   class_addmethod(dbtoa_class, nullfn, gensym("signal"), 0);
   class_addmethod(dbtoa_class, (t_method) dbtoa_dsp, gensym("dsp"), A_CANT, 0);
+  class_addmethod(dbtoa_class, (t_method) dbtoa_fast, gensym("fast"), A_FLOAT, 0);
 }
 
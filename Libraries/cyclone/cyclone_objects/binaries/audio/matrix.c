@@ -200,6 +200,47 @@ static void matrix_ramp(t_matrix *x, t_floatarg f){ // CHECKED active ramps are
     }
 }
 
+// The mixing loops are unrolled by 4 like pd's own perform routines, loading before
+// storing, so compilers can vectorise them even though they can't rule out aliasing
+static void matrix_add(t_float *out, t_float *in, int n){
+    for(; n >= 4; n -= 4, in += 4, out += 4){
+        t_float f0 = in[0], f1 = in[1], f2 = in[2], f3 = in[3];
+        t_float g0 = out[0], g1 = out[1], g2 = out[2], g3 = out[3];
+        out[0] = g0 + f0, out[1] = g1 + f1, out[2] = g2 + f2, out[3] = g3 + f3;
+    }
+    while(n--)
+        *out++ += *in++;
+}
+
+static void matrix_addgain(t_float *out, t_float *in, float coef, int n){
+    for(; n >= 4; n -= 4, in += 4, out += 4){
+        t_float f0 = in[0], f1 = in[1], f2 = in[2], f3 = in[3];
+        t_float g0 = out[0], g1 = out[1], g2 = out[2], g3 = out[3];
+        out[0] = g0 + f0 * coef, out[1] = g1 + f1 * coef;
+        out[2] = g2 + f2 * coef, out[3] = g3 + f3 * coef;
+    }
+    while(n--)
+        *out++ += *in++ * coef;
+}
+
+// coef moves by incr every sample, the caller keeps track of where the ramp is
+static void matrix_addramp(t_float *out, t_float *in, float coef, float incr, int n){
+    float c0 = coef, c1 = coef + incr, c2 = coef + 2*incr, c3 = coef + 3*incr;
+    float incr4 = 4*incr;
+    int nvec = n & ~3;
+    for(int i = 0; i < nvec; i += 4, in += 4, out += 4){
+        t_float f0 = in[0], f1 = in[1], f2 = in[2], f3 = in[3];
+        t_float g0 = out[0], g1 = out[1], g2 = out[2], g3 = out[3];
+        out[0] = g0 + f0 * c0, out[1] = g1 + f1 * c1;
+        out[2] = g2 + f2 * c2, out[3] = g3 + f3 * c3;
+        c0 += incr4, c1 += incr4, c2 += incr4, c3 += incr4;
+    }
+    coef += nvec * incr;
+    n -= nvec;
+    while(n--)
+        *out++ += *in++ * coef, coef += incr;
+}
+
 static t_int *matrix01_perform(t_int *w){
     t_matrix *x = (t_matrix *)(w[1]);
     int nblock = (int)(w[2]);
@@ -216,18 +257,15 @@ static t_int *matrix01_perform(t_int *w){
                 pd_error(x, "matrix~: doesn't understand 'float'");
                 magic_setnan(x->x_signalscalars[indx]);
             }
-            if(!(x->x_hasfeeders[indx]))
-                ivec = x->x_zerovec;
+            if(!(x->x_hasfeeders[indx])){ // adding silence changes nothing
+                cellp += x->x_numoutlets;
+                continue;
+            }
         }
         int ondx = x->x_numoutlets;
         while(ondx--){
-            if(*cellp++){
-                t_float *in = ivec;
-                t_float *out = *ovecp;
-                int sndx = nblock;
-                while(sndx--)
-                    *out++ += *in++;
-            }
+            if(*cellp++)
+                matrix_add(*ovecp, ivec, nblock);
             ovecp++;
         }
     }
@@ -269,6 +307,8 @@ static t_int *matrixnb_perform(t_int *w){
             if(!(x->x_hasfeeders[indx]))
                 ivec = x->x_zerovec;
         }
+        // without feeders only the ramps move on, adding silence changes nothing
+        int silent = (ivec == x->x_zerovec);
         int ondx = x->x_numoutlets;
         while(ondx--){
             t_float *in = ivec;
@@ -282,30 +322,27 @@ static t_int *matrixnb_perform(t_int *w){
                     *coefp = (*cellp ? *gainp : 0.);
                 else
                     *coefp += *bigincrp;
-                while(sndx--)
-                     *out++ += *in++ * coef, coef += incr;
+                if(!silent)
+                    matrix_addramp(out, in, coef, incr, sndx);
             }
             else if(nleft > 0){
                 float coef = *coefp;
                 float incr = *incrp;
-                sndx -= nleft;
-                do{
-                    *out++ += *in++ * coef, coef += incr;
-                }while(--nleft);
+                int nramp = nleft;
+                sndx -= nramp;
+                if(!silent)
+                    matrix_addramp(out, in, coef, incr, nramp);
                 if(*cellp){
                     coef = *coefp = *gainp;
-                    while(sndx--)
-                        *out++ += *in++ * coef;
+                    if(!silent)
+                        matrix_addgain(out + nramp, in + nramp, coef, sndx);
                 }
                 else
                     *coefp = 0.;
                 *nleftp = 0;
             }
-            else if(*cellp){
-                float coef = *coefp;
-                while(sndx--)
-                    *out++ += *in++ * coef;
-            }
+            else if(*cellp && *coefp != 0 && !silent) // cells that are on with a gain of 0 are skipped too
+                matrix_addgain(out, in, *coefp, sndx);
             cellp++;
             ovecp++;
             gainp++;
@@ -5,19 +5,36 @@
 #include <math.h>
 #include "m_pd.h"
 #include <common/api.h>
+#include "signal/fastmath.h"
 
 static t_class *pow_class;
 
 typedef struct _pow{
     t_object x_obj;
     t_inlet  *x_inlet;
+    int       x_fast;
 }t_pow;
 
 static t_int *pow_perform(t_int *w){
-    int nblock = (int)(w[1]);
-    t_float *in1 = (t_float *)(w[2]);
-    t_float *in2 = (t_float *)(w[3]);
-    t_float *out = (t_float *)(w[4]);
+    t_pow *x = (t_pow *)(w[1]);
+    int nblock = (int)(w[2]);
+    t_float *in1 = (t_float *)(w[3]);
+    t_float *in2 = (t_float *)(w[4]);
+    t_float *out = (t_float *)(w[5]);
+    if(x->x_fast){ // same special cases as below, worked out without branches
+        for(int i = 0; i < nblock; i++){
+            float e = in1[i], b = in2[i];
+            float ab = fastmath_abs(b);
+            float r = fastmath_exp2(e * fastmath_log2(ab > 0 ? ab : 1.f));
+            float zero = e == 0 ? 1.f : 0.f; // 0 to the power of e
+            float neg = -r;
+            int odd = ((int32_t)e) & 1;
+            r = ab > 0 ? r : zero;
+            r = (b < 0 && odd) ? neg : r;
+            out[i] = (b == 0 && e < 0) || (b < 0 && (e - (int32_t)e) != 0) ? 0 : r;
+        }
+        return (w + 6);
+    }
     while (nblock--){
         float f1 = *in1++;
         float f2 = *in2++;
@@ -25,11 +42,15 @@ static t_int *pow_perform(t_int *w){
             (f2 < 0 && (f1 - (int)f1) != 0) ?
             0 : pow(f2, f1);
     }
-    return (w + 5);
+    return (w + 6);
+}
+
+static void pow_fast(t_pow *x, t_floatarg f){
+    x->x_fast = (f != 0);
 }
 
 static void pow_dsp(t_pow *x, t_signal **sp){
-    dsp_add(pow_perform, 4, sp[0]->s_n,
+    dsp_add(pow_perform, 5, x, sp[0]->s_n,
             sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec);
 }
 
@@ -53,6 +74,7 @@ CYCLONE_OBJ_API void pow_tilde_setup(void){
     class_addcreator((t_newmethod)pow_new, gensym("cyclone/Pow~"), A_GIMME, 0);
     class_addmethod(pow_class, nullfn, gensym("signal"), 0);
     class_addmethod(pow_class, (t_method)pow_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(pow_class, (t_method)pow_fast, gensym("fast"), A_FLOAT, 0);
 }
 
 void Pow_tilde_setup(void){
@@ -24,6 +24,17 @@ handle managemente, added a receive symbol, visible inlets and implemented zoom;
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#if defined(_M_ARM64)
+#define scope_barrier() __dmb(_ARM64_BARRIER_ISH)
+#else
+#define scope_barrier() _mm_mfence()
+#endif
+#else
+#define scope_barrier() __sync_synchronize()
+#endif
+
 #define SCOPE_MINSIZE       18
 #define SCOPE_MINPERIOD     2
 #define SCOPE_MAXPERIOD     8192
@@ -77,6 +88,7 @@ typedef struct _scope{
     t_symbol       *x_bindsym;
     t_clock        *x_clock;
     t_pd           *x_handle;
+    unsigned int    x_snapshot_seq; // odd while x_xbuflast/x_ybuflast are being written
 }t_scope;
 
 typedef struct _handle{
@@ -770,9 +782,14 @@ static t_int *scope_perform(t_int *w){
                         *bp1 = currx;
                         *bp2 = curry;
                         bufphase = 0;
+                        // publish the snapshot, readers retry while the sequence is odd or has changed
+                        x->x_snapshot_seq++;
+                        scope_barrier();
                         x->x_lastbufsize = bufsize;
                         memcpy(x->x_xbuflast, x->x_xbuffer, bufsize * sizeof(*x->x_xbuffer));
                         memcpy(x->x_ybuflast, x->x_ybuffer, bufsize * sizeof(*x->x_ybuffer));
+                        scope_barrier();
+                        x->x_snapshot_seq++;
                         x->x_retrigger = (x->x_trigmode != 0);
                         x->x_trigx = x->x_triglevel;
                         clock_delay(x->x_clock, 0);
@@ -5,11 +5,13 @@
 #include <math.h>
 #include "m_pd.h"
 #include <common/api.h>
+#include "signal/fastmath.h"
 
 typedef struct _sinh {
     t_object x_obj;
     t_inlet *sinh;
     t_outlet *x_outlet;
+    int x_fast;
 } t_sinh;
 
 void *sinh_new(void);
@@ -20,20 +22,32 @@ static t_class *sinh_class;
 
 static t_int *sinh_perform(t_int *w)
 {
-    int nblock = (int)(w[1]);
-    t_float *in = (t_float *)(w[2]);
-    t_float *out = (t_float *)(w[3]);
+    t_sinh *x = (t_sinh *)(w[1]);
+    int nblock = (int)(w[2]);
+    t_float *in = (t_float *)(w[3]);
+    t_float *out = (t_float *)(w[4]);
+    if (x->x_fast)
+    {
+        for (int i = 0; i < nblock; i++)
+            out[i] = fastmath_sinh(in[i]);
+        return (w + 5);
+    }
     while (nblock--)
     {
         float f = *in++;
         *out++ = sinhf(f);  /* CHECKED no protection against NaNs */
     }
-    return (w + 4);
+    return (w + 5);
+}
+
+static void sinh_fast(t_sinh *x, t_floatarg f)
+{
+    x->x_fast = (f != 0);
 }
 
 static void sinh_dsp(t_sinh *x, t_signal **sp)
 {
-    dsp_add(sinh_perform, 3, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
+    dsp_add(sinh_perform, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
 }
 
 void *sinh_new(void)
@@ -49,4 +63,5 @@ CYCLONE_OBJ_API void sinh_tilde_setup(void)
                            sizeof(t_sinh), CLASS_DEFAULT, 0);
     class_addmethod(sinh_class, nullfn, gensym("signal"), 0);
     class_addmethod(sinh_class, (t_method) sinh_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(sinh_class, (t_method) sinh_fast, gensym("fast"), A_FLOAT, 0);
 }
@@ -0,0 +1,147 @@
+/* For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.  */
+
+/* Approximations of libm functions, for signal objects that have a "fast" mode.
+ * Everything is computed without branches, both sides of a choice are worked out
+ * and one gets selected, so loops over a block are vectorised by the compiler
+ * (SSE, AVX or NEON, depending on the target).
+ * Relative error is around 1e-6 (absolute for cos, log2 and atan2). Results at the
+ * edges of the float range are clamped instead of overflowing, and NaNs give undefined
+ * results, which the exact versions don't protect against either. */
+
+#ifndef __FASTMATH_H__
+#define __FASTMATH_H__
+
+#include <stdint.h>
+
+#define FASTMATH_PI      3.14159265358979f
+#define FASTMATH_HALFPI  1.57079632679490f
+#define FASTMATH_LOG2E   1.44269504088896f
+
+static inline float fastmath_asfloat(int32_t i)
+{
+    union { int32_t i; float f; } u;
+    u.i = i;
+    return (u.f);
+}
+
+static inline int32_t fastmath_asint(float f)
+{
+    union { int32_t i; float f; } u;
+    u.f = f;
+    return (u.i);
+}
+
+static inline float fastmath_abs(float f)
+{
+    return (fastmath_asfloat(fastmath_asint(f) & 0x7FFFFFFF));
+}
+
+static inline float fastmath_clamp(float f, float lo, float hi)
+{
+    f = f < lo ? lo : f;
+    return (f > hi ? hi : f);
+}
+
+static inline float fastmath_round(float f) /* for |f| < 2^31 */
+{
+    /* copy the sign of f onto 0.5 */
+    float half = fastmath_asfloat((fastmath_asint(f) & 0x80000000) | 0x3F000000);
+    return ((float)(int32_t)(f + half));
+}
+
+static inline float fastmath_exp2(float x)
+{
+    float xi, f, p;
+    x = fastmath_clamp(x, -126.f, 127.f);
+    xi = fastmath_round(x);
+    f = x - xi; /* -0.5 to 0.5 */
+    p = 1.f + f * (0.693147181f + f * (0.240226507f + f * (0.0555041087f
+        + f * (0.00961812911f + f * (0.00133335581f + f * 0.000154035304f)))));
+    return (p * fastmath_asfloat(((int32_t)xi + 127) << 23));
+}
+
+static inline float fastmath_exp(float x)
+{
+    return (fastmath_exp2(x * FASTMATH_LOG2E));
+}
+
+static inline float fastmath_log2(float x) /* for x > 0 */
+{
+    int32_t i = fastmath_asint(x);
+    float e = (float)(((i >> 23) & 0xFF) - 127);
+    float m = fastmath_asfloat((i & 0x007FFFFF) | 0x3F800000); /* 1 to 2 */
+    /* sqrt(0.5) to sqrt(2) is the range where the series converges fastest */
+    int big = m > 1.41421356f;
+    float mh = m * 0.5f, e1 = e + 1.f, t, t2;
+    m = big ? mh : m;
+    e = big ? e1 : e;
+    t = (m - 1.f) / (m + 1.f);
+    t2 = t * t;
+    return (e + t * (2.88539008f + t2 * (0.961796694f + t2 * (0.577078016f + t2 * 0.412198583f))));
+}
+
+static inline float fastmath_tanh(float x)
+{
+    float e = fastmath_exp2(fastmath_clamp(x, -9.f, 9.f) * (2.f * FASTMATH_LOG2E));
+    float x2 = x * x;
+    /* (e^2x - 1) / (e^2x + 1) loses precision close to 0, where the series is better */
+    float small = x * (1.f + x2 * (-0.333333333f + x2 * (0.133333333f + x2 * (-0.0539682540f + x2 * 0.0218694885f))));
+    float large = (e - 1.f) / (e + 1.f);
+    return (fastmath_abs(x) < 0.25f ? small : large);
+}
+
+static inline float fastmath_sinh(float x)
+{
+    float e = fastmath_exp(fastmath_clamp(x, -88.f, 88.f));
+    float x2 = x * x;
+    float small = x * (1.f + x2 * (0.166666667f + x2 * (0.00833333333f + x2 * 0.000198412698f)));
+    float large = 0.5f * (e - 1.f / e);
+    return (fastmath_abs(x) < 0.25f ? small : large);
+}
+
+static inline float fastmath_cosh(float x)
+{
+    float e = fastmath_exp(fastmath_clamp(x, -88.f, 88.f));
+    return (0.5f * (e + 1.f / e));
+}
+
+static inline float fastmath_cos(float x) /* for |x| < 2^31 */
+{
+    /* reduce to -pi..pi, 2pi is split in two parts for accuracy */
+    float k = fastmath_round(x * (0.5f / FASTMATH_PI));
+    float r = (x - k * 6.28125f) - k * 0.00193530717958647692f;
+    float a = fastmath_abs(r), a2, c;
+    int flip = a > FASTMATH_HALFPI;
+    float mirrored = FASTMATH_PI - a;
+    a = flip ? mirrored : a;
+    a2 = a * a;
+    c = 1.f + a2 * (-0.5f + a2 * (0.0416666667f + a2 * (-0.00138888889f + a2 * (2.48015873e-5f
+        + a2 * (-2.75573192e-7f + a2 * 2.08767570e-9f)))));
+    return (flip ? -c : c);
+}
+
+static inline float fastmath_atan2(float y, float x)
+{
+    float ax = fastmath_abs(x), ay = fastmath_abs(y);
+    float mx = ax > ay ? ax : ay;
+    float mn = ax > ay ? ay : ax;
+    /* 0 to 1, 0/0 gives 0 like atan2f(0, 0) */
+    float z = mn / (mx > 0.f ? mx : 1.f);
+    /* above tan(pi/8), atan(z) = pi/4 + atan((z - 1) / (z + 1)) keeps the polynomial's range small */
+    int shift = z > 0.414213562f;
+    float zs = (z - 1.f) / (z + 1.f);
+    float t = shift ? zs : z;
+    float t2 = t * t;
+    float a = t + t * t2 * (-0.333329491539f + t2 * (0.199777106478f + t2 * (-0.138776856032f + t2 * 0.0805374449538f)));
+    float as = a + 0.785398163f, ar, aq;
+    a = shift ? as : a;
+    ar = FASTMATH_HALFPI - a;
+    a = ay > ax ? ar : a;
+    /* the signs of zeros count, like for atan2f */
+    aq = FASTMATH_PI - a;
+    a = fastmath_asint(x) < 0 ? aq : a;
+    return (fastmath_asint(y) < 0 ? -a : a);
+}
+
+#endif /* __FASTMATH_H__ */
@@ -16,8 +16,10 @@
 #endif
 
 #include <stdarg.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #ifdef _MSC_VER  /* This is only for Microsoft's compiler, not cygwin, e.g. */
 #define snprintf _snprintf
@@ -33,6 +35,13 @@ t_pd pd_canvasmaker;    /* factory for creating canvases */
 
 static t_symbol *class_extern_dir;
 
+    /* pd's own abstraction creator, which reads the file again for every
+    instance.  It's static, so we find it once the first abstraction got
+    created, and replace it by one that reads through the patch cache. */
+typedef t_pd *(*t_abstractioncreator)(t_symbol *s, int argc, t_atom *argv);
+static t_abstractioncreator abstraction_creator;
+static t_pd *libpd_create_abstraction(t_symbol *s, int argc, t_atom *argv);
+
 #ifdef PDINSTANCE
 static t_class *class_list = 0;
 PERTHREAD t_pdinstance *pd_this = NULL;
@@ -46,6 +55,9 @@ t_pdinstance pd_maininstance;
 
 static t_symbol *dogensym(const char *s, t_symbol *oldsym,
     t_pdinstance *pdinstance);
+static t_symbol **symtable_new(int size);
+static int symtable_size(t_symbol **symhash);
+static void symtable_free(t_symbol **symhash);
 void x_midi_newpdinstance( void);
 void x_midi_freepdinstance( void);
 void s_inter_newpdinstance( void);
@@ -79,9 +91,7 @@ static t_pdinstance *pdinstance_init(t_pdinstance *x)
     x->pd_clock_setlist = 0;
     x->pd_canvaslist = 0;
     x->pd_templatelist = 0;
-    x->pd_symhash = getbytes(SYMTABHASHSIZE * sizeof(*x->pd_symhash));
-    for (i = 0; i < SYMTABHASHSIZE; i++)
-        x->pd_symhash[i] = 0;
+    x->pd_symhash = symtable_new(SYMTABHASHSIZE);
 #ifdef PDINSTANCE
     dogensym("pointer",   &x->pd_s_pointer,  x);
     dogensym("float",     &x->pd_s_float,    x);
@@ -227,7 +237,7 @@ EXTERN void pdinstance_free(t_pdinstance *x)
             pd_ninstances * sizeof(*c->c_methods),
             (pd_ninstances - 1) * sizeof(*c->c_methods));
     }
-    for (i =0; i < SYMTABHASHSIZE; i++)
+    for (i =0; i < symtable_size(x->pd_symhash); i++)
     {
         while ((s = x->pd_symhash[i]))
         {
@@ -250,7 +260,7 @@ EXTERN void pdinstance_free(t_pdinstance *x)
             }
         }
     }
-    freebytes(x->pd_symhash, SYMTABHASHSIZE * sizeof (*x->pd_symhash));
+    symtable_free(x->pd_symhash);
     x_midi_freepdinstance();
     g_canvas_freepdinstance();
     d_ugen_freepdinstance();
@@ -590,6 +600,9 @@ void class_addcreator(t_newmethod newmethod, t_symbol *s,
         *vp = va_arg(ap, t_atomtype);
     }
     va_end(ap);
+    if (abstraction_creator &&
+        newmethod == (t_newmethod)abstraction_creator)
+            newmethod = (t_newmethod)libpd_create_abstraction;
     class_addmethod(pd_objectmaker, (t_method)newmethod, s,
         vec[0], vec[1], vec[2], vec[3], vec[4], vec[5]);
 }
@@ -842,25 +855,106 @@ t_propertiesfn class_getpropertiesfn(const t_class *c)
 
 /* ---------------- the symbol table ------------------------ */
 
-static t_symbol *dogensym(const char *s, t_symbol *oldsym,
-    t_pdinstance *pdinstance)
+    /* pd's table has a fixed number of buckets, which gets slow once
+    libraries and big patches intern tens of thousands of symbols.  This
+    one doubles whenever it holds more symbols than buckets.  The instance
+    only has room for the bucket pointer, so the size and count live in a
+    header in front of the buckets.  Only this file looks at pd_symhash.
+    gensym also gets called without the pd lock, so looking up, adding
+    and moving symbols all happen under a lock of their own.  It's only
+    held for the lookup, so it hardly ever has to wait. */
+typedef struct _symtable
 {
-    char *symname = 0;
-    t_symbol **symhashloc, *sym2;
-    unsigned int hash = 5381;
-    int length = 0;
+    int st_size;    /* number of buckets, a power of 2 */
+    int st_count;   /* number of symbols in the table */
+    t_symbol *st_buckets[1];
+} t_symtable;
+
+static pthread_mutex_t symtable_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define SYMTABLE_BYTES(size) \
+    (sizeof(t_symtable) + ((size) - 1) * sizeof(t_symbol *))
+
+static t_symtable *symtable_get(t_symbol **symhash)
+{
+    return ((t_symtable *)((char *)symhash - offsetof(t_symtable, st_buckets)));
+}
+
+static t_symbol **symtable_new(int size)
+{
+    t_symtable *table = (t_symtable *)getbytes(SYMTABLE_BYTES(size));
+    table->st_size = size;
+    table->st_count = 0;
+    return (table->st_buckets);
+}
+
+static int symtable_size(t_symbol **symhash)
+{
+    return (symtable_get(symhash)->st_size);
+}
+
+static void symtable_free(t_symbol **symhash)
+{
+    t_symtable *table = symtable_get(symhash);
+    freebytes(table, SYMTABLE_BYTES(table->st_size));
+}
+
+    /* FNV-1a, folded so the high bits still count once the mask is small */
+static unsigned int symtable_hash(const char *s, int *length)
+{
+    unsigned int hash = 2166136261u;
     const char *s2 = s;
-    while (*s2) /* djb2 hash algo */
+    while (*s2)
     {
-        hash = ((hash << 5) + hash) + *s2;
-        length++;
-        s2++;
+        hash ^= (unsigned char)*s2++;
+        hash *= 16777619u;
     }
-    symhashloc = pdinstance->pd_symhash + (hash & (SYMTABHASHSIZE-1));
+    *length = (int)(s2 - s);
+    return (hash ^ (hash >> 16));
+}
+
+static void symtable_grow(t_pdinstance *pdinstance)
+{
+    t_symtable *old = symtable_get(pdinstance->pd_symhash);
+    t_symbol **symhash = symtable_new(old->st_size * 2);
+    t_symtable *table = symtable_get(symhash);
+    int i, length;
+    for (i = 0; i < old->st_size; i++)
+    {
+        t_symbol *sym = old->st_buckets[i], *next;
+        for (; sym; sym = next)
+        {
+            t_symbol **loc = symhash +
+                (symtable_hash(sym->s_name, &length) & (table->st_size - 1));
+            next = sym->s_next;
+            sym->s_next = *loc;
+            *loc = sym;
+        }
+    }
+    table->st_count = old->st_count;
+    pdinstance->pd_symhash = symhash;
+    symtable_free(old->st_buckets);
+}
+
+static t_symbol *dogensym(const char *s, t_symbol *oldsym,
+    t_pdinstance *pdinstance)
+{
+    char *symname = 0;
+    t_symbol **symhash, **symhashloc, *sym2;
+    t_symtable *table;
+    int length;
+    unsigned int hash = symtable_hash(s, &length);
+    pthread_mutex_lock(&symtable_mutex);
+    symhash = pdinstance->pd_symhash;
+    table = symtable_get(symhash);
+    symhashloc = symhash + (hash & (table->st_size - 1));
     while ((sym2 = *symhashloc))
     {
         if (!strcmp(sym2->s_name, s))
+        {
+            pthread_mutex_unlock(&symtable_mutex);
             return(sym2);
+        }
         symhashloc = &sym2->s_next;
     }
     if (oldsym)
@@ -872,6 +966,9 @@ static t_symbol *dogensym(const char *s, t_symbol *oldsym,
     strcpy(symname, s);
     sym2->s_name = symname;
     *symhashloc = sym2;
+    if (++table->st_count > table->st_size)
+        symtable_grow(pdinstance);
+    pthread_mutex_unlock(&symtable_mutex);
     return (sym2);
 }
 
@@ -880,6 +977,21 @@ t_symbol *gensym(const char *s)
     return(dogensym(s, 0, pd_this));
 }
 
+    /* for finding what a closed patch left bound, see x_libpd_mod_utils.c.
+    fn can't call gensym, the table is locked while it runs */
+void libpd_symtable_foreach(void (*fn)(t_symbol *s, void *data), void *data)
+{
+    t_symbol **symhash, *s;
+    int i, size;
+    pthread_mutex_lock(&symtable_mutex);
+    symhash = pd_this->pd_symhash;
+    size = symtable_size(symhash);
+    for (i = 0; i < size; i++)
+        for (s = symhash[i]; s; s = s->s_next)
+            fn(s, data);
+    pthread_mutex_unlock(&symtable_mutex);
+}
+
 static t_symbol *addfileextent(t_symbol *s)
 {
     char namebuf[MAXPDSTRING];
@@ -898,6 +1010,144 @@ void canvas_popabstraction(t_canvas *x);
 
 t_symbol* pathsearch(t_symbol *s,char* ext);
 int pd_setloadingabstraction(t_symbol *sym);
+t_binbuf *libpd_patchcache_get(const char *name, const char *dir);
+int libpd_pathcache_find(t_symbol *name, t_symbol *canvasdir, t_symbol **dir,
+    t_symbol **file);
+void libpd_pathcache_add(t_symbol *name, t_symbol *canvasdir, t_symbol *dir,
+    t_symbol *file);
+
+    /* same layout as in g_canvas.c, only to see if there are declared paths */
+typedef struct _fake_canvasenvironment
+{
+    t_symbol *ce_dir;
+    int ce_argc;
+    t_atom *ce_argv;
+    int ce_dollarzero;
+    t_namelist *ce_path;
+} t_fake_canvasenvironment;
+
+    /* the folder that decides where a name is found from this canvas, or 0
+    if declared paths take part, which are not part of the key.  canvas_open
+    searches the declared paths of every owner up to the toplevel, not only
+    the nearest environment's. */
+static t_symbol *libpd_pathcache_dir(t_canvas *x)
+{
+    t_canvas *y;
+    if (!x)
+        return (0);
+    for (y = x; y; y = y->gl_owner)
+        if (y->gl_env && ((t_fake_canvasenvironment *)y->gl_env)->ce_path)
+            return (0);
+    return (canvas_getdir(x));
+}
+
+static t_pd *libpd_create_abstraction(t_symbol *s, int argc, t_atom *argv)
+{
+    char dirbuf[MAXPDSTRING], classslashclass[MAXPDSTRING], *nameptr;
+    t_canvas *canvas;
+    t_binbuf *b;
+    t_pd *was;
+    t_symbol *canvasdir, *founddir, *foundfile;
+    int fd, dspstate;
+
+    if (pd_setloadingabstraction(s))
+    {
+        pd_error(0, "%s: can't load abstraction within itself\n", s->s_name);
+        pd_this->pd_newest = 0;
+        return (0);
+    }
+
+    canvas = glist_getcanvas((t_glist *)canvas_getcurrent());
+    snprintf(classslashclass, MAXPDSTRING, "%s/%s", s->s_name, s->s_name);
+
+        /* other instances from the same folder already found the file */
+    canvasdir = libpd_pathcache_dir(canvas);
+    if (canvasdir &&
+        libpd_pathcache_find(s, canvasdir, &founddir, &foundfile) == 1)
+    {
+        strncpy(dirbuf, founddir->s_name, MAXPDSTRING);
+        dirbuf[MAXPDSTRING-1] = 0;
+        nameptr = (char *)foundfile->s_name;
+    }
+    else
+    {
+        if ((fd = canvas_open(canvas, s->s_name, ".pd", dirbuf, &nameptr,
+            MAXPDSTRING, 0)) < 0)
+        {
+                /* Max patches need to be converted, pd's creator does that */
+            if ((fd = canvas_open(canvas, s->s_name, ".pat", dirbuf, &nameptr,
+                MAXPDSTRING, 0)) >= 0)
+            {
+                sys_close(fd);
+                return (abstraction_creator(s, argc, argv));
+            }
+            if ((fd = canvas_open(canvas, classslashclass, ".pd", dirbuf,
+                &nameptr, MAXPDSTRING, 0)) < 0)
+                    return (abstraction_creator(s, argc, argv));
+        }
+        sys_close(fd);
+        if (canvasdir)
+            libpd_pathcache_add(s, canvasdir, gensym(dirbuf), gensym(nameptr));
+    }
+
+    if (!(b = libpd_patchcache_get(nameptr, dirbuf)))
+        return (abstraction_creator(s, argc, argv));
+
+    was = s__X.s_thing;
+    canvas_setargs(argc, argv);
+    dspstate = canvas_suspend_dsp();
+    glob_setfilename(0, gensym(nameptr), gensym(dirbuf));
+    binbuf_eval(b, 0, 0, 0);
+    glob_setfilename(0, &s_, &s_);
+    canvas_resume_dsp(dspstate);
+    if (s__X.s_thing && was != s__X.s_thing)
+        canvas_popabstraction((t_canvas *)(s__X.s_thing));
+    else s__X.s_thing = was;
+    canvas_setargs(0, 0);
+    return (pd_this->pd_newest);
+}
+
+static void replace_abstraction_creator(t_methodentry *methods, int nmethod,
+    t_symbol *s)
+{
+    int i;
+    if (!abstraction_creator)
+        for (i = 0; i < nmethod; i++)
+            if (methods[i].me_name == s)
+                abstraction_creator = (t_abstractioncreator)methods[i].me_fun;
+    for (i = 0; i < nmethod; i++)
+        if (abstraction_creator &&
+            methods[i].me_fun == (t_gotfn)abstraction_creator)
+                methods[i].me_fun = (t_gotfn)libpd_create_abstraction;
+}
+
+    /* called after "s" got loaded: if that made an abstraction, the creator
+    that was just added for it is pd's abstraction creator */
+static void check_abstraction_creator(t_symbol *s)
+{
+    t_canvas *x = (t_canvas *)pd_this->pd_newest;
+    const char *slash = strrchr(s->s_name, '/');
+    const char *basename = slash ? slash + 1 : s->s_name;
+    size_t len = strlen(basename);
+#ifdef PDINSTANCE
+    int i;
+#endif
+
+    if (abstraction_creator || !x || pd_class(&x->gl_pd) != canvas_class ||
+        !canvas_isabstraction(x) || strncmp(x->gl_name->s_name, basename, len) ||
+            strcmp(x->gl_name->s_name + len, ".pd"))
+                return;
+#ifdef PDINSTANCE
+    replace_abstraction_creator(pd_objectmaker->c_methods[pd_this->pd_instanceno],
+        pd_objectmaker->c_nmethod, s);
+    for (i = 0; i < pd_ninstances; i++)
+        replace_abstraction_creator(pd_objectmaker->c_methods[i],
+            pd_objectmaker->c_nmethod, 0);
+#else
+    replace_abstraction_creator(pd_objectmaker->c_methods,
+        pd_objectmaker->c_nmethod, s);
+#endif
+}
 
     /* this routine is called when a new "object" is requested whose class Pd
     doesn't know.  Pd tries to load it as an extern, then as an abstraction. */
@@ -905,6 +1155,7 @@ void new_anything(void *dummy, t_symbol *s, int argc, t_atom *argv)
 {
     int fd;
     char dirbuf[MAXPDSTRING], classslashclass[MAXPDSTRING], *nameptr;
+    t_symbol *canvasdir, *founddir, *foundfile;
     if (tryingalready>MAXOBJDEPTH){
       pd_error(0, "maximum object loading depth %d reached", MAXOBJDEPTH);
       return;
@@ -914,6 +1165,12 @@ void new_anything(void *dummy, t_symbol *s, int argc, t_atom *argv)
       return;
     }
     pd_this->pd_newest = 0;
+        /* a name that wasn't found from this folder before isn't searched
+        for again, until the search paths or the files in them change */
+    canvasdir = libpd_pathcache_dir(canvas_getcurrent());
+    if (canvasdir &&
+        !libpd_pathcache_find(s, canvasdir, &founddir, &foundfile))
+            return;
     class_loadsym = s;
     pd_globallock();
     if (sys_load_lib(canvas_getcurrent(), s->s_name))
@@ -921,10 +1178,13 @@ void new_anything(void *dummy, t_symbol *s, int argc, t_atom *argv)
         tryingalready++;
         typedmess(dummy, s, argc, argv);
         tryingalready--;
+        check_abstraction_creator(s);
         return;
     }
     class_loadsym = 0;
     pd_globalunlock();
+    if (canvasdir)
+        libpd_pathcache_add(s, canvasdir, 0, 0);
 }
 
 /* This is externally available, but note that it might later disappear; the
@@ -934,6 +1194,47 @@ t_pd *pd_newest(void)
     return (pd_this->pd_newest);
 }
 
+    /* Remembers which entry of a method list answers to a selector, so
+    sending the same messages over and over doesn't scan the whole list
+    every time.  Each thread has its own cache, so pd instances running
+    on different threads don't step on each other.  Entries are checked
+    against the list before they're used, instead of being cleared when
+    methods get added: a list that got reallocated has another address,
+    and aliasing an old method renames its entry.  Selectors are unique
+    within a list, so an entry whose name still matches is the method
+    the scan would have found. */
+#define METHODCACHESIZE 512
+
+typedef struct _methodcache
+{
+    t_methodentry *mc_list;
+    t_symbol *mc_sel;
+    int mc_index;
+} t_methodcache;
+
+static PERTHREAD t_methodcache methodcache[METHODCACHESIZE];
+
+static t_methodentry *methodcache_find(t_methodentry *mlist, int nmethod,
+    t_symbol *s)
+{
+    t_methodcache *mc = methodcache + ((((size_t)mlist >> 4) ^
+        ((size_t)s >> 4)) & (METHODCACHESIZE-1));
+    t_methodentry *m;
+    int i;
+    if (mc->mc_list == mlist && mc->mc_sel == s &&
+        mc->mc_index < nmethod && mlist[mc->mc_index].me_name == s)
+            return (mlist + mc->mc_index);
+    for (i = 0, m = mlist; i < nmethod; i++, m++)
+        if (m->me_name == s)
+    {
+        mc->mc_list = mlist;
+        mc->mc_sel = s;
+        mc->mc_index = i;
+        return (m);
+    }
+    return (0);
+}
+
     /* horribly, we need prototypes for each of the artificial function
     calls in typedmess(), to keep the compiler quiet. */
 typedef t_pd *(*t_newgimme)(t_symbol *s, int argc, t_atom *argv);
@@ -960,7 +1261,6 @@ void pd_typedmess(t_pd *x, t_symbol *s, int argc, t_atom *argv)
     t_class *c = *x;
     t_methodentry *m, *mlist;
     unsigned char *wp, wanttype;
-    int i;
     t_int ai[MAXPDARG+1], *ap = ai;
     t_floatarg ad[MAXPDARG+1], *dp = ad;
     int narg = 0;
@@ -1010,8 +1310,7 @@ void pd_typedmess(t_pd *x, t_symbol *s, int argc, t_atom *argv)
 #else
     mlist = c->c_methods;
 #endif
-    for (i = c->c_nmethod, m = mlist; i--; m++)
-        if (m->me_name == s)
+    if ((m = methodcache_find(mlist, c->c_nmethod, s)))
     {
         wp = m->me_arg;
         if (*wp == A_GIMME)
@@ -1174,15 +1473,14 @@ t_gotfn getfn(const t_pd *x, t_symbol *s)
 {
     const t_class *c = *x;
     t_methodentry *m, *mlist;
-    int i;
 
 #ifdef PDINSTANCE
     mlist = c->c_methods[pd_this->pd_instanceno];
 #else
     mlist = c->c_methods;
 #endif
-    for (i = c->c_nmethod, m = mlist; i--; m++)
-        if (m->me_name == s) return(m->me_fun);
+    if ((m = methodcache_find(mlist, c->c_nmethod, s)))
+        return(m->me_fun);
     pd_error(x, "%s: no method for message '%s'", c->c_name->s_name, s->s_name);
     return((t_gotfn)nullfn);
 }
@@ -1191,15 +1489,14 @@ t_gotfn zgetfn(const t_pd *x, t_symbol *s)
 {
     const t_class *c = *x;
     t_methodentry *m, *mlist;
-    int i;
 
 #ifdef PDINSTANCE
     mlist = c->c_methods[pd_this->pd_instanceno];
 #else
     mlist = c->c_methods;
 #endif
-    for (i = c->c_nmethod, m = mlist; i--; m++)
-        if (m->me_name == s) return(m->me_fun);
+    if ((m = methodcache_find(mlist, c->c_nmethod, s)))
+        return(m->me_fun);
     return(0);
 }
 
@@ -143,6 +143,8 @@ struct _instanceinter {
     pd_panel_callback panel_callback;
     pd_synchronise_callback synchronise_callback;
     pd_message_callback message_callback;
+    pd_change_callback change_callback;
+    pd_array_callback array_callback;
     void* callback_target;
 };
 
@@ -161,6 +163,47 @@ void register_gui_triggers(t_pdinstance* instance, void* target, pd_gui_callback
     instance->pd_inter->callback_target = target;
 }
 
+void register_change_trigger(t_pdinstance* instance, pd_change_callback change_callback)
+{
+
+#if !PDINSTANCE
+    instance = &pd_maininstance;
+#endif
+
+    instance->pd_inter->change_callback = change_callback;
+}
+
+void register_array_trigger(t_pdinstance* instance, pd_array_callback array_callback)
+{
+
+#if !PDINSTANCE
+    instance = &pd_maininstance;
+#endif
+
+    instance->pd_inter->array_callback = array_callback;
+}
+
+void array_changed(void* garray, int start, int end)
+{
+    if (pd_this->pd_inter->array_callback) {
+        pd_this->pd_inter->array_callback(pd_this->pd_inter->callback_target, garray, start, end);
+    }
+}
+
+void patch_changed(void* cnv, int type, void* obj)
+{
+    if (pd_this->pd_inter->change_callback) {
+        pd_this->pd_inter->change_callback(pd_this->pd_inter->callback_target, cnv, type, obj, 0, 0, 0, 0);
+    }
+}
+
+void connection_changed(void* cnv, int type, void* src, int nout, void* sink, int nin)
+{
+    if (pd_this->pd_inter->change_callback) {
+        pd_this->pd_inter->change_callback(pd_this->pd_inter->callback_target, cnv, type, 0, src, nout, sink, nin);
+    }
+}
+
 void update_gui_parameters()
 {
     if (pd_this->pd_inter->parameter_callback) {
@@ -7,3 +7,25 @@ typedef void (*pd_panel_callback)(void*, int, char const*, char const*);
 typedef void (*pd_synchronise_callback)(void*, void*);
 typedef void (*pd_message_callback)(void*, void*, t_symbol*, int, t_atom*);
 void register_gui_triggers(t_pdinstance* instance, void* target, pd_gui_callback gui_callback, pd_panel_callback panel_callback, pd_synchronise_callback synchronise_callback, pd_parameter_callback parameter_callback, pd_message_callback message_callback);
+
+/* structural changes made through the libpd mod utils, so the GUI can apply them without rescanning the canvas */
+enum pd_change_type {
+    pd_object_added,
+    pd_object_removed,
+    pd_object_moved,
+    pd_connection_added,
+    pd_connection_removed,
+    pd_canvas_changed /* anything the other types can't describe, the whole canvas needs to be rescanned */
+};
+
+typedef void (*pd_change_callback)(void* target, void* cnv, int type, void* obj, void* src, int nout, void* sink, int nin);
+void register_change_trigger(t_pdinstance* instance, pd_change_callback change_callback);
+
+void patch_changed(void* cnv, int type, void* obj);
+void connection_changed(void* cnv, int type, void* src, int nout, void* sink, int nin);
+
+/* the range [start, end) of a garray that was written, so the GUI only has to copy that part */
+typedef void (*pd_array_callback)(void* target, void* garray, int start, int end);
+void register_array_trigger(t_pdinstance* instance, pd_array_callback array_callback);
+
+void array_changed(void* garray, int start, int end);
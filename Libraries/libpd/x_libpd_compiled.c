@@ -0,0 +1,247 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <m_pd.h>
+#include <m_imp.h>
+#include <g_canvas.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include "x_libpd_compiled.h"
+
+typedef void (*t_libpd_compiled_dsp)(t_canvas* x, t_signal** sp);
+typedef void (*t_libpd_compiled_freemethod)(t_canvas* x);
+
+typedef struct _libpd_compiled {
+    t_canvas* c_canvas;
+    void* c_context;
+    double c_samplerate;
+    int c_nin;
+    int c_nout;
+    int c_blocksize;
+    t_sample** c_signals;
+    float* c_buffer;
+
+    t_libpd_compiled_new c_new;
+    t_libpd_compiled_process c_process;
+    t_libpd_compiled_free c_free;
+
+    struct _libpd_compiled* c_next;
+} t_libpd_compiled;
+
+// The compiled subpatches of an instance are kept by an object bound to a symbol, symbols belong to one instance
+typedef struct _libpd_compiled_list {
+    t_pd l_pd;
+    t_libpd_compiled* l_first;
+} t_libpd_compiled_list;
+
+static t_class* libpd_compiled_list_class;
+static t_libpd_compiled_dsp libpd_compiled_canvas_dsp;
+static t_libpd_compiled_freemethod libpd_compiled_canvas_free;
+
+static t_libpd_compiled_list* libpd_compiled_getlist(int create)
+{
+    t_symbol* s = gensym("#libpd_compiled");
+    if (!s->s_thing && create) {
+        t_libpd_compiled_list* list = (t_libpd_compiled_list*)pd_new(libpd_compiled_list_class);
+        list->l_first = NULL;
+        pd_bind(&list->l_pd, s);
+    }
+    return (t_libpd_compiled_list*)s->s_thing;
+}
+
+static t_libpd_compiled* libpd_compiled_find(t_canvas* cnv)
+{
+    t_libpd_compiled_list* list = libpd_compiled_getlist(0);
+    t_libpd_compiled* x;
+    if (!list)
+        return NULL;
+    for (x = list->l_first; x; x = x->c_next) {
+        if (x->c_canvas == cnv)
+            return x;
+    }
+    return NULL;
+}
+
+static void libpd_compiled_freebuffers(t_libpd_compiled* x)
+{
+    if (x->c_signals)
+        freebytes(x->c_signals, (x->c_nin + x->c_nout) * sizeof(t_sample*));
+    if (x->c_buffer)
+        freebytes(x->c_buffer, (x->c_nin + x->c_nout) * x->c_blocksize * sizeof(float));
+    x->c_signals = NULL;
+    x->c_buffer = NULL;
+    x->c_blocksize = 0;
+}
+
+static void libpd_compiled_delete(t_libpd_compiled* x)
+{
+    if (x->c_context)
+        x->c_free(x->c_context);
+    libpd_compiled_freebuffers(x);
+    freebytes(x, sizeof(t_libpd_compiled));
+}
+
+// Unlinks the compiled code of a subpatch from the list, returns it so the caller can free it
+static t_libpd_compiled* libpd_compiled_unlink(t_canvas* cnv)
+{
+    t_libpd_compiled_list* list = libpd_compiled_getlist(0);
+    t_libpd_compiled** x;
+    if (!list)
+        return NULL;
+    for (x = &list->l_first; *x; x = &(*x)->c_next) {
+        if ((*x)->c_canvas == cnv) {
+            t_libpd_compiled* found = *x;
+            *x = found->c_next;
+            return found;
+        }
+    }
+    return NULL;
+}
+
+static t_int* libpd_compiled_perform(t_int* w)
+{
+    t_libpd_compiled* x = (t_libpd_compiled*)(w[1]);
+    int n = (int)(w[2]);
+    float* inputs = x->c_buffer;
+    float* outputs = x->c_buffer + x->c_nin * n;
+    int i, j;
+
+    // Signals can share memory in pd, so the inputs are copied before anything gets written
+    for (i = 0; i < x->c_nin; i++) {
+        for (j = 0; j < n; j++)
+            inputs[i * n + j] = x->c_signals[i][j];
+    }
+
+    x->c_process(x->c_context, x->c_nin ? inputs : NULL, outputs, n);
+
+    for (i = 0; i < x->c_nout; i++) {
+        for (j = 0; j < n; j++)
+            x->c_signals[x->c_nin + i][j] = outputs[i * n + j];
+    }
+
+    return (w + 3);
+}
+
+static void libpd_compiled_dsp(t_canvas* cnv, t_signal** sp)
+{
+    t_libpd_compiled* x = libpd_compiled_find(cnv);
+    int nin = obj_nsiginlets(&cnv->gl_obj);
+    int nout = obj_nsigoutlets(&cnv->gl_obj);
+    int i, n;
+    double samplerate;
+
+    // Fall back to the objects when the iolets changed after compiling
+    if (!x || !x->c_new || nin != x->c_nin || nout != x->c_nout || nin + nout == 0) {
+        libpd_compiled_canvas_dsp(cnv, sp);
+        return;
+    }
+
+    n = sp[0]->s_n;
+    samplerate = sp[0]->s_sr;
+
+    if (!x->c_context || samplerate != x->c_samplerate) {
+        if (x->c_context)
+            x->c_free(x->c_context);
+        x->c_context = x->c_new(samplerate);
+        x->c_samplerate = samplerate;
+    }
+
+    if (!x->c_context) {
+        libpd_compiled_canvas_dsp(cnv, sp);
+        return;
+    }
+
+    if (n != x->c_blocksize) {
+        libpd_compiled_freebuffers(x);
+        x->c_signals = (t_sample**)getbytes((nin + nout) * sizeof(t_sample*));
+        x->c_buffer = (float*)getbytes((nin + nout) * n * sizeof(float));
+        x->c_blocksize = n;
+    }
+
+    for (i = 0; i < nin + nout; i++)
+        x->c_signals[i] = sp[i]->s_vec;
+
+    dsp_add(libpd_compiled_perform, 2, x, (t_int)n);
+}
+
+static void libpd_compiled_free(t_canvas* cnv)
+{
+    t_libpd_compiled* x = libpd_compiled_unlink(cnv);
+    if (x)
+        libpd_compiled_delete(x);
+    libpd_compiled_canvas_free(cnv);
+}
+
+void libpd_compiled_setup(void)
+{
+    t_pd canvas = canvas_class;
+
+    libpd_compiled_list_class = class_new(gensym("libpd_compiled_list"), (t_newmethod)NULL, (t_method)NULL,
+        sizeof(t_libpd_compiled_list), CLASS_PD, A_NULL, 0);
+
+    // Canvases keep their own dsp method, ours only takes over for subpatches that have compiled code
+    libpd_compiled_canvas_dsp = (t_libpd_compiled_dsp)zgetfn(&canvas, gensym("dsp"));
+    class_addmethod(canvas_class, (t_method)libpd_compiled_dsp, gensym("dsp"), A_CANT, 0);
+
+    libpd_compiled_canvas_free = (t_libpd_compiled_freemethod)canvas_class->c_freemethod;
+    canvas_class->c_freemethod = (t_method)libpd_compiled_free;
+}
+
+void libpd_compiled_reserve(t_canvas* cnv)
+{
+    t_libpd_compiled_list* list = libpd_compiled_getlist(1);
+    t_libpd_compiled* x;
+
+    if (libpd_compiled_find(cnv))
+        return;
+
+    x = (t_libpd_compiled*)getbytes(sizeof(t_libpd_compiled));
+    memset(x, 0, sizeof(t_libpd_compiled));
+    x->c_canvas = cnv;
+    x->c_next = list->l_first;
+    list->l_first = x;
+}
+
+int libpd_compiled_attach(t_canvas* cnv, int nin, int nout, t_libpd_compiled_new fn_new, t_libpd_compiled_process fn_process, t_libpd_compiled_free fn_free)
+{
+    t_libpd_compiled* x = libpd_compiled_find(cnv);
+
+    // The subpatch was deleted while compiling
+    if (!x)
+        return 0;
+
+    // Code from an earlier compilation is replaced, its context gets freed while it still can be
+    if (x->c_context)
+        x->c_free(x->c_context);
+
+    x->c_context = NULL;
+    x->c_nin = nin;
+    x->c_nout = nout;
+    x->c_new = fn_new;
+    x->c_process = fn_process;
+    x->c_free = fn_free;
+
+    canvas_update_dsp();
+    return 1;
+}
+
+void libpd_compiled_detach(t_canvas* cnv)
+{
+    t_libpd_compiled* x = libpd_compiled_unlink(cnv);
+    if (!x)
+        return;
+
+    // Rebuild the chain before freeing, so no perform routine points to it anymore
+    canvas_update_dsp();
+    libpd_compiled_delete(x);
+}
+
+int libpd_compiled_isattached(t_canvas* cnv)
+{
+    t_libpd_compiled* x = libpd_compiled_find(cnv);
+    return x && x->c_new;
+}
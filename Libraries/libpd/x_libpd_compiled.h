@@ -0,0 +1,40 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <m_pd.h>
+#include <g_canvas.h>
+
+// Function signatures of a compiled subpatch, these match the Heavy C API
+typedef void* (*t_libpd_compiled_new)(double samplerate);
+typedef int (*t_libpd_compiled_process)(void* context, float* inputs, float* outputs, int nframes);
+typedef void (*t_libpd_compiled_free)(void* context);
+
+// Hooks into the dsp and free methods of canvases, called once by libpd_multi_init
+void libpd_compiled_setup(void);
+
+// Marks a subpatch that is about to get compiled code, so it is known when the subpatch gets deleted in the meantime
+void libpd_compiled_reserve(t_canvas* cnv);
+
+// Replaces the signal processing of a reserved subpatch with compiled code, its objects are left out of the dsp chain
+// nin and nout are the number of signal inlets and outlets the compiled code expects
+// The caller needs to hold pd's lock, the swap happens when the dsp chain is rebuilt, in between two ticks
+// Returns 0 when the subpatch doesn't exist anymore
+int libpd_compiled_attach(t_canvas* cnv, int nin, int nout, t_libpd_compiled_new fn_new, t_libpd_compiled_process fn_process, t_libpd_compiled_free fn_free);
+
+// Goes back to the subpatch's own objects, the compiled code is not used anymore after this returns
+void libpd_compiled_detach(t_canvas* cnv);
+
+int libpd_compiled_isattached(t_canvas* cnv);
+
+#ifdef __cplusplus
+}
+#endif
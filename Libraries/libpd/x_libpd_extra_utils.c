@@ -6,6 +6,11 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 #include <m_pd.h>
 #include <m_imp.h>
@@ -14,6 +19,7 @@
 #include <m_imp.h>
 #include <g_all_guis.h>
 #include "x_libpd_multi.h"
+#include "s_libpd_inter.h"
 
 // False GARRAY
 typedef struct _fake_garray {
@@ -50,9 +56,267 @@ typedef struct _gatom {
     t_symbol* a_expanded_to;          /* a_symto after $0, $1, ...  expansion */
 } t_fake_gatom;
 
-void* libpd_create_canvas(char const* name, char const* path)
+// A parsed patch file, with the modification time and size it had when it was read
+typedef struct _libpd_patchcache_entry {
+    t_symbol* e_path;
+    long long e_mtime;
+    long long e_size;
+    t_binbuf* e_binbuf;
+    struct _libpd_patchcache_entry* e_next;
+} t_libpd_patchcache_entry;
+
+// Bound to a symbol, so every instance has its own cache
+typedef struct _libpd_patchcache {
+    t_pd c_pd;
+    t_libpd_patchcache_entry* c_first;
+} t_libpd_patchcache;
+
+static t_class* libpd_patchcache_class;
+
+void libpd_patchcache_setup(void)
+{
+    libpd_patchcache_class = class_new(gensym("libpd_patchcache"), (t_newmethod)NULL, (t_method)NULL,
+        sizeof(t_libpd_patchcache), CLASS_PD, A_NULL, 0);
+}
+
+static int libpd_patchcache_stat(char const* path, long long* mtime, long long* size)
+{
+#ifdef _WIN32
+    wchar_t wpath[MAXPDSTRING];
+    struct _stat64 st;
+    if (!MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, MAXPDSTRING) || _wstat64(wpath, &st))
+        return 0;
+#else
+    struct stat st;
+    if (stat(path, &st))
+        return 0;
+#endif
+    *mtime = (long long)st.st_mtime;
+    *size = (long long)st.st_size;
+    return 1;
+}
+
+// Looks up the file in the cache, on a miss it's tokenised from text when that's given, or read from disk otherwise
+static t_binbuf* libpd_patchcache_fetch(char const* name, char const* dir, char const* text, int textsize)
+{
+    t_libpd_patchcache* cache = (t_libpd_patchcache*)gensym("#libpd_patchcache")->s_thing;
+    t_libpd_patchcache_entry* e;
+    char path[MAXPDSTRING];
+    t_symbol* pathsym;
+    long long mtime, size;
+
+    snprintf(path, MAXPDSTRING, "%s/%s", dir, name);
+    if (!libpd_patchcache_stat(path, &mtime, &size))
+        return 0;
+
+    if (!cache) {
+        cache = (t_libpd_patchcache*)pd_new(libpd_patchcache_class);
+        cache->c_first = 0;
+        pd_bind(&cache->c_pd, gensym("#libpd_patchcache"));
+    }
+
+    pathsym = gensym(path);
+    for (e = cache->c_first; e; e = e->e_next) {
+        if (e->e_path == pathsym)
+            break;
+    }
+
+    if (e && e->e_mtime == mtime && e->e_size == size)
+        return e->e_binbuf;
+
+    if (!e) {
+        e = (t_libpd_patchcache_entry*)getbytes(sizeof(t_libpd_patchcache_entry));
+        e->e_path = pathsym;
+        e->e_binbuf = binbuf_new();
+        e->e_next = cache->c_first;
+        cache->c_first = e;
+    } else {
+        binbuf_clear(e->e_binbuf);
+    }
+
+    e->e_mtime = mtime;
+    e->e_size = size;
+
+    if (text) {
+        binbuf_text(e->e_binbuf, text, textsize);
+    } else if (binbuf_read(e->e_binbuf, (char*)name, (char*)dir, 0)) {
+        // Forget about it, so the next attempt reads it again
+        e->e_mtime = -1;
+        return 0;
+    }
+
+    return e->e_binbuf;
+}
+
+t_binbuf* libpd_patchcache_get(char const* name, char const* dir)
+{
+    return libpd_patchcache_fetch(name, dir, 0, 0);
+}
+
+void libpd_patchcache_invalidate(char const* path)
+{
+    t_libpd_patchcache* cache = (t_libpd_patchcache*)gensym("#libpd_patchcache")->s_thing;
+    t_libpd_patchcache_entry** e;
+    t_symbol* pathsym = path ? gensym(path) : 0;
+
+    if (!cache)
+        return;
+
+    for (e = &cache->c_first; *e;) {
+        if (!pathsym || (*e)->e_path == pathsym) {
+            t_libpd_patchcache_entry* next = (*e)->e_next;
+            binbuf_free((*e)->e_binbuf);
+            freebytes(*e, sizeof(t_libpd_patchcache_entry));
+            *e = next;
+        } else {
+            e = &(*e)->e_next;
+        }
+    }
+
+    if (!path) {
+        pd_unbind(&cache->c_pd, gensym("#libpd_patchcache"));
+        pd_free(&cache->c_pd);
+    }
+}
+
+// Where an object name was found, looked up from a patch folder, or that it wasn't found at all
+typedef struct _libpd_pathcache_entry {
+    t_symbol* e_name;
+    t_symbol* e_canvasdir;
+    t_symbol* e_dir; // NULL if neither an external nor an abstraction exists
+    t_symbol* e_file;
+    struct _libpd_pathcache_entry* e_next;
+} t_libpd_pathcache_entry;
+
+#define LIBPD_PATHCACHE_SIZE 256
+
+// Bound to a symbol, so every instance has its own cache
+typedef struct _libpd_pathcache {
+    t_pd c_pd;
+    t_libpd_pathcache_entry* c_buckets[LIBPD_PATHCACHE_SIZE];
+} t_libpd_pathcache;
+
+static t_class* libpd_pathcache_class;
+
+void libpd_pathcache_setup(void)
 {
-    t_canvas* cnv = (t_canvas*)libpd_openfile(name, path);
+    libpd_pathcache_class = class_new(gensym("libpd_pathcache"), (t_newmethod)NULL, (t_method)NULL,
+        sizeof(t_libpd_pathcache), CLASS_PD, A_NULL, 0);
+}
+
+// Symbols are unique, so their addresses make a good hash
+static t_libpd_pathcache_entry** libpd_pathcache_bucket(t_libpd_pathcache* cache, t_symbol* name, t_symbol* canvasdir)
+{
+    size_t hash = ((size_t)name >> 4) * 31 + ((size_t)canvasdir >> 4);
+    return &cache->c_buckets[hash % LIBPD_PATHCACHE_SIZE];
+}
+
+int libpd_pathcache_find(t_symbol* name, t_symbol* canvasdir, t_symbol** dir, t_symbol** file)
+{
+    t_libpd_pathcache* cache = (t_libpd_pathcache*)gensym("#libpd_pathcache")->s_thing;
+    t_libpd_pathcache_entry* e;
+
+    if (!cache)
+        return -1;
+
+    for (e = *libpd_pathcache_bucket(cache, name, canvasdir); e; e = e->e_next) {
+        if (e->e_name == name && e->e_canvasdir == canvasdir) {
+            if (!e->e_dir)
+                return 0;
+            *dir = e->e_dir;
+            *file = e->e_file;
+            return 1;
+        }
+    }
+    return -1;
+}
+
+void libpd_pathcache_add(t_symbol* name, t_symbol* canvasdir, t_symbol* dir, t_symbol* file)
+{
+    t_libpd_pathcache* cache = (t_libpd_pathcache*)gensym("#libpd_pathcache")->s_thing;
+    t_libpd_pathcache_entry** bucket;
+    t_libpd_pathcache_entry* e;
+    int i;
+
+    if (!cache) {
+        cache = (t_libpd_pathcache*)pd_new(libpd_pathcache_class);
+        for (i = 0; i < LIBPD_PATHCACHE_SIZE; i++)
+            cache->c_buckets[i] = 0;
+        pd_bind(&cache->c_pd, gensym("#libpd_pathcache"));
+    }
+
+    bucket = libpd_pathcache_bucket(cache, name, canvasdir);
+    for (e = *bucket; e; e = e->e_next) {
+        if (e->e_name == name && e->e_canvasdir == canvasdir)
+            break;
+    }
+
+    if (!e) {
+        e = (t_libpd_pathcache_entry*)getbytes(sizeof(t_libpd_pathcache_entry));
+        e->e_name = name;
+        e->e_canvasdir = canvasdir;
+        e->e_next = *bucket;
+        *bucket = e;
+    }
+
+    e->e_dir = dir;
+    e->e_file = file;
+}
+
+void libpd_pathcache_invalidate(void)
+{
+    t_libpd_pathcache* cache = (t_libpd_pathcache*)gensym("#libpd_pathcache")->s_thing;
+    int i;
+
+    if (!cache)
+        return;
+
+    for (i = 0; i < LIBPD_PATHCACHE_SIZE; i++) {
+        t_libpd_pathcache_entry* e = cache->c_buckets[i];
+        while (e) {
+            t_libpd_pathcache_entry* next = e->e_next;
+            freebytes(e, sizeof(t_libpd_pathcache_entry));
+            e = next;
+        }
+    }
+
+    pd_unbind(&cache->c_pd, gensym("#libpd_pathcache"));
+    pd_free(&cache->c_pd);
+}
+
+// Same as glob_evalfile, but the patch has already been read
+static t_canvas* libpd_create_canvas_from_binbuf(t_binbuf* b, char const* name, char const* path)
+{
+    t_pd* x = 0;
+    t_pd* boundx;
+    t_canvas* cnv = NULL;
+
+    sys_lock();
+    pd_globallock();
+
+    boundx = s__X.s_thing;
+    s__X.s_thing = 0;
+
+    glob_setfilename(0, gensym(name), gensym(path));
+    binbuf_eval(b, 0, 0, 0);
+    glob_setfilename(0, &s_, &s_);
+
+    // The last canvas that gets popped is the root canvas of the patch
+    while ((x != s__X.s_thing) && s__X.s_thing) {
+        x = s__X.s_thing;
+        vmess(x, gensym("pop"), "i", 1);
+    }
+    if (x && pd_class(x) == canvas_class)
+        cnv = (t_canvas*)x;
+
+    if (!sys_noloadbang)
+        pd_doloadbang();
+
+    s__X.s_thing = boundx;
+
+    pd_globalunlock();
+    sys_unlock();
+
     if (cnv) {
         canvas_vis(cnv, 1.f);
         canvas_rename(cnv, gensym(name), gensym(path));
@@ -60,6 +324,50 @@ void* libpd_create_canvas(char const* name, char const* path)
     return cnv;
 }
 
+static t_canvas* libpd_create_canvas_cached(char const* name, char const* path, char const* text, int size)
+{
+    t_binbuf* b;
+    t_canvas* cnv;
+
+    sys_lock();
+    b = libpd_patchcache_fetch(name, path, text, size);
+    sys_unlock();
+
+    // Let pd report why it couldn't be read
+    if (!b) {
+        cnv = (t_canvas*)libpd_openfile(name, path);
+        if (cnv) {
+            canvas_vis(cnv, 1.f);
+            canvas_rename(cnv, gensym(name), gensym(path));
+        }
+        return cnv;
+    }
+
+    return libpd_create_canvas_from_binbuf(b, name, path);
+}
+
+void* libpd_create_canvas(char const* name, char const* path)
+{
+    return libpd_create_canvas_cached(name, path, 0, 0);
+}
+
+void* libpd_create_canvas_from_mapping(char const* text, int size, char const* name, char const* path)
+{
+    return libpd_create_canvas_cached(name, path, text, size);
+}
+
+void* libpd_create_canvas_from_text(char const* text, int size, char const* name, char const* path)
+{
+    t_binbuf* b = binbuf_new();
+    t_canvas* cnv;
+
+    binbuf_text(b, text, size);
+    cnv = libpd_create_canvas_from_binbuf(b, name, path);
+    binbuf_free(b);
+
+    return cnv;
+}
+
 char const* libpd_get_object_class_name(void* ptr)
 {
     return class_getname(pd_class((t_pd*)ptr));
@@ -89,6 +397,28 @@ void libpd_get_object_bounds(void* patch, void* ptr, int* x, int* y, int* w, int
     *h -= *y;
 }
 
+int libpd_get_gui_value(void* ptr, t_float* value)
+{
+    t_symbol* name = pd_class((t_pd*)ptr)->c_name;
+
+    if (name == gensym("tgl")) {
+        *value = ((t_toggle*)ptr)->x_on;
+    } else if (name == gensym("hsl") || name == gensym("vsl")) {
+        *value = ((t_slider*)ptr)->x_fval;
+    } else if (name == gensym("nbx")) {
+        *value = ((t_my_numbox*)ptr)->x_val;
+    } else if (name == gensym("hradio") || name == gensym("vradio")) {
+        *value = ((t_radio*)ptr)->x_on;
+    } else if (name == gensym("gatom") && ((t_fake_gatom*)ptr)->a_flavor == A_FLOAT) {
+        t_binbuf* b = ((t_fake_gatom*)ptr)->a_text.te_binbuf;
+        *value = binbuf_getnatom(b) == 1 ? atom_getfloat(binbuf_getvec(b)) : 0;
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
 t_garray* libpd_array_get_byname(char const* name)
 {
     return (t_fake_garray*)pd_findbyclass(gensym((char*)name), garray_class);
@@ -241,8 +571,10 @@ int libpd_array_resize(void* garray, long size)
 }
 
 #define MEMCPY(_x, _y)                                              \
-    if (n < 0 || offset < 0 || offset + n > garray_npoints(garray)) \
+    if (n < 0 || offset < 0 || offset + n > garray_npoints(garray)) { \
+        sys_unlock();                                               \
         return -2;                                                  \
+    }                                                               \
     t_word* vec = ((t_word*)garray_vec(garray)) + offset;           \
     int i;                                                          \
     for (i = 0; i < n; i++)                                         \
@@ -260,6 +592,7 @@ int libpd_array_write(void* garray, int offset, float const* src, int n)
 {
     sys_lock();
     MEMCPY((vec++)->w_float, *src++)
+    array_changed(garray, offset, offset + n);
     sys_unlock();
     return 0;
 }
@@ -315,6 +648,134 @@ int libpd_process_nodsp(void)
     PROCESS_NODSP()
 }
 
+void sched_tick(void); // m_sched.c
+
+// The last output sample of every channel, and the dsp chain that produced it
+// Bound to a symbol, so every instance has its own
+typedef struct _libpd_declick {
+    t_pd d_pd;
+    t_int* d_chain;
+    int d_chainsize;
+    int d_nchannels;
+    t_sample* d_last;
+} t_libpd_declick;
+
+static t_class* libpd_declick_class;
+
+void libpd_declick_setup(void)
+{
+    libpd_declick_class = class_new(gensym("libpd_declick"), (t_newmethod)NULL, (t_method)NULL,
+        sizeof(t_libpd_declick), CLASS_PD, A_NULL, 0);
+}
+
+void libpd_declick_free(void)
+{
+    t_libpd_declick* x = (t_libpd_declick*)gensym("#libpd_declick")->s_thing;
+    if (!x)
+        return;
+
+    pd_unbind(&x->d_pd, gensym("#libpd_declick"));
+    if (x->d_last)
+        freebytes(x->d_last, x->d_nchannels * sizeof(t_sample));
+    pd_free(&x->d_pd);
+}
+
+// Called after every tick. When the dsp chain was rebuilt during the tick, or in between two ticks,
+// the new chain starts from a different value than the old one ended at
+// The difference is added to the output and faded out over the tick, so the swap doesn't click
+static void libpd_declick_tick(void)
+{
+    t_libpd_declick* x = (t_libpd_declick*)gensym("#libpd_declick")->s_thing;
+    int ch, i, nchannels = STUFF->st_outchannels;
+
+    if (!x) {
+        x = (t_libpd_declick*)pd_new(libpd_declick_class);
+        x->d_chain = pd_this->pd_dspchain;
+        x->d_chainsize = pd_this->pd_dspchainsize;
+        x->d_nchannels = 0;
+        x->d_last = NULL;
+        pd_bind(&x->d_pd, gensym("#libpd_declick"));
+    }
+
+    // Only happens when the audio settings change
+    if (x->d_nchannels != nchannels) {
+        x->d_last = (t_sample*)resizebytes(x->d_last, x->d_nchannels * sizeof(t_sample), nchannels * sizeof(t_sample));
+        for (ch = x->d_nchannels; ch < nchannels; ch++)
+            x->d_last[ch] = 0;
+        x->d_nchannels = nchannels;
+    }
+
+    if (pd_this->pd_dspchain != x->d_chain || pd_this->pd_dspchainsize != x->d_chainsize) {
+        for (ch = 0; ch < nchannels; ch++) {
+            t_sample* out = STUFF->st_soundout + ch * DEFDACBLKSIZE;
+            t_sample offset = x->d_last[ch] - out[0];
+            for (i = 0; i < DEFDACBLKSIZE; i++)
+                out[i] += offset * (t_sample)(DEFDACBLKSIZE - i) / (t_sample)DEFDACBLKSIZE;
+        }
+        x->d_chain = pd_this->pd_dspchain;
+        x->d_chainsize = pd_this->pd_dspchainsize;
+    }
+
+    for (ch = 0; ch < nchannels; ch++)
+        x->d_last[ch] = STUFF->st_soundout[ch * DEFDACBLKSIZE + DEFDACBLKSIZE - 1];
+}
+
+int libpd_process_channels(t_sample** inputs, t_sample** outputs, int nins, int nouts, int offset)
+{
+    int ch;
+    size_t const n_bytes = DEFDACBLKSIZE * sizeof(t_sample);
+    sys_lock();
+    sys_pollgui();
+
+    // All inputs are read before any output is written, so the host may pass the same buffers for both
+    for (ch = 0; ch < STUFF->st_inchannels; ch++) {
+        if (ch < nins)
+            memcpy(STUFF->st_soundin + ch * DEFDACBLKSIZE, inputs[ch] + offset, n_bytes);
+        else
+            memset(STUFF->st_soundin + ch * DEFDACBLKSIZE, 0, n_bytes);
+    }
+
+    // soundout still holds the result of the previous tick, which keeps the latency the same as libpd_process_raw
+    for (ch = 0; ch < STUFF->st_outchannels && ch < nouts; ch++) {
+        memcpy(outputs[ch] + offset, STUFF->st_soundout + ch * DEFDACBLKSIZE, n_bytes);
+    }
+
+    memset(STUFF->st_soundout, 0, STUFF->st_outchannels * n_bytes);
+    sched_tick();
+    libpd_declick_tick();
+    sys_unlock();
+    return 0;
+}
+
+int libpd_process_ticks(t_sample const* inputs, t_sample* outputs, int ticks)
+{
+    int tick, ch;
+    size_t const stride = (size_t)ticks * DEFDACBLKSIZE;
+    size_t const n_bytes = DEFDACBLKSIZE * sizeof(t_sample);
+    sys_lock();
+    for (tick = 0; tick < ticks; tick++) {
+        sys_pollgui();
+        for (ch = 0; ch < STUFF->st_inchannels; ch++) {
+            memcpy(STUFF->st_soundin + ch * DEFDACBLKSIZE, inputs + ch * stride + tick * DEFDACBLKSIZE, n_bytes);
+        }
+        memset(STUFF->st_soundout, 0, STUFF->st_outchannels * n_bytes);
+        sched_tick();
+        libpd_declick_tick();
+        for (ch = 0; ch < STUFF->st_outchannels; ch++) {
+            memcpy(outputs + ch * stride + tick * DEFDACBLKSIZE, STUFF->st_soundout + ch * DEFDACBLKSIZE, n_bytes);
+        }
+    }
+    sys_unlock();
+    return 0;
+}
+
+void libpd_get_last_output(t_sample* outputs)
+{
+    sys_lock();
+    memcpy(outputs, STUFF->st_soundout, STUFF->st_outchannels * DEFDACBLKSIZE * sizeof(t_sample));
+    sys_unlock();
+}
+
 int libpd_is_text_object(void* obj)
 {
     return ((t_gobj*)obj)->g_pd->c_wb == &text_widgetbehavior;
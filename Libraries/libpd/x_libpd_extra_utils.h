@@ -13,12 +13,47 @@ extern "C" {
 #include <m_pd.h>
 #include "z_libpd.h"
 
+// Opens a patch file, the parsed file is kept in the instance's patch cache
 void* libpd_create_canvas(char const* name, char const* path);
 
+// Same as libpd_create_canvas, but on a cache miss the file is tokenised from text, a mapping of the file at path/name
+void* libpd_create_canvas_from_mapping(char const* text, int size, char const* name, char const* path);
+
+// Opens a patch from its text, name and path are used for the canvas name and to find abstractions
+void* libpd_create_canvas_from_text(char const* text, int size, char const* name, char const* path);
+
+// Parsed patch files, shared by libpd_create_canvas and all abstraction instances
+// Entries are keyed on the path, and are read again when the file's modification time or size changed
+void libpd_patchcache_setup(void);
+
+// Returns NULL if the file can't be read, the binbuf belongs to the cache. The caller needs to hold pd's lock
+t_binbuf* libpd_patchcache_get(char const* name, char const* dir);
+
+// Forgets the cached file at path, or every file if path is NULL
+void libpd_patchcache_invalidate(char const* path);
+
+// Where object names were found when they were created from a patch folder, and which ones weren't found at all
+// Saves probing every search path for every extension again, for each instance of an abstraction or for a typo
+// Patches that declare their own paths don't use it, since the folder doesn't tell where they look
+void libpd_pathcache_setup(void);
+
+// Returns 1 with the folder and file name if it was found before, 0 if it wasn't found, and -1 if it wasn't looked up yet
+int libpd_pathcache_find(t_symbol* name, t_symbol* canvasdir, t_symbol** dir, t_symbol** file);
+
+// Stores where a name was found, or that it wasn't if dir is NULL. The caller needs to hold pd's lock
+void libpd_pathcache_add(t_symbol* name, t_symbol* canvasdir, t_symbol* dir, t_symbol* file);
+
+// Forgets everything, needs to be called when the search paths or the files in them change
+void libpd_pathcache_invalidate(void);
+
 char const* libpd_get_object_class_name(void* ptr);
 void libpd_get_object_text(void* ptr, char** text, int* size);
 void libpd_get_object_bounds(void* patch, void* ptr, int* x, int* y, int* w, int* h);
 
+// Reads the value of toggles, sliders, number boxes, radios and float atoms, returns 0 for other objects
+// The caller needs to hold pd's lock
+int libpd_get_gui_value(void* ptr, t_float* value);
+
 t_garray* libpd_array_get_byname(char const* name);
 char const* libpd_array_get_name(void* array);
 char const* libpd_array_get_unexpanded_name(void* array);
@@ -62,6 +97,22 @@ float libpd_get_canvas_font_height(t_canvas* cnv);
 
 int libpd_process_nodsp(void);
 
+// perform one DSP tick reading one block from each input channel at offset,
+// and writing the output of the previous tick to each output channel at offset
+// inputs and outputs may point to the same buffers
+int libpd_process_channels(t_sample** inputs, t_sample** outputs, int nins, int nouts, int offset);
+
+// perform several DSP ticks on non-interleaved buffers that hold ticks * 64 samples per channel
+// with ticks == 1, this is the same as libpd_process_raw
+int libpd_process_ticks(t_sample const* inputs, t_sample* outputs, int ticks);
+
+// copy the output of the last DSP tick into a non-interleaved buffer
+void libpd_get_last_output(t_sample* outputs);
+
+// both process functions smooth the jump in the output when the dsp chain gets rebuilt
+void libpd_declick_setup(void);
+void libpd_declick_free(void);
+
 unsigned int convert_from_iem_color(int const color);
 unsigned int convert_to_iem_color(char const* hex);
 
@@ -0,0 +1,503 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <m_pd.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
+
+#include "x_libpd_global.h"
+
+// Every pd instance runs on its own thread, and symbols belong to one instance
+// So the buses are kept outside of pd, by name, and messages cross over as text
+// Ring buffers have a single writer and any number of readers that each keep their own position,
+// the audio threads never wait for each other. Only creating and freeing objects takes the registry lock
+
+#ifdef _MSC_VER
+#define GLOBAL_LOAD(p) ((uint64_t)InterlockedCompareExchange64((LONG64 volatile*)(p), 0, 0))
+#define GLOBAL_STORE(p, v) InterlockedExchange64((LONG64 volatile*)(p), (LONG64)(v))
+#define GLOBAL_FENCE() MemoryBarrier()
+#else
+#define GLOBAL_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define GLOBAL_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define GLOBAL_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+// Bytes of messages a sending instance can be ahead of the slowest receiver, older messages get dropped
+#define GLOBAL_RING_SIZE 16384
+#define GLOBAL_MAX_RECORD 4096
+#define GLOBAL_MAX_ATOMS 256
+
+// Number of instances that can send to one control bus
+#define GLOBAL_MAX_RINGS 64
+
+// Samples of a signal bus, power of two
+#define GLOBAL_SIGNAL_SIZE 8192
+
+typedef enum {
+    GLOBAL_CONTROL,
+    GLOBAL_SIGNAL
+} t_global_kind;
+
+// The messages sent from one instance to a control bus
+typedef struct _global_ring {
+    t_pdinstance* r_owner;
+    uint64_t volatile r_reserved; // up to where the writer may be overwriting
+    uint64_t volatile r_written;
+    unsigned char r_data[GLOBAL_RING_SIZE];
+} t_global_ring;
+
+typedef struct _global_bus {
+    char* b_name;
+    t_global_kind b_kind;
+    int b_refs;
+    struct _global_bus* b_next;
+
+    // Control buses, rings are only added, and freed with the bus
+    t_global_ring* volatile b_rings[GLOBAL_MAX_RINGS];
+    uint64_t volatile b_nrings;
+
+    // Signal buses
+    void* b_writer;
+    uint64_t volatile b_written;
+    t_sample* b_samples;
+} t_global_bus;
+
+static pthread_mutex_t global_mutex = PTHREAD_MUTEX_INITIALIZER;
+static t_global_bus* global_buses;
+
+static t_global_bus* global_bus_get(char const* name, t_global_kind kind)
+{
+    t_global_bus* bus;
+
+    pthread_mutex_lock(&global_mutex);
+    for (bus = global_buses; bus; bus = bus->b_next) {
+        if (bus->b_kind == kind && !strcmp(bus->b_name, name))
+            break;
+    }
+
+    if (!bus) {
+        bus = (t_global_bus*)calloc(1, sizeof(t_global_bus));
+        bus->b_name = strdup(name);
+        bus->b_kind = kind;
+        if (kind == GLOBAL_SIGNAL)
+            bus->b_samples = (t_sample*)calloc(GLOBAL_SIGNAL_SIZE, sizeof(t_sample));
+        bus->b_next = global_buses;
+        global_buses = bus;
+    }
+
+    bus->b_refs++;
+    pthread_mutex_unlock(&global_mutex);
+    return bus;
+}
+
+static void global_bus_release(t_global_bus* bus)
+{
+    t_global_bus** prev;
+    int i;
+
+    pthread_mutex_lock(&global_mutex);
+    if (--bus->b_refs > 0) {
+        pthread_mutex_unlock(&global_mutex);
+        return;
+    }
+
+    for (prev = &global_buses; *prev; prev = &(*prev)->b_next) {
+        if (*prev == bus) {
+            *prev = bus->b_next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&global_mutex);
+
+    for (i = 0; i < GLOBAL_MAX_RINGS; i++)
+        free(bus->b_rings[i]);
+    free(bus->b_samples);
+    free(bus->b_name);
+    free(bus);
+}
+
+// The ring this instance writes to, the pd instance stands in for the thread
+static t_global_ring* global_bus_getring(t_global_bus* bus)
+{
+    t_global_ring* ring = NULL;
+    int i, n;
+
+    pthread_mutex_lock(&global_mutex);
+    n = (int)bus->b_nrings;
+    for (i = 0; i < n; i++) {
+        if (bus->b_rings[i]->r_owner == pd_this) {
+            ring = bus->b_rings[i];
+            break;
+        }
+    }
+
+    if (!ring && n < GLOBAL_MAX_RINGS) {
+        ring = (t_global_ring*)calloc(1, sizeof(t_global_ring));
+        ring->r_owner = pd_this;
+        bus->b_rings[n] = ring;
+        GLOBAL_STORE(&bus->b_nrings, (uint64_t)(n + 1));
+    }
+    pthread_mutex_unlock(&global_mutex);
+    return ring;
+}
+
+static void global_ring_write(t_global_ring* ring, uint64_t pos, void const* data, int size)
+{
+    int i;
+    unsigned char const* bytes = (unsigned char const*)data;
+    for (i = 0; i < size; i++)
+        ring->r_data[(pos + i) & (GLOBAL_RING_SIZE - 1)] = bytes[i];
+}
+
+static void global_ring_read(t_global_ring* ring, uint64_t pos, void* data, int size)
+{
+    int i;
+    unsigned char* bytes = (unsigned char*)data;
+    for (i = 0; i < size; i++)
+        bytes[i] = ring->r_data[(pos + i) & (GLOBAL_RING_SIZE - 1)];
+}
+
+// Records are the total size, the number of atoms and the selector, followed by 'f' and a float or 's' and a string for each atom
+static int global_encode(unsigned char* buf, t_symbol* s, int argc, t_atom* argv)
+{
+    uint32_t size, count = 0;
+    int len = (int)strlen(s->s_name) + 1, i;
+    unsigned char* p = buf + 8;
+
+    if (8 + len > GLOBAL_MAX_RECORD)
+        return 0;
+    memcpy(p, s->s_name, len);
+    p += len;
+
+    for (i = 0; i < argc && count < GLOBAL_MAX_ATOMS; i++) {
+        if (argv[i].a_type == A_FLOAT) {
+            if (p + 1 + sizeof(t_float) > buf + GLOBAL_MAX_RECORD)
+                return 0;
+            *p++ = 'f';
+            memcpy(p, &argv[i].a_w.w_float, sizeof(t_float));
+            p += sizeof(t_float);
+            count++;
+        } else if (argv[i].a_type == A_SYMBOL) {
+            len = (int)strlen(argv[i].a_w.w_symbol->s_name) + 1;
+            if (p + 1 + len > buf + GLOBAL_MAX_RECORD)
+                return 0;
+            *p++ = 's';
+            memcpy(p, argv[i].a_w.w_symbol->s_name, len);
+            p += len;
+            count++;
+        }
+    }
+
+    // Keeps the next record aligned
+    while ((p - buf) & 3) {
+        if (p >= buf + GLOBAL_MAX_RECORD)
+            return 0;
+        *p++ = 0;
+    }
+
+    size = (uint32_t)(p - buf);
+    memcpy(buf, &size, 4);
+    memcpy(buf + 4, &count, 4);
+    return (int)size;
+}
+
+static void global_decode(unsigned char const* buf, int size, t_outlet* out)
+{
+    t_atom argv[GLOBAL_MAX_ATOMS];
+    uint32_t count, i;
+    unsigned char const* p = buf + 8;
+    unsigned char const* end = buf + size;
+    unsigned char const* sel;
+
+    memcpy(&count, buf + 4, 4);
+    sel = p;
+    p += strlen((char const*)sel) + 1;
+
+    for (i = 0; i < count && i < GLOBAL_MAX_ATOMS && p < end; i++) {
+        if (*p == 'f') {
+            t_float f;
+            memcpy(&f, p + 1, sizeof(t_float));
+            SETFLOAT(argv + i, f);
+            p += 1 + sizeof(t_float);
+        } else {
+            SETSYMBOL(argv + i, gensym((char const*)p + 1));
+            p += strlen((char const*)p + 1) + 2;
+        }
+    }
+
+    outlet_anything(out, gensym((char const*)sel), (int)i, argv);
+}
+
+static t_class* global_send_class;
+
+typedef struct _global_send {
+    t_object x_obj;
+    t_global_bus* x_bus;
+    t_global_ring* x_ring;
+} t_global_send;
+
+static void global_send_anything(t_global_send* x, t_symbol* s, int argc, t_atom* argv)
+{
+    unsigned char buf[GLOBAL_MAX_RECORD];
+    t_global_ring* ring = x->x_ring;
+    uint64_t pos;
+    int size;
+
+    if (!ring)
+        return;
+
+    if (!(size = global_encode(buf, s, argc, argv))) {
+        pd_error(x, "global.send %s: message too long", x->x_bus->b_name);
+        return;
+    }
+
+    // Readers check the reservation after copying a record, to tell if it was overwritten in the meantime
+    pos = ring->r_written;
+    GLOBAL_STORE(&ring->r_reserved, pos + size);
+    GLOBAL_FENCE();
+    global_ring_write(ring, pos, buf, size);
+    GLOBAL_STORE(&ring->r_written, pos + size);
+}
+
+static void* global_send_new(t_symbol* s)
+{
+    t_global_send* x = (t_global_send*)pd_new(global_send_class);
+    x->x_bus = global_bus_get(s->s_name, GLOBAL_CONTROL);
+    if (!(x->x_ring = global_bus_getring(x->x_bus)))
+        pd_error(x, "global.send %s: too many instances send to this name", s->s_name);
+    return x;
+}
+
+static void global_send_free(t_global_send* x)
+{
+    global_bus_release(x->x_bus);
+}
+
+static t_class* global_receive_class;
+
+typedef struct _global_receive {
+    t_object x_obj;
+    t_global_bus* x_bus;
+    t_clock* x_clock;
+    uint64_t x_pos[GLOBAL_MAX_RINGS];
+    int x_nseen;
+} t_global_receive;
+
+static void global_receive_poll(t_global_receive* x, t_global_ring* ring, uint64_t* pos)
+{
+    unsigned char buf[GLOBAL_MAX_RECORD];
+    uint64_t written = GLOBAL_LOAD(&ring->r_written);
+    uint32_t size;
+
+    while (*pos < written) {
+        // Too far behind, the oldest messages were already overwritten
+        if (written - *pos > GLOBAL_RING_SIZE - GLOBAL_MAX_RECORD) {
+            *pos = written;
+            return;
+        }
+
+        global_ring_read(ring, *pos, &size, 4);
+        if (size < 8 || size > GLOBAL_MAX_RECORD || (size & 3)) {
+            *pos = written;
+            return;
+        }
+        global_ring_read(ring, *pos, buf, (int)size);
+
+        GLOBAL_FENCE();
+        if (GLOBAL_LOAD(&ring->r_reserved) - *pos > GLOBAL_RING_SIZE) {
+            *pos = written;
+            return;
+        }
+
+        *pos += size;
+        global_decode(buf, (int)size, x->x_obj.ob_outlet);
+    }
+}
+
+static void global_receive_tick(t_global_receive* x)
+{
+    int i, n = (int)GLOBAL_LOAD(&x->x_bus->b_nrings);
+
+    // Instances that started sending after we were created, everything they sent is new
+    for (; x->x_nseen < n; x->x_nseen++)
+        x->x_pos[x->x_nseen] = 0;
+
+    // Runs once per tick, so messages arrive one block after they were sent
+    clock_delay(x->x_clock, 64);
+
+    for (i = 0; i < n; i++) {
+        t_global_ring* ring = x->x_bus->b_rings[i];
+        if (ring)
+            global_receive_poll(x, ring, x->x_pos + i);
+    }
+}
+
+static void* global_receive_new(t_symbol* s)
+{
+    int i;
+    t_global_receive* x = (t_global_receive*)pd_new(global_receive_class);
+    x->x_bus = global_bus_get(s->s_name, GLOBAL_CONTROL);
+    x->x_nseen = (int)GLOBAL_LOAD(&x->x_bus->b_nrings);
+
+    // Messages that were sent before we existed are skipped
+    for (i = 0; i < x->x_nseen; i++)
+        x->x_pos[i] = GLOBAL_LOAD(&x->x_bus->b_rings[i]->r_written);
+
+    outlet_new(&x->x_obj, 0);
+    x->x_clock = clock_new(x, (t_method)global_receive_tick);
+    clock_setunit(x->x_clock, 1, 1);
+    clock_delay(x->x_clock, 64);
+    return x;
+}
+
+static void global_receive_free(t_global_receive* x)
+{
+    clock_free(x->x_clock);
+    global_bus_release(x->x_bus);
+}
+
+static t_class* global_sigsend_class;
+
+typedef struct _global_sigsend {
+    t_object x_obj;
+    t_float x_f;
+    t_global_bus* x_bus;
+} t_global_sigsend;
+
+static t_int* global_sigsend_perform(t_int* w)
+{
+    t_global_bus* bus = (t_global_bus*)(w[1]);
+    t_sample* in = (t_sample*)(w[2]);
+    int n = (int)(w[3]), i;
+    uint64_t pos = bus->b_written;
+
+    for (i = 0; i < n; i++)
+        bus->b_samples[(pos + i) & (GLOBAL_SIGNAL_SIZE - 1)] = in[i];
+
+    GLOBAL_STORE(&bus->b_written, pos + n);
+    return (w + 4);
+}
+
+static void global_sigsend_dsp(t_global_sigsend* x, t_signal** sp)
+{
+    if (x->x_bus->b_writer == x)
+        dsp_add(global_sigsend_perform, 3, x->x_bus, sp[0]->s_vec, (t_int)sp[0]->s_n);
+}
+
+static void* global_sigsend_new(t_symbol* s)
+{
+    t_global_sigsend* x = (t_global_sigsend*)pd_new(global_sigsend_class);
+    x->x_f = 0;
+    x->x_bus = global_bus_get(s->s_name, GLOBAL_SIGNAL);
+
+    pthread_mutex_lock(&global_mutex);
+    if (!x->x_bus->b_writer)
+        x->x_bus->b_writer = x;
+    pthread_mutex_unlock(&global_mutex);
+
+    if (x->x_bus->b_writer != x)
+        pd_error(x, "global.send~ %s: there already is a sender with this name", s->s_name);
+    return x;
+}
+
+static void global_sigsend_free(t_global_sigsend* x)
+{
+    pthread_mutex_lock(&global_mutex);
+    if (x->x_bus->b_writer == x)
+        x->x_bus->b_writer = NULL;
+    pthread_mutex_unlock(&global_mutex);
+
+    global_bus_release(x->x_bus);
+}
+
+static t_class* global_sigreceive_class;
+
+typedef struct _global_sigreceive {
+    t_object x_obj;
+    t_global_bus* x_bus;
+    uint64_t x_pos;
+    int x_started;
+} t_global_sigreceive;
+
+static t_int* global_sigreceive_perform(t_int* w)
+{
+    t_global_sigreceive* x = (t_global_sigreceive*)(w[1]);
+    t_sample* out = (t_sample*)(w[2]);
+    int n = (int)(w[3]), i;
+    t_global_bus* bus = x->x_bus;
+    uint64_t written = GLOBAL_LOAD(&bus->b_written);
+
+    // Starts two blocks behind, so it doesn't matter which instance ticks first
+    // After falling too far behind, we skip ahead to the same distance
+    if (!x->x_started || written - x->x_pos > GLOBAL_SIGNAL_SIZE - 2 * (uint64_t)n) {
+        x->x_pos = written > 2 * (uint64_t)n ? written - 2 * n : 0;
+        x->x_started = 1;
+    }
+
+    // The sender stopped, or hasn't started yet
+    if (written - x->x_pos < (uint64_t)n || written < x->x_pos) {
+        for (i = 0; i < n; i++)
+            out[i] = 0;
+        return (w + 4);
+    }
+
+    for (i = 0; i < n; i++)
+        out[i] = bus->b_samples[(x->x_pos + i) & (GLOBAL_SIGNAL_SIZE - 1)];
+
+    x->x_pos += n;
+    return (w + 4);
+}
+
+static void global_sigreceive_dsp(t_global_sigreceive* x, t_signal** sp)
+{
+    x->x_started = 0;
+    dsp_add(global_sigreceive_perform, 3, x, sp[0]->s_vec, (t_int)sp[0]->s_n);
+}
+
+static void* global_sigreceive_new(t_symbol* s)
+{
+    t_global_sigreceive* x = (t_global_sigreceive*)pd_new(global_sigreceive_class);
+    x->x_bus = global_bus_get(s->s_name, GLOBAL_SIGNAL);
+    x->x_pos = 0;
+    x->x_started = 0;
+    outlet_new(&x->x_obj, &s_signal);
+    return x;
+}
+
+static void global_sigreceive_free(t_global_sigreceive* x)
+{
+    global_bus_release(x->x_bus);
+}
+
+void libpd_global_setup(void)
+{
+    global_send_class = class_new(gensym("global.send"), (t_newmethod)global_send_new, (t_method)global_send_free,
+        sizeof(t_global_send), 0, A_DEFSYM, 0);
+    class_addcreator((t_newmethod)global_send_new, gensym("global.s"), A_DEFSYM, 0);
+    class_addanything(global_send_class, global_send_anything);
+
+    global_receive_class = class_new(gensym("global.receive"), (t_newmethod)global_receive_new, (t_method)global_receive_free,
+        sizeof(t_global_receive), CLASS_NOINLET, A_DEFSYM, 0);
+    class_addcreator((t_newmethod)global_receive_new, gensym("global.r"), A_DEFSYM, 0);
+
+    global_sigsend_class = class_new(gensym("global.send~"), (t_newmethod)global_sigsend_new, (t_method)global_sigsend_free,
+        sizeof(t_global_sigsend), 0, A_DEFSYM, 0);
+    class_addcreator((t_newmethod)global_sigsend_new, gensym("global.s~"), A_DEFSYM, 0);
+    CLASS_MAINSIGNALIN(global_sigsend_class, t_global_sigsend, x_f);
+    class_addmethod(global_sigsend_class, (t_method)global_sigsend_dsp, gensym("dsp"), A_CANT, 0);
+
+    global_sigreceive_class = class_new(gensym("global.receive~"), (t_newmethod)global_sigreceive_new, (t_method)global_sigreceive_free,
+        sizeof(t_global_sigreceive), CLASS_NOINLET, A_DEFSYM, 0);
+    class_addcreator((t_newmethod)global_sigreceive_new, gensym("global.r~"), A_DEFSYM, 0);
+    class_addmethod(global_sigreceive_class, (t_method)global_sigreceive_dsp, gensym("dsp"), A_CANT, 0);
+}
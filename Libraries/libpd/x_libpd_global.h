@@ -0,0 +1,19 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Creates [global.send], [global.receive], [global.send~] and [global.receive~], called once by libpd_multi_init
+// These work like [send] and [receive], but between all plugdata instances in the process, with one block of latency
+void libpd_global_setup(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -13,9 +13,13 @@
 
 #include <errno.h>
 
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "x_libpd_mod_utils.h"
+#include "x_libpd_extra_utils.h"
+#include "s_libpd_inter.h"
 
 struct _instanceeditor {
     t_binbuf* copy_binbuf;
@@ -120,6 +124,7 @@ void libpd_moveselection(t_canvas* cnv, int dx, int dy)
 
         t_class* cl = pd_class(&y->sel_what->g_pd);
         gobj_displace(y->sel_what, cnv, dx, dy);
+        patch_changed(cnv, pd_object_moved, y->sel_what);
         if (cl == vinlet_class)
             resortin = 1;
         else if (cl == voutlet_class)
@@ -166,6 +171,7 @@ void libpd_canvas_doclear(t_canvas* cnv)
         // t_gobj *selwas = x->gl_editor->e_selection->sel_what;
         pd_this->pd_newest = 0;
         glist_noselect(cnv);
+        patch_changed(cnv, pd_canvas_changed, 0);
         if (pd_this->pd_newest) {
             for (y = cnv->gl_list; y; y = y->g_next)
                 if (&y->g_pd == pd_this->pd_newest)
@@ -177,6 +183,7 @@ void libpd_canvas_doclear(t_canvas* cnv)
         for (y = cnv->gl_list; y; y = y2) {
             y2 = y->g_next;
             if (glist_isselected(cnv, y)) {
+                patch_changed(cnv, pd_object_removed, y);
                 glist_delete(cnv, y);
                 goto next;
             }
@@ -243,6 +250,385 @@ int libpd_canconnect(t_canvas* cnv, t_object* src, int nout, t_object* sink, int
         obj_issignalinlet(sink, nin));
 }
 
+/* ------- deferred dsp updates -------- */
+
+// Bound to a symbol while a rebuild of the dsp chain is pending, so every instance has its own
+typedef struct _libpd_dspupdate {
+    t_pd u_pd;
+    t_clock* u_clock;
+} t_libpd_dspupdate;
+
+static t_class* libpd_dspupdate_class;
+
+static t_libpd_dspupdate* libpd_dspupdate_get(void)
+{
+    return (t_libpd_dspupdate*)gensym("#libpd_dspupdate")->s_thing;
+}
+
+static void libpd_dspupdate_free(t_libpd_dspupdate* x)
+{
+    pd_unbind(&x->u_pd, gensym("#libpd_dspupdate"));
+    clock_free(x->u_clock);
+    pd_free(&x->u_pd);
+}
+
+// Runs at the start of the next tick, before its dsp
+static void libpd_dspupdate_tick(t_libpd_dspupdate* x)
+{
+    libpd_dspupdate_free(x);
+    canvas_update_dsp();
+}
+
+void libpd_dspupdate_setup(void)
+{
+    libpd_dspupdate_class = class_new(gensym("libpd_dspupdate"), (t_newmethod)NULL, (t_method)NULL,
+        sizeof(t_libpd_dspupdate), CLASS_PD, A_NULL, 0);
+}
+
+void libpd_dspupdate_schedule(void)
+{
+    t_libpd_dspupdate* x;
+
+    // While dsp is off or suspended, it gets rebuilt when it's turned on again anyway
+    if (!pd_this->pd_dspstate || libpd_dspupdate_get())
+        return;
+
+    x = (t_libpd_dspupdate*)pd_new(libpd_dspupdate_class);
+    x->u_clock = clock_new(x, (t_method)libpd_dspupdate_tick);
+    pd_bind(&x->u_pd, gensym("#libpd_dspupdate"));
+    clock_delay(x->u_clock, 0);
+}
+
+void libpd_dspupdate_flush(void)
+{
+    t_libpd_dspupdate* x = libpd_dspupdate_get();
+    if (x)
+        libpd_dspupdate_tick(x);
+}
+
+/* ------- deferred patch closing -------- */
+
+// Time the audio thread may spend on freeing objects in one tick
+#define LIBPD_DEFERFREE_BUDGET 0.0002
+
+// Same layouts as in m_pd.c and m_sched.c, to find what a closed patch left bound or scheduled
+typedef struct _fake_bindelem {
+    t_pd* e_who;
+    struct _fake_bindelem* e_next;
+} t_fake_bindelem;
+
+typedef struct _fake_bindlist {
+    t_pd b_pd;
+    t_fake_bindelem* b_list;
+} t_fake_bindlist;
+
+typedef struct _fake_clock {
+    double c_settime;
+    void* c_owner;
+    t_clockmethod c_fn;
+    struct _fake_clock* c_next;
+    t_float c_unit;
+} t_fake_clock;
+
+// Defined in m_libpd_class.c, the symbol table's layout is private to that file
+void libpd_symtable_foreach(void (*fn)(t_symbol* s, void* data), void* data);
+
+// A name an object of a closed patch was bound to, so the patch stops receiving messages
+typedef struct _libpd_deferfree_binding {
+    t_pd* b_who;
+    t_symbol* b_symbol;
+} t_libpd_deferfree_binding;
+
+typedef struct _libpd_deferfree_patch {
+    t_canvas* p_canvas;
+    t_libpd_deferfree_binding* p_bindings; // sorted on b_who
+    int p_nbindings;
+} t_libpd_deferfree_patch;
+
+// Every object in a patch, sorted, only while it's being closed
+typedef struct _libpd_deferfree_objects {
+    t_pd** o_vec;
+    int o_n;
+    int o_size;
+    t_libpd_deferfree_patch* o_patch;
+} t_libpd_deferfree_objects;
+
+// Bound to a symbol while closed patches are being freed, so every instance has its own
+typedef struct _libpd_deferfree {
+    t_pd f_pd;
+    t_clock* f_clock;
+    t_libpd_deferfree_patch* f_patches;
+    int f_npatches;
+} t_libpd_deferfree;
+
+static t_class* libpd_deferfree_class;
+
+static t_libpd_deferfree* libpd_deferfree_get(void)
+{
+    return (t_libpd_deferfree*)gensym("#libpd_deferfree")->s_thing;
+}
+
+static int libpd_deferfree_compare(void const* a, void const* b)
+{
+    uintptr_t x = (uintptr_t)(*(t_pd* const*)a), y = (uintptr_t)(*(t_pd* const*)b);
+    return x < y ? -1 : x > y;
+}
+
+static void libpd_deferfree_collect(t_libpd_deferfree_objects* o, t_glist* gl)
+{
+    t_gobj* y;
+
+    if (o->o_n == o->o_size) {
+        o->o_vec = (t_pd**)resizebytes(o->o_vec, o->o_size * sizeof(t_pd*), o->o_size * 2 * sizeof(t_pd*));
+        o->o_size *= 2;
+    }
+    o->o_vec[o->o_n++] = &gl->gl_pd;
+
+    for (y = gl->gl_list; y; y = y->g_next) {
+        if (pd_class(&y->g_pd) == canvas_class) {
+            libpd_deferfree_collect(o, (t_glist*)y);
+            continue;
+        }
+        if (o->o_n == o->o_size) {
+            o->o_vec = (t_pd**)resizebytes(o->o_vec, o->o_size * sizeof(t_pd*), o->o_size * 2 * sizeof(t_pd*));
+            o->o_size *= 2;
+        }
+        o->o_vec[o->o_n++] = &y->g_pd;
+    }
+}
+
+static int libpd_deferfree_contains(t_libpd_deferfree_objects* o, void* who)
+{
+    return bsearch(&who, o->o_vec, o->o_n, sizeof(t_pd*), libpd_deferfree_compare) != NULL;
+}
+
+static void libpd_deferfree_addbinding(t_libpd_deferfree_patch* p, t_pd* who, t_symbol* s)
+{
+    p->p_bindings = (t_libpd_deferfree_binding*)resizebytes(p->p_bindings,
+        p->p_nbindings * sizeof(t_libpd_deferfree_binding), (p->p_nbindings + 1) * sizeof(t_libpd_deferfree_binding));
+    p->p_bindings[p->p_nbindings].b_who = who;
+    p->p_bindings[p->p_nbindings].b_symbol = s;
+    p->p_nbindings++;
+}
+
+static int libpd_deferfree_isbindlist(t_pd* x)
+{
+    return x && !strcmp(class_getname(*x), "bindlist");
+}
+
+static void libpd_deferfree_findbindings(t_symbol* s, void* data)
+{
+    t_libpd_deferfree_objects* o = (t_libpd_deferfree_objects*)data;
+    t_fake_bindelem* e;
+
+    if (libpd_deferfree_isbindlist(s->s_thing)) {
+        for (e = ((t_fake_bindlist*)s->s_thing)->b_list; e; e = e->e_next) {
+            if (libpd_deferfree_contains(o, e->e_who))
+                libpd_deferfree_addbinding(o->o_patch, e->e_who, s);
+        }
+    } else if (s->s_thing && libpd_deferfree_contains(o, s->s_thing)) {
+        libpd_deferfree_addbinding(o->o_patch, s->s_thing, s);
+    }
+}
+
+static int libpd_deferfree_isbound(t_pd* who, t_symbol* s)
+{
+    t_fake_bindelem* e;
+
+    if (s->s_thing == who)
+        return 1;
+    if (libpd_deferfree_isbindlist(s->s_thing)) {
+        for (e = ((t_fake_bindlist*)s->s_thing)->b_list; e; e = e->e_next) {
+            if (e->e_who == who)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+// Objects unbind themselves when they're freed, so their names are bound again before any of them is
+static void libpd_deferfree_rebind(t_libpd_deferfree_patch* p)
+{
+    int i;
+    for (i = 0; i < p->p_nbindings; i++)
+        pd_bind(p->p_bindings[i].b_who, p->p_bindings[i].b_symbol);
+}
+
+// Unbinds the objects that are still there, and forgets the ones that were freed
+static void libpd_deferfree_unbind(t_libpd_deferfree_patch* p)
+{
+    int i, n = 0;
+    for (i = 0; i < p->p_nbindings; i++) {
+        if (!libpd_deferfree_isbound(p->p_bindings[i].b_who, p->p_bindings[i].b_symbol))
+            continue;
+        pd_unbind(p->p_bindings[i].b_who, p->p_bindings[i].b_symbol);
+        p->p_bindings[n++] = p->p_bindings[i];
+    }
+    p->p_bindings = (t_libpd_deferfree_binding*)resizebytes(p->p_bindings,
+        p->p_nbindings * sizeof(t_libpd_deferfree_binding), n * sizeof(t_libpd_deferfree_binding));
+    p->p_nbindings = n;
+}
+
+// Other patches find arrays, delay lines and the like by name, and keep pointers to them in their dsp chain
+static int libpd_deferfree_isnamed(t_libpd_deferfree_patch* p, t_gobj* y)
+{
+    t_pd* who = &y->g_pd;
+    return pd_class(&y->g_pd) != canvas_class
+        && bsearch(&who, p->p_bindings, p->p_nbindings, sizeof(t_libpd_deferfree_binding), libpd_deferfree_compare) != NULL;
+}
+
+// Unbinds the patch's receivers and unsets its clocks, so a closed patch doesn't do anything while it waits to be freed
+static void libpd_deferfree_silence(t_libpd_deferfree_patch* p)
+{
+    t_libpd_deferfree_objects o;
+    t_fake_clock *c, *next;
+
+    o.o_size = 64;
+    o.o_n = 0;
+    o.o_vec = (t_pd**)getbytes(o.o_size * sizeof(t_pd*));
+    o.o_patch = p;
+    libpd_deferfree_collect(&o, p->p_canvas);
+    qsort(o.o_vec, o.o_n, sizeof(t_pd*), libpd_deferfree_compare);
+
+    libpd_symtable_foreach(libpd_deferfree_findbindings, &o);
+    qsort(p->p_bindings, p->p_nbindings, sizeof(t_libpd_deferfree_binding), libpd_deferfree_compare);
+    libpd_deferfree_unbind(p);
+
+    for (c = (t_fake_clock*)pd_this->pd_clock_setlist; c; c = next) {
+        next = c->c_next;
+        if (libpd_deferfree_contains(&o, c->c_owner))
+            clock_unset((t_clock*)c);
+    }
+
+    freebytes(o.o_vec, o.o_size * sizeof(t_pd*));
+}
+
+// canvas_free takes a toplevel canvas off the canvas list, so it has to be on there again
+static void libpd_deferfree_close(t_libpd_deferfree_patch* p)
+{
+    p->p_canvas->gl_next = pd_this->pd_canvaslist;
+    pd_this->pd_canvaslist = p->p_canvas;
+    pd_free(&p->p_canvas->gl_pd);
+    freebytes(p->p_bindings, p->p_nbindings * sizeof(t_libpd_deferfree_binding));
+}
+
+// Deletes what's inside a closed patch, subpatches from the inside out, until the time is up
+// Returns 1 once the canvas is empty, rebuild is set when something other patches can find by name was deleted
+static int libpd_deferfree_clear(t_libpd_deferfree_patch* p, t_glist* gl, double deadline, int* rebuild)
+{
+    t_gobj* y;
+    while ((y = gl->gl_list)) {
+        if (sys_getrealtime() > deadline)
+            return 0;
+        if (pd_class(&y->g_pd) == canvas_class && !libpd_deferfree_clear(p, (t_glist*)y, deadline, rebuild))
+            return 0;
+        if (libpd_deferfree_isnamed(p, y))
+            *rebuild = 1;
+        glist_delete(gl, y);
+    }
+    return 1;
+}
+
+static void libpd_deferfree_free(t_libpd_deferfree* x)
+{
+    pd_unbind(&x->f_pd, gensym("#libpd_deferfree"));
+    clock_free(x->f_clock);
+    freebytes(x->f_patches, x->f_npatches * sizeof(t_libpd_deferfree_patch));
+    pd_free(&x->f_pd);
+}
+
+// Runs at the start of a tick, before its dsp
+// The closed patches were left out of the dsp chain when they closed, so deleting their signal objects doesn't need
+// the rebuild glist_delete would do. It's only rebuilt once something other patches may have found by name is gone
+static void libpd_deferfree_tick(t_libpd_deferfree* x)
+{
+    double deadline = sys_getrealtime() + LIBPD_DEFERFREE_BUDGET;
+    int dspstate = pd_this->pd_dspstate, rebuild = 0;
+
+    pd_this->pd_dspstate = 0;
+    while (x->f_npatches) {
+        t_libpd_deferfree_patch* p = &x->f_patches[0];
+        libpd_deferfree_rebind(p);
+        if (!libpd_deferfree_clear(p, p->p_canvas, deadline, &rebuild)) {
+            libpd_deferfree_unbind(p);
+            break;
+        }
+        libpd_deferfree_close(p);
+        memmove(x->f_patches, x->f_patches + 1, (x->f_npatches - 1) * sizeof(t_libpd_deferfree_patch));
+        x->f_patches = (t_libpd_deferfree_patch*)resizebytes(x->f_patches, x->f_npatches * sizeof(t_libpd_deferfree_patch),
+            (x->f_npatches - 1) * sizeof(t_libpd_deferfree_patch));
+        x->f_npatches--;
+    }
+    pd_this->pd_dspstate = dspstate;
+
+    if (rebuild)
+        canvas_update_dsp();
+
+    if (x->f_npatches)
+        clock_delay(x->f_clock, sys_getblksize());
+    else
+        libpd_deferfree_free(x);
+}
+
+void libpd_deferfree_setup(void)
+{
+    libpd_deferfree_class = class_new(gensym("libpd_deferfree"), (t_newmethod)NULL, (t_method)NULL,
+        sizeof(t_libpd_deferfree), CLASS_PD, A_NULL, 0);
+}
+
+void libpd_deferfree_canvas(t_canvas* cnv)
+{
+    t_libpd_deferfree* x = libpd_deferfree_get();
+    t_libpd_deferfree_patch* p;
+    t_canvas* z;
+
+    if (!x) {
+        x = (t_libpd_deferfree*)pd_new(libpd_deferfree_class);
+        x->f_clock = clock_new(x, (t_method)libpd_deferfree_tick);
+        x->f_patches = (t_libpd_deferfree_patch*)getbytes(0);
+        x->f_npatches = 0;
+        clock_setunit(x->f_clock, 1, 1);
+        pd_bind(&x->f_pd, gensym("#libpd_deferfree"));
+        clock_delay(x->f_clock, sys_getblksize());
+    }
+
+    // Off the canvas list, it's left out of the rebuild of the dsp chain at the start of the next tick
+    if (pd_this->pd_canvaslist == cnv)
+        pd_this->pd_canvaslist = cnv->gl_next;
+    else {
+        for (z = pd_this->pd_canvaslist; z && z->gl_next != cnv; z = z->gl_next)
+            ;
+        if (z)
+            z->gl_next = cnv->gl_next;
+    }
+    cnv->gl_next = NULL;
+
+    x->f_patches = (t_libpd_deferfree_patch*)resizebytes(x->f_patches, x->f_npatches * sizeof(t_libpd_deferfree_patch),
+        (x->f_npatches + 1) * sizeof(t_libpd_deferfree_patch));
+    p = &x->f_patches[x->f_npatches++];
+    p->p_canvas = cnv;
+    p->p_bindings = (t_libpd_deferfree_binding*)getbytes(0);
+    p->p_nbindings = 0;
+
+    libpd_deferfree_silence(p);
+    libpd_dspupdate_schedule();
+}
+
+void libpd_deferfree_flush(void)
+{
+    t_libpd_deferfree* x = libpd_deferfree_get();
+    int i;
+
+    if (!x)
+        return;
+
+    for (i = 0; i < x->f_npatches; i++) {
+        libpd_deferfree_rebind(&x->f_patches[i]);
+        libpd_deferfree_close(&x->f_patches[i]);
+    }
+    libpd_deferfree_free(x);
+}
+
 int libpd_tryconnect(t_canvas* cnv, t_object* src, int nout, t_object* sink, int nin)
 {
     if (libpd_canconnect(cnv, src, nout, sink, nin)) {
@@ -273,6 +659,11 @@ int libpd_tryconnect(t_canvas* cnv, t_object* src, int nout, t_object* sink, int
                 oc);
             canvas_undo_add(cnv, UNDO_CONNECT, "connect", canvas_undo_set_connect(cnv, canvas_getindex(cnv, &src->ob_g), nout, canvas_getindex(cnv, &sink->ob_g), nin));
             canvas_dirty(cnv, 1);
+            connection_changed(cnv, pd_connection_added, src, nout, sink, nin);
+
+            // Control connections don't change the dsp chain
+            if (obj_issignaloutlet(src, nout))
+                libpd_dspupdate_schedule();
             return 1;
         }
     }
@@ -369,21 +760,78 @@ char const* libpd_copy(t_canvas* cnv, int* size)
     return text;
 }
 
-void libpd_paste(t_canvas* cnv, char const* buf)
+static t_gobj* libpd_lastobj(t_canvas* cnv)
+{
+    t_gobj* y;
+    for (y = cnv->gl_list; y && y->g_next; y = y->g_next) {
+    }
+    return y;
+}
+
+// Pasted objects are appended after the last object, the only connections pasted are the ones between them
+// Reports them as single changes, so the GUI doesn't have to rescan the whole canvas
+static t_gobj* libpd_reportpasted(t_canvas* cnv, t_gobj* last)
+{
+    t_gobj* first = last ? last->g_next : cnv->gl_list;
+    t_gobj* y;
+
+    for (y = first; y; y = y->g_next)
+        patch_changed(cnv, pd_object_added, y);
+
+    for (y = first; y; y = y->g_next) {
+        t_object* src = pd_checkobject(&y->g_pd);
+        int nout;
+
+        if (!src)
+            continue;
+
+        for (nout = 0; nout < obj_noutlets(src); nout++) {
+            t_outlet* outlet;
+            t_outconnect* connection = obj_starttraverseoutlet(src, &outlet, nout);
+            while (connection) {
+                t_object* sink;
+                t_inlet* inlet;
+                int nin;
+                connection = obj_nexttraverseoutlet(connection, &sink, &inlet, &nin);
+                connection_changed(cnv, pd_connection_added, src, nout, sink, nin);
+            }
+        }
+    }
+
+    return first;
+}
+
+t_gobj* libpd_paste(t_canvas* cnv, char const* buf)
 {
     size_t len = strlen(buf);
+    t_gobj* last;
+    t_gobj* first;
+
     binbuf_text(pd_this->pd_gui->i_editor->copy_binbuf, buf, len);
     
     sys_lock();
+    last = libpd_lastobj(cnv);
     pd_typedmess((t_pd*)cnv, gensym("paste"), 0, NULL);
+    first = libpd_reportpasted(cnv, last);
     sys_unlock();
+
+    return first;
 }
 
 void libpd_undo(t_canvas* cnv)
 {
+    int dspstate;
+
     sys_lock();
+
+    // An undo sequence can contain many changes to the dsp chain, it only needs to be rebuilt once
+    dspstate = canvas_suspend_dsp();
     pd_typedmess((t_pd*)cnv, gensym("undo"), 0, NULL);
+    canvas_resume_dsp(dspstate);
+
     sys_unlock();
+
+    patch_changed(cnv, pd_canvas_changed, 0);
 }
 
 void libpd_redo(t_canvas* cnv)
@@ -394,15 +842,28 @@ void libpd_redo(t_canvas* cnv)
         return;
 
     sys_lock();
-    pd_typedmess((t_pd*)cnv, gensym("redo"), 0, NULL);
+    {
+        int dspstate = canvas_suspend_dsp();
+        pd_typedmess((t_pd*)cnv, gensym("redo"), 0, NULL);
+        canvas_resume_dsp(dspstate);
+    }
     sys_unlock();
+
+    patch_changed(cnv, pd_canvas_changed, 0);
 }
 
-void libpd_duplicate(t_canvas* cnv)
+t_gobj* libpd_duplicate(t_canvas* cnv)
 {
+    t_gobj* last;
+    t_gobj* first;
+
     sys_lock();
+    last = libpd_lastobj(cnv);
     pd_typedmess((t_pd*)cnv, gensym("duplicate"), 0, NULL);
+    first = libpd_reportpasted(cnv, last);
     sys_unlock();
+
+    return first;
 }
 
 void libpd_canvas_saveto(t_canvas* cnv, t_binbuf* b)
@@ -561,6 +1022,20 @@ void libpd_savetofile(t_canvas* cnv, t_symbol* filename, t_symbol* dir)
     binbuf_free(b);
 }
 
+void libpd_reload_abstraction(char const* name, char const* dir)
+{
+    char path[MAXPDSTRING];
+    snprintf(path, MAXPDSTRING, "%s/%s", dir, name);
+
+    sys_lock();
+
+    // The instances are created again through the patch cache, so the file is only read once
+    libpd_patchcache_invalidate(path);
+    canvas_reload(gensym(name), gensym(dir), 0);
+
+    sys_unlock();
+}
+
 t_pd* libpd_creategraphonparent(t_canvas* cnv, int x, int y)
 {
     int argc = 9;
@@ -599,6 +1074,8 @@ t_pd* libpd_creategraphonparent(t_canvas* cnv, int x, int y)
     t_pd* result = libpd_newest(cnv);
     ((t_glist*)result)->gl_hidetext = 1;
 
+    patch_changed(cnv, pd_object_added, result);
+
     return result;
 }
 
@@ -624,6 +1101,8 @@ t_pd* libpd_creategraph(t_canvas* cnv, char const* name, int size, int x, int y)
 
     gobj_setposition(pd_checkobject(arr), cnv, x, y);
 
+    patch_changed(cnv, pd_object_added, arr);
+
     return arr;
 }
 
@@ -650,6 +1129,9 @@ t_pd* libpd_createobj(t_canvas* cnv, t_symbol* s, int argc, t_atom* argv)
     
     glist_noselect(cnv);
 
+    if (new_object)
+        patch_changed(cnv, pd_object_added, new_object);
+
     return new_object;
 }
 
@@ -720,6 +1202,9 @@ void libpd_renameobj(t_canvas* cnv, t_gobj* obj, char const* buf, size_t bufsize
 
     canvas_editmode(cnv, 0);
     sys_unlock();
+
+    // Retyping recreates the object and its connections
+    patch_changed(cnv, pd_canvas_changed, 0);
 }
 
 int libpd_can_undo(t_canvas* cnv)
@@ -752,12 +1237,16 @@ void libpd_undo_apply(t_canvas* cnv, t_gobj* obj)
 
     canvas_undo_add(cnv, UNDO_APPLY, "props",
         canvas_undo_set_apply(cnv, glist_getindex(cnv, obj)));
+
+    patch_changed(cnv, pd_canvas_changed, 0);
 }
 
 void libpd_moveobj(t_canvas* cnv, t_gobj* obj, int x, int y)
 {
     ((t_object*)obj)->te_xpix = x;
     ((t_object*)obj)->te_ypix = y;
+
+    patch_changed(cnv, pd_object_moved, obj);
 }
 
 void libpd_createconnection(t_canvas* cnv, t_object* src, int nout, t_object* sink, int nin)
@@ -766,6 +1255,268 @@ void libpd_createconnection(t_canvas* cnv, t_object* src, int nout, t_object* si
     glist_noselect(cnv);
 }
 
+/* ------- encapsulate: moving the selection into a new subpatch -------- */
+
+// A connection between a selected and an unselected object
+typedef struct _libpd_encapsulate_edge {
+    t_object* e_inner; // the selected object
+    int e_index;       // its inlet or outlet
+    t_object* e_outer;
+    int e_outerindex;
+    int e_isoutlet;
+    int e_signal;
+    int e_xpix;
+    int e_iolet; // the index of the [inlet] or [outlet] that replaces it, shared by edges with the same inner iolet
+} t_libpd_encapsulate_edge;
+
+static int libpd_encapsulate_compareptr(void const* a, void const* b)
+{
+    uintptr_t pa = (uintptr_t)(*(t_gobj* const*)a);
+    uintptr_t pb = (uintptr_t)(*(t_gobj* const*)b);
+    return (pa > pb) - (pa < pb);
+}
+
+// Inlets before outlets, then from left to right, the same order pd gives the iolets of the new subpatch
+static int libpd_encapsulate_compareedge(void const* a, void const* b)
+{
+    t_libpd_encapsulate_edge const* ea = (t_libpd_encapsulate_edge const*)a;
+    t_libpd_encapsulate_edge const* eb = (t_libpd_encapsulate_edge const*)b;
+    if (ea->e_isoutlet != eb->e_isoutlet)
+        return ea->e_isoutlet - eb->e_isoutlet;
+    if (ea->e_xpix != eb->e_xpix)
+        return ea->e_xpix - eb->e_xpix;
+    if (ea->e_inner != eb->e_inner)
+        return libpd_encapsulate_compareptr(&ea->e_inner, &eb->e_inner);
+    return ea->e_index - eb->e_index;
+}
+
+static int libpd_encapsulate_sameiolet(t_libpd_encapsulate_edge const* a, t_libpd_encapsulate_edge const* b)
+{
+    return a->e_isoutlet == b->e_isoutlet && a->e_inner == b->e_inner && a->e_index == b->e_index;
+}
+
+t_canvas* libpd_encapsulate(t_canvas* cnv)
+{
+    t_selection* sel;
+    t_gobj **selected, **moved, *y, *prev, *next, *first = 0, *last = 0;
+    t_libpd_encapsulate_edge* edges = 0;
+    t_linetraverser t;
+    t_outconnect* oc;
+    t_binbuf* b;
+    t_canvas* subpatch;
+    int nselected = 0, nmoved = 0, nedges = 0, i, niolets, dspstate;
+    int top = 0x7fffffff, bottom = -0x7fffffff, left = 0x7fffffff, right = -0x7fffffff, lastx, lastoutlet;
+
+    sys_lock();
+
+    if (!cnv->gl_editor || !cnv->gl_editor->e_selection) {
+        sys_unlock();
+        return 0;
+    }
+
+    for (sel = cnv->gl_editor->e_selection; sel; sel = sel->sel_next) {
+        t_class* cl = pd_class(&sel->sel_what->g_pd);
+
+        // Inlets and outlets belong to the object of their canvas, they can't be moved to another one
+        if (cl == vinlet_class || cl == voutlet_class) {
+            sys_unlock();
+            return 0;
+        }
+        nselected++;
+    }
+
+    selected = (t_gobj**)getbytes(nselected * sizeof(t_gobj*));
+    for (sel = cnv->gl_editor->e_selection, i = 0; sel; sel = sel->sel_next, i++) {
+        int x1, y1, x2, y2;
+        selected[i] = sel->sel_what;
+        gobj_getrect(sel->sel_what, cnv, &x1, &y1, &x2, &y2);
+        top = y1 < top ? y1 : top;
+        bottom = y2 > bottom ? y2 : bottom;
+        left = x1 < left ? x1 : left;
+        right = x2 > right ? x2 : right;
+    }
+    qsort(selected, nselected, sizeof(t_gobj*), libpd_encapsulate_compareptr);
+
+#define libpd_encapsulate_isselected(obj) \
+    (bsearch(&(obj), selected, nselected, sizeof(t_gobj*), libpd_encapsulate_compareptr) != 0)
+
+    linetraverser_start(&t, cnv);
+    while ((oc = linetraverser_next(&t))) {
+        t_gobj* src = &t.tr_ob->ob_g;
+        t_gobj* sink = &t.tr_ob2->ob_g;
+        int srcselected = libpd_encapsulate_isselected(src);
+        int sinkselected = libpd_encapsulate_isselected(sink);
+        t_libpd_encapsulate_edge* e;
+
+        if (srcselected == sinkselected)
+            continue;
+
+        edges = (t_libpd_encapsulate_edge*)resizebytes(edges, nedges * sizeof(t_libpd_encapsulate_edge), (nedges + 1) * sizeof(t_libpd_encapsulate_edge));
+        e = edges + nedges++;
+        e->e_isoutlet = srcselected;
+        e->e_inner = srcselected ? t.tr_ob : t.tr_ob2;
+        e->e_index = srcselected ? t.tr_outno : t.tr_inno;
+        e->e_outer = srcselected ? t.tr_ob2 : t.tr_ob;
+        e->e_outerindex = srcselected ? t.tr_inno : t.tr_outno;
+        e->e_signal = obj_issignaloutlet(t.tr_ob, t.tr_outno);
+        e->e_xpix = srcselected ? t.tr_lx1 : t.tr_lx2;
+    }
+    qsort(edges, nedges, sizeof(t_libpd_encapsulate_edge), libpd_encapsulate_compareedge);
+
+    canvas_undo_add(cnv, UNDO_SEQUENCE_START, "encapsulate", 0);
+
+    // Undoing restores the objects and all their connections from this, the same as undoing a delete
+    canvas_undo_add(cnv, UNDO_CUT, "clear", canvas_undo_set_cut(cnv, 2));
+
+    glist_noselect(cnv);
+    dspstate = canvas_suspend_dsp();
+
+    for (i = 0; i < nedges; i++)
+        obj_disconnect(edges[i].e_isoutlet ? edges[i].e_inner : edges[i].e_outer, edges[i].e_isoutlet ? edges[i].e_index : edges[i].e_outerindex,
+            edges[i].e_isoutlet ? edges[i].e_outer : edges[i].e_inner, edges[i].e_isoutlet ? edges[i].e_outerindex : edges[i].e_index);
+
+    // An [inlet] or [outlet] for every iolet of the selection that had a connection from outside
+    // They are placed left to right in the order of the edges, so pd sorts the new subpatch's iolets the same way
+    b = binbuf_new();
+    binbuf_addv(b, "ssiiiisi;", gensym("#N"), gensym("canvas"), 0, 50, 450, 300, gensym("(subpatch)"), 0);
+
+    lastx = -0x7fffffff;
+    lastoutlet = -1;
+    niolets = 0;
+    for (i = 0; i < nedges; i++) {
+        t_libpd_encapsulate_edge* e = edges + i;
+        int x;
+
+        if (i > 0 && libpd_encapsulate_sameiolet(e, e - 1)) {
+            e->e_iolet = (e - 1)->e_iolet;
+            continue;
+        }
+
+        if (e->e_isoutlet != lastoutlet) {
+            lastx = -0x7fffffff;
+            lastoutlet = e->e_isoutlet;
+            niolets = 0;
+        }
+
+        x = e->e_xpix > lastx ? e->e_xpix : lastx + 1;
+        lastx = x;
+        e->e_iolet = niolets++;
+
+        binbuf_addv(b, "ssiis;", gensym("#X"), gensym("obj"), x, e->e_isoutlet ? bottom + 30 : top - 40,
+            gensym(e->e_isoutlet ? (e->e_signal ? "outlet~" : "outlet") : (e->e_signal ? "inlet~" : "inlet")));
+    }
+
+    binbuf_addv(b, "ssiis;", gensym("#X"), gensym("restore"), (left + right) / 2, (top + bottom) / 2, gensym("pd"));
+
+    canvas_setcurrent(cnv);
+    binbuf_eval(b, 0, 0, 0);
+    canvas_unsetcurrent(cnv);
+    binbuf_free(b);
+
+    subpatch = (t_canvas*)libpd_newest(cnv);
+
+    // Unlink the selected objects without freeing them, so they keep their state
+    moved = (t_gobj**)getbytes(nselected * sizeof(t_gobj*));
+    for (y = cnv->gl_list, prev = 0; y; y = next) {
+        t_object* ob;
+        next = y->g_next;
+
+        if (!libpd_encapsulate_isselected(y)) {
+            prev = y;
+            continue;
+        }
+
+        if (prev)
+            prev->g_next = next;
+        else
+            cnv->gl_list = next;
+
+        if (cnv->gl_editor && (ob = pd_checkobject(&y->g_pd)))
+            rtext_free(glist_findrtext(cnv, ob));
+
+        if (pd_class(&y->g_pd) == canvas_class)
+            ((t_canvas*)y)->gl_owner = subpatch;
+
+        patch_changed(cnv, pd_object_removed, y);
+
+        y->g_next = 0;
+        if (last)
+            last->g_next = y;
+        else
+            first = y;
+        last = y;
+        moved[nmoved++] = y;
+    }
+
+#undef libpd_encapsulate_isselected
+
+    // They go before the [inlet] and [outlet] objects, in the order they had
+    if (last) {
+        last->g_next = subpatch->gl_list;
+        subpatch->gl_list = first;
+    }
+
+    for (i = 0; i < nmoved; i++) {
+        t_object* ob;
+        if (subpatch->gl_editor && (ob = pd_checkobject(&moved[i]->g_pd)))
+            rtext_new(subpatch, ob);
+    }
+
+    // Connect the new [inlet] and [outlet] objects inside, they follow the moved objects
+    for (i = 0; i < nedges; i++) {
+        t_libpd_encapsulate_edge* e = edges + i;
+        t_gobj* iolet;
+        int n;
+
+        if (i > 0 && libpd_encapsulate_sameiolet(e, e - 1))
+            continue;
+
+        // Outlet objects come after all inlet objects
+        for (iolet = first ? last->g_next : subpatch->gl_list, n = 0; iolet; iolet = iolet->g_next) {
+            t_class* cl = pd_class(&iolet->g_pd);
+            if ((e->e_isoutlet ? cl == voutlet_class : cl == vinlet_class) && n++ == e->e_iolet)
+                break;
+        }
+
+        if (!iolet)
+            continue;
+
+        if (e->e_isoutlet)
+            obj_connect(e->e_inner, e->e_index, pd_checkobject(&iolet->g_pd), 0);
+        else
+            obj_connect(pd_checkobject(&iolet->g_pd), 0, e->e_inner, e->e_index);
+    }
+
+    canvas_resume_dsp(dspstate);
+
+    // Undoing the creation removes the subpatch, before the objects are restored
+    glist_select(cnv, &subpatch->gl_obj.te_g);
+    canvas_undo_add(cnv, UNDO_CREATE, "create", (void*)canvas_undo_set_create(cnv));
+    glist_noselect(cnv);
+
+    patch_changed(cnv, pd_object_added, subpatch);
+
+    for (i = 0; i < nedges; i++) {
+        t_libpd_encapsulate_edge* e = edges + i;
+        if (e->e_isoutlet)
+            libpd_tryconnect(cnv, &subpatch->gl_obj, e->e_iolet, e->e_outer, e->e_outerindex);
+        else
+            libpd_tryconnect(cnv, e->e_outer, e->e_outerindex, &subpatch->gl_obj, e->e_iolet);
+    }
+
+    canvas_undo_add(cnv, UNDO_SEQUENCE_END, "encapsulate", 0);
+    canvas_dirty(cnv, 1);
+
+    freebytes(moved, nselected * sizeof(t_gobj*));
+    freebytes(selected, nselected * sizeof(t_gobj*));
+    if (edges)
+        freebytes(edges, nedges * sizeof(t_libpd_encapsulate_edge));
+
+    sys_unlock();
+
+    return subpatch;
+}
+
 /* ------- specific undo methods: 1. connect -------- */
 typedef struct _undo_connect {
     int u_index1;
@@ -789,11 +1540,16 @@ void libpd_removeconnection(t_canvas* cnv, t_object* src, int nout, t_object* si
 
     obj_disconnect(src, nout, sink, nin);
 
+    if (obj_issignaloutlet(src, nout))
+        libpd_dspupdate_schedule();
+
     int dest_i = canvas_getindex(cnv, &(sink->te_g));
     int src_i = canvas_getindex(cnv, &(src->te_g));
 
     canvas_undo_add(cnv, UNDO_DISCONNECT, "disconnect", canvas_undo_set_disconnect(cnv, src_i, nout, dest_i, nin));
     glist_noselect(cnv);
+
+    connection_changed(cnv, pd_connection_removed, src, nout, sink, nin);
 }
 
 void libpd_getcontent(t_canvas* cnv, char** buf, int* bufsize)
@@ -801,6 +1557,7 @@ void libpd_getcontent(t_canvas* cnv, char** buf, int* bufsize)
     t_binbuf* b = binbuf_new();
     libpd_canvas_saveto(cnv, b);
     binbuf_gettext(b, buf, bufsize);
+    binbuf_free(b);
 }
 
 typedef t_pd* (*t_newgimme)(t_symbol* s, int argc, t_atom* argv);
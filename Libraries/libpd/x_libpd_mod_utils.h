@@ -29,9 +29,10 @@ void libpd_renameobj(t_canvas* cnv, t_gobj* obj, char const* buf, size_t bufsize
 void libpd_moveobj(t_canvas* cnv, t_gobj* obj, int x, int y);
 
 char const* libpd_copy(t_canvas* cnv, int* size);
-void libpd_paste(t_canvas* cnv, char const*);
+// Both return the first created object, or NULL if nothing was created. Everything after it in the canvas' list is new
+t_gobj* libpd_paste(t_canvas* cnv, char const*);
 
-void libpd_duplicate(t_canvas* x);
+t_gobj* libpd_duplicate(t_canvas* x);
 
 void libpd_undo(t_canvas* cnv);
 void libpd_redo(t_canvas* cnv);
@@ -44,13 +45,38 @@ void libpd_removeselection(t_canvas* cnv);
 
 void libpd_moveselection(t_canvas* cnv, int dx, int dy);
 
+// Changes to signal connections don't rebuild the dsp chain right away
+// All changes made before the next tick are combined into one rebuild, that happens at the start of that tick
+void libpd_dspupdate_setup(void);
+void libpd_dspupdate_schedule(void);
+
+// Does a pending rebuild immediately
+void libpd_dspupdate_flush(void);
+
+// Closes a toplevel patch without freeing all of it at once, the caller needs to hold pd's lock
+// It's taken off the canvas list and silenced right away, then its objects are freed a few at a time at the start of the next ticks
+void libpd_deferfree_setup(void);
+void libpd_deferfree_canvas(t_canvas* cnv);
+
+// Frees the patches that are still waiting, immediately
+void libpd_deferfree_flush(void);
+
 int libpd_hasconnection(t_canvas* cnv, t_object* src, int nout, t_object* sink, int nin);
 void libpd_createconnection(t_canvas* cnv, t_object* src, int nout, t_object* sink, int nin);
+
+// Moves the selected objects into a new subpatch as one undoable step, they keep their state and the connections between them
+// Connections to the rest of the canvas go through new [inlet] and [outlet] objects
+// Returns NULL without changing anything if the selection is empty or contains inlets or outlets
+t_canvas* libpd_encapsulate(t_canvas* cnv);
 void libpd_removeconnection(t_canvas* cnv, t_object* src, int nout, t_object* sink, int nin);
 
 void libpd_getcontent(t_canvas* cnv, char** buf, int* bufsize);
 void libpd_savetofile(t_canvas* cnv, t_symbol* filename, t_symbol* dir);
 
+// Recreates every instance of an abstraction after its file changed, they stay connected to their parent
+// Pd rebuilds the dsp chain once, after all instances have been replaced
+void libpd_reload_abstraction(char const* name, char const* dir);
+
 int libpd_type_exists(char const* type);
 
 int libpd_noutlets(t_object const* x);
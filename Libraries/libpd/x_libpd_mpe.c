@@ -0,0 +1,306 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <m_pd.h>
+
+#include <string.h>
+
+#include "x_libpd_mpe.h"
+
+// [mpe.voices <voices>] takes the host's midi before it goes through [notein] and friends, and hands out voices for [clone]
+// Every outlet sends "<voice> <values>" lists, so [clone] can pass them on by index without routing on symbols
+// A note keeps its voice until it's released, and the voice follows the expression of the note's channel
+// Pitch bend on the manager channel (1) is added to every voice, and notes on the manager channel get its other expression too,
+// which also covers midi that isn't MPE
+// Notes, channels and voices are looked up in tables, so every event takes the same time
+
+#define MPE_MAX_VOICES 128
+#define MPE_NO_VOICE -1
+
+typedef struct _mpe_voice {
+    int v_channel;
+    int v_note;
+    int v_prev; // sounding voices are kept from oldest to newest, free voices form a stack through v_next
+    int v_next;
+    int v_active;
+} t_mpe_voice;
+
+static t_class* mpe_voices_class;
+
+typedef struct _mpe_voices {
+    t_object x_obj;
+    t_outlet* x_note_out;
+    t_outlet* x_bend_out;
+    t_outlet* x_pressure_out;
+    t_outlet* x_timbre_out;
+
+    int x_nvoices;
+    int x_offset; // number of the first voice, [clone] starts at 0 unless -s is given
+    t_mpe_voice x_voices[MPE_MAX_VOICES];
+    int x_free;
+    int x_oldest;
+    int x_newest;
+
+    signed char x_lookup[16][128];  // voice playing each note on each channel
+    signed char x_channelvoice[16]; // the voice of the latest note on each channel
+
+    // Last expression per channel, applied to new notes since MPE sends it before the note on
+    t_float x_bend[16];
+    t_float x_pressure[16];
+    t_float x_timbre[16];
+
+    t_float x_memberrange; // semitones of a full pitch bend
+    t_float x_managerrange;
+} t_mpe_voices;
+
+static void mpe_voices_output(t_mpe_voices* x, t_outlet* out, int voice, int argc, t_float a, t_float b)
+{
+    t_atom at[3];
+    SETFLOAT(at, voice + x->x_offset);
+    SETFLOAT(at + 1, a);
+    SETFLOAT(at + 2, b);
+    outlet_list(out, &s_list, argc + 1, at);
+}
+
+static void mpe_voices_unlink(t_mpe_voices* x, int voice)
+{
+    t_mpe_voice* v = x->x_voices + voice;
+    if (v->v_prev != MPE_NO_VOICE)
+        x->x_voices[v->v_prev].v_next = v->v_next;
+    else
+        x->x_oldest = v->v_next;
+
+    if (v->v_next != MPE_NO_VOICE)
+        x->x_voices[v->v_next].v_prev = v->v_prev;
+    else
+        x->x_newest = v->v_prev;
+}
+
+static void mpe_voices_release(t_mpe_voices* x, int voice)
+{
+    t_mpe_voice* v = x->x_voices + voice;
+
+    mpe_voices_output(x, x->x_note_out, voice, 2, v->v_note, 0);
+
+    x->x_lookup[v->v_channel][v->v_note] = MPE_NO_VOICE;
+    if (x->x_channelvoice[v->v_channel] == voice)
+        x->x_channelvoice[v->v_channel] = MPE_NO_VOICE;
+
+    mpe_voices_unlink(x, voice);
+    v->v_active = 0;
+    v->v_next = x->x_free;
+    x->x_free = voice;
+}
+
+static t_float mpe_voices_getbend(t_mpe_voices* x, int channel)
+{
+    // The manager channel's bend is added to every note
+    t_float bend = x->x_bend[0] * x->x_managerrange;
+    if (channel)
+        bend += x->x_bend[channel] * x->x_memberrange;
+    return bend;
+}
+
+static void mpe_voices_noteon(t_mpe_voices* x, int channel, int note, int velocity)
+{
+    int voice = x->x_lookup[channel][note];
+    t_mpe_voice* v;
+
+    // Retriggering a note that's still sounding keeps its voice
+    if (voice != MPE_NO_VOICE)
+        mpe_voices_release(x, voice);
+
+    // Without a free voice, the oldest note is stolen
+    if (x->x_free == MPE_NO_VOICE)
+        mpe_voices_release(x, x->x_oldest);
+
+    voice = x->x_free;
+    v = x->x_voices + voice;
+    x->x_free = v->v_next;
+
+    v->v_active = 1;
+    v->v_channel = channel;
+    v->v_note = note;
+    v->v_prev = x->x_newest;
+    v->v_next = MPE_NO_VOICE;
+    if (x->x_newest != MPE_NO_VOICE)
+        x->x_voices[x->x_newest].v_next = voice;
+    else
+        x->x_oldest = voice;
+    x->x_newest = voice;
+
+    x->x_lookup[channel][note] = voice;
+    x->x_channelvoice[channel] = voice;
+
+    // Right to left, so the voice has its expression before it starts
+    mpe_voices_output(x, x->x_timbre_out, voice, 1, x->x_timbre[channel], 0);
+    mpe_voices_output(x, x->x_pressure_out, voice, 1, x->x_pressure[channel], 0);
+    mpe_voices_output(x, x->x_bend_out, voice, 1, mpe_voices_getbend(x, channel), 0);
+    mpe_voices_output(x, x->x_note_out, voice, 2, note, velocity);
+}
+
+static void mpe_voices_noteoff(t_mpe_voices* x, int channel, int note)
+{
+    int voice = x->x_lookup[channel][note];
+    if (voice != MPE_NO_VOICE)
+        mpe_voices_release(x, voice);
+}
+
+// Expression on a member channel goes to its latest note
+static void mpe_voices_expression(t_mpe_voices* x, t_outlet* out, t_float* values, int channel, t_float value)
+{
+    int voice;
+    values[channel] = value;
+
+    if (channel) {
+        voice = x->x_channelvoice[channel];
+        if (voice != MPE_NO_VOICE)
+            mpe_voices_output(x, out, voice, 1, out == x->x_bend_out ? mpe_voices_getbend(x, channel) : value, 0);
+        return;
+    }
+
+    for (voice = x->x_oldest; voice != MPE_NO_VOICE; voice = x->x_voices[voice].v_next) {
+        t_mpe_voice* v = x->x_voices + voice;
+        if (out == x->x_bend_out)
+            mpe_voices_output(x, out, voice, 1, mpe_voices_getbend(x, v->v_channel), 0);
+        else if (!v->v_channel)
+            mpe_voices_output(x, out, voice, 1, value, 0);
+    }
+}
+
+static void mpe_voices_flush(t_mpe_voices* x)
+{
+    while (x->x_oldest != MPE_NO_VOICE)
+        mpe_voices_release(x, x->x_oldest);
+}
+
+static void mpe_voices_reset(t_mpe_voices* x)
+{
+    int i;
+    memset(x->x_lookup, MPE_NO_VOICE, sizeof(x->x_lookup));
+    memset(x->x_channelvoice, MPE_NO_VOICE, sizeof(x->x_channelvoice));
+
+    for (i = 0; i < 16; i++) {
+        x->x_bend[i] = 0;
+        x->x_pressure[i] = 0;
+        x->x_timbre[i] = 0.5;
+    }
+
+    for (i = 0; i < x->x_nvoices; i++) {
+        x->x_voices[i].v_active = 0;
+        x->x_voices[i].v_next = i + 1 < x->x_nvoices ? i + 1 : MPE_NO_VOICE;
+    }
+    x->x_free = 0;
+    x->x_oldest = x->x_newest = MPE_NO_VOICE;
+}
+
+// Raw midi bytes, from the host or from a list sent to the inlet
+static void mpe_voices_list(t_mpe_voices* x, t_symbol* s, int argc, t_atom* argv)
+{
+    int status = (int)atom_getfloatarg(0, argc, argv);
+    int data1 = (int)atom_getfloatarg(1, argc, argv) & 0x7f;
+    int data2 = (int)atom_getfloatarg(2, argc, argv) & 0x7f;
+    int channel = status & 0x0f;
+
+    switch (status & 0xf0) {
+    case 0x80:
+        mpe_voices_noteoff(x, channel, data1);
+        break;
+    case 0x90:
+        if (data2)
+            mpe_voices_noteon(x, channel, data1, data2);
+        else
+            mpe_voices_noteoff(x, channel, data1);
+        break;
+    case 0xa0: {
+        int voice = x->x_lookup[channel][data1];
+        if (voice != MPE_NO_VOICE)
+            mpe_voices_output(x, x->x_pressure_out, voice, 1, data2 / 127.0f, 0);
+        break;
+    }
+    case 0xb0:
+        if (data1 == 74)
+            mpe_voices_expression(x, x->x_timbre_out, x->x_timbre, channel, data2 / 127.0f);
+        else if (data1 == 123 && !channel)
+            mpe_voices_flush(x);
+        break;
+    case 0xd0:
+        mpe_voices_expression(x, x->x_pressure_out, x->x_pressure, channel, data1 / 127.0f);
+        break;
+    case 0xe0:
+        mpe_voices_expression(x, x->x_bend_out, x->x_bend, channel, ((data1 | (data2 << 7)) - 8192) / 8192.0f);
+        break;
+    }
+}
+
+static void mpe_voices_bendrange(t_mpe_voices* x, t_floatarg member, t_floatarg manager)
+{
+    x->x_memberrange = member;
+    x->x_managerrange = manager;
+}
+
+static void* mpe_voices_new(t_symbol* s, int argc, t_atom* argv)
+{
+    t_mpe_voices* x = (t_mpe_voices*)pd_new(mpe_voices_class);
+
+    x->x_offset = 0;
+    if (argc >= 2 && atom_getsymbolarg(0, argc, argv) == gensym("-s")) {
+        x->x_offset = (int)atom_getfloatarg(1, argc, argv);
+        argc -= 2;
+        argv += 2;
+    }
+
+    x->x_nvoices = (int)atom_getfloatarg(0, argc, argv);
+    if (x->x_nvoices < 1)
+        x->x_nvoices = 1;
+    if (x->x_nvoices > MPE_MAX_VOICES)
+        x->x_nvoices = MPE_MAX_VOICES;
+
+    // Ranges the MPE spec starts with
+    x->x_memberrange = 48;
+    x->x_managerrange = 2;
+
+    mpe_voices_reset(x);
+
+    x->x_note_out = outlet_new(&x->x_obj, &s_list);
+    x->x_bend_out = outlet_new(&x->x_obj, &s_list);
+    x->x_pressure_out = outlet_new(&x->x_obj, &s_list);
+    x->x_timbre_out = outlet_new(&x->x_obj, &s_list);
+
+    pd_bind(&x->x_obj.ob_pd, gensym("#libpd_mpe"));
+    return x;
+}
+
+static void mpe_voices_free(t_mpe_voices* x)
+{
+    pd_unbind(&x->x_obj.ob_pd, gensym("#libpd_mpe"));
+}
+
+void libpd_mpe_setup(void)
+{
+    mpe_voices_class = class_new(gensym("mpe.voices"), (t_newmethod)mpe_voices_new, (t_method)mpe_voices_free,
+        sizeof(t_mpe_voices), 0, A_GIMME, 0);
+    class_addlist(mpe_voices_class, mpe_voices_list);
+    class_addmethod(mpe_voices_class, (t_method)mpe_voices_flush, gensym("flush"), 0);
+    class_addmethod(mpe_voices_class, (t_method)mpe_voices_bendrange, gensym("bendrange"), A_FLOAT, A_FLOAT, 0);
+}
+
+void libpd_mpe_midi(unsigned char const* data, int size)
+{
+    t_symbol* sym = gensym("#libpd_mpe");
+    t_atom at[3];
+    int i;
+
+    // Only channel voice messages
+    if (!sym->s_thing || size < 2 || data[0] < 0x80 || data[0] >= 0xf0)
+        return;
+
+    for (i = 0; i < 3; i++)
+        SETFLOAT(at + i, i < size ? data[i] : 0);
+
+    // pd_list calls the list method directly, also through the list of bound objects
+    pd_list(sym->s_thing, &s_list, 3, at);
+}
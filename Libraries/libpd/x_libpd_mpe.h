@@ -0,0 +1,21 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Creates the [mpe.voices] class, called once by libpd_multi_init
+void libpd_mpe_setup(void);
+
+// Passes incoming midi to every [mpe.voices] in the current instance, the caller needs to hold pd's lock
+void libpd_mpe_midi(unsigned char const* data, int size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,17 @@
 #include <string.h>
 #include <assert.h>
 #include "x_libpd_multi.h"
+#include "x_libpd_compiled.h"
+#include "x_libpd_profiler.h"
+#include "x_libpd_global.h"
+#include "x_libpd_mpe.h"
+#include "x_libpd_param.h"
+#include "x_libpd_extra_utils.h"
+#include "x_libpd_mod_utils.h"
+
+#ifdef LIBPD_FFTW
+#include <fftw3.h>
+#endif
 
 
 static t_class* libpd_multi_receiver_class;
@@ -212,6 +223,248 @@ void* libpd_multi_midi_new(void* ptr,
     return x;
 }
 
+// Dispatches incoming midi at the logical time of its sample offset, instead of at the start of the tick
+// Every event gets a clock from a fixed pool, so scheduling doesn't allocate on the audio thread
+
+#define LIBPD_MULTI_MIDI_SCHEDULER_SIZE 512
+
+typedef struct _libpd_multi_midi_event {
+    t_clock* e_clock;
+    int e_active;
+    int e_port;
+    int e_size;
+    unsigned char e_data[3];
+} t_libpd_multi_midi_event;
+
+static t_class* libpd_multi_midi_scheduler_class;
+
+typedef struct _libpd_multi_midi_scheduler {
+    t_object x_obj;
+    t_libpd_multi_midi_event x_events[LIBPD_MULTI_MIDI_SCHEDULER_SIZE];
+} t_libpd_multi_midi_scheduler;
+
+// Called with the pd lock held, so we use the inmidi functions instead of the libpd ones
+void libpd_multi_midi_dispatch(int port, unsigned char const* data, int size)
+{
+    int i;
+    int const status = data[0];
+    int const channel = status & 0x0f;
+
+    libpd_mpe_midi(data, size);
+
+    if (status == 0xf0) {
+        for (i = 1; i < size && data[i] != 0xf7; i++) {
+            inmidi_sysex(port, data[i]);
+        }
+    } else if (status >= 0xf8) {
+        inmidi_realtimein(port, status);
+    } else if (size > 1) {
+        switch (status & 0xf0) {
+        case 0x80:
+            inmidi_noteon(port, channel, data[1], 0);
+            break;
+        case 0x90:
+            inmidi_noteon(port, channel, data[1], size > 2 ? data[2] : 0);
+            break;
+        case 0xa0:
+            if (size > 2)
+                inmidi_polyaftertouch(port, channel, data[1], data[2]);
+            break;
+        case 0xb0:
+            if (size > 2)
+                inmidi_controlchange(port, channel, data[1], data[2]);
+            break;
+        case 0xc0:
+            inmidi_programchange(port, channel, data[1]);
+            break;
+        case 0xd0:
+            inmidi_aftertouch(port, channel, data[1]);
+            break;
+        case 0xe0:
+            if (size > 2)
+                inmidi_pitchbend(port, channel, data[1] | (data[2] << 7));
+            break;
+        }
+    }
+
+    // The raw bytes are only needed by [midiin]
+    if (pd_this->pd_midiin_sym->s_thing) {
+        for (i = 0; i < size; i++) {
+            inmidi_byte(port, data[i]);
+        }
+    }
+}
+
+static void libpd_multi_midi_event_tick(t_libpd_multi_midi_event* e)
+{
+    libpd_multi_midi_dispatch(e->e_port, e->e_data, e->e_size);
+    e->e_active = 0;
+}
+
+static void libpd_multi_midi_scheduler_free(t_libpd_multi_midi_scheduler* x)
+{
+    int i;
+    for (i = 0; i < LIBPD_MULTI_MIDI_SCHEDULER_SIZE; i++) {
+        clock_free(x->x_events[i].e_clock);
+    }
+}
+
+static void libpd_multi_midi_scheduler_setup(void)
+{
+    sys_lock();
+    libpd_multi_midi_scheduler_class = class_new(gensym("libpd_multi_midi_scheduler"), (t_newmethod)NULL, (t_method)libpd_multi_midi_scheduler_free,
+        sizeof(t_libpd_multi_midi_scheduler), CLASS_DEFAULT, A_NULL, 0);
+    sys_unlock();
+}
+
+void* libpd_multi_midi_scheduler_new(void)
+{
+    int i;
+    t_libpd_multi_midi_scheduler* x = (t_libpd_multi_midi_scheduler*)pd_new(libpd_multi_midi_scheduler_class);
+    if (x) {
+        sys_lock();
+        for (i = 0; i < LIBPD_MULTI_MIDI_SCHEDULER_SIZE; i++) {
+            t_libpd_multi_midi_event* e = x->x_events + i;
+            e->e_active = 0;
+            e->e_clock = clock_new(e, (t_method)libpd_multi_midi_event_tick);
+            // delays are in samples
+            clock_setunit(e->e_clock, 1, 1);
+        }
+        sys_unlock();
+    }
+    return x;
+}
+
+void libpd_multi_midi_schedule(void* scheduler, int port, unsigned char const* data, int size, double delay)
+{
+    int i;
+    t_libpd_multi_midi_scheduler* x = (t_libpd_multi_midi_scheduler*)scheduler;
+
+    sys_lock();
+    // sysex doesn't fit in an event, and non-positive delays don't need one
+    if (size <= 3 && delay > 0) {
+        for (i = 0; i < LIBPD_MULTI_MIDI_SCHEDULER_SIZE; i++) {
+            t_libpd_multi_midi_event* e = x->x_events + i;
+            if (!e->e_active) {
+                e->e_active = 1;
+                e->e_port = port;
+                e->e_size = size;
+                memcpy(e->e_data, data, size);
+                clock_delay(e->e_clock, delay);
+                sys_unlock();
+                return;
+            }
+        }
+    }
+
+    // If the pool is exhausted, we fall back to sending at the start of the tick
+    libpd_multi_midi_dispatch(port, data, size);
+    sys_unlock();
+}
+
+// Same as the midi scheduler, for OSC messages that arrived with a timetag in the future
+// Messages with more atoms than fit in an event are dispatched right away
+
+#define LIBPD_MULTI_OSC_SCHEDULER_SIZE 256
+#define LIBPD_MULTI_OSC_EVENT_ATOMS 16
+
+typedef struct _libpd_multi_osc_event {
+    t_clock* e_clock;
+    int e_active;
+    t_symbol* e_address;
+    int e_argc;
+    t_atom e_argv[LIBPD_MULTI_OSC_EVENT_ATOMS];
+} t_libpd_multi_osc_event;
+
+static t_class* libpd_multi_osc_scheduler_class;
+
+typedef struct _libpd_multi_osc_scheduler {
+    t_object x_obj;
+    t_libpd_multi_osc_event x_events[LIBPD_MULTI_OSC_SCHEDULER_SIZE];
+} t_libpd_multi_osc_scheduler;
+
+void libpd_multi_osc_dispatch(t_symbol* address, int argc, t_atom* argv)
+{
+    t_symbol* all = gensym("pd~osc~in");
+
+    if (address->s_thing) {
+        if (!argc)
+            pd_bang(address->s_thing);
+        else if (argc == 1 && argv->a_type == A_FLOAT)
+            pd_float(address->s_thing, argv->a_w.w_float);
+        else if (argc == 1 && argv->a_type == A_SYMBOL)
+            pd_symbol(address->s_thing, argv->a_w.w_symbol);
+        else
+            pd_list(address->s_thing, &s_list, argc, argv);
+    }
+
+    // Everything also goes to one receiver with the address as selector, to be picked apart with [route]
+    if (all->s_thing)
+        typedmess(all->s_thing, address, argc, argv);
+}
+
+static void libpd_multi_osc_event_tick(t_libpd_multi_osc_event* e)
+{
+    e->e_active = 0;
+    libpd_multi_osc_dispatch(e->e_address, e->e_argc, e->e_argv);
+}
+
+static void libpd_multi_osc_scheduler_free(t_libpd_multi_osc_scheduler* x)
+{
+    int i;
+    for (i = 0; i < LIBPD_MULTI_OSC_SCHEDULER_SIZE; i++) {
+        clock_free(x->x_events[i].e_clock);
+    }
+}
+
+static void libpd_multi_osc_scheduler_setup(void)
+{
+    sys_lock();
+    libpd_multi_osc_scheduler_class = class_new(gensym("libpd_multi_osc_scheduler"), (t_newmethod)NULL, (t_method)libpd_multi_osc_scheduler_free,
+        sizeof(t_libpd_multi_osc_scheduler), CLASS_DEFAULT, A_NULL, 0);
+    sys_unlock();
+}
+
+void* libpd_multi_osc_scheduler_new(void)
+{
+    int i;
+    t_libpd_multi_osc_scheduler* x = (t_libpd_multi_osc_scheduler*)pd_new(libpd_multi_osc_scheduler_class);
+    if (x) {
+        sys_lock();
+        for (i = 0; i < LIBPD_MULTI_OSC_SCHEDULER_SIZE; i++) {
+            t_libpd_multi_osc_event* e = x->x_events + i;
+            e->e_active = 0;
+            e->e_clock = clock_new(e, (t_method)libpd_multi_osc_event_tick);
+            // delays are in samples
+            clock_setunit(e->e_clock, 1, 1);
+        }
+        sys_unlock();
+    }
+    return x;
+}
+
+void libpd_multi_osc_schedule(void* scheduler, t_symbol* address, int argc, t_atom* argv, double delay)
+{
+    int i;
+    t_libpd_multi_osc_scheduler* x = (t_libpd_multi_osc_scheduler*)scheduler;
+
+    if (argc <= LIBPD_MULTI_OSC_EVENT_ATOMS && delay > 0) {
+        for (i = 0; i < LIBPD_MULTI_OSC_SCHEDULER_SIZE; i++) {
+            t_libpd_multi_osc_event* e = x->x_events + i;
+            if (!e->e_active) {
+                e->e_active = 1;
+                e->e_address = address;
+                e->e_argc = argc;
+                memcpy(e->e_argv, argv, argc * sizeof(t_atom));
+                clock_delay(e->e_clock, delay);
+                return;
+            }
+        }
+    }
+
+    libpd_multi_osc_dispatch(address, argc, argv);
+}
+
 static t_class* libpd_multi_print_class;
 
 typedef struct _libpd_multi_print {
@@ -699,6 +952,7 @@ void sr_tilde_setup();
 void standard_tilde_setup();
 void status_tilde_setup();
 void stepnoise_tilde_setup();
+void setup_stream0x2efile_tilde();
 void susloop_tilde_setup();
 void suspedal_setup();
 void svfilter_tilde_setup();
@@ -737,8 +991,15 @@ void xselect_tilde_setup();
 void xselect2_tilde_setup();
 void zerocross_tilde_setup();
 
+// Classes are shared by all pd instances, new instances copy their methods from the first one
+// So the libraries only have to be set up once per process
 void libpd_init_else(void)
 {
+    static int initialized = 0;
+    if (initialized)
+        return;
+    initialized = 1;
+
     above_tilde_setup();
     add_tilde_setup();
     adsr_tilde_setup();
@@ -973,6 +1234,7 @@ void libpd_init_else(void)
     standard_tilde_setup();
     status_tilde_setup();
     stepnoise_tilde_setup();
+    setup_stream0x2efile_tilde();
     susloop_tilde_setup();
     suspedal_setup();
     svfilter_tilde_setup();
@@ -1013,6 +1275,11 @@ void libpd_init_else(void)
 
 void libpd_init_cyclone(void)
 {
+    static int initialized = 0;
+    if (initialized)
+        return;
+    initialized = 1;
+
     // cyclone objects
     cyclone_setup();
     accum_setup();
@@ -1211,6 +1478,515 @@ void libpd_init_cyclone(void)
     
 }
 
+// Lazy mode: only the cyclone library object is set up front, every other class gets set up the first time a patch creates it
+// Setup functions are looked up by the names of the classes and creators they register
+
+typedef struct _libpd_multi_lazy_class {
+    char const* c_name;
+    void (*c_setup)(void);
+} t_libpd_multi_lazy_class;
+
+static t_libpd_multi_lazy_class libpd_multi_lazy_classes[] = {
+    { "above~", above_tilde_setup },
+    { "add~", add_tilde_setup },
+    { "adsr~", adsr_tilde_setup },
+    { "allpass.2nd~", setup_allpass0x2e2nd_tilde },
+    { "allpass.rev~", setup_allpass0x2erev_tilde },
+    { "args", args_setup },
+    { "asr~", asr_tilde_setup },
+    { "autofade~", autofade_tilde_setup },
+    { "autofade2~", autofade2_tilde_setup },
+    { "balance~", balance_tilde_setup },
+    { "bandpass~", bandpass_tilde_setup },
+    { "bandstop~", bandstop_tilde_setup },
+    { "bend.in", setup_bend0x2ein },
+    { "bend.out", setup_bend0x2eout },
+    { "bl.saw~", setup_bl0x2esaw_tilde },
+    { "bl.saw2~", setup_bl0x2esaw2_tilde },
+    { "bl.imp~", setup_bl0x2eimp_tilde },
+    { "bl.imp2~", setup_bl0x2eimp2_tilde },
+    { "bl.square~", setup_bl0x2esquare_tilde },
+    { "bl.tri~", setup_bl0x2etri_tilde },
+    { "bl.vsaw~", setup_bl0x2evsaw_tilde },
+    { "bl.osc~", setup_bl0x2eosc_tilde },
+    { "bicoeff", bicoeff_setup },
+    { "bicoeff2", bicoeff2_setup },
+    { "bitnormal~", bitnormal_tilde_setup },
+    { "biquads~", biquads_tilde_setup },
+    { "blocksize~", blocksize_tilde_setup },
+    { "break", break_setup },
+    { "brown~", brown_tilde_setup },
+    { "buffer", buffer_setup },
+    { "button", button_setup },
+    { "canvas.active", setup_canvas0x2eactive },
+    { "canvas.bounds", setup_canvas0x2ebounds },
+    { "canvas.edit", setup_canvas0x2eedit },
+    { "canvas.gop", setup_canvas0x2egop },
+    { "canvas.mouse", setup_canvas0x2emouse },
+    { "canvas.name", setup_canvas0x2ename },
+    { "canvas.pos", setup_canvas0x2epos },
+    { "canvas.setname", setup_canvas0x2esetname },
+    { "canvas.vis", setup_canvas0x2evis },
+    { "canvas.zoom", setup_canvas0x2ezoom },
+    { "canvas.file", setup_canvas0x2efile },
+    { "ceil", ceil_setup },
+    { "ceil~", ceil_tilde_setup },
+    { "cents2ratio", cents2ratio_setup },
+    { "cents2ratio~", cents2ratio_tilde_setup },
+    { "chance", chance_setup },
+    { "chance~", chance_tilde_setup },
+    { "changed", changed_setup },
+    { "changed~", changed_tilde_setup },
+    { "changed2~", changed2_tilde_setup },
+    { "click", click_setup },
+    { "white~", white_tilde_setup },
+    { "cmul~", cmul_tilde_setup },
+    { "colors", colors_setup },
+    { "comb.filt~", setup_comb0x2efilt_tilde },
+    { "comb.rev~", setup_comb0x2erev_tilde },
+    { "cosine~", cosine_tilde_setup },
+    { "crackle~", crackle_tilde_setup },
+    { "crossover~", crossover_tilde_setup },
+    { "ctl.in", setup_ctl0x2ein },
+    { "ctl.out", setup_ctl0x2eout },
+    { "cusp~", cusp_tilde_setup },
+    { "datetime", datetime_setup },
+    { "db2lin~", db2lin_tilde_setup },
+    { "decay~", decay_tilde_setup },
+    { "decay2~", decay2_tilde_setup },
+    { "default", default_setup },
+    { "del~", del_tilde_setup },
+    { "else/del~", del_tilde_setup },
+    { "detect~", detect_tilde_setup },
+    { "dir", dir_setup },
+    { "dollsym", dollsym_setup },
+    { "downsample~", downsample_tilde_setup },
+    { "drive~", drive_tilde_setup },
+    { "dust~", dust_tilde_setup },
+    { "dust2~", dust2_tilde_setup },
+    { "else", else_setup },
+    { "envgen~", envgen_tilde_setup },
+    { "eq~", eq_tilde_setup },
+    { "factor", factor_setup },
+    { "fader~", fader_tilde_setup },
+    { "fbdelay~", fbdelay_tilde_setup },
+    { "fbsine~", fbsine_tilde_setup },
+    { "fbsine2~", fbsine2_tilde_setup },
+    { "f2s~", f2s_tilde_setup },
+    { "fdn.rev~", setup_fdn0x2erev_tilde },
+    { "ffdelay~", ffdelay_tilde_setup },
+    { "float2bits", float2bits_setup },
+    { "float2sig~", float2sig_tilde_setup },
+    { "floor", floor_setup },
+    { "floor~", floor_tilde_setup },
+    { "fold", fold_setup },
+    { "fold~", fold_tilde_setup },
+    { "fontsize", fontsize_setup },
+    { "format", format_setup },
+    { "freq.shift~", setup_freq0x2eshift_tilde },
+    { "function", function_setup },
+    { "function~", function_tilde_setup },
+    { "gate2imp~", gate2imp_tilde_setup },
+    { "gaussian~", gaussian_tilde_setup },
+    { "gbman~", gbman_tilde_setup },
+    { "gcd", gcd_setup },
+    { "gendyn~", gendyn_tilde_setup },
+    { "giga.rev~", setup_giga0x2erev_tilde },
+    { "glide~", glide_tilde_setup },
+    { "glide2~", glide2_tilde_setup },
+    { "gray~", gray_tilde_setup },
+    { "gui", gui_setup },
+    { "henon~", henon_tilde_setup },
+    { "highpass~", highpass_tilde_setup },
+    { "highshelf~", highshelf_tilde_setup },
+    { "hot", hot_setup },
+    { "hz2rad", hz2rad_setup },
+    { "ikeda~", ikeda_tilde_setup },
+    { "imp~", imp_tilde_setup },
+    { "imp2~", imp2_tilde_setup },
+    { "impseq~", impseq_tilde_setup },
+    { "impulse~", impulse_tilde_setup },
+    { "impulse2~", impulse2_tilde_setup },
+    { "initmess", initmess_setup },
+    { "keyboard", keyboard_setup },
+    { "lag~", lag_tilde_setup },
+    { "lag2~", lag2_tilde_setup },
+    { "lastvalue~", lastvalue_tilde_setup },
+    { "latoocarfian~", latoocarfian_tilde_setup },
+    { "lb", lb_setup },
+    { "lfnoise~", lfnoise_tilde_setup },
+    { "limit", limit_setup },
+    { "lincong~", lincong_tilde_setup },
+    { "loadbanger", loadbanger_setup },
+    { "logistic~", logistic_tilde_setup },
+    { "loop", loop_setup },
+    { "lop2~", lop2_tilde_setup },
+    { "lorenz~", lorenz_tilde_setup },
+    { "lowpass~", lowpass_tilde_setup },
+    { "lowshelf~", lowshelf_tilde_setup },
+    { "match~", match_tilde_setup },
+    { "median~", median_tilde_setup },
+    { "merge-inlet", merge_setup },
+    { "merge", merge_setup },
+    { "message", message_setup },
+    { "messbox", messbox_setup },
+    { "metronome", metronome_setup },
+    { "midi", midi_setup },
+    { "mouse", mouse_setup },
+    { "mov.avg~", setup_mov0x2eavg_tilde },
+    { "mov.rms~", setup_mov0x2erms_tilde },
+    { "mtx~", mtx_tilde_setup },
+    { "note", note_setup },
+    { "note.in", setup_note0x2ein },
+    { "note.out", setup_note0x2eout },
+    { "noteinfo", noteinfo_setup },
+    { "nyquist~", nyquist_tilde_setup },
+    { "op~", op_tilde_setup },
+    { "openfile", openfile_setup },
+    { "oscope~", oscope_tilde_setup },
+    { "pack2-inlet", pack2_setup },
+    { "pack2", pack2_setup },
+    { "pad", pad_setup },
+    { "pan2~", pan2_tilde_setup },
+    { "pan4~", pan4_tilde_setup },
+    { "panic", panic_setup },
+    { "parabolic~", parabolic_tilde_setup },
+    { "peak~", peak_tilde_setup },
+    { "pgm.in", setup_pgm0x2ein },
+    { "pgm.out", setup_pgm0x2eout },
+    { "pic", pic_setup },
+    { "pimp~", pimp_tilde_setup },
+    { "pimpmul~", pimpmul_tilde_setup },
+    { "pluck~", pluck_tilde_setup },
+    { "pmosc~", pmosc_tilde_setup },
+    { "power~", power_tilde_setup },
+    { "properties", properties_setup },
+    { "pulse~", pulse_tilde_setup },
+    { "pulsecount~", pulsecount_tilde_setup },
+    { "pulsediv~", pulsediv_tilde_setup },
+    { "quad~", quad_tilde_setup },
+    { "quantizer", quantizer_setup },
+    { "quantizer~", quantizer_tilde_setup },
+    { "rad2hz", rad2hz_setup },
+    { "ramp~", ramp_tilde_setup },
+    { "rampnoise~", rampnoise_tilde_setup },
+    { "rand.f", setup_rand0x2ef },
+    { "rand.u", setup_rand0x2eu },
+    { "rand.f~", setup_rand0x2ef_tilde },
+    { "rand.hist", setup_rand0x2ehist },
+    { "s2f~", s2f_tilde_setup },
+#if ENABLE_SFONT
+    { "sfont~", sfont_tilde_setup },
+#endif
+    { "rand.i", setup_rand0x2ei },
+    { "rand.i~", setup_rand0x2ei_tilde },
+    { "route2", route2_setup },
+    { "randpulse~", randpulse_tilde_setup },
+    { "randpulse2~", randpulse2_tilde_setup },
+    { "range~", range_tilde_setup },
+    { "ratio2cents", ratio2cents_setup },
+    { "ratio2cents~", ratio2cents_tilde_setup },
+    { "rec", rec_setup },
+    { "receiver", receiver_setup },
+    { "rescale", rescale_setup },
+    { "rescale~", rescale_tilde_setup },
+    { "resonant~", resonant_tilde_setup },
+    { "resonant2~", resonant2_tilde_setup },
+    { "retrieve", retrieve_setup },
+    { "rint", rint_setup },
+    { "rint~", rint_tilde_setup },
+    { "rms~", rms_tilde_setup },
+    { "rotate~", rotate_tilde_setup },
+    { "routeall", routeall_setup },
+    { "router", router_setup },
+    { "routetype", routetype_setup },
+    { "saw~", saw_tilde_setup },
+    { "saw2~", saw2_tilde_setup },
+    { "schmitt~", schmitt_tilde_setup },
+    { "selector", selector_setup },
+    { "separate", separate_setup },
+    { "sequencer~", sequencer_tilde_setup },
+    { "sh~", sh_tilde_setup },
+    { "shaper~", shaper_tilde_setup },
+    { "sig2float~", sig2float_tilde_setup },
+    { "sin~", sin_tilde_setup },
+    { "sine~", sine_tilde_setup },
+    { "slew~", slew_tilde_setup },
+    { "slew2~", slew2_tilde_setup },
+    { "slice", slice_setup },
+    { "sort", sort_setup },
+    { "spread", spread_setup },
+    { "spread~", spread_tilde_setup },
+    { "square~", square_tilde_setup },
+    { "sr~", sr_tilde_setup },
+    { "standard~", standard_tilde_setup },
+    { "status~", status_tilde_setup },
+    { "stepnoise~", stepnoise_tilde_setup },
+    { "stream.file~", setup_stream0x2efile_tilde },
+    { "susloop~", susloop_tilde_setup },
+    { "suspedal", suspedal_setup },
+    { "svfilter~", svfilter_tilde_setup },
+    { "symbol2any", symbol2any_setup },
+    { "tabplayer~", tabplayer_tilde_setup },
+    { "tabreader", tabreader_setup },
+    { "tabreader~", tabreader_tilde_setup },
+    { "tabwriter~", tabwriter_tilde_setup },
+    { "tempo~", tempo_tilde_setup },
+    { "timed.gate~", setup_timed0x2egate_tilde },
+    { "toggleff~", toggleff_tilde_setup },
+    { "touch.in", setup_touch0x2ein },
+    { "touch.out", setup_touch0x2eout },
+    { "tri~", tri_tilde_setup },
+    { "trig.delay~", setup_trig0x2edelay_tilde },
+    { "trig.delay2~", setup_trig0x2edelay2_tilde },
+    { "trighold~", trighold_tilde_setup },
+    { "trunc", trunc_setup },
+    { "unmerge", unmerge_setup },
+    { "voices", voices_setup },
+    { "vsaw~", vsaw_tilde_setup },
+    { "vu~", vu_tilde_setup },
+    { "wt~", wt_tilde_setup },
+    { "wavetable~", wavetable_tilde_setup },
+    { "wrap2", wrap2_setup },
+    { "wrap2~", wrap2_tilde_setup },
+    { "xfade~", xfade_tilde_setup },
+    { "xgate~", xgate_tilde_setup },
+    { "xgate2~", xgate2_tilde_setup },
+    { "xmod~", xmod_tilde_setup },
+    { "xmod2~", xmod2_tilde_setup },
+    { "xselect~", xselect_tilde_setup },
+    { "xselect2~", xselect2_tilde_setup },
+    { "zerocross~", zerocross_tilde_setup },
+    { "accum", accum_setup },
+    { "acos", acos_setup },
+    { "acosh", acosh_setup },
+    { "active", active_setup },
+    { "anal", anal_setup },
+    { "cyclone/append", append_setup },
+    { "asin", asin_setup },
+    { "asinh", asinh_setup },
+    { "atanh", atanh_setup },
+    { "atodb", atodb_setup },
+    { "bangbang", bangbang_setup },
+    { "bondo", bondo_setup },
+    { "borax", borax_setup },
+    { "bucket", bucket_setup },
+    { "buddy", buddy_setup },
+    { "capture", capture_setup },
+    { "cartopol", cartopol_setup },
+    { "cyclone/clip", clip_setup },
+    { "coll", coll_setup },
+    { "cosh", cosh_setup },
+    { "counter", counter_setup },
+    { "cycle", cycle_setup },
+    { "dbtoa", dbtoa_setup },
+    { "decide", decide_setup },
+    { "decode", decode_setup },
+    { "drunk", drunk_setup },
+    { "flush", flush_setup },
+    { "forward", forward_setup },
+    { "fromsymbol", fromsymbol_setup },
+    { "funnel", funnel_setup },
+    { "gate", gate_setup },
+    { "grab", grab_setup },
+    { "histo", histo_setup },
+    { "iter", iter_setup },
+    { "join-inlet", join_setup },
+    { "join", join_setup },
+    { "linedrive", linedrive_setup },
+    { "listfunnel", listfunnel_setup },
+    { "loadmess", loadmess_setup },
+    { "match", match_setup },
+    { "maximum", maximum_setup },
+    { "mean", mean_setup },
+    { "midiflush", midiflush_setup },
+    { "midiformat", midiformat_setup },
+    { "midiparse", midiparse_setup },
+    { "minimum", minimum_setup },
+    { "mousefilter", mousefilter_setup },
+    { "mousestate", mousestate_setup },
+    { "next", next_setup },
+    { "offer", offer_setup },
+    { "onebang", onebang_setup },
+    { "pak-inlet", pak_setup },
+    { "pak", pak_setup },
+    { "past", past_setup },
+    { "peak", peak_setup },
+    { "poltocar", poltocar_setup },
+    { "pong", pong_setup },
+    { "prepend", prepend_setup },
+    { "prob", prob_setup },
+    { "pv", pv_setup },
+    { "rdiv", rdiv_setup },
+    { "rminus", rminus_setup },
+    { "round", round_setup },
+    { "scale", scale_setup },
+    { "seq", seq_setup },
+    { "sinh", sinh_setup },
+    { "speedlim", speedlim_setup },
+    { "spell", spell_setup },
+    { "split", split_setup },
+    { "spray", spray_setup },
+    { "sprintf", sprintf_setup },
+    { "substitute", substitute_setup },
+    { "sustain", sustain_setup },
+    { "switch", switch_setup },
+    { "cyclone/table", table_setup },
+    { "Table", table_setup },
+    { "tanh", tanh_setup },
+    { "thresh", thresh_setup },
+    { "togedge", togedge_setup },
+    { "tosymbol", tosymbol_setup },
+    { "trough", trough_setup },
+    { "universal", universal_setup },
+    { "unjoin", unjoin_setup },
+    { "urn", urn_setup },
+    { "uzi", uzi_setup },
+    { "xbendin", xbendin_setup },
+    { "xbendin2", xbendin2_setup },
+    { "xbendout", xbendout_setup },
+    { "xbendout2", xbendout2_setup },
+    { "xnotein", xnotein_setup },
+    { "xnoteout", xnoteout_setup },
+    { "zl", zl_setup },
+    { "acos~", acos_tilde_setup },
+    { "acosh~", acosh_tilde_setup },
+    { "allpass~", allpass_tilde_setup },
+    { "asin~", asin_tilde_setup },
+    { "asinh~", asinh_tilde_setup },
+    { "atan~", atan_tilde_setup },
+    { "atan2~", atan2_tilde_setup },
+    { "atanh~", atanh_tilde_setup },
+    { "atodb~", atodb_tilde_setup },
+    { "average~", average_tilde_setup },
+    { "avg~", avg_tilde_setup },
+    { "bitand~", bitand_tilde_setup },
+    { "bitnot~", bitnot_tilde_setup },
+    { "bitor~", bitor_tilde_setup },
+    { "bitsafe~", bitsafe_tilde_setup },
+    { "bitshift~", bitshift_tilde_setup },
+    { "bitxor~", bitxor_tilde_setup },
+    { "buffir~", buffir_tilde_setup },
+    { "capture~", capture_tilde_setup },
+    { "cartopol~", cartopol_tilde_setup },
+    { "change~", change_tilde_setup },
+    { "click~", click_tilde_setup },
+    { "cyclone/clip~", clip_tilde_setup },
+    { "comb~", comb_tilde_setup },
+    { "comment", comment_setup },
+    { "cosh~", cosh_tilde_setup },
+    { "cosx~", cosx_tilde_setup },
+    { "count~", count_tilde_setup },
+    { "cross~", cross_tilde_setup },
+    { "curve~", curve_tilde_setup },
+    { "cycle~", cycle_tilde_setup },
+    { "dbtoa~", dbtoa_tilde_setup },
+    { "degrade~", degrade_tilde_setup },
+    { "delay~", delay_tilde_setup },
+    { "delta~", delta_tilde_setup },
+    { "deltaclip~", deltaclip_tilde_setup },
+    { "downsamp~", downsamp_tilde_setup },
+    { "edge~", edge_tilde_setup },
+    { "equals~", equals_tilde_setup },
+    { "frameaccum~", frameaccum_tilde_setup },
+    { "framedelta~", framedelta_tilde_setup },
+    { "gate~", gate_tilde_setup },
+    { "greaterthan~", greaterthan_tilde_setup },
+    { "greaterthaneq~", greaterthaneq_tilde_setup },
+    { "index~", index_tilde_setup },
+    { "kink~", kink_tilde_setup },
+    { "lessthan~", lessthan_tilde_setup },
+    { "lessthaneq~", lessthaneq_tilde_setup },
+    { "cyclone/line~", line_tilde_setup },
+    { "lookup~", lookup_tilde_setup },
+    { "lores~", lores_tilde_setup },
+    { "matrix~", matrix_tilde_setup },
+    { "maximum~", maximum_tilde_setup },
+    { "minimum~", minimum_tilde_setup },
+    { "minmax~", minmax_tilde_setup },
+    { "modulo~", modulo_tilde_setup },
+    { "mstosamps~", mstosamps_tilde_setup },
+    { "notequals~", notequals_tilde_setup },
+    { "numbox~", numbox_tilde_setup },
+    { "onepole~", onepole_tilde_setup },
+    { "overdrive~", overdrive_tilde_setup },
+    { "peakamp~", peakamp_tilde_setup },
+    { "peek~", peek_tilde_setup },
+    { "phaseshift~", phaseshift_tilde_setup },
+    { "phasewrap~", phasewrap_tilde_setup },
+    { "pink~", pink_tilde_setup },
+    { "play~", play_tilde_setup },
+    { "plusequals~", plusequals_tilde_setup },
+    { "poke~", poke_tilde_setup },
+    { "poltocar~", poltocar_tilde_setup },
+    { "pong~", pong_tilde_setup },
+    { "Pow~", pow_tilde_setup },
+    { "cyclone/pow~", pow_tilde_setup },
+    { "cyclone/Pow~", pow_tilde_setup },
+    { "rampsmooth~", rampsmooth_tilde_setup },
+    { "rand~", rand_tilde_setup },
+    { "rdiv~", rdiv_tilde_setup },
+    { "record~", record_tilde_setup },
+    { "reson~", reson_tilde_setup },
+    { "rminus~", rminus_tilde_setup },
+    { "round~", round_tilde_setup },
+    { "sah~", sah_tilde_setup },
+    { "sampstoms~", sampstoms_tilde_setup },
+    { "scale~", scale_tilde_setup },
+    { "scope~", scope_tilde_setup },
+    { "selector~", selector_tilde_setup },
+    { "sinh~", sinh_tilde_setup },
+    { "sinx~", sinx_tilde_setup },
+    { "slide~", slide_tilde_setup },
+    { "cyclone/snapshot~", snapshot_tilde_setup },
+    { "spike~", spike_tilde_setup },
+    { "svf~", svf_tilde_setup },
+    { "tanh~", tanh_tilde_setup },
+    { "tanx~", tanx_tilde_setup },
+    { "teeth~", teeth_tilde_setup },
+    { "thresh~", thresh_tilde_setup },
+    { "train~", train_tilde_setup },
+    { "trapezoid~", trapezoid_tilde_setup },
+    { "triangle~", triangle_tilde_setup },
+    { "trunc~", trunc_tilde_setup },
+    { "typeroute~", typeroute_tilde_setup },
+    { "vectral~", vectral_tilde_setup },
+    { "wave~", wave_tilde_setup },
+    { "zerox~", zerox_tilde_setup },
+};
+
+static int libpd_multi_lazy_loader(t_canvas* canvas, char const* classname, char const* path)
+{
+    size_t i, j;
+    size_t const size = sizeof(libpd_multi_lazy_classes) / sizeof(*libpd_multi_lazy_classes);
+
+    for (i = 0; i < size; i++) {
+        void (*setup)(void) = libpd_multi_lazy_classes[i].c_setup;
+        if (setup && !strcmp(libpd_multi_lazy_classes[i].c_name, classname)) {
+            setup();
+
+            // A setup function can register multiple names, it should only run once
+            for (j = 0; j < size; j++) {
+                if (libpd_multi_lazy_classes[j].c_setup == setup)
+                    libpd_multi_lazy_classes[j].c_setup = NULL;
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void libpd_init_libraries_lazy(void)
+{
+    static int initialized = 0;
+    if (initialized)
+        return;
+    initialized = 1;
+
+    cyclone_setup();
+    sys_register_loader(libpd_multi_lazy_loader);
+}
+
 void libpd_multi_init(void)
 {
     static int initialized = 0;
@@ -1227,9 +2003,30 @@ void libpd_multi_init(void)
         libpd_set_verbose(0);
         libpd_init();
 
+#ifdef LIBPD_FFTW
+        // The plans are shared, but instances on different threads may build their dsp chain at the same time
+#if PD_FLOATSIZE == 32
+        fftwf_make_planner_thread_safe();
+#else
+        fftw_make_planner_thread_safe();
+#endif
+#endif
+
         libpd_multi_receiver_setup();
         libpd_multi_midi_setup();
+        libpd_multi_midi_scheduler_setup();
+        libpd_multi_osc_scheduler_setup();
         libpd_multi_print_setup();
+        libpd_compiled_setup();
+        libpd_profiler_setup();
+        libpd_patchcache_setup();
+        libpd_pathcache_setup();
+        libpd_dspupdate_setup();
+        libpd_deferfree_setup();
+        libpd_declick_setup();
+        libpd_global_setup();
+        libpd_mpe_setup();
+        libpd_param_setup();
         libpd_defaultfont_init();
         libpd_set_verbose(4);
 
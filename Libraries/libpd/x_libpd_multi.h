@@ -16,6 +16,9 @@ void libpd_multi_init(void);
 void libpd_init_else(void);
 void libpd_init_cyclone(void);
 
+// sets up ELSE and cyclone classes on demand, when an object can't be created
+void libpd_init_libraries_lazy(void);
+
 typedef void (*t_libpd_multi_banghook)(void* ptr, char const* recv);
 typedef void (*t_libpd_multi_floathook)(void* ptr, char const* recv, float f);
 typedef void (*t_libpd_multi_symbolhook)(void* ptr, char const* recv, char const* s);
@@ -46,6 +49,20 @@ void* libpd_multi_midi_new(void* ptr,
     t_libpd_multi_polyaftertouchhook hook_polyaftertouch,
     t_libpd_multi_midibytehook hook_midibyte);
 
+// schedules a midi message to be received by pd after delay samples of logical time
+// messages longer than 3 bytes are received immediately
+void* libpd_multi_midi_scheduler_new(void);
+void libpd_multi_midi_schedule(void* scheduler, int port, unsigned char const* data, int size, double delay);
+
+// sends a midi message to pd right away, the caller needs to hold the pd lock
+void libpd_multi_midi_dispatch(int port, unsigned char const* data, int size);
+
+// schedules an OSC message to be received by pd after delay samples of logical time, the caller needs to hold the pd lock
+// the arguments go to [r <address>], and to [r pd~osc~in] with the address as selector
+void* libpd_multi_osc_scheduler_new(void);
+void libpd_multi_osc_schedule(void* scheduler, t_symbol* address, int argc, t_atom* argv, double delay);
+void libpd_multi_osc_dispatch(t_symbol* address, int argc, t_atom* argv);
+
 typedef void (*t_libpd_multi_printhook)(void* ptr, char const* recv);
 
 void* libpd_multi_print_new(void* ptr, t_libpd_multi_printhook hook_print);
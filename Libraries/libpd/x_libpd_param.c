@@ -0,0 +1,164 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <m_pd.h>
+
+#include "x_libpd_param.h"
+
+// [param~ <n>] outputs automation parameter n as a signal
+// The host only tells us the value a parameter has at the start of its audio block, so instead of jumping to it at the next tick
+// like [r param<n>] does, the signal moves there in a straight line over the length of that block
+
+static t_class* param_tilde_class;
+static t_class* libpd_param_values_class;
+
+typedef struct _param_tilde {
+    t_object x_obj;
+    int x_index;
+    t_float x_value;
+    t_float x_target;
+    t_float x_increment;
+    int x_remaining;
+} t_param_tilde;
+
+// The last value of every parameter, so a new [param~] starts where the others are
+// Bound to a symbol, so every instance has its own
+typedef struct _libpd_param_values {
+    t_pd v_pd;
+    t_float v_values[LIBPD_PARAM_MAX];
+} t_libpd_param_values;
+
+static t_libpd_param_values* libpd_param_getvalues(int create)
+{
+    t_libpd_param_values* x = (t_libpd_param_values*)gensym("#libpd_param")->s_thing;
+    int i;
+
+    if (!x && create) {
+        x = (t_libpd_param_values*)pd_new(libpd_param_values_class);
+        for (i = 0; i < LIBPD_PARAM_MAX; i++)
+            x->v_values[i] = 0;
+        pd_bind(&x->v_pd, gensym("#libpd_param"));
+    }
+    return x;
+}
+
+static t_int* param_tilde_perform(t_int* w)
+{
+    t_param_tilde* x = (t_param_tilde*)(w[1]);
+    t_sample* out = (t_sample*)(w[2]);
+    int n = (int)(w[3]), i;
+
+    if (!x->x_remaining) {
+        for (i = 0; i < n; i++)
+            out[i] = x->x_value;
+        return (w + 4);
+    }
+
+    for (i = 0; i < n; i++) {
+        if (x->x_remaining) {
+            // Lands on the target exactly, instead of on the sum of the increments
+            x->x_value = --x->x_remaining ? x->x_value + x->x_increment : x->x_target;
+        }
+        out[i] = x->x_value;
+    }
+    return (w + 4);
+}
+
+static void param_tilde_dsp(t_param_tilde* x, t_signal** sp)
+{
+    dsp_add(param_tilde_perform, 3, x, sp[0]->s_vec, (t_int)sp[0]->s_n);
+}
+
+// Sent to every [param~] by libpd_param_ramp, as "<index> <value> <samples>"
+static void param_tilde_ramp(t_param_tilde* x, t_floatarg index, t_floatarg value, t_floatarg samples)
+{
+    if ((int)index != x->x_index)
+        return;
+
+    if (samples < 1) {
+        x->x_value = x->x_target = value;
+        x->x_remaining = 0;
+        return;
+    }
+
+    x->x_target = value;
+    x->x_remaining = (int)samples;
+    x->x_increment = (value - x->x_value) / (t_float)x->x_remaining;
+}
+
+static void param_tilde_set(t_param_tilde* x, t_floatarg f)
+{
+    t_libpd_param_values* values = libpd_param_getvalues(0);
+    int index = (int)f - 1;
+
+    if (index < 0 || index >= LIBPD_PARAM_MAX) {
+        pd_error(x, "param~: parameter %d doesn't exist", (int)f);
+        return;
+    }
+
+    x->x_index = index;
+    x->x_value = x->x_target = values ? values->v_values[index] : 0;
+    x->x_remaining = 0;
+}
+
+static void* param_tilde_new(t_floatarg f)
+{
+    t_param_tilde* x = (t_param_tilde*)pd_new(param_tilde_class);
+    x->x_index = 0;
+    x->x_value = x->x_target = x->x_increment = 0;
+    x->x_remaining = 0;
+    param_tilde_set(x, f < 1 ? 1 : f);
+
+    outlet_new(&x->x_obj, &s_signal);
+    pd_bind(&x->x_obj.ob_pd, gensym("#libpd_param~"));
+    return x;
+}
+
+static void param_tilde_free(t_param_tilde* x)
+{
+    pd_unbind(&x->x_obj.ob_pd, gensym("#libpd_param~"));
+}
+
+void libpd_param_setup(void)
+{
+    param_tilde_class = class_new(gensym("param~"), (t_newmethod)param_tilde_new, (t_method)param_tilde_free,
+        sizeof(t_param_tilde), 0, A_DEFFLOAT, 0);
+    class_addmethod(param_tilde_class, (t_method)param_tilde_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(param_tilde_class, (t_method)param_tilde_ramp, gensym("ramp"), A_FLOAT, A_FLOAT, A_FLOAT, 0);
+    class_addmethod(param_tilde_class, (t_method)param_tilde_set, gensym("set"), A_FLOAT, 0);
+
+    libpd_param_values_class = class_new(gensym("libpd_param_values"), (t_newmethod)NULL, (t_method)NULL,
+        sizeof(t_libpd_param_values), CLASS_PD, A_NULL, 0);
+}
+
+void libpd_param_ramp(int index, t_float value, int nsamples)
+{
+    t_symbol* sym = gensym("#libpd_param~");
+    t_atom at[3];
+
+    if (index < 0 || index >= LIBPD_PARAM_MAX)
+        return;
+
+    libpd_param_getvalues(1)->v_values[index] = value;
+
+    if (!sym->s_thing)
+        return;
+
+    SETFLOAT(at, index);
+    SETFLOAT(at + 1, value);
+    SETFLOAT(at + 2, nsamples);
+    pd_typedmess(sym->s_thing, gensym("ramp"), 3, at);
+}
+
+void libpd_param_free(void)
+{
+    t_libpd_param_values* x = libpd_param_getvalues(0);
+    if (!x)
+        return;
+
+    pd_unbind(&x->v_pd, gensym("#libpd_param"));
+    pd_free(&x->v_pd);
+}
@@ -0,0 +1,29 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <m_pd.h>
+
+#define LIBPD_PARAM_MAX 512
+
+// Creates the [param~] class, called once by libpd_multi_init
+void libpd_param_setup(void);
+
+// Moves every [param~] of a parameter to a new value in nsamples, index starts at 0
+// The caller needs to hold pd's lock
+void libpd_param_ramp(int index, t_float value, int nsamples);
+
+// Frees the last values of the current instance
+void libpd_param_free(void);
+
+#ifdef __cplusplus
+}
+#endif
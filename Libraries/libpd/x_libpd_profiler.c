@@ -0,0 +1,341 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <m_pd.h>
+#include <m_imp.h>
+#include <g_canvas.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+#include "x_libpd_profiler.h"
+
+typedef void (*t_libpd_profiler_dsp)(t_object* x, t_signal** sp);
+
+// The counters of one object, only the audio thread touches them while the chain runs
+typedef struct _libpd_profiler_entry {
+    t_object* e_object;
+    t_class* e_class;
+    uint64_t e_start;
+    uint64_t e_elapsed;
+    int e_ticks;
+    uint64_t e_total; // elapsed and ticks since the profiler was started, collecting doesn't reset these
+    uint64_t e_totalticks;
+    struct _libpd_profiler_entry* e_parent;
+    int e_order;
+    int e_generation;
+    int e_blocksize;
+    t_float e_samplerate;
+    struct _libpd_profiler_entry* e_next;
+} t_libpd_profiler_entry;
+
+// Bound to a symbol while the profiler runs, symbols belong to one instance
+typedef struct _libpd_profiler_list {
+    t_pd l_pd;
+    t_libpd_profiler_entry* l_first;
+    t_libpd_profiler_entry* l_current; // the subpatch or clone whose dsp method is running
+    int l_order;
+    int l_generation;
+} t_libpd_profiler_list;
+
+// Original dsp methods of the classes that got a timer, classes are shared by all instances
+typedef struct _libpd_profiler_method {
+    t_class* m_class;
+    t_libpd_profiler_dsp m_dsp;
+} t_libpd_profiler_method;
+
+static t_class* libpd_profiler_list_class;
+static t_libpd_profiler_method* libpd_profiler_methods;
+static int libpd_profiler_nmethods;
+
+static uint64_t libpd_profiler_now(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)counter.QuadPart;
+#elif defined(__APPLE__)
+    return mach_absolute_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static double libpd_profiler_toseconds(uint64_t elapsed)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (double)elapsed / (double)frequency.QuadPart;
+#elif defined(__APPLE__)
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    return (double)elapsed * timebase.numer / timebase.denom * 1e-9;
+#else
+    return (double)elapsed * 1e-9;
+#endif
+}
+
+static t_libpd_profiler_list* libpd_profiler_getlist(void)
+{
+    return (t_libpd_profiler_list*)gensym("#libpd_profiler")->s_thing;
+}
+
+static t_libpd_profiler_dsp libpd_profiler_findmethod(t_class* c)
+{
+    int i;
+    for (i = 0; i < libpd_profiler_nmethods; i++) {
+        if (libpd_profiler_methods[i].m_class == c)
+            return libpd_profiler_methods[i].m_dsp;
+    }
+    return NULL;
+}
+
+static t_libpd_profiler_entry* libpd_profiler_getentry(t_libpd_profiler_list* list, t_object* obj)
+{
+    t_libpd_profiler_entry* e;
+    for (e = list->l_first; e; e = e->e_next) {
+        if (e->e_object == obj) {
+            // A new object got the memory of a deleted one
+            if (e->e_class != pd_class(&obj->ob_pd)) {
+                e->e_class = pd_class(&obj->ob_pd);
+                e->e_elapsed = 0;
+                e->e_ticks = 0;
+                e->e_total = 0;
+                e->e_totalticks = 0;
+            }
+            return e;
+        }
+    }
+
+    e = (t_libpd_profiler_entry*)getbytes(sizeof(t_libpd_profiler_entry));
+    memset(e, 0, sizeof(t_libpd_profiler_entry));
+    e->e_object = obj;
+    e->e_class = pd_class(&obj->ob_pd);
+    e->e_next = list->l_first;
+    list->l_first = e;
+    return e;
+}
+
+static t_int* libpd_profiler_begin(t_int* w)
+{
+    t_libpd_profiler_entry* e = (t_libpd_profiler_entry*)(w[1]);
+    e->e_start = libpd_profiler_now();
+    return (w + 2);
+}
+
+static t_int* libpd_profiler_end(t_int* w)
+{
+    t_libpd_profiler_entry* e = (t_libpd_profiler_entry*)(w[1]);
+    e->e_elapsed += libpd_profiler_now() - e->e_start;
+    e->e_ticks++;
+    return (w + 2);
+}
+
+// Takes the place of the dsp method of every timed class, the object's perform routines end up between the two timer routines
+static void libpd_profiler_dsp(t_object* x, t_signal** sp)
+{
+    t_libpd_profiler_dsp dsp = libpd_profiler_findmethod(pd_class(&x->ob_pd));
+    t_libpd_profiler_list* list = libpd_profiler_getlist();
+    t_libpd_profiler_entry* e;
+
+    if (!dsp)
+        return;
+
+    if (!list) {
+        dsp(x, sp);
+        return;
+    }
+
+    e = libpd_profiler_getentry(list, x);
+    e->e_parent = list->l_current;
+    e->e_order = list->l_order++;
+    e->e_generation = list->l_generation;
+
+    // Objects without signal iolets don't get any signals to read the block size from
+    if (obj_nsiginlets(x) + obj_nsigoutlets(x) > 0 && sp && sp[0]) {
+        e->e_blocksize = sp[0]->s_n;
+        e->e_samplerate = sp[0]->s_sr;
+    } else {
+        e->e_blocksize = 0;
+        e->e_samplerate = 0;
+    }
+
+    dsp_add(libpd_profiler_begin, 1, e);
+    list->l_current = e;
+    dsp(x, sp);
+    list->l_current = e->e_parent;
+    dsp_add(libpd_profiler_end, 1, e);
+}
+
+static void libpd_profiler_hookclass(t_class* c, t_libpd_profiler_dsp dsp)
+{
+    if (libpd_profiler_findmethod(c))
+        return;
+
+    libpd_profiler_methods = (t_libpd_profiler_method*)resizebytes(libpd_profiler_methods,
+        libpd_profiler_nmethods * sizeof(t_libpd_profiler_method),
+        (libpd_profiler_nmethods + 1) * sizeof(t_libpd_profiler_method));
+    libpd_profiler_methods[libpd_profiler_nmethods].m_class = c;
+    libpd_profiler_methods[libpd_profiler_nmethods].m_dsp = dsp;
+    libpd_profiler_nmethods++;
+
+    // The hook stays after stopping, it only adds the timers while the profiler runs
+    class_addmethod(c, (t_method)libpd_profiler_dsp, gensym("dsp"), A_CANT, 0);
+}
+
+// The time of a subpatch or clone includes the objects inside it, those are timed on their own too
+static void libpd_profiler_hookcanvas(t_canvas* cnv)
+{
+    t_gobj* y;
+    for (y = cnv->gl_list; y; y = y->g_next) {
+        t_object* obj;
+        t_libpd_profiler_dsp dsp;
+
+        // Subpatches get a timer as well, so we know which objects are inside them
+        if (pd_class(&y->g_pd) == canvas_class)
+            libpd_profiler_hookcanvas((t_canvas*)y);
+
+        if (!(obj = pd_checkobject(&y->g_pd)))
+            continue;
+
+        dsp = (t_libpd_profiler_dsp)zgetfn(&y->g_pd, gensym("dsp"));
+        if (dsp && dsp != (t_libpd_profiler_dsp)libpd_profiler_dsp)
+            libpd_profiler_hookclass(pd_class(&y->g_pd), dsp);
+    }
+}
+
+static void libpd_profiler_freelist(t_libpd_profiler_list* list)
+{
+    t_libpd_profiler_entry* e = list->l_first;
+    while (e) {
+        t_libpd_profiler_entry* next = e->e_next;
+        freebytes(e, sizeof(t_libpd_profiler_entry));
+        e = next;
+    }
+    pd_free(&list->l_pd);
+}
+
+void libpd_profiler_setup(void)
+{
+    libpd_profiler_list_class = class_new(gensym("libpd_profiler_list"), (t_newmethod)NULL, (t_method)NULL,
+        sizeof(t_libpd_profiler_list), CLASS_PD, A_NULL, 0);
+}
+
+void libpd_profiler_start(void)
+{
+    t_canvas* cnv;
+
+    if (!libpd_profiler_getlist()) {
+        t_libpd_profiler_list* list = (t_libpd_profiler_list*)pd_new(libpd_profiler_list_class);
+        list->l_first = NULL;
+        list->l_current = NULL;
+        list->l_order = 0;
+        list->l_generation = 0;
+        pd_bind(&list->l_pd, gensym("#libpd_profiler"));
+    }
+
+    for (cnv = pd_getcanvaslist(); cnv; cnv = cnv->gl_next)
+        libpd_profiler_hookcanvas(cnv);
+
+    canvas_update_dsp();
+}
+
+void libpd_profiler_stop(void)
+{
+    t_libpd_profiler_list* list = libpd_profiler_getlist();
+    if (!list)
+        return;
+
+    pd_unbind(&list->l_pd, gensym("#libpd_profiler"));
+
+    // Rebuild the chain before freeing, so no timer routine points to the counters anymore
+    canvas_update_dsp();
+    libpd_profiler_freelist(list);
+}
+
+int libpd_profiler_isrunning(void)
+{
+    return libpd_profiler_getlist() != NULL;
+}
+
+void libpd_profiler_collect(void* userdata, t_libpd_profiler_callback callback)
+{
+    t_libpd_profiler_list* list = libpd_profiler_getlist();
+    t_libpd_profiler_entry* e;
+
+    if (!list)
+        return;
+
+    for (e = list->l_first; e; e = e->e_next) {
+        if (e->e_ticks)
+            callback(userdata, e->e_object, libpd_profiler_toseconds(e->e_elapsed), e->e_ticks);
+        e->e_total += e->e_elapsed;
+        e->e_totalticks += e->e_ticks;
+        e->e_elapsed = 0;
+        e->e_ticks = 0;
+    }
+}
+
+static int libpd_profiler_compareorder(void const* a, void const* b)
+{
+    return (*(t_libpd_profiler_entry* const*)a)->e_order - (*(t_libpd_profiler_entry* const*)b)->e_order;
+}
+
+void libpd_profiler_getchain(void* userdata, t_libpd_profiler_chaincallback callback)
+{
+    t_libpd_profiler_list* list = libpd_profiler_getlist();
+    t_libpd_profiler_entry** sorted;
+    t_libpd_profiler_entry* e;
+    int count = 0, i;
+
+    if (!list)
+        return;
+
+    // Entries of deleted objects stay in the list, only the ones the new chain touches are reported
+    list->l_generation++;
+    list->l_order = 0;
+    list->l_current = NULL;
+    canvas_update_dsp();
+
+    for (e = list->l_first; e; e = e->e_next) {
+        if (e->e_generation == list->l_generation)
+            count++;
+    }
+
+    if (!count)
+        return;
+
+    sorted = (t_libpd_profiler_entry**)getbytes(count * sizeof(t_libpd_profiler_entry*));
+    for (e = list->l_first, i = 0; e; e = e->e_next) {
+        if (e->e_generation == list->l_generation)
+            sorted[i++] = e;
+    }
+    qsort(sorted, count, sizeof(t_libpd_profiler_entry*), libpd_profiler_compareorder);
+
+    for (i = 0; i < count; i++) {
+        uint64_t elapsed, ticks;
+        e = sorted[i];
+        elapsed = e->e_total + e->e_elapsed;
+        ticks = e->e_totalticks + e->e_ticks;
+
+        callback(userdata, e->e_object, e->e_parent ? e->e_parent->e_object : NULL, e->e_order, e->e_blocksize, e->e_samplerate,
+            ticks ? libpd_profiler_toseconds(elapsed) / (double)ticks : 0.0);
+    }
+
+    freebytes(sorted, count * sizeof(t_libpd_profiler_entry*));
+}
@@ -0,0 +1,48 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <m_pd.h>
+
+// Called for every timed object, with the time its perform routines took and the number of dsp ticks since the last collect
+typedef void (*t_libpd_profiler_callback)(void* userdata, t_object* obj, double seconds, int ticks);
+
+// Called for every object in the dsp chain, in the order pd sorted them
+// parent is the subpatch or clone whose dsp method added the object, or NULL for objects in a toplevel patch
+// blocksize and samplerate are 0 for objects without signal inlets or outlets
+// meanseconds is the average time per dsp tick since the profiler was started
+typedef void (*t_libpd_profiler_chaincallback)(void* userdata, t_object* obj, t_object* parent, int order, int blocksize, t_float samplerate, double meanseconds);
+
+// Creates the profiler's classes, called once by libpd_multi_init
+void libpd_profiler_setup(void);
+
+// Starts timing the perform routines of every object in the current instance, the dsp chain is rebuilt with a timer around each object
+// Classes of objects created after this are timed once the profiler is started again
+// The caller needs to hold pd's lock
+void libpd_profiler_start(void);
+
+// Rebuilds the dsp chain without timers and frees the counters
+void libpd_profiler_stop(void);
+
+int libpd_profiler_isrunning(void);
+
+// Reports the time spent in each object since the last collect and resets the counters
+// The caller needs to hold pd's lock, so the audio thread isn't writing to them in the meantime
+void libpd_profiler_collect(void* userdata, t_libpd_profiler_callback callback);
+
+// Rebuilds the dsp chain and reports every object in it, the profiler needs to be running
+// Subpatches and clones are reported as well, before the objects inside them
+// The caller needs to hold pd's lock
+void libpd_profiler_getchain(void* userdata, t_libpd_profiler_chaincallback callback);
+
+#ifdef __cplusplus
+}
+#endif
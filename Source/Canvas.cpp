@@ -9,6 +9,7 @@ extern "C"
 {
 #include <m_pd.h>
 #include <m_imp.h>
+#include "x_libpd_extra_utils.h"
 }
 
 #include "Object.h"
@@ -18,9 +19,36 @@ extern "C"
 #include "LookAndFeel.h"
 
 #include "Utility/GraphArea.h"
+#include "Utility/Minimap.h"
 #include "Utility/SuggestionComponent.h"
+#include "Utility/Tracer.h"
+#include "Utility/PaintProfiler.h"
 
-Canvas::Canvas(PlugDataPluginEditor& parent, pd::Patch& p, Component* parentGraph) : main(parent), pd(&parent.pd), patch(p), storage(patch.getPointer(), pd)
+// Viewport that tells the canvas when the visible area changes, so it can hide what's out of view
+class CanvasViewport : public Viewport
+{
+   public:
+    explicit CanvasViewport(Canvas* parent) : cnv(parent)
+    {
+    }
+
+    void visibleAreaChanged(Rectangle<int> const& newVisibleArea) override
+    {
+        cnv->updateCulling();
+        if (cnv->minimap) cnv->minimap->visibleAreaChanged();
+    }
+
+    void resized() override
+    {
+        Viewport::resized();
+        if (cnv->minimap) cnv->minimap->visibleAreaChanged();
+    }
+
+   private:
+    Canvas* cnv;
+};
+
+Canvas::Canvas(PlugDataPluginEditor& parent, pd::Patch& p, Component* parentGraph, bool deferLoading) : main(parent), pd(&parent.pd), patch(p), storage(patch.getPointer(), pd)
 {
     isGraphChild = glist_isgraph(p.getPointer());
     hideNameAndArgs = static_cast<bool>(p.getPointer()->gl_hidetext);
@@ -73,9 +101,12 @@ Canvas::Canvas(PlugDataPluginEditor& parent, pd::Patch& p, Component* parentGrap
 
     if (!isGraph)
     {
-        viewport = new Viewport;  // Owned by the tabbar, but doesn't exist for graph!
+        viewport = new CanvasViewport(this);  // Owned by the tabbar, but doesn't exist for graph!
         viewport->setViewedComponent(this, false);
 
+        minimap = new Minimap(this, viewport);
+        viewport->addChildComponent(minimap);
+
         presentationMode.referTo(parent.statusbar.presentationMode);
         presentationMode.addListener(this);
     }
@@ -84,10 +115,15 @@ Canvas::Canvas(PlugDataPluginEditor& parent, pd::Patch& p, Component* parentGrap
         presentationMode = false;
     }
 
-    synchronise();
-    
+    auto numObjects = patch.getObjects().size();
+
+    if (isGraph || !deferLoading)
+    {
+        loadIfNeeded();
+    }
+
     // Start in unlocked mode if the patch is empty
-    if(objects.isEmpty()) {
+    if(numObjects == 0) {
         locked = false;
         patch.getPointer()->gl_edit = false;
     }
@@ -98,9 +134,103 @@ Canvas::Canvas(PlugDataPluginEditor& parent, pd::Patch& p, Component* parentGrap
     locked.addListener(this);
 }
 
+bool Canvas::loadIfNeeded()
+{
+    if (isLoaded) return false;
+    isLoaded = true;
+
+    // Pd already runs the patch, so large patches can be built over several message loop iterations
+    if (!isGraph && patch.getObjects().size() > progressiveLoadThreshold)
+    {
+        synchroniseProgressively();
+    }
+    else
+    {
+        synchronise();
+    }
+
+    return true;
+}
+
+void Canvas::updateColours()
+{
+    if (themeVersion == PlugDataLook::themeVersion) return;
+    themeVersion = PlugDataLook::themeVersion;
+
+    repaint();
+    for (auto* connection : connections) connection->repaint();
+
+    objectsToRecolour.clear();
+    for (auto* object : objects) objectsToRecolour.emplace_back(object);
+    numObjectsRecoloured = 0;
+
+    // Objects in view first, the ones that are culled only paint once they get into view anyway
+    std::stable_partition(objectsToRecolour.begin(), objectsToRecolour.end(), [](SafePointer<Object> const& object) { return !object->culled; });
+
+    updateNextColours();
+}
+
+void Canvas::updateNextColours()
+{
+    auto end = std::min(numObjectsRecoloured + objectsPerSlice, objectsToRecolour.size());
+    for (; numObjectsRecoloured < end; numObjectsRecoloured++)
+    {
+        auto* object = objectsToRecolour[numObjectsRecoloured].getComponent();
+        if (!object || !object->gui) continue;
+
+        // Some objects with setBufferedToImage need manual repainting
+        object->gui->repaint();
+
+        // Make sure label colour gets updated
+        if (auto* gui = dynamic_cast<GUIObject*>(object->gui.get()))
+        {
+            gui->updateLabel();
+        }
+
+        // Graphs are cached into an image, which gets drawn again as part of this slice
+        if (auto* graph = object->gui->getCanvas()) graph->updateColours();
+    }
+
+    if (numObjectsRecoloured < objectsToRecolour.size())
+    {
+        MessageManager::callAsync([_this = SafePointer(this)]()
+            {
+                if (_this) _this->updateNextColours();
+            });
+    }
+    else
+    {
+        objectsToRecolour.clear();
+    }
+}
+
+void Canvas::unload()
+{
+    if (!isLoaded || isGraph) return;
+
+    hideAllActiveEditors();
+    connectingEdges.clear();
+    selectedComponents.deselectAll();
+
+    // Skips the selection updates that every deleted object and connection would do otherwise
+    isBeingDeleted = true;
+    isUnloading = true;
+    connections.clear();
+    objects.clear();
+    isUnloading = false;
+    isBeingDeleted = false;
+
+    pendingValueUpdates.clear();
+    isLoading = false;
+    objectsToLoad.clear();
+    numObjectsLoaded = 0;
+    isLoaded = false;
+}
+
 Canvas::~Canvas()
 {
     isBeingDeleted = true;
+    delete minimap;
     delete graphArea;
     delete suggestor;
 }
@@ -108,6 +238,7 @@ Canvas::~Canvas()
 
 void Canvas::paint(Graphics& g)
 {
+    PaintProfiler::getInstance().beginPaint(this);
 
     if (!isGraph)
     {
@@ -129,33 +260,244 @@ void Canvas::paint(Graphics& g)
         int const objectGridSize = 25;
         Rectangle<int> const clipBounds = g.getClipBounds();
 
-        g.setColour(findColour(PlugDataColour::canvasDotsColourId));
+        auto const dotColour = findColour(PlugDataColour::canvasDotsColourId);
+        auto const scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+        // The grid is drawn by tiling a single cell, which only needs to be rendered again when zoom or colours change
+        if (gridTile.isNull() || gridTileScale != scale || gridTileColour != dotColour)
+        {
+            auto const tileSize = std::max(1, roundToInt(objectGridSize * scale));
+            auto const dotSize = std::max(1, roundToInt(scale));
+
+            gridTile = Image(Image::ARGB, tileSize, tileSize, true);
+            Graphics tile(gridTile);
+            tile.setColour(dotColour);
+            tile.fillRect(0, 0, dotSize, dotSize);
+
+            gridTileScale = scale;
+            gridTileColour = dotColour;
+        }
+
+        auto const tileScale = static_cast<float>(objectGridSize) / static_cast<float>(gridTile.getWidth());
+
+        // The first dot is one grid step away from the origin
+        auto const gridArea = Rectangle<int>::leftTopRightBottom(canvasOrigin.x + objectGridSize, canvasOrigin.y + objectGridSize, clipBounds.getRight(), clipBounds.getBottom()).getIntersection(clipBounds);
+
+        g.setImageResamplingQuality(Graphics::lowResamplingQuality);
+        g.setFillType(FillType(gridTile, AffineTransform::scale(tileScale).translated(canvasOrigin.toFloat())));
+        g.fillRect(gridArea);
+    }
+}
+
+// Creates the objects in slices, starting with the ones that are visible
+// Connections are only made once all objects exist, by a regular synchronise
+void Canvas::synchroniseProgressively()
+{
+    objectsToLoad = patch.getObjects();
+    numObjectsLoaded = 0;
+
+    auto visibleArea = main.getLocalBounds();
+    std::stable_partition(objectsToLoad.begin(), objectsToLoad.end(), [this, visibleArea](void* obj)
+        {
+            int x, y, w, h;
+            libpd_get_object_bounds(patch.getPointer(), obj, &x, &y, &w, &h);
+            return visibleArea.intersects(Rectangle<int>(x, y, w, h));
+        });
+
+    isLoading = true;
+
+    // Don't allow editing before the objects are in the same order as in pd
+    setInterceptsMouseClicks(false, false);
+
+    MessageManager::callAsync([_this = SafePointer(this)]()
+        {
+            if (_this) _this->loadNextObjects();
+        });
+}
+
+void Canvas::loadNextObjects()
+{
+    if (!isLoading) return;
+
+    pd->waitForStateUpdate();
+    patch.setCurrent(true);
+
+    auto end = std::min(numObjectsLoaded + objectsPerSlice, objectsToLoad.size());
+    for (; numObjectsLoaded < end; numObjectsLoaded++)
+    {
+        auto* newBox = objects.add(new Object(objectsToLoad[numObjectsLoaded], this));
+        if (newBox->gui && newBox->gui->getLabel()) newBox->gui->getLabel()->toFront(false);
+    }
+
+    repaint();
+
+    if (numObjectsLoaded < objectsToLoad.size())
+    {
+        MessageManager::callAsync([_this = SafePointer(this)]()
+            {
+                if (_this) _this->loadNextObjects();
+            });
+    }
+    else
+    {
+        synchronise();
+    }
+}
+
+// Applies the changes pd reported since the last synchronise, without rescanning the patch
+// Falls back to a full synchronise for anything that can't be described as a single change
+Array<Object*> Canvas::synchroniseChanges()
+{
+    // There's nothing to update until the canvas is loaded, it reads the whole patch then
+    if (!isLoaded) return {};
+
+    pd->waitForStateUpdate();
+
+    auto changes = pd->takePatchChanges(patch.getPointer());
+
+    bool needsRescan = isLoading || isGraph || presentationMode == var(true) || std::any_of(changes.begin(), changes.end(), [](auto const& change) { return change.type == pd_canvas_changed; });
+
+    Array<Object*> addedObjects;
 
-        for (int x = canvasOrigin.getX() + objectGridSize; x < clipBounds.getRight(); x += objectGridSize)
+    if (needsRescan)
+    {
+        synchronise();
+
+        // Pd selects what it pasted or duplicated
+        patch.setCurrent();
+        sys_lock();
+        for (auto* object : objects)
+        {
+            if (object->getPointer() && glist_isselected(patch.getPointer(), static_cast<t_gobj*>(object->getPointer()))) addedObjects.add(object);
+        }
+        sys_unlock();
+
+        return addedObjects;
+    }
+
+    patch.setCurrent(true);
+
+    std::unordered_map<void*, Object*> existingObjects;
+    for (auto* object : objects)
+    {
+        if (object->getPointer()) existingObjects[object->getPointer()] = object;
+    }
+
+    auto findConnection = [this](Object* start, int outIdx, Object* end, int inIdx) -> Connection*
+    {
+        for (auto* c : connections)
         {
-            for (int y = canvasOrigin.getY() + objectGridSize; y < clipBounds.getBottom(); y += objectGridSize)
+            if (c->outobj == start && c->inobj == end && c->outIdx == outIdx && c->inIdx == inIdx) return c;
+        }
+        return nullptr;
+    };
+
+    for (auto const& change : changes)
+    {
+        switch (change.type)
+        {
+            case pd_object_added:
+            {
+                if (existingObjects.count(change.object)) break;
+
+                // New objects are always appended to the patch, so the order stays the same as in pd
+                auto* newBox = objects.add(new Object(change.object, this));
+                newBox->toFront(false);
+                if (newBox->gui && newBox->gui->getLabel()) newBox->gui->getLabel()->toFront(false);
+
+                existingObjects[change.object] = newBox;
+                addedObjects.add(newBox);
+                break;
+            }
+            case pd_object_removed:
+            {
+                auto it = existingObjects.find(change.object);
+                if (it == existingObjects.end()) break;
+
+                // Pd removes the connections of an object along with it
+                for (auto* connection : it->second->getConnections()) connections.removeObject(connection);
+
+                addedObjects.removeFirstMatchingValue(it->second);
+                objects.removeObject(it->second);
+                existingObjects.erase(it);
+                break;
+            }
+            case pd_object_moved:
+            {
+                auto it = existingObjects.find(change.object);
+                if (it != existingObjects.end()) it->second->updateBounds();
+                break;
+            }
+            case pd_connection_added:
+            case pd_connection_removed:
             {
-                g.fillRect(x, y, 1, 1);
+                auto startIt = existingObjects.find(change.source);
+                auto endIt = existingObjects.find(change.sink);
+                if (startIt == existingObjects.end() || endIt == existingObjects.end()) break;
+
+                auto* start = startIt->second;
+                auto* end = endIt->second;
+                auto* existing = findConnection(start, change.outlet, end, change.inlet);
+
+                if (change.type == pd_connection_removed)
+                {
+                    if (existing) connections.removeObject(existing);
+                }
+                else if (!existing && change.outlet < start->numOutputs && change.inlet < end->numInputs)
+                {
+                    connections.add(new Connection(this, start->iolets[start->numInputs + change.outlet], end->iolets[change.inlet], true));
+                }
+                break;
             }
+            default: break;
         }
     }
+
+    storage.confirmIds();
+
+    if (minimap && !changes.empty()) minimap->patchChanged();
+
+    return addedObjects;
 }
 
 // Synchronise state with pure-data
 // Used for loading and for complicated actions like undo/redo
 void Canvas::synchronise(bool updatePosition)
 {
+    TRACE_ZONE("Canvas::synchronise");
+
+    if (!isLoaded) return;
+
+    // A full synchronise creates anything that wasn't loaded yet
+    if (isLoading)
+    {
+        isLoading = false;
+        objectsToLoad.clear();
+        setInterceptsMouseClicks(true, true);
+        repaint();
+    }
+
     pd->waitForStateUpdate();
     deselectAll();
 
+    // We're rescanning everything, so the recorded changes are no longer needed
+    pd->takePatchChanges(patch.getPointer());
+
     patch.setCurrent(true);
 
     auto pdObjects = patch.getObjects();
+
+    // Index pd objects by pointer, so every lookup below is constant time
+    std::unordered_map<void*, size_t> pdObjectIndices;
+    pdObjectIndices.reserve(pdObjects.size());
+    for (size_t i = 0; i < pdObjects.size(); i++)
+    {
+        pdObjectIndices[pdObjects[i]] = i;
+    }
+
     auto isObjectDeprecated = [&](void* obj)
     {
-        return std::all_of(pdObjects.begin(), pdObjects.end(), [obj](const auto* obj2){
-            return obj != obj2;
-        });
+        return !pdObjectIndices.count(obj);
     };
 
     if (!(isGraph || presentationMode == var(true)))
@@ -192,11 +534,18 @@ void Canvas::synchronise(bool updatePosition)
         }
     }
 
+    std::unordered_map<void*, Object*> existingObjects;
+    existingObjects.reserve(objects.size());
+    for (auto* object : objects)
+    {
+        if (object->getPointer()) existingObjects[object->getPointer()] = object;
+    }
+
     for (auto* object : pdObjects)
     {
-        auto* it = std::find_if(objects.begin(), objects.end(), [&object](Object* b) { return b->getPointer() && b->getPointer() == object; });
+        auto it = existingObjects.find(object);
 
-        if (it == objects.end())
+        if (it == existingObjects.end())
         {
             auto* newBox = objects.add(new Object(object, this));
             newBox->toFront(false);
@@ -206,7 +555,7 @@ void Canvas::synchronise(bool updatePosition)
         }
         else
         {
-            auto* object = *it;
+            auto* object = it->second;
 
             // Check if number of inlets/outlets is correct
             object->updatePorts();
@@ -221,57 +570,81 @@ void Canvas::synchronise(bool updatePosition)
     }
 
     // Make sure objects have the same order
+    auto getPdIndex = [&pdObjectIndices, &pdObjects](Object* object)
+    {
+        auto it = pdObjectIndices.find(object->getPointer());
+        return it != pdObjectIndices.end() ? it->second : pdObjects.size();
+    };
+
     std::sort(objects.begin(), objects.end(),
-              [&pdObjects](Object* first, Object* second) mutable
+              [&getPdIndex](Object* first, Object* second)
               {
-                  size_t idx1 = std::find(pdObjects.begin(), pdObjects.end(), first->getPointer()) - pdObjects.begin();
-                  size_t idx2 = std::find(pdObjects.begin(), pdObjects.end(), second->getPointer()) - pdObjects.begin();
-
-                  return idx1 < idx2;
+                  return getPdIndex(first) < getPdIndex(second);
               });
 
     auto pdConnections = patch.getConnections();
 
     if (!(isGraph || presentationMode == var(true)))
     {
+        // Existing connections by their endpoints, collisions are resolved by comparing the connections themselves
+        auto getConnectionHash = [](Object* start, int outIdx, Object* end, int inIdx)
+        {
+            return std::hash<void*>()(start) ^ (std::hash<void*>()(end) * 31) ^ (static_cast<size_t>(outIdx) << 20) ^ (static_cast<size_t>(inIdx) << 10);
+        };
+
+        std::unordered_multimap<size_t, Connection*> existingConnections;
+        existingConnections.reserve(connections.size());
+        for (auto* c : connections)
+        {
+            if (c->inlet && c->outlet) existingConnections.emplace(getConnectionHash(c->outobj, c->outIdx, c->inobj, c->inIdx), c);
+        }
+
         for (auto& connection : pdConnections)
         {
             auto& [inno, inobj, outno, outobj] = connection;
 
-            int srcno = patch.getIndex(&inobj->te_g);
-            int sinkno = patch.getIndex(&outobj->te_g);
-
-            auto& srcEdges = objects[srcno]->iolets;
-            auto& sinkEdges = objects[sinkno]->iolets;
+            auto srcIt = pdObjectIndices.find(&inobj->te_g);
+            auto sinkIt = pdObjectIndices.find(&outobj->te_g);
 
             // TEMP: remove when we're sure this works
-            if (srcno >= objects.size() || sinkno >= objects.size() || outno >= srcEdges.size() || inno >= sinkEdges.size())
+            if (srcIt == pdObjectIndices.end() || sinkIt == pdObjectIndices.end() || srcIt->second >= static_cast<size_t>(objects.size()) || sinkIt->second >= static_cast<size_t>(objects.size()))
             {
                 pd->logError("Error: impossible connection");
                 continue;
             }
 
-            auto* it = std::find_if(connections.begin(), connections.end(),
-                                   [this, &connection, &srcno, &sinkno](Connection* c)
-                                   {
-                                       auto& [inno, inobj, outno, outobj] = connection;
+            auto* start = objects[static_cast<int>(srcIt->second)];
+            auto* end = objects[static_cast<int>(sinkIt->second)];
 
-                                       if (!c->inlet || !c->outlet) return false;
+            auto& srcEdges = start->iolets;
+            auto& sinkEdges = end->iolets;
 
-                                       bool sameStart = c->outobj == objects[srcno];
-                                       bool sameEnd = c->inobj == objects[sinkno];
+            if (outno >= srcEdges.size() || inno >= sinkEdges.size())
+            {
+                pd->logError("Error: impossible connection");
+                continue;
+            }
 
-                                       return c->inIdx == inno && c->outIdx == outno && sameStart && sameEnd;
-                                   });
+            Connection* existing = nullptr;
+            auto range = existingConnections.equal_range(getConnectionHash(start, outno, end, inno));
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                auto* c = it->second;
+                if (c->inIdx == inno && c->outIdx == outno && c->outobj == start && c->inobj == end)
+                {
+                    existing = c;
+                    break;
+                }
+            }
 
-            if (it == connections.end())
+            if (!existing)
             {
-                connections.add(new Connection(this, srcEdges[objects[srcno]->numInputs + outno], sinkEdges[inno], true));
+                connections.add(new Connection(this, srcEdges[start->numInputs + outno], sinkEdges[inno], true));
             }
             else
             {
                 // Update storage ids for connections
-                auto& c = *(*it);
+                auto& c = *existing;
 
                 c.inIdx = c.inlet->ioletIdx;
                 c.outIdx = c.outlet->ioletIdx;
@@ -302,13 +675,54 @@ void Canvas::synchronise(bool updatePosition)
         if(!_this) return;
         _this->pd->waitForStateUpdate();
         _this->checkBounds();
+        _this->updateCulling();
     });
     
 
+    updateGraphCache();
+    if (minimap) minimap->patchChanged();
+
     main.updateCommandStatus();
     repaint();
 }
 
+void Canvas::updateGraphCache()
+{
+    if (!isGraph) return;
+
+    setBufferedToImage(!hasAnimatedObjects());
+}
+
+bool Canvas::hasAnimatedObjects()
+{
+    return std::any_of(objects.begin(), objects.end(), [](Object* object){
+        return object->gui && object->gui->isAnimated();
+    });
+}
+
+void Canvas::updateCulling()
+{
+    if (isGraph || !viewport) return;
+
+    auto visibleArea = getLocalArea(viewport, viewport->getLocalBounds()).expanded(cullingMargin);
+
+    std::unordered_set<Object*> visibleObjects;
+    for (auto* object : objectIndex.query(visibleArea))
+    {
+        visibleObjects.insert(object);
+    }
+
+    for (auto* object : objects)
+    {
+        object->setCulled(!visibleObjects.count(object));
+    }
+
+    for (auto* connection : connections)
+    {
+        connection->setCulled(!connection->getBounds().intersects(visibleArea));
+    }
+}
+
 void Canvas::updateDrawables()
 {
 
@@ -323,15 +737,111 @@ void Canvas::updateDrawables()
 
 void Canvas::updateGuiValues()
 {
+    TRACE_ZONE("Canvas::updateGuiValues");
+
     for (auto* object : objects)
     {
-        if (object->gui)
+        // Culled objects update their value when they come back into view
+        if (object->gui && !object->culled)
+        {
+            object->gui->updateValue();
+        }
+    }
+
+    if (!pendingValueUpdates.empty())
+    {
+        GUIObject::pollValues(pd, std::move(pendingValueUpdates));
+        pendingValueUpdates.clear();
+    }
+}
+
+void Canvas::updateGuiValues(std::unordered_set<void*> const& dirtyObjects)
+{
+    for (auto* object : objects)
+    {
+        if (!object->gui || object->culled)
+            continue;
+
+        if (dirtyObjects.count(object->getPointer()))
         {
             object->gui->updateValue();
         }
+        // Graphs contain objects of their own
+        else if (auto* graph = object->gui->getCanvas())
+        {
+            graph->updateGuiValues(dirtyObjects);
+        }
+    }
+
+    if (!pendingValueUpdates.empty())
+    {
+        GUIObject::pollValues(pd, std::move(pendingValueUpdates));
+        pendingValueUpdates.clear();
+    }
+}
+
+void Canvas::requestValueUpdate(GUIObject* object)
+{
+    pendingValueUpdates.emplace_back(object);
+}
+
+void Canvas::addCanvasListener(CanvasListener* listener)
+{
+    // The first listener compares against the current state, so it doesn't get a change that happened before it existed
+    if (canvasListeners.isEmpty()) wasShowing = isShowing();
+    canvasListeners.add(listener);
+}
+
+void Canvas::removeCanvasListener(CanvasListener* listener)
+{
+    canvasListeners.remove(listener);
+}
+
+void Canvas::updateShowingState()
+{
+    auto const showing = isShowing();
+
+    // Canvases that were unloaded while hidden are built again as soon as they show
+    if (showing) loadIfNeeded();
+
+    if (showing != wasShowing)
+    {
+        wasShowing = showing;
+        canvasListeners.call([showing](CanvasListener& l) { l.canvasShowingChanged(showing); });
+    }
+
+    for (auto* object : objects)
+    {
+        if (object->gui)
+        {
+            if (auto* graph = object->gui->getCanvas()) graph->updateShowingState();
+        }
+    }
+}
+
+void Canvas::zoomChanged(float scale)
+{
+    canvasListeners.call([scale](CanvasListener& l) { l.canvasZoomChanged(scale); });
+
+    for (auto* object : objects)
+    {
+        if (object->gui)
+        {
+            if (auto* graph = object->gui->getCanvas()) graph->zoomChanged(scale);
+        }
     }
 }
 
+void Canvas::visibilityChanged()
+{
+    updateShowingState();
+}
+
+void Canvas::parentHierarchyChanged()
+{
+    updateShowingState();
+}
+
 void Canvas::mouseDown(MouseEvent const& e)
 {
     auto* source = e.originalComponent;
@@ -418,6 +928,8 @@ void Canvas::mouseDown(MouseEvent const& e)
         popupMenu.clear();
 
         popupMenu.addItem(1, "Open", object && !multiple && canBeOpened);  // for opening subpatches
+        if (object && !multiple && object->gui && object->gui->canInspectInstances())
+            popupMenu.addItem(12, "Inspect Instances");
         popupMenu.addSeparator();
 
         popupMenu.addCommandItem(&main, CommandIDs::Cut);
@@ -461,6 +973,9 @@ void Canvas::mouseDown(MouseEvent const& e)
                 case 10:  // Open help
                     object->openHelpPatch();
                     break;
+                case 12:  // Show the values of all clone instances
+                    object->gui->inspectInstances();
+                    break;
                 case 11:
                     if(originalComponent == this) {
                         // Open help
@@ -597,6 +1112,20 @@ void Canvas::updateSidebarSelection()
 
 void Canvas::paintOverChildren(Graphics& g)
 {
+    PaintProfiler::getInstance().endPaint(this);
+
+    if (isLoading && viewport)
+    {
+        auto progress = static_cast<float>(numObjectsLoaded) / static_cast<float>(std::max<size_t>(objectsToLoad.size(), 1));
+        auto bar = Rectangle<float>(0.0f, 0.0f, 200.0f, 4.0f).withCentre(viewport->getViewArea().getCentre().toFloat());
+
+        g.setColour(findColour(PlugDataColour::canvasDotsColourId));
+        g.fillRoundedRectangle(bar, 2.0f);
+
+        g.setColour(findColour(PlugDataColour::objectSelectedOutlineColourId));
+        g.fillRoundedRectangle(bar.withWidth(bar.getWidth() * progress), 2.0f);
+    }
+
     Point<float> mousePos = getMouseXYRelative().toFloat();
     
     // Draw connections in the making over everything else
@@ -732,21 +1261,16 @@ void Canvas::pasteSelection()
     patch.startUndoSequence("Paste");
     // Tell pd to paste
     patch.paste();
-    // Load state from pd, don't update positions
-    synchronise(false);
 
-    patch.setCurrent();
+    // Only create the pasted objects and connections
+    auto pasted = synchroniseChanges();
 
     std::vector<void*> pastedObjects;
 
-    sys_lock();
-    for (auto* object : objects) {
-        if (glist_isselected(patch.getPointer(), static_cast<t_gobj*>(object->getPointer()))) {
-            setSelected(object, true);
-            pastedObjects.emplace_back(object->getPointer());
-        }
+    for (auto* object : pasted) {
+        setSelected(object, true);
+        pastedObjects.emplace_back(object->getPointer());
     }
-    sys_unlock();
 
     // Paste at mousePos, adds padding if pasted the same place
     if (lastMousePosition == pastedPosition) {
@@ -796,16 +1320,8 @@ void Canvas::duplicateSelection()
     // Tell pd to duplicate
     patch.duplicate();
 
-    // Load state from pd, don't update positions
-    synchronise(false);
-
-    // Store the duplicated objects for later selection
-    Array<Object*> duplicated;
-    for (auto* object : objects) {
-        if (glist_isselected(patch.getPointer(), static_cast<t_gobj*>(object->getPointer()))) {
-            duplicated.add(object);
-        }
-    }
+    // Only create the duplicated objects and connections, and keep them for later selection
+    auto duplicated = synchroniseChanges();
 
     // Auto patching
     if (!wasDragDuplicated && main.autoconnect.getValue()) {
@@ -900,13 +1416,49 @@ void Canvas::removeSelection()
 
     deselectAll();
 
-    // Load state from pd, don't update positions
-    synchronise(false);
+    // Apply the removals that pd reported
+    synchroniseChanges();
 
     patch.deselectAll();
 }
 
 void Canvas::encapsulateSelection()
+{
+    auto selectedBoxes = getSelectionOfType<Object>();
+
+    // Inlets and outlets belong to this canvas, so they can only be copied into the new subpatch
+    bool hasIolets = std::any_of(selectedBoxes.begin(), selectedBoxes.end(), [](Object* object)
+        {
+            if (!object->getPointer()) return false;
+            auto className = String::fromUTF8(libpd_get_object_class_name(object->getPointer()));
+            return className == "inlet" || className == "outlet";
+        });
+
+    if (hasIolets)
+    {
+        encapsulateSelectionAsText();
+        return;
+    }
+
+    patch.deselectAll();
+
+    for (auto* object : selectedBoxes)
+    {
+        if (object->getPointer()) patch.selectObject(object->getPointer());
+    }
+
+    // Moves the objects themselves, so they keep their state
+    pd->enqueueFunction([this]() mutable
+        {
+            patch.setCurrent();
+            libpd_encapsulate(patch.getPointer());
+        });
+
+    synchroniseChanges();
+    patch.deselectAll();
+}
+
+void Canvas::encapsulateSelectionAsText()
 {
     auto selectedBoxes = getSelectionOfType<Object>();
     
@@ -1044,6 +1596,63 @@ void Canvas::encapsulateSelection()
     patch.deselectAll();
 }
 
+void Canvas::findPaths(Array<Connection*> const& toRoute)
+{
+    struct Route
+    {
+        SafePointer<Connection> connection;
+        Point<int> start, end;
+        std::vector<Rectangle<int>> obstacles;
+        PathPlan result;
+    };
+
+    // Take a snapshot of everything the router needs, so the workers never touch any components
+    auto routes = std::make_shared<std::vector<Route>>();
+    for (auto* connection : toRoute)
+    {
+        if (!connection->inlet || !connection->outlet) continue;
+        routes->push_back({ connection, connection->getStartPoint(), connection->getEndPoint(), connection->getObstacles(), {} });
+    }
+
+    if (routes->empty()) return;
+
+    auto remaining = std::make_shared<std::atomic<size_t>>(routes->size());
+    auto applyRoutes = [_this = SafePointer(this), routes]()
+    {
+        if (!_this) return;
+
+        std::vector<std::pair<String, String>> paths;
+        for (auto& route : *routes)
+        {
+            auto* connection = route.connection.getComponent();
+
+            // Skip connections that were moved while we were routing them
+            if (!connection || connection->getStartPoint() != route.start || connection->getEndPoint() != route.end) continue;
+
+            connection->setPath(route.result);
+            paths.emplace_back(connection->lastId, connection->getState());
+        }
+
+        _this->storage.setInfos("Path", paths);
+    };
+
+    for (size_t i = 0; i < routes->size(); i++)
+    {
+        main.routingPool.addJob([routes, remaining, applyRoutes, i]()
+            {
+                auto& route = (*routes)[i];
+
+                // We're not blocking the editor here, so we can afford to search for longer
+                route.result = Connection::computePath(route.start, route.end, route.obstacles, 250.0);
+
+                if (--(*remaining) == 0)
+                {
+                    MessageManager::callAsync(applyRoutes);
+                }
+            });
+    }
+}
+
 bool Canvas::canConnectSelectedObjects()
 {
     auto selection = getSelectionOfType<Object>();
@@ -1071,7 +1680,7 @@ bool Canvas::connectSelectedObjects()
     
     patch.createConnection(topObject->getPointer(), 0, bottomObject->getPointer(), 0);
     
-    synchronise();
+    synchroniseChanges();
     
     return true;
 }
@@ -1164,6 +1773,8 @@ void Canvas::valueChanged(Value& v)
         if(isShowing() && isVisible()) grabKeyboardFocus();
         
         main.updateCommandStatus();
+
+        canvasListeners.call([editMode](CanvasListener& l) { l.canvasLockChanged(!editMode); });
     }
     else if (v.refersToSameSourceAs(commandLocked))
     {
@@ -1326,6 +1937,26 @@ void Canvas::handleMouseUp(Component* component, MouseEvent const& e)
         patch.moveObjects(objects, distance.x, distance.y);
 
         pd->waitForStateUpdate();
+
+        // Cables that were only translated get their real path, routed cables that were stretched are stored in one step
+        std::vector<std::pair<String, String>> paths;
+        auto movedObjects = std::exchange(draggedObjects, {});
+        for (auto* connection : connections)
+        {
+            bool outletMoved = movedObjects.count(connection->outobj.getComponent());
+            bool inletMoved = movedObjects.count(connection->inobj.getComponent());
+
+            if (outletMoved && inletMoved)
+            {
+                connection->updatePath();
+            }
+            else if ((outletMoved || inletMoved) && connection->isSegmented())
+            {
+                paths.emplace_back(connection->lastId, connection->getState());
+            }
+        }
+
+        storage.setInfos("Path", paths);
         
         // Update undo state
         main.updateCommandStatus();
@@ -1354,7 +1985,7 @@ void Canvas::handleMouseUp(Component* component, MouseEvent const& e)
         objectSnappingInbetween->iolets[objectSnappingInbetween->numInputs]->isTargeted = false;
         objectSnappingInbetween = nullptr;
 
-        synchronise();
+        synchroniseChanges();
     }
 
     if (wasDragDuplicated) {
@@ -1404,6 +2035,9 @@ void Canvas::handleMouseDrag(MouseEvent const& e)
         duplicateSelection();
     }
 
+    draggedObjects.clear();
+    for (auto* object : selection) draggedObjects.insert(object);
+
     // move all selected objects
     if (wasDragDuplicated) {
         // Correct distancing
@@ -1533,19 +2167,21 @@ void Canvas::removeSelectedComponent(Component* component)
 
 void Canvas::findLassoItemsInArea(Array<WeakReference<Component>>& itemsFound, Rectangle<int> const& area)
 {
-    for (auto* element : objects)
+    // Only the objects that are selected now can fall outside of the lasso
+    if (!ModifierKeys::getCurrentModifiers().isAnyModifierKeyDown())
     {
-        if (area.intersects(element->getBounds()))
+        for (auto* element : getSelectionOfType<Object>())
         {
-            itemsFound.add(element);
-            setSelected(element, true);
-        }
-        else if (!ModifierKeys::getCurrentModifiers().isAnyModifierKeyDown())
-        {
-            setSelected(element, false);
+            if (!area.intersects(element->getBounds())) setSelected(element, false);
         }
     }
 
+    for (auto* element : objectIndex.query(area))
+    {
+        itemsFound.add(element);
+        setSelected(element, true);
+    }
+
     for (auto& con : connections)
     {
         // If total bounds don't intersect, there can't be an intersection with the line
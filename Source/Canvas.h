@@ -7,15 +7,19 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "Object.h"
 #include "Pd/PdPatch.h"
 #include "Pd/PdStorage.h"
 #include "PluginProcessor.h"
 #include "Utility/ObjectGrid.h"
+#include "Utility/SpatialIndex.h"
 
 class SuggestionComponent;
 struct GraphArea;
+struct Minimap;
 class Iolet;
 class PlugDataPluginEditor;
 class Canvas : public Component, public Value::Listener, public LassoSource<WeakReference<Component>>
@@ -23,8 +27,12 @@ class Canvas : public Component, public Value::Listener, public LassoSource<Weak
    public:
     
     bool isBeingDeleted = false;
+
+    // Set while unload deletes the objects, tabs of subpatches opened from them stay open
+    bool isUnloading = false;
     
-    Canvas(PlugDataPluginEditor& parent, pd::Patch& patch, Component* parentGraph = nullptr);
+    // With deferLoading, no objects are created until the canvas is shown for the first time
+    Canvas(PlugDataPluginEditor& parent, pd::Patch& patch, Component* parentGraph = nullptr, bool deferLoading = false);
 
     ~Canvas() override;
 
@@ -45,9 +53,68 @@ class Canvas : public Component, public Value::Listener, public LassoSource<Weak
     void mouseMove(const MouseEvent& e) override;
 
     void synchronise(bool updatePosition = true);
+
+    // Only applies the changes that pd reported, instead of rescanning the whole patch
+    // Returns the objects that were added, or the ones pd has selected if it had to rescan
+    Array<Object*> synchroniseChanges();
+
+    // Builds the canvas over multiple message loop iterations, for large patches
+    void synchroniseProgressively();
+
+    // Creates the objects of a canvas that was constructed with deferLoading, returns false if that already happened
+    bool loadIfNeeded();
+
+    // Applies a theme change to the objects, the visible ones first and the rest over the next message loop iterations
+    // Does nothing if the canvas is already up to date with the current theme
+    void updateColours();
+
+    // Deletes the objects and connections of a canvas that isn't shown, the patch keeps running in pd
+    // They're built again from the patch by the next loadIfNeeded
+    void unload();
+
+    // Last time the canvas was on screen, used to decide when to unload it
+    double lastShownTime = Time::getMillisecondCounterHiRes();
     
     void updateDrawables();
+
+    // Graphs are drawn from a cached image, so redrawing the parent doesn't repaint every object in them
+    // The cache is left off while the graph contains an object that redraws all the time
+    void updateGraphCache();
+    bool hasAnimatedObjects();
+
+    // Hides the objects and connections outside of the visible area, so they don't cost anything to paint or update
+    void updateCulling();
     void updateGuiValues();
+
+    // Only updates the objects that pd reported as changed
+    void updateGuiValues(std::unordered_set<void*> const& dirtyObjects);
+
+    // Queues a GUI object for the next batched value poll in updateGuiValues
+    void requestValueUpdate(GUIObject* object);
+
+    // Objects that respond to changes of the canvas itself, like [canvas.vis], [canvas.zoom] and [canvas.edit]
+    // Every change is sent once to all of them, so they don't need to watch for it on their own
+    struct CanvasListener
+    {
+        virtual ~CanvasListener() = default;
+
+        virtual void canvasShowingChanged(bool isShowing) {}
+        virtual void canvasZoomChanged(float scale) {}
+        virtual void canvasLockChanged(bool isLocked) {}
+    };
+
+    void addCanvasListener(CanvasListener* listener);
+    void removeCanvasListener(CanvasListener* listener);
+
+    // Called by the editor when tabs changed or the editor was shown or hidden, the graphs in this canvas are updated as well
+    // Only tells the listeners if the canvas started or stopped showing since the last call
+    void updateShowingState();
+
+    // Called by the editor when the zoom changed, also for the graphs in this canvas
+    void zoomChanged(float scale);
+
+    void visibilityChanged() override;
+    void parentHierarchyChanged() override;
     
     bool keyPressed(const KeyPress& key) override;
     void valueChanged(Value& v) override;
@@ -63,6 +130,9 @@ class Canvas : public Component, public Value::Listener, public LassoSource<Weak
     
     bool canConnectSelectedObjects();
     bool connectSelectedObjects();
+
+    // Routes the connections on worker threads, the results are applied and stored as one undoable step
+    void findPaths(Array<Connection*> const& toRoute);
     
     void cancelConnectionCreation();
 
@@ -116,7 +186,11 @@ class Canvas : public Component, public Value::Listener, public LassoSource<Weak
 
     // Needs to be allocated before object and connection so they can deselect themselves in the destructor
     SelectedItemSet<WeakReference<Component>> selectedComponents;
-    
+
+    // Needs to outlive the objects, they remove themselves from it in their destructor
+    SpatialIndex objectIndex;
+    ListenerList<CanvasListener> canvasListeners;
+
     OwnedArray<Object> objects;
     OwnedArray<Connection> connections;
 
@@ -141,6 +215,7 @@ class Canvas : public Component, public Value::Listener, public LassoSource<Weak
     Point<int> viewportPositionBeforeMiddleDrag = {0, 0};
 
     GraphArea* graphArea = nullptr;
+    Minimap* minimap = nullptr;
     SuggestionComponent* suggestor = nullptr;
     
     bool attachNextObjectToMouse = false;
@@ -152,6 +227,9 @@ class Canvas : public Component, public Value::Listener, public LassoSource<Weak
     bool didStartDragging = false;
     const int minimumMovementToStartDrag = 5;
     Object* componentBeingDragged = nullptr;
+
+    // Objects that move with the current drag, cables between two of them are only translated until the drag ends
+    std::unordered_set<Object*> draggedObjects;
     
     pd::Storage storage;
     
@@ -162,6 +240,37 @@ class Canvas : public Component, public Value::Listener, public LassoSource<Weak
 
    private:
     
+    void loadNextObjects();
+    void updateNextColours();
+
+    // Copies the selection into a new subpatch as text, for selections that can't be moved there
+    void encapsulateSelectionAsText();
+
+    bool isLoaded = false;
+
+    static constexpr size_t progressiveLoadThreshold = 500;
+    static constexpr size_t objectsPerSlice = 100;
+
+    // Distance outside the visible area in which objects are still shown, so they're ready when scrolling
+    static constexpr int cullingMargin = 200;
+
+    bool isLoading = false;
+    std::vector<void*> objectsToLoad;
+    size_t numObjectsLoaded = 0;
+
+    int themeVersion = PlugDataLook::themeVersion;
+    std::vector<SafePointer<Object>> objectsToRecolour;
+    size_t numObjectsRecoloured = 0;
+
+    std::vector<SafePointer<GUIObject>> pendingValueUpdates;
+
+    bool wasShowing = false;
+
+    // One cell of the dot grid, rendered at the current zoom level
+    Image gridTile;
+    float gridTileScale = 0.0f;
+    Colour gridTileColour;
+
     SafePointer<Object> objectSnappingInbetween;
     SafePointer<Connection> connectionToSnapInbetween;
     SafePointer<TabbedComponent> tabbar;
@@ -5,9 +5,12 @@
  */
 #include "Connection.h"
 
+#include <queue>
+
 #include "Canvas.h"
 #include "Iolet.h"
 #include "LookAndFeel.h"
+#include "Utility/PaintProfiler.h"
 
 Connection::Connection(Canvas* parent, Iolet* s, Iolet* e, bool exists) : cnv(parent), outlet(s->isInlet ? e : s), inlet(s->isInlet ? s : e), outobj(outlet->object), inobj(inlet->object)
 {
@@ -203,6 +206,11 @@ bool Connection::intersects(Rectangle<float> toCheck, int accuracy) const
 }
 void Connection::paint(Graphics& g)
 {
+    PaintProfiler::ScopedMeasurement paintMeasurement(this);
+
+    // Our bounds are those of the whole cable, so we're often asked to paint an area that the cable doesn't even touch
+    if (!g.clipRegionIntersects(strokes[0].getBounds().getSmallestIntegerContainer()) && !cnv->isSelected(this)) return;
+    
     auto baseColour = findColour(PlugDataColour::connectionColourId);
     auto dataColour = findColour(PlugDataColour::dataColourId);
     auto signalColour = findColour(PlugDataColour::signalColourId);
@@ -219,13 +227,13 @@ void Connection::paint(Graphics& g)
     }
     
     g.setColour(baseColour.darker(0.1));
-    g.strokePath(toDraw, PathStrokeType(2.5f, PathStrokeType::mitered, PathStrokeType::square));
+    g.fillPath(strokes[0]);
     
     g.setColour(baseColour.darker(0.2));
-    g.strokePath(toDraw, PathStrokeType(1.5f, PathStrokeType::mitered, PathStrokeType::square));
+    g.fillPath(strokes[1]);
     
     g.setColour(baseColour);
-    g.strokePath(toDraw, PathStrokeType(0.5f, PathStrokeType::mitered, PathStrokeType::square));
+    g.fillPath(strokes[2]);
     
     if (cnv->isSelected(this))
     {
@@ -450,10 +458,25 @@ void Connection::componentMovedOrResized(Component& component, bool wasMoved, bo
 {
     if (!inlet || !outlet) return;
     
+    // Both ends move by the same distance, so the cable keeps its shape until the drag ends
+    if (cnv->draggedObjects.count(outobj.getComponent()) && cnv->draggedObjects.count(inobj.getComponent()))
+    {
+        auto delta = getStartPoint() - lastStartPoint;
+        if (delta.isOrigin()) return;
+        
+        for (auto& point : currentPlan) point += delta;
+        origin += delta;
+        lastStartPoint += delta;
+        setTopLeftPosition(getPosition() + delta);
+        return;
+    }
+    
     auto pstart = getStartPoint();
     auto pend = getEndPoint();
     
-    if (currentPlan.size() <= 2 || cnv->storage.getInfo(getId(), "Style") == "0")
+    if (lastId.isEmpty()) lastId = getId();
+
+    if (currentPlan.size() <= 2 || cnv->storage.getInfo(lastId, "Style") == "0")
     {
         updatePath();
         return;
@@ -515,6 +538,7 @@ void Connection::updatePath()
     int bottom = std::max(outlet->getCanvasBounds().getCentreY(), inlet->getCanvasBounds().getCentreY()) + 4;
     
     origin = Rectangle<int>(left, top, right - left, bottom - top).getPosition();
+    lastStartPoint = getStartPoint();
     
     auto pstart = getStartPoint() - origin;
     auto pend = getEndPoint() - origin;
@@ -601,23 +625,60 @@ void Connection::updatePath()
     
     startReconnectHandle = Rectangle<float>(5, 5).withCentre(toDraw.getPointAlongPath(8.5f));
     endReconnectHandle = Rectangle<float>(5, 5).withCentre(toDraw.getPointAlongPath(std::max(toDraw.getLength() - 8.5f, 9.5f)));
+    
+    updateStrokes();
+}
+
+void Connection::updateStrokes()
+{
+    float const widths[] = { 2.5f, 1.5f, 0.5f };
+    
+    for (int i = 0; i < 3; i++)
+    {
+        strokes[i].clear();
+        PathStrokeType(widths[i], PathStrokeType::mitered, PathStrokeType::square).createStrokedPath(strokes[i], toDraw);
+    }
 }
 
 void Connection::findPath()
 {
     if (!outlet || !inlet) return;
     
+    currentPlan = computePath(getStartPoint(), getEndPoint(), getObstacles());
+    
+    auto state = getState();
+    lastId = getId();
+    cnv->storage.setInfo(lastId, "Path", state);
+}
+
+std::vector<Rectangle<int>> Connection::getObstacles()
+{
     auto pstart = getStartPoint();
     auto pend = getEndPoint();
     
-    auto pathStack = PathPlan();
-    auto bestPath = PathPlan();
-    
-    pathStack.reserve(8);
+    // Only objects inside the area between the iolets can be in the way
+    std::vector<Rectangle<int>> obstacles;
+    for (auto* object : cnv->objectIndex.query(Rectangle<int>(pstart, pend).expanded(2)))
+    {
+        if (object == outobj || object == inobj) continue;
+        obstacles.push_back(object->getBounds().expanded(1));
+    }
     
-    auto numFound = 0;
+    return obstacles;
+}
+
+void Connection::setPath(PathPlan const& plan)
+{
+    currentPlan = plan;
+    lastId = getId();
+    updatePath();
+}
+
+PathPlan Connection::computePath(Point<int> pstart, Point<int> pend, std::vector<Rectangle<int>> const& obstacles, double timeLimitMs)
+{
+    auto bestPath = PathPlan();
     
-    int incrementX, incrementY;
+    bool found = false;
     
     auto distance = pstart.getDistanceFrom(pend);
     auto distanceX = std::abs(pstart.x - pend.x);
@@ -629,37 +690,28 @@ void Connection::findPath()
     int resolutionX = 6;
     int resolutionY = 6;
     
-    auto obstacles = Array<Rectangle<int>>();
-    auto searchBounds = Rectangle<int>(pstart, pend);
-    
-    for(auto* object : cnv->objects) {
-        if(object->getBounds().intersects(searchBounds)) {
-            obstacles.add(object->getBounds());
-        }
-    }
+    // When the search takes too long, we fall back to a simple path
+    auto deadline = Time::getMillisecondCounterHiRes() + timeLimitMs;
     
     // Look for paths at an increasing resolution
-    while (!numFound && resolutionX < maxXResolution && distance > 40)
+    while (!found && resolutionX < maxXResolution && distance > 40 && Time::getMillisecondCounterHiRes() < deadline)
     {
-        
         // Find paths on a resolution*resolution lattice ObjectGrid
-        incrementX = std::max(1, distanceX / resolutionX);
-        incrementY = std::max(1, distanceY / resolutionY);
+        auto incrementX = std::max(1, distanceX / resolutionX);
+        auto incrementY = std::max(1, distanceY / resolutionY);
         
-        numFound = findLatticePaths(bestPath, pathStack, pend, pstart, {incrementX, incrementY});
+        found = findLatticePath(bestPath, pend, pstart, {incrementX, incrementY}, obstacles, deadline);
         
         if(resolutionX < maxXResolution) resolutionX++;
         if(resolutionY < maxXResolution) resolutionY++;
         
         if(resolutionX > maxXResolution || resolutionY > maxYResolution) break;
-        
-        pathStack.clear();
     }
     
     PathPlan simplifiedPath;
     
     bool direction;
-    if (!bestPath.empty())
+    if (bestPath.size() > 1)
     {
         simplifiedPath.push_back(bestPath.front());
         
@@ -704,96 +756,134 @@ void Connection::findPath()
     }
     std::reverse(simplifiedPath.begin(), simplifiedPath.end());
     
-    currentPlan = simplifiedPath;
-    
-    auto state = getState();
-    lastId = getId();
-    cnv->storage.setInfo(lastId, "Path", state);
+    return simplifiedPath;
 }
 
-int Connection::findLatticePaths(PathPlan& bestPath, PathPlan& pathStack, Point<int> pstart, Point<int> pend, Point<int> increment)
+// A* over a lattice between the two points, where every step has to move closer to the destination
+// The search state includes the direction of the last step, so that turns can be penalised
+bool Connection::findLatticePath(PathPlan& bestPath, Point<int> pstart, Point<int> pend, Point<int> increment, std::vector<Rectangle<int>> const& obstacles, double deadline)
 {
+    auto const distanceX = std::abs(pend.x - pstart.x);
+    auto const distanceY = std::abs(pend.y - pstart.y);
+    auto const signX = pend.x < pstart.x ? -1 : 1;
+    auto const signY = pend.y < pstart.y ? -1 : 1;
     
-    auto obstacles = Array<Object*>();
-    auto searchBounds = Rectangle<int>(pstart, pend);
+    // The last lattice point is clamped to the destination, so the increments don't need to divide the distance
+    int const numX = (distanceX + increment.x - 1) / increment.x;
+    int const numY = (distanceY + increment.y - 1) / increment.y;
     
-    for(auto* object : cnv->objects) {
-        if(object->getBounds().intersects(searchBounds)) {
-            obstacles.add(object);
-        }
-    }
+    auto getPoint = [&](int i, int j) -> Point<int>
+    {
+        return { pstart.x + signX * std::min(i * increment.x, distanceX), pstart.y + signY * std::min(j * increment.y, distanceY) };
+    };
     
-    // Stop after we've found a path
-    if (!bestPath.empty()) return 0;
+    // Cords leave outlets and enter inlets vertically, unless the inlet is above the outlet
+    bool const endVertically = pstart.y > pend.y;
+    int const preferredDirection = endVertically ? 1 : 0;
     
-    // Add point to path
-    pathStack.push_back(pstart);
+    auto const numStates = (numX + 1) * (numY + 1) * 2;
+    auto getState = [numY](int i, int j, int dir) { return (i * (numY + 1) + j) * 2 + dir; };
     
-    // Check if it intersects any object
-    if (pathStack.size() > 1 && straightLineIntersectsObject(Line<int>(pathStack.back(), *(pathStack.end() - 2)), obstacles))
-    {
-        return 0;
-    }
+    std::vector<float> cost(numStates, std::numeric_limits<float>::max());
+    std::vector<int> parent(numStates, -1);
     
-    bool endVertically = pathStack[0].y > pend.y;
+    // Turning costs more than going straight, and turning halfway between the points looks best
+    auto const turnPenalty = static_cast<float>(increment.x + increment.y);
+    auto getTurnCost = [&](int i, int j, int dir)
+    {
+        auto progress = dir == 0 ? static_cast<float>(j) / std::max(numY, 1) : static_cast<float>(i) / std::max(numX, 1);
+        return turnPenalty * (1.0f + std::abs(progress - 0.5f));
+    };
     
-    // Check if we've reached the destination
-    if (std::abs(pstart.x - pend.x) < (increment.x * 0.5) && std::abs(pstart.y - pend.y) < (increment.y * 0.5))
+    auto heuristic = [&](int i, int j)
     {
-        bestPath = pathStack;
-        return 1;
-    }
+        return static_cast<float>((distanceX - std::min(i * increment.x, distanceX)) + (distanceY - std::min(j * increment.y, distanceY)));
+    };
     
-    // Count the number of found paths
-    int count = 0;
+    using Entry = std::pair<float, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
     
-    // Get current stack to revert to after each trial
-    auto pathCopy = pathStack;
+    auto startState = getState(0, 0, preferredDirection);
+    cost[startState] = 0.0f;
+    open.push({ heuristic(0, 0), startState });
     
-    auto followLine = [this, &count, &pathCopy, &bestPath, &pathStack, &increment](Point<int> currentOutlet, Point<int> currentInlet, bool isX)
-    {
-        auto& coord1 = isX ? currentOutlet.x : currentOutlet.y;
-        auto& coord2 = isX ? currentInlet.x : currentInlet.y;
-        auto& incr = isX ? increment.x : increment.y;
-        
-        if (std::abs(coord1 - coord2) >= incr)
-        {
-            coord1 > coord2 ? coord1 -= incr : coord1 += incr;
-            count += findLatticePaths(bestPath, pathStack, currentOutlet, currentInlet, increment);
-            pathStack = pathCopy;
-        }
-    };
+    int goalState = -1;
+    int numExpanded = 0;
     
-    // If we're halfway on the axis, change preferred direction by inverting search order
-    // This will make it do a staircase effect
-    if (endVertically)
+    while (!open.empty())
     {
-        if (std::abs(pstart.y - pend.y) >= std::abs(pathStack[0].y - pend.y) * 0.5)
+        auto [priority, state] = open.top();
+        open.pop();
+        
+        int const dir = state % 2;
+        int const i = (state / 2) / (numY + 1);
+        int const j = (state / 2) % (numY + 1);
+        
+        if (priority > cost[state] + heuristic(i, j)) continue;  // Already found a cheaper way here
+        
+        if (i == numX && j == numY)
         {
-            followLine(pstart, pend, false);
-            followLine(pstart, pend, true);
+            // Arriving the wrong way around costs one more turn
+            if (dir != preferredDirection && (numX > 0 && numY > 0))
+            {
+                auto turned = getState(i, j, preferredDirection);
+                auto turnedCost = cost[state] + turnPenalty;
+                if (turnedCost < cost[turned])
+                {
+                    cost[turned] = turnedCost;
+                    parent[turned] = state;
+                    open.push({ turnedCost, turned });
+                }
+                continue;
+            }
+            
+            goalState = state;
+            break;
         }
-        else
+        
+        if ((++numExpanded & 63) == 0 && Time::getMillisecondCounterHiRes() > deadline) return false;
+        
+        for (int nextDir = 0; nextDir < 2; nextDir++)
         {
-            followLine(pstart, pend, true);
-            followLine(pstart, pend, false);
+            int ni = i + (nextDir == 0);
+            int nj = j + (nextDir == 1);
+            if (ni > numX || nj > numY) continue;
+            
+            auto from = getPoint(i, j);
+            auto to = getPoint(ni, nj);
+            
+            if (from == to || segmentIntersectsObstacle({ from, to }, obstacles)) continue;
+            
+            auto stepCost = static_cast<float>(std::abs(to.x - from.x) + std::abs(to.y - from.y));
+            if (nextDir != dir) stepCost += getTurnCost(i, j, nextDir);
+            
+            auto next = getState(ni, nj, nextDir);
+            auto nextCost = cost[state] + stepCost;
+            
+            if (nextCost < cost[next])
+            {
+                cost[next] = nextCost;
+                parent[next] = state;
+                open.push({ nextCost + heuristic(ni, nj), next });
+            }
         }
     }
-    else
+    
+    if (goalState < 0) return false;
+    
+    bestPath.clear();
+    for (int state = goalState; state >= 0; state = parent[state])
     {
-        if (std::abs(pstart.x - pend.x) >= std::abs(pathStack[0].x - pend.x) * 0.5)
-        {
-            followLine(pstart, pend, true);
-            followLine(pstart, pend, false);
-        }
-        else
-        {
-            followLine(pstart, pend, false);
-            followLine(pstart, pend, true);
-        }
+        auto i = (state / 2) / (numY + 1);
+        auto j = (state / 2) % (numY + 1);
+        auto point = getPoint(i, j);
+        
+        // Turning in place adds the same point twice
+        if (bestPath.empty() || bestPath.back() != point) bestPath.push_back(point);
     }
+    std::reverse(bestPath.begin(), bestPath.end());
     
-    return count;
+    return true;
 }
 
 bool Connection::intersectsObject(Object* object)
@@ -805,16 +895,19 @@ bool Connection::intersectsObject(Object* object)
     || toDraw.intersectsLine({b.getBottomRight(), b.getTopRight()});
 }
 
+void Connection::setCulled(bool shouldBeCulled)
+{
+    if (culled == shouldBeCulled) return;
+
+    culled = shouldBeCulled;
+    setVisible(!culled);
+}
 
-bool Connection::straightLineIntersectsObject(Line<int> toCheck, Array<Object*>& objects)
+
+bool Connection::segmentIntersectsObstacle(Line<int> toCheck, std::vector<Rectangle<int>> const& obstacles)
 {
-    
-    for (const auto& object : objects)
+    for (auto const& bounds : obstacles)
     {
-        auto bounds = object->getBounds().expanded(1);
-        
-        if (object == outobj || object == inobj || !bounds.intersects(getBounds())) continue;
-        
         auto intersectV = [](Line<int> first, Line<int> second)
         {
             if (first.getStartY() > first.getEndY())
@@ -842,12 +935,6 @@ bool Connection::straightLineIntersectsObject(Line<int> toCheck, Array<Object*>&
         {
             return true;
         }
-        
-        /*
-         if(bounds.toFloat().intersects(toCheck.toFloat())) {
-         return true;
-         } TODO: benchmark these two options */
-        // TODO: possible mark areas that have already been visited?
     }
     
     return false;
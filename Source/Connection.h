@@ -64,16 +64,30 @@ class Connection : public Component, public ComponentListener
     void componentMovedOrResized(Component& component, bool wasMoved, bool wasResized) override;
 
     // Pathfinding
-    int findLatticePaths(PathPlan& bestPath, PathPlan& pathStack, Point<int> start, Point<int> end, Point<int> increment);
-
     void findPath();
 
+    // The bounds of the objects that a path could run into
+    std::vector<Rectangle<int>> getObstacles();
+
+    // Uses a path that was computed elsewhere, the caller is responsible for storing it
+    void setPath(PathPlan const& plan);
+
+    // Finds a path between two points around the obstacles, falls back to a simple path when that takes too long
+    // Doesn't touch any components, so it can be called from any thread
+    static PathPlan computePath(Point<int> start, Point<int> end, std::vector<Rectangle<int>> const& obstacles, double timeLimitMs = 20.0);
+
     bool intersectsObject(Object* object);
-    bool straightLineIntersectsObject(Line<int> toCheck, Array<Object*>& objects);
+
+    // Hides connections that are outside of the visible area
+    void setCulled(bool shouldBeCulled);
 
    private:
+    static bool findLatticePath(PathPlan& bestPath, Point<int> start, Point<int> end, Point<int> increment, std::vector<Rectangle<int>> const& obstacles, double deadline);
+    static bool segmentIntersectsObstacle(Line<int> toCheck, std::vector<Rectangle<int>> const& obstacles);
+
     bool wasSelected = false;
     bool segmented = false;
+    bool culled = false;
     
     Array<SafePointer<Connection>> reconnecting;
 
@@ -81,12 +95,19 @@ class Connection : public Component, public ComponentListener
 
     PathPlan currentPlan;
 
+    // Outlines of the cable for each of the line widths we draw, these are only rebuilt when the path changes
+    std::array<Path, 3> strokes;
+    void updateStrokes();
+
     Value locked;
 
     Canvas* cnv;
 
     Point<int> origin, offset;
 
+    // Where the cable started when its path was last built, so a dragged cable can be translated instead
+    Point<int> lastStartPoint;
+
     int dragIdx = -1;
 
     float mouseDownPosition = 0;
@@ -270,6 +270,20 @@ public:
             deviceTypeDropDownLabel->setJustificationType (Justification::centredRight);
             deviceTypeDropDownLabel->attachToComponent (deviceTypeDropDown.get(), true);
         }
+
+        lowLatencyMode.referTo (audioProcessor.settingsTree.getPropertyAsValue ("LowLatencyAudio", nullptr));
+
+        lowLatencyToggle.reset (new ToggleButton (TRANS("Fastest driver, smallest buffer, realtime audio thread")));
+        lowLatencyToggle->getToggleStateValue().referTo (lowLatencyMode);
+        lowLatencyToggle->onClick = [this] {
+            if (lowLatencyToggle->getToggleState())
+                applyLowLatencyProfile();
+        };
+        addAndMakeVisible (lowLatencyToggle.get());
+
+        lowLatencyLabel.reset (new Label ({}, TRANS("Low latency mode:")));
+        lowLatencyLabel->setJustificationType (Justification::centredRight);
+        lowLatencyLabel->attachToComponent (lowLatencyToggle.get(), true);
         
 
         midiInputsList.reset (new MidiSelectorComponentListBox (true, audioProcessor, deviceManager,
@@ -336,6 +350,9 @@ public:
             deviceTypeDropDown->setBounds (r.removeFromTop (itemHeight));
             r.removeFromTop (space * 3);
         }
+
+        lowLatencyToggle->setBounds (r.removeFromTop (itemHeight));
+        r.removeFromTop (space * 3);
         
         if (audioDeviceSettingsComp != nullptr)
         {
@@ -397,6 +414,58 @@ private:
     {
         updateAllControls();
     }
+
+    // Picks the fastest driver that has a device, and the smallest buffer that still holds one pd block
+    void applyLowLatencyProfile()
+    {
+        static const StringArray fastestTypes { "ASIO", "Windows Audio (Exclusive Mode)", "Windows Audio (Low Latency Mode)", "JACK", "ALSA", "CoreAudio" };
+
+        auto hasDevices = [this] (String const& typeName)
+        {
+            for (auto* type : deviceManager.getAvailableDeviceTypes())
+            {
+                if (type->getTypeName() == typeName)
+                {
+                    type->scanForDevices();
+                    return ! type->getDeviceNames().isEmpty();
+                }
+            }
+            return false;
+        };
+
+        for (auto& typeName : fastestTypes)
+        {
+            if (hasDevices (typeName))
+            {
+                if (deviceManager.getCurrentAudioDeviceType() != typeName)
+                    deviceManager.setCurrentAudioDeviceType (typeName, true);
+                break;
+            }
+        }
+
+        if (auto* device = deviceManager.getCurrentAudioDevice())
+        {
+            auto setup = deviceManager.getAudioDeviceSetup();
+            auto sizes = device->getAvailableBufferSizes();
+
+            if (! sizes.isEmpty())
+            {
+                setup.bufferSize = sizes.getLast();
+                for (auto size : sizes)
+                {
+                    if (size >= 64)
+                    {
+                        setup.bufferSize = size;
+                        break;
+                    }
+                }
+            }
+
+            deviceManager.setAudioDeviceSetup (setup, true);
+        }
+
+        updateAllControls();
+    }
     
     void updateAllControls()
     {
@@ -440,6 +509,9 @@ private:
     
     std::unique_ptr<ComboBox> deviceTypeDropDown;
     std::unique_ptr<Label> deviceTypeDropDownLabel;
+    std::unique_ptr<ToggleButton> lowLatencyToggle;
+    std::unique_ptr<Label> lowLatencyLabel;
+    Value lowLatencyMode;
     std::unique_ptr<Component> audioDeviceSettingsComp;
     String audioDeviceSettingsCompType;
     int itemHeight = 0;
@@ -1239,10 +1311,14 @@ struct DAWAudioSettings : public Component, public Value::Listener {
         addAndMakeVisible(latencyNumberBox);
         addAndMakeVisible(tailLengthNumberBox);
         addAndMakeVisible(nativeDialogToggle);
-        
-        dynamic_cast<DraggableNumber*>(latencyNumberBox.label.get())->setMinimum(64);
+        addAndMakeVisible(blockSizeSelector);
+        addAndMakeVisible(sampleAccurateMidiToggle);
+        addAndMakeVisible(oversamplingFilterSelector);
+        addAndMakeVisible(autoSleepToggle);
         
         auto* proc = dynamic_cast<PlugDataAudioProcessor*>(&processor);
+        
+        dynamic_cast<DraggableNumber*>(latencyNumberBox.label.get())->setMinimum(proc->pdBlockSize);
         auto& settingsTree = dynamic_cast<PlugDataAudioProcessor&>(p).settingsTree;
         
         if(!settingsTree.hasProperty("NativeDialog")) {
@@ -1256,8 +1332,20 @@ struct DAWAudioSettings : public Component, public Value::Listener {
         latencyValue.addListener(this);
         nativeDialogValue.addListener(this);
         
-        latencyValue = proc->getLatencySamples();
+        latencyValue = proc->getLatency();
+        
+        // Item ids 1 to 4 map to 64, 128, 256 and 512 samples
+        blockSizeValue = static_cast<int>(std::log2(proc->pdBlockSize / 64)) + 1;
+        blockSizeValue.addListener(this);
+        
+        sampleAccurateMidiValue = proc->sampleAccurateMidi.load();
+        sampleAccurateMidiValue.addListener(this);
+        
+        oversamplingFilterValue = proc->oversamplingFilter + 1;
+        oversamplingFilterValue.addListener(this);
         
+        autoSleepValue = proc->autoSleep.load();
+        autoSleepValue.addListener(this);
     }
     
     void resized() override
@@ -1266,13 +1354,33 @@ struct DAWAudioSettings : public Component, public Value::Listener {
         latencyNumberBox.setBounds(bounds.removeFromTop(23));
         tailLengthNumberBox.setBounds(bounds.removeFromTop(23));
         nativeDialogToggle.setBounds(bounds.removeFromTop(23));
+        blockSizeSelector.setBounds(bounds.removeFromTop(23));
+        sampleAccurateMidiToggle.setBounds(bounds.removeFromTop(23));
+        oversamplingFilterSelector.setBounds(bounds.removeFromTop(23));
+        autoSleepToggle.setBounds(bounds.removeFromTop(23));
     }
     
     
     void valueChanged(Value& v) override
     {
         if(v.refersToSameSourceAs(latencyValue)) {
-            processor.setLatencySamples(static_cast<int>(latencyValue.getValue()));
+            dynamic_cast<PlugDataAudioProcessor*>(&processor)->setLatency(static_cast<int>(latencyValue.getValue()));
+        }
+        else if(v.refersToSameSourceAs(blockSizeValue)) {
+            auto* proc = dynamic_cast<PlugDataAudioProcessor*>(&processor);
+            proc->setPdBlockSize(64 << (static_cast<int>(blockSizeValue.getValue()) - 1));
+            
+            dynamic_cast<DraggableNumber*>(latencyNumberBox.label.get())->setMinimum(proc->pdBlockSize);
+            latencyValue = proc->getLatency();
+        }
+        else if(v.refersToSameSourceAs(sampleAccurateMidiValue)) {
+            dynamic_cast<PlugDataAudioProcessor*>(&processor)->setSampleAccurateMidi(static_cast<bool>(sampleAccurateMidiValue.getValue()));
+        }
+        else if(v.refersToSameSourceAs(oversamplingFilterValue)) {
+            dynamic_cast<PlugDataAudioProcessor*>(&processor)->setOversamplingFilter(static_cast<int>(oversamplingFilterValue.getValue()) - 1);
+        }
+        else if(v.refersToSameSourceAs(autoSleepValue)) {
+            dynamic_cast<PlugDataAudioProcessor*>(&processor)->setAutoSleep(static_cast<bool>(autoSleepValue.getValue()));
         }
     }
     
@@ -1281,10 +1389,18 @@ struct DAWAudioSettings : public Component, public Value::Listener {
     Value latencyValue;
     Value tailLengthValue;
     Value nativeDialogValue;
+    Value blockSizeValue;
+    Value sampleAccurateMidiValue;
+    Value oversamplingFilterValue;
+    Value autoSleepValue;
     
     PropertiesPanel::EditableComponent<int> latencyNumberBox = PropertiesPanel::EditableComponent<int>("Latency (samples)", latencyValue);
     PropertiesPanel::EditableComponent<float> tailLengthNumberBox = PropertiesPanel::EditableComponent<float>("Tail Length (seconds)", tailLengthValue);
     PropertiesPanel::BoolComponent nativeDialogToggle = PropertiesPanel::BoolComponent("Use Native Dialog", tailLengthValue,  {"No", "Yes"});
+    PropertiesPanel::ComboComponent blockSizeSelector = PropertiesPanel::ComboComponent("Pd Block Size", blockSizeValue, {"64", "128", "256", "512"});
+    PropertiesPanel::BoolComponent sampleAccurateMidiToggle = PropertiesPanel::BoolComponent("Sample Accurate MIDI", sampleAccurateMidiValue, {"No", "Yes"});
+    PropertiesPanel::ComboComponent oversamplingFilterSelector = PropertiesPanel::ComboComponent("Oversampling Filter", oversamplingFilterValue, {"IIR", "FIR", "FIR (Max Quality)"});
+    PropertiesPanel::BoolComponent autoSleepToggle = PropertiesPanel::BoolComponent("Sleep When Silent", autoSleepValue, {"No", "Yes"});
 };
 
 #endif
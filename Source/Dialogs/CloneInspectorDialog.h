@@ -0,0 +1,245 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <m_pd.h>
+#include <g_canvas.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+
+#include "x_libpd_extra_utils.h"
+
+extern "C" {
+t_glist* clone_get_instance(t_gobj*, int);
+int clone_get_n(t_gobj*);
+}
+
+// Live values of the GUI objects in every instance of a [clone], one row per instance
+// All instances are read in one job on pd's thread per frame, instead of building a canvas for each of them
+// Only the objects in the top level of the abstraction are shown, the ones whose value can be read without their GUI
+struct CloneInspector : public Component {
+
+    CloneInspector(PlugDataPluginEditor* pluginEditor, void* clonePtr, String const& abstractionName, int firstVoice)
+        : editor(pluginEditor)
+        , clone(clonePtr)
+        , name(abstractionName)
+        , startVoice(firstVoice)
+    {
+        findColumns();
+
+        viewport.setViewedComponent(&table, false);
+        viewport.setScrollBarsShown(true, true);
+        addAndMakeVisible(viewport);
+
+        editor->repaintScheduler.addFrameCallback(this, 30.0, [this]() { return poll(); });
+    }
+
+    ~CloneInspector() override
+    {
+        editor->repaintScheduler.removeFrameCallback(this);
+    }
+
+    void paint(Graphics& g) override
+    {
+        auto* lnf = dynamic_cast<PlugDataLook*>(&getLookAndFeel());
+        if (!lnf)
+            return;
+
+        auto bounds = getLocalBounds().reduced(20, 15);
+
+        g.setColour(findColour(PlugDataColour::panelTextColourId));
+        g.setFont(lnf->boldFont.withHeight(16));
+        g.drawText("Instances of " + name, bounds.removeFromTop(30), Justification::centredLeft);
+
+        if (columns.empty()) {
+            g.setColour(findColour(PlugDataColour::panelTextColourId).withAlpha(0.6f));
+            g.setFont(lnf->defaultFont.withHeight(14));
+            g.drawText("No toggles, sliders, number boxes, radios or atoms in this abstraction", bounds.removeFromTop(rowHeight), Justification::centredLeft);
+        }
+    }
+
+    void resized() override
+    {
+        viewport.setBounds(getLocalBounds().reduced(20, 15).withTrimmedTop(35));
+        table.setSize(std::max(voiceWidth + static_cast<int>(columns.size()) * columnWidth, viewport.getMaximumVisibleWidth()), (numInstances + 1) * rowHeight);
+    }
+
+    static constexpr int rowHeight = 24;
+
+private:
+    struct Column {
+        int index; // position in the canvas' object list
+        String label;
+    };
+
+    struct Table : public Component {
+        explicit Table(CloneInspector& parent)
+            : inspector(parent)
+        {
+        }
+
+        void paint(Graphics& g) override
+        {
+            auto* lnf = dynamic_cast<PlugDataLook*>(&getLookAndFeel());
+            if (!lnf)
+                return;
+
+            auto const numColumns = static_cast<int>(inspector.columns.size());
+            auto const& values = inspector.values;
+
+            g.setColour(findColour(PlugDataColour::panelTextColourId));
+            g.setFont(lnf->boldFont.withHeight(13));
+            g.drawText("Voice", 0, 0, voiceWidth, rowHeight, Justification::centredLeft);
+
+            for (int col = 0; col < numColumns; col++) {
+                g.drawText(inspector.columns[col].label, voiceWidth + col * columnWidth, 0, columnWidth - 6, rowHeight, Justification::centredRight, true);
+            }
+
+            g.setFont(lnf->defaultFont.withHeight(13));
+
+            // Only the rows in view are drawn, clones can have hundreds of instances
+            auto const clip = g.getClipBounds();
+            auto const firstRow = std::max(0, clip.getY() / rowHeight - 1);
+            auto const lastRow = std::min(inspector.numInstances, clip.getBottom() / rowHeight);
+
+            for (int row = firstRow; row < lastRow; row++) {
+                auto const y = (row + 1) * rowHeight;
+
+                if (row % 2 == 0) {
+                    g.setColour(findColour(PlugDataColour::panelTextColourId).withAlpha(0.05f));
+                    g.fillRect(0, y, getWidth(), rowHeight);
+                }
+
+                g.setColour(findColour(PlugDataColour::panelTextColourId).withAlpha(0.6f));
+                g.drawText(String(row + inspector.startVoice), 0, y, voiceWidth, rowHeight, Justification::centredLeft);
+
+                g.setColour(findColour(PlugDataColour::panelTextColourId));
+                for (int col = 0; col < numColumns; col++) {
+                    auto const idx = static_cast<size_t>(row * numColumns + col);
+                    if (idx >= values.size() || std::isnan(values[idx]))
+                        continue;
+
+                    g.drawText(String(values[idx]), voiceWidth + col * columnWidth, y, columnWidth - 6, rowHeight, Justification::centredRight);
+                }
+            }
+        }
+
+        CloneInspector& inspector;
+    };
+
+    // The instances are copies of the same abstraction, so the first one tells where the objects are in all of them
+    void findColumns()
+    {
+        auto& pd = editor->pd;
+        std::map<String, int> classCounts;
+
+        pd.setThis();
+        pd.getCallbackLock()->enter();
+
+        auto* gobj = static_cast<t_gobj*>(clone);
+        numInstances = clone_get_n(gobj);
+
+        if (numInstances > 0) {
+            int index = 0;
+            for (t_gobj* y = clone_get_instance(gobj, 0)->gl_list; y; y = y->g_next, index++) {
+                t_float value;
+                if (!libpd_get_gui_value(y, &value))
+                    continue;
+
+                auto const className = String::fromUTF8(libpd_get_object_class_name(y));
+                columns.push_back({ index, className + " " + String(++classCounts[className]) });
+            }
+        }
+
+        pd.getCallbackLock()->exit();
+    }
+
+    // Returns whether anything changed in the last poll that came back, so the frame callback slows down while nothing does
+    bool poll()
+    {
+        if (pollPending || columns.empty())
+            return false;
+
+        pollPending = true;
+
+        std::vector<int> indices;
+        for (auto const& column : columns)
+            indices.push_back(column.index);
+
+        editor->pd.enqueueBulkFunction(
+            [_this = SafePointer(this), gobj = static_cast<t_gobj*>(clone), indices = std::move(indices)]() {
+                if (!_this)
+                    return;
+
+                auto const numColumns = indices.size();
+                auto const n = clone_get_n(gobj);
+                std::vector<float> result(static_cast<size_t>(n) * numColumns, std::numeric_limits<float>::quiet_NaN());
+
+                // The indices are in order, so every instance is walked once
+                for (int i = 0; i < n; i++) {
+                    auto* y = clone_get_instance(gobj, i)->gl_list;
+                    int position = 0;
+
+                    for (size_t col = 0; col < numColumns && y; col++) {
+                        while (y && position < indices[col]) {
+                            y = y->g_next;
+                            position++;
+                        }
+
+                        t_float value;
+                        if (y && libpd_get_gui_value(y, &value))
+                            result[i * numColumns + col] = value;
+                    }
+                }
+
+                MessageManager::callAsync([_this, n, result = std::move(result)]() mutable {
+                    if (!_this)
+                        return;
+
+                    _this->pollPending = false;
+
+                    // NaN never compares equal, so empty cells are compared by their bits
+                    _this->lastPollChanged = n != _this->numInstances || result.size() != _this->values.size() || std::memcmp(result.data(), _this->values.data(), result.size() * sizeof(float)) != 0;
+
+                    if (!_this->lastPollChanged)
+                        return;
+
+                    auto const resized = n != _this->numInstances;
+                    _this->numInstances = n;
+                    _this->values = std::move(result);
+
+                    if (resized)
+                        _this->resized();
+
+                    _this->table.repaint();
+                });
+            });
+
+        return lastPollChanged;
+    }
+
+    static constexpr int voiceWidth = 60;
+    static constexpr int columnWidth = 80;
+
+    PlugDataPluginEditor* editor;
+    void* clone;
+    String name;
+    int startVoice;
+
+    std::vector<Column> columns;
+    int numInstances = 0;
+
+    // Row by row, NaN where an instance doesn't have the object
+    std::vector<float> values;
+
+    bool pollPending = false;
+    bool lastPollChanged = true;
+
+    Table table { *this };
+    Viewport viewport;
+};
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include "../Utility/Tracer.h"
+
 struct Spinner : public Component
 , public Timer {
     bool isSpinning = false;
@@ -60,6 +62,101 @@ struct PackageInfo {
 // Array with package info to store the result of a search action in
 using PackageList = Array<PackageInfo>;
 
+// Lookup tables over the objects of all packages, built once when the package list changes
+// Exact names are found by hash, substrings through trigrams of the object names
+struct PackageIndex {
+
+    PackageIndex() = default;
+
+    explicit PackageIndex(PackageList const& packages)
+    {
+        for (int i = 0; i < packages.size(); i++) {
+            for (auto const& object : packages.getReference(i).objects) {
+                packagesByObject[object].addIfNotAlreadyThere(i);
+
+                auto entry = static_cast<int>(objects.size());
+                objects.emplace_back(object, i);
+
+                forEachTrigram(object, [this, entry](uint64 trigram) {
+                    auto& entries = objectsByTrigram[trigram];
+                    if (entries.empty() || entries.back() != entry)
+                        entries.push_back(entry);
+                });
+            }
+        }
+    }
+
+    // Packages that provide an object with exactly this name
+    Array<int> getPackagesProviding(String const& objectName) const
+    {
+        auto it = packagesByObject.find(objectName);
+        return it != packagesByObject.end() ? it->second : Array<int>();
+    }
+
+    // Packages with an object name that contains the query, in package order
+    Array<int> getPackagesWithObjectContaining(String const& query) const
+    {
+        Array<int> result;
+        auto addIfMatching = [this, &query, &result](int entry) {
+            auto const& [object, package] = objects[entry];
+            if (object.contains(query))
+                result.addIfNotAlreadyThere(package);
+        };
+
+        if (query.length() < 3) {
+            for (int i = 0; i < static_cast<int>(objects.size()); i++)
+                addIfMatching(i);
+
+            return result;
+        }
+
+        // Every match contains all trigrams of the query, so only the shortest posting list has to be checked
+        std::vector<int> const* candidates = nullptr;
+        bool missing = false;
+        forEachTrigram(query, [this, &candidates, &missing](uint64 trigram) {
+            auto it = objectsByTrigram.find(trigram);
+            if (it == objectsByTrigram.end()) {
+                missing = true;
+            } else if (!candidates || it->second.size() < candidates->size()) {
+                candidates = &it->second;
+            }
+        });
+
+        if (missing || !candidates)
+            return result;
+
+        for (auto entry : *candidates)
+            addIfMatching(entry);
+
+        return result;
+    }
+
+private:
+    template<typename Callback>
+    static void forEachTrigram(String const& text, Callback&& callback)
+    {
+        auto t = text.getCharPointer();
+        if (t.isEmpty())
+            return;
+
+        uint64 a = t.getAndAdvance();
+        if (t.isEmpty())
+            return;
+
+        uint64 b = t.getAndAdvance();
+        while (!t.isEmpty()) {
+            uint64 c = t.getAndAdvance();
+            callback((a << 42) | (b << 21) | c);
+            a = b;
+            b = c;
+        }
+    }
+
+    std::unordered_map<String, Array<int>> packagesByObject;
+    std::vector<std::pair<String, int>> objects;
+    std::unordered_map<uint64, std::vector<int>> objectsByTrigram;
+};
+
 struct PackageSorter {
     static void sort(ValueTree& packageState)
     {
@@ -76,30 +173,27 @@ struct PackageSorter {
 struct PackageManager : public Thread
 , public ActionBroadcaster
 , public ValueTree::Listener
-, public DeletedAtShutdown {
+, public DeletedAtShutdown
+, private AsyncUpdater
+, private Timer {
     
+    // Downloads into a partial file next to the install folder, so archives never have to fit in memory
+    // Interrupted downloads continue where they stopped with a range request
     struct DownloadTask : public Thread {
         PackageManager& manager;
         PackageInfo packageInfo;
         
-        std::unique_ptr<InputStream> instream;
+        File partialFile;
+        bool started = false;
+        
+        static constexpr int maxAttempts = 3;
         
         DownloadTask(PackageManager& m, PackageInfo& info)
         : Thread("Download Thread")
         , manager(m)
         , packageInfo(info)
+        , partialFile(filesystem.getChildFile(".downloads").getChildFile(String::toHexString(info.packageId.hashCode64()) + ".part"))
         {
-            int statusCode = 0;
-            instream = URL(info.url).createInputStream(URL::InputStreamOptions(URL::ParameterHandling::inAddress)
-                                                       .withConnectionTimeoutMs(5000)
-                                                       .withStatusCode(&statusCode));
-            
-            if (instream != nullptr && statusCode == 200) {
-                startThread();
-            } else {
-                finish(Result::fail("Failed to start download"));
-                return;
-            }
         };
         
         ~DownloadTask()
@@ -107,37 +201,41 @@ struct PackageManager : public Thread
             stopThread(-1);
         }
         
+        void start()
+        {
+            started = true;
+            startThread();
+        }
+        
         void run() override
         {
-            MemoryBlock dekData;
-            
-            int64 totalBytes = instream->getTotalLength();
-            int64 bytesDownloaded = 0;
-            
-            MemoryOutputStream mo(dekData, true);
+            TRACE_ZONE("Deken download");
+
+            partialFile.getParentDirectory().createDirectory();
             
-            while (true) {
+            auto result = Result::fail("Failed to start download");
+            for (int attempt = 0; attempt < maxAttempts; attempt++) {
                 if (threadShouldExit()) {
                     finish(Result::fail("Download cancelled"));
                     return;
                 }
                 
-                auto written = mo.writeFromInputStream(*instream, 8192);
-                
-                if (written == 0)
+                result = download();
+                if (result.wasOk() || result.getErrorMessage() == "Download cancelled")
                     break;
                 
-                bytesDownloaded += written;
-                
-                float progress = static_cast<long double>(bytesDownloaded) / static_cast<long double>(totalBytes);
-                
-                MessageManager::callAsync([this, progress]() mutable {
-                    onProgress(progress);
-                });
+                // Give flaky connections a moment before resuming
+                wait(1000 * (attempt + 1));
             }
             
-            MemoryInputStream input(dekData, false);
-            ZipFile zip(input);
+            if (!result.wasOk()) {
+                // Keep the partial file when cancelled or failed, so the next try can resume it
+                finish(result);
+                return;
+            }
+            
+            // Extracts entry by entry from the file on disk, only the central directory is kept in memory
+            ZipFile zip(partialFile);
             
             /* This check produces false positives sometimes, so I've disabled it
              if (zip.getNumEntries() == 0) {
@@ -146,7 +244,9 @@ struct PackageManager : public Thread
              } */
             
             auto extractedPath = filesystem.getChildFile(packageInfo.name).getFullPathName();
-            auto result = zip.uncompressTo(filesystem);
+            result = zip.uncompressTo(filesystem);
+            
+            partialFile.deleteFile();
             
             if (!result.wasOk()) {
                 finish(result);
@@ -159,18 +259,79 @@ struct PackageManager : public Thread
             finish(Result::ok());
         }
         
+        Result download()
+        {
+            auto offset = partialFile.getSize();
+            
+            int statusCode = 0;
+            auto rangeHeader = offset > 0 ? "Range: bytes=" + String(offset) + "-\r\n" : String();
+            auto instream = URL(packageInfo.url).createInputStream(URL::InputStreamOptions(URL::ParameterHandling::inAddress)
+                                                                       .withExtraHeaders(rangeHeader)
+                                                                       .withConnectionTimeoutMs(5000)
+                                                                       .withStatusCode(&statusCode));
+            
+            // 416 means the partial file already holds everything
+            if (offset > 0 && statusCode == 416)
+                return Result::ok();
+            
+            if (instream == nullptr || (statusCode != 200 && statusCode != 206))
+                return Result::fail("Failed to start download");
+            
+            // The server doesn't do ranges, so start over
+            if (statusCode == 200) {
+                offset = 0;
+                partialFile.deleteFile();
+            }
+            
+            FileOutputStream output(partialFile);
+            if (!output.openedOk())
+                return Result::fail("Couldn't write to " + partialFile.getFullPathName());
+            
+            int64 totalBytes = offset + instream->getTotalLength();
+            int64 bytesDownloaded = offset;
+            
+            while (true) {
+                if (threadShouldExit()) {
+                    return Result::fail("Download cancelled");
+                }
+                
+                auto written = output.writeFromInputStream(*instream, 8192);
+                
+                if (written == 0)
+                    break;
+                
+                bytesDownloaded += written;
+                
+                float progress = static_cast<long double>(bytesDownloaded) / static_cast<long double>(totalBytes);
+                
+                MessageManager::callAsync([this, progress]() mutable {
+                    onProgress(progress);
+                });
+            }
+            
+            output.flush();
+            
+            if (totalBytes > offset && bytesDownloaded < totalBytes)
+                return Result::fail("Download interrupted");
+            
+            return Result::ok();
+        }
+        
         void finish(Result result)
         {
             MessageManager::callAsync(
                                       [this, result]() mutable {
                                           // Make sure lambda still exists after deletion
                                           auto finishCopy = onFinish;
+                                          auto& managerCopy = manager;
                                           waitForThreadToExit(-1);
                                           
                                           // Self-destruct
-                                          manager.downloads.removeObject(this);
+                                          managerCopy.downloads.removeObject(this);
                                           
                                           finishCopy(result);
+                                          
+                                          managerCopy.startQueuedDownloads();
                                       });
         }
         
@@ -201,6 +362,14 @@ struct PackageManager : public Thread
             webstream->cancel();
         downloads.clear();
         stopThread(500);
+
+        // Write the last state right away instead of waiting for the debounce
+        cancelPendingUpdate();
+        stopTimer();
+        savePool.removeAllJobs(false, -1);
+        if (saveNeeded)
+            writePackageState(packageState.toXmlString());
+
         clearSingletonInstance();
     }
     
@@ -212,15 +381,62 @@ struct PackageManager : public Thread
     
     void run() override
     {
+        TRACE_ZONE("Deken update");
+
         // Continue on pipe errors
 #ifndef _MSC_VER
         signal(SIGPIPE, SIG_IGN);
 #endif
-        allPackages = getAvailablePackages();
+        // Show the index from the last session right away, the server is only asked whether it changed
+        auto cache = readCachedIndex();
+        if (cache.data.getSize() > 0 && !hasPackages()) {
+            setPackages(parsePackages(cache.data));
+            sendActionMessage("");
+        }
+
+        if (auto packages = getAvailablePackages(cache)) {
+            setPackages(std::move(*packages));
+        }
+
         sendActionMessage("");
     }
-    
-    PackageList getAvailablePackages()
+
+    struct CachedIndex {
+        MemoryBlock data;
+        String etag;
+        String lastModified;
+    };
+
+    CachedIndex readCachedIndex() const
+    {
+        CachedIndex cache;
+
+        FileInputStream stream(indexCache);
+        if (!stream.openedOk())
+            return cache;
+
+        cache.etag = stream.readString();
+        cache.lastModified = stream.readString();
+        stream.readIntoMemoryBlock(cache.data);
+
+        return cache;
+    }
+
+    void writeCachedIndex(CachedIndex const& cache) const
+    {
+        // Written to a temporary file first, so an interrupted write never leaves a broken cache behind
+        TemporaryFile temp(indexCache);
+        if (auto stream = temp.getFile().createOutputStream()) {
+            stream->writeString(cache.etag);
+            stream->writeString(cache.lastModified);
+            stream->write(cache.data.getData(), cache.data.getSize());
+            stream.reset();
+            temp.overwriteTargetFileWithTemporary();
+        }
+    }
+
+    // Returns nothing if the cached index is still up to date or the server can't be reached
+    std::optional<PackageList> getAvailablePackages(CachedIndex const& cache)
     {
         
         // plugdata's deken servers, hosted on github
@@ -231,16 +447,54 @@ struct PackageManager : public Thread
         auto repoForArchitecture = "https://raw.githubusercontent.com/plugdata-team/plugdata-deken/main/bin/" + triplet + ".bin";
         
         webstream = std::make_unique<WebInputStream>(URL(repoForArchitecture), false);
+
+        // Revalidate the cached index, the server answers with 304 if it didn't change
+        if (cache.data.getSize() > 0) {
+            String headers;
+            if (cache.etag.isNotEmpty())
+                headers << "If-None-Match: " << cache.etag << "\r\n";
+            if (cache.lastModified.isNotEmpty())
+                headers << "If-Modified-Since: " << cache.lastModified << "\r\n";
+
+            webstream->withExtraHeaders(headers);
+        }
+
         webstream->connect(nullptr);
         
+        // Offline, but the cached index is still usable
         if (webstream->isError()) {
-            sendActionMessage("Failed to connect to server");
-            return {};
+            if (cache.data.getSize() == 0)
+                sendActionMessage("Failed to connect to server");
+            return std::nullopt;
         }
+
+        if (webstream->getStatusCode() == 304)
+            return std::nullopt;
         
-        MemoryBlock block;
-        webstream->readIntoMemoryBlock(block);
-        
+        CachedIndex newCache;
+        webstream->readIntoMemoryBlock(newCache.data);
+
+        if (webstream->getStatusCode() != 200 || newCache.data.getSize() == 0) {
+            if (cache.data.getSize() == 0)
+                sendActionMessage("Failed to connect to server");
+            return std::nullopt;
+        }
+
+        auto responseHeaders = webstream->getResponseHeaders();
+        for (auto const& key : responseHeaders.getAllKeys()) {
+            if (key.equalsIgnoreCase("ETag"))
+                newCache.etag = responseHeaders[key];
+            else if (key.equalsIgnoreCase("Last-Modified"))
+                newCache.lastModified = responseHeaders[key];
+        }
+
+        writeCachedIndex(newCache);
+
+        return parsePackages(newCache.data);
+    }
+
+    static PackageList parsePackages(MemoryBlock const& block)
+    {
         // Parse tree that was downloaded
         auto tree = ValueTree::readFromData(block.getData(), block.getSize());
         
@@ -268,21 +522,80 @@ struct PackageManager : public Thread
         
         return packages;
     }
+
+    void setPackages(PackageList packages)
+    {
+        // Built before taking the lock, so searches don't wait for it
+        PackageIndex index(packages);
+
+        ScopedLock lock(packageLock);
+        allPackages = std::move(packages);
+        packageIndex = std::move(index);
+    }
+
+    // Packages that provide an object called objectName, for suggesting where unknown objects might come from
+    PackageList findPackagesProviding(String const& objectName) const
+    {
+        ScopedLock lock(packageLock);
+
+        PackageList result;
+        for (auto idx : packageIndex.getPackagesProviding(objectName))
+            result.add(allPackages.getReference(idx));
+
+        return result;
+    }
+
+    bool hasPackages() const
+    {
+        ScopedLock lock(packageLock);
+        return !allPackages.isEmpty();
+    }
     
-    // When a property in our pkginfo changes, save it immediately
+    // When pkginfo changes, save it once the changes have settled
     void valueTreePropertyChanged(ValueTree& treeWhosePropertyHasChanged, Identifier const& property) override
     {
-        pkgInfo.replaceWithText(packageState.toXmlString());
+        scheduleSave();
     }
     
     void valueTreeChildAdded(ValueTree& parentTree, ValueTree& childWhichHasBeenAdded) override
     {
-        pkgInfo.replaceWithText(packageState.toXmlString());
+        scheduleSave();
     }
     
     void valueTreeChildRemoved(ValueTree& parentTree, ValueTree& childWhichHasBeenRemoved, int indexFromWhichChildWasRemoved) override
     {
-        pkgInfo.replaceWithText(packageState.toXmlString());
+        scheduleSave();
+    }
+
+    // Changes can come from the download threads, the timer gets started from the message thread
+    void scheduleSave()
+    {
+        saveNeeded = true;
+        triggerAsyncUpdate();
+    }
+
+    void handleAsyncUpdate() override
+    {
+        startTimer(saveDelayMs);
+    }
+
+    void timerCallback() override
+    {
+        stopTimer();
+        saveNeeded = false;
+
+        // Serialised here, written to disk on the save thread
+        savePool.addJob([this, xml = packageState.toXmlString()]() {
+            writePackageState(xml);
+        });
+    }
+
+    // Written to a temporary file first, so a crash while saving never leaves a broken pkginfo behind
+    void writePackageState(String const& xml) const
+    {
+        TemporaryFile temp(pkgInfo);
+        if (temp.getFile().replaceWithText(xml))
+            temp.overwriteTargetFileWithTemporary();
     }
     
     void uninstall(PackageInfo& packageInfo)
@@ -299,8 +612,32 @@ struct PackageManager : public Thread
     {
         // Make sure https is used
         packageInfo.url = packageInfo.url.replaceFirstOccurrenceOf("http://", "https://");
-        return downloads.add(new DownloadTask(*this, packageInfo));
+        auto* task = downloads.add(new DownloadTask(*this, packageInfo));
+        startQueuedDownloads();
+        return task;
     }
+
+    // Runs at most maxConcurrentDownloads at the same time, the rest wait in order
+    void startQueuedDownloads()
+    {
+        int numRunning = 0;
+        for (auto* download : downloads) {
+            if (download->started)
+                numRunning++;
+        }
+
+        for (auto* download : downloads) {
+            if (numRunning >= maxConcurrentDownloads)
+                break;
+
+            if (!download->started) {
+                download->start();
+                numRunning++;
+            }
+        }
+    }
+
+    static constexpr int maxConcurrentDownloads = 3;
     
     void addPackageToRegister(PackageInfo const& info, String path)
     {
@@ -337,15 +674,26 @@ struct PackageManager : public Thread
         return nullptr;
     }
     
+    // Written from the update thread, hold packageLock when reading it
     PackageList allPackages;
+    PackageIndex packageIndex;
+    CriticalSection packageLock;
     
     inline static File filesystem = File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory).getChildFile("plugdata").getChildFile("Deken");
     
     // Package info file
     File pkgInfo = filesystem.getChildFile(".pkg_info");
+
+    // Last downloaded package index, with the headers to revalidate it
+    File indexCache = filesystem.getChildFile(".index_cache");
     
     // Package state tree, keeps track of which packages are installed and saves it to pkgInfo
     ValueTree packageState = ValueTree("pkg_info");
+
+    // Saves are combined when many properties change in a row
+    static constexpr int saveDelayMs = 500;
+    std::atomic<bool> saveNeeded = false;
+    ThreadPool savePool = ThreadPool(1);
     
     // Thread for unzipping and installing packages
     OwnedArray<DownloadTask> downloads;
@@ -493,7 +841,8 @@ public:
             showError("");
         }
         
-        if (running) {
+        // With a cached index, packages can be searched while it is being refreshed
+        if (running && !packageManager->hasPackages()) {
             
             input.setText("Updating packages...");
             input.setEnabled(false);
@@ -606,6 +955,7 @@ public:
             return;
         }
         
+        ScopedLock lock(packageManager->packageLock);
         auto& allPackages = packageManager->allPackages;
         
         // First check for name match
@@ -622,11 +972,11 @@ public:
             }
         }
         
+        auto const& packageIndex = packageManager->packageIndex;
+
         // Then check for object match
-        for (auto const& result : allPackages) {
-            if (result.objects.contains(query)) {
-                newResult.addIfNotAlreadyThere(result);
-            }
+        for (auto idx : packageIndex.getPackagesProviding(query)) {
+            newResult.addIfNotAlreadyThere(allPackages.getReference(idx));
         }
         
         // Then check for author match
@@ -637,12 +987,8 @@ public:
         }
         
         // Then check for object close match
-        for (auto const& result : allPackages) {
-            for (auto const& obj : result.objects) {
-                if (obj.contains(query)) {
-                    newResult.addIfNotAlreadyThere(result);
-                }
-            }
+        for (auto idx : packageIndex.getPackagesWithObjectContaining(query)) {
+            newResult.addIfNotAlreadyThere(allPackages.getReference(idx));
         }
         
         // Downloads are already always visible, so filter them out here
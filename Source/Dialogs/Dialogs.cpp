@@ -15,6 +15,8 @@
 #include "SettingsDialog.h"
 #include "TextEditorDialog.h"
 #include "HeavyExportDialog.h"
+#include "MemoryDialog.h"
+#include "CloneInspectorDialog.h"
 #include "Canvas.h"
 
 Component* Dialogs::showTextEditorDialog(String text, String filename, std::function<void(String, bool)> callback)
@@ -186,6 +188,27 @@ void Dialogs::showHeavyExportDialog(std::unique_ptr<Dialog>* target, Component*
     target->reset(dialog);
 }
 
+void Dialogs::showMemoryDialog(std::unique_ptr<Dialog>* target, PlugDataPluginEditor* parent)
+{
+    auto* dialog = new Dialog(target, parent, 560, 60 + 7 * MemoryDialog::rowHeight, parent->getBounds().getCentreY() + 120, true);
+    auto* dialogContent = new MemoryDialog(parent);
+
+    dialog->setViewedComponent(dialogContent);
+    target->reset(dialog);
+}
+
+void Dialogs::showCloneInspector(std::unique_ptr<Dialog>* target, PlugDataPluginEditor* parent, void* clone, String const& name, int firstVoice)
+{
+    if (*target)
+        return;
+
+    auto* dialog = new Dialog(target, parent, 560, 60 + 16 * CloneInspector::rowHeight, parent->getBounds().getCentreY() + 240, true);
+    auto* dialogContent = new CloneInspector(parent, clone, name, firstVoice);
+
+    dialog->setViewedComponent(dialogContent);
+    target->reset(dialog);
+}
+
 StringArray DekenInterface::getExternalPaths()
 {
     StringArray searchPaths;
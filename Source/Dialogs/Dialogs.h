@@ -117,6 +117,11 @@ struct Dialogs {
     static void showOkayCancelDialog(std::unique_ptr<Dialog>* target, Component* parent, const String& title, std::function<void(bool)> callback);
     
     static void showHeavyExportDialog(std::unique_ptr<Dialog>* target, Component* parent);
+
+    static void showMemoryDialog(std::unique_ptr<Dialog>* target, PlugDataPluginEditor* parent);
+
+    // Table of the GUI values in all instances of a [clone], firstVoice is the number of the first instance
+    static void showCloneInspector(std::unique_ptr<Dialog>* target, PlugDataPluginEditor* parent, void* clone, String const& name, int firstVoice);
 };
 
 
@@ -88,28 +88,7 @@ struct ToolchainInstaller : public Component, public Thread, public Timer
             errorMessage = "";
             repaint();
 
-            // Get latest version
-            auto latestVersion = "v" + URL("https://raw.githubusercontent.com/timothyschoen/HeavyDistributable/main/VERSION").readEntireTextStream().trim();
-
-            if(latestVersion == "v") {
-                errorMessage = "Error: Could not download files (possibly no network connection)";
-                installButton.topText = "Try Again";
-                repaint();
-            }
-
-            String downloadLocation = "https://github.com/timothyschoen/HeavyDistributable/releases/download/" + latestVersion + "/";
-
-#if JUCE_MAC
-            downloadLocation += "Heavy-MacOS-Universal.zip";
-#elif JUCE_WINDOWS
-            downloadLocation += "Heavy-Win64.zip";
-#elif JUCE_LINUX && !__aarch64__
-            downloadLocation += "Heavy-Linux-x64.zip";
-#endif
-
-            instream = URL(downloadLocation).createInputStream(URL::InputStreamOptions(URL::ParameterHandling::inAddress)
-                                                               .withConnectionTimeoutMs(5000)
-                                                               .withStatusCode(&statusCode));
+            // Downloading happens on the installer thread, so the dialog stays responsive
             startThread();
         };
     }
@@ -184,49 +163,109 @@ struct ToolchainInstaller : public Component, public Thread, public Timer
         
     #endif
         
-        MemoryBlock toolchainData;
+        auto fail = [this](String const& message) {
+            MessageManager::callAsync([this, message](){
+                installButton.topText = "Try Again";
+                errorMessage = message;
+                repaint();
+                stopTimer();
+            });
+        };
 
-        if(!instream) return; // error!
+        // Get latest version
+        auto latestVersion = "v" + URL("https://raw.githubusercontent.com/timothyschoen/HeavyDistributable/main/VERSION").readEntireTextStream().trim();
 
-        int64 totalBytes = instream->getTotalLength();
-        int64 bytesDownloaded = 0;
+        if(latestVersion == "v") {
+            fail("Error: Could not download files (possibly no network connection)");
+            return;
+        }
 
-        MemoryOutputStream mo(toolchainData, true);
+        String downloadLocation = "https://github.com/timothyschoen/HeavyDistributable/releases/download/" + latestVersion + "/";
 
-        while (true) {
-            if (threadShouldExit()) return;
+#if JUCE_MAC
+        downloadLocation += "Heavy-MacOS-Universal.zip";
+#elif JUCE_WINDOWS
+        downloadLocation += "Heavy-Win64.zip";
+#elif JUCE_LINUX && !__aarch64__
+        downloadLocation += "Heavy-Linux-x64.zip";
+#endif
 
-            auto written = mo.writeFromInputStream(*instream, 8192);
+        // The archive goes to disk instead of memory, a partial download of the same version is resumed
+        auto archive = downloadFolder.getChildFile("Toolchain-" + latestVersion + ".zip");
+        downloadFolder.createDirectory();
+        for (auto const& old : downloadFolder.findChildFiles(File::findFiles, false, "Toolchain-*.zip")) {
+            if (old != archive) old.deleteFile();
+        }
 
-            if (written == 0) break;
+        auto offset = archive.getSize();
+        auto rangeHeader = offset > 0 ? "Range: bytes=" + String(offset) + "-\r\n" : String();
 
-            bytesDownloaded += written;
+        instream = URL(downloadLocation).createInputStream(URL::InputStreamOptions(URL::ParameterHandling::inAddress)
+                                                           .withExtraHeaders(rangeHeader)
+                                                           .withConnectionTimeoutMs(5000)
+                                                           .withStatusCode(&statusCode));
 
-            float progress = static_cast<long double>(bytesDownloaded) / static_cast<long double>(totalBytes);
+        // 416: the partial file is already complete
+        if (!(offset > 0 && statusCode == 416)) {
+            if(!instream || (statusCode != 200 && statusCode != 206)) {
+                fail("Error: Could not download files (possibly no network connection)");
+                return;
+            }
 
-            MessageManager::callAsync([this, progress]() mutable {
-                installProgress = progress;
-                repaint();
-            });
+            if (statusCode == 200) {
+                offset = 0;
+                archive.deleteFile();
+            }
+
+            FileOutputStream output(archive);
+            if (!output.openedOk()) {
+                fail("Error: Could not write to " + archive.getFullPathName());
+                return;
+            }
+
+            int64 totalBytes = offset + instream->getTotalLength();
+            int64 bytesDownloaded = offset;
+
+            while (true) {
+                if (threadShouldExit()) return;
+
+                auto written = output.writeFromInputStream(*instream, 1 << 16);
+
+                if (written == 0) break;
+
+                bytesDownloaded += written;
+
+                float progress = static_cast<long double>(bytesDownloaded) / static_cast<long double>(totalBytes);
+
+                MessageManager::callAsync([this, progress]() mutable {
+                    installProgress = progress;
+                    repaint();
+                });
+            }
+
+            output.flush();
+
+            // The partial file is kept, the next try continues from here
+            if (totalBytes > offset && bytesDownloaded < totalBytes) {
+                fail("Error: Download was interrupted");
+                return;
+            }
         }
 
+        instream.reset();
         startTimer(25);
 
-        MemoryInputStream input(toolchainData, false);
-        ZipFile zip(input);
+        auto result = extractInParallel(archive, toolchain);
 
-        auto result = zip.uncompressTo(toolchain);
-
-        if (!result.wasOk() || (statusCode >= 400)) {
-            MessageManager::callAsync([this](){
-                installButton.topText = "Try Again";
-                errorMessage = "Error: Could not extract downloaded package";
-                repaint();
-                stopTimer();
-            });
+        if (!result.wasOk()) {
+            // A corrupt archive shouldn't be resumed
+            archive.deleteFile();
+            fail("Error: Could not extract downloaded package");
             return;
         }
 
+        archive.deleteFile();
+
         // Make sure downloaded files have executable permission on unix
 #if JUCE_MAC || JUCE_LINUX || JUCE_BSD
         
@@ -270,7 +309,47 @@ struct ToolchainInstaller : public Component, public Thread, public Timer
         });
     }
 
+    // Entries are extracted by a pool of workers, each opening its own stream on the archive
+    // Directories are created first, so the workers never race to create the same folder
+    Result extractInParallel(File const& archive, File const& destination)
+    {
+        ZipFile zip(archive);
+        auto numEntries = zip.getNumEntries();
+        if (numEntries == 0)
+            return Result::fail("Empty archive");
+
+        for (int i = 0; i < numEntries; i++) {
+            auto const* entry = zip.getEntry(i);
+            auto target = destination.getChildFile(entry->filename);
+            auto directory = !entry->filename.endsWithChar('/') ? target.getParentDirectory() : target;
+            if (!directory.createDirectory())
+                return Result::fail("Can't create " + directory.getFullPathName());
+        }
+
+        std::atomic<int> nextEntry = 0;
+        std::atomic<bool> failed = false;
+        auto const numWorkers = std::max(1, SystemStats::getNumCpus());
+
+        ThreadPool pool(numWorkers);
+        for (int worker = 0; worker < numWorkers; worker++) {
+            pool.addJob([&]() {
+                for (int i = nextEntry++; i < numEntries && !failed; i = nextEntry++) {
+                    if (!zip.uncompressEntry(i, destination).wasOk())
+                        failed = true;
+                }
+            });
+        }
+
+        while (pool.getNumJobs() > 0) {
+            if (threadShouldExit()) failed = true;
+            Thread::sleep(10);
+        }
+
+        return failed ? Result::fail("Extraction failed") : Result::ok();
+    }
+
     inline static File toolchain = File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory).getChildFile("plugdata").getChildFile("Toolchain");
+    inline static File downloadFolder = File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory).getChildFile("plugdata").getChildFile("Downloads");
 
     float installProgress = 0.0f;
 
@@ -445,6 +524,10 @@ struct ExporterSettingsPanel : public Component, public Value::Listener, public
     
     inline static File heavyExecutable = toolchain.getChildFile("bin").getChildFile("Heavy").getChildFile("Heavy" + exeSuffix);
 
+    // Output of earlier hvcc runs, by hash of everything that goes into them
+    inline static File heavyCache = File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory).getChildFile("plugdata").getChildFile("HeavyCache");
+    static constexpr int maxCachedExports = 16;
+
     bool validPatchSelected = false;
 
     std::unique_ptr<FileChooser> saveChooser;
@@ -489,6 +572,7 @@ struct ExporterSettingsPanel : public Component, public Value::Listener, public
         if(auto* cnv = editor->getCurrentCanvas())
         {
             openedPatchFile = File::createTempFile(".pd");
+            cnv->storage.flushInfo();
             openedPatchFile.replaceWithText(cnv->patch.getCanvasContent(), false, false, "\n");
             patchChooser->comboBox.setItemEnabled(1, true);
             patchChooser->comboBox.setSelectedId(1);
@@ -536,6 +620,19 @@ struct ExporterSettingsPanel : public Component, public Value::Listener, public
 
     void startExport(File outDir) {
 
+        // Report unsupported objects right away, instead of after hvcc fails
+        if(patchFile == openedPatchFile) {
+            if(auto* cnv = editor->getCurrentCanvas()) {
+                auto incompatible = Object::findHvccIncompatibleObjects(cnv->patch);
+                if(!incompatible.isEmpty()) {
+                    exportingView->showState(ExportingView::Busy);
+                    exportingView->logToConsole("These objects are not supported by Heavy:\n" + incompatible.joinIntoString("\n") + "\n");
+                    exportingView->showState(ExportingView::Failure);
+                    return;
+                }
+            }
+        }
+
         auto patchPath = patchFile.getFullPathName();
         auto outPath = outDir.getFullPathName();
         auto projectTitle = projectNameValue.toString();
@@ -664,6 +761,122 @@ private:
 
     virtual bool performExport(String pdPatch, String outdir, String name, String copyright, StringArray searchPaths) = 0;
 
+    // Hashes the hvcc arguments, with the contents of the files they refer to
+    // Abstractions are fingerprinted by path, size and modification time, reading all of them would cost more than it saves
+    static String getHeavyCacheKey(StringArray const& args)
+    {
+        String material;
+
+        auto addFileFingerprint = [&material](File const& file) {
+            material << file.getFullPathName() << ":" << file.getSize() << ":" << file.getLastModificationTime().toMilliseconds() << "\n";
+        };
+
+        for (int i = 0; i < args.size(); i++) {
+            auto const& arg = args[i];
+
+            if (i == 0) {
+                // A toolchain update can change the generated code
+                addFileFingerprint(File(arg));
+            } else if (i == 1) {
+                material << "patch:" << File(arg).loadFileAsString() << "\n";
+            } else if (arg.startsWith("-o")) {
+                // The output location doesn't change what gets generated
+                continue;
+            } else if (arg.startsWith("-m")) {
+                material << "meta:" << File(arg.substring(2)).loadFileAsString() << "\n";
+            } else if (arg.startsWith("-p")) {
+                auto searchPath = File(arg.substring(2));
+                material << "path:" << searchPath.getFullPathName() << "\n";
+
+                for (auto const& abstraction : searchPath.findChildFiles(File::findFiles, true, "*.pd"))
+                    addFileFingerprint(abstraction);
+            } else {
+                material << arg << "\n";
+            }
+        }
+
+        return String::toHexString(material.hashCode64()) + String::toHexString(material.length());
+    }
+
+    // Runs hvcc, or copies its output from the cache when the patch, abstractions and settings didn't change since an earlier export
+    int runHeavy(StringArray const& args, String const& outdir)
+    {
+        auto outputDir = File(outdir);
+        auto cached = heavyCache.getChildFile(getHeavyCacheKey(args));
+
+        if (cached.isDirectory()) {
+            exportingView->logToConsole("Reusing generated code from an earlier export\n");
+
+            for (auto const& entry : RangedDirectoryIterator(cached, false, "*", File::findFilesAndDirectories)) {
+                auto const& source = entry.getFile();
+                auto target = outputDir.getChildFile(source.getFileName());
+
+                if (source.isDirectory())
+                    source.copyDirectoryTo(target);
+                else
+                    source.copyFileTo(target);
+            }
+
+            // Recently used entries are kept when the cache gets pruned
+            cached.setLastModificationTime(Time::getCurrentTime());
+            return 0;
+        }
+
+        // Only the files this run creates or changes are stored, the output directory can contain anything else
+        auto startTime = Time::getCurrentTime() - RelativeTime::seconds(2);
+
+        start(args);
+        waitForProcessToFinish(-1);
+
+        // Delay to get correct exit code
+        Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 300);
+
+        auto exitCode = getExitCode();
+        if (exitCode != 0 || shouldQuit)
+            return exitCode;
+
+        auto temp = heavyCache.getChildFile(cached.getFileName() + ".tmp");
+        temp.deleteRecursively();
+        temp.createDirectory();
+
+        for (auto const& entry : RangedDirectoryIterator(outputDir, false, "*", File::findFilesAndDirectories)) {
+            auto const& generated = entry.getFile();
+            if (generated.getLastModificationTime() < startTime)
+                continue;
+
+            if (generated.isDirectory())
+                generated.copyDirectoryTo(temp.getChildFile(generated.getFileName()));
+            else
+                generated.copyFileTo(temp.getChildFile(generated.getFileName()));
+        }
+
+        temp.moveFileTo(cached);
+        pruneHeavyCache();
+
+        return exitCode;
+    }
+
+    // Builds use every core, the working directory is passed to make instead of changed for the whole process
+    // That way exports of different targets can run at the same time
+    static String getMakeJobsFlag()
+    {
+        return "-j" + String(std::max(1, SystemStats::getNumCpus()));
+    }
+
+    static void pruneHeavyCache()
+    {
+        auto entries = heavyCache.findChildFiles(File::findDirectories, false);
+        if (entries.size() <= maxCachedExports)
+            return;
+
+        std::sort(entries.begin(), entries.end(), [](File const& a, File const& b) {
+            return a.getLastModificationTime() > b.getLastModificationTime();
+        });
+
+        for (int i = maxCachedExports; i < entries.size(); i++)
+            entries.getReference(i).deleteRecursively();
+    }
+
 public:
 
 
@@ -703,8 +916,7 @@ public:
 
         if(shouldQuit) return 1;
 
-        start(args);
-        waitForProcessToFinish(-1);
+        auto exitCode = runHeavy(args, outdir);
 
         if(shouldQuit) return 1;
 
@@ -712,10 +924,7 @@ public:
         outputFile.getChildFile("ir").deleteRecursively();
         outputFile.getChildFile("hv").deleteRecursively();
 
-        // Delay to get correct exit code
-        Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 300);
-
-        return getExitCode();
+        return exitCode;
     }
 };
 
@@ -803,18 +1012,12 @@ public:
             args.add("-p" + path);
         }
 
-        start(args);
-        waitForProcessToFinish(-1);
+        int heavyExitCode = runHeavy(args, outdir);
 
         exportingView->logToConsole("Compiling...");
 
         if(shouldQuit) return 1;
 
-        // Delay to get correct exit code
-        Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 300);
-
-        int heavyExitCode = getExitCode();
-
         if(compile) {
 
             auto bin = toolchain.getChildFile("bin");
@@ -829,11 +1032,8 @@ public:
             outputFile.getChildFile("hv").deleteRecursively();
             outputFile.getChildFile("c").deleteRecursively();
 
-            auto workingDir = File::getCurrentWorkingDirectory();
             auto sourceDir = outputFile.getChildFile("daisy").getChildFile("source");
 
-            sourceDir.setAsCurrentWorkingDirectory();
-
             sourceDir.getChildFile("build").createDirectory();
             toolchain.getChildFile("lib").getChildFile("heavy-static.a").copyFileTo(sourceDir.getChildFile("build").getChildFile("heavy-static.a"));
             toolchain.getChildFile("etc").getChildFile("daisy_makefile").copyFileTo(sourceDir.getChildFile("Makefile"));
@@ -880,13 +1080,13 @@ public:
 #if JUCE_WINDOWS
             auto bash = String("#!/bin/bash\n");
             auto buildScript = sourceDir.getChildFile("build.sh");
-            buildScript.replaceWithText(bash + make.getFullPathName().replaceCharacter('\\', '/') + " -j4 -f " + sourceDir.getChildFile("Makefile").getFullPathName().replaceCharacter('\\', '/') + " GCC_PATH=" + gccPath.replaceCharacter('\\', '/') + " PROJECT_NAME=" + name);
+            buildScript.replaceWithText(bash + make.getFullPathName().replaceCharacter('\\', '/') + " " + getMakeJobsFlag() + " -C " + sourceDir.getFullPathName().replaceCharacter('\\', '/') + " -f " + sourceDir.getChildFile("Makefile").getFullPathName().replaceCharacter('\\', '/') + " GCC_PATH=" + gccPath.replaceCharacter('\\', '/') + " PROJECT_NAME=" + name);
 
             auto sh = toolchain.getChildFile("bin").getChildFile("sh.exe");
             
             start(StringArray{sh.getFullPathName(), "--login", buildScript.getFullPathName()});
 #else
-            String command = make.getFullPathName().replaceCharacter('\\', '/') + " -j4 -f " + sourceDir.getChildFile("Makefile").getFullPathName().replaceCharacter('\\', '/') + " GCC_PATH=" + gccPath.replaceCharacter('\\', '/') + " PROJECT_NAME=" + name;
+            String command = make.getFullPathName().replaceCharacter('\\', '/') + " " + getMakeJobsFlag() + " -C " + sourceDir.getFullPathName().replaceCharacter('\\', '/') + " -f " + sourceDir.getChildFile("Makefile").getFullPathName().replaceCharacter('\\', '/') + " GCC_PATH=" + gccPath.replaceCharacter('\\', '/') + " PROJECT_NAME=" + name;
             
             start(command.toRawUTF8());
 #endif
@@ -894,9 +1094,6 @@ public:
 
             waitForProcessToFinish(-1);
 
-            // Restore original working directory
-            workingDir.setAsCurrentWorkingDirectory();
-
             auto binLocation = outputFile.getChildFile(name + ".bin");
             sourceDir.getChildFile("build").getChildFile("Heavy_" + name + ".bin").moveFileTo(binLocation);
 
@@ -1047,8 +1244,7 @@ public:
 
         if(shouldQuit) return 1;
 
-        start(args);
-        waitForProcessToFinish(-1);
+        bool generationExitCode = runHeavy(args, outdir);
 
         if(shouldQuit) return 1;
 
@@ -1059,24 +1255,15 @@ public:
 
         auto DPF = toolchain.getChildFile("lib").getChildFile("dpf");
         DPF.copyDirectoryTo(outputFile.getChildFile("dpf"));
-        
-        // Delay to get correct exit code
-        Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 300);
-        
-        bool generationExitCode = getExitCode();
         // Check if we need to compile
         if(!generationExitCode && static_cast<int>(exportTypeValue.getValue()) == 2)
         {
-            auto workingDir = File::getCurrentWorkingDirectory();
-
-            outputFile.setAsCurrentWorkingDirectory();
-            
             auto bin = toolchain.getChildFile("bin");
             auto make = bin.getChildFile("make" + exeSuffix);
             auto makefile = outputFile.getChildFile("Makefile");
             
 #if JUCE_MAC
-            String command = "make -j4 -f " + makefile.getFullPathName();
+            String command = "make " + getMakeJobsFlag() + " -C " + outputFile.getFullPathName() + " -f " + makefile.getFullPathName();
             start(command.toRawUTF8());
 #elif JUCE_WINDOWS
             auto bash = String("#!/bin/bash\n");
@@ -1086,7 +1273,7 @@ public:
             auto cxx = "CXX=" + toolchain.getChildFile("bin").getChildFile("g++.exe").getFullPathName().replaceCharacter('\\', '/') + " ";
 
             auto buildScript = outputFile.getChildFile("build.sh");
-            buildScript.replaceWithText(bash + changedir + path + cc + cxx + make.getFullPathName().replaceCharacter('\\', '/') + " -j4 -f " + makefile.getFullPathName().replaceCharacter('\\', '/'));
+            buildScript.replaceWithText(bash + changedir + path + cc + cxx + make.getFullPathName().replaceCharacter('\\', '/') + " " + getMakeJobsFlag() + " -f " + makefile.getFullPathName().replaceCharacter('\\', '/'));
 
             auto sh = toolchain.getChildFile("bin").getChildFile("sh.exe");
             String command = sh.getFullPathName() + " --login " + buildScript.getFullPathName().replaceCharacter('\\', '/');
@@ -1099,7 +1286,7 @@ public:
             auto prepareEnvironmentScript = toolchain.getChildFile("scripts").getChildFile("anywhere-setup.sh").getFullPathName() + "\n";
             
             auto buildScript = outputFile.getChildFile("build.sh");
-            buildScript.replaceWithText(bash + changedir + prepareEnvironmentScript + make.getFullPathName() + " -j4 -f " + makefile.getFullPathName(), false, false, "\n");
+            buildScript.replaceWithText(bash + changedir + prepareEnvironmentScript + make.getFullPathName() + " " + getMakeJobsFlag() + " -f " + makefile.getFullPathName(), false, false, "\n");
             
             buildScript.setExecutePermission(true);
             
@@ -1114,8 +1301,6 @@ public:
             // Delay to get correct exit code
             Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 300);
             
-            workingDir.setAsCurrentWorkingDirectory();
-            
             // Copy output
             if(lv2) outputFile.getChildFile("bin").getChildFile(name + ".lv2").copyDirectoryTo(outputFile.getChildFile(name + ".lv2"));
             if(vst3) outputFile.getChildFile("bin").getChildFile(name + ".vst3").copyDirectoryTo(outputFile.getChildFile(name + ".vst3"));
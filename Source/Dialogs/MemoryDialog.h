@@ -0,0 +1,194 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <m_pd.h>
+#include <m_imp.h>
+#include <g_canvas.h>
+
+#include "../Utility/WindowsUtils.h"
+
+#if JUCE_MAC
+#include <mach/mach.h>
+#elif JUCE_LINUX
+#include <unistd.h>
+#endif
+
+// Breaks down the memory used by this plugin instance, to find out what to blame when sessions with many instances run out
+// Most of these are estimates based on the size of the data, allocator overhead isn't included
+struct MemoryDialog : public Component
+    , public Timer {
+
+    MemoryDialog(PlugDataPluginEditor* pluginEditor)
+        : editor(pluginEditor)
+    {
+        update();
+        startTimer(1000);
+    }
+
+    void timerCallback() override
+    {
+        update();
+    }
+
+    void paint(Graphics& g) override
+    {
+        auto* lnf = dynamic_cast<PlugDataLook*>(&getLookAndFeel());
+        if (!lnf)
+            return;
+
+        auto bounds = getLocalBounds().reduced(20, 15);
+
+        g.setColour(findColour(PlugDataColour::panelTextColourId));
+        g.setFont(lnf->boldFont.withHeight(16));
+        g.drawText("Memory usage", bounds.removeFromTop(30), Justification::centredLeft);
+
+        bounds.removeFromTop(5);
+
+        for (auto const& row : rows) {
+            auto rowBounds = bounds.removeFromTop(rowHeight);
+
+            g.setColour(findColour(PlugDataColour::panelTextColourId));
+            g.setFont(lnf->defaultFont.withHeight(14));
+            g.drawText(row.name, rowBounds.removeFromLeft(170), Justification::centredLeft);
+            g.drawText(formatBytes(row.bytes), rowBounds.removeFromLeft(90), Justification::centredRight);
+
+            g.setColour(findColour(PlugDataColour::panelTextColourId).withAlpha(0.6f));
+            g.setFont(lnf->defaultFont.withHeight(12));
+            g.drawText(row.details, rowBounds.withTrimmedLeft(20), Justification::centredLeft, true);
+        }
+    }
+
+    static constexpr int rowHeight = 26;
+
+private:
+    struct Row {
+        String name;
+        size_t bytes;
+        String details;
+    };
+
+    static String formatBytes(size_t bytes)
+    {
+        if (bytes >= 1024 * 1024)
+            return String(bytes / (1024.0 * 1024.0), 1) + " MB";
+
+        return String(bytes / 1024.0, 1) + " KB";
+    }
+
+    static size_t getResidentMemory()
+    {
+#if JUCE_WINDOWS
+        return ::getResidentMemory();
+#elif JUCE_MAC
+        mach_task_basic_info info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+        if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+            return 0;
+
+        return info.resident_size;
+#else
+        long pages = 0, residentPages = 0;
+        auto statm = File("/proc/self/statm").loadFileAsString();
+        if (std::sscanf(statm.toRawUTF8(), "%ld %ld", &pages, &residentPages) != 2)
+            return 0;
+
+        return static_cast<size_t>(residentPages) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    // Adds up the struct sizes of all objects and the sample data of all arrays, subpatches included
+    static void measureCanvas(t_canvas* cnv, size_t& objectBytes, int& numObjects, size_t& arrayBytes, int& numArrays)
+    {
+        for (t_gobj* y = cnv->gl_list; y; y = y->g_next) {
+            auto* pdClass = pd_class(&y->g_pd);
+
+            objectBytes += pdClass->c_size;
+            numObjects++;
+
+            if (pdClass == canvas_class) {
+                measureCanvas(reinterpret_cast<t_canvas*>(y), objectBytes, numObjects, arrayBytes, numArrays);
+            } else if (pdClass == garray_class) {
+                int size = 0;
+                t_word* vec = nullptr;
+                if (garray_getfloatwords(reinterpret_cast<t_garray*>(y), &size, &vec)) {
+                    arrayBytes += static_cast<size_t>(size) * sizeof(t_word);
+                    numArrays++;
+                }
+            }
+        }
+    }
+
+    // Components that are buffered to an image keep one at the resolution they're shown at
+    static void measureComponents(Component* component, int& numComponents, size_t& imageBytes, int& numImages)
+    {
+        numComponents++;
+
+        if (component->getCachedComponentImage()) {
+            auto const scale = Component::getApproximateScaleFactorForComponent(component);
+            imageBytes += static_cast<size_t>(component->getWidth() * scale) * static_cast<size_t>(component->getHeight() * scale) * 4;
+            numImages++;
+        }
+
+        for (auto* child : component->getChildren()) {
+            measureComponents(child, numComponents, imageBytes, numImages);
+        }
+    }
+
+    static size_t measureConsole(pd::Instance::ConsoleMessages const& messages)
+    {
+        size_t bytes = messages.size() * sizeof(std::tuple<String, int, int>);
+        for (size_t i = 0; i < messages.size(); i++) {
+            bytes += std::get<0>(messages[i]).getNumBytesAsUTF8() + 16;
+        }
+        return bytes;
+    }
+
+    void update()
+    {
+        auto& pd = editor->pd;
+
+        size_t objectBytes = 0, arrayBytes = 0;
+        int numObjects = 0, numArrays = 0;
+
+        pd.setThis();
+        pd.getCallbackLock()->enter();
+        for (auto* patch : pd.patches) {
+            if (auto* cnv = patch->getPointer()) {
+                measureCanvas(cnv, objectBytes, numObjects, arrayBytes, numArrays);
+            }
+        }
+        pd.getCallbackLock()->exit();
+
+        int numComponents = 0, numCanvasObjects = 0, numConnections = 0, numImages = 0;
+        size_t imageBytes = 0;
+
+        measureComponents(editor, numComponents, imageBytes, numImages);
+        for (auto* cnv : editor->canvases) {
+            numCanvasObjects += cnv->objects.size();
+            numConnections += cnv->connections.size();
+        }
+
+        auto& messages = pd.getConsoleMessages();
+        auto& history = pd.getConsoleHistory();
+
+        // Roughly what a component with a few listeners and properties costs
+        static constexpr size_t componentBytes = 512;
+
+        rows.clear();
+        rows.push_back({ "Whole process", getResidentMemory(), "resident, all instances" });
+        rows.push_back({ "Pd objects", objectBytes, String(numObjects) + " objects, struct sizes only" });
+        rows.push_back({ "Pd arrays", arrayBytes, String(numArrays) + " arrays" });
+        rows.push_back({ "Object library", pd.objectLibrary.getMemoryUsage(), "search index and documentation" });
+        rows.push_back({ "Console", measureConsole(messages) + measureConsole(history), String(messages.size() + history.size()) + " messages" });
+        rows.push_back({ "Components", numComponents * componentBytes, String(numComponents) + " components, " + String(numCanvasObjects) + " objects, " + String(numConnections) + " connections" });
+        rows.push_back({ "Cached images", imageBytes, String(numImages) + " buffered components" });
+
+        repaint();
+    }
+
+    PlugDataPluginEditor* editor;
+    std::vector<Row> rows;
+};
@@ -202,6 +202,10 @@ struct SettingsPopup : public PopupMenu {
         addItem("Compile", [this, editor]() mutable {
             Dialogs::showHeavyExportDialog(&editor->openedDialog, editor);
         });
+
+        addItem("Memory usage", [this, editor]() mutable {
+            Dialogs::showMemoryDialog(&editor->openedDialog, editor);
+        });
         
 
         addSeparator();
@@ -212,6 +216,25 @@ struct SettingsPopup : public PopupMenu {
             bool ticked = settingsTree.hasProperty("AutoConnect") ? static_cast<bool>(settingsTree.getProperty("AutoConnect")) : false;
             settingsTree.setProperty("AutoConnect", !ticked, nullptr);
         });
+
+        bool hardwareAccelerationEnabled = settingsTree.hasProperty("HardwareAcceleration") ? static_cast<bool>(settingsTree.getProperty("HardwareAcceleration")) : false;
+
+        addItem("Hardware acceleration", true, hardwareAccelerationEnabled, [this]() mutable {
+            bool ticked = settingsTree.hasProperty("HardwareAcceleration") ? static_cast<bool>(settingsTree.getProperty("HardwareAcceleration")) : false;
+            settingsTree.setProperty("HardwareAcceleration", !ticked, nullptr);
+        });
+
+        // Streams the console to rotating log files, for installations that run for a long time
+        bool logToFileEnabled = settingsTree.hasProperty("LogToFile") ? static_cast<bool>(settingsTree.getProperty("LogToFile")) : false;
+
+        addItem("Log console to file", true, logToFileEnabled, [this, &processor]() mutable {
+            bool ticked = settingsTree.hasProperty("LogToFile") ? static_cast<bool>(settingsTree.getProperty("LogToFile")) : false;
+            settingsTree.setProperty("LogToFile", !ticked, nullptr);
+
+            if (auto* pd = dynamic_cast<PlugDataAudioProcessor*>(&processor)) {
+                pd->updateConsoleLogging();
+            }
+        });
         
         addSeparator();
         addItem(5, "Settings");
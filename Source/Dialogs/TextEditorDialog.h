@@ -242,6 +242,13 @@ public:
     int getToken(int row, int col, int defaultIfOutOfBounds) const;
     void clearTokens(int index);
     void applyTokens(int index, Selection zone);
+
+    /** Rows are tokenised again only after they changed. */
+    bool tokensAreDirty(int index) const;
+    void setTokensValid(int index);
+
+    /** The width of a row's text, measured without laying out its glyphs. */
+    float getWidth(int index) const;
     GlyphArrangement getGlyphs(int index,
         float baseline,
         int token,
@@ -268,6 +275,7 @@ private:
         Array<int> tokens;
         bool glyphsAreDirty = true;
         bool tokensAreDirty = true;
+        float width = -1.f;
     };
     mutable Array<Entry> lines;
 };
@@ -368,6 +376,8 @@ public:
     {
         font = fontToUse;
         lines.font = fontToUse;
+        lines.invalidateAll();
+        widestRow = -1.f;
     }
 
     StringArray getText() const;
@@ -511,7 +521,10 @@ private:
     friend class PlugDataTextEditor;
 
     float lineSpacing = 1.25f;
-    mutable Rectangle<float> cachedBounds;
+
+    // Width of the widest row, or negative if it needs to be measured again
+    // Edits only measure the rows they insert, all rows are only measured again when the widest one was removed
+    mutable float widestRow = -1.f;
     GlyphArrangementArray lines;
     Font font;
     Array<Selection> selections;
@@ -1057,6 +1070,29 @@ GlyphArrangement GlyphArrangementArray::getGlyphs(int index,
     return glyphs;
 }
 
+bool GlyphArrangementArray::tokensAreDirty(int index) const
+{
+    return isPositiveAndBelow(index, lines.size()) && lines.getReference(index).tokensAreDirty;
+}
+
+void GlyphArrangementArray::setTokensValid(int index)
+{
+    if (isPositiveAndBelow(index, lines.size()))
+        lines.getReference(index).tokensAreDirty = false;
+}
+
+float GlyphArrangementArray::getWidth(int index) const
+{
+    if (!isPositiveAndBelow(index, lines.size()))
+        return 0.f;
+
+    auto& entry = lines.getReference(index);
+    if (entry.width < 0.f) {
+        entry.width = font.getStringWidthFloat(entry.string + " ");
+    }
+    return entry.width;
+}
+
 void GlyphArrangementArray::ensureValid(int index) const
 {
     if (!isPositiveAndBelow(index, lines.size()))
@@ -1077,12 +1113,14 @@ void GlyphArrangementArray::invalidateAll()
     for (auto& entry : lines) {
         entry.glyphsAreDirty = true;
         entry.tokensAreDirty = true;
+        entry.width = -1.f;
     }
 }
 
 void TextDocument::replaceAll(String const& content)
 {
     lines.clear();
+    widestRow = -1.f;
 
     for (auto const& line : StringArray::fromLines(content)) {
         lines.add(line);
@@ -1169,15 +1207,13 @@ Array<Rectangle<float>> TextDocument::getSelectionRegion(Selection selection, Re
 
 Rectangle<float> TextDocument::getBounds() const
 {
-    if (cachedBounds.isEmpty()) {
-        auto bounds = Rectangle<float>();
-
+    if (widestRow < 0.f) {
+        widestRow = 0.f;
         for (int n = 0; n < getNumRows(); ++n) {
-            bounds = bounds.getUnion(getBoundsOnRow(n, Range<int>(0, getNumColumns(n))));
+            widestRow = jmax(widestRow, lines.getWidth(n));
         }
-        return cachedBounds = bounds;
     }
-    return cachedBounds;
+    return { TEXT_INDENT, 0.f, widestRow, getHeight() };
 }
 
 Rectangle<float> TextDocument::getBoundsOnRow(int row, Range<int> columns) const
@@ -1465,8 +1501,6 @@ String TextDocument::getSelectionContent(Selection s) const
 
 Transaction TextDocument::fulfill(Transaction const& transaction)
 {
-    cachedBounds = {}; // invalidate the bounds
-
     auto const t = transaction.accountingForSpecialCharacters(*this);
     auto const s = t.selection.oriented();
     auto const L = getSelectionContent(s.horizontallyMaximized(*this));
@@ -1479,6 +1513,12 @@ Transaction TextDocument::fulfill(Transaction const& transaction)
         existingSelection.pushBy(Selection(t.content).startingFrom(s.head));
     }
 
+    // Only measure all rows again if the widest one goes away
+    for (int n = s.head.x; n <= s.tail.x && widestRow >= 0.f; ++n) {
+        if (lines.getWidth(n) >= widestRow)
+            widestRow = -1.f;
+    }
+
     lines.removeRange(s.head.x, s.tail.x - s.head.x + 1);
     int row = s.head.x;
 
@@ -1489,6 +1529,10 @@ Transaction TextDocument::fulfill(Transaction const& transaction)
         lines.insert(row++, line);
     }
 
+    for (int n = s.head.x; n < row && widestRow >= 0.f; ++n) {
+        widestRow = jmax(widestRow, lines.getWidth(n));
+    }
+
     using D = Transaction::Direction;
     auto inf = std::numeric_limits<float>::max();
 
@@ -1516,6 +1560,7 @@ void TextDocument::applyTokens(Range<int> rows, Array<Selection> const& zones)
                 lines.applyTokens(n, zone);
             }
         }
+        lines.setTokensValid(n);
     }
 }
 
@@ -2030,22 +2075,32 @@ void PlugDataTextEditor::renderTextUsingGlyphArrangement(Graphics& g)
 
     if (enableSyntaxHighlighting) {
         auto colourScheme = CPlusPlusCodeTokeniser().getDefaultColourScheme();
-        auto rows = document.getRangeOfRowsIntersecting(g.getClipBounds().toFloat());
-        auto index = Point<int>(rows.getStart(), 0);
-        document.navigate(index, TextDocument::Target::token, TextDocument::Direction::backwardRow);
-
-        auto it = TextDocument::Iterator(document, index);
-        auto previous = it.getIndex();
-        auto zones = Array<Selection>();
-        auto start = Time::getMillisecondCounterHiRes();
-
-        while (it.getIndex().x < rows.getEnd() && !it.isEOF()) {
-            auto tokenType = CppTokeniserFunctions::readNextToken(it);
-            zones.add(Selection(previous, it.getIndex()).withStyle(tokenType));
-            previous = it.getIndex();
+        auto visibleRows = document.getRangeOfRowsIntersecting(g.getClipBounds().toFloat());
+
+        // Rows keep their tokens until they get edited, so only the rows from the first edited one onwards are tokenised
+        // The rows after an edited row are included, because an edit can change how they get tokenised
+        auto firstDirtyRow = visibleRows.getStart();
+        while (firstDirtyRow < visibleRows.getEnd() && !document.lines.tokensAreDirty(firstDirtyRow)) {
+            firstDirtyRow++;
+        }
+
+        if (firstDirtyRow < visibleRows.getEnd()) {
+            auto rows = visibleRows.withStart(firstDirtyRow);
+            auto index = Point<int>(rows.getStart(), 0);
+            document.navigate(index, TextDocument::Target::token, TextDocument::Direction::backwardRow);
+
+            auto it = TextDocument::Iterator(document, index);
+            auto previous = it.getIndex();
+            auto zones = Array<Selection>();
+
+            while (it.getIndex().x < rows.getEnd() && !it.isEOF()) {
+                auto tokenType = CppTokeniserFunctions::readNextToken(it);
+                zones.add(Selection(previous, it.getIndex()).withStyle(tokenType));
+                previous = it.getIndex();
+            }
+            document.clearTokens(rows);
+            document.applyTokens(rows, zones);
         }
-        document.clearTokens(rows);
-        document.applyTokens(rows, zones);
 
         for (int n = 0; n < colourScheme.types.size(); ++n) {
             g.setColour(colourScheme.types[n].colour);
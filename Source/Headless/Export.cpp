@@ -0,0 +1,209 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+// Exports a patch with the Heavy toolchain, without a GUI, for build machines
+// Usage: plugdata-export patch.pd -o outdir [-t c|daisy|dpf] [-n name] [-b board] [-f formats] [-p searchpath] [--toolchain dir] [--compile]
+
+#include <JuceHeader.h>
+
+#include <iostream>
+
+#if JUCE_WINDOWS
+static String const exeSuffix = ".exe";
+#else
+static String const exeSuffix = "";
+#endif
+
+static int fail(String const& message)
+{
+    std::cerr << message << std::endl;
+    return 1;
+}
+
+// Same location the export dialog installs the toolchain to
+static File getDefaultToolchain()
+{
+    auto toolchain = File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory).getChildFile("plugdata").getChildFile("Toolchain");
+#if JUCE_WINDOWS
+    toolchain = toolchain.getChildFile("usr");
+#endif
+    return toolchain;
+}
+
+// Runs a process and forwards its output, returns the exit code
+static int run(StringArray const& args)
+{
+    ChildProcess process;
+    if (!process.start(args))
+        return fail("Can't start " + args[0]);
+
+    char buffer[4096];
+    while (true) {
+        auto numRead = process.readProcessOutput(buffer, sizeof(buffer));
+        if (numRead <= 0)
+            break;
+
+        std::cout.write(buffer, numRead);
+    }
+
+    process.waitForProcessToFinish(-1);
+    return static_cast<int>(process.getExitCode());
+}
+
+// Runs make for a generated project, in its own directory so several exports can run at once
+static int runMake(File const& toolchain, File const& directory, StringArray const& variables)
+{
+    auto make = toolchain.getChildFile("bin").getChildFile("make" + exeSuffix);
+    auto jobs = "-j" + String(std::max(1, SystemStats::getNumCpus()));
+
+#if JUCE_WINDOWS
+    // The toolchain's make needs its own shell on Windows
+    auto command = make.getFullPathName().replaceCharacter('\\', '/') + " " + jobs + " -C " + directory.getFullPathName().replaceCharacter('\\', '/') + " " + variables.joinIntoString(" ");
+    auto buildScript = directory.getChildFile("build.sh");
+    buildScript.replaceWithText("#!/bin/bash\nexport PATH=\"$PATH:" + toolchain.getChildFile("bin").getFullPathName().replaceCharacter('\\', '/') + "\"\n" + command, false, false, "\n");
+
+    return run({ toolchain.getChildFile("bin").getChildFile("sh.exe").getFullPathName(), "--login", buildScript.getFullPathName() });
+#elif JUCE_MAC
+    StringArray args = { "make", jobs, "-C", directory.getFullPathName() };
+    args.addArray(variables);
+    return run(args);
+#else
+    auto buildScript = directory.getChildFile("build.sh");
+    auto setup = toolchain.getChildFile("scripts").getChildFile("anywhere-setup.sh").getFullPathName();
+    buildScript.replaceWithText("#!/bin/bash\n" + setup + "\n" + make.getFullPathName() + " " + jobs + " -C " + directory.getFullPathName() + " " + variables.joinIntoString(" "), false, false, "\n");
+    buildScript.setExecutePermission(true);
+
+    return run({ buildScript.getFullPathName() });
+#endif
+}
+
+static String writeMetaJson(File const& outdir, String const& generator, DynamicObject::Ptr settings)
+{
+    DynamicObject::Ptr metaJson(new DynamicObject());
+    metaJson->setProperty(generator, var(settings.get()));
+
+    auto metadata = outdir.getChildFile("meta.json");
+    metadata.replaceWithText(JSON::toString(var(metaJson.get())), false, false, "\n");
+    return metadata.getFullPathName();
+}
+
+int main(int argc, char* argv[])
+{
+    ArgumentList args(argc, argv);
+
+    if (args.size() == 0 || args.containsOption("-h|--help")) {
+        std::cout << "usage: plugdata-export patch.pd -o outdir [-t c|daisy|dpf] [-n name] [-b board] [-f lv2,vst2,vst3,clap,jack] [-p searchpath] [--toolchain dir] [--compile]" << std::endl;
+        return 0;
+    }
+
+    auto patchFile = args[0].resolveAsFile();
+    if (!patchFile.existsAsFile())
+        return fail("Patch not found: " + args[0].text);
+    if (!args.containsOption("-o"))
+        return fail("No output directory specified");
+
+    auto outdir = File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("-o"));
+    auto target = args.containsOption("-t") ? args.getValueForOption("-t") : String("c");
+    auto name = args.containsOption("-n") ? args.getValueForOption("-n") : patchFile.getFileNameWithoutExtension();
+    auto compile = args.containsOption("--compile");
+
+    auto toolchain = args.containsOption("--toolchain") ? File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--toolchain")) : getDefaultToolchain();
+    auto heavy = toolchain.getChildFile("bin").getChildFile("Heavy").getChildFile("Heavy" + exeSuffix);
+    if (!heavy.existsAsFile())
+        return fail("Heavy toolchain not found in " + toolchain.getFullPathName());
+
+    if (!outdir.createDirectory())
+        return fail("Can't create output directory: " + outdir.getFullPathName());
+
+    StringArray heavyArgs = { heavy.getFullPathName(), patchFile.getFullPathName(), "-o" + outdir.getFullPathName(), "-n" + name, "-v" };
+
+    auto searchPaths = StringArray { patchFile.getParentDirectory().getFullPathName() };
+    searchPaths.addArray(StringArray::fromTokens(args.getValueForOption("-p"), ";", ""));
+    searchPaths.removeEmptyStrings();
+    searchPaths.removeDuplicates(false);
+
+    for (auto const& path : searchPaths)
+        heavyArgs.add("-p" + path);
+
+    auto boards = StringArray { "seed", "pod", "petal", "patch", "patch_init", "field" };
+    auto board = args.containsOption("-b") ? args.getValueForOption("-b") : String("seed");
+
+    auto formats = StringArray::fromTokens(args.containsOption("-f") ? args.getValueForOption("-f") : String("lv2,vst3,clap"), ",", "");
+    formats.removeEmptyStrings();
+
+    if (target == "daisy") {
+        if (!boards.contains(board))
+            return fail("Unknown board: " + board + ", pick one of " + boards.joinIntoString(", "));
+
+        DynamicObject::Ptr daisy(new DynamicObject());
+        daisy->setProperty("board", board);
+        heavyArgs.add("-m" + writeMetaJson(outdir, "daisy", daisy));
+        heavyArgs.add("-gdaisy");
+    } else if (target == "dpf") {
+        StringArray dpfFormats;
+        for (auto const& format : formats)
+            dpfFormats.add(format == "lv2" ? "lv2_dsp" : format);
+
+        DynamicObject::Ptr dpf(new DynamicObject());
+        dpf->setProperty("project", "true");
+        dpf->setProperty("description", "Rename Me");
+        dpf->setProperty("maker", "Wasted Audio");
+        dpf->setProperty("license", "ISC");
+        dpf->setProperty("midi_input", 0);
+        dpf->setProperty("midi_output", 0);
+        dpf->setProperty("plugin_formats", dpfFormats);
+        heavyArgs.add("-m" + writeMetaJson(outdir, "dpf", dpf));
+        heavyArgs.add("-gdpf");
+    } else if (target != "c") {
+        return fail("Unknown target: " + target);
+    }
+
+    auto exitCode = run(heavyArgs);
+
+    outdir.getChildFile("meta.json").deleteFile();
+    outdir.getChildFile("ir").deleteRecursively();
+    outdir.getChildFile("hv").deleteRecursively();
+
+    if (exitCode != 0)
+        return fail("Heavy failed with exit code " + String(exitCode));
+
+    if (target == "daisy") {
+        auto libDaisy = toolchain.getChildFile("lib").getChildFile("libDaisy");
+        libDaisy.copyDirectoryTo(outdir.getChildFile("libDaisy"));
+        outdir.getChildFile("c").deleteRecursively();
+
+        if (!compile)
+            return 0;
+
+        auto sourceDir = outdir.getChildFile("daisy").getChildFile("source");
+        sourceDir.getChildFile("build").createDirectory();
+        toolchain.getChildFile("lib").getChildFile("heavy-static.a").copyFileTo(sourceDir.getChildFile("build").getChildFile("heavy-static.a"));
+        toolchain.getChildFile("etc").getChildFile("daisy_makefile").copyFileTo(sourceDir.getChildFile("Makefile"));
+
+        auto gccPath = toolchain.getChildFile("bin").getFullPathName().replaceCharacter('\\', '/');
+        exitCode = runMake(toolchain, sourceDir, { "GCC_PATH=" + gccPath, "PROJECT_NAME=" + name });
+
+        if (exitCode == 0) {
+            sourceDir.getChildFile("build").getChildFile("Heavy_" + name + ".bin").moveFileTo(outdir.getChildFile(name + ".bin"));
+            outdir.getChildFile("daisy").deleteRecursively();
+            outdir.getChildFile("libDaisy").deleteRecursively();
+        }
+    } else if (target == "dpf") {
+        outdir.getChildFile("c").deleteRecursively();
+        toolchain.getChildFile("lib").getChildFile("dpf").copyDirectoryTo(outdir.getChildFile("dpf"));
+
+        if (!compile)
+            return 0;
+
+        outdir.getChildFile("dpf").getChildFile("utils").getChildFile("generate-ttl.sh").setExecutePermission(true);
+        exitCode = runMake(toolchain, outdir, {});
+    }
+
+    if (exitCode != 0)
+        return fail("Compilation failed with exit code " + String(exitCode));
+
+    return 0;
+}
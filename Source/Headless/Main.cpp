@@ -0,0 +1,153 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+// Renders a patch to an audio file without a GUI or audio device, as fast as pd can run
+// Usage: plugdata-render patch.pd -o out.wav [-i in.wav] [-l seconds] [-t tail] [-r samplerate] [-c channels] [-p searchpath]
+
+#include <JuceHeader.h>
+
+#include <iostream>
+
+extern "C" {
+#include <m_pd.h>
+#include <z_libpd.h>
+
+#include "x_libpd_extra_utils.h"
+#include "x_libpd_multi.h"
+}
+
+static void printHook(void*, char const* message)
+{
+    std::cerr << message;
+}
+
+static int fail(String const& message)
+{
+    std::cerr << message << std::endl;
+    return 1;
+}
+
+static std::unique_ptr<AudioFormat> createFormat(File const& file)
+{
+    if (file.hasFileExtension("flac"))
+        return std::make_unique<FlacAudioFormat>();
+
+    return std::make_unique<WavAudioFormat>();
+}
+
+int main(int argc, char* argv[])
+{
+    ArgumentList args(argc, argv);
+
+    if (args.size() == 0 || args.containsOption("-h|--help")) {
+        std::cout << "usage: plugdata-render patch.pd -o out.wav [-i in.wav] [-l seconds] [-t tail] [-r samplerate] [-c channels] [-p searchpath]" << std::endl;
+        return 0;
+    }
+
+    auto patchFile = args[0].resolveAsFile();
+    auto outputFile = File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("-o"));
+
+    if (!patchFile.existsAsFile())
+        return fail("Patch not found: " + args[0].text);
+    if (!args.containsOption("-o"))
+        return fail("No output file specified");
+
+    // The input file decides the sample rate and length, unless they are given explicitly
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<AudioFormatReader> reader;
+    if (args.containsOption("-i")) {
+        reader.reset(formatManager.createReaderFor(File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("-i"))));
+        if (!reader)
+            return fail("Can't read input file: " + args.getValueForOption("-i"));
+    }
+
+    auto const sampleRate = args.containsOption("-r") ? args.getValueForOption("-r").getDoubleValue() : reader ? reader->sampleRate : 44100.0;
+    auto const numOutputs = args.containsOption("-c") ? args.getValueForOption("-c").getIntValue() : 2;
+    auto const numInputs = reader ? static_cast<int>(reader->numChannels) : 0;
+    auto const tail = args.getValueForOption("-t").getDoubleValue();
+
+    int64 numSamples = reader ? reader->lengthInSamples : 0;
+    if (args.containsOption("-l")) {
+        numSamples = static_cast<int64>(args.getValueForOption("-l").getDoubleValue() * sampleRate);
+    }
+    numSamples += static_cast<int64>(tail * sampleRate);
+
+    if (numSamples <= 0)
+        return fail("Nothing to render, specify an input file or a length");
+
+    libpd_multi_init();
+    auto* instance = libpd_new_instance();
+    libpd_set_instance(instance);
+
+    libpd_init_else();
+    libpd_init_cyclone();
+    auto* printReceiver = libpd_multi_print_new(nullptr, printHook);
+
+    for (auto const& path : StringArray::fromTokens(args.getValueForOption("-p"), ";", ""))
+    {
+        libpd_add_to_search_path(path.toRawUTF8());
+    }
+    libpd_add_to_search_path(patchFile.getParentDirectory().getFullPathName().toRawUTF8());
+
+    libpd_init_audio(numInputs, numOutputs, static_cast<int>(sampleRate));
+
+    auto* patch = libpd_openfile(patchFile.getFileName().toRawUTF8(), patchFile.getParentDirectory().getFullPathName().toRawUTF8());
+    if (!patch)
+        return fail("Can't open patch: " + patchFile.getFullPathName());
+
+    libpd_start_message(1);
+    libpd_add_float(1.0f);
+    libpd_finish_message("pd", "dsp");
+
+    outputFile.deleteFile();
+    auto format = createFormat(outputFile);
+    std::unique_ptr<AudioFormatWriter> writer(format->createWriterFor(outputFile.createOutputStream().release(), sampleRate, numOutputs, 24, {}, 0));
+    if (!writer)
+        return fail("Can't write output file: " + outputFile.getFullPathName());
+
+    // Larger batches mean fewer lock and file operations per tick
+    constexpr int ticksPerBatch = 64;
+    int const blockSize = libpd_blocksize();
+    int const batchSize = blockSize * ticksPerBatch;
+
+    AudioBuffer<float> fileBuffer(std::max({ numInputs, numOutputs, 1 }), batchSize);
+    std::vector<t_sample> pdInput(std::max(numInputs, 1) * batchSize);
+    std::vector<t_sample> pdOutput(std::max(numOutputs, 1) * batchSize);
+
+    for (int64 position = 0; position < numSamples; position += batchSize)
+    {
+        fileBuffer.clear();
+        if (reader) {
+            reader->read(&fileBuffer, 0, batchSize, position, true, true);
+        }
+
+        // libpd expects every channel of the batch after each other
+        for (int ch = 0; ch < numInputs; ch++)
+        {
+            std::copy_n(fileBuffer.getReadPointer(ch), batchSize, pdInput.data() + ch * batchSize);
+        }
+
+        libpd_process_ticks(pdInput.data(), pdOutput.data(), ticksPerBatch);
+
+        for (int ch = 0; ch < numOutputs; ch++)
+        {
+            std::copy_n(pdOutput.data() + ch * batchSize, batchSize, fileBuffer.getWritePointer(ch));
+        }
+
+        auto const numToWrite = static_cast<int>(std::min<int64>(batchSize, numSamples - position));
+        writer->writeFromAudioSampleBuffer(fileBuffer, 0, numToWrite);
+    }
+
+    writer.reset();
+
+    libpd_closefile(patch);
+    pd_free(static_cast<t_pd*>(printReceiver));
+    libpd_free_instance(instance);
+
+    return 0;
+}
@@ -30,25 +30,14 @@ Rectangle<int> Iolet::getCanvasBounds()
 
 void Iolet::paint(Graphics& g)
 {
-    auto bounds = getLocalBounds().toFloat().reduced(0.5f);
-
     bool isLocked = static_cast<bool>(locked.getValue());
     bool down = isMouseButtonDown();
     bool over = isMouseOver();
-    
-    if ((!isTargeted && !over) || isLocked)
-    {
-        bounds = bounds.reduced(2);
-    }
-    
-    auto backgroundColour = isSignal ? findColour(PlugDataColour::signalColourId) : findColour(PlugDataColour::dataColourId);
 
-    if ((down || over) && !isLocked) backgroundColour = backgroundColour.contrasting(down ? 0.2f : 0.05f);
+    bool expanded = (isTargeted || over) && !isLocked;
 
-    if (isLocked)
-    {
-        backgroundColour = findColour(PlugDataColour::canvasBackgroundColourId).contrasting(0.5f);
-    }
+    auto& lnf = dynamic_cast<PlugDataLook&>(getLookAndFeel());
+    auto& image = lnf.getIoletImage(getLocalBounds(), isSignal, expanded, over, down, isLocked, g.getInternalContext().getPhysicalPixelScaleFactor());
 
     // Instead of drawing pie segments, just clip the graphics region to the visible iolets of the object
     // This is much faster!
@@ -60,11 +49,7 @@ void Iolet::paint(Graphics& g)
         stateSaved = true;
     }
 
-    g.setColour(backgroundColour);
-    g.fillEllipse(bounds);
-
-    g.setColour(findColour(PlugDataColour::objectOutlineColourId));
-    g.drawEllipse(bounds, 1.0f);
+    g.drawImage(image, getLocalBounds().toFloat());
 
     if (stateSaved)
     {
@@ -325,9 +310,9 @@ void Iolet::createConnection()
 
 Iolet* Iolet::findNearestEdge(Canvas* cnv, Point<int> position, bool inlet, Object* boxToExclude)
 {
-    // Find all iolets
+    // Find all iolets that could be in range, iolets don't stick out of their object by more than a few pixels
     Array<Iolet*> allEdges;
-    for (auto* object : cnv->objects)
+    for (auto* object : cnv->objectIndex.query(Rectangle<int>(position, position).expanded(60)))
     {
         for (auto* iolet : object->iolets)
         {
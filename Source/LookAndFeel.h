@@ -8,6 +8,7 @@
 
 #include <JuceHeader.h>
 #include <map>
+#include <unordered_map>
 
 struct Constants
 {
@@ -868,6 +869,8 @@ struct PlugDataLook : public LookAndFeel_V4
     
     void setColours(std::map<PlugDataColour, Colour> colours)
     {
+        themeVersion++;
+
         for (auto colourId = 0; colourId < PlugDataColour::numberOfColours; colourId++) {
             setColour(colourId, colours.at(static_cast<PlugDataColour>(colourId)));
         }
@@ -1132,8 +1135,59 @@ struct PlugDataLook : public LookAndFeel_V4
         
         isUsingLightTheme = useLightTheme;
     }
+
+    // Iolets are drawn from images that are rendered once for every look they can have, a big patch has too many of them to draw their shapes on every repaint
+    // The images are rendered at the pixel scale they're drawn at, so they stay sharp when zoomed
+    Image const& getIoletImage(Rectangle<int> area, bool isSignal, bool isExpanded, bool isOver, bool isDown, bool isLocked, float scale)
+    {
+        if (ioletImageThemeVersion != themeVersion) {
+            ioletImages.clear();
+            ioletImageThemeVersion = themeVersion;
+        }
+
+        int state = isLocked ? 3 : (isDown ? 2 : (isOver ? 1 : 0));
+        auto key = (static_cast<int64>(roundToInt(scale * 100.0f)) << 32) | (area.getWidth() << 20) | (area.getHeight() << 8) | (state << 2) | (isExpanded << 1) | static_cast<int>(isSignal);
+
+        auto it = ioletImages.find(key);
+        if (it != ioletImages.end())
+            return it->second;
+
+        auto width = std::max(roundToInt(area.getWidth() * scale), 1);
+        auto height = std::max(roundToInt(area.getHeight() * scale), 1);
+
+        Image image(Image::ARGB, width, height, true);
+        Graphics g(image);
+        g.addTransform(AffineTransform::scale(width / static_cast<float>(area.getWidth()), height / static_cast<float>(area.getHeight())));
+
+        auto bounds = area.withZeroOrigin().toFloat().reduced(0.5f);
+        if (!isExpanded)
+            bounds = bounds.reduced(2);
+
+        auto backgroundColour = findColour(isSignal ? PlugDataColour::signalColourId : PlugDataColour::dataColourId);
+
+        if ((isDown || isOver) && !isLocked)
+            backgroundColour = backgroundColour.contrasting(isDown ? 0.2f : 0.05f);
+
+        if (isLocked)
+            backgroundColour = findColour(PlugDataColour::canvasBackgroundColourId).contrasting(0.5f);
+
+        g.setColour(backgroundColour);
+        g.fillEllipse(bounds);
+
+        g.setColour(findColour(PlugDataColour::objectOutlineColourId));
+        g.drawEllipse(bounds, 1.0f);
+
+        return ioletImages[key] = image;
+    }
+
+    // Changes every time the colours change, components that depend on the theme compare it to the one they were last updated for
+    static inline int themeVersion = 0;
     
     // TODO: swap this out for a string theme name perhaps?
     static inline bool isUsingLightTheme = true;
     std::unique_ptr<Drawable> folderImage;
+
+private:
+    std::unordered_map<int64, Image> ioletImages;
+    int ioletImageThemeVersion = -1;
 };
@@ -12,14 +12,18 @@
 #include "Iolet.h"
 #include "LookAndFeel.h"
 #include "PluginEditor.h"
+#include "Utility/PaintProfiler.h"
 
 extern "C"
 {
 #include <m_pd.h>
 #include <m_imp.h>
+#include <g_canvas.h>
 #include <x_libpd_extra_utils.h>
 }
 
+#include <unordered_map>
+
 Object::Object(Canvas* parent, String const& name, Point<int> position)
     : cnv(parent)
 {
@@ -71,6 +75,8 @@ Object::Object(void* object, Canvas* parent)
 
 Object::~Object()
 {
+    cnv->objectIndex.remove(this);
+
     if(!cnv->isBeingDeleted) {
         // Ensure there's no pointer to this object in the selection
         cnv->setSelected(this, false);
@@ -239,6 +245,11 @@ void Object::setType(String const& newType, void* existingObject)
 
 
     void* objectPtr;
+    if (!existingObject)
+    {
+        cnv->pd->objectLibrary.recordUsage(type);
+    }
+
     // "exists" indicates that this object already exists in pd
     // When setting exists to true, the gui needs to be assigned already
     if (!existingObject)
@@ -246,12 +257,26 @@ void Object::setType(String const& newType, void* existingObject)
         auto* pd = &cnv->patch;
         if (gui)
         {
+            auto oldClass = String(libpd_get_object_class_name(getPointer()));
+
+            objectPtr = pd->renameObject(getPointer(), newType);
+
+            // Only the arguments changed: keep the gui and the connections, pd has restored them on the new object
+            if (objectPtr && oldClass == libpd_get_object_class_name(objectPtr) && gui->setPointer(objectPtr))
+            {
+                updatePorts();
+                updateBounds();
+                updateConnections();
+
+                cnv->lastSelectedObject = nullptr;
+                cnv->main.updateCommandStatus();
+                return;
+            }
+
             // Clear connections to this object
             // They will be remade by the synchronise call later
             for (auto* connection : getConnections()) cnv->connections.removeObject(connection);
 
-            objectPtr = pd->renameObject(getPointer(), newType);
-
             // Synchronise to make sure connections are preserved correctly
             // Asynchronous because it could possibly delete this object
             MessageManager::callAsync([cnv = SafePointer(cnv)]() {
@@ -320,6 +345,14 @@ Array<Rectangle<float>> Object::getCorners() const
 
 void Object::paintOverChildren(Graphics& g)
 {
+    PaintProfiler::getInstance().endPaint(this);
+
+    if (profilerHeat > 0.0f)
+    {
+        g.setColour(Colours::red.withAlpha(0.5f * profilerHeat));
+        g.fillRoundedRectangle(getLocalBounds().toFloat().reduced(Object::margin + 1.0f), Constants::objectCornerRadius);
+    }
+
     if (isSearchTarget)
     {
         g.saveState();
@@ -370,7 +403,7 @@ void Object::paintOverChildren(Graphics& g)
         
         auto text = String(cnv->objects.indexOf(this));
         auto font = dynamic_cast<PlugDataLook&>(getLookAndFeel()).monoFont.withHeight(10);
-        int textWidth = font.getStringWidth(text) + 5;
+        int textWidth = FastStringWidth::forFont(font).getStringWidth(text) + 5;
         int left = std::min<int>(getWidth() - (1.5 * margin), getWidth() - textWidth);
         
         auto indexBounds = Rectangle<int>(left, (getHeight() / 2) - halfHeight, getWidth() - left, halfHeight * 2);
@@ -395,7 +428,9 @@ void Object::showIndex(bool shouldShowIndex)
 
 void Object::paint(Graphics& g)
 {
-    
+    // Ended in paintOverChildren, so the time the GUI takes to paint is counted for its class
+    PaintProfiler::getInstance().beginPaint(this, gui ? std::type_index(typeid(*gui)) : std::type_index(typeid(*this)));
+
     if (cnv->isSelected(this) && !cnv->isGraph)
     {
         g.setColour(findColour(PlugDataColour::objectSelectedOutlineColourId));
@@ -412,9 +447,35 @@ void Object::paint(Graphics& g)
     }
 }
 
+void Object::setCulled(bool shouldBeCulled)
+{
+    if (culled == shouldBeCulled) return;
+
+    culled = shouldBeCulled;
+    updateVisibility();
+
+    // Values weren't updated while we were out of view
+    if (!culled && gui)
+    {
+        gui->updateValue();
+    }
+}
+
+void Object::updateVisibility()
+{
+    setVisible(!culled && !((cnv->isGraph || cnv->presentationMode == var(true)) && gui && gui->hideInGraph()));
+}
+
+void Object::moved()
+{
+    cnv->objectIndex.update(this, getBounds());
+}
+
 void Object::resized()
 {
-    setVisible(!((cnv->isGraph || cnv->presentationMode == var(true)) && gui && gui->hideInGraph()));
+    cnv->objectIndex.update(this, getBounds());
+
+    updateVisibility();
 
     if (gui)
     {
@@ -482,8 +543,11 @@ void Object::updateTooltips() {
     std::vector<std::pair<int, String>> inletMessages;
     std::vector<std::pair<int, String>> outletMessages;
     
+    auto const type = gui->getType();
+    auto const ioletTooltips = cnv->pd->objectLibrary.getIoletTooltips(pd_class(static_cast<t_pd*>(gui->ptr)), type);
+
     // Set object tooltip
-    gui->setTooltip(cnv->pd->objectLibrary.getObjectDescriptions()[gui->getType()]);
+    gui->setTooltip(cnv->pd->objectLibrary.getObjectDescription(type));
     
     if(auto* subpatch =  gui->getPatch()) {
         
@@ -532,12 +596,12 @@ void Object::updateTooltips() {
         auto* iolet = iolets[i];
         
         // Check pd library for pddp tooltips, those have priority
-        String tooltip = cnv->pd->objectLibrary.getInletOutletTooltip(gui->getType(), iolet->ioletIdx, iolet->isInlet ? numInputs : numOutputs, iolet->isInlet);
+        String tooltip = ioletTooltips.getTooltip(iolet->ioletIdx, iolet->isInlet ? numInputs : numOutputs, iolet->isInlet);
         
         // Don't overwrite custom documentation
         if(tooltip.isNotEmpty())  {
             iolet->setTooltip(tooltip);
-            return;
+            continue;
         }
         
         if((iolet->isInlet && numIn >= inletMessages.size()) ||(!iolet->isInlet && numIn >= inletMessages.size())) continue;
@@ -577,6 +641,13 @@ void Object::updatePorts()
     while (numOutputs < oldNumOutputs) iolets.remove(numInputs + (--oldNumOutputs));
     while (numOutputs > oldNumOutputs) iolets.insert(numInputs + (++oldNumOutputs), new Iolet(this, false));
 
+    // Looked up once for all iolets, getting the type needs the audio lock
+    pd::IoletTooltips ioletTooltips;
+    if (gui)
+    {
+        ioletTooltips = cnv->pd->objectLibrary.getIoletTooltips(pd_class(static_cast<t_pd*>(gui->ptr)), gui->getType());
+    }
+
     int numIn = 0;
     int numOut = 0;
 
@@ -600,7 +671,7 @@ void Object::updatePorts()
         
         if (gui)
         {
-            String tooltip = cnv->pd->objectLibrary.getInletOutletTooltip(gui->getType(), iolet->ioletIdx, input ? numInputs : numOutputs, input);
+            String tooltip = ioletTooltips.getTooltip(iolet->ioletIdx, input ? numInputs : numOutputs, input);
             iolet->setTooltip(tooltip);
         }
 
@@ -787,6 +858,31 @@ void Object::hideEditor()
     }
 }
 
+// After renaming in place, drops the connections pd didn't restore and redraws the others in case their iolet type changed
+void Object::updateConnections()
+{
+    // Consume the changes of the rename, they describe the object that was replaced
+    auto object = SafePointer<Object>(this);
+    cnv->synchroniseChanges();
+    if (!object) return;
+
+    // Connections to iolets that don't exist anymore aren't found by getConnections
+    for (int n = cnv->connections.size() - 1; n >= 0; n--)
+    {
+        auto* connection = cnv->connections[n];
+        if (connection->inobj != this && connection->outobj != this) continue;
+
+        if (!connection->inlet || !connection->outlet || !canvas_isconnected(cnv->patch.getPointer(), static_cast<t_text*>(connection->outobj->getPointer()), connection->outIdx, static_cast<t_text*>(connection->inobj->getPointer()), connection->inIdx))
+        {
+            cnv->connections.remove(n);
+        }
+        else
+        {
+            connection->repaint();
+        }
+    }
+}
+
 Array<Connection*> Object::getConnections() const
 {
     Array<Connection*> result;
@@ -904,3 +1000,65 @@ void Object::openHelpPatch() const
     
     cnv->pd->logMessage("Couldn't find help file");
 }
+
+struct HvccAbstractionResult {
+    int64 modificationTime = -1;
+    StringArray incompatible;
+};
+
+static void collectHvccIncompatibleObjects(t_canvas* cnv, String const& prefix, StringArray& result, std::unordered_map<String, HvccAbstractionResult>& abstractions)
+{
+    for (t_gobj* y = cnv->gl_list; y; y = y->g_next) {
+        if (pd::Storage::isInfoParent(y))
+            continue;
+
+        if (pd_class(&y->g_pd) != canvas_class) {
+            const String name = libpd_get_object_class_name(y);
+            if (!Object::hvccObjects.contains(name))
+                result.add(prefix + name);
+
+            continue;
+        }
+
+        auto* subpatch = reinterpret_cast<t_canvas*>(y);
+
+        char* text = nullptr;
+        int size = 0;
+        libpd_get_object_text(y, &text, &size);
+        auto subpatchPrefix = prefix + String::fromUTF8(text, size) + " -> ";
+        freebytes(static_cast<void*>(text), static_cast<size_t>(size) * sizeof(char));
+
+        if (!canvas_isabstraction(subpatch)) {
+            collectHvccIncompatibleObjects(subpatch, subpatchPrefix, result, abstractions);
+            continue;
+        }
+
+        auto file = File(String::fromUTF8(canvas_getdir(subpatch)->s_name)).getChildFile(String::fromUTF8(subpatch->gl_name->s_name)).withFileExtension("pd");
+        auto modificationTime = file.getLastModificationTime().toMilliseconds();
+
+        // References into an unordered_map stay valid while nested abstractions get added
+        auto& cached = abstractions[file.getFullPathName()];
+        if (cached.modificationTime != modificationTime) {
+            cached.modificationTime = modificationTime;
+            cached.incompatible.clear();
+            collectHvccIncompatibleObjects(subpatch, "", cached.incompatible, abstractions);
+        }
+
+        for (auto const& object : cached.incompatible)
+            result.add(subpatchPrefix + object);
+    }
+}
+
+StringArray Object::findHvccIncompatibleObjects(pd::Patch& patch)
+{
+    // Only used from the message thread
+    static std::unordered_map<String, HvccAbstractionResult> abstractions;
+
+    StringArray result;
+
+    patch.instance->getCallbackLock()->enter();
+    collectHvccIncompatibleObjects(patch.getPointer(), "", result, abstractions);
+    patch.instance->getCallbackLock()->exit();
+
+    return result;
+}
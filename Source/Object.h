@@ -34,6 +34,7 @@ class Object : public Component, public Value::Listener, public Timer, private T
     void paint(Graphics&) override;
     void paintOverChildren(Graphics&) override;
     void resized() override;
+    void moved() override;
 
     void updatePorts();
 
@@ -45,6 +46,9 @@ class Object : public Component, public Value::Listener, public Timer, private T
     
     void showIndex(bool showIndex);
 
+    // Hides objects that are outside of the visible area, their values aren't updated until they come back into view
+    void setCulled(bool shouldBeCulled);
+
     Rectangle<int> getObjectBounds();
     void setObjectBounds(Rectangle<int> bounds);
 
@@ -52,6 +56,7 @@ class Object : public Component, public Value::Listener, public Timer, private T
     void* getPointer() const;
 
     Array<Connection*> getConnections() const;
+    void updateConnections();
 
     void mouseEnter(const MouseEvent& e) override;
     void mouseExit(const MouseEvent& e) override;
@@ -91,14 +96,24 @@ class Object : public Component, public Value::Listener, public Timer, private T
     bool attachedToMouse = false;
     bool isSearchTarget = false;
 
+    // Share of the canvas' dsp time, drawn as an overlay while the profiler panel is open
+    float profilerHeat = 0.0f;
+    bool culled = false;
+
     Value hvccMode = Value(var(false));
     
+    // Objects in the patch and its subpatches that Heavy can't compile, as "subpatch -> object" paths
+    // Abstractions are only walked again when their file changed
+    static StringArray findHvccIncompatibleObjects(pd::Patch& patch);
+
     static inline const StringArray hvccObjects = {"!=", "%", "&", "&&", "|", "||", "*", "+", "-", "/", "<", "<<", "<=", "==", ">", ">=", ">>", "abs", "atan", "atan2", "b", "bang", "bendin", "bendout", "bng", "change", "clip", "cnv", "cos", "ctlin", "ctlout", "dbtopow", "dbtorms", "declare", "del", "delay", "div", "exp", "f", "float", "floatatom", "ftom", "gatom", "hradio", "hsl", "i", "inlet", "int", "line", "loadbang", "log", "msg", "message", "makenote", "max", "metro", "min", "midiin", "midiout", "midirealtimein", "mod", "moses", "mtof", "nbx", "notein", "noteout", "outlet", "pack", "pgmin", "pgmout", "pipe", "poly", "pow", "powtodb", "print", "r", "random", "receive", "rmstodb", "route", "s", "sel", "select", "send", "sin", "spigot", "sqrt", "stripnote", "swap", "symbol", "symbolatom", "t", "table", "tabread", "tabwrite", "tan", "text", "tgl", "timer", "touchin", "touchout", "trigger", "unpack", "until", "vradio", "vsl", "wrap", "*~", "+~", "-~", "/~", "abs~", "adc~", "biquad~", "bp~", "catch~", "clip~", "cos~", "cpole~", "czero_rev~", "czero~", "dac~", "dbtopow~", "dbtorms~", "delread~", "delwrite~", "delread4~", "env~", "exp~", "ftom~", "hip~", "inlet~", "line~", "lop~", "max~", "min~", "mtof~", "noise~", "osc~", "outlet~", "phasor~", "powtodb~", "pow~", "q8_rsqrt~", "q8_sqrt~", "receive~", "rmstodb~", "rpole~", "rsqrt~", "rzero_rev~", "rzero~", "r~", "samphold~", "samplerate~", "send~", "sig~", "snapshot~", "sqrt~", "s~", "tabosc4~", "tabplay~", "tabread4~", "tabread~", "tabwrite~", "throw~", "vcf~", "vd~", "wrap~"};
     
    private:
     void initialise();
 
     void updateTooltips();
+
+    void updateVisibility();
     
     void openNewObjectEditor();
 
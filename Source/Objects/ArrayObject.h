@@ -96,6 +96,13 @@ public:
         libpd_array_read(output.data(), ptr, 0, size);
     }
 
+    // Gets the values of part of the array, the output needs to be large enough already.
+    void read(std::vector<float>& output, int offset, int length) const
+    {
+        libpd_set_instance(static_cast<t_pdinstance*>(instance));
+        libpd_array_read(output.data() + offset, ptr, offset, length);
+    }
+
     // Writes the values of the array.
     void write(std::vector<float> const& input)
     {
@@ -103,6 +110,13 @@ public:
         libpd_array_write(ptr, 0, input.data(), static_cast<int>(input.size()));
     }
 
+    // Writes a range of values of the array at once.
+    void write(int offset, float const* input, int length)
+    {
+        libpd_set_instance(static_cast<t_pdinstance*>(instance));
+        libpd_array_write(ptr, offset, input, length);
+    }
+
     // Writes a value of the array.
     void write(const size_t pos, float const input)
     {
@@ -115,7 +129,169 @@ public:
     void* instance = nullptr;
 };
 
-struct GraphicalArray : public Component {
+// Minimum and maximum of an array over blocks of increasing size
+// Lets us find the range of any part of a huge array without looking at every sample, and can be updated for just the part that changed
+class MinMaxPyramid {
+public:
+    struct MinMax {
+        float min, max;
+
+        void add(MinMax other)
+        {
+            min = std::min(min, other.min);
+            max = std::max(max, other.max);
+        }
+    };
+
+    void build(std::vector<float> const& data)
+    {
+        numSamples = data.size();
+        levels.clear();
+
+        if (data.empty())
+            return;
+
+        levels.emplace_back((numSamples + baseBlockSize - 1) / baseBlockSize);
+        updateBaseLevel(data, 0, levels[0].size());
+
+        while (levels.back().size() > 1) {
+            auto& previous = levels.back();
+            std::vector<MinMax> level((previous.size() + 1) / 2);
+            levels.push_back(std::move(level));
+            updateLevel(levels.size() - 1, 0, levels.back().size());
+        }
+    }
+
+    // Updates the blocks that contain samples in [start, end)
+    void update(std::vector<float> const& data, size_t start, size_t end)
+    {
+        if (data.size() != numSamples) {
+            build(data);
+            return;
+        }
+
+        if (start >= end || levels.empty())
+            return;
+
+        auto firstBlock = start / baseBlockSize;
+        auto lastBlock = (end - 1) / baseBlockSize + 1;
+        updateBaseLevel(data, firstBlock, lastBlock);
+
+        for (size_t i = 1; i < levels.size(); i++) {
+            firstBlock /= 2;
+            lastBlock = (lastBlock + 1) / 2;
+            updateLevel(i, firstBlock, lastBlock);
+        }
+    }
+
+    // Gets the range of the samples in [start, end), using the largest blocks that fit
+    MinMax getRange(std::vector<float> const& data, size_t start, size_t end) const
+    {
+        MinMax result = { std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest() };
+
+        auto position = start;
+        while (position < end) {
+            // Find the largest block that starts here and doesn't extend beyond the end
+            int level = -1;
+            for (int i = static_cast<int>(levels.size()) - 1; i >= 0; i--) {
+                auto blockSize = baseBlockSize << i;
+                if (position % blockSize == 0 && position + blockSize <= end) {
+                    level = i;
+                    break;
+                }
+            }
+
+            if (level < 0) {
+                result.add({ data[position], data[position] });
+                position++;
+            } else {
+                auto blockSize = baseBlockSize << level;
+                result.add(levels[level][position / blockSize]);
+                position += blockSize;
+            }
+        }
+
+        return result;
+    }
+
+    size_t size() const
+    {
+        return numSamples;
+    }
+
+private:
+    void updateBaseLevel(std::vector<float> const& data, size_t firstBlock, size_t lastBlock)
+    {
+        for (size_t block = firstBlock; block < lastBlock; block++) {
+            auto begin = data.begin() + block * baseBlockSize;
+            auto end = data.begin() + std::min((block + 1) * baseBlockSize, numSamples);
+            auto [min, max] = std::minmax_element(begin, end);
+            levels[0][block] = { *min, *max };
+        }
+    }
+
+    void updateLevel(size_t level, size_t firstBlock, size_t lastBlock)
+    {
+        auto const& below = levels[level - 1];
+        auto& current = levels[level];
+
+        for (size_t block = firstBlock; block < std::min(lastBlock, current.size()); block++) {
+            current[block] = below[block * 2];
+            if (block * 2 + 1 < below.size())
+                current[block].add(below[block * 2 + 1]);
+        }
+    }
+
+    static constexpr size_t baseBlockSize = 32;
+
+    std::vector<std::vector<MinMax>> levels;
+    size_t numSamples = 0;
+};
+
+// The GUI's copy of an array, shared by everything that shows the same array
+// The version increases on every change, so views can tell whether what they show is outdated
+class SharedArrayView : public ChangeBroadcaster {
+public:
+    // Message thread only
+    static std::shared_ptr<SharedArrayView> get(void* garray)
+    {
+        static std::unordered_map<void*, std::weak_ptr<SharedArrayView>> views;
+
+        for (auto it = views.begin(); it != views.end();) {
+            it = it->second.expired() ? views.erase(it) : std::next(it);
+        }
+
+        if (auto existing = views[garray].lock())
+            return existing;
+
+        auto view = std::make_shared<SharedArrayView>();
+        views[garray] = view;
+        return view;
+    }
+
+    // Call after changing [start, end) of the values
+    void changed(size_t start, size_t end)
+    {
+        pyramid.update(values, start, end);
+        version++;
+        sendChangeMessage();
+    }
+
+    // Swaps in a whole new set of values
+    void replace(std::vector<float>& newValues)
+    {
+        values.swap(newValues);
+        pyramid.build(values);
+        version++;
+        sendChangeMessage();
+    }
+
+    std::vector<float> values;
+    MinMaxPyramid pyramid;
+    int64 version = 0;
+};
+
+struct GraphicalArray : public Component, public ChangeListener {
 public:
     Object* object;
 
@@ -125,48 +301,56 @@ public:
         , pd(instance)
         , object(parent)
     {
+        setView();
+
         if (!array.ptr)
             return;
 
-        vec.reserve(8192);
-        temp.reserve(8192);
-        try {
-            array.read(vec);
-        } catch (...) {
-            error = true;
-        }
-
         setInterceptsMouseClicks(true, false);
         setOpaque(false);
     }
 
+    ~GraphicalArray() override
+    {
+        view->removeChangeListener(this);
+    }
+
     void setArray(PdArray& graph)
     {
         if (!array.ptr)
             return;
         array = graph;
+
+        view->removeChangeListener(this);
+        setView();
     }
 
-    std::vector<float> rescale(std::vector<float> const& v, unsigned const newSize)
+    void setView()
     {
-        if (v.empty()) {
-            return {};
-        }
+        view = SharedArrayView::get(array.ptr);
+        view->addChangeListener(this);
 
-        std::vector<float> result(newSize);
-        const std::size_t oldSize = v.size();
-        for (unsigned i = 0; i < newSize; i++) {
-            auto const idx = i * (oldSize - 1) / newSize;
-            auto const mod = i * (oldSize - 1) % newSize;
-
-            if (mod == 0)
-                result[i] = v[idx];
-            else {
-                float const part = float(mod) / float(newSize);
-                result[i] = v[idx] * (1.0 - part) + v[idx + 1] * part;
+        // Start with a full read, unless another view already has the content
+        lastArrayChangeOverflows = -1;
+        if (array.ptr && view->values.empty()) {
+            try {
+                array.read(temp);
+                view->replace(temp);
+            } catch (...) {
+                error = true;
             }
         }
-        return result;
+
+        lastVersion = view->version;
+    }
+
+    // Other views of this array changed it
+    void changeListenerCallback(ChangeBroadcaster*) override
+    {
+        if (view->version != lastVersion) {
+            lastVersion = view->version;
+            repaint();
+        }
     }
 
     void paintGraph(Graphics& g)
@@ -174,7 +358,7 @@ public:
 
         auto const h = static_cast<float>(getHeight());
         auto const w = static_cast<float>(getWidth());
-        std::vector<float> points = vec;
+        auto const& points = view->values;
 
         if (!points.empty()) {
             std::array<float, 2> scale = array.getScale();
@@ -186,9 +370,10 @@ public:
             }
 
             // More than a point per pixel will cause insane loads, and isn't actually helpful
-            // Instead, linearly interpolate the vector to a max size of width in pixels
-            if (vec.size() >= w) {
-                points = rescale(points, w);
+            // Instead, draw the range of the samples that fall within each visible pixel
+            if (points.size() > static_cast<size_t>(getWidth())) {
+                paintDecimated(g, scale, invert);
+                return;
             }
 
             float const dh = h / (scale[1] - scale[0]);
@@ -251,8 +436,45 @@ public:
         }
     }
 
+    void paintDecimated(Graphics& g, std::array<float, 2> scale, bool invert)
+    {
+        auto const& vec = view->values;
+        auto const& pyramid = view->pyramid;
+
+        auto const h = static_cast<float>(getHeight());
+        auto const numSamples = vec.size();
+        auto const width = static_cast<size_t>(getWidth());
+        float const dh = h / (scale[1] - scale[0]);
+
+        auto toY = [&](float value) {
+            auto y = h - (std::clamp(value, scale[0], scale[1]) - scale[0]) * dh;
+            return invert ? h - y : y;
+        };
+
+        auto clip = g.getClipBounds().getIntersection(getLocalBounds());
+
+        RectangleList<float> columns;
+        columns.ensureStorageAllocated(clip.getWidth());
+
+        for (auto x = static_cast<size_t>(clip.getX()); x < static_cast<size_t>(clip.getRight()); x++) {
+            auto start = x * numSamples / width;
+            auto end = std::max(start + 1, (x + 1) * numSamples / width);
+
+            auto range = pyramid.getRange(vec, start, end);
+            auto top = std::min(toY(range.min), toY(range.max));
+            auto bottom = std::max(toY(range.min), toY(range.max));
+
+            columns.addWithoutMerging({ static_cast<float>(x), top, 1.0f, std::max(bottom - top, 1.0f) });
+        }
+
+        g.setColour(object->findColour(PlugDataColour::objectOutlineColourId));
+        g.fillRectList(columns);
+    }
+
     void paint(Graphics& g) override
     {
+        PaintProfiler::ScopedMeasurement paintMeasurement(this);
+
         g.setColour(object->findColour(PlugDataColour::defaultObjectBackgroundColourId));
         g.fillRoundedRectangle(getLocalBounds().toFloat().reduced(0.5f), Constants::objectCornerRadius);
 
@@ -272,7 +494,7 @@ public:
             return;
         edited = true;
 
-        auto const s = static_cast<float>(vec.size() - 1);
+        auto const s = static_cast<float>(view->values.size() - 1);
         auto const w = static_cast<float>(getWidth());
         auto const x = static_cast<float>(e.x);
 
@@ -286,6 +508,7 @@ public:
         if (error || !array.getEditMode())
             return;
 
+        auto& vec = view->values;
         auto const s = static_cast<float>(vec.size() - 1);
         auto const w = static_cast<float>(getWidth());
         auto const h = static_cast<float>(getHeight());
@@ -310,24 +533,27 @@ public:
             vec[n] = jmap<float>(n, interpStart, interpEnd + 1, min, max);
         }
 
-        // Don't want to touch vec on the other thread, so we copy the vector into the lambda
+        view->changed(interpStart, interpEnd + 1);
+        lastVersion = view->version;
+
+        // Don't want to touch vec on the other thread, so we copy the changed part into the lambda
+        // and write it in one go
         auto changed = std::vector<float>(vec.begin() + interpStart, vec.begin() + interpEnd + 1);
 
         pd->enqueueFunction(
-            [_this = SafePointer(this), interpStart, changed]() mutable {
+            [_this = SafePointer(this), target = array, interpStart, changed]() mutable {
                 try {
-                    for (int n = 0; n < changed.size(); n++) {
-                        _this->array.write(interpStart + n, changed[n]);
-                    }
+                    target.write(interpStart, changed.data(), static_cast<int>(changed.size()));
                 } catch (...) {
-                    _this->error = true;
+                    if (_this)
+                        _this->error = true;
                 }
             });
 
         lastIndex = index;
 
         pd->enqueueDirectMessages(array.ptr, stringArray);
-        repaint();
+        repaintRange({ interpStart, interpEnd + 1 });
     }
 
     void mouseUp(MouseEvent const& e) override
@@ -341,26 +567,81 @@ public:
     {
         if (!edited) {
             error = false;
+
+            // Pd tells us which part of the array was written, so we only need to copy that
+            // If it lost track of changes, or the size changed, read and compare everything
+            auto& vec = view->values;
+            auto changed = pd->takeArrayChanges(array.ptr);
+            auto overflows = pd->getArrayChangeOverflows();
+
+            if (overflows == lastArrayChangeOverflows && static_cast<size_t>(array.size()) == vec.size()) {
+                changed = changed.getIntersectionWith({ 0, static_cast<int>(vec.size()) });
+                if (changed.isEmpty())
+                    return;
+
+                try {
+                    array.read(vec, changed.getStart(), changed.getLength());
+                } catch (...) {
+                    error = true;
+                }
+
+                view->changed(changed.getStart(), changed.getEnd());
+                lastVersion = view->version;
+                repaintRange(changed);
+                return;
+            }
+
+            lastArrayChangeOverflows = overflows;
+
             try {
                 array.read(temp);
             } catch (...) {
                 error = true;
             }
-            if (temp != vec) {
-                vec.swap(temp);
+            if (temp.size() != vec.size()) {
+                view->replace(temp);
+                lastVersion = view->version;
                 repaint();
+            } else {
+                // Only update the range of the array that changed
+                auto first = std::mismatch(vec.begin(), vec.end(), temp.begin());
+                if (first.first != vec.end()) {
+                    auto last = std::mismatch(vec.rbegin(), vec.rend(), temp.rbegin());
+                    auto start = static_cast<size_t>(first.first - vec.begin());
+                    auto end = vec.size() - static_cast<size_t>(last.first - vec.rbegin());
+
+                    vec.swap(temp);
+                    view->changed(start, end);
+                    lastVersion = view->version;
+                    repaintRange({ static_cast<int>(start), static_cast<int>(end) });
+                }
             }
         }
     }
 
+    // Repaints the part of the graph that shows these samples, and the lines to their neighbours
+    void repaintRange(Range<int> samples)
+    {
+        if (view->values.empty())
+            return;
+
+        auto const pixelsPerSample = static_cast<float>(getWidth()) / static_cast<float>(view->values.size());
+        auto const start = static_cast<int>(std::floor(samples.getStart() * pixelsPerSample - pixelsPerSample)) - 1;
+        auto const end = static_cast<int>(std::ceil(samples.getEnd() * pixelsPerSample + pixelsPerSample)) + 1;
+
+        repaint(start, 0, end - start, getHeight());
+    }
+
     PdArray array;
-    std::vector<float> vec;
+    std::shared_ptr<SharedArrayView> view;
     std::vector<float> temp;
     std::atomic<bool> edited;
     bool error = false;
     const String stringArray = "array";
 
     int lastIndex = 0;
+    int lastArrayChangeOverflows = -1;
+    int64 lastVersion = -1;
 
     PlugDataAudioProcessor* pd;
 };
@@ -608,10 +889,9 @@ public:
 
     void updateValue() override
     {
+        // The graph reads the whole array when the size changed
         int currentSize = graph.array.size();
-        if (graph.vec.size() != currentSize) {
-
-            graph.vec.resize(currentSize);
+        if (graph.view->values.size() != currentSize) {
             size = currentSize;
         }
         graph.update();
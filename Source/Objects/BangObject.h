@@ -91,7 +91,7 @@ struct BangObject final : public IEMObject {
     {
         if (getValueOriginal() > std::numeric_limits<float>::epsilon()) {
             bangState = true;
-            repaint();
+            repaintOnNextFrame();
 
             auto currentTime = Time::getCurrentTime().getMillisecondCounter();
             auto timeSinceLast = currentTime - lastBang;
@@ -116,7 +116,7 @@ struct BangObject final : public IEMObject {
 
                     if (bangState) {
                         bangState = false;
-                        repaint();
+                        repaintOnNextFrame();
                     }
                 });
         }
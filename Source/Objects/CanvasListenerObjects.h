@@ -116,7 +116,8 @@ struct CanvasMouseObject final : public TextBase
 };
 
 
-struct CanvasVisibleObject final : public TextBase, public ComponentListener, public Timer
+// Told by the canvas when it starts or stops showing, instead of checking on a timer
+struct CanvasVisibleObject final : public TextBase, public Canvas::CanvasListener
 {
     struct t_fake_canvas_vis{
         t_object            x_obj;
@@ -124,48 +125,26 @@ struct CanvasVisibleObject final : public TextBase, public ComponentListener, pu
         t_canvas*           x_canvas;
     };
 
-
-    bool lastFocus = 0;
-    
     CanvasVisibleObject(void* ptr, Object* object)
         : TextBase(ptr, object)
     {
-        lastFocus = cnv->hasKeyboardFocus(true);
         setInterceptsMouseClicks(false, false);
-        cnv->addComponentListener(this);
-        startTimer(100);
+        cnv->addCanvasListener(this);
     }
     
     ~CanvasVisibleObject() {
-        cnv->addComponentListener(this);
-    }
-    
-    void updateVisibility() {
-        if(lastFocus != cnv->isShowing()) {
-            auto* vis = static_cast<t_fake_canvas_vis*>(ptr);
-           
-            lastFocus = cnv->isShowing();
-            outlet_float(vis->x_obj.ob_outlet, static_cast<int>(cnv->isShowing()));
-        }
-    }
-    
-    void componentBroughtToFront (Component &component) override
-    {
-        updateVisibility();
+        cnv->removeCanvasListener(this);
     }
     
-    void componentVisibilityChanged (Component &component) override
+    void canvasShowingChanged(bool isShowing) override
     {
-        updateVisibility();
-    }
-    
-    void timerCallback() override {
-        updateVisibility();
+        auto* vis = static_cast<t_fake_canvas_vis*>(ptr);
+        outlet_float(vis->x_obj.ob_outlet, static_cast<int>(isShowing));
     }
 };
 
 
-struct CanvasZoomObject final : public TextBase, public Value::Listener
+struct CanvasZoomObject final : public TextBase, public Canvas::CanvasListener
 {
     struct t_fake_zoom{
         t_object        x_obj;
@@ -181,12 +160,15 @@ struct CanvasZoomObject final : public TextBase, public Value::Listener
         : TextBase(ptr, object)
     {
         lastScale = static_cast<float>(cnv->main.zoomScale.getValue());
-        cnv->main.zoomScale.addListener(this);
+        cnv->addCanvasListener(this);
+    }
+
+    ~CanvasZoomObject() {
+        cnv->removeCanvasListener(this);
     }
     
-    void valueChanged(Value& v) override {
+    void canvasZoomChanged(float newScale) override {
         
-        float newScale = static_cast<float>(cnv->main.zoomScale.getValue());
         if(lastScale != newScale) {
             auto* zoom = static_cast<t_fake_zoom*>(ptr);
             outlet_float(zoom->x_obj.ob_outlet, newScale);
@@ -195,7 +177,7 @@ struct CanvasZoomObject final : public TextBase, public Value::Listener
     }
 };
 
-struct CanvasEditObject final : public TextBase, public Value::Listener
+struct CanvasEditObject final : public TextBase, public Canvas::CanvasListener
 {
     struct t_fake_edit
     {
@@ -212,12 +194,15 @@ struct CanvasEditObject final : public TextBase, public Value::Listener
     {
         // Don't use lock method, because that also responds to temporary lock
         lastEditMode = static_cast<float>(cnv->locked.getValue());
-        cnv->locked.addListener(this);
+        cnv->addCanvasListener(this);
+    }
+
+    ~CanvasEditObject() {
+        cnv->removeCanvasListener(this);
     }
     
-    void valueChanged(Value& v) override {
+    void canvasLockChanged(bool editMode) override {
         
-        bool editMode = static_cast<bool>(cnv->locked.getValue());
         if(lastEditMode != editMode) {
             auto* edit = static_cast<t_fake_edit*>(ptr);
             outlet_float(edit->x_obj.ob_outlet, edit->x_edit = editMode);
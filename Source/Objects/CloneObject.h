@@ -80,6 +80,19 @@ struct CloneObject final : public TextBase {
         openSubpatch();
     }
 
+    bool canInspectInstances() override
+    {
+        return clone_get_n(static_cast<t_gobj*>(ptr)) > 0;
+    }
+
+    void inspectInstances() override
+    {
+        Dialogs::showCloneInspector(&inspector, &cnv->main, ptr, getText(), static_cast<t_fake_clone*>(ptr)->x_startvoice);
+    }
+
 protected:
     pd::Patch subpatch;
+
+    // Owned by the object, so it's closed when the clone gets deleted
+    std::unique_ptr<Dialog> inspector;
 };
@@ -151,6 +151,6 @@ struct CycloneCommentObject final : public GUIObject {
 
     int getBestTextWidth(String const& text)
     {
-        return std::max<float>(round(font.getStringWidthFloat(text) + 14.0f), 32);
+        return std::max<float>(round(FastStringWidth::forFont(font).getStringWidth(text) + 14.0f), 32);
     }
 };
@@ -62,6 +62,26 @@ ObjectBase::ObjectBase(void* obj, Object* parent)
 {
 }
 
+ObjectBase::~ObjectBase()
+{
+    stopFrameCallback();
+}
+
+void ObjectBase::repaintOnNextFrame()
+{
+    cnv->main.repaintScheduler.repaint(this);
+}
+
+void ObjectBase::startFrameCallback(double frequency, std::function<bool()> callback, bool onlyWhenShowing)
+{
+    cnv->main.repaintScheduler.addFrameCallback(this, frequency, std::move(callback), onlyWhenShowing);
+}
+
+void ObjectBase::stopFrameCallback()
+{
+    cnv->main.repaintScheduler.removeFrameCallback(this);
+}
+
 String ObjectBase::getText()
 {
     if (!cnv->patch.checkObject(ptr))
@@ -120,7 +140,7 @@ void ObjectBase::closeOpenedSubpatchers()
     auto& main = object->cnv->main;
     auto* tabbar = &main.tabbar;
 
-    if (!tabbar)
+    if (!tabbar || object->cnv->isUnloading)
         return;
 
     for (int n = 0; n < tabbar->getNumTabs(); n++) {
@@ -395,7 +415,7 @@ void GUIObject::setValueScaled(float v)
 void GUIObject::startEdition()
 {
     edited = true;
-    processor.enqueueMessages("gui", "mouse", { 1.f });
+    processor.enqueueGuiMouse(true);
 
     value = getValue();
 }
@@ -403,31 +423,47 @@ void GUIObject::startEdition()
 void GUIObject::stopEdition()
 {
     edited = false;
-    processor.enqueueMessages("gui", "mouse", { 0.f });
+    processor.enqueueGuiMouse(false);
 }
 
 void GUIObject::updateValue()
 {
     if (!edited) {
-        pd->enqueueFunction(
-            [_this = SafePointer(this)]() {
-                if (!_this)
-                    return;
-
-                float const v = _this->getValue();
-                if (_this->value != v) {
-                    MessageManager::callAsync(
-                        [_this, v]() mutable {
-                            if (_this) {
-                                _this->value = v;
-                                _this->update();
-                            }
-                        });
-                }
-            });
+        cnv->requestValueUpdate(this);
     }
 }
 
+void GUIObject::pollValues(pd::Instance* pd, std::vector<SafePointer<GUIObject>>&& objects)
+{
+    pd->enqueueBulkFunction(
+        [objects = std::move(objects)]() {
+            std::vector<std::pair<SafePointer<GUIObject>, float>> changed;
+
+            for (auto const& object : objects) {
+                if (!object)
+                    continue;
+
+                float const v = object->getValue();
+                if (object->value != v) {
+                    changed.emplace_back(object, v);
+                }
+            }
+
+            if (changed.empty())
+                return;
+
+            MessageManager::callAsync(
+                [changed = std::move(changed)]() {
+                    for (auto const& [object, v] : changed) {
+                        if (object) {
+                            object->value = v;
+                            object->update();
+                        }
+                    }
+                });
+        });
+}
+
 void GUIObject::componentMovedOrResized(Component& component, bool moved, bool resized)
 {
     updateLabel();
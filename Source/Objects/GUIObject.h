@@ -27,9 +27,19 @@ struct ObjectBase : public Component
     PlugDataAudioProcessor* pd;
 
     ObjectBase(void* obj, Object* parent);
+    ~ObjectBase() override;
 
     void paint(Graphics& g) override;
 
+    // Repaints on the next display frame, together with all other objects that changed
+    void repaintOnNextFrame();
+
+    // Calls the function on display frames, at most the given number of times per second, until the object is deleted
+    // Use this instead of a Timer for polling and animation, so all objects update in the same frame
+    // The function returns whether anything changed, the rate drops while nothing does and polling stops while hidden
+    void startFrameCallback(double frequency, std::function<bool()> callback, bool onlyWhenShowing = true);
+    void stopFrameCallback();
+
     // Functions to show and hide a text editor
     // Used internally, or to trigger a text editor when creating a new object (comment, message, new text object etc.)
     virtual void showEditor() {};
@@ -55,14 +65,32 @@ struct ObjectBase : public Component
 
     virtual void openFromMenu() {};
 
+    // Objects with many copies of a patch, like [clone], can show the values in all of them at once
+    virtual bool canInspectInstances() { return false; }
+
+    virtual void inspectInstances() {};
+
     // Flag to make object visible or hidden inside a GraphOnParent
     virtual bool hideInGraph()
     {
         return false;
     }
 
+    // Objects that redraw all the time, a graph that contains one isn't cached into an image
+    virtual bool isAnimated()
+    {
+        return false;
+    }
+
     virtual void setText(String const&) {};
 
+    // Called when the object got renamed to a new object of the same class
+    // Objects that can show the new object without being recreated take the pointer and return true
+    virtual bool setPointer(void* newPtr)
+    {
+        return false;
+    }
+
     // Most objects ignore mouseclicks when locked
     // Objects can override this to do custom locking behaviour
     virtual void lock(bool isLocked)
@@ -123,6 +151,9 @@ struct GUIObject : public ObjectBase, public pd::MessageListener
 
     void updateValue() override;
 
+    // Reads the values of all objects in one job on pd's thread, and applies the changed ones in one message
+    static void pollValues(pd::Instance* pd, std::vector<SafePointer<GUIObject>>&& objects);
+
     virtual void update() {};
     virtual void updateFromAudioThread() {};
 
@@ -130,11 +130,7 @@ public:
         if (!canvas)
             return;
 
-        for (auto& object : canvas->objects) {
-            if (object->gui) {
-                object->gui->updateValue();
-            }
-        }
+        canvas->updateGuiValues();
     }
 
     void updateDrawables() override
@@ -167,6 +163,11 @@ public:
         }
     }
 
+    bool isAnimated() override
+    {
+        return canvas && canvas->hasAnimatedObjects();
+    }
+
     pd::Patch* getPatch() override
     {
         return &subpatch;
@@ -4,6 +4,8 @@
  // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
  */
 
+#include <bitset>
+
 // Inherit to customise drawing
 struct MIDIKeyboard : public MidiKeyboardComponent {
     MIDIKeyboard(MidiKeyboardState& stateToUse, Orientation orientationToUse)
@@ -17,8 +19,25 @@ struct MIDIKeyboard : public MidiKeyboardComponent {
         setColour(MidiKeyboardComponent::shadowColourId, Colours::transparentWhite);
     }
 
+    // Notes that pd turned on, only the keys that changed get repainted
+    void setActiveNotes(std::bitset<128> const& notes)
+    {
+        auto const changed = notes ^ activeNotes;
+        activeNotes = notes;
+
+        if (changed.none())
+            return;
+
+        for (int note = getRangeStart(); note <= getRangeEnd(); note++) {
+            if (changed[note])
+                repaint(getRectangleForKey(note).getSmallestIntegerContainer());
+        }
+    }
+
     void drawWhiteNote(int midiNoteNumber, Graphics& g, Rectangle<float> area, bool isDown, bool isOver, Colour lineColour, Colour textColour) override
     {
+        isDown = isDown || activeNotes[midiNoteNumber];
+
         auto c = Colour(225, 225, 225);
         if (isOver)
             c = Colour(235, 235, 235);
@@ -53,6 +72,8 @@ struct MIDIKeyboard : public MidiKeyboardComponent {
 
     void drawBlackNote(int midiNoteNumber, Graphics& g, Rectangle<float> area, bool isDown, bool isOver, Colour noteFillColour) override
     {
+        isDown = isDown || activeNotes[midiNoteNumber];
+
         auto c = Colour(90, 90, 90);
 
         if (isOver)
@@ -63,10 +84,12 @@ struct MIDIKeyboard : public MidiKeyboardComponent {
         g.setColour(c);
         g.fillRect(area);
     }
+
+private:
+    std::bitset<128> activeNotes;
 };
 // ELSE keyboard
 struct KeyboardObject final : public GUIObject
-    , public Timer
     , public MidiKeyboardStateListener {
     typedef struct _edit_proxy {
         t_object p_obj;
@@ -132,7 +155,8 @@ struct KeyboardObject final : public GUIObject
             octaves = 4;
         }
 
-        startTimer(150);
+        // The pd object tells us when its notes change, after this we only update when it's marked as dirty
+        keyboard.setActiveNotes(getActiveNotes());
     }
 
     void updateBounds() override
@@ -251,18 +275,24 @@ struct KeyboardObject final : public GUIObject
         }
     }
 
-    void updateValue() override
+    std::bitset<128> getActiveNotes() const
     {
         auto* keyboardObject = static_cast<t_keyboard*>(ptr);
 
-        for (int i = keyboard.getRangeStart(); i < keyboard.getRangeEnd(); i++) {
-            if (keyboardObject->x_tgl_notes[i] && !(state.isNoteOn(2, i) && state.isNoteOn(1, i))) {
-                state.noteOn(2, i, 1.0f);
-            }
-            if (!keyboardObject->x_tgl_notes[i] && !(state.isNoteOn(2, i) && state.isNoteOn(1, i))) {
-                state.noteOff(2, i, 1.0f);
-            }
+        std::bitset<128> notes;
+        for (int i = 0; i < 128; i++) {
+            notes[i] = keyboardObject->x_tgl_notes[i] != 0;
         }
+        return notes;
+    }
+
+    void updateValue() override
+    {
+        pd->getCallbackLock()->enter();
+        auto const notes = getActiveNotes();
+        pd->getCallbackLock()->exit();
+
+        keyboard.setActiveNotes(notes);
     }
         
     void receiveObjectMessage(const String& symbol, std::vector<pd::Atom>& atoms) override {
@@ -291,15 +321,6 @@ struct KeyboardObject final : public GUIObject
         }
     }
 
-    void timerCallback() override
-    {
-        pd->enqueueFunction([_this = SafePointer(this)] {
-            if (!_this)
-                return;
-            _this->updateValue();
-        });
-    }
-
     void paintOverChildren(Graphics& g) override
     {
         bool selected = cnv->isSelected(object) && !cnv->isGraph;
@@ -33,11 +33,11 @@ typedef struct _numbox {
     char x_buf[32]; // number buffer
 } t_numbox;
 
-struct NumboxTildeObject final : public GUIObject
-    , public Timer {
+struct NumboxTildeObject final : public GUIObject {
     DraggableNumber input;
 
-    int nextInterval = 100;
+    std::atomic<int> nextInterval = 100;
+    int displayInterval = 100;
     std::atomic<int> mode = 0;
 
     Value interval, ramp, init;
@@ -83,7 +83,7 @@ struct NumboxTildeObject final : public GUIObject
 
         mode = static_cast<t_numbox*>(ptr)->x_outmode;
 
-        startTimer(nextInterval);
+        startDisplayUpdates();
         repaint();
     }
 
@@ -218,13 +218,35 @@ struct NumboxTildeObject final : public GUIObject
         g.drawRoundedRectangle(getLocalBounds().toFloat().reduced(0.5f), Constants::objectCornerRadius, 1.0f);
     }
 
-    void timerCallback() override
+    bool isAnimated() override
     {
+        return true;
+    }
+
+    // Refreshes the displayed number at the rate set in the object
+    void startDisplayUpdates()
+    {
+        displayInterval = std::max(nextInterval.load(), 1);
+        startFrameCallback(1000.0 / displayInterval, [this]() { return updateDisplay(); });
+    }
+
+    // Returns whether the displayed number changed
+    bool updateDisplay()
+    {
+        bool changed = false;
         if (!mode) {
-            input.setText(input.formatNumber(getValueOriginal()), dontSendNotification);
+            auto text = input.formatNumber(getValueOriginal());
+            if (text != input.getText()) {
+                input.setText(text, dontSendNotification);
+                changed = true;
+            }
+        }
+
+        if (nextInterval != displayInterval) {
+            startDisplayUpdates();
         }
 
-        startTimer(nextInterval);
+        return changed;
     }
 
     void setValue(float newValue)
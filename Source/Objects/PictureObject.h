@@ -4,6 +4,8 @@
  // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
  */
 
+#include "../Utility/PictureCache.h"
+
 // ELSE pic
 struct PictureObject final : public GUIObject {
     typedef struct _edit_proxy {
@@ -62,8 +64,12 @@ struct PictureObject final : public GUIObject {
 
     void paint(Graphics& g) override
     {
-        if (imageFile.existsAsFile()) {
-            g.drawImageAt(img, 0, 0);
+        if (picture && picture->image.isValid()) {
+            // Zoomed out, a smaller copy looks the same and is a lot faster to draw
+            auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+            g.drawImage(picture->getImageForScale(scale), Rectangle<float>(0, 0, img.getWidth(), img.getHeight()));
+        } else if (imageFile.existsAsFile()) {
+            // Still being decoded
         } else {
             g.setFont(30);
             g.setColour(object->findColour(PlugDataColour::canvasTextColourId));
@@ -138,13 +144,32 @@ struct PictureObject final : public GUIObject {
         pic->x_filename = gensym(charptr);
         pic->x_fullname = gensym(charptr);
 
-        img = ImageFileFormat::loadFrom(imageFile);
+        if (!imageFile.existsAsFile()) {
+            picture.reset();
+            img = Image();
+            pic->x_width = 0;
+            pic->x_height = 0;
+
+            object->updateBounds();
+            repaint();
+            return;
+        }
+
+        PictureCache::getInstance().load(imageFile, [_this = SafePointer(this), file = imageFile](PictureCache::PicturePtr loaded) {
+            // A different file could have been opened while this one was decoding
+            if (!_this || _this->imageFile != file)
+                return;
+
+            _this->picture = loaded;
+            _this->img = loaded->image;
 
-        pic->x_width = img.getWidth();
-        pic->x_height = img.getHeight();
+            auto* pic = static_cast<t_pic*>(_this->ptr);
+            pic->x_width = _this->img.getWidth();
+            pic->x_height = _this->img.getHeight();
 
-        object->updateBounds();
-        repaint();
+            _this->object->updateBounds();
+            _this->repaint();
+        });
     }
 
     static char const* pic_filepath(t_pic* x, char const* filename)
@@ -163,4 +188,7 @@ struct PictureObject final : public GUIObject {
     Value path;
     File imageFile;
     Image img;
+
+    // Shared with every other [pic] that shows the same file
+    PictureCache::PicturePtr picture;
 };
@@ -114,7 +114,7 @@ struct RadioObject final : public IEMObject {
 
     void update() override
     {
-        repaint();
+        repaintOnNextFrame();
     }
 
     void updateBounds() override
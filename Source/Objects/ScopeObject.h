@@ -50,6 +50,7 @@ struct t_fake_oscope {
     t_symbol*       x_bindsym;
     t_clock*        x_clock;
     void*           x_handle;
+    unsigned int    x_snapshot_seq;
 };
 
 struct t_fake_scope {
@@ -87,20 +88,23 @@ struct t_fake_scope {
     t_symbol       *x_bindsym;
     t_clock        *x_clock;
     t_pd           *x_handle;
+    unsigned int    x_snapshot_seq;
 };
 
 template<typename S>
-struct ScopeBase : public GUIObject, public Timer {
+struct ScopeBase : public GUIObject {
     
     std::vector<float> x_buffer;
     std::vector<float> y_buffer;
+    // Odd values never match a finished snapshot, so they force the next one to be mapped again
+    unsigned int lastSequence = 1;
     
     Value gridColour, triggerMode, triggerValue, samplesPerPoint, bufferSize, delay, signalRange;
         
     ScopeBase(void* ptr, Object* object)
         : GUIObject(ptr, object)
     {
-        startTimerHz(25);
+        startFrameCallback(25, [this]() { return updateScope(); });
         
         auto* scope = static_cast<S*>(ptr);
         triggerMode = scope->x_trigmode + 1;
@@ -151,8 +155,14 @@ struct ScopeBase : public GUIObject, public Timer {
         object->setObjectBounds({x, y, w, h});
     }
 
+    bool isAnimated() override
+    {
+        return true;
+    }
+
     void resized() override
     {
+        lastSequence = 1;
     }
 
     void checkBounds() override
@@ -217,33 +227,50 @@ struct ScopeBase : public GUIObject, public Timer {
         static_cast<S*>(ptr)->x_height = getHeight();
     }
     
-    void timerCallback() override
+    // Returns whether there was a new snapshot to show
+    bool updateScope()
     {
         int bufsize, mode;
         float min, max;
         
         if(object->iolets.size() == 3) object->iolets[2]->setVisible(false);
 
-        if(pd->getCallbackLock()->tryEnter())
-        {
-            auto* x = static_cast<S*>(ptr);
-            bufsize = x->x_bufsize;
-            min = x->x_min;
-            max = x->x_max;
-            mode = x->x_xymode;
-            
+        auto* x = static_cast<S*>(ptr);
+        min = x->x_min;
+        max = x->x_max;
+        mode = x->x_xymode;
+
+        // The DSP side makes the sequence odd while it writes a new snapshot, so we can copy it without taking the audio lock
+        // If it changed while we were copying, try again
+        auto readSequence = [x]() { return *static_cast<volatile unsigned int*>(&x->x_snapshot_seq); };
+
+        bool gotSnapshot = false;
+        for(int attempt = 0; attempt < 4 && !gotSnapshot; attempt++) {
+            auto sequence = readSequence();
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if(sequence & 1) continue;
+
+            // Nothing new since the last frame
+            if(sequence == lastSequence) return false;
+
+            bufsize = std::clamp(x->x_lastbufsize, 0, SCOPE_MAXBUFSIZE * 4);
+
             if(x_buffer.size() != bufsize) {
                 x_buffer.resize(bufsize);
                 y_buffer.resize(bufsize);
             }
-            
+
             std::copy(x->x_xbuflast, x->x_xbuflast + bufsize, x_buffer.data());
             std::copy(x->x_ybuflast, x->x_ybuflast + bufsize, y_buffer.data());
-            pd->getCallbackLock()->exit();
-        }
-        else {
-            return;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            gotSnapshot = readSequence() == sequence;
+            if(gotSnapshot) lastSequence = sequence;
         }
+
+        // Keep showing the last snapshot, we'll get a new one next frame
+        if(!gotSnapshot) return true;
         
         if(min > max) {
             auto temp = max;
@@ -251,34 +278,40 @@ struct ScopeBase : public GUIObject, public Timer {
             min = temp;
         }
 
-        float oldx = 0, oldy = 0;
         float dx = getWidth() / (float)bufsize;
         float dy = getHeight() / (float)bufsize;
 
-        for(int n = 0; n < bufsize; n++) {
-            if(mode == 1) {
-                y_buffer[n] = jmap<float>(x_buffer[n], min, max, getHeight(), 0);
-                x_buffer[n] = oldx;
-                oldx += dx;
-            }
-            else if(mode == 2) {
-                x_buffer[n] = jmap<float>(y_buffer[n], min, max, 0, getWidth());
-                y_buffer[n] = oldy;
-                oldy += dy;
-            }
-            else if(mode == 3) {
-                x_buffer[n] = jmap<float>(x_buffer[n], min, max, 0, getWidth());
-                y_buffer[n] = jmap<float>(y_buffer[n], min, max, getHeight(), 0);
-            }
+        if(mode == 1) {
+            mapRange(y_buffer.data(), x_buffer.data(), bufsize, min, max, getHeight(), 0);
+            for(int n = 0; n < bufsize; n++) x_buffer[n] = n * dx;
+        }
+        else if(mode == 2) {
+            mapRange(x_buffer.data(), y_buffer.data(), bufsize, min, max, 0, getWidth());
+            for(int n = 0; n < bufsize; n++) y_buffer[n] = n * dy;
+        }
+        else if(mode == 3) {
+            mapRange(x_buffer.data(), x_buffer.data(), bufsize, min, max, 0, getWidth());
+            mapRange(y_buffer.data(), y_buffer.data(), bufsize, min, max, getHeight(), 0);
         }
         
         repaint();
+        return true;
+    }
+
+    // Same as jmap over a whole buffer, as a multiply and add so it can use SIMD
+    static void mapRange(float* dest, float const* src, int num, float sourceMin, float sourceMax, float targetMin, float targetMax)
+    {
+        auto scale = (targetMax - targetMin) / (sourceMax - sourceMin);
+        FloatVectorOperations::multiply(dest, src, scale, num);
+        FloatVectorOperations::add(dest, targetMin - sourceMin * scale, num);
     }
 
     void updateValue() override {};
     
     void valueChanged(Value& v) override
     {
+        lastSequence = 1;
+        
         auto* scope = static_cast<S*>(ptr);
         if(v.refersToSameSourceAs(primaryColour)) {
             colourToHexArray(Colour::fromString(primaryColour.toString()), scope->x_fg);
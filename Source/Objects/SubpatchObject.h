@@ -12,9 +12,11 @@ struct SubpatchObject final : public TextBase
     {
         isGraphChild = false;
         hideNameAndArgs = static_cast<bool>(subpatch.getPointer()->gl_hidetext);
+        runCompiled = cnv->pd->subpatchCompiler.isCompiled(ptr);
         
         isGraphChild.addListener(this);
         hideNameAndArgs.addListener(this);
+        runCompiled.addListener(this);
         
         object->hvccMode.addListener(this);
         
@@ -66,7 +68,7 @@ struct SubpatchObject final : public TextBase
     
     ObjectParameters getParameters() override
     {
-        return { { "Is graph", tBool, cGeneral, &isGraphChild, { "No", "Yes" } }, { "Hide name and arguments", tBool, cGeneral, &hideNameAndArgs, { "No", "Yes" } } };
+        return { { "Is graph", tBool, cGeneral, &isGraphChild, { "No", "Yes" } }, { "Hide name and arguments", tBool, cGeneral, &hideNameAndArgs, { "No", "Yes" } }, { "Run compiled (experimental)", tBool, cGeneral, &runCompiled, { "No", "Yes" } } };
     };
     
     void valueChanged(Value& v) override
@@ -83,6 +85,9 @@ struct SubpatchObject final : public TextBase
                 checkHvccCompatibility(subpatch);
             }
         }
+        else if (v.refersToSameSourceAs(runCompiled)) {
+            updateCompiledMode();
+        }
     }
     
     bool canOpenFromMenu() override
@@ -95,25 +100,43 @@ struct SubpatchObject final : public TextBase
         openSubpatch();
     }
     
-    static void checkHvccCompatibility(pd::Patch& patch, String prefix = "") {
-        
-        auto* instance = patch.instance;
-        
-        for(auto* object : patch.getObjects()) {
-            const String name = libpd_get_object_class_name(object);
-            
-            if(name == "canvas" || name == "graph") {
-                auto patch = pd::Patch(object, instance);
-                
-                char* text = nullptr;
-                int size = 0;
-                libpd_get_object_text(object, &text, &size);
-                
-                checkHvccCompatibility(patch, prefix + String(text) + " -> ");
-            }
-            else if(!Object::hvccObjects.contains(name)) {
-                instance->logWarning(String("Warning: object \"" + prefix + name + "\" is not supported in Compiled Mode").toRawUTF8());
+    // Compiles the subpatch with Heavy and swaps it in for its objects, or swaps the objects back in
+    void updateCompiledMode()
+    {
+        auto& compiler = cnv->pd->subpatchCompiler;
+        auto shouldRunCompiled = static_cast<bool>(runCompiled.getValue());
+
+        if (!shouldRunCompiled) {
+            if (compiler.isCompiled(ptr)) compiler.release(ptr);
+            return;
+        }
+
+        if (compiler.isCompiled(ptr)) return;
+
+        auto incompatible = Object::findHvccIncompatibleObjects(subpatch);
+        if (!incompatible.isEmpty()) {
+            cnv->pd->logError("Can't compile subpatch, these objects are not supported by Heavy: " + incompatible.joinIntoString(", "));
+            runCompiled = false;
+            return;
+        }
+
+        cnv->pd->logMessage("Compiling subpatch...");
+
+        compiler.compile(ptr, [_this = SafePointer(this), processor = cnv->pd](Result result) {
+            if (result.failed()) {
+                processor->logError(result.getErrorMessage());
+                if (_this) _this->runCompiled = false;
+                return;
             }
+
+            processor->logMessage("Subpatch is running compiled");
+        });
+    }
+
+    static void checkHvccCompatibility(pd::Patch& patch) {
+        
+        for(auto const& name : Object::findHvccIncompatibleObjects(patch)) {
+            patch.instance->logWarning(String("Warning: object \"" + name + "\" is not supported in Compiled Mode").toRawUTF8());
         }
     }
     
@@ -121,6 +144,7 @@ protected:
     pd::Patch subpatch;
     Value isGraphChild = Value(var(false));
     Value hideNameAndArgs = Value(var(false));
+    Value runCompiled = Value(var(false));
     
     bool locked = false;
 };
@@ -79,36 +79,14 @@ struct TextDefineObject final : public TextBase {
     {
         auto& textbuf = static_cast<t_fake_text_define*>(ptr)->x_textbuf;
 
-        text = text.removeCharacters("\r");
-        auto lines = StringArray::fromTokens(text, ";", "\"");
-        auto atoms = std::vector<t_atom>();
-        atoms.reserve(lines.size());
-
-        for (int i = 0; i < lines.size(); i++) {
-            if (lines[i].isEmpty())
-                continue;
-
-            auto words = StringArray::fromTokens(lines[i], " ", "\"");
-            for (int j = 0; j < words.size(); j++) {
-                atoms.emplace_back();
-                if (words[j].containsOnly("0123456789e.-+") && words[j] != "-") {
-                    SETFLOAT(&atoms.back(), words[j].getFloatValue());
-                } else {
-                    SETSYMBOL(&atoms.back(), gensym((words[j].toRawUTF8())));
-                }
-            }
-
-            atoms.emplace_back();
-            SETSYMBOL(&atoms.back(), gensym(";"));
-        }
-
-        pd->enqueueFunction([this, atoms, &textbuf]() mutable {
-            binbuf_clear(textbuf.b_binbuf);
-
-            t_binbuf* z = binbuf_new();
-            binbuf_restore(z, atoms.size(), atoms.data());
-            binbuf_add(textbuf.b_binbuf, binbuf_getnatom(z), binbuf_getvec(z));
-            binbuf_free(z);
+        // Parsed by pd's own tokeniser on the pd thread, straight into the text's binbuf
+        // For long sequences this saves splitting the text into words and interning every word on the message thread
+        auto content = text.removeCharacters("\r").toStdString();
+
+        pd->enqueueFunction([content, &textbuf]() {
+            sys_lock();
+            binbuf_text(textbuf.b_binbuf, content.c_str(), content.size());
+            sys_unlock();
         });
     }
 
@@ -120,9 +98,14 @@ struct TextDefineObject final : public TextBase {
         char* bufp;
         int lenp;
 
+        pd->setThis();
+        pd->getCallbackLock()->enter();
         binbuf_gettext(binbuf, &bufp, &lenp);
+        pd->getCallbackLock()->exit();
 
-        return String::fromUTF8(bufp, lenp);
+        auto text = String::fromUTF8(bufp, lenp);
+        freebytes(bufp, lenp);
+        return text;
     }
 
     bool canOpenFromMenu() override
@@ -86,7 +86,7 @@ struct TextBase : public ObjectBase
 
     virtual int getBestTextWidth(String const& text)
     {
-        return std::max<float>(round(font.getStringWidthFloat(text) + 14.0f), 32);
+        return std::max<float>(round(FastStringWidth::forFont(font).getStringWidth(text) + 14.0f), 32);
     }
 
     void textEditorReturnKeyPressed(TextEditor& ed) override
@@ -260,4 +260,13 @@ struct TextObject final : public TextBase {
         : TextBase(obj, parent, isValid)
     {
     }
+
+    // Only the arguments changed, so the text is all there is to update
+    bool setPointer(void* newPtr) override
+    {
+        ptr = newPtr;
+        objectText = getText();
+        repaint();
+        return true;
+    }
 };
@@ -120,6 +120,6 @@ struct ToggleObject final : public IEMObject {
     void update() override
     {
         toggleState = getValueOriginal() > std::numeric_limits<float>::epsilon();
-        repaint();
+        repaintOnNextFrame();
     }
 };
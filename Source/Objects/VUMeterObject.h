@@ -37,7 +37,9 @@ struct VUMeterObject final : public IEMObject {
 
     void paint(Graphics& g) override
     {
-        auto values = std::vector<float> { getValue(), getRMS() };
+        float const values[2] = { getValue(), getRMS() };
+        lastPeak = values[0];
+        lastRMS = values[1];
 
         int height = getHeight();
         int width = getWidth();
@@ -106,8 +108,18 @@ struct VUMeterObject final : public IEMObject {
         g.drawRoundedRectangle(getLocalBounds().toFloat().reduced(0.5f), Constants::objectCornerRadius, 1.0f);
     }
 
+    bool isAnimated() override
+    {
+        return true;
+    }
+
+    // Only repaint when the level actually changed
     void updateValue() override
     {
-        repaint();
+        if (getValue() != lastPeak || getRMS() != lastRMS) {
+            repaintOnNextFrame();
+        }
     };
+
+    float lastPeak = 0.0f, lastRMS = 0.0f;
 };
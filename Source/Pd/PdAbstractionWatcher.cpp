@@ -0,0 +1,132 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+extern "C" {
+#include <m_pd.h>
+#include <g_canvas.h>
+
+#include "x_libpd_extra_utils.h"
+#include "x_libpd_mod_utils.h"
+}
+
+#include "PdAbstractionWatcher.h"
+#include "PdInstance.h"
+
+namespace pd {
+
+static void findPatchFolders(t_canvas* cnv, StringArray& folders)
+{
+    if (!cnv->gl_owner || canvas_isabstraction(cnv))
+        folders.addIfNotAlreadyThere(String::fromUTF8(canvas_getdir(cnv)->s_name));
+
+    for (t_gobj* y = cnv->gl_list; y; y = y->g_next) {
+        if (pd_class(&y->g_pd) == canvas_class)
+            findPatchFolders(reinterpret_cast<t_canvas*>(y), folders);
+    }
+}
+
+AbstractionWatcher::AbstractionWatcher(Instance* inst)
+    : instance(inst)
+{
+    watcher.addListener(this);
+}
+
+AbstractionWatcher::~AbstractionWatcher()
+{
+    watcher.removeListener(this);
+}
+
+void AbstractionWatcher::updateWatchedFolders()
+{
+    StringArray folders;
+
+    instance->setThis();
+    instance->getCallbackLock()->enter();
+
+    for (auto* cnv = pd_getcanvaslist(); cnv; cnv = cnv->gl_next)
+        findPatchFolders(cnv, folders);
+
+    instance->getCallbackLock()->exit();
+
+    auto watched = watcher.getWatchedFolders();
+
+    for (auto& folder : watched) {
+        if (!folders.contains(folder.getFullPathName().replaceCharacter('\\', '/')))
+            watcher.removeFolder(folder);
+    }
+
+    for (auto& path : folders) {
+        auto folder = File(path);
+        if (folder.isDirectory() && !watched.contains(folder))
+            watcher.addFolder(folder);
+    }
+}
+
+void AbstractionWatcher::ignoreNextChange(File const& file)
+{
+    savedFiles[file.getFullPathName()] = Time::getMillisecondCounter();
+}
+
+void AbstractionWatcher::fileChanged(const File file, FileSystemWatcher::FileSystemEvent fsEvent)
+{
+    if (fsEvent != FileSystemWatcher::fileUpdated)
+        foldersChanged = true;
+
+    if (!file.hasFileExtension("pd") || fsEvent == FileSystemWatcher::fileDeleted || fsEvent == FileSystemWatcher::fileRenamedOldName)
+        return;
+
+    pendingChanges.addIfNotAlreadyThere(file);
+}
+
+// Called for every batch of changes in the watched folders, also when none of them was a patch
+void AbstractionWatcher::fsChangeCallback()
+{
+    auto changes = std::move(pendingChanges);
+    pendingChanges.clear();
+
+    // Also when plugdata saved the file itself, a new abstraction or external might make a name that wasn't found work
+    if (std::exchange(foldersChanged, false)) {
+        instance->enqueueFunction([]() {
+            libpd_pathcache_invalidate();
+        });
+    }
+
+    auto now = Time::getMillisecondCounter();
+    bool reloaded = false;
+
+    for (auto& file : changes) {
+        // Reloading the patch that was just saved would replace the canvas that is being edited
+        auto saved = savedFiles.find(file.getFullPathName());
+        if (saved != savedFiles.end() && now - saved->second < ignoreTime)
+            continue;
+
+        auto name = file.getFileName();
+        auto dir = file.getParentDirectory().getFullPathName().replaceCharacter('\\', '/');
+
+        // Runs in between two DSP ticks, pd swaps all instances of the abstraction at once
+        instance->enqueueFunction([name, dir]() {
+            libpd_reload_abstraction(name.toRawUTF8(), dir.toRawUTF8());
+        });
+        reloaded = true;
+    }
+
+    for (auto it = savedFiles.begin(); it != savedFiles.end();) {
+        if (now - it->second >= ignoreTime)
+            it = savedFiles.erase(it);
+        else
+            ++it;
+    }
+
+    if (reloaded) {
+        instance->waitForStateUpdate();
+        instance->synchroniseAll();
+
+        // Reloaded abstractions can use abstractions from other folders
+        updateWatchedFolders();
+    }
+}
+
+} // namespace pd
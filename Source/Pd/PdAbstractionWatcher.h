@@ -0,0 +1,51 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <map>
+
+#include "../Utility/FileSystemWatcher.h"
+
+namespace pd {
+
+class Instance;
+
+// Reloads the instances of an abstraction when its file gets edited, also when that happens in another program
+// Watches the folders of the open patches and of every abstraction that is used in them
+class AbstractionWatcher : public FileSystemWatcher::Listener {
+public:
+    explicit AbstractionWatcher(Instance* instance);
+    ~AbstractionWatcher() override;
+
+    // Looks for the folders that contain the open patches and their abstractions again. Message thread only
+    void updateWatchedFolders();
+
+    // Called when plugdata saves a patch itself, pd already reloaded the other instances of it
+    void ignoreNextChange(File const& file);
+
+    void fsChangeCallback() override;
+    void fileChanged(const File file, FileSystemWatcher::FileSystemEvent fsEvent) override;
+
+private:
+    Instance* instance;
+
+    Array<File> pendingChanges;
+
+    // A file was added, removed or renamed, so objects might be found in another place now
+    bool foldersChanged = false;
+
+    // Files saved by plugdata, with the time they were saved at
+    std::map<String, uint32> savedFiles;
+
+    static constexpr uint32 ignoreTime = 3000;
+
+    FileSystemWatcher watcher;
+};
+
+} // namespace pd
@@ -0,0 +1,362 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+extern "C" {
+#include <m_pd.h>
+#include <g_canvas.h>
+
+#include "x_libpd_compiled.h"
+#include "x_libpd_mod_utils.h"
+}
+
+#include "PdCompiler.h"
+#include "PdInstance.h"
+#include "PdPatch.h"
+
+namespace pd {
+
+#if JUCE_WINDOWS
+static String const exeSuffix = ".exe";
+static String const libraryExtension = ".dll";
+#elif JUCE_MAC
+static String const exeSuffix = "";
+static String const libraryExtension = ".dylib";
+#else
+static String const exeSuffix = "";
+static String const libraryExtension = ".so";
+#endif
+
+// Same location the export dialog installs the toolchain to
+static File getToolchain()
+{
+    auto toolchain = File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory).getChildFile("plugdata").getChildFile("Toolchain");
+#if JUCE_WINDOWS
+    toolchain = toolchain.getChildFile("usr");
+#endif
+    return toolchain;
+}
+
+static File getHeavyExecutable()
+{
+    return getToolchain().getChildFile("bin").getChildFile("Heavy").getChildFile("Heavy" + exeSuffix);
+}
+
+SubpatchCompiler::SubpatchCompiler(Instance* parent)
+    : instance(parent)
+{
+}
+
+SubpatchCompiler::~SubpatchCompiler()
+{
+    pool.removeAllJobs(true, -1);
+}
+
+bool SubpatchCompiler::isToolchainInstalled()
+{
+    return getHeavyExecutable().existsAsFile();
+}
+
+bool SubpatchCompiler::isCompiled(void* subpatch) const
+{
+    return libraries.count(subpatch) > 0;
+}
+
+void SubpatchCompiler::compile(void* subpatch, std::function<void(Result)> onDone)
+{
+    if (!isToolchainInstalled()) {
+        onDone(Result::fail("The Heavy toolchain is not installed, it can be installed from the export dialog"));
+        return;
+    }
+
+    instance->setThis();
+
+    auto content = Patch(subpatch, instance).getCanvasContent();
+
+    String converted;
+    int numInputs, numOutputs;
+    auto result = convertForHeavy(content, converted, numInputs, numOutputs);
+    if (result.failed()) {
+        onDone(result);
+        return;
+    }
+
+    // Abstractions are looked up from the patch's location first, like pd does
+    auto searchPaths = StringArray { String::fromUTF8(canvas_getdir(static_cast<t_canvas*>(subpatch))->s_name) };
+
+    char* paths[1024];
+    int numItems;
+    libpd_get_search_paths(paths, &numItems);
+
+    for (int i = 0; i < numItems; i++) {
+        searchPaths.add(paths[i]);
+    }
+
+    searchPaths.removeDuplicates(false);
+
+    instance->enqueueFunction([subpatch]() {
+        libpd_compiled_reserve(static_cast<t_canvas*>(subpatch));
+    });
+
+    pool.addJob([_this = WeakReference<SubpatchCompiler>(this), subpatch, converted, searchPaths, numInputs, numOutputs, onDone]() {
+        File libraryFile;
+        auto result = build(converted, searchPaths, libraryFile);
+
+        MessageManager::callAsync([_this, subpatch, libraryFile, result, numInputs, numOutputs, onDone]() mutable {
+            if (!_this)
+                return;
+
+            auto library = std::make_unique<DynamicLibrary>();
+
+            if (result.wasOk() && !library->open(libraryFile.getFullPathName())) {
+                result = Result::fail("Can't load " + libraryFile.getFullPathName());
+            }
+
+            auto fnNew = reinterpret_cast<t_libpd_compiled_new>(library->getFunction("hv_" + heavyName + "_new"));
+            auto fnProcess = reinterpret_cast<t_libpd_compiled_process>(library->getFunction("hv_processInline"));
+            auto fnFree = reinterpret_cast<t_libpd_compiled_free>(library->getFunction("hv_delete"));
+
+            if (result.wasOk() && !(fnNew && fnProcess && fnFree)) {
+                result = Result::fail("The compiled library doesn't contain a Heavy context");
+            }
+
+            if (result.failed()) {
+                // Code from an earlier compilation keeps running, otherwise the reservation isn't needed anymore
+                if (!_this->isCompiled(subpatch)) {
+                    _this->instance->enqueueFunction([subpatch]() {
+                        libpd_compiled_detach(static_cast<t_canvas*>(subpatch));
+                    });
+                }
+
+                onDone(result);
+                return;
+            }
+
+            // The previous library can only be closed once its code is swapped out
+            auto* previous = _this->libraries[subpatch].release();
+            _this->libraries[subpatch] = std::move(library);
+
+            _this->instance->enqueueFunction([_this, subpatch, numInputs, numOutputs, fnNew, fnProcess, fnFree, previous, onDone]() {
+                auto attached = libpd_compiled_attach(static_cast<t_canvas*>(subpatch), numInputs, numOutputs, fnNew, fnProcess, fnFree);
+
+                MessageManager::callAsync([_this, subpatch, attached, previous, onDone]() {
+                    std::unique_ptr<DynamicLibrary>(previous).reset();
+
+                    if (!_this)
+                        return;
+
+                    if (!attached) {
+                        _this->libraries.erase(subpatch);
+                        onDone(Result::fail("The subpatch was deleted while compiling"));
+                        return;
+                    }
+
+                    onDone(Result::ok());
+                });
+            });
+        });
+    });
+}
+
+void SubpatchCompiler::release(void* subpatch)
+{
+    DynamicLibrary* library = nullptr;
+
+    auto it = libraries.find(subpatch);
+    if (it != libraries.end()) {
+        library = it->second.release();
+        libraries.erase(it);
+    }
+
+    instance->enqueueFunction([subpatch, library]() {
+        libpd_compiled_detach(static_cast<t_canvas*>(subpatch));
+
+        MessageManager::callAsync([library]() {
+            std::unique_ptr<DynamicLibrary>(library).reset();
+        });
+    });
+}
+
+Result SubpatchCompiler::convertForHeavy(String const& content, String& converted, int& numInputs, int& numOutputs)
+{
+    // Statements end with an unescaped semicolon at the end of a line
+    StringArray statements;
+    int start = 0;
+    for (int i = 0; i < content.length(); i++) {
+        if (content[i] == ';' && (i == 0 || content[i - 1] != '\\') && (i + 1 == content.length() || content[i + 1] == '\n')) {
+            statements.add(content.substring(start, i).trim());
+            start = i + 1;
+        }
+    }
+
+    statements.removeEmptyStrings();
+
+    if (statements.isEmpty() || !statements[0].startsWith("#N canvas"))
+        return Result::fail("Not a patch");
+
+    // hvcc expects the header of a patch file, not the one of a subpatch
+    auto header = StringArray::fromTokens(statements[0], " ", "");
+    header.removeEmptyStrings();
+    if (header.size() < 6)
+        return Result::fail("Not a patch");
+
+    header.removeRange(6, header.size() - 6);
+    header.add("12");
+    statements.set(0, header.joinIntoString(" "));
+
+    std::vector<std::pair<int, int>> inlets;
+    std::vector<std::pair<int, int>> outlets;
+
+    int depth = 0;
+    for (int i = 1; i < statements.size(); i++) {
+        auto tokens = StringArray::fromTokens(statements[i], " \n", "");
+        tokens.removeEmptyStrings();
+
+        if (tokens.size() >= 2 && tokens[0] == "#N" && tokens[1] == "canvas") {
+            depth++;
+            continue;
+        }
+        if (tokens.size() >= 2 && tokens[0] == "#X" && tokens[1] == "restore") {
+            depth--;
+            continue;
+        }
+        if (depth != 0 || tokens.size() < 5 || tokens[0] != "#X" || tokens[1] != "obj")
+            continue;
+
+        auto const& type = tokens[4];
+        if (type == "inlet~")
+            inlets.emplace_back(tokens[2].getIntValue(), i);
+        else if (type == "outlet~")
+            outlets.emplace_back(tokens[2].getIntValue(), i);
+        else if (type == "inlet" || type == "outlet")
+            return Result::fail("Subpatches with control inlets or outlets can't be compiled");
+    }
+
+    if (inlets.empty() && outlets.empty())
+        return Result::fail("The subpatch has no signal inlets or outlets");
+
+    // Pd orders iolets from left to right, those become the channels of the compiled patch
+    auto replaceIolets = [&statements](std::vector<std::pair<int, int>>& iolets, String const& replacement) {
+        std::stable_sort(iolets.begin(), iolets.end(), [](auto const& a, auto const& b) {
+            return a.first < b.first;
+        });
+
+        int channel = 1;
+        for (auto const& iolet : iolets) {
+            auto index = iolet.second;
+            auto tokens = StringArray::fromTokens(statements[index], " \n", "");
+            tokens.removeEmptyStrings();
+            statements.set(index, tokens[0] + " " + tokens[1] + " " + tokens[2] + " " + tokens[3] + " " + replacement + " " + String(channel++));
+        }
+    };
+
+    replaceIolets(inlets, "adc~");
+    replaceIolets(outlets, "dac~");
+
+    numInputs = static_cast<int>(inlets.size());
+    numOutputs = static_cast<int>(outlets.size());
+    converted = statements.joinIntoString(";\n") + ";\n";
+
+    return Result::ok();
+}
+
+int SubpatchCompiler::runProcess(StringArray const& args, String& output)
+{
+    ChildProcess process;
+    if (!process.start(args))
+        return -1;
+
+    char buffer[4096];
+    while (true) {
+        auto numRead = process.readProcessOutput(buffer, sizeof(buffer));
+        if (numRead <= 0)
+            break;
+
+        output += String(buffer, static_cast<size_t>(numRead));
+
+        if (auto* job = ThreadPoolJob::getCurrentThreadPoolJob(); job && job->shouldExit()) {
+            process.kill();
+            return -1;
+        }
+    }
+
+    process.waitForProcessToFinish(-1);
+    return static_cast<int>(process.getExitCode());
+}
+
+Result SubpatchCompiler::build(String const& heavyPatch, StringArray const& searchPaths, File& library)
+{
+    auto toolchain = getToolchain();
+    auto heavy = getHeavyExecutable();
+
+    // Compiled subpatches are kept by the hash of what went into them, so reopening a patch doesn't compile again
+    auto material = heavyPatch + searchPaths.joinIntoString(";") + String(heavy.getLastModificationTime().toMilliseconds());
+    auto directory = File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory).getChildFile("plugdata").getChildFile("Compiled").getChildFile(String::toHexString(material.hashCode64()));
+
+    library = directory.getChildFile("lib" + heavyName + libraryExtension);
+    if (library.existsAsFile())
+        return Result::ok();
+
+    directory.deleteRecursively();
+    if (!directory.createDirectory())
+        return Result::fail("Can't create " + directory.getFullPathName());
+
+    auto patchFile = directory.getChildFile("patch.pd");
+    patchFile.replaceWithText(heavyPatch, false, false, "\n");
+
+    StringArray heavyArgs = { heavy.getFullPathName(), patchFile.getFullPathName(), "-o" + directory.getFullPathName(), "-n" + heavyName };
+    for (auto const& path : searchPaths)
+        heavyArgs.add("-p" + path);
+
+    String output;
+    if (runProcess(heavyArgs, output) != 0) {
+        directory.deleteRecursively();
+        return Result::fail("hvcc failed:\n" + output);
+    }
+
+    auto const flags = String(" -O3 -fPIC -DNDEBUG -Ic ");
+
+#if JUCE_WINDOWS
+    auto bin = toolchain.getChildFile("bin").getFullPathName().replaceCharacter('\\', '/');
+    auto setup = "export PATH=\"$PATH:" + bin + "\"\n";
+    auto cc = bin + "/gcc.exe";
+    auto cxx = bin + "/g++.exe";
+#elif JUCE_MAC
+    auto setup = String();
+    auto cc = String("cc");
+    auto cxx = String("c++");
+#else
+    auto setup = "source " + toolchain.getChildFile("scripts").getChildFile("anywhere-setup.sh").getFullPathName() + "\n";
+    auto cc = String("${CC:-cc}");
+    auto cxx = String("${CXX:-c++}");
+#endif
+
+    auto script = String("#!/bin/bash\n")
+        + "cd \"$(dirname \"$0\")\"\n"
+        + setup
+        + "mkdir -p obj\n"
+        + "for f in c/*.c; do " + cc + flags + "-c \"$f\" -o \"obj/$(basename \"$f\").o\" || exit 1; done\n"
+        + "for f in c/*.cpp; do " + cxx + flags + "-std=c++11 -c \"$f\" -o \"obj/$(basename \"$f\").o\" || exit 1; done\n"
+        + cxx + " -shared -o " + library.getFileName() + " obj/*.o\n";
+
+    auto buildScript = directory.getChildFile("build.sh");
+    buildScript.replaceWithText(script, false, false, "\n");
+    buildScript.setExecutePermission(true);
+
+#if JUCE_WINDOWS
+    StringArray buildArgs = { toolchain.getChildFile("bin").getChildFile("sh.exe").getFullPathName(), "--login", buildScript.getFullPathName().replaceCharacter('\\', '/') };
+#else
+    StringArray buildArgs = { "/bin/bash", buildScript.getFullPathName() };
+#endif
+
+    if (runProcess(buildArgs, output) != 0 || !library.existsAsFile()) {
+        directory.deleteRecursively();
+        return Result::fail("Compilation failed:\n" + output);
+    }
+
+    return Result::ok();
+}
+
+} // namespace pd
@@ -0,0 +1,56 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <map>
+
+namespace pd {
+
+class Instance;
+
+// Experimental: runs Heavy compatible subpatches as native code inside the session
+// A subpatch is converted to a Heavy patch, compiled with the installed toolchain and loaded as a shared library
+// The compiled code takes over the subpatch's signal processing in between two ticks, until it gets released
+class SubpatchCompiler {
+public:
+    explicit SubpatchCompiler(Instance* instance);
+    ~SubpatchCompiler();
+
+    // Compiles a subpatch in the background, onDone is called on the message thread once it runs compiled. Message thread only
+    void compile(void* subpatch, std::function<void(Result)> onDone);
+
+    // Goes back to the subpatch's own objects. Message thread only
+    void release(void* subpatch);
+
+    bool isCompiled(void* subpatch) const;
+
+    static bool isToolchainInstalled();
+
+    // Turns the content of a subpatch into a patch hvcc accepts, signal inlets and outlets become adc~ and dac~ channels
+    // Control inlets and outlets can't be reached from the compiled code, subpatches that have them are refused
+    static Result convertForHeavy(String const& content, String& converted, int& numInputs, int& numOutputs);
+
+private:
+    // Returns the compiled library, from the cache when the same patch was compiled before
+    static Result build(String const& heavyPatch, StringArray const& searchPaths, File& library);
+
+    static int runProcess(StringArray const& args, String& output);
+
+    Instance* instance;
+    ThreadPool pool = ThreadPool(1);
+
+    // Loaded libraries by subpatch, kept until the compiled code that came from them isn't used anymore
+    std::map<void*, std::unique_ptr<DynamicLibrary>> libraries;
+
+    static inline const String heavyName = "plugdata_compiled";
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(SubpatchCompiler)
+};
+
+} // namespace pd
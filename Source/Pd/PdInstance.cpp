@@ -5,96 +5,127 @@
  */
 
 #include <algorithm>
+#include <string_view>
+#include <thread>
 
 extern "C" {
+#include <g_canvas.h>
 #include <g_undo.h>
 #include <m_imp.h>
 
 #include "x_libpd_extra_utils.h"
 #include "x_libpd_mod_utils.h"
 #include "x_libpd_multi.h"
+#include "x_libpd_param.h"
 #include "z_print_util.h"
 }
 
 #include "PdInstance.h"
 #include "PdPatch.h"
+#include "../Utility/RealtimeChecker.h"
+#include "../Utility/Tracer.h"
 
 extern "C" {
 struct pd::Instance::internal {
 
     static void instance_multi_bang(pd::Instance* ptr, char const* recv)
     {
-        ptr->enqueueFunctionAsync([ptr, recv]() { ptr->processMessage({ String("bang"), String(recv) }); });
+        MessageRecord record;
+        record.type = MessageRecord::Receive;
+        record.destination = gensym(recv);
+        record.selector = &s_bang;
+        ptr->enqueueRecord(ptr->m_notification_queue, record, 0, nullptr);
     }
 
     static void instance_multi_float(pd::Instance* ptr, char const* recv, float f)
     {
-        ptr->enqueueFunctionAsync([ptr, recv, f]() mutable { ptr->processMessage({ String("float"), String(recv), std::vector<Atom>(1, { f }) }); });
+        MessageRecord record;
+        record.type = MessageRecord::Receive;
+        record.destination = gensym(recv);
+        record.selector = &s_float;
+
+        t_atom atom;
+        SETFLOAT(&atom, f);
+        ptr->enqueueRecord(ptr->m_notification_queue, record, 1, &atom);
     }
 
     static void instance_multi_symbol(pd::Instance* ptr, char const* recv, char const* sym)
     {
-        ptr->enqueueFunctionAsync([ptr, recv, sym]() mutable { ptr->processMessage({ String("symbol"), String(recv), std::vector<Atom>(1, String(sym)) }); });
+        MessageRecord record;
+        record.type = MessageRecord::Receive;
+        record.destination = gensym(recv);
+        record.selector = &s_symbol;
+
+        t_atom atom;
+        SETSYMBOL(&atom, gensym(sym));
+        ptr->enqueueRecord(ptr->m_notification_queue, record, 1, &atom);
     }
 
     static void instance_multi_list(pd::Instance* ptr, char const* recv, int argc, t_atom* argv)
     {
-        Message mess { String("list"), String(recv), std::vector<Atom>(argc) };
-        for (int i = 0; i < argc; ++i) {
-            if (argv[i].a_type == A_FLOAT)
-                mess.list[i] = Atom(atom_getfloat(argv + i));
-            else if (argv[i].a_type == A_SYMBOL)
-                mess.list[i] = Atom(String(atom_getsymbol(argv + i)->s_name));
-        }
-
-        ptr->enqueueFunctionAsync([ptr, mess]() mutable { ptr->processMessage(mess); });
+        MessageRecord record;
+        record.type = MessageRecord::Receive;
+        record.destination = gensym(recv);
+        record.selector = &s_list;
+        ptr->enqueueRecord(ptr->m_notification_queue, record, argc, argv);
     }
 
     static void instance_multi_message(pd::Instance* ptr, char const* recv, char const* msg, int argc, t_atom* argv)
     {
-        Message mess { msg, String(recv), std::vector<Atom>(argc) };
-        for (int i = 0; i < argc; ++i) {
-            if (argv[i].a_type == A_FLOAT)
-                mess.list[i] = Atom(atom_getfloat(argv + i));
-            else if (argv[i].a_type == A_SYMBOL)
-                mess.list[i] = Atom(String(atom_getsymbol(argv + i)->s_name));
-        }
-        ptr->enqueueFunctionAsync([ptr, mess]() mutable { ptr->processMessage(std::move(mess)); });
+        MessageRecord record;
+        record.type = MessageRecord::Receive;
+        record.destination = gensym(recv);
+        record.selector = gensym(msg);
+        ptr->enqueueRecord(ptr->m_notification_queue, record, argc, argv);
+    }
+
+    static void instance_multi_midievent(pd::Instance* ptr, midievent event)
+    {
+        MessageRecord record;
+        record.type = MessageRecord::Midi;
+        record.midi = event;
+
+        // Messages sent in between two blocks are performed at the start of the next one, as startBlock was called before sending them
+        // Anything later than the block, like a message sent after it was performed, is pinned to its end
+        auto const elapsed = clock_gettimesincewithunits(ptr->m_block_start_time, 1, 1);
+        record.midi.position = std::clamp(static_cast<int>(elapsed), 0, ptr->getBlockSize() - 1);
+
+        ptr->enqueueRecord(ptr->m_notification_queue, record, 0, nullptr);
     }
 
     static void instance_multi_noteon(pd::Instance* ptr, int channel, int pitch, int velocity)
     {
-        ptr->enqueueFunctionAsync([ptr, channel, pitch, velocity]() mutable { ptr->processMidiEvent({ midievent::NOTEON, channel, pitch, velocity }); });
+        instance_multi_midievent(ptr, { midievent::NOTEON, channel, pitch, velocity });
     }
 
     static void instance_multi_controlchange(pd::Instance* ptr, int channel, int controller, int value)
     {
-        ptr->enqueueFunctionAsync([ptr, channel, controller, value]() mutable { ptr->processMidiEvent({ midievent::CONTROLCHANGE, channel, controller, value }); });
+        instance_multi_midievent(ptr, { midievent::CONTROLCHANGE, channel, controller, value });
     }
 
     static void instance_multi_programchange(pd::Instance* ptr, int channel, int value)
     {
-        ptr->enqueueFunctionAsync([ptr, channel, value]() mutable { ptr->processMidiEvent({ midievent::PROGRAMCHANGE, channel, value, 0 }); });
+        instance_multi_midievent(ptr, { midievent::PROGRAMCHANGE, channel, value, 0 });
     }
 
     static void instance_multi_pitchbend(pd::Instance* ptr, int channel, int value)
     {
-        ptr->enqueueFunctionAsync([ptr, channel, value]() mutable { ptr->processMidiEvent({ midievent::PITCHBEND, channel, value, 0 }); });
+        instance_multi_midievent(ptr, { midievent::PITCHBEND, channel, value, 0 });
     }
 
     static void instance_multi_aftertouch(pd::Instance* ptr, int channel, int value)
     {
-        ptr->enqueueFunctionAsync([ptr, channel, value]() mutable { ptr->processMidiEvent({ midievent::AFTERTOUCH, channel, value, 0 }); });
+        instance_multi_midievent(ptr, { midievent::AFTERTOUCH, channel, value, 0 });
     }
 
     static void instance_multi_polyaftertouch(pd::Instance* ptr, int channel, int pitch, int value)
     {
-        ptr->enqueueFunctionAsync([ptr, channel, pitch, value]() mutable { ptr->processMidiEvent({ midievent::POLYAFTERTOUCH, channel, pitch, value }); });
+        instance_multi_midievent(ptr, { midievent::POLYAFTERTOUCH, channel, pitch, value });
     }
 
     static void instance_multi_midibyte(pd::Instance* ptr, int port, int byte)
     {
-        ptr->enqueueFunctionAsync([ptr, port, byte]() mutable { ptr->processMidiEvent({ midievent::MIDIBYTE, port, byte, 0 }); });
+        instance_multi_midievent(ptr, { midievent::MIDIBYTE, port, byte, 0 });
     }
 
     static void instance_multi_print(pd::Instance* ptr, char const* s)
@@ -108,21 +139,127 @@ bool wantsNativeDialog();
 
 namespace pd {
 
+// Creating a pd instance copies the methods of every registered class, which takes a while with all libraries loaded
+// We keep a spare instance around, so inserting a new plugin doesn't have to wait for that
+// Creating one holds pd's global lock, which every processing instance needs too, so spares are only built while none are processing
+struct InstancePool {
+    ~InstancePool()
+    {
+        // The spares are freed along with the last instance, pd may already be gone by now
+        if (refillThread.joinable())
+            refillThread.join();
+    }
+
+    t_pdinstance* acquire()
+    {
+        {
+            ScopedLock lock(poolLock);
+            numInstances++;
+            if (!spareInstances.empty()) {
+                auto* instance = spareInstances.back();
+                spareInstances.pop_back();
+                return instance;
+            }
+        }
+
+        return libpd_new_instance();
+    }
+
+    // Called once the instance from acquire was freed, the last one takes the spares along
+    void release(bool wasProcessing)
+    {
+        std::thread refilling;
+        {
+            ScopedLock lock(poolLock);
+            if (wasProcessing)
+                numProcessing--;
+            if (--numInstances > 0)
+                return;
+
+            refilling = std::move(refillThread);
+        }
+
+        if (refilling.joinable())
+            refilling.join();
+
+        ScopedLock lock(poolLock);
+        for (auto* instance : spareInstances) {
+            libpd_free_instance(instance);
+        }
+        spareInstances.clear();
+    }
+
+    void startProcessing()
+    {
+        ScopedLock lock(poolLock);
+        numProcessing++;
+    }
+
+    void stopProcessing()
+    {
+        {
+            ScopedLock lock(poolLock);
+            if (--numProcessing > 0)
+                return;
+        }
+
+        refill();
+    }
+
+    // Only called after the libraries are set up, so the spare instance gets all classes
+    void refill()
+    {
+        std::thread finished;
+        {
+            ScopedLock lock(poolLock);
+            if (isRefilling || numProcessing > 0 || numInstances == 0 || !spareInstances.empty())
+                return;
+
+            isRefilling = true;
+            finished = std::move(refillThread);
+            refillThread = std::thread([this]() {
+                auto* instance = libpd_new_instance();
+
+                ScopedLock lock(poolLock);
+                spareInstances.push_back(instance);
+                isRefilling = false;
+            });
+        }
+
+        if (finished.joinable())
+            finished.join();
+    }
+
+    CriticalSection poolLock;
+    std::vector<t_pdinstance*> spareInstances;
+    std::thread refillThread;
+    bool isRefilling = false;
+    int numInstances = 0;
+    int numProcessing = 0;
+};
+
+static InstancePool instancePool;
+
 Instance::Instance(String const& symbol)
     : consoleHandler(this)
 {
     libpd_multi_init();
 
-    m_instance = libpd_new_instance();
+    m_instance = instancePool.acquire();
 
     libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
 
+#if PLUGDATA_LAZY_LIBRARIES
+    libpd_init_libraries_lazy();
+#else
     libpd_init_else();
     libpd_init_cyclone();
+#endif
 
     m_midi_receiver = libpd_multi_midi_new(this, reinterpret_cast<t_libpd_multi_noteonhook>(internal::instance_multi_noteon), reinterpret_cast<t_libpd_multi_controlchangehook>(internal::instance_multi_controlchange), reinterpret_cast<t_libpd_multi_programchangehook>(internal::instance_multi_programchange),
         reinterpret_cast<t_libpd_multi_pitchbendhook>(internal::instance_multi_pitchbend), reinterpret_cast<t_libpd_multi_aftertouchhook>(internal::instance_multi_aftertouch), reinterpret_cast<t_libpd_multi_polyaftertouchhook>(internal::instance_multi_polyaftertouch),
         reinterpret_cast<t_libpd_multi_midibytehook>(internal::instance_multi_midibyte));
+    m_midi_scheduler = libpd_multi_midi_scheduler_new();
     m_print_receiver = libpd_multi_print_new(this, reinterpret_cast<t_libpd_multi_printhook>(internal::instance_multi_print));
 
     m_message_receiver = libpd_multi_receiver_new(this, "pd", reinterpret_cast<t_libpd_multi_banghook>(internal::instance_multi_bang), reinterpret_cast<t_libpd_multi_floathook>(internal::instance_multi_float), reinterpret_cast<t_libpd_multi_symbolhook>(internal::instance_multi_symbol),
@@ -134,18 +271,87 @@ Instance::Instance(String const& symbol)
     m_parameter_change_receiver = libpd_multi_receiver_new(this, "param_change", reinterpret_cast<t_libpd_multi_banghook>(internal::instance_multi_bang), reinterpret_cast<t_libpd_multi_floathook>(internal::instance_multi_float), reinterpret_cast<t_libpd_multi_symbolhook>(internal::instance_multi_symbol),
         reinterpret_cast<t_libpd_multi_listhook>(internal::instance_multi_list), reinterpret_cast<t_libpd_multi_messagehook>(internal::instance_multi_message));
 
-    m_atoms = malloc(sizeof(t_atom) * 512);
+    // A bang to [s pd~stats] gets answered with the message stats on [r pd~stats~out]
+    m_stats_receiver = libpd_multi_receiver_new(this, "pd~stats", reinterpret_cast<t_libpd_multi_banghook>(internal::instance_multi_bang), reinterpret_cast<t_libpd_multi_floathook>(internal::instance_multi_float), reinterpret_cast<t_libpd_multi_symbolhook>(internal::instance_multi_symbol),
+        reinterpret_cast<t_libpd_multi_listhook>(internal::instance_multi_list), reinterpret_cast<t_libpd_multi_messagehook>(internal::instance_multi_message));
+
+    // [; pd~trace dump <file>( writes the recorded trace zones, when built with tracing
+    m_trace_receiver = libpd_multi_receiver_new(this, "pd~trace", reinterpret_cast<t_libpd_multi_banghook>(internal::instance_multi_bang), reinterpret_cast<t_libpd_multi_floathook>(internal::instance_multi_float), reinterpret_cast<t_libpd_multi_symbolhook>(internal::instance_multi_symbol),
+        reinterpret_cast<t_libpd_multi_listhook>(internal::instance_multi_list), reinterpret_cast<t_libpd_multi_messagehook>(internal::instance_multi_message));
+
+    // [; pd~osc port <port>( starts listening for OSC, port 0 stops. [; pd~osc latency <ms>( sets the delay for messages without a timetag
+    m_osc_receiver = libpd_multi_receiver_new(this, "pd~osc", reinterpret_cast<t_libpd_multi_banghook>(internal::instance_multi_bang), reinterpret_cast<t_libpd_multi_floathook>(internal::instance_multi_float), reinterpret_cast<t_libpd_multi_symbolhook>(internal::instance_multi_symbol),
+        reinterpret_cast<t_libpd_multi_listhook>(internal::instance_multi_list), reinterpret_cast<t_libpd_multi_messagehook>(internal::instance_multi_message));
+    m_osc_scheduler = libpd_multi_osc_scheduler_new();
+
+    // [; pd~snapshot store <n> <name>(, recall <n>, interpolate <from> <to> <position>, morph <from> <to>, name <n> <name>, remove <n> and clear
+    m_snapshot_receiver = libpd_multi_receiver_new(this, "pd~snapshot", reinterpret_cast<t_libpd_multi_banghook>(internal::instance_multi_bang), reinterpret_cast<t_libpd_multi_floathook>(internal::instance_multi_float), reinterpret_cast<t_libpd_multi_symbolhook>(internal::instance_multi_symbol),
+        reinterpret_cast<t_libpd_multi_listhook>(internal::instance_multi_list), reinterpret_cast<t_libpd_multi_messagehook>(internal::instance_multi_message));
+
+    // [; pd~latency <samples>( declares the latency of the patch in pd samples, so the host can compensate it
+    m_latency_receiver = libpd_multi_receiver_new(this, "pd~latency", reinterpret_cast<t_libpd_multi_banghook>(internal::instance_multi_bang), reinterpret_cast<t_libpd_multi_floathook>(internal::instance_multi_float), reinterpret_cast<t_libpd_multi_symbolhook>(internal::instance_multi_symbol),
+        reinterpret_cast<t_libpd_multi_listhook>(internal::instance_multi_list), reinterpret_cast<t_libpd_multi_messagehook>(internal::instance_multi_message));
+
+    // [; pd~record start <file> <bus>( records the output to a file, or only one output bus. [; pd~record stop <file>( stops it, without a file all recordings stop
+    m_record_receiver = libpd_multi_receiver_new(this, "pd~record", reinterpret_cast<t_libpd_multi_banghook>(internal::instance_multi_bang), reinterpret_cast<t_libpd_multi_floathook>(internal::instance_multi_float), reinterpret_cast<t_libpd_multi_symbolhook>(internal::instance_multi_symbol),
+        reinterpret_cast<t_libpd_multi_listhook>(internal::instance_multi_list), reinterpret_cast<t_libpd_multi_messagehook>(internal::instance_multi_message));
+
+    m_atoms.resize(512);
+
+    m_param_symbol = gensym("param");
+    m_param_change_symbol = gensym("param_change");
+    m_dsp_symbol = gensym("dsp");
+    m_stats_symbol = gensym("pd~stats");
+    m_stats_out_symbol = gensym("pd~stats~out");
+    m_trace_symbol = gensym("pd~trace");
+    m_osc_symbol = gensym("pd~osc");
+    m_snapshot_symbol = gensym("pd~snapshot");
+    m_latency_symbol = gensym("pd~latency");
+    m_record_symbol = gensym("pd~record");
+    m_gui_symbol = gensym("gui");
+    m_mouse_symbol = gensym("mouse");
+
+    for (int i = 0; i < numLongListBlocks; i++) {
+        m_free_long_list_blocks.enqueue(i);
+    }
 
     // Register callback when pd's gui changes
     // Needs to be done on pd's thread
     auto gui_trigger = [](void* instance, void* target) {
         auto* pd = static_cast<t_pd*>(target);
 
+        auto* inst = static_cast<Instance*>(instance);
+
+        // The editor does a full update once it's shown again
+        if (inst->guiUpdatesPaused) return;
+
         // redraw scalar
         if (pd && !strcmp((*pd)->c_name->s_name, "scalar")) {
-            static_cast<Instance*>(instance)->receiveGuiUpdate(2);
-        } else {
-            static_cast<Instance*>(instance)->receiveGuiUpdate(1);
+            inst->receiveGuiUpdate(2);
+        }
+        // Arrays redraw when something like tabwrite~ or soundfiler wrote to them, we don't know which part changed
+        // The GUI object belongs to the graph that holds the array
+        else if (pd && !strcmp((*pd)->c_name->s_name, "array")) {
+            auto* garray = static_cast<t_garray*>(target);
+            if (!inst->m_array_changes.try_enqueue({ garray, 0, garray_npoints(garray) })) {
+                inst->m_array_change_overflows++;
+            }
+            if (inst->m_dirty_objects.try_enqueue(garray_getglist(garray))) {
+                inst->receiveGuiUpdate(4);
+            }
+            else {
+                inst->m_dropped_object_updates++;
+                inst->receiveGuiUpdate(1);
+            }
+        }
+        // We know which object changed, so only that object needs to be updated
+        else if (pd && inst->m_dirty_objects.try_enqueue(target)) {
+            inst->receiveGuiUpdate(4);
+        }
+        // Unknown source, or too many changes to keep track of: update everything
+        else {
+            if (pd) inst->m_dropped_object_updates++;
+            inst->receiveGuiUpdate(1);
         }
     };
 
@@ -184,6 +390,31 @@ Instance::Instance(String const& symbol)
 
     register_gui_triggers(static_cast<t_pdinstance*>(m_instance), this, gui_trigger, panel_trigger, synchronise_trigger, parameter_trigger, message_trigger);
 
+    auto change_trigger = [](void* instance, void* cnv, int type, void* obj, void* src, int nout, void* sink, int nin) {
+        auto* inst = static_cast<Instance*>(instance);
+        inst->m_patch_changes.enqueue({ cnv, type, obj, src, nout, sink, nin });
+        inst->m_patch_change_count++;
+        inst->snapshots.patchChanged();
+
+        inst->journal.record(cnv, type, obj, src, nout, sink, nin);
+
+        // Every edit that adds to the undo stack, and every undo or redo, reports a change
+        if (cnv && cnv == inst->m_undo_canvas.load()) {
+            inst->publishUndoState();
+        }
+    };
+
+    register_change_trigger(static_cast<t_pdinstance*>(m_instance), change_trigger);
+
+    auto array_trigger = [](void* instance, void* garray, int start, int end) {
+        auto* inst = static_cast<Instance*>(instance);
+        if (!inst->m_array_changes.try_enqueue({ garray, start, end })) {
+            inst->m_array_change_overflows++;
+        }
+    };
+
+    register_array_trigger(static_cast<t_pdinstance*>(m_instance), array_trigger);
+
     
     
     // HACK: create full path names for c-coded externals
@@ -247,34 +478,69 @@ Instance::Instance(String const& symbol)
 
     libpd_set_verbose(0);
     setThis();
+
+    instancePool.refill();
 }
 
 Instance::~Instance()
 {
+    // Stops the network thread
+    oscReceiver.setPort(0);
+
+    // Quitting normally, so there's nothing to recover
+    journal.stop();
+
     pd_free(static_cast<t_pd*>(m_message_receiver));
     pd_free(static_cast<t_pd*>(m_midi_receiver));
     pd_free(static_cast<t_pd*>(m_print_receiver));
     pd_free(static_cast<t_pd*>(m_parameter_receiver));
     pd_free(static_cast<t_pd*>(m_parameter_change_receiver));
+    pd_free(static_cast<t_pd*>(m_stats_receiver));
+    pd_free(static_cast<t_pd*>(m_trace_receiver));
+    pd_free(static_cast<t_pd*>(m_osc_receiver));
+    pd_free(static_cast<t_pd*>(m_snapshot_receiver));
+    pd_free(static_cast<t_pd*>(m_latency_receiver));
+    pd_free(static_cast<t_pd*>(m_record_receiver));
 
     libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
+
+    // Needs the instance to be set, to remove any pending clocks
+    pd_free(static_cast<t_pd*>(m_midi_scheduler));
+    pd_free(static_cast<t_pd*>(m_osc_scheduler));
+    libpd_patchcache_invalidate(nullptr);
+    libpd_pathcache_invalidate();
+    libpd_deferfree_flush();
+    libpd_dspupdate_flush();
+    libpd_declick_free();
+    libpd_param_free();
+
     libpd_free_instance(static_cast<t_pdinstance*>(m_instance));
+
+    instancePool.release(m_processing);
 }
 
 int Instance::getBlockSize() const
 {
-    return libpd_blocksize();
+    return libpd_blocksize() * numTicks;
 }
 
-void Instance::prepareDSP(int const nins, int const nouts, double const samplerate, int const blockSize)
+void Instance::prepareDSP(int const nins, int const nouts, double const samplerate, int const blockSize, int const pdBlockSize)
 {
+    // pd's scheduler always ticks in blocks of 64, larger block sizes are performed as multiple ticks
+    numTicks = std::max(1, pdBlockSize / libpd_blocksize());
+
     libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
     libpd_init_audio(nins, nouts, static_cast<int>(samplerate));
-    //continuityChecker.prepare(samplerate, blockSize, std::max(nins, nouts));
+    continuityChecker.prepare(samplerate, blockSize, numTicks * libpd_blocksize(), std::max(nins, nouts));
 }
 
 void Instance::startDSP()
 {
+    if (!m_processing) {
+        m_processing = true;
+        instancePool.startProcessing();
+    }
+
     t_atom av;
     libpd_set_float(&av, 1.f);
     libpd_message("pd", "dsp", 1, &av);
@@ -282,16 +548,41 @@ void Instance::startDSP()
 
 void Instance::releaseDSP()
 {
+    continuityChecker.release();
+
     t_atom av;
     libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
     libpd_set_float(&av, 0.f);
     libpd_message("pd", "dsp", 1, &av);
+
+    if (m_processing) {
+        m_processing = false;
+        instancePool.stopProcessing();
+    }
+}
+
+void Instance::startBlock()
+{
+    libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
+    m_block_start_time = clock_getlogicaltime();
+}
+
+void Instance::performDSP(t_sample const* inputs, t_sample* outputs)
+{
+    libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
+    libpd_process_ticks(inputs, outputs, numTicks);
+}
+
+void Instance::performDSP(t_sample** inputs, t_sample** outputs, int numInputs, int numOutputs, int offset)
+{
+    libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
+    libpd_process_channels(inputs, outputs, numInputs, numOutputs, offset);
 }
 
-void Instance::performDSP(float const* inputs, float* outputs)
+void Instance::copyLastOutput(t_sample* outputs)
 {
     libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
-    libpd_process_raw(inputs, outputs);
+    libpd_get_last_output(outputs);
 }
 
 void Instance::sendNoteOn(int const channel, int const pitch, int const velocity) const
@@ -348,6 +639,25 @@ void Instance::sendMidiByte(int const port, int const byte) const
     libpd_midibyte(port, byte);
 }
 
+void Instance::scheduleMidi(uint8 const* data, int const size, int const samplePosition) const
+{
+    libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
+    libpd_multi_midi_schedule(m_midi_scheduler, 0, data, size, samplePosition);
+}
+
+void Instance::sendMidiMessages(MidiBuffer const& buffer) const
+{
+    libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
+
+    RealtimeChecker::checkLock("sys_lock");
+    sys_lock();
+    for (auto const& event : buffer)
+    {
+        libpd_multi_midi_dispatch(0, event.data, event.numBytes);
+    }
+    sys_unlock();
+}
+
 void Instance::sendBang(char const* receiver) const
 {
 #if !PLUGDATA_STANDALONE
@@ -388,11 +698,16 @@ void Instance::sendSymbol(char const* receiver, char const* symbol) const
 
 void Instance::sendList(char const* receiver, std::vector<Atom> const& list) const
 {
-    auto* argv = static_cast<t_atom*>(m_atoms);
+    if (list.size() > m_atoms.size())
+        m_atoms.resize(list.size());
+
+    auto* argv = m_atoms.data();
     libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
     for (size_t i = 0; i < list.size(); ++i) {
         if (list[i].isFloat())
             libpd_set_float(argv + i, list[i].getFloat());
+        else if (auto* sym = list[i].getRawSymbol())
+            SETSYMBOL(argv + i, sym);
         else
             libpd_set_symbol(argv + i, list[i].getSymbol().toRawUTF8());
     }
@@ -402,49 +717,77 @@ void Instance::sendList(char const* receiver, std::vector<Atom> const& list) con
 void Instance::sendMessage(char const* receiver, char const* msg, std::vector<Atom> const& list) const
 {
     libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
-    
-    auto* argv = static_cast<t_atom*>(m_atoms);
+
+    if (list.size() > m_atoms.size())
+        m_atoms.resize(list.size());
+
+    auto* argv = m_atoms.data();
 
     for (size_t i = 0; i < list.size(); ++i) {
         if (list[i].isFloat())
             libpd_set_float(argv + i, list[i].getFloat());
+        else if (auto* sym = list[i].getRawSymbol())
+            SETSYMBOL(argv + i, sym);
         else
             libpd_set_symbol(argv + i, list[i].getSymbol().toRawUTF8());
     }
     auto* obj = gensym(receiver)->s_thing;
-    
-    if(!obj) return;
-    
-    pd_typedmess(gensym(receiver)->s_thing, gensym(msg), static_cast<int>(list.size()), argv);
+
+    if (!obj)
+        return;
+
+    pd_typedmess(obj, gensym(msg), static_cast<int>(list.size()), argv);
 }
 
-void Instance::processMessage(Message mess)
+void Instance::processReceive(t_symbol* dest, t_symbol* sel, int argc, t_atom* argv)
 {
-    if (mess.destination == "param") {
-        int index = mess.list[0].getFloat();
-        float value = std::clamp(mess.list[1].getFloat(), 0.0f, 1.0f);
+    if (dest == m_param_symbol) {
+        int index = atom_getfloatarg(0, argc, argv);
+        float value = std::clamp<float>(atom_getfloatarg(1, argc, argv), 0.0f, 1.0f);
         performParameterChange(0, index - 1, value);
-    } else if (mess.destination == "param_change") {
-        int index = mess.list[0].getFloat();
-        int state = mess.list[1].getFloat() != 0;
+    } else if (dest == m_param_change_symbol) {
+        int index = atom_getfloatarg(0, argc, argv);
+        int state = atom_getfloatarg(1, argc, argv) != 0;
         performParameterChange(1, index - 1, state);
-    } else if (mess.selector == "bang") {
-        receiveBang(mess.destination);
-    } else if (mess.selector == "float") {
-        receiveFloat(mess.destination, mess.list[0].getFloat());
-    } else if (mess.selector == "symbol") {
-        receiveSymbol(mess.destination, mess.list[0].getSymbol());
-    } else if (mess.selector == "list") {
-        receiveList(mess.destination, mess.list);
-    } else if (mess.selector == "dsp") {
-        receiveDSPState(mess.list[0].getFloat());
+    } else if (dest == m_stats_symbol) {
+        sendMessageStats();
+    } else if (dest == m_trace_symbol) {
+        auto* path = atom_getsymbolarg(0, argc, argv);
+        writeTrace(path == &s_ ? "" : String::fromUTF8(path->s_name));
+    } else if (dest == m_osc_symbol) {
+        setOscSettings(sel, argc, argv);
+    } else if (dest == m_snapshot_symbol) {
+        receiveSnapshotMessage(sel, argc, argv);
+    } else if (dest == m_latency_symbol) {
+        if (sel == &s_bang) {
+            receiveLatencyQuery();
+        } else if (sel == &s_float) {
+            receivePatchLatency("", atom_getfloatarg(0, argc, argv));
+        } else {
+            receivePatchLatency(String::fromUTF8(sel->s_name), atom_getfloatarg(0, argc, argv));
+        }
+    } else if (dest == m_record_symbol) {
+        auto* file = atom_getsymbolarg(0, argc, argv);
+        receiveRecordMessage(String::fromUTF8(sel->s_name), file == &s_ ? "" : String::fromUTF8(file->s_name), static_cast<int>(atom_getfloatarg(1, argc, argv)));
+    } else if (sel == m_dsp_symbol) {
+        receiveDSPState(atom_getfloatarg(0, argc, argv));
+    } else if (sel == &s_bang) {
+        receiveBang(String::fromUTF8(dest->s_name));
+    } else if (sel == &s_float) {
+        receiveFloat(String::fromUTF8(dest->s_name), atom_getfloatarg(0, argc, argv));
+    } else if (sel == &s_symbol) {
+        receiveSymbol(String::fromUTF8(dest->s_name), String::fromUTF8(atom_getsymbolarg(0, argc, argv)->s_name));
+    } else if (sel == &s_list) {
+        receiveList(String::fromUTF8(dest->s_name), Atom::fromAtoms(argc, argv));
     } else {
-        receiveMessage(mess.destination, mess.selector, mess.list);
+        receiveMessage(String::fromUTF8(dest->s_name), String::fromUTF8(sel->s_name), Atom::fromAtoms(argc, argv));
     }
 }
 
 void Instance::processMidiEvent(midievent event)
 {
+    midiEventPosition = event.position;
+
     if (event.type == midievent::NOTEON)
         receiveNoteOn(event.midi1 + 1, event.midi2, event.midi3);
     else if (event.type == midievent::CONTROLCHANGE)
@@ -461,35 +804,23 @@ void Instance::processMidiEvent(midievent event)
         receiveMidiByte(event.midi1, event.midi2);
 }
 
-void Instance::processSend(dmessage mess)
-{
-    if (mess.object && !mess.list.empty()) {
-        if (mess.selector == "list") {
-            auto* argv = static_cast<t_atom*>(m_atoms);
-            for (size_t i = 0; i < mess.list.size(); ++i) {
-                if (mess.list[i].isFloat())
-                    SETFLOAT(argv + i, mess.list[i].getFloat());
-                else if (mess.list[i].isSymbol()) {
-                    sys_lock();
-                    SETSYMBOL(argv + i, gensym(mess.list[i].getSymbol().toRawUTF8()));
-                    sys_unlock();
-                } else
-                    SETFLOAT(argv + i, 0.0);
-            }
-            sys_lock();
-            pd_list(static_cast<t_pd*>(mess.object), gensym("list"), static_cast<int>(mess.list.size()), argv);
-            sys_unlock();
-        } else if (mess.selector == "float" && mess.list[0].isFloat()) {
-            sys_lock();
-            pd_float(static_cast<t_pd*>(mess.object), mess.list[0].getFloat());
-            sys_unlock();
-        } else if (mess.selector == "symbol") {
-            sys_lock();
-            pd_symbol(static_cast<t_pd*>(mess.object), gensym(mess.list[0].getSymbol().toRawUTF8()));
-            sys_unlock();
+void Instance::processSend(MessageRecord const& record, t_atom* argv)
+{
+    if (record.type == MessageRecord::Direct) {
+        if (!record.object || !record.argc)
+            return;
+
+        auto* object = static_cast<t_pd*>(record.object);
+
+        if (record.selector == &s_list) {
+            pd_list(object, &s_list, record.argc, argv);
+        } else if (record.selector == &s_float && argv[0].a_type == A_FLOAT) {
+            pd_float(object, atom_getfloat(argv));
+        } else if (record.selector == &s_symbol) {
+            pd_symbol(object, atom_getsymbol(argv));
         }
-    } else {
-        sendMessage(mess.destination.toRawUTF8(), mess.selector.toRawUTF8(), mess.list);
+    } else if (auto* target = record.destination->s_thing) {
+        pd_typedmess(target, record.selector, record.argc, argv);
     }
 }
 
@@ -508,11 +839,80 @@ void Instance::unregisterMessageListener(void* object, MessageListener* messageL
     if(it != messageListeners[object].end())  messageListeners[object].erase(it);
 }
 
+t_symbol* Instance::internSymbol(Atom const& atom)
+{
+    if (auto* sym = atom.getRawSymbol())
+        return sym;
+
+    return gensym(atom.getSymbol().toRawUTF8());
+}
+
+t_symbol* Instance::generateSymbol(String const& symbol)
+{
+    setThis();
+
+    sys_lock();
+    auto* sym = gensym(symbol.toRawUTF8());
+    sys_unlock();
+
+    return sym;
+}
+
+void Instance::enqueueRecord(moodycamel::ConcurrentQueue<MessageRecord>& queue, MessageRecord& record, int argc, t_atom const* argv)
+{
+    record.argc = argc;
+
+    if (argc <= MessageRecord::maxInlineAtoms) {
+        std::copy(argv, argv + argc, record.atoms);
+    } else if (argc <= longListBlockSize && m_free_long_list_blocks.try_dequeue(record.longListBlock)) {
+        std::copy(argv, argv + argc, m_long_list_atoms.data() + record.longListBlock * longListBlockSize);
+    } else {
+        // The long list pool is exhausted, so we have no choice but to allocate
+        auto list = std::vector<t_atom>(argv, argv + argc);
+        record.callback = [this, record, list]() mutable {
+            if (record.type == MessageRecord::Receive) {
+                processReceive(record.destination, record.selector, record.argc, list.data());
+            } else {
+                sys_lock();
+                processSend(record, list.data());
+                sys_unlock();
+            }
+        };
+        record.type = MessageRecord::Function;
+    }
+
+    m_lane_counters[getLane(queue)].enqueued.fetch_add(1, std::memory_order_relaxed);
+    queue.enqueue(std::move(record));
+}
+
+void Instance::dispatchRecord(MessageRecord& record)
+{
+    auto* argv = record.longListBlock >= 0 ? m_long_list_atoms.data() + record.longListBlock * longListBlockSize : record.atoms;
+
+    switch (record.type) {
+    case MessageRecord::Receive:
+        processReceive(record.destination, record.selector, record.argc, argv);
+        break;
+    case MessageRecord::Send:
+    case MessageRecord::Direct:
+        processSend(record, argv);
+        break;
+    case MessageRecord::Midi:
+        processMidiEvent(record.midi);
+        break;
+    case MessageRecord::Function:
+        record.callback();
+        break;
+    }
+
+    if (record.longListBlock >= 0) {
+        m_free_long_list_blocks.enqueue(record.longListBlock);
+    }
+}
+
 void Instance::enqueueFunction(std::function<void(void)> const& fn)
 {
-    // This should be the way to do it, but it currently causes some issues
-    // By calling fn directly we fix these issues at the cost of possible thread unsafety
-    m_function_queue.enqueue(fn);
+    enqueueFunctionAsync(fn);
 
     // Checks if it can be performed immediately
     messageEnqueued();
@@ -520,35 +920,195 @@ void Instance::enqueueFunction(std::function<void(void)> const& fn)
 
 void Instance::enqueueFunctionAsync(std::function<void(void)> const& fn)
 {
-    // This should be the way to do it, but it currently causes some issues
-    // By calling fn directly we fix these issues at the cost of possible thread unsafety
-    m_function_queue.enqueue(fn);
+    MessageRecord record;
+    record.callback = fn;
+    m_lane_counters[MessageStats::Command].enqueued.fetch_add(1, std::memory_order_relaxed);
+    m_command_queue.enqueue(std::move(record));
+}
+
+void Instance::enqueueBulkFunction(std::function<void(void)> const& fn)
+{
+    MessageRecord record;
+    record.callback = fn;
+    m_lane_counters[MessageStats::Bulk].enqueued.fetch_add(1, std::memory_order_relaxed);
+    m_bulk_queue.enqueue(std::move(record));
 }
 
 void Instance::enqueueMessages(String const& dest, String const& msg, std::vector<Atom>&& list)
 {
-    enqueueFunction([this, dest, msg, list]() mutable { processSend(dmessage { nullptr, dest, msg, std::move(list) }); });
+    MessageRecord record;
+    record.type = MessageRecord::Send;
+
+    std::vector<t_atom> atoms(list.size());
+
+    // Intern all symbols under a single lock
+    setThis();
+    sys_lock();
+    record.destination = gensym(dest.toRawUTF8());
+    record.selector = gensym(msg.toRawUTF8());
+    for (size_t i = 0; i < list.size(); i++) {
+        list[i].isFloat() ? SETFLOAT(atoms.data() + i, list[i].getFloat()) : SETSYMBOL(atoms.data() + i, internSymbol(list[i]));
+    }
+    sys_unlock();
+
+    enqueueRecord(m_command_queue, record, static_cast<int>(atoms.size()), atoms.data());
+    messageEnqueued();
+}
+
+void Instance::enqueueMessage(t_symbol* dest, t_symbol* sel, int argc, t_atom const* argv)
+{
+    MessageRecord record;
+    record.type = MessageRecord::Send;
+    record.destination = dest;
+    record.selector = sel;
+
+    enqueueRecord(m_command_queue, record, argc, argv);
+    messageEnqueued();
+}
+
+void Instance::enqueueGuiMouse(bool down)
+{
+    t_atom atom;
+    SETFLOAT(&atom, down ? 1.0f : 0.0f);
+    enqueueMessage(m_gui_symbol, m_mouse_symbol, 1, &atom);
 }
 
 void Instance::enqueueDirectMessages(void* object, std::vector<Atom> const& list)
 {
-    enqueueFunction([this, object, list]() mutable { processSend(dmessage { object, String(), "list", list }); });
+    MessageRecord record;
+    record.type = MessageRecord::Direct;
+    record.object = object;
+    record.selector = &s_list;
+
+    std::vector<t_atom> atoms(list.size());
+
+    setThis();
+    sys_lock();
+    for (size_t i = 0; i < list.size(); i++) {
+        if (list[i].isFloat())
+            SETFLOAT(atoms.data() + i, list[i].getFloat());
+        else if (list[i].isSymbol())
+            SETSYMBOL(atoms.data() + i, internSymbol(list[i]));
+        else
+            SETFLOAT(atoms.data() + i, 0.0f);
+    }
+    sys_unlock();
+
+    enqueueRecord(m_command_queue, record, static_cast<int>(atoms.size()), atoms.data());
+    messageEnqueued();
 }
 
 void Instance::enqueueDirectMessages(void* object, String const& msg)
 {
-    enqueueFunction([this, object, msg]() mutable { processSend(dmessage { object, String(), "symbol", std::vector<Atom>(1, msg) }); });
+    MessageRecord record;
+    record.type = MessageRecord::Direct;
+    record.object = object;
+    record.selector = &s_symbol;
+
+    t_atom atom;
+    SETSYMBOL(&atom, generateSymbol(msg));
+    enqueueRecord(m_command_queue, record, 1, &atom);
+    messageEnqueued();
 }
 
 void Instance::enqueueDirectMessages(void* object, float const msg)
 {
-    enqueueFunction([this, object, msg]() mutable { processSend(dmessage { object, String(), "float", std::vector<Atom>(1, msg) }); });
+    MessageRecord record;
+    record.type = MessageRecord::Direct;
+    record.object = object;
+    record.selector = &s_float;
+
+    t_atom atom;
+    SETFLOAT(&atom, msg);
+    enqueueRecord(m_command_queue, record, 1, &atom);
+    messageEnqueued();
+}
+
+bool Instance::hasPendingMessages() const
+{
+    return m_command_queue.size_approx() > 0 || m_notification_queue.size_approx() > 0 || m_bulk_queue.size_approx() > 0;
+}
+
+void Instance::setUndoCanvas(void* cnv)
+{
+    ScopedLock lock(*getCallbackLock());
+    setThis();
+
+    m_undo_canvas = cnv;
+    publishUndoState();
+}
+
+void Instance::publishUndoState()
+{
+    auto* cnv = static_cast<t_canvas*>(m_undo_canvas.load());
+
+    bool const undo = cnv && libpd_can_undo(cnv);
+    bool const redo = cnv && libpd_can_redo(cnv);
+
+    bool const undoChanged = canUndo.exchange(undo) != undo;
+    bool const redoChanged = canRedo.exchange(redo) != redo;
+
+    if (undoChanged || redoChanged) {
+        undoStateChanged();
+    }
+}
+
+bool Instance::getNextDirtyObject(void*& object)
+{
+    return m_dirty_objects.try_dequeue(object);
+}
+
+Range<int> Instance::takeArrayChanges(void* garray)
+{
+    ArrayChange change;
+    while (m_array_changes.try_dequeue(change)) {
+        auto range = Range<int>(change.start, change.end);
+        auto [it, inserted] = m_pending_array_changes.try_emplace(change.array, range);
+        if (!inserted) {
+            it->second = it->second.getUnionWith(range);
+        }
+    }
+
+    auto it = m_pending_array_changes.find(garray);
+    if (it == m_pending_array_changes.end())
+        return {};
+
+    auto range = it->second;
+    m_pending_array_changes.erase(it);
+
+    return range;
+}
+
+std::vector<Instance::PatchChange> Instance::takePatchChanges(void* cnv)
+{
+    PatchChange change;
+    while (m_patch_changes.try_dequeue(change)) {
+        auto& changes = m_pending_patch_changes[change.canvas];
+
+        if (changes.size() >= maxPatchChanges) {
+            changes.clear();
+            change = { change.canvas, pd_canvas_changed };
+        }
+
+        if (changes.empty() || changes.back().type != pd_canvas_changed) {
+            changes.push_back(change);
+        }
+    }
+
+    auto it = m_pending_patch_changes.find(cnv);
+    if (it == m_pending_patch_changes.end())
+        return {};
+
+    auto changes = std::move(it->second);
+    m_pending_patch_changes.erase(it);
+
+    return changes;
 }
 
 void Instance::waitForStateUpdate()
 {
     // No action needed
-    if (m_function_queue.size_approx() == 0) {
+    if (m_command_queue.size_approx() == 0 && m_notification_queue.size_approx() == 0 && m_bulk_queue.size_approx() == 0) {
         return;
     }
 
@@ -560,21 +1120,281 @@ void Instance::waitForStateUpdate()
     updateWait.wait();
 }
 
-void Instance::sendMessagesFromQueue()
+void Instance::sendMessagesFromQueue(bool limitToBudget)
 {
+    TRACE_ZONE("sendMessagesFromQueue");
+
     libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
 
-    std::function<void(void)> callback;
-    while (m_function_queue.try_dequeue(callback)) {
-        callback();
+    auto const startTicks = Time::getHighResolutionTicks();
+    auto const maxRecords = laneBudget.load();
+    auto const maxMicroseconds = timeBudgetMicroseconds.load();
+    auto const deadline = maxMicroseconds > 0 ? startTicks + Time::secondsToHighResolutionTicks(maxMicroseconds / 1000000.0) : std::numeric_limits<int64>::max();
+
+    // Each lane gets its own budget, so a burst in one lane can't starve the others or stall the audio callback
+    // Every lane may always dequeue at least one record, even if an earlier lane used up the time budget
+    // Consecutive messages to pd are delivered under a single lock, which is released before running anything that might lock pd itself
+    auto drain = [this, limitToBudget, deadline](moodycamel::ConcurrentQueue<MessageRecord>& queue, int budget) {
+        MessageRecord record;
+        bool locked = false;
+        bool remaining = false;
+        auto& counters = m_lane_counters[getLane(queue)];
+
+        // Only drains raise the peak, so a plain load and store is enough
+        auto const depth = static_cast<uint32>(queue.size_approx());
+        if (depth > counters.peakDepth.load(std::memory_order_relaxed)) {
+            counters.peakDepth.store(depth, std::memory_order_relaxed);
+        }
+
+        int i = 0;
+        for (;; i++) {
+            if (limitToBudget && (i >= budget || (i > 0 && Time::getHighResolutionTicks() > deadline))) {
+                remaining = queue.size_approx() > 0;
+                break;
+            }
+            if (!queue.try_dequeue(record)) {
+                break;
+            }
+
+            bool const needsLock = record.type == MessageRecord::Send || record.type == MessageRecord::Direct;
+            if (needsLock && !locked) {
+                RealtimeChecker::checkLock("sys_lock");
+                sys_lock();
+                locked = true;
+            } else if (!needsLock && locked) {
+                sys_unlock();
+                locked = false;
+            }
+
+            dispatchRecord(record);
+        }
+
+        if (locked) {
+            sys_unlock();
+        }
+
+        counters.dequeued.fetch_add(i, std::memory_order_relaxed);
+        if (remaining) {
+            counters.deferred.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return remaining;
+    };
+
+    bool deferred = drain(m_command_queue, maxRecords);
+    deferred = drain(m_notification_queue, maxRecords) || deferred;
+    deferred = drain(m_bulk_queue, std::max(maxRecords / 16, 1)) || deferred;
+
+    if (deferred) {
+        messageBudgetOverruns++;
+    }
+
+    auto const elapsed = static_cast<float>(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1e6);
+    m_last_drain_microseconds.store(elapsed, std::memory_order_relaxed);
+    if (elapsed > m_peak_drain_microseconds.load(std::memory_order_relaxed)) {
+        m_peak_drain_microseconds.store(elapsed, std::memory_order_relaxed);
     }
 }
 
+void Instance::setMessageBudget(int maxRecordsPerLane, int maxMicroseconds)
+{
+    laneBudget = std::max(maxRecordsPerLane, 1);
+    timeBudgetMicroseconds = std::max(maxMicroseconds, 0);
+}
+
+uint32 Instance::getMessageBudgetOverruns() const
+{
+    return messageBudgetOverruns;
+}
+
+int Instance::getLane(moodycamel::ConcurrentQueue<MessageRecord> const& queue) const
+{
+    if (&queue == &m_command_queue)
+        return MessageStats::Command;
+    if (&queue == &m_notification_queue)
+        return MessageStats::Notification;
+    return MessageStats::Bulk;
+}
+
+Instance::MessageStats Instance::getMessageStats() const
+{
+    MessageStats stats;
+    for (int lane = 0; lane < MessageStats::NumLanes; lane++) {
+        stats.enqueued[lane] = m_lane_counters[lane].enqueued.load(std::memory_order_relaxed);
+        stats.dequeued[lane] = m_lane_counters[lane].dequeued.load(std::memory_order_relaxed);
+        stats.deferred[lane] = m_lane_counters[lane].deferred.load(std::memory_order_relaxed);
+        stats.peakDepth[lane] = m_lane_counters[lane].peakDepth.load(std::memory_order_relaxed);
+    }
+
+    stats.droppedObjectUpdates = m_dropped_object_updates.load(std::memory_order_relaxed);
+    stats.droppedArrayChanges = static_cast<uint32>(m_array_change_overflows.load(std::memory_order_relaxed));
+    stats.lastDrainMicroseconds = m_last_drain_microseconds.load(std::memory_order_relaxed);
+    stats.peakDrainMicroseconds = m_peak_drain_microseconds.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void Instance::resetMessageStatPeaks()
+{
+    for (auto& counters : m_lane_counters) {
+        counters.peakDepth.store(0, std::memory_order_relaxed);
+    }
+    m_peak_drain_microseconds.store(0.0f, std::memory_order_relaxed);
+}
+
+// Runs while draining the notification lane, where pd isn't locked
+void Instance::writeTrace(String const& path)
+{
+    MessageManager::callAsync([this, path]() {
+#if PLUGDATA_TRACING
+        auto file = path.isEmpty() ? File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("plugdata").getChildFile("Trace.json") : File::getCurrentWorkingDirectory().getChildFile(path);
+
+        if (Tracer::writeTrace(file)) {
+            logMessage("Trace written to " + file.getFullPathName());
+        } else {
+            logError("Couldn't write trace to " + file.getFullPathName());
+        }
+#else
+        logError("plugdata was built without tracing, enable it with the ENABLE_TRACING cmake option");
+#endif
+    });
+}
+
+void Instance::setOscSettings(t_symbol* sel, int argc, t_atom* argv)
+{
+    auto const setting = String::fromUTF8(sel->s_name);
+    auto const value = atom_getfloatarg(0, argc, argv);
+
+    MessageManager::callAsync([this, setting, value]() {
+        if (setting == "port") {
+            auto const port = static_cast<int>(value);
+            if (!oscReceiver.setPort(port)) {
+                logError("Couldn't listen for OSC on port " + String(port));
+            }
+        } else if (setting == "latency") {
+            oscReceiver.setLatency(value);
+        } else {
+            logError("pd~osc: unknown setting " + setting);
+        }
+    });
+}
+
+void Instance::receiveSnapshotMessage(t_symbol* sel, int argc, t_atom* argv)
+{
+    auto const action = String::fromUTF8(sel->s_name);
+    auto const first = static_cast<int>(atom_getfloatarg(0, argc, argv));
+    auto const second = static_cast<int>(atom_getfloatarg(1, argc, argv));
+    auto const position = atom_getfloatarg(2, argc, argv);
+    auto const name = String::fromUTF8(atom_getsymbolarg(1, argc, argv)->s_name);
+
+    // Snapshots are numbered from 1 in the patch, like parameters
+    MessageManager::callAsync([this, action, first, second, position, name]() {
+        if (action == "store") {
+            snapshots.store(first - 1, name);
+        } else if (action == "recall" || action == "float") {
+            snapshots.recall(first - 1);
+        } else if (action == "interpolate") {
+            snapshots.interpolate(first - 1, second - 1, position);
+        } else if (action == "name") {
+            snapshots.setName(first - 1, name);
+        } else if (action == "morph") {
+            snapshots.setMorph(first - 1, second - 1);
+        } else if (action == "remove") {
+            snapshots.remove(first - 1);
+        } else if (action == "clear") {
+            snapshots.clear();
+        } else {
+            logError("pd~snapshot: unknown message " + action);
+        }
+    });
+}
+
+void Instance::dispatchOscMessages()
+{
+    if (!oscReceiver.hasPendingPackets())
+        return;
+
+    libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
+
+    RealtimeChecker::checkLock("sys_lock");
+    sys_lock();
+    oscReceiver.dispatch(m_osc_scheduler, sys_getsr());
+    sys_unlock();
+}
+
+void Instance::sendMessageStats()
+{
+    auto const stats = getMessageStats();
+    static char const* laneNames[MessageStats::NumLanes] = { "command", "notification", "bulk" };
+
+    sys_lock();
+    if (auto* target = m_stats_out_symbol->s_thing) {
+        t_atom atoms[4];
+        for (int lane = 0; lane < MessageStats::NumLanes; lane++) {
+            SETFLOAT(atoms, stats.enqueued[lane]);
+            SETFLOAT(atoms + 1, stats.dequeued[lane]);
+            SETFLOAT(atoms + 2, stats.deferred[lane]);
+            SETFLOAT(atoms + 3, stats.peakDepth[lane]);
+            pd_typedmess(target, gensym(laneNames[lane]), 4, atoms);
+        }
+
+        SETFLOAT(atoms, stats.droppedObjectUpdates);
+        SETFLOAT(atoms + 1, stats.droppedArrayChanges);
+        pd_typedmess(target, gensym("dropped"), 2, atoms);
+
+        SETFLOAT(atoms, stats.lastDrainMicroseconds);
+        SETFLOAT(atoms + 1, stats.peakDrainMicroseconds);
+        pd_typedmess(target, gensym("drain"), 2, atoms);
+    }
+    sys_unlock();
+}
+
+// Streams through the file in chunks and stops as soon as the info block has been read, so large patches are never loaded as a whole
 String Instance::getExtraInfo(File const& toOpen)
 {
-    String content = toOpen.loadFileAsString();
-    if (content.contains("_plugdatainfo_")) {
-        return content.fromFirstOccurrenceOf("_plugdatainfo_", false, false).fromFirstOccurrenceOf("[INFOSTART]", false, false).upToFirstOccurrenceOf("[INFOEND]", false, false);
+    FileInputStream stream(toOpen);
+    if (!stream.openedOk())
+        return String();
+
+    static constexpr std::string_view markers[] = { "_plugdatainfo_", "[INFOSTART]", "[INFOEND]" };
+    static constexpr size_t chunkSize = 1 << 16;
+
+    std::string buffer;
+    size_t searchFrom = 0;
+    int stage = 0;
+
+    HeapBlock<char> chunk(chunkSize);
+    while (!stream.isExhausted()) {
+        auto numRead = stream.read(chunk.get(), static_cast<int>(chunkSize));
+        if (numRead <= 0)
+            break;
+
+        buffer.append(chunk.get(), static_cast<size_t>(numRead));
+
+        while (stage < 3) {
+            auto const& marker = markers[stage];
+            auto found = buffer.find(marker, searchFrom);
+
+            if (found == std::string::npos) {
+                // Keep the tail, a marker might be split between two chunks
+                auto keep = std::min(buffer.size(), marker.size() - 1);
+                if (stage < 2) {
+                    buffer.erase(0, buffer.size() - keep);
+                    searchFrom = 0;
+                } else {
+                    searchFrom = buffer.size() - keep;
+                }
+                break;
+            }
+
+            if (stage == 2) {
+                return String::fromUTF8(buffer.data(), static_cast<int>(found));
+            }
+
+            // Everything before the start of the info can be dropped
+            buffer.erase(0, found + marker.size());
+            searchFrom = 0;
+            stage++;
+        }
     }
 
     return String();
@@ -584,8 +1404,6 @@ Patch Instance::openPatch(File const& toOpen)
 {
     t_canvas* cnv = nullptr;
 
-    bool done = false;
-
     String dirname = toOpen.getParentDirectory().getFullPathName();
     const auto* dir = dirname.toRawUTF8();
 
@@ -594,14 +1412,35 @@ Patch Instance::openPatch(File const& toOpen)
 
     setThis();
 
-    cnv = static_cast<t_canvas*>(libpd_create_canvas(file, dir));
-    done = true;
+    // Tokenise straight from a mapping of the file, so huge patches never get copied into memory as text
+    // This still goes through the patch cache, the mapping is only tokenised when the cached copy is missing or stale
+    MemoryMappedFile mappedFile(toOpen, MemoryMappedFile::readOnly);
+    if (mappedFile.getData() && mappedFile.getSize() > 0 && mappedFile.getSize() < std::numeric_limits<int>::max()) {
+        cnv = static_cast<t_canvas*>(libpd_create_canvas_from_mapping(static_cast<char const*>(mappedFile.getData()), static_cast<int>(mappedFile.getSize()), file, dir));
+    } else {
+        cnv = static_cast<t_canvas*>(libpd_create_canvas(file, dir));
+    }
 
     auto patch = Patch(cnv, this, toOpen);
 
+    abstractionWatcher.updateWatchedFolders();
+
     return patch;
 }
 
+Patch Instance::openPatch(String const& patchText, File const& location)
+{
+    String dirname = location.getParentDirectory().getFullPathName();
+    String filename = location.getFileName();
+
+    setThis();
+
+    auto const text = patchText.toStdString();
+    auto* cnv = static_cast<t_canvas*>(libpd_create_canvas_from_text(text.c_str(), static_cast<int>(text.size()), filename.toRawUTF8(), dirname.toRawUTF8()));
+
+    return Patch(cnv, this, File());
+}
+
 void Instance::setThis()
 {
     libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
@@ -623,16 +1462,37 @@ void Instance::logWarning(String const& warning)
 }
 
 
-std::deque<std::tuple<String, int, int>>& Instance::getConsoleMessages()
+Instance::ConsoleMessages& Instance::getConsoleMessages()
 {
     return consoleHandler.consoleMessages;
 }
 
-std::deque<std::tuple<String, int, int>>& Instance::getConsoleHistory()
+void Instance::flushInfoStorage()
+{
+    if (!MessageManager::getInstance()->isThisTheMessageThread())
+        return;
+
+    for (auto* storage : infoStorages)
+        storage->flushInfo();
+}
+
+Instance::ConsoleMessages& Instance::getConsoleHistory()
 {
     return consoleHandler.consoleHistory;
 }
 
+void Instance::setConsoleLogFile(File const& file)
+{
+    auto& sink = consoleHandler.logSink;
+    if (file == File() ? !sink : sink && sink->getFile() == file)
+        return;
+
+    sink.reset();
+    if (file != File()) {
+        sink = std::make_unique<ConsoleLogSink>(file);
+    }
+}
+
 void Instance::createPanel(int type, char const* snd, char const* location)
 {
 
@@ -17,8 +17,15 @@ extern "C" {
 }
 
 #include "PdPatch.h"
+#include "PdCompiler.h"
+#include "PdAbstractionWatcher.h"
+#include "PdOscReceiver.h"
+#include "PdSnapshots.h"
+#include "PdJournal.h"
 #include "concurrentqueue.h"
 #include "../Utility/FastStringWidth.h"
+#include "../Utility/RingBuffer.h"
+#include "../Utility/ConsoleLogSink.h"
 
 namespace pd {
 
@@ -41,7 +48,7 @@ public:
             if (av[i].a_type == A_FLOAT) {
                 array.emplace_back(atom_getfloat(av + i));
             } else if (av[i].a_type == A_SYMBOL) {
-                array.emplace_back(atom_getsymbol(av + i)->s_name);
+                array.emplace_back(atom_getsymbol(av + i));
             } else {
                 array.emplace_back();
             }
@@ -74,6 +81,15 @@ public:
     {
     }
 
+    // The interned symbol constructor.
+    // Only stores the pointer, the String is created when it's first requested
+    inline Atom(t_symbol* sym)
+        : type(SYMBOL)
+        , value(0)
+        , pdSymbol(sym)
+    {
+    }
+
     // Check if the atom is a float.
     inline bool isFloat() const
     {
@@ -95,14 +111,27 @@ public:
     // Get the string.
     inline String const& getSymbol() const
     {
+        if (pdSymbol && symbol.isEmpty()) {
+            symbol = String::fromUTF8(pdSymbol->s_name);
+        }
+
         return symbol;
     }
 
+    // Get the interned symbol, or nullptr if the atom was created from a String
+    inline t_symbol* getRawSymbol() const
+    {
+        return pdSymbol;
+    }
+
     // Compare two atoms.
     inline bool operator==(Atom const& other) const
     {
         if (type == SYMBOL) {
-            return other.type == SYMBOL && symbol == other.symbol;
+            if (other.type == SYMBOL && pdSymbol && pdSymbol == other.pdSymbol)
+                return true;
+
+            return other.type == SYMBOL && getSymbol() == other.getSymbol();
         } else {
             return other.type == FLOAT && value == other.value;
         }
@@ -115,131 +144,126 @@ private:
     };
     Type type = FLOAT;
     float value = 0;
-    String symbol;
+    t_symbol* pdSymbol = nullptr;
+    mutable String symbol;
 };
 
-struct ContinuityChecker : public Timer {
-
-    struct BackupTimer : public HighResolutionTimer {
-        t_pdinstance* pd;
-
-        std::atomic<bool>& hasTicked;
-
-        std::vector<t_float> emptyInBuffer;
-        std::vector<t_float> emptyOutBuffer;
-
-        std::function<void(t_float*, t_float*)> callback;
+// Keeps pd's clocks running while the host doesn't call processBlock, for example when the transport stops or a track is frozen
+// The audio callback marks every block, once no block arrived for a while, a backup timer performs the dsp ticks that are due
+// since then, with silent input and the output thrown away
+// Both run under the audio processor's callback lock, and the timer only ticks while the host is away,
+// so when the host comes back it simply continues, pd never runs twice for the same stretch of time
+struct ContinuityChecker : private HighResolutionTimer {
 
-        int numBlocksPerCallback;
-        int intervalMs;
-
-        BackupTimer(std::atomic<bool>& ticked)
-            : hasTicked(ticked)
-        {
-        }
-
-        void prepare(int samplesPerBlock, int schedulerInterval, int numChannels)
-        {
-            pd = pd_this;
+    // Performs one pd block, returns false if the host is processing again
+    using Callback = std::function<bool(t_sample*, t_sample*)>;
 
-            numBlocksPerCallback = samplesPerBlock / libpd_blocksize();
-            intervalMs = schedulerInterval;
-
-            emptyInBuffer.resize(numChannels * samplesPerBlock);
-            emptyOutBuffer.resize(numChannels * samplesPerBlock);
-        }
-
-        void startScheduler()
-        {
-            if (isTimerRunning())
-                return;
-
-                // startTimer(intervalMs);
-#if JUCE_DEBUG
-                // std::cout << "backup scheduler started" << std::endl;
-#endif
-        }
+    ~ContinuityChecker() override
+    {
+        stopTimer();
+    }
 
-        void stopScheduler()
-        {
-            if (!isTimerRunning())
-                return;
+    void setCallback(Callback cb)
+    {
+        stopTimer();
+        callback = std::move(cb);
+    }
 
-                // stopTimer();
+    // Allocates the buffers for the backup ticks, not on the audio thread
+    void prepare(double sampleRate, int hostBlockSize, int pdBlockSize, int numChannels)
+    {
+        stopTimer();
 
-#if JUCE_DEBUG
-                // std::cout << "backup scheduler stopped" << std::endl;
-#endif
-        }
+        blockDuration = 1000.0 * pdBlockSize / sampleRate;
 
-        void hiResTimerCallback() override
-        {
-            if (hasTicked) {
-                stopScheduler();
-                return;
-            }
+        // Hosts may skip a few blocks now and then, that shouldn't start the backup scheduler yet
+        timeout = std::max(50.0, 4000.0 * hostBlockSize / sampleRate);
 
-            for (int i = 0; i < numBlocksPerCallback; i++) {
-                std::fill(emptyInBuffer.begin(), emptyInBuffer.end(), 0.0f);
+        emptyInBuffer.assign(numChannels * pdBlockSize, 0.0f);
+        emptyOutBuffer.assign(numChannels * pdBlockSize, 0.0f);
 
-                callback(emptyInBuffer.data(), emptyOutBuffer.data());
+        running = false;
+        lastCallback = Time::getMillisecondCounterHiRes();
 
-                std::fill(emptyOutBuffer.begin(), emptyOutBuffer.end(), 0.0f);
-            }
-        }
-    };
-
-    ContinuityChecker()
-        : backupTimer(hasTicked) {};
+        if (callback)
+            startTimer(std::clamp(roundToInt(blockDuration), 1, 5));
+    }
 
-    void setCallback(std::function<void(t_float*, t_float*)> cb)
+    void release()
     {
-        backupTimer.callback = std::move(cb);
+        stopTimer();
+        running = false;
     }
 
-    void prepare(double sampleRate, int samplesPerBlock, int numChannels)
+    // Called by the audio callback for every block, with the callback lock held
+    void audioCallbackStarted()
     {
-        timePerBlock = std::round((samplesPerBlock / sampleRate) * 1000.0);
-
-        backupTimer.prepare(samplesPerBlock, timePerBlock, numChannels);
-
-        startTimer(timePerBlock);
+        lastCallback.store(Time::getMillisecondCounterHiRes(), std::memory_order_relaxed);
     }
 
-    void setTimer()
+    // Offline rendering doesn't happen at the speed of a clock, so there is nothing to keep running
+    void setNonRealtime(bool nonRealtime)
     {
-        lastTime = Time::getCurrentTime().getMillisecondCounterHiRes();
-        hasTicked = true;
+        isNonRealtime.store(nonRealtime, std::memory_order_relaxed);
     }
 
-    void setNonRealtime(bool nonRealtime)
+    // The callback checks this with the callback lock held, after the host has just been waiting for it
+    bool isHostRunning() const
     {
-        isNonRealtime = nonRealtime;
-        if (isNonRealtime)
-            backupTimer.stopScheduler();
+        return Time::getMillisecondCounterHiRes() - lastCallback.load(std::memory_order_relaxed) < timeout;
     }
 
-    void timerCallback() override
+private:
+    void hiResTimerCallback() override
     {
-        int timePassed = Time::getCurrentTime().getMillisecondCounterHiRes() - lastTime;
+        if (isNonRealtime.load(std::memory_order_relaxed) || isHostRunning()) {
+            running = false;
+            return;
+        }
 
-        // Scheduler
-        if (timePassed > 2 * timePerBlock && !hasTicked && !isNonRealtime) {
-            backupTimer.startScheduler();
+        auto const now = Time::getMillisecondCounterHiRes();
+
+        // The blocks are counted from the moment the host went away, so pd's time follows the clock on the wall
+        if (!running) {
+            running = true;
+            backupStart = now;
+            blocksDone = 0;
         }
 
-        hasTicked = false;
+        auto blocksDue = static_cast<int64>((now - backupStart) / blockDuration) - blocksDone;
+
+        // After the computer was suspended or the timer got starved, we skip ahead instead of catching up in one burst
+        if (blocksDue > maxBlocksPerCallback) {
+            blocksDone += blocksDue - maxBlocksPerCallback;
+            blocksDue = maxBlocksPerCallback;
+        }
+
+        for (int64 i = 0; i < blocksDue; i++) {
+            if (!callback(emptyInBuffer.data(), emptyOutBuffer.data())) {
+                running = false;
+                return;
+            }
+            blocksDone++;
+        }
     }
 
-    t_pdinstance* pd;
+    static constexpr int64 maxBlocksPerCallback = 32;
+
+    Callback callback;
+
+    std::vector<t_sample> emptyInBuffer;
+    std::vector<t_sample> emptyOutBuffer;
 
-    std::atomic<double> lastTime;
-    std::atomic<bool> hasTicked;
+    double blockDuration = 64.0 / 44.1;
+    double timeout = 50.0;
 
+    std::atomic<double> lastCallback = 0.0;
     std::atomic<bool> isNonRealtime = false;
-    int timePerBlock;
 
-    BackupTimer backupTimer;
+    // Only used on the timer thread
+    bool running = false;
+    double backupStart = 0.0;
+    int64 blocksDone = 0;
 };
 
 struct MessageListener
@@ -249,20 +273,8 @@ struct MessageListener
     JUCE_DECLARE_WEAK_REFERENCEABLE (MessageListener);
 };
 
+class Storage;
 class Instance {
-    struct Message {
-        String selector;
-        String destination;
-        std::vector<pd::Atom> list;
-    };
-
-    struct dmessage {
-        void* object;
-        String destination;
-        String selector;
-        std::vector<pd::Atom> list;
-    };
-
     typedef struct midievent {
         enum {
             NOTEON,
@@ -276,17 +288,49 @@ class Instance {
         int midi1;
         int midi2;
         int midi3;
+        int position; // Sample offset inside the DSP block that produced the event
     } midievent;
 
+    // Fixed-size message record, so messages can be passed between threads without allocating
+    struct MessageRecord {
+        enum Type {
+            Receive,  // Message from pd, sent to one of our receivers
+            Send,     // Message to a pd receiver
+            Direct,   // Message to a pd object
+            Midi,     // Midi from pd
+            Function  // Fallback for arbitrary closures
+        };
+
+        static constexpr int maxInlineAtoms = 8;
+
+        Type type = Function;
+        void* object = nullptr;
+        t_symbol* destination = nullptr;
+        t_symbol* selector = nullptr;
+        midievent midi;
+
+        int argc = 0;
+        t_atom atoms[maxInlineAtoms];
+
+        // Index of a block in the long list pool when argc exceeds maxInlineAtoms
+        int longListBlock = -1;
+
+        std::function<void(void)> callback;
+    };
+
 public:
     Instance(String const& symbol);
     Instance(Instance const& other) = delete;
     virtual ~Instance();
 
-    void prepareDSP(int const nins, int const nouts, double const samplerate, int const blockSize);
+    void prepareDSP(int const nins, int const nouts, double const samplerate, int const blockSize, int const pdBlockSize = 64);
     void startDSP();
     void releaseDSP();
-    void performDSP(float const* inputs, float* outputs);
+    // Midi coming out of pd is timestamped from here, call this before sending the messages for the next block
+    void startBlock();
+    void performDSP(t_sample const* inputs, t_sample* outputs);
+    void performDSP(t_sample** inputs, t_sample** outputs, int numInputs, int numOutputs, int offset);
+    void copyLastOutput(t_sample* outputs);
     int getBlockSize() const;
 
     void sendNoteOn(int const channel, int const pitch, int const velocity) const;
@@ -299,6 +343,12 @@ public:
     void sendSysRealTime(int const port, int const byte) const;
     void sendMidiByte(int const port, int const byte) const;
 
+    // Sends a midi message that pd will receive at a sample offset from the start of the next block
+    void scheduleMidi(uint8 const* data, int const size, int const samplePosition) const;
+
+    // Sends all events in the buffer to pd at once, decoding them from their raw bytes
+    void sendMidiMessages(MidiBuffer const& buffer) const;
+
     virtual void receiveNoteOn(int const channel, int const pitch, int const velocity)
     {
     }
@@ -322,8 +372,45 @@ public:
     }
 
     virtual void receiveGuiUpdate(int type) {};
+
+    // Set while there's no editor, or it isn't on screen
+    // Pd's GUI changes aren't queued then, the editor catches up with one full update when it's shown again
+    std::atomic<bool> guiUpdatesPaused = true;
+
+    // Dequeues a pd object that reported a GUI change, returns false when there are none left
+    bool getNextDirtyObject(void*& object);
     virtual void synchroniseCanvas(void* cnv) {};
 
+    // A structural change that was made to a canvas, reported by the libpd mod utils
+    struct PatchChange
+    {
+        void* canvas = nullptr;
+        int type = pd_canvas_changed;
+        void* object = nullptr;
+        void* source = nullptr;
+        int outlet = 0;
+        void* sink = nullptr;
+        int inlet = 0;
+    };
+
+    // Takes the changes to a canvas since the last call, in the order pd made them. Message thread only
+    std::vector<PatchChange> takePatchChanges(void* cnv);
+
+    // Takes the part of an array that was written since the last call, empty if nothing changed. Message thread only
+    Range<int> takeArrayChanges(void* garray);
+
+    // Increases whenever array changes couldn't be recorded, anyone tracking array changes should then read the whole array
+    int getArrayChangeOverflows() const
+    {
+        return m_array_change_overflows.load();
+    }
+
+    // Increases with every structural change to any patch, for caches of patch contents
+    int getPatchChangeCount() const
+    {
+        return m_patch_change_count.load();
+    }
+
     virtual void createPanel(int type, char const* snd, char const* location);
 
     void sendBang(char const* receiver) const;
@@ -355,15 +442,39 @@ public:
     
     virtual void receiveDSPState(bool dsp) {};
 
+    // Latency that a patch declared with [; pd~latency <samples>(, or [; pd~latency <source> <samples>( to declare several that add up
+    virtual void receivePatchLatency(String const& source, float samples) {};
+
+    // Bang to pd~latency, the total latency is sent to pd~latency~out
+    virtual void receiveLatencyQuery() {};
+
+    // [; pd~record start <file> <bus>( and [; pd~record stop <file>(, bus is numbered from 1 and 0 means all outputs
+    virtual void receiveRecordMessage(String const& action, String const& file, int bus) {};
+
     virtual void updateConsole() {};
 
     virtual void titleChanged() {};
 
+    // Makes cnv the canvas whose undo state is published into canUndo and canRedo
+    void setUndoCanvas(void* cnv);
+
+    // Called from pd's thread when canUndo or canRedo changed
+    virtual void undoStateChanged() {};
+
     void enqueueFunction(std::function<void(void)> const& fn);
     void enqueueFunctionAsync(std::function<void(void)> const& fn);
 
+    // Low priority lane for work that can be postponed, like polling GUI values
+    void enqueueBulkFunction(std::function<void(void)> const& fn);
+
     void enqueueMessages(String const& dest, String const& msg, std::vector<pd::Atom>&& list);
 
+    // Sends a message to an interned receiver, without allocating
+    void enqueueMessage(t_symbol* dest, t_symbol* sel, int argc, t_atom const* argv);
+
+    // Tells [r gui] whether a GUI object is being dragged
+    void enqueueGuiMouse(bool down);
+
     void enqueueDirectMessages(void* object, std::vector<pd::Atom> const& list);
     void enqueueDirectMessages(void* object, String const& msg);
     void enqueueDirectMessages(void* object, float const msg);
@@ -374,19 +485,64 @@ public:
     void logError(String const& message);
     void logWarning(String const& message);
 
-    std::deque<std::tuple<String, int, int>>& getConsoleMessages();
-    std::deque<std::tuple<String, int, int>>& getConsoleHistory();
+    // Message, type (0 = message, 1 = warning, 2 = error) and width of the text in pixels
+    using ConsoleMessages = RingBuffer<std::tuple<String, int, int>>;
+    static constexpr size_t maxConsoleMessages = 100000;
+
+    ConsoleMessages& getConsoleMessages();
+    ConsoleMessages& getConsoleHistory();
+
+    // Also writes all console messages to this file, an empty file turns it off. Message thread only
+    void setConsoleLogFile(File const& file);
 
     virtual void messageEnqueued() {};
 
-    void sendMessagesFromQueue();
-    void processMessage(Message mess);
+    // When limitToBudget is set, only a limited number of records is dequeued from each lane, for use inside the audio callback
+    void sendMessagesFromQueue(bool limitToBudget = false);
+
+    // Sets the budget used by sendMessagesFromQueue: max records per lane, and the total time it may take (0 for no time limit)
+    void setMessageBudget(int maxRecordsPerLane, int maxMicroseconds);
+
+    // Number of ticks where messages had to be deferred because the budget was used up
+    uint32 getMessageBudgetOverruns() const;
+
+    // Delivers the OSC messages that arrived since the last tick, called at the start of a tick
+    void dispatchOscMessages();
+
+    // Traffic through the message lanes, the counts keep running, the peaks are since the last resetMessageStatPeaks
+    struct MessageStats
+    {
+        enum Lane
+        {
+            Command,
+            Notification,
+            Bulk,
+            NumLanes
+        };
+
+        uint32 enqueued[NumLanes] = {};
+        uint32 dequeued[NumLanes] = {};
+        uint32 deferred[NumLanes] = {}; // drains that ran out of budget before the lane was empty
+        uint32 peakDepth[NumLanes] = {};
+        uint32 droppedObjectUpdates = 0; // changed objects that didn't fit in the queue, these fall back to a full update
+        uint32 droppedArrayChanges = 0;
+        float lastDrainMicroseconds = 0.0f;
+        float peakDrainMicroseconds = 0.0f;
+    };
+
+    MessageStats getMessageStats() const;
+    void resetMessageStatPeaks();
+    void processReceive(t_symbol* dest, t_symbol* sel, int argc, t_atom* argv);
     void processMidiEvent(midievent event);
-    void processSend(dmessage mess);
+    // Must be called while holding pd's lock
+    void processSend(MessageRecord const& record, t_atom* argv);
 
     String getExtraInfo(File const& toOpen);
     Patch openPatch(File const& toOpen);
 
+    // Opens a patch from its text, without writing it to disk first
+    Patch openPatch(String const& patchText, File const& location);
+
     virtual Colour getForegroundColour() = 0;
     virtual Colour getBackgroundColour() = 0;
     virtual Colour getTextColour() = 0;
@@ -394,24 +550,56 @@ public:
     
     virtual void synchroniseAll() = 0;
 
+    // Writes the plugdata info of all open canvases into their patches. Only does something on the message thread
+    void flushInfoStorage();
+
     void setThis();
 
     void waitForStateUpdate();
 
+    // Checks if there are any messages or functions waiting to be handled by pd
+    bool hasPendingMessages() const;
+
     virtual CriticalSection const* getCallbackLock()
     {
         return nullptr;
     };
 
+    // Runs Heavy compatible subpatches as native code, experimental
+    SubpatchCompiler subpatchCompiler { this };
+
+    // Reloads abstractions that were edited, in this or another program
+    AbstractionWatcher abstractionWatcher { this };
+
+    // Listens for OSC on the port set with [; pd~osc port <port>(
+    OscReceiver oscReceiver;
+
+    // Snapshots of all GUI values, stored and recalled with [; pd~snapshot store <n>( and [; pd~snapshot recall <n>(
+    Snapshots snapshots { this };
+
+    // Edits to the open patches since their last snapshot, so they can be restored after a crash
+    Journal journal { this };
+
     void* m_instance = nullptr;
     void* m_patch = nullptr;
-    void* m_atoms = nullptr;
+    // Scratch space for the atoms of sendList and sendMessage, which only run on pd's thread
+    // It only grows for lists longer than any before, so it doesn't allocate after a while
+    mutable std::vector<t_atom> m_atoms;
     void* m_message_receiver = nullptr;
     void* m_parameter_receiver = nullptr;
     void* m_parameter_change_receiver = nullptr;
+    void* m_stats_receiver = nullptr;
+    void* m_trace_receiver = nullptr;
+    void* m_osc_receiver = nullptr;
+    void* m_osc_scheduler = nullptr;
+    void* m_snapshot_receiver = nullptr;
+    void* m_latency_receiver = nullptr;
+    void* m_record_receiver = nullptr;
     void* m_midi_receiver = nullptr;
+    void* m_midi_scheduler = nullptr;
     void* m_print_receiver = nullptr;
 
+    // Undo state of the canvas that's shown in the editor, pd publishes it whenever that canvas changes
     std::atomic<bool> canUndo = false;
     std::atomic<bool> canRedo = false;
 
@@ -420,16 +608,122 @@ public:
 private:
     
     std::unordered_map<void*, std::vector<WeakReference<MessageListener>>> messageListeners;
+
+    // Storages of all open canvases, these register themselves
+    Array<Storage*> infoStorages;
+    friend class Storage;
     
-    moodycamel::ConcurrentQueue<std::function<void(void)>> m_function_queue = moodycamel::ConcurrentQueue<std::function<void(void)>>(4096);
+    void enqueueRecord(moodycamel::ConcurrentQueue<MessageRecord>& queue, MessageRecord& record, int argc, t_atom const* argv);
+    void dispatchRecord(MessageRecord& record);
+
+    // Answers a bang to the stats receiver with the message stats, sent to the stats output receiver
+    void sendMessageStats();
+
+    // Writes the trace of all threads on the message thread, to the given path or the default location
+    void writeTrace(String const& path);
+
+    // Handles the port and latency messages of [s pd~osc] on the message thread
+    void setOscSettings(t_symbol* sel, int argc, t_atom* argv);
+
+    // Handles the messages of [s pd~snapshot] on the message thread
+    void receiveSnapshotMessage(t_symbol* sel, int argc, t_atom* argv);
+
+    int getLane(moodycamel::ConcurrentQueue<MessageRecord> const& queue) const;
+
+    // Interns a symbol from outside of pd's thread
+    t_symbol* generateSymbol(String const& symbol);
+
+    // Returns the atom's symbol, interning it if needed. The caller needs to hold pd's lock
+    t_symbol* internSymbol(Atom const& atom);
+
+    // Editor commands, messages coming out of pd and low priority work each get their own lane
+    moodycamel::ConcurrentQueue<MessageRecord> m_command_queue = moodycamel::ConcurrentQueue<MessageRecord>(4096);
+    moodycamel::ConcurrentQueue<MessageRecord> m_notification_queue = moodycamel::ConcurrentQueue<MessageRecord>(4096);
+    moodycamel::ConcurrentQueue<MessageRecord> m_bulk_queue = moodycamel::ConcurrentQueue<MessageRecord>(1024);
+
+    // Pd objects that changed their GUI since the last editor update
+    moodycamel::ConcurrentQueue<void*> m_dirty_objects = moodycamel::ConcurrentQueue<void*>(1024);
+
+    // Structural changes from pd, sorted per canvas on the message thread
+    // Canvases that collect too many changes without being synchronised only keep a rescan marker
+    static constexpr size_t maxPatchChanges = 1024;
+    moodycamel::ConcurrentQueue<PatchChange> m_patch_changes = moodycamel::ConcurrentQueue<PatchChange>(1024);
+
+    // Only compared against the canvas of a change, it's never dereferenced after that canvas is closed
+    std::atomic<void*> m_undo_canvas = nullptr;
+    void publishUndoState();
+    std::unordered_map<void*, std::vector<PatchChange>> m_pending_patch_changes;
+
+    // Written ranges of arrays, these can come from the audio thread, so they're never allowed to allocate
+    struct ArrayChange
+    {
+        void* array = nullptr;
+        int start = 0;
+        int end = 0;
+    };
+
+    moodycamel::ConcurrentQueue<ArrayChange> m_array_changes = moodycamel::ConcurrentQueue<ArrayChange>(1024);
+    std::unordered_map<void*, Range<int>> m_pending_array_changes;
+    std::atomic<int> m_array_change_overflows = 0;
+    std::atomic<int> m_patch_change_count = 0;
+
+    // Budget for draining from the audio callback, the bulk lane gets a sixteenth of the records
+    std::atomic<int> laneBudget = 1024;
+    std::atomic<int> timeBudgetMicroseconds = 500;
+    std::atomic<uint32> messageBudgetOverruns = 0;
+
+    struct LaneCounters
+    {
+        std::atomic<uint32> enqueued = 0;
+        std::atomic<uint32> dequeued = 0;
+        std::atomic<uint32> deferred = 0;
+        std::atomic<uint32> peakDepth = 0;
+    };
+
+    LaneCounters m_lane_counters[MessageStats::NumLanes];
+    std::atomic<uint32> m_dropped_object_updates = 0;
+    std::atomic<float> m_last_drain_microseconds = 0.0f;
+    std::atomic<float> m_peak_drain_microseconds = 0.0f;
+
+    // Preallocated atoms for lists that don't fit inside a message record
+    static constexpr int longListBlockSize = 512;
+    static constexpr int numLongListBlocks = 32;
+    std::vector<t_atom> m_long_list_atoms = std::vector<t_atom>(longListBlockSize * numLongListBlocks);
+    moodycamel::ConcurrentQueue<int> m_free_long_list_blocks = moodycamel::ConcurrentQueue<int>(numLongListBlocks);
+
+    t_symbol* m_param_symbol = nullptr;
+    t_symbol* m_param_change_symbol = nullptr;
+    t_symbol* m_dsp_symbol = nullptr;
+    t_symbol* m_stats_symbol = nullptr;
+    t_symbol* m_stats_out_symbol = nullptr;
+    t_symbol* m_trace_symbol = nullptr;
+    t_symbol* m_osc_symbol = nullptr;
+    t_symbol* m_snapshot_symbol = nullptr;
+    t_symbol* m_latency_symbol = nullptr;
+    t_symbol* m_record_symbol = nullptr;
+    t_symbol* m_gui_symbol = nullptr;
+    t_symbol* m_mouse_symbol = nullptr;
 
     std::unique_ptr<FileChooser> saveChooser;
     std::unique_ptr<FileChooser> openChooser;
 
     WaitableEvent updateWait;
 
+    // Number of 64-sample pd ticks performed per DSP block
+    int numTicks = 1;
+
+    // Whether this instance counts as processing for the instance pool, between startDSP and releaseDSP
+    bool m_processing = false;
+
+    // Logical time at the start of the current DSP block, to timestamp midi coming out of pd
+    double m_block_start_time = 0.0;
+
 protected:
-    //ContinuityChecker continuityChecker;
+    // Sample offset of the midi event that is currently being received
+    int midiEventPosition = 0;
+
+    // Runs pd from a timer while the host doesn't call processBlock
+    ContinuityChecker continuityChecker;
 
     struct internal;
 
@@ -444,92 +738,143 @@ protected:
 
         void timerCallback() override
         {
-            auto item = std::pair<String, bool>();
+            // Stop first, so messages that come in while we're busy will start it again
+            stopTimer();
+            numPending = 0;
+
+            bool changed = false;
+
+            auto item = std::pair<String, int>();
             while (pendingMessages.try_dequeue(item)) {
                 auto& [message, type] = item;
-                consoleMessages.emplace_back(message, type, fastStringWidth.getStringWidth(message) + 12);
 
-                if (consoleMessages.size() > 800)
-                    consoleMessages.pop_front();
+                if (logSink)
+                    logSink->write(message, type);
+
+                // Collapse repeated lines into a counter
+                if (repeatCount > 0 && type == lastType && message == lastMessage && !consoleMessages.empty()) {
+                    repeatCount++;
+                    auto text = message + " (x" + String(repeatCount) + ")";
+                    consoleMessages.back() = { text, type, fastStringWidth.getStringWidth(text) + 12 };
+                } else {
+                    consoleMessages.push_back({ message, type, fastStringWidth.getStringWidth(message) + 12 });
+                    lastMessage = message;
+                    lastType = type;
+                    repeatCount = 1;
+                }
+
+                changed = true;
             }
 
-            // Check if any item got assigned
-            if (std::get<0>(item).isNotEmpty()) {
-                instance->updateConsole();
+            if (auto dropped = numDropped.exchange(0)) {
+                auto text = String(dropped) + " messages dropped, too many messages at once";
+                if (logSink)
+                    logSink->write(text, 1);
+
+                consoleMessages.push_back({ text, 1, fastStringWidth.getStringWidth(text) + 12 });
+                repeatCount = 0;
+                changed = true;
             }
 
-            stopTimer();
+            if (changed) {
+                instance->updateConsole();
+            }
         }
 
         void logMessage(String const& message)
         {
-            pendingMessages.enqueue({ message, false });
-            startTimer(10);
+            addMessage(message, 0);
         }
         
         void logWarning(String const& warning)
         {
-            pendingMessages.enqueue({ warning, 1 });
-            startTimer(10);
+            addMessage(warning, 1);
         }
 
         void logError(String const& error)
         {
-            pendingMessages.enqueue({ error, 2 });
-            startTimer(10);
+            addMessage(error, 2);
         }
-        
 
+        // Can be called from any thread
+        // When more messages come in than the console can show before it gets updated, the rest is only counted
+        void addMessage(String const& message, int type)
+        {
+            if (numPending >= maxPendingMessages) {
+                numDropped++;
+                return;
+            }
+
+            pendingMessages.enqueue({ message, type });
+
+            // Nobody is looking at the console while the editor is hidden, so messages are gathered in larger batches
+            if (numPending++ == 0) {
+                startTimer(instance->guiUpdatesPaused ? 500 : 10);
+            }
+        }
 
         void processPrint(char const* message)
         {
-            std::function<void(String)> forwardMessage =
-                [this](String message) {
-                    if (message.startsWith("error")) {
-                        logError(message.substring(7));
-                    } else if (message.startsWith("verbose(0):") || message.startsWith("verbose(1):")) {
-                        logError(message.substring(12));
-                    } else {
-                        logMessage(message);
-                    }
-                };
-
-            static int length = 0;
-            printConcatBuffer[length] = '\0';
-
-            int len = (int)strlen(message);
+            auto forwardMessage = [this](char const* line, int length) {
+                // Don't bother creating strings when they'd be dropped anyway
+                if (numPending >= maxPendingMessages) {
+                    numDropped++;
+                    return;
+                }
+
+                auto text = String::fromUTF8(line, length);
+                if (text.startsWith("error")) {
+                    logError(text.substring(7));
+                } else if (text.startsWith("verbose(0):") || text.startsWith("verbose(1):")) {
+                    logError(text.substring(12));
+                } else {
+                    logMessage(text);
+                }
+            };
+
+            // Pd can print from multiple threads, each one gets its own line buffer
+            thread_local char printConcatBuffer[2048];
+            thread_local int length = 0;
+
+            int len = static_cast<int>(strlen(message));
             while (length + len >= 2048) {
                 int d = 2048 - 1 - length;
-                strncat(printConcatBuffer, message, d);
+                memcpy(printConcatBuffer + length, message, d);
 
                 // Send concatenated line to plugdata!
-                forwardMessage(String::fromUTF8(printConcatBuffer));
+                forwardMessage(printConcatBuffer, 2048 - 1);
 
                 message += d;
                 len -= d;
                 length = 0;
-                printConcatBuffer[0] = '\0';
             }
 
-            strncat(printConcatBuffer, message, len);
+            memcpy(printConcatBuffer + length, message, len);
             length += len;
 
             if (length > 0 && printConcatBuffer[length - 1] == '\n') {
-                printConcatBuffer[length - 1] = '\0';
-
                 // Send concatenated line to plugdata!
-                forwardMessage(String::fromUTF8(printConcatBuffer));
+                forwardMessage(printConcatBuffer, length - 1);
 
                 length = 0;
             }
         }
 
-        std::deque<std::tuple<String, int, int>> consoleMessages;
-        std::deque<std::tuple<String, int, int>> consoleHistory;
+        ConsoleMessages consoleMessages = ConsoleMessages(maxConsoleMessages);
+        ConsoleMessages consoleHistory = ConsoleMessages(maxConsoleMessages);
+
+        moodycamel::ConcurrentQueue<std::pair<String, int>> pendingMessages;
+
+        static constexpr int maxPendingMessages = 1000;
+        std::atomic<int> numPending = 0;
+        std::atomic<int> numDropped = 0;
 
-        char printConcatBuffer[2048];
+        std::unique_ptr<ConsoleLogSink> logSink;
 
-        moodycamel::ConcurrentQueue<std::pair<String, bool>> pendingMessages;
+        // For collapsing repeated messages, only used on the message thread
+        String lastMessage;
+        int lastType = 0;
+        int repeatCount = 0;
 
         FastStringWidth fastStringWidth; // For formatting console messages more quickly
     };
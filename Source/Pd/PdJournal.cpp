@@ -0,0 +1,822 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+extern "C" {
+#include <m_pd.h>
+#include <m_imp.h>
+#include <g_canvas.h>
+
+#include "s_libpd_inter.h"
+#include "x_libpd_mod_utils.h"
+}
+
+#include <array>
+
+#include "PdJournal.h"
+#include "PdInstance.h"
+
+namespace pd {
+
+// The patch file, read as far as needed to apply the journal to it
+// Every object is one item, subpatches keep the canvas they contain
+struct JournalCanvas;
+
+struct JournalItem {
+    StringArray messages; // the message that creates the object, followed by the ones that belong to it like "#A" and "#X f"
+    std::unique_ptr<JournalCanvas> canvas;
+};
+
+struct JournalCanvas {
+    StringArray header;
+    std::vector<JournalItem> items;
+    std::vector<std::array<int, 4>> connections;
+    StringArray footer;
+
+    void write(StringArray& out) const
+    {
+        out.addArray(header);
+
+        for (auto const& item : items) {
+            if (item.canvas)
+                item.canvas->write(out);
+            out.addArray(item.messages);
+        }
+
+        for (auto const& [src, nout, sink, nin] : connections)
+            out.add("#X connect " + String(src) + " " + String(nout) + " " + String(sink) + " " + String(nin));
+
+        out.addArray(footer);
+    }
+
+    // Keeps the connections pointing at the same objects after items were inserted or removed
+    template<typename Function>
+    void remapConnections(Function remap)
+    {
+        for (int i = static_cast<int>(connections.size()) - 1; i >= 0; i--) {
+            auto& connection = connections[i];
+            connection[0] = remap(connection[0], connection[1], true);
+            connection[2] = remap(connection[2], connection[3], false);
+
+            if (connection[0] < 0 || connection[2] < 0)
+                connections.erase(connections.begin() + i);
+        }
+    }
+};
+
+// Splits pd's file format into its messages, without the semicolons
+static StringArray splitMessages(String const& text)
+{
+    StringArray messages;
+    String current;
+
+    auto ptr = text.getCharPointer();
+    while (!ptr.isEmpty()) {
+        auto c = ptr.getAndAdvance();
+
+        if (c == '\\' && !ptr.isEmpty()) {
+            current << String::charToString(c) << String::charToString(ptr.getAndAdvance());
+        } else if (c == ';') {
+            auto message = current.trim();
+            if (message.isNotEmpty())
+                messages.add(message);
+            current.clear();
+        } else {
+            current << String::charToString(c == '\n' || c == '\r' ? ' ' : c);
+        }
+    }
+
+    return messages;
+}
+
+static bool parsePatch(String const& text, StringArray& prefix, JournalCanvas& root)
+{
+    std::vector<std::unique_ptr<JournalCanvas>> opened;
+    std::vector<JournalCanvas*> stack;
+
+    for (auto const& message : splitMessages(text)) {
+        auto tokens = StringArray::fromTokens(message, " ", "");
+        auto const& kind = tokens[0];
+        auto const& selector = tokens[1];
+
+        if (kind == "#N" && selector == "canvas") {
+            if (stack.empty()) {
+                root.header.add(message);
+                stack.push_back(&root);
+            } else {
+                opened.push_back(std::make_unique<JournalCanvas>());
+                opened.back()->header.add(message);
+                stack.push_back(opened.back().get());
+            }
+            continue;
+        }
+
+        if (stack.empty()) {
+            prefix.add(message);
+            continue;
+        }
+
+        auto* current = stack.back();
+
+        if (kind == "#X" && selector == "restore") {
+            if (opened.empty())
+                return false;
+
+            stack.pop_back();
+            JournalItem item;
+            item.messages.add(message);
+            item.canvas = std::move(opened.back());
+            opened.pop_back();
+            stack.back()->items.push_back(std::move(item));
+        } else if (kind == "#X" && selector == "connect" && tokens.size() >= 6) {
+            current->connections.push_back({ tokens[2].getIntValue(), tokens[3].getIntValue(), tokens[4].getIntValue(), tokens[5].getIntValue() });
+        } else if (kind == "#X" && selector == "coords") {
+            current->footer.add(message);
+        } else if (kind == "#X" && selector == "declare") {
+            current->header.add(message);
+        } else if ((kind == "#A" || (kind == "#X" && selector == "f")) && !current->items.empty()) {
+            current->items.back().messages.add(message);
+        } else {
+            JournalItem item;
+            item.messages.add(message);
+            current->items.push_back(std::move(item));
+        }
+    }
+
+    return opened.empty();
+}
+
+// The text of a single object, as it would be saved in its patch
+static bool parseItem(String const& text, JournalItem& item)
+{
+    StringArray prefix;
+    JournalCanvas canvas;
+    if (!parsePatch("#N canvas 0 0 450 300 12;\n" + text, prefix, canvas) || canvas.items.size() != 1)
+        return false;
+
+    item = std::move(canvas.items.front());
+    return true;
+}
+
+static JournalCanvas* findCanvas(JournalCanvas& root, String const& path)
+{
+    auto* canvas = &root;
+    if (path == "-")
+        return canvas;
+
+    for (auto const& index : StringArray::fromTokens(path, ".", "")) {
+        auto i = index.getIntValue();
+        if (i < 0 || i >= static_cast<int>(canvas->items.size()) || !canvas->items[i].canvas)
+            return nullptr;
+
+        canvas = canvas->items[i].canvas.get();
+    }
+
+    return canvas;
+}
+
+static bool applyLine(JournalCanvas& root, String const& line)
+{
+    // The text of an object always starts with '#', everything before it are numbers
+    auto textStart = line.indexOf(" #");
+    auto fields = StringArray::fromTokens(textStart >= 0 ? line.substring(0, textStart) : line, " ", "");
+    auto text = textStart >= 0 ? line.substring(textStart + 1) : String();
+
+    auto const& type = fields[0];
+    auto* canvas = findCanvas(root, fields[1]);
+    if (!canvas)
+        return false;
+
+    auto& items = canvas->items;
+    auto numItems = static_cast<int>(items.size());
+    auto getField = [&fields](int i) { return fields[i].getIntValue(); };
+
+    if (type == "add" && fields.size() >= 3) {
+        auto index = getField(2);
+        JournalItem item;
+        if (index < 0 || index > numItems || !parseItem(text, item))
+            return false;
+
+        items.insert(items.begin() + index, std::move(item));
+        canvas->remapConnections([index](int i, int, bool) { return i >= index ? i + 1 : i; });
+        return true;
+    }
+    if (type == "remove" && fields.size() >= 3) {
+        auto index = getField(2);
+        if (index < 0 || index >= numItems)
+            return false;
+
+        items.erase(items.begin() + index);
+        canvas->remapConnections([index](int i, int, bool) { return i == index ? -1 : (i > index ? i - 1 : i); });
+        return true;
+    }
+    if (type == "retype" && fields.size() >= 6) {
+        auto oldIndex = getField(2);
+        auto newIndex = getField(3);
+        auto numInlets = getField(4);
+        auto numOutlets = getField(5);
+
+        JournalItem item;
+        if (oldIndex < 0 || oldIndex >= numItems || newIndex < 0 || newIndex >= numItems || !parseItem(text, item))
+            return false;
+
+        items.erase(items.begin() + oldIndex);
+        items.insert(items.begin() + newIndex, std::move(item));
+
+        // Pd doesn't restore the connections to iolets the new object doesn't have
+        canvas->remapConnections([oldIndex, newIndex, numInlets, numOutlets](int i, int iolet, bool isOutlet) {
+            if (i == oldIndex)
+                return iolet < (isOutlet ? numOutlets : numInlets) ? newIndex : -1;
+
+            auto shifted = i > oldIndex ? i - 1 : i;
+            return shifted >= newIndex ? shifted + 1 : shifted;
+        });
+        return true;
+    }
+    if (type == "move" && fields.size() >= 5) {
+        auto index = getField(2);
+        if (index < 0 || index >= numItems)
+            return false;
+
+        // The position is in the message that creates the object, for subpatches that's the restore message
+        auto& message = items[index].messages.getReference(0);
+        auto tokens = StringArray::fromTokens(message, " ", "");
+        static StringArray const positioned = { "obj", "msg", "floatatom", "symbolatom", "listbox", "text", "restore" };
+
+        if (tokens.size() >= 4 && positioned.contains(tokens[1])) {
+            tokens.set(2, fields[3]);
+            tokens.set(3, fields[4]);
+            message = tokens.joinIntoString(" ");
+        }
+        return true;
+    }
+    if ((type == "connect" || type == "disconnect") && fields.size() >= 6) {
+        std::array<int, 4> connection = { getField(2), getField(3), getField(4), getField(5) };
+        auto it = std::find(canvas->connections.begin(), canvas->connections.end(), connection);
+
+        if (type == "disconnect" && it != canvas->connections.end())
+            canvas->connections.erase(it);
+        else if (type == "connect" && it == canvas->connections.end())
+            canvas->connections.push_back(connection);
+
+        return true;
+    }
+
+    return false;
+}
+
+String Journal::applyJournal(String const& snapshot, StringArray const& lines)
+{
+    StringArray prefix;
+    JournalCanvas root;
+    if (!parsePatch(snapshot, prefix, root))
+        return snapshot;
+
+    // Anything after an edit that doesn't fit the snapshot can't be trusted either
+    for (auto const& line : lines) {
+        if (line.isNotEmpty() && !applyLine(root, line))
+            break;
+    }
+
+    StringArray messages = prefix;
+    root.write(messages);
+
+    String result;
+    for (auto const& message : messages)
+        result << message << ";\n";
+
+    return result;
+}
+
+// Indices of the subpatches that lead from the patch to the canvas
+bool Journal::getCanvasPath(void* cnv, void* root, Line& line)
+{
+    int depth = 0;
+    for (auto* c = static_cast<t_canvas*>(cnv); c != root; c = c->gl_owner) {
+        if (!c->gl_owner || depth == maxDepth)
+            return false;
+        depth++;
+    }
+
+    line.depth = depth;
+    for (auto* c = static_cast<t_canvas*>(cnv); c != root; c = c->gl_owner)
+        line.path[--depth] = glist_getindex(c->gl_owner, &c->gl_obj.te_g);
+
+    return true;
+}
+
+// What text_save writes for the box, as long as the object doesn't save itself in some other way
+// Subpatches, arrays, atom boxes and objects that keep more than their text need a snapshot instead
+bool Journal::getBoxText(void* obj, Line& line, t_atom const*& atoms)
+{
+    auto* object = pd_checkobject(static_cast<t_pd*>(obj));
+    if (!object || object->te_type == T_ATOM || class_getsavefn(pd_class(&object->te_pd)) != class_getsavefn(vinlet_class))
+        return false;
+
+    line.boxType = object->te_type;
+    line.boxX = object->te_xpix;
+    line.boxY = object->te_ypix;
+    line.boxWidth = object->te_width;
+    line.numAtoms = binbuf_getnatom(object->te_binbuf);
+    atoms = binbuf_getvec(object->te_binbuf);
+    return true;
+}
+
+// Same as binbuf_gettext would write it to a patch file
+static String getAtomText(t_atom const& atom)
+{
+    switch (atom.a_type) {
+    case A_SEMI:
+        return "\\;";
+    case A_COMMA:
+        return "\\,";
+    case A_DOLLAR:
+        return "\\$" + String(atom.a_w.w_index);
+    default: {
+        // Saving turns dollar symbols into plain symbols, which get their '$' escaped
+        auto copy = atom;
+        if (copy.a_type == A_DOLLSYM)
+            copy.a_type = A_SYMBOL;
+
+        char buf[MAXPDSTRING];
+        atom_string(&copy, buf, MAXPDSTRING);
+        return String::fromUTF8(buf);
+    }
+    }
+}
+
+String Journal::getLineText(Line const& line, t_atom const* atoms)
+{
+    StringArray path;
+    for (int i = 0; i < line.depth; i++)
+        path.add(String(line.path[i]));
+
+    auto text = path.isEmpty() ? String("-") : path.joinIntoString(".");
+    auto addFields = [&text, &line](int numFields) {
+        for (int i = 0; i < numFields; i++)
+            text << " " << String(line.fields[i]);
+    };
+    auto addBox = [&text, &line, atoms]() {
+        static char const* const selectors[] = { "text", "obj", "msg" };
+        text << " #X " << selectors[line.boxType] << " " << String(line.boxX) << " " << String(line.boxY);
+        for (int i = 0; i < line.numAtoms; i++)
+            text << " " << getAtomText(atoms[i]);
+        if (line.boxWidth)
+            text << ", f " << String(line.boxWidth);
+        text << ";";
+    };
+
+    switch (line.type) {
+    case ObjectAdded:
+        text = "add " + text;
+        addFields(1);
+        addBox();
+        break;
+    case ObjectRemoved:
+        text = "remove " + text;
+        addFields(1);
+        break;
+    case ObjectRetyped:
+        text = "retype " + text;
+        addFields(4);
+        addBox();
+        break;
+    case ObjectMoved:
+        text = "move " + text;
+        addFields(3);
+        break;
+    case ConnectionAdded:
+    case ConnectionRemoved:
+        text = (line.type == ConnectionAdded ? "connect " : "disconnect ") + text;
+        addFields(4);
+        break;
+    default:
+        return {};
+    }
+
+    return text;
+}
+
+Journal::Journal(Instance* inst)
+    : Thread("Patch Journal")
+    , instance(inst)
+{
+}
+
+Journal::~Journal()
+{
+    stop();
+}
+
+void Journal::setDirectory(File const& directory)
+{
+    if (isThreadRunning())
+        return;
+
+    journalDirectory = directory;
+
+    // Every running session holds the lock of its folder, so other sessions can tell it didn't crash
+    // Folders that exist without a session holding their lock still have to be recovered
+    for (int slot = 0; slot < maxSessions; slot++) {
+        auto folder = directory.getChildFile(String(slot));
+        auto lock = std::make_unique<InterProcessLock>("plugdata_journal_" + String(slot));
+
+        if (folder.exists() || !lock->enter(0))
+            continue;
+
+        if (!folder.createDirectory())
+            return;
+
+        recordedLines.resize(maxRecordedLines);
+        recordedAtoms.resize(maxRecordedAtoms);
+        poppedLines.reserve(maxRecordedLines);
+        poppedAtoms.reserve(maxRecordedAtoms);
+
+        sessionLock = std::move(lock);
+        sessionDirectory = folder;
+        startThread();
+        return;
+    }
+}
+
+void Journal::stop()
+{
+    if (!isThreadRunning())
+        return;
+
+    signalThreadShouldExit();
+    notify();
+    stopThread(-1);
+
+    // Frees the snapshots that were still on their way
+    std::vector<Entry> entries;
+    pop(entries);
+
+    sessionDirectory.deleteRecursively();
+    sessionLock.reset();
+}
+
+void Journal::open(void* patch)
+{
+    if (!isThreadRunning())
+        return;
+
+    SpinLock::ScopedLockType lock(patchLock);
+    patches[patch] = { nextId++ };
+    notify();
+}
+
+void Journal::close(void* patch)
+{
+    SpinLock::ScopedLockType lock(patchLock);
+    auto it = patches.find(patch);
+    if (it != patches.end())
+        it->second.isClosed = true;
+}
+
+bool Journal::isJournaled(void* patch)
+{
+    SpinLock::ScopedLockType lock(patchLock);
+    auto it = patches.find(patch);
+    return it != patches.end() && !it->second.isClosed;
+}
+
+bool Journal::push(Line& line, t_atom const* atoms)
+{
+    SpinLock::ScopedLockType lock(recordLock);
+
+    if (linesWritten - linesRead >= maxRecordedLines || atomsWritten - atomsRead + line.numAtoms > maxRecordedAtoms) {
+        linesDropped = true;
+        return false;
+    }
+
+    line.atomStart = atomsWritten;
+    for (int i = 0; i < line.numAtoms; i++)
+        recordedAtoms[(atomsWritten + i) & (maxRecordedAtoms - 1)] = atoms[i];
+
+    atomsWritten += line.numAtoms;
+    recordedLines[linesWritten++ & (maxRecordedLines - 1)] = line;
+    return true;
+}
+
+bool Journal::pop(std::vector<Entry>& entries)
+{
+    bool dropped;
+
+    {
+        SpinLock::ScopedLockType lock(recordLock);
+
+        poppedLines.clear();
+        poppedAtoms.clear();
+
+        for (; linesRead != linesWritten; linesRead++) {
+            auto& line = poppedLines.emplace_back(recordedLines[linesRead & (maxRecordedLines - 1)]);
+            line.atomStart = static_cast<uint32>(poppedAtoms.size());
+            for (int i = 0; i < line.numAtoms; i++)
+                poppedAtoms.push_back(recordedAtoms[(atomsRead + i) & (maxRecordedAtoms - 1)]);
+            atomsRead += line.numAtoms;
+        }
+
+        dropped = linesDropped;
+        linesDropped = false;
+    }
+
+    for (auto& line : poppedLines) {
+        Entry entry;
+        entry.patch = line.patch;
+
+        if (line.type == SnapshotTaken) {
+            entry.isSnapshot = true;
+            if (line.content) {
+                entry.text = String::fromUTF8(line.content, line.contentSize);
+                entry.location = String::fromUTF8(line.directory->s_name) + "/" + String::fromUTF8(line.name->s_name);
+                freebytes(line.content, line.contentSize);
+            }
+        } else {
+            entry.text = getLineText(line, poppedAtoms.data() + line.atomStart);
+        }
+
+        entries.push_back(std::move(entry));
+    }
+
+    return dropped;
+}
+
+void Journal::record(void* cnv, int type, void* obj, void* src, int nout, void* sink, int nin)
+{
+    if (!cnv || cnv == retypeCanvas || !isThreadRunning())
+        return;
+
+    auto* canvas = static_cast<t_canvas*>(cnv);
+
+    // Edits inside abstractions are saved in their own files
+    auto* root = canvas_getrootfor(canvas);
+    if (!isJournaled(root))
+        return;
+
+    Line line;
+    line.patch = root;
+    t_atom const* atoms = nullptr;
+
+    if (!getCanvasPath(canvas, root, line)) {
+        push(line);
+        return;
+    }
+
+    auto getIndex = [canvas](void* object) {
+        return glist_getindex(canvas, static_cast<t_gobj*>(object));
+    };
+
+    switch (type) {
+    case pd_object_added:
+        line.fields = { getIndex(obj) };
+        line.type = getBoxText(obj, line, atoms) ? ObjectAdded : NeedsSnapshot;
+        break;
+    case pd_object_removed:
+        // Reported before the object is deleted, pd removes its connections along with it
+        line.type = ObjectRemoved;
+        line.fields = { getIndex(obj) };
+        break;
+    case pd_object_moved: {
+        if (auto* object = pd_checkobject(static_cast<t_pd*>(obj))) {
+            line.type = ObjectMoved;
+            line.fields = { getIndex(obj), object->te_xpix, object->te_ypix };
+        }
+        break;
+    }
+    case pd_connection_added:
+    case pd_connection_removed:
+        line.type = type == pd_connection_added ? ConnectionAdded : ConnectionRemoved;
+        line.fields = { getIndex(src), nout, getIndex(sink), nin };
+        break;
+    default:
+        break;
+    }
+
+    push(line, atoms);
+}
+
+void Journal::beginRetype(void* cnv, void* obj)
+{
+    retypeCanvas = cnv;
+    retypeObject = obj;
+    retypeIndex = glist_getindex(static_cast<t_canvas*>(cnv), static_cast<t_gobj*>(obj));
+}
+
+void Journal::endRetype()
+{
+    auto* canvas = static_cast<t_canvas*>(retypeCanvas);
+    retypeCanvas = nullptr;
+
+    if (!canvas || !isThreadRunning())
+        return;
+
+    auto* root = canvas_getrootfor(canvas);
+    if (!isJournaled(root))
+        return;
+
+    Line line;
+    line.patch = root;
+    t_atom const* atoms = nullptr;
+
+    if (!getCanvasPath(canvas, root, line)) {
+        push(line);
+        return;
+    }
+
+    // Pd either renames the object in place, or replaces it with a new object at the end of the canvas
+    auto* object = glist_nth(canvas, retypeIndex);
+    if (object != retypeObject)
+        object = reinterpret_cast<t_gobj*>(libpd_newest(canvas));
+
+    if (object && getBoxText(object, line, atoms)) {
+        auto* textObject = pd_checkobject(&object->g_pd);
+        line.type = ObjectRetyped;
+        line.fields = { retypeIndex, glist_getindex(canvas, object), obj_ninlets(textObject), obj_noutlets(textObject) };
+    }
+
+    push(line, atoms);
+}
+
+File Journal::getSnapshotFile(int id) const
+{
+    return sessionDirectory.getChildFile(String(id) + ".pd");
+}
+
+File Journal::getJournalFile(int id) const
+{
+    return sessionDirectory.getChildFile(String(id) + ".journal");
+}
+
+void Journal::run()
+{
+    while (!threadShouldExit()) {
+        wait(writeInterval);
+
+        writeLines();
+        takeSnapshots();
+        removeClosed();
+    }
+}
+
+void Journal::writeLines()
+{
+    std::vector<Entry> entries;
+    auto const dropped = pop(entries);
+
+    std::map<int, String> newText;
+    std::map<int, std::pair<String, String>> snapshots;
+
+    {
+        SpinLock::ScopedLockType lock(patchLock);
+        for (auto& entry : entries) {
+            auto it = patches.find(entry.patch);
+            if (it == patches.end() || it->second.isClosed)
+                continue;
+
+            auto& journaled = it->second;
+
+            // Everything recorded before the snapshot is part of it
+            if (entry.isSnapshot) {
+                journaled.snapshotPending = false;
+                if (entry.text.isNotEmpty()) {
+                    snapshots[journaled.id] = { entry.text, entry.location };
+                    newText.erase(journaled.id);
+                    journaled.needsSnapshot = false;
+                    journaled.numLines = 0;
+                    journaled.lastSnapshot = Time::getMillisecondCounter();
+                }
+                continue;
+            }
+
+            // The next snapshot contains this edit already
+            if (journaled.needsSnapshot)
+                continue;
+
+            if (entry.text.isEmpty() || journaled.numLines >= maxLines) {
+                journaled.needsSnapshot = true;
+                continue;
+            }
+
+            newText[journaled.id] << entry.text << "\n";
+            journaled.numLines++;
+        }
+
+        // The lost lines may have included a snapshot that was asked for
+        if (dropped) {
+            for (auto& [patch, journaled] : patches) {
+                journaled.needsSnapshot = true;
+                journaled.snapshotPending = false;
+            }
+        }
+    }
+
+    for (auto& [id, snapshot] : snapshots) {
+        getSnapshotFile(id).replaceWithText(snapshot.first, false, false, "\n");
+        getJournalFile(id).replaceWithText(snapshot.second + "\n", false, false, "\n");
+    }
+
+    for (auto& [id, text] : newText)
+        getJournalFile(id).appendText(text, false, false, "\n");
+}
+
+void Journal::takeSnapshots()
+{
+    std::vector<void*> due;
+
+    {
+        SpinLock::ScopedLockType lock(patchLock);
+        auto now = Time::getMillisecondCounter();
+        for (auto& [patch, journaled] : patches) {
+            if (journaled.isClosed || journaled.snapshotPending)
+                continue;
+
+            if (journaled.needsSnapshot || (journaled.numLines > 0 && now - journaled.lastSnapshot > snapshotInterval)) {
+                journaled.snapshotPending = true;
+                due.push_back(patch);
+            }
+        }
+    }
+
+    // Taken on pd's thread in between its edits, so the snapshot ends up among the recorded lines right where it belongs
+    for (auto* patch : due)
+        instance->enqueueBulkFunction([this, patch]() { takeSnapshot(patch); });
+}
+
+void Journal::takeSnapshot(void* patch)
+{
+    if (!isThreadRunning())
+        return;
+
+    Line line;
+    line.type = SnapshotTaken;
+    line.patch = patch;
+
+    sys_lock();
+
+    if (isJournaled(patch)) {
+        auto* cnv = static_cast<t_canvas*>(patch);
+        libpd_getcontent(cnv, &line.content, &line.contentSize);
+        line.directory = canvas_getdir(cnv);
+        line.name = cnv->gl_name;
+    }
+
+    if (!push(line) && line.content)
+        freebytes(line.content, line.contentSize);
+
+    sys_unlock();
+}
+
+void Journal::removeClosed()
+{
+    std::vector<int> closed;
+
+    {
+        SpinLock::ScopedLockType lock(patchLock);
+        for (auto it = patches.begin(); it != patches.end();) {
+            if (it->second.isClosed) {
+                closed.push_back(it->second.id);
+                it = patches.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (auto id : closed) {
+        getSnapshotFile(id).deleteFile();
+        getJournalFile(id).deleteFile();
+    }
+}
+
+std::vector<std::pair<String, File>> Journal::recover()
+{
+    std::vector<std::pair<String, File>> recovered;
+
+    for (auto const& session : journalDirectory.findChildFiles(File::findDirectories, false)) {
+        if (session == sessionDirectory)
+            continue;
+
+        // Sessions that are still running hold their lock
+        InterProcessLock lock("plugdata_journal_" + session.getFileName());
+        if (!lock.enter(0))
+            continue;
+
+        for (auto const& snapshot : session.findChildFiles(File::findFiles, false, "*.pd")) {
+            auto lines = StringArray::fromLines(snapshot.withFileExtension("journal").loadFileAsString());
+            auto location = lines.isEmpty() ? String() : lines[0];
+            lines.remove(0);
+
+            recovered.emplace_back(applyJournal(snapshot.loadFileAsString(), lines), File::isAbsolutePath(location) ? File(location) : File());
+        }
+
+        session.deleteRecursively();
+        lock.exit();
+    }
+
+    return recovered;
+}
+
+} // namespace pd
@@ -0,0 +1,169 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <map>
+#include <vector>
+
+extern "C" {
+#include <m_pd.h>
+}
+
+namespace pd {
+
+class Instance;
+
+// Keeps the edits to the open patches on disk, so they can be restored when plugdata or the host crashed
+// Every structural edit pd reports becomes one line in the patch's journal, written to disk in the background
+// Only now and then, or after an edit that can't be described in a single line, the journal is replaced by a snapshot of the whole patch
+class Journal : private Thread {
+public:
+    explicit Journal(Instance* instance);
+    ~Journal() override;
+
+    // Starts journaling into a folder of its own inside the given one, nothing is recorded before this is called
+    void setDirectory(File const& directory);
+
+    // Stops the thread and removes the files of this session, after this nothing is recorded anymore
+    void stop();
+
+    // Starts or stops journaling an open patch, the first snapshot is taken in the background. Message thread only
+    void open(void* patch);
+    void close(void* patch);
+
+    // Called for every change pd reports, on pd's thread
+    void record(void* cnv, int type, void* obj, void* src, int nout, void* sink, int nin);
+
+    // Renaming an object only reports that the whole canvas changed, these describe the rename instead
+    // Called on pd's thread, right before and after the rename
+    void beginRetype(void* cnv, void* obj);
+    void endRetype();
+
+    // Restores the patches of sessions that ended without closing them, as their last snapshot with the journaled edits applied
+    // The files of those sessions are removed, sessions that are still running are left alone
+    std::vector<std::pair<String, File>> recover();
+
+    // The snapshot with the journaled lines applied, up to the first line that doesn't fit it
+    static String applyJournal(String const& snapshot, StringArray const& lines);
+
+private:
+    static constexpr int maxDepth = 16;
+
+    enum LineType {
+        NeedsSnapshot,
+        ObjectAdded,
+        ObjectRemoved,
+        ObjectRetyped,
+        ObjectMoved,
+        ConnectionAdded,
+        ConnectionRemoved,
+        SnapshotTaken
+    };
+
+    // An edit as pd reported it. Lines are recorded on pd's thread, so they hold nothing that needs allocating
+    // The text of an added or retyped object is kept as the atoms of its box, numAtoms of them from atomStart
+    struct Line {
+        LineType type = NeedsSnapshot;
+        void* patch = nullptr;
+        int depth = 0;
+        std::array<int, maxDepth> path {};
+        std::array<int, 4> fields {};
+        int boxType = -1;
+        int boxX = 0, boxY = 0, boxWidth = 0;
+        uint32 atomStart = 0;
+        int numAtoms = 0;
+
+        // The whole patch, for snapshots. Allocated by pd, and freed once the journal thread took it
+        char* content = nullptr;
+        int contentSize = 0;
+        t_symbol* directory = nullptr;
+        t_symbol* name = nullptr;
+    };
+
+    // A line as it's written to the journal
+    struct Entry {
+        void* patch = nullptr;
+        bool isSnapshot = false;
+        String text; // empty if the edit couldn't be described and the patch needs a new snapshot
+        String location;
+    };
+
+    struct JournaledPatch {
+        int id;
+        int numLines = 0;
+        bool needsSnapshot = true;
+        bool snapshotPending = false;
+        bool isClosed = false;
+        uint32 lastSnapshot = 0;
+    };
+
+    void run() override;
+
+    // Appends the recorded lines to the journals, and writes the snapshots that were taken in between them
+    void writeLines();
+
+    // Asks pd's thread for a snapshot of the journals that grew too long or that have edits they couldn't describe
+    void takeSnapshots();
+    void takeSnapshot(void* patch);
+
+    // Removes the files of patches that were closed
+    void removeClosed();
+
+    bool isJournaled(void* patch);
+
+    // Adds a line, and the atoms of its box, to the recorded ones. Returns false if there's no room left
+    bool push(Line& line, t_atom const* atoms = nullptr);
+
+    // Takes the recorded lines, returns true if lines were lost because there was no room for them
+    bool pop(std::vector<Entry>& entries);
+
+    static bool getCanvasPath(void* cnv, void* root, Line& line);
+    static bool getBoxText(void* obj, Line& line, t_atom const*& atoms);
+    static String getLineText(Line const& line, t_atom const* atoms);
+
+    File getSnapshotFile(int id) const;
+    File getJournalFile(int id) const;
+
+    Instance* instance;
+
+    File journalDirectory;
+    File sessionDirectory;
+    std::unique_ptr<InterProcessLock> sessionLock;
+
+    // Ring buffers filled on pd's thread and emptied by the journal thread, allocated once journaling starts
+    SpinLock recordLock;
+    std::vector<Line> recordedLines;
+    std::vector<t_atom> recordedAtoms;
+    uint32 linesWritten = 0, linesRead = 0;
+    uint32 atomsWritten = 0, atomsRead = 0;
+    bool linesDropped = false;
+
+    // Only used on the journal thread, reserved up front so taking the lines doesn't allocate under the lock
+    std::vector<Line> poppedLines;
+    std::vector<t_atom> poppedAtoms;
+
+    SpinLock patchLock;
+    std::map<void*, JournaledPatch> patches;
+    int nextId = 0;
+
+    // Only used on pd's thread
+    void* retypeCanvas = nullptr;
+    void* retypeObject = nullptr;
+    int retypeIndex = -1;
+
+    static constexpr int maxSessions = 64;
+    static constexpr int maxLines = 2000;
+    static constexpr uint32 maxRecordedLines = 1024;
+    static constexpr uint32 maxRecordedAtoms = 16384;
+    static constexpr uint32 snapshotInterval = 5 * 60 * 1000;
+    static constexpr int writeInterval = 500;
+};
+
+} // namespace pd
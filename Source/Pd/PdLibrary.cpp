@@ -12,10 +12,12 @@ extern "C" {
 #include <z_libpd.h>
 }
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 
 #include "PdLibrary.h"
+#include "../Utility/Tracer.h"
 
 struct _canvasenvironment {
     t_symbol* ce_dir;    /* directory patch lives in */
@@ -27,180 +29,181 @@ struct _canvasenvironment {
 
 namespace pd {
 
-// Iterative function to insert a key into a Trie
-void Trie::insert(String const& key)
+// Estimates, the real size depends on the allocator
+static size_t getStringMemory(String const& str)
 {
-    // Names with spaces not supported yet by the suggestor
-    if (key.containsChar(' '))
-        return;
+    return sizeof(String) + (str.isEmpty() ? 0 : str.getNumBytesAsUTF8() + 16);
+}
 
-    // start from the root node
-    Trie* curr = this;
-    for (char i : key) {
-        if (!curr)
-            continue;
+static size_t getStringMemory(std::string const& str)
+{
+    return sizeof(std::string) + (str.capacity() > 15 ? str.capacity() + 1 : 0);
+}
 
-        // create a new node if the path doesn't exist
-        if (curr->character[i] == nullptr) {
-            curr->character[i] = new Trie();
-        }
+// Every entry of an unordered_map is a separate node with a hash and a next pointer
+static constexpr size_t mapNodeOverhead = 2 * sizeof(void*);
 
-        // go to the next node
-        curr = curr->character[i];
-    }
+void SearchIndex::insert(String const& key)
+{
+    // Names with spaces not supported yet by the suggestor
+    if (key.isEmpty() || key.containsChar(' '))
+        return;
 
-    // mark the current node as a leaf
-    curr->isLeaf = true;
+    names.push_back(key.toStdString());
 }
 
-// Iterative function to search a key in a Trie. It returns true
-// if the key is found in the Trie; otherwise, it returns false
-bool Trie::search(String const& key)
+void SearchIndex::finalise(KeywordMap const& keywordMap, SearchIndex const* previous)
 {
-    Trie* curr = this;
-    for (char i : key) {
-        // go to the next node
-        curr = curr->character[i];
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    names.shrink_to_fit();
 
-        // if the string is invalid (reached end of a path in the Trie)
-        if (curr == nullptr) {
-            return false;
-        }
-    }
+    lowercaseNames.resize(names.size());
+    keywords.resize(names.size());
+    usage = std::make_unique<std::atomic<int>[]>(names.size());
 
-    // return true if the current node is a leaf and the
-    // end of the string is reached
-    return curr->isLeaf;
-}
+    for (size_t i = 0; i < names.size(); i++) {
+        lowercaseNames[i] = String(names[i]).toLowerCase().toStdString();
 
-// Returns true if a given node has any children
-bool Trie::hasChildren()
-{
-    for (auto& i : character) {
-        if (i) {
-            return true; // child found
+        auto it = keywordMap.find(String(names[i]));
+        if (it != keywordMap.end()) {
+            keywords[i] = it->second.joinIntoString(" ").toLowerCase().toStdString();
         }
-    }
 
-    return false;
+        usage[i] = previous ? previous->getUsage(names[i]) : 0;
+    }
 }
 
-// Recursive function to delete a key in the Trie
-bool Trie::deletion(Trie*& curr, String key)
+std::shared_ptr<SearchIndex> SearchIndex::withChanges(StringArray const& added, StringArray const& removed, KeywordMap const& keywords) const
 {
-    // return if Trie is empty
-    if (curr == nullptr) {
-        return false;
+    auto newIndex = std::make_shared<SearchIndex>();
+
+    for (auto const& name : names) {
+        if (!removed.contains(String(name)))
+            newIndex->names.push_back(name);
     }
 
-    // if the end of the key is not reached
-    if (key.length()) {
-        // recur for the node corresponding to the next character in the key
-        // and if it returns true, delete the current node (if it is non-leaf)
+    for (auto const& name : added)
+        newIndex->insert(name);
 
-        if (curr != nullptr && curr->character[key[0]] != nullptr && deletion(curr->character[key[0]], key.substring(1)) && !curr->isLeaf) {
-            if (!curr->hasChildren()) {
-                delete curr;
-                curr = nullptr;
-                return true;
-            }
+    newIndex->finalise(keywords, this);
+    return newIndex;
+}
 
-            return false;
-        }
-    }
+size_t SearchIndex::getMemoryUsage() const
+{
+    size_t bytes = sizeof(SearchIndex) + names.size() * sizeof(std::atomic<int>);
 
-    // if the end of the key is reached
-    if (key.length() == 0 && curr->isLeaf) {
-        // if the current node is a leaf node and doesn't have any children
-        if (!curr->hasChildren()) {
-            // delete the current node
-            delete curr;
-            curr = nullptr;
+    for (auto const* list : { &names, &lowercaseNames, &keywords }) {
+        bytes += (list->capacity() - list->size()) * sizeof(std::string);
+        for (auto const& str : *list)
+            bytes += getStringMemory(str);
+    }
 
-            // delete the non-leaf parent nodes
-            return true;
-        }
+    return bytes;
+}
 
-        // mark the current node as a non-leaf node (DON'T DELETE IT)
-        curr->isLeaf = false;
+bool SearchIndex::search(String const& key) const
+{
+    return std::binary_search(names.begin(), names.end(), key.toStdString());
+}
 
-        // don't delete its parent nodes
-        return false;
+void SearchIndex::recordUsage(String const& name) const
+{
+    auto key = name.toStdString();
+    auto it = std::lower_bound(names.begin(), names.end(), key);
+    if (it != names.end() && *it == key) {
+        usage[it - names.begin()]++;
     }
-
-    return false;
 }
 
-void Trie::suggestionsRec(String currPrefix, Suggestions& result)
+int SearchIndex::getUsage(std::string const& name) const
 {
-    // found aString in Trie with the given prefix
-    if (isLeaf) {
-        result.push_back({ currPrefix, true });
+    auto it = std::lower_bound(names.begin(), names.end(), name);
+    if (it != names.end() && *it == name) {
+        return usage[it - names.begin()];
     }
+    return 0;
+}
 
-    // All children struct node pointers are NULL
-    if (!hasChildren())
-        return;
+// Returns -1 if the name doesn't match at all
+// The groups are far enough apart that the usage bonus never moves a name into a better group
+int SearchIndex::score(size_t idx, std::string const& query) const
+{
+    auto const& name = lowercaseNames[idx];
+    int const bonus = std::min<int>(usage[idx], 50) * 4;
+
+    if (name.compare(0, query.size(), query) == 0) {
+        // Exact match, otherwise shorter names first
+        if (name.size() == query.size())
+            return 3000 + bonus;
 
-    for (int i = 0; i < CHAR_SIZE; i++) {
-        if (character[i]) {
-            // append current character to currPrefixString
-            // currPrefix += i;
-            char letter = INDEX_TO_CHAR(i);
-            currPrefix += String(&letter, 1);
+        return 2000 - std::min<int>(static_cast<int>(name.size() - query.size()), 100) + bonus;
+    }
 
-            // recur over the rest
-            character[i]->suggestionsRec(currPrefix, result);
+    // Fuzzy match: all characters of the query appear in order
+    // Fewer gaps and an earlier first match rank higher
+    size_t pos = name.find(query[0]);
+    if (pos != std::string::npos) {
+        int const first = static_cast<int>(pos);
+        int gaps = 0;
+        size_t q = 1;
+        for (++pos; pos < name.size() && q < query.size(); ++pos) {
+            if (name[pos] == query[q]) {
+                q++;
+            } else if (name[pos - 1] == query[q - 1]) {
+                gaps++;
+            }
+        }
 
-            // remove last character
-            currPrefix = currPrefix.dropLastCharacters(1);
+        if (q == query.size()) {
+            return 700 + std::max(0, 300 - gaps * 20 - first * 5) + bonus;
         }
     }
-}
 
-// print suggestions for given query prefix.
-int Trie::autocomplete(String query, Suggestions& result)
-{
-    auto* pCrawl = this;
+    if (query.size() > 1 && keywords[idx].find(query) != std::string::npos) {
+        return 400 + bonus;
+    }
 
-    // Check if prefix is present and find the
-    // the node (of last level) with last character
-    // of givenString.
-    int level;
-    int n = query.length();
-    for (level = 0; level < n; level++) {
-        int index = CHAR_TO_INDEX(query[level]);
+    return -1;
+}
 
-        // no String in the Trie has this prefix
-        if (index < 0 || index >= 127 || !pCrawl->character[index])
-            return 0;
+void SearchIndex::autocomplete(String const& query, Suggestions& result, int maxResults, std::function<bool(String const&)> const& filter) const
+{
+    auto const lowercaseQuery = query.toLowerCase().toStdString();
+    if (lowercaseQuery.empty() || maxResults <= 0)
+        return;
 
-        pCrawl = pCrawl->character[index];
+    std::vector<std::pair<int, uint32>> candidates;
+    for (size_t i = 0; i < names.size(); i++) {
+        auto s = score(i, lowercaseQuery);
+        if (s >= 0)
+            candidates.emplace_back(s, static_cast<uint32>(i));
     }
 
-    // If prefix is present as a word.
-    bool isWord = pCrawl->isLeaf;
-
-    // If prefix is last node of tree (has no
-    // children)
-    bool isLast = !pCrawl->hasChildren();
+    // Highest score first, alphabetical for equal scores
+    auto const compare = [](auto const& a, auto const& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    };
 
-    // If prefix is present as a word, but
-    // there is no subtree below the last
-    // matching node.
-    if (isWord && isLast) {
-        result.push_back({ query, true });
-        return -1;
+    // With a filter we can't know in advance how many candidates we'll need
+    if (filter) {
+        std::sort(candidates.begin(), candidates.end(), compare);
+    } else {
+        auto const numResults = std::min<size_t>(candidates.size(), maxResults);
+        std::partial_sort(candidates.begin(), candidates.begin() + numResults, candidates.end(), compare);
+        candidates.resize(numResults);
     }
 
-    // If there are are nodes below last
-    // matching character.
-    if (!isLast) {
-        String const& prefix = query;
-        pCrawl->suggestionsRec(prefix, result);
-        return 1;
+    for (auto const& [s, idx] : candidates) {
+        if (static_cast<int>(result.size()) >= maxResults)
+            break;
+
+        auto name = String(names[idx]);
+        if (!filter || filter(name)) {
+            result.push_back({ name, true });
+        }
     }
-    return 0;
 }
 
 void Library::initialiseLibrary()
@@ -208,8 +211,6 @@ void Library::initialiseLibrary()
     auto* pdinstance = pd_this;
 
     auto updateFn = [this, pdinstance]() {
-        libraryLock.lock();
-
 // Make sure instance is set correctly for this thread
 #ifdef PDINSTANCE
         pd_setinstance(pdinstance);
@@ -229,6 +230,8 @@ void Library::initialiseLibrary()
             appDataDir.getChildFile("Deken")
         };
 
+        updateHelpIndex();
+
         // Update docs in GUI
         MessageManager::callAsync([this]() {
             watcher.addFolder(appDataDir);
@@ -237,8 +240,6 @@ void Library::initialiseLibrary()
             if (appDirChanged)
                 appDirChanged();
         });
-
-        libraryLock.unlock();
     };
 
     libraryUpdateThread.addJob(updateFn);
@@ -248,11 +249,14 @@ void Library::updateLibrary()
 {
     auto* pdinstance = pd_this;
     auto updateFn = [this, pdinstance]() {
+        TRACE_ZONE("Library::updateLibrary");
+
         auto settingsTree = ValueTree::fromXml(appDataDir.getChildFile("Settings.xml").loadFileAsString());
 
         auto pathTree = settingsTree.getChildWithName("Paths");
 
-        searchTree = std::make_unique<Trie>();
+        auto newIndex = std::make_shared<SearchIndex>();
+        abstractionPaths.clear();
 
         // Get available objects directly from pd
         int i;
@@ -268,53 +272,136 @@ void Library::updateLibrary()
 
         for (i = o->c_nmethod, m = mlist; i--; m++) {
             String name(m->me_name->s_name);
-            searchTree->insert(m->me_name->s_name);
+            newIndex->insert(m->me_name->s_name);
         }
 
-        searchTree->insert("graph");
+        newIndex->insert("graph");
 
 
         // TODO: fix this hack
         auto elsePath = appDataDir.getChildFile("Library").getChildFile("Abstractions").getChildFile("else");
+        abstractionPaths.add(elsePath);
 
         for (const auto& iter : RangedDirectoryIterator(elsePath, false)) {
             auto file = iter.getFile();
             // Get pd files but not help files
             if (file.getFileExtension() == ".pd" && !(file.getFileNameWithoutExtension().startsWith("help-") || file.getFileNameWithoutExtension().endsWith("-help"))) {
-                searchTree->insert(file.getFileNameWithoutExtension().toStdString());
+                newIndex->insert(file.getFileNameWithoutExtension().toStdString());
             }
         }
 
         // TODO: fix this hack as well
         auto heavylibPath = appDataDir.getChildFile("Library").getChildFile("Abstractions").getChildFile("heavylib");
+        abstractionPaths.add(heavylibPath);
 
         for (const auto& iter : RangedDirectoryIterator(heavylibPath, false)) {
             auto file = iter.getFile();
             // Get pd files but not help files
             if (file.getFileExtension() == ".pd" && !(file.getFileNameWithoutExtension().startsWith("help-") || file.getFileNameWithoutExtension().endsWith("-help"))) {
-                searchTree->insert(file.getFileNameWithoutExtension().toStdString());
+                newIndex->insert(file.getFileNameWithoutExtension().toStdString());
             }
         }
 
         // Find patches in our search tree
         for (auto path : pathTree) {
             auto filePath = File(path.getProperty("Path").toString());
+            abstractionPaths.add(filePath);
 
             for (const auto& iter : RangedDirectoryIterator(filePath, false)) {
                 auto file = iter.getFile();
                 // Get pd files but not help files
                 if (file.getFileExtension() == ".pd" && !(file.getFileNameWithoutExtension().startsWith("help-") || file.getFileNameWithoutExtension().endsWith("-help"))) {
-                    searchTree->insert(file.getFileNameWithoutExtension().toStdString());
+                    newIndex->insert(file.getFileNameWithoutExtension().toStdString());
                 }
             }
         }
+
+        newIndex->finalise(getDocumentation()->objectKeywords, std::atomic_load(&searchIndex).get());
+        std::atomic_store(&searchIndex, std::shared_ptr<SearchIndex const>(std::move(newIndex)));
     };
 
     libraryUpdateThread.addJob(updateFn);
 }
 
+// Parsed contents of a single documentation file, as stored in the documentation cache
+struct DocumentationEntry {
+    int64 modificationTime = 0;
+    int64 fileSize = 0;
+
+    String name; // empty if the file has no title
+    bool hasDescription = false;
+    String description;
+    bool hasArguments = false;
+    Arguments arguments;
+    bool hasInlets = false;
+    IODescription inlets;
+    bool hasOutlets = false;
+    IODescription outlets;
+
+    void write(OutputStream& out) const
+    {
+        auto writeIO = [&out](IODescription const& description) {
+            out.writeInt(description.size());
+            for (auto& [tooltip, repeating] : description) {
+                out.writeString(tooltip);
+                out.writeBool(repeating);
+            }
+        };
+
+        out.writeInt64(modificationTime);
+        out.writeInt64(fileSize);
+        out.writeString(name);
+        out.writeBool(hasDescription);
+        out.writeString(description);
+        out.writeBool(hasArguments);
+        out.writeInt(static_cast<int>(arguments.size()));
+        for (auto& [type, argumentDescription, init] : arguments) {
+            out.writeString(type);
+            out.writeString(argumentDescription);
+            out.writeString(init);
+        }
+        out.writeBool(hasInlets);
+        writeIO(inlets);
+        out.writeBool(hasOutlets);
+        writeIO(outlets);
+    }
+
+    void read(InputStream& in)
+    {
+        auto readIO = [&in](IODescription& description) {
+            auto size = in.readInt();
+            for (int i = 0; i < size && !in.isExhausted(); i++) {
+                auto tooltip = in.readString();
+                description.add({ tooltip, in.readBool() });
+            }
+        };
+
+        modificationTime = in.readInt64();
+        fileSize = in.readInt64();
+        name = in.readString();
+        hasDescription = in.readBool();
+        description = in.readString();
+        hasArguments = in.readBool();
+        auto numArguments = in.readInt();
+        for (int i = 0; i < numArguments && !in.isExhausted(); i++) {
+            auto type = in.readString();
+            auto argumentDescription = in.readString();
+            arguments.push_back({ type, argumentDescription, in.readString() });
+        }
+        hasInlets = in.readBool();
+        readIO(inlets);
+        hasOutlets = in.readBool();
+        readIO(outlets);
+    }
+};
+
+// Bump this when the parser or the entry format changes, to invalidate old caches
+static constexpr int documentationCacheVersion = 1;
+
 void Library::parseDocumentation(String const& path)
 {
+    TRACE_ZONE("Library::parseDocumentation");
+
     // Function to get sections from a text file based on a section name
     // Let it know which sections exists, and it will order them and put them in a map by name
     auto getSections = [](String contents, StringArray sectionNames) {
@@ -388,17 +475,20 @@ void Library::parseDocumentation(String const& path)
         return lines;
     };
 
-    auto parseFile = [this, getSections, formatText, sectionsFromHyphens](File& f) {
+    auto parseFile = [getSections, formatText, sectionsFromHyphens](File const& f) {
+        DocumentationEntry entry;
+
         String contents = f.loadFileAsString();
         auto sections = getSections(contents, { "\ntitle", "\ndescription", "\npdcategory", "\ncategories", "\nflags", "\narguments", "\nlast_update", "\ninlets", "\noutlets", "\ndraft" });
 
         if (!sections.count("title"))
-            return;
+            return entry;
 
-        String name = sections["title"].first;
+        entry.name = sections["title"].first;
 
         if (sections.count("description")) {
-            objectDescriptions[name] = sections["description"].first;
+            entry.hasDescription = true;
+            entry.description = sections["description"].first;
         }
 
         if (sections.count("arguments") || sections.count("flags")) {
@@ -414,13 +504,15 @@ void Library::parseDocumentation(String const& path)
                 args.push_back({ sectionMap["name"].first, sectionMap["description"].first, "" });
             }
 
-            arguments[name] = args;
+            entry.hasArguments = true;
+            entry.arguments = args;
         }
 
         auto numbers = { "1st", "2nd", "3rd", "4th", "5th", "6th", "7th", "8th", "nth" };
         if (sections.count("inlets")) {
             auto section = getSections(sections["inlets"].first, numbers);
-            inletDescriptions[name].resize(static_cast<int>(section.size()));
+            entry.hasInlets = true;
+            entry.inlets.resize(static_cast<int>(section.size()));
             for (auto [number, content] : section) {
                 String tooltip;
                 for (auto& argument : sectionsFromHyphens(content.first)) {
@@ -431,12 +523,13 @@ void Library::parseDocumentation(String const& path)
                     tooltip += "(" + sectionMap["type"].first + ") " + sectionMap["description"].first + "\n";
                 }
 
-                inletDescriptions[name].getReference(content.second) = { tooltip, number == "nth" };
+                entry.inlets.getReference(content.second) = { tooltip, number == "nth" };
             }
         }
         if (sections.count("outlets")) {
             auto section = getSections(sections["outlets"].first, numbers);
-            outletDescriptions[name].resize(static_cast<int>(section.size()));
+            entry.hasOutlets = true;
+            entry.outlets.resize(static_cast<int>(section.size()));
             for (auto [number, content] : section) {
                 String tooltip;
 
@@ -447,65 +540,331 @@ void Library::parseDocumentation(String const& path)
                     tooltip += "(" + sectionMap["type"].first + ") " + sectionMap["description"].first + "\n";
                 }
 
-                outletDescriptions[name].getReference(content.second) = { tooltip, number == "nth" };
+                entry.outlets.getReference(content.second) = { tooltip, number == "nth" };
             }
         }
+
+        return entry;
     };
 
+    // Build a new snapshot, readers keep using the old one until it's published
+    auto newDocumentation = std::make_shared<Documentation>();
+
+    auto applyEntry = [&newDocumentation](DocumentationEntry const& entry) {
+        if (entry.name.isEmpty())
+            return;
+
+        if (entry.hasDescription)
+            newDocumentation->objectDescriptions[entry.name] = entry.description;
+        if (entry.hasArguments)
+            newDocumentation->arguments[entry.name] = entry.arguments;
+        if (entry.hasInlets)
+            newDocumentation->inletDescriptions[entry.name] = entry.inlets;
+        if (entry.hasOutlets)
+            newDocumentation->outletDescriptions[entry.name] = entry.outlets;
+    };
+
+    // Load the results of the last run, so we only need to parse files that changed since
+    auto cacheFile = appDataDir.getChildFile("DocumentationCache.bin");
+    std::unordered_map<String, DocumentationEntry> cache;
+
+    if (cacheFile.existsAsFile()) {
+        MemoryMappedFile mappedCache(cacheFile, MemoryMappedFile::readOnly);
+        if (mappedCache.getData()) {
+            MemoryInputStream in(mappedCache.getData(), mappedCache.getSize(), false);
+
+            if (in.readInt() == documentationCacheVersion) {
+                auto numEntries = in.readInt();
+                for (int i = 0; i < numEntries && !in.isExhausted(); i++) {
+                    auto filePath = in.readString();
+                    cache[filePath].read(in);
+                }
+            }
+        }
+    }
+
+    // Entries in directory order, so the result doesn't depend on which file finished parsing first
+    std::vector<std::pair<String, DocumentationEntry>> entries;
+    std::vector<std::pair<size_t, File>> toParse;
+
     for (auto& iter : RangedDirectoryIterator(path, true)) {
         auto file = iter.getFile();
 
-        if (file.hasFileExtension("md")) {
-            parseFile(file);
+        if (!file.hasFileExtension("md"))
+            continue;
+
+        auto filePath = file.getFullPathName();
+        auto modificationTime = iter.getModificationTime().toMilliseconds();
+        auto fileSize = iter.getFileSize();
+
+        auto cached = cache.find(filePath);
+        if (cached != cache.end() && cached->second.modificationTime == modificationTime && cached->second.fileSize == fileSize) {
+            entries.emplace_back(filePath, std::move(cached->second));
+            continue;
         }
+
+        DocumentationEntry entry;
+        entry.modificationTime = modificationTime;
+        entry.fileSize = fileSize;
+
+        toParse.emplace_back(entries.size(), file);
+        entries.emplace_back(filePath, std::move(entry));
+    }
+
+    // Parse the files that changed in parallel, every file gets its own slot so the workers share nothing
+    if (!toParse.empty()) {
+        auto const numWorkers = std::min<int>(SystemStats::getNumCpus(), static_cast<int>(toParse.size()));
+
+        ThreadPool parsePool(numWorkers);
+        WaitableEvent finished;
+        std::atomic<size_t> nextFile = 0;
+        std::atomic<int> remainingWorkers = numWorkers;
+
+        for (int i = 0; i < numWorkers; i++) {
+            parsePool.addJob([&]() {
+                for (size_t idx = nextFile++; idx < toParse.size(); idx = nextFile++) {
+                    auto& [entryIdx, file] = toParse[idx];
+                    auto& entry = entries[entryIdx].second;
+
+                    auto parsed = parseFile(file);
+                    parsed.modificationTime = entry.modificationTime;
+                    parsed.fileSize = entry.fileSize;
+                    entry = std::move(parsed);
+                }
+
+                if (--remainingWorkers == 0)
+                    finished.signal();
+            });
+        }
+
+        finished.wait();
+    }
+
+    std::unordered_map<String, DocumentationEntry> newCache;
+    for (auto& [filePath, entry] : entries) {
+        applyEntry(entry);
+        newCache[filePath] = std::move(entry);
+    }
+
+    bool const cacheChanged = !toParse.empty();
+
+    std::atomic_store(&documentation, std::shared_ptr<Documentation const>(std::move(newDocumentation)));
+
+    // Also rewrite if files were removed
+    if (!cacheChanged && newCache.size() == cache.size())
+        return;
+
+    MemoryOutputStream out;
+    out.writeInt(documentationCacheVersion);
+    out.writeInt(static_cast<int>(newCache.size()));
+    for (auto& [filePath, entry] : newCache) {
+        out.writeString(filePath);
+        entry.write(out);
     }
+
+    cacheFile.replaceWithData(out.getData(), out.getDataSize());
 }
 
-Suggestions Library::autocomplete(String query) const
+Suggestions Library::autocomplete(String const& query, int maxResults, std::function<bool(String const&)> const& filter) const
 {
     Suggestions result;
-    if (searchTree)
-        searchTree->autocomplete(std::move(query), result);
+
+    // The index is swapped out when the library gets updated, hold on to the current one while searching
+    if (auto index = std::atomic_load(&searchIndex))
+        index->autocomplete(query, result, maxResults, filter);
+
     return result;
 }
 
-String Library::getInletOutletTooltip(String objname, int idx, int total, bool isInlet)
+void Library::autocompleteAsync(String const& query, int maxResults, std::function<bool(String const&)> filter, std::function<void(Suggestions&&)> callback)
 {
-    auto name = objname.upToFirstOccurrenceOf(" ", false, false);
-    auto args = StringArray::fromTokens(objname.fromFirstOccurrenceOf(" ", false, false), true);
-
-    auto findInfo = [&name, &args, &total, &idx](IODescriptionMap map) {
-        if (map.count(name)) {
-            auto descriptions = map.at(name);
-
-            // if the amount of inlets is not equal to the amount in the spec, look for repeating inlets
-            if (descriptions.size() < total) {
-                for (int i = 0; i < descriptions.size(); i++) {
-                    if (descriptions[i].second) { // repeating inlet found
-                        for (int j = 0; j < total - descriptions.size(); j++) {
-                            descriptions.insert(i, descriptions[i]);
-                        }
-                    }
-                }
-            }
+    auto generation = ++(*autocompleteGeneration);
+
+    autocompleteThread.addJob([this, query, maxResults, generation, currentGeneration = autocompleteGeneration, filter = std::move(filter), callback = std::move(callback)]() mutable {
+        // A newer query came in while this one was waiting
+        if (generation != *currentGeneration)
+            return;
 
-            auto result = isPositiveAndBelow(idx, descriptions.size()) ? descriptions[idx].first : String();
-            result = result.replace("$mth", String(idx));
-            result = result.replace("$nth", String(idx + 1));
-            result = result.replace("$arg", args[idx]);
+        auto result = autocomplete(query, maxResults, filter);
 
-            return result;
-        }
+        MessageManager::callAsync([generation, currentGeneration, result = std::move(result), callback = std::move(callback)]() mutable {
+            if (generation == *currentGeneration)
+                callback(std::move(result));
+        });
+    });
+}
+
+void Library::recordUsage(String const& name)
+{
+    if (auto index = std::atomic_load(&searchIndex))
+        index->recordUsage(name);
+}
 
+String IoletTooltips::getTooltip(int idx, int total, bool isInlet) const
+{
+    auto const* descriptions = isInlet ? inlets : outlets;
+    if (!descriptions || idx < 0)
         return String();
+
+    int const size = descriptions->size();
+
+    // If there are more iolets than in the spec, the first repeating one stands in for the extra ones
+    if (size < total) {
+        for (int i = 0; i < size; i++) {
+            if ((*descriptions)[i].second) {
+                if (idx > i)
+                    idx = std::max(i, idx - (total - size));
+                break;
+            }
+        }
+    }
+
+    auto result = isPositiveAndBelow(idx, size) ? (*descriptions)[idx].first : String();
+    result = result.replace("$mth", String(idx));
+    result = result.replace("$nth", String(idx + 1));
+    result = result.replace("$arg", String());
+
+    return result;
+}
+
+IoletTooltips Library::getIoletTooltips(t_class* pdClass, String const& className)
+{
+    auto docs = getDocumentation();
+
+    auto lookup = [&docs, &className]() {
+        IoletTooltips tooltips;
+        tooltips.documentation = docs;
+
+        auto inlets = docs->inletDescriptions.find(className);
+        if (inlets != docs->inletDescriptions.end())
+            tooltips.inlets = &inlets->second;
+
+        auto outlets = docs->outletDescriptions.find(className);
+        if (outlets != docs->outletDescriptions.end())
+            tooltips.outlets = &outlets->second;
+
+        return tooltips;
     };
 
-    return isInlet ? findInfo(getInletDescriptions()) : findInfo(getOutletDescriptions());
+    // Abstractions all share the canvas class
+    if (pdClass == canvas_class)
+        return lookup();
+
+    // The documentation got updated, so the cache is outdated
+    if (!ioletTooltipCache.empty() && ioletTooltipCache.begin()->second.documentation != docs)
+        ioletTooltipCache.clear();
+
+    auto cached = ioletTooltipCache.find(pdClass);
+    if (cached != ioletTooltipCache.end())
+        return cached->second;
+
+    return ioletTooltipCache[pdClass] = lookup();
+}
+
+void Library::fileChanged(const File file, FileSystemWatcher::FileSystemEvent fsEvent)
+{
+    pendingFileChanges.add({ file, fsEvent });
 }
 
 void Library::fsChangeCallback()
 {
-    appDirChanged();
+    auto changes = std::move(pendingFileChanges);
+    pendingFileChanges.clear();
+
+    if (libraryFilesChanged)
+        libraryFilesChanged();
+
+    // Without details about what changed, we have to reload everything
+    if (changes.isEmpty()) {
+        if (patchFileChanged)
+            patchFileChanged(File());
+
+        updateHelpIndex();
+        appDirChanged();
+        return;
+    }
+
+    if (patchFileChanged) {
+        for (auto& [file, fsEvent] : changes) {
+            if (file.hasFileExtension("pd"))
+                patchFileChanged(file);
+        }
+    }
+
+    bool settingsChanged = false;
+    bool helpFilesChanged = false;
+
+    for (auto& [file, fsEvent] : changes) {
+        auto fileName = file.getFileName();
+
+        if (fileName == "Settings.xml") {
+            settingsChanged = true;
+        }
+        // Help patches, or folders that could contain them (like a new library)
+        else if (fileName.endsWith("-help.pd") || fileName.startsWith("help-") || !file.hasFileExtension("pd")) {
+            helpFilesChanged = true;
+        }
+    }
+
+    // Settings can change the search paths, which needs a full update
+    if (settingsChanged) {
+        updateHelpIndex();
+        appDirChanged();
+        return;
+    }
+
+    if (helpFilesChanged) {
+        updateHelpIndex();
+    }
+
+    // Only add or remove the abstractions that changed
+    libraryUpdateThread.addJob([this, changes]() {
+        StringArray added, removed;
+
+        for (auto& [file, fsEvent] : changes) {
+            auto name = file.getFileNameWithoutExtension();
+
+            if (!file.hasFileExtension("pd") || name.startsWith("help-") || name.endsWith("-help") || !abstractionPaths.contains(file.getParentDirectory()))
+                continue;
+
+            if (fsEvent == FileSystemWatcher::fileCreated || fsEvent == FileSystemWatcher::fileRenamedNewName) {
+                added.addIfNotAlreadyThere(name);
+                removed.removeString(name);
+            } else if (fsEvent == FileSystemWatcher::fileDeleted || fsEvent == FileSystemWatcher::fileRenamedOldName) {
+                removed.addIfNotAlreadyThere(name);
+                added.removeString(name);
+            }
+        }
+
+        if (added.isEmpty() && removed.isEmpty())
+            return;
+
+        if (auto index = std::atomic_load(&searchIndex)) {
+            auto newIndex = index->withChanges(added, removed, getDocumentation()->objectKeywords);
+            std::atomic_store(&searchIndex, std::shared_ptr<SearchIndex const>(std::move(newIndex)));
+        }
+    });
+}
+
+void Library::updateHelpIndex()
+{
+    libraryUpdateThread.addJob([this]() {
+        std::unordered_map<String, std::pair<int, File>> newIndex;
+
+        for (int i = 0; i < static_cast<int>(helpPaths.size()); i++) {
+            for (auto const& iter : RangedDirectoryIterator(helpPaths[i], true, "*.pd")) {
+                auto file = iter.getFile();
+                auto fileName = file.getFileName();
+
+                if (fileName.endsWith("-help.pd") || fileName.startsWith("help-")) {
+                    // Keep the first match, same as searching the paths one by one
+                    newIndex.try_emplace(fileName, i, file);
+                }
+            }
+        }
+
+        std::atomic_store(&helpIndex, std::shared_ptr<HelpIndex const>(std::make_shared<HelpIndex>(std::move(newIndex))));
+    });
 }
 
 File Library::findHelpfile(t_object* obj)
@@ -532,6 +891,25 @@ File Library::findHelpfile(t_object* obj)
     String firstName = helpName + "-help.pd";
     String secondName = "help-" + helpName + ".pd";
 
+    // Look it up in the index if it's been built already
+    if (auto index = std::atomic_load(&helpIndex)) {
+        auto first = index->find(firstName);
+        auto second = index->find(secondName);
+
+        File file;
+        if (first != index->end() && (second == index->end() || first->second.first <= second->second.first)) {
+            file = first->second.second;
+        } else if (second != index->end()) {
+            file = second->second.second;
+        }
+
+        // If it's not in the index, or the file has disappeared, fall back to searching
+        // The file watcher isn't recursive on Linux, so the index can miss newly installed libraries
+        if (file.existsAsFile()) {
+            return file;
+        }
+    }
+
     auto findHelpPatch = [&firstName, &secondName](const File& searchDir) -> File
     {
         for (const auto& fileIter : RangedDirectoryIterator(searchDir, true))
@@ -557,50 +935,62 @@ File Library::findHelpfile(t_object* obj)
     return File();
 }
 
-ObjectMap Library::getObjectDescriptions()
+size_t Library::getMemoryUsage() const
 {
-    if (libraryLock.try_lock()) {
-        auto descriptions = objectDescriptions;
-        libraryLock.unlock();
-        return descriptions;
+    size_t bytes = 0;
+
+    if (auto index = std::atomic_load(&searchIndex))
+        bytes += index->getMemoryUsage();
+
+    auto const docs = getDocumentation();
+    for (auto const& [name, description] : docs->objectDescriptions)
+        bytes += mapNodeOverhead + getStringMemory(name) + getStringMemory(description);
+
+    for (auto const& [name, keywords] : docs->objectKeywords) {
+        bytes += mapNodeOverhead + getStringMemory(name);
+        for (auto const& keyword : keywords)
+            bytes += getStringMemory(keyword);
     }
-    return {};
-}
-KeywordMap Library::getObjectKeywords()
-{
-    if (libraryLock.try_lock()) {
-        auto keywords = objectKeywords;
-        libraryLock.unlock();
-        return keywords;
+
+    for (auto const* ioMap : { &docs->inletDescriptions, &docs->outletDescriptions }) {
+        for (auto const& [name, iolets] : *ioMap) {
+            bytes += mapNodeOverhead + getStringMemory(name);
+            for (auto const& [description, isSignal] : iolets)
+                bytes += sizeof(std::pair<String, bool>) + getStringMemory(description);
+        }
+    }
+
+    for (auto const& [name, arguments] : docs->arguments) {
+        bytes += mapNodeOverhead + getStringMemory(name);
+        for (auto const& [type, description, defaultValue] : arguments)
+            bytes += getStringMemory(type) + getStringMemory(description) + getStringMemory(defaultValue);
     }
-    return {};
+
+    if (auto index = std::atomic_load(&helpIndex)) {
+        for (auto const& [name, entry] : *index)
+            bytes += mapNodeOverhead + getStringMemory(name) + sizeof(entry) + getStringMemory(entry.second.getFullPathName());
+    }
+
+    return bytes;
 }
-IODescriptionMap Library::getInletDescriptions()
+
+std::shared_ptr<Documentation const> Library::getDocumentation() const
 {
-    if (libraryLock.try_lock()) {
-        auto descriptions = inletDescriptions;
-        libraryLock.unlock();
-        return descriptions;
-    }
-    return {};
+    return std::atomic_load(&documentation);
 }
-IODescriptionMap Library::getOutletDescriptions()
+
+String Library::getObjectDescription(String const& name) const
 {
-    if (libraryLock.try_lock()) {
-        auto descriptions = outletDescriptions;
-        libraryLock.unlock();
-        return descriptions;
-    }
-    return {};
+    auto docs = getDocumentation();
+    auto it = docs->objectDescriptions.find(name);
+    return it != docs->objectDescriptions.end() ? it->second : String();
 }
-ArgumentMap Library::getArguments()
+
+Arguments Library::getArguments(String const& name) const
 {
-    if (libraryLock.try_lock()) {
-        auto args = arguments;
-        libraryLock.unlock();
-        return args;
-    }
-    return {};
+    auto docs = getDocumentation();
+    auto it = docs->arguments.find(name);
+    return it != docs->arguments.end() ? it->second : Arguments();
 }
 
 } // namespace pd
@@ -27,42 +27,60 @@ using ArgumentMap = std::unordered_map<String, Arguments>;
 using ObjectMap = std::unordered_map<String, String>;
 using KeywordMap = std::unordered_map<String, StringArray>;
 
-// Define the character size
-#define CHAR_SIZE 128
-#define CHAR_TO_INDEX(c) (static_cast<int>(c) - static_cast<int>('\0'))
-#define INDEX_TO_CHAR(c) static_cast<char>(c + static_cast<int>('\0'))
-// A class to store a Trie node
-class Trie {
+// Sorted, flat list of object names used for autocompletion
+// Everything the ranking needs is precomputed when the index is built, so a query is a single pass over flat arrays
+class SearchIndex {
 public:
-    bool isLeaf;
-    Trie* character[CHAR_SIZE];
+    void insert(String const& key);
 
-    // Constructor
-    Trie()
-    {
-        isLeaf = false;
+    // Sorts the names, removes duplicates and prepares the ranking data. Needs to be called after inserting
+    // Usage counts are carried over from the previous index, if there is one
+    void finalise(KeywordMap const& keywords, SearchIndex const* previous);
 
-        for (int i = 0; i < CHAR_SIZE; i++) {
-            character[i] = nullptr;
-        }
-    }
+    bool search(String const& key) const;
 
-    ~Trie()
-    {
-        for (int i = 0; i < CHAR_SIZE; i++) {
-            if (character[i]) {
-                delete character[i];
-            }
-        }
-    }
+    // Appends the best maxResults matches for query
+    // Prefix matches come first, then fuzzy (subsequence) matches, then names with a matching keyword
+    // Within each group, objects that were used often are ranked higher
+    void autocomplete(String const& query, Suggestions& result, int maxResults, std::function<bool(String const&)> const& filter = nullptr) const;
 
-    void insert(String const& key);
-    bool deletion(Trie*&, String);
-    bool search(String const&);
-    bool hasChildren();
+    void recordUsage(String const& name) const;
+    int getUsage(std::string const& name) const;
+
+    // Returns a copy of this index with names added and removed, with the usage counts carried over
+    std::shared_ptr<SearchIndex> withChanges(StringArray const& added, StringArray const& removed, KeywordMap const& keywords) const;
+
+    size_t size() const { return names.size(); }
+
+    // Approximate number of bytes used by the names and the ranking data
+    size_t getMemoryUsage() const;
+
+private:
+    int score(size_t idx, std::string const& query) const;
+
+    std::vector<std::string> names;
+    std::vector<std::string> lowercaseNames;
+    std::vector<std::string> keywords; // lowercase and space separated
+    std::unique_ptr<std::atomic<int>[]> usage;
+};
+
+// Parsed documentation
+// Published as an immutable snapshot, so readers can hold on to it without locking while the library updates
+struct Documentation {
+    ObjectMap objectDescriptions;
+    KeywordMap objectKeywords;
+    IODescriptionMap inletDescriptions;
+    IODescriptionMap outletDescriptions;
+    ArgumentMap arguments;
+};
+
+// Documented inlets and outlets of a class
+struct IoletTooltips {
+    std::shared_ptr<Documentation const> documentation; // keeps the descriptions below alive
+    IODescription const* inlets = nullptr;
+    IODescription const* outlets = nullptr;
 
-    void suggestionsRec(String currPrefix, Suggestions& result);
-    int autocomplete(String query, Suggestions& result);
+    String getTooltip(int idx, int total, bool isInlet) const;
 };
 
 struct Library : public FileSystemWatcher::Listener {
@@ -70,43 +88,80 @@ struct Library : public FileSystemWatcher::Listener {
     ~Library()
     {
         appDirChanged = nullptr;
+        patchFileChanged = nullptr;
+        libraryFilesChanged = nullptr;
         libraryUpdateThread.removeAllJobs(true, -1);
+        autocompleteThread.removeAllJobs(true, -1);
     }
     void initialiseLibrary();
 
     void updateLibrary();
     void parseDocumentation(String const& path);
 
-    Suggestions autocomplete(String query) const;
+    Suggestions autocomplete(String const& query, int maxResults = 20, std::function<bool(String const&)> const& filter = nullptr) const;
+
+    // Searches on a background thread and calls the callback on the message thread with the results
+    // Starting a new query cancels the previous one: if it didn't run yet it's skipped, otherwise its results are dropped
+    void autocompleteAsync(String const& query, int maxResults, std::function<bool(String const&)> filter, std::function<void(Suggestions&&)> callback);
 
-    String getInletOutletTooltip(String objname, int idx, int total, bool isInlet);
+    // Called when an object gets created, so it will be ranked higher in future suggestions
+    void recordUsage(String const& name);
+
+    // Cached by class, so this is only looked up by name once per class. Only call this from the message thread
+    IoletTooltips getIoletTooltips(t_class* pdClass, String const& className);
 
     void fsChangeCallback() override;
+    void fileChanged(const File file, FileSystemWatcher::FileSystemEvent fsEvent) override;
     
     File findHelpfile(t_object* obj);
 
+    // Rebuilds the help file index on the library thread
+    void updateHelpIndex();
+
     std::vector<File> helpPaths;
 
     ThreadPool libraryUpdateThread = ThreadPool(1);
 
-    ObjectMap getObjectDescriptions();
-    KeywordMap getObjectKeywords();
-    IODescriptionMap getInletDescriptions();
-    IODescriptionMap getOutletDescriptions();
-    ArgumentMap getArguments();
+    // Never returns null
+    std::shared_ptr<Documentation const> getDocumentation() const;
+
+    String getObjectDescription(String const& name) const;
+    Arguments getArguments(String const& name) const;
+
+    // Approximate number of bytes used by the search index, the parsed documentation and the help file index
+    size_t getMemoryUsage() const;
 
     std::function<void()> appDirChanged;
 
+    // Called for every patch in the library folders that changed, with an empty file if it's unknown which ones did
+    std::function<void(File const&)> patchFileChanged;
+
+    // Called when any file in the library folders was added, removed or changed, like externals installed by Deken
+    std::function<void()> libraryFilesChanged;
+
 private:
-    ObjectMap objectDescriptions;
-    KeywordMap objectKeywords;
-    IODescriptionMap inletDescriptions;
-    IODescriptionMap outletDescriptions;
-    ArgumentMap arguments;
+    std::shared_ptr<Documentation const> documentation = std::make_shared<Documentation const>();
+
+    std::unordered_map<t_class*, IoletTooltips> ioletTooltipCache;
+
+    // Folders whose patches are suggested as abstractions, only used on the library thread
+    Array<File> abstractionPaths;
+
+    // File changes reported by the watcher since the last fsChangeCallback
+    Array<std::pair<File, FileSystemWatcher::FileSystemEvent>> pendingFileChanges;
+
+    // Help file name -> index into helpPaths and the file, for the first match in search order
+    // Null until it's been built for the first time
+    using HelpIndex = std::unordered_map<String, std::pair<int, File>>;
+    std::shared_ptr<HelpIndex const> helpIndex = nullptr;
+
+    std::shared_ptr<SearchIndex const> searchIndex = nullptr;
 
-    std::mutex libraryLock;
+    // Separate from the library thread, so queries don't wait for a library update to finish
+    ThreadPool autocompleteThread = ThreadPool(1);
 
-    std::unique_ptr<Trie> searchTree = nullptr;
+    // Shared with the pending callbacks, so they can check if they're stale without touching the library
+    std::shared_ptr<std::atomic<uint32>> autocompleteGeneration = std::make_shared<std::atomic<uint32>>(0);
 
     File appDataDir;
     FileSystemWatcher watcher;
@@ -0,0 +1,266 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "PdOscReceiver.h"
+
+extern "C" {
+#include <m_pd.h>
+#include "x_libpd_multi.h"
+}
+
+namespace pd {
+
+// Seconds between 1900, where OSC time starts, and 1970
+static constexpr double ntpEpochOffset = 2208988800.0;
+
+// Timetag 1 means "now"
+static constexpr uint64 immediateTimetag = 1;
+
+// Messages can't have more atoms than this, the rest is dropped
+static constexpr int maxAtoms = 64;
+
+static uint32 readUint32(char const* data)
+{
+    auto const* bytes = reinterpret_cast<uint8 const*>(data);
+    return (static_cast<uint32>(bytes[0]) << 24) | (static_cast<uint32>(bytes[1]) << 16) | (static_cast<uint32>(bytes[2]) << 8) | static_cast<uint32>(bytes[3]);
+}
+
+static uint64 readUint64(char const* data)
+{
+    return (static_cast<uint64>(readUint32(data)) << 32) | readUint32(data + 4);
+}
+
+// Length of a string with its padding, or -1 if it isn't terminated inside the packet
+static int paddedStringLength(char const* data, int size)
+{
+    for (int i = 0; i < size; i++) {
+        if (data[i] == '\0')
+            return (i + 4) & ~3;
+    }
+    return -1;
+}
+
+OscReceiver::OscReceiver()
+    : Thread("OSC Receiver")
+{
+}
+
+OscReceiver::~OscReceiver()
+{
+    setPort(0);
+}
+
+bool OscReceiver::setPort(int newPort)
+{
+    if (newPort == port && (port == 0 || socket))
+        return true;
+
+    signalThreadShouldExit();
+    if (socket)
+        socket->shutdown();
+    stopThread(1000);
+    socket.reset();
+    port = 0;
+
+    if (newPort <= 0)
+        return true;
+
+    auto newSocket = std::make_unique<DatagramSocket>(false);
+    if (!newSocket->bindToPort(newPort))
+        return false;
+
+    socket = std::move(newSocket);
+    port = newPort;
+
+    startThread(8);
+    return true;
+}
+
+void OscReceiver::setLatency(double milliseconds)
+{
+    latency = std::max(milliseconds, 0.0) / 1000.0;
+}
+
+double OscReceiver::getNtpTime()
+{
+    // Wall clock once, the high resolution counter after that
+    static double const start = Time::currentTimeMillis() / 1000.0 + ntpEpochOffset - Time::getMillisecondCounterHiRes() / 1000.0;
+    return start + Time::getMillisecondCounterHiRes() / 1000.0;
+}
+
+void OscReceiver::run()
+{
+    Packet packet;
+
+    while (!threadShouldExit()) {
+        if (socket->waitUntilReady(true, 100) != 1)
+            continue;
+
+        packet.size = socket->read(packet.data, maxPacketSize, false);
+        packet.arrival = getNtpTime();
+
+        if (packet.size <= 0 || packet.size >= maxPacketSize) {
+            // Also a packet that was cut off, since the datagram was bigger than the buffer
+            if (packet.size > 0)
+                droppedPackets.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Never allocates, a full queue means the audio thread doesn't keep up and the packet is dropped
+        if (!packets.try_enqueue(packet))
+            droppedPackets.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void OscReceiver::dispatch(void* scheduler, double sampleRate)
+{
+    Packet packet;
+
+    // Limits the work in one tick, the rest waits for the next one
+    for (int i = 0; i < 64 && packets.try_dequeue(packet); i++) {
+        parsePacket(packet.data, packet.size, packet.arrival, 0.0, scheduler, sampleRate, 0);
+    }
+}
+
+void OscReceiver::parsePacket(char const* data, int size, double arrival, double timetag, void* scheduler, double sampleRate, int depth)
+{
+    // Nested bundles beyond this are malformed or malicious
+    if (size < 4 || depth > 8)
+        return;
+
+    if (size >= 16 && !memcmp(data, "#bundle", 8)) {
+        auto const tag = readUint64(data + 8);
+        auto bundleTime = timetag;
+        if (tag != immediateTimetag) {
+            bundleTime = static_cast<double>(tag >> 32) + static_cast<double>(tag & 0xffffffff) / 4294967296.0;
+        }
+
+        for (int pos = 16; pos + 4 <= size;) {
+            auto const elementSize = static_cast<int>(readUint32(data + pos));
+            pos += 4;
+            if (elementSize <= 0 || elementSize > size - pos)
+                return;
+
+            parsePacket(data + pos, elementSize, arrival, bundleTime, scheduler, sampleRate, depth + 1);
+            pos += elementSize;
+        }
+        return;
+    }
+
+    auto due = arrival + latency.load(std::memory_order_relaxed);
+    if (timetag > due)
+        due = timetag;
+
+    parseMessage(data, size, due, scheduler, sampleRate);
+}
+
+void OscReceiver::parseMessage(char const* data, int size, double due, void* scheduler, double sampleRate)
+{
+    if (data[0] != '/')
+        return;
+
+    auto const addressLength = paddedStringLength(data, size);
+    if (addressLength < 0)
+        return;
+
+    // Type tags are optional in OSC 1.0, messages without them carry no arguments we can read
+    char const* types = ",";
+    int pos = addressLength;
+    if (pos < size && data[pos] == ',') {
+        auto const typesLength = paddedStringLength(data + pos, size - pos);
+        if (typesLength < 0)
+            return;
+        types = data + pos;
+        pos += typesLength;
+    }
+
+    t_atom atoms[maxAtoms];
+    int argc = 0;
+
+    for (char const* type = types + 1; *type && argc < maxAtoms; type++) {
+        auto const remaining = size - pos;
+
+        switch (*type) {
+        case 'i':
+        case 'c':
+        case 'r':
+        case 'm':
+            if (remaining < 4)
+                return;
+            SETFLOAT(atoms + argc++, static_cast<t_float>(static_cast<int32>(readUint32(data + pos))));
+            pos += 4;
+            break;
+        case 'f': {
+            if (remaining < 4)
+                return;
+            auto const bits = readUint32(data + pos);
+            float value;
+            memcpy(&value, &bits, sizeof(float));
+            SETFLOAT(atoms + argc++, value);
+            pos += 4;
+            break;
+        }
+        case 'h':
+            if (remaining < 8)
+                return;
+            SETFLOAT(atoms + argc++, static_cast<t_float>(static_cast<int64>(readUint64(data + pos))));
+            pos += 8;
+            break;
+        case 'd': {
+            if (remaining < 8)
+                return;
+            auto const bits = readUint64(data + pos);
+            double value;
+            memcpy(&value, &bits, sizeof(double));
+            SETFLOAT(atoms + argc++, static_cast<t_float>(value));
+            pos += 8;
+            break;
+        }
+        case 't':
+            // Timetags as arguments aren't of any use inside pd
+            if (remaining < 8)
+                return;
+            pos += 8;
+            break;
+        case 's':
+        case 'S': {
+            auto const length = paddedStringLength(data + pos, remaining);
+            if (length < 0)
+                return;
+            SETSYMBOL(atoms + argc++, gensym(data + pos));
+            pos += length;
+            break;
+        }
+        case 'b': {
+            if (remaining < 4)
+                return;
+            auto const blobSize = static_cast<int>(readUint32(data + pos));
+            if (blobSize < 0 || blobSize > remaining - 4)
+                return;
+            pos += 4 + ((blobSize + 3) & ~3);
+            break;
+        }
+        case 'T':
+            SETFLOAT(atoms + argc++, 1);
+            break;
+        case 'F':
+        case 'N':
+            SETFLOAT(atoms + argc++, 0);
+            break;
+        case 'I':
+            SETFLOAT(atoms + argc++, std::numeric_limits<t_float>::infinity());
+            break;
+        default:
+            // Sizes of unknown types are unknown too, so the rest can't be read
+            return;
+        }
+    }
+
+    auto const delay = (due - getNtpTime()) * sampleRate;
+    libpd_multi_osc_schedule(scheduler, gensym(data), argc, atoms, delay);
+}
+
+} // namespace pd
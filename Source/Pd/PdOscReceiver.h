@@ -0,0 +1,66 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "concurrentqueue.h"
+
+namespace pd {
+
+// Receives OSC over UDP on its own thread, without going through pd's scheduler
+// Packets are queued as they arrived, and parsed on the audio thread at the start of a tick
+// Messages in bundles with a timetag in the future are scheduled at the sample they're due,
+// the others are delayed by the latency, so jitter on the network doesn't end up in the audio
+class OscReceiver : private Thread {
+public:
+    OscReceiver();
+    ~OscReceiver() override;
+
+    // Starts listening on a UDP port, or stops with port 0. Not on the audio thread
+    bool setPort(int port);
+    int getPort() const { return port; }
+
+    // Delay for messages without a timetag, or with a timetag that already passed
+    void setLatency(double milliseconds);
+
+    // Delivers the queued packets through the scheduler from libpd_multi_osc_scheduler_new
+    // The caller needs to hold pd's lock, with the instance set
+    void dispatch(void* scheduler, double sampleRate);
+
+    bool hasPendingPackets() const { return packets.size_approx() > 0; }
+
+    uint32 getNumDroppedPackets() const { return droppedPackets.load(std::memory_order_relaxed); }
+
+private:
+    void run() override;
+
+    // Seconds since 1900, like OSC timetags
+    static double getNtpTime();
+
+    void parsePacket(char const* data, int size, double arrival, double timetag, void* scheduler, double sampleRate, int depth);
+    void parseMessage(char const* data, int size, double due, void* scheduler, double sampleRate);
+
+    // Larger than the payload of a UDP packet on ethernet, bigger packets are dropped
+    static constexpr int maxPacketSize = 2048;
+
+    struct Packet {
+        int size = 0;
+        double arrival = 0.0;
+        char data[maxPacketSize];
+    };
+
+    moodycamel::ConcurrentQueue<Packet> packets = moodycamel::ConcurrentQueue<Packet>(256);
+    std::atomic<uint32> droppedPackets = 0;
+
+    std::unique_ptr<DatagramSocket> socket;
+    int port = 0;
+
+    std::atomic<double> latency = 0.0;
+};
+
+} // namespace pd
@@ -84,7 +84,13 @@ Rectangle<int> Patch::getBounds() const
 
 void Patch::close()
 {
-    libpd_closefile(ptr);
+    // Freeing a big patch at once would keep the audio thread waiting, so it's taken apart over the next few ticks
+    instance->setThis();
+    sys_lock();
+    instance->journal.close(getPointer());
+    instance->snapshots.patchChanged();
+    libpd_deferfree_canvas(getPointer());
+    sys_unlock();
 }
 
 bool Patch::isDirty() const
@@ -99,8 +105,12 @@ void Patch::savePatch(File const& location)
 
     auto* dir = gensym(fullPathname.toRawUTF8());
     auto* file = gensym(filename.toRawUTF8());
+
+    instance->flushInfoStorage();
+    instance->abstractionWatcher.ignoreNextChange(location);
     libpd_savetofile(getPointer(), file, dir);
     instance->synchroniseAll();
+    instance->abstractionWatcher.updateWatchedFolders();
     
     setTitle(filename);
 
@@ -116,6 +126,8 @@ void Patch::savePatch()
     auto* dir = gensym(fullPathname.toRawUTF8());
     auto* file = gensym(filename.toRawUTF8());
 
+    instance->flushInfoStorage();
+    instance->abstractionWatcher.ignoreNextChange(currentFile);
     libpd_savetofile(getPointer(), file, dir);
     instance->synchroniseAll();
     
@@ -397,7 +409,9 @@ void* Patch::renameObject(void* obj, String const& name)
 
     instance->enqueueFunction([this, obj, newName]() mutable {
         setCurrent();
+        instance->journal.beginRetype(getPointer(), obj);
         libpd_renameobj(getPointer(), &checkObject(obj)->te_g, newName.toRawUTF8(), newName.getNumBytesAsUTF8());
+        instance->journal.endRetype();
 
         // make sure that creating a graph doesn't leave it as the current patch
         setCurrent();
@@ -112,6 +112,7 @@ public:
         libpd_getcontent(static_cast<t_canvas*>(ptr), &buf, &bufsize);
 
         auto content = String(buf, static_cast<size_t>(bufsize));
+        freebytes(buf, static_cast<size_t>(bufsize));
         return content;
     }
 
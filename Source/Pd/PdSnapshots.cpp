@@ -0,0 +1,408 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+extern "C" {
+#include <m_pd.h>
+#include <m_imp.h>
+#include <g_canvas.h>
+#include <g_all_guis.h>
+}
+
+#include <string_view>
+
+#include "PdSnapshots.h"
+#include "PdInstance.h"
+
+namespace pd {
+
+// Only the fields up to the flavor are needed, the rest of the struct is in Objects/AtomObject.h
+typedef struct _snapshot_gatom {
+    t_text a_text;
+    int a_flavor;
+} t_snapshot_gatom;
+
+float Snapshots::getValue(Entry const& entry)
+{
+    switch (entry.kind) {
+    case Toggle:
+        return static_cast<t_toggle*>(entry.object)->x_on;
+    case Slider:
+        return static_cast<t_slider*>(entry.object)->x_fval;
+    case Radio:
+        return static_cast<t_radio*>(entry.object)->x_on;
+    case NumberBox:
+        return static_cast<t_my_numbox*>(entry.object)->x_val;
+    default: {
+        auto* binbuf = static_cast<t_snapshot_gatom*>(entry.object)->a_text.te_binbuf;
+        return binbuf_getnatom(binbuf) == 1 ? atom_getfloat(binbuf_getvec(binbuf)) : 0.0f;
+    }
+    }
+}
+
+void Snapshots::findGuis(void* canvas, std::vector<Entry>& found)
+{
+    // Symbols belong to one instance, so we compare the class names
+    static std::pair<std::string_view, Kind> const classes[] = {
+        { "tgl", Toggle }, { "hsl", Slider }, { "vsl", Slider }, { "hradio", Radio }, { "vradio", Radio }, { "nbx", NumberBox }, { "gatom", FloatAtom }
+    };
+
+    for (t_gobj* y = static_cast<t_canvas*>(canvas)->gl_list; y; y = y->g_next) {
+        auto* cls = pd_class(&y->g_pd);
+
+        if (cls == canvas_class) {
+            findGuis(y, found);
+            continue;
+        }
+
+        auto const name = std::string_view(class_getname(cls));
+        for (auto const& [className, kind] : classes) {
+            if (name != className)
+                continue;
+
+            // Symbol and list atoms don't have a value we can interpolate
+            if (kind == FloatAtom && reinterpret_cast<t_snapshot_gatom*>(y)->a_flavor != A_FLOAT)
+                break;
+
+            found.push_back({ y, kind });
+            break;
+        }
+    }
+}
+
+Snapshots::Snapshots(Instance* inst)
+    : instance(inst)
+{
+}
+
+Snapshots::~Snapshots()
+{
+    cancelPendingUpdate();
+}
+
+void Snapshots::findEntries()
+{
+    // Any edit to a patch might free the GUIs, so the pointers are only kept for the morph, until patchChanged is called
+    entries.clear();
+
+    for (auto* cnv = pd_getcanvaslist(); cnv; cnv = cnv->gl_next)
+        findGuis(cnv, entries);
+}
+
+void Snapshots::store(int index, String const& name)
+{
+    if (index < 0)
+        return;
+
+    Snapshot snapshot;
+
+    instance->setThis();
+    sys_lock();
+
+    findEntries();
+    snapshot.kinds.reserve(entries.size());
+    snapshot.values.reserve(entries.size());
+
+    for (auto& entry : entries) {
+        snapshot.kinds.push_back(entry.kind);
+        snapshot.values.push_back(getValue(entry));
+    }
+
+    sys_unlock();
+
+    int from, to;
+
+    {
+        ScopedLock lock(snapshotLock);
+
+        if (index >= snapshots.size())
+            snapshots.resize(index + 1);
+
+        snapshot.name = name.isNotEmpty() ? name : snapshots[index].name;
+        if (snapshot.name.isEmpty())
+            snapshot.name = "Snapshot " + String(index + 1);
+
+        snapshots[index] = std::move(snapshot);
+
+        from = morphFrom;
+        to = morphTo;
+    }
+
+    // Overwriting one of the morph snapshots changes the differences between them
+    if (index == from || index == to)
+        setMorph(from, to);
+
+    currentSnapshot = index;
+    notifyChange();
+}
+
+void Snapshots::recall(int index)
+{
+    interpolate(index, index, 0.0f);
+}
+
+void Snapshots::interpolate(int from, int to, float position)
+{
+    Snapshot a, b;
+
+    {
+        ScopedLock lock(snapshotLock);
+        if (!isPositiveAndBelow(from, snapshots.size()) || !isPositiveAndBelow(to, snapshots.size()))
+            return;
+
+        a = snapshots[from];
+        if (to != from)
+            b = snapshots[to];
+    }
+
+    position = std::clamp(position, 0.0f, 1.0f);
+
+    // All values are set between two dsp ticks, a GUI that already has its value doesn't get a message, so it doesn't output or redraw
+    instance->enqueueFunction([this, a = std::move(a), b = std::move(b), position]() {
+        sys_lock();
+        findEntries();
+
+        auto const& target = b.values.empty() ? a : b;
+        auto const numValues = std::min({ entries.size(), a.values.size(), target.values.size() });
+
+        for (int i = 0; i < numValues; i++) {
+            auto& entry = entries[i];
+
+            // The patch changed since the snapshot was stored, skip values that belong to another type of GUI
+            if (a.kinds[i] != entry.kind || target.kinds[i] != entry.kind)
+                continue;
+
+            float value;
+            if (entry.kind == Toggle || entry.kind == Radio)
+                value = position < 0.5f ? a.values[i] : target.values[i];
+            else
+                value = a.values[i] + (target.values[i] - a.values[i]) * position;
+
+            if (getValue(entry) != value)
+                pd_float(static_cast<t_pd*>(entry.object), value);
+        }
+
+        sys_unlock();
+    });
+
+    auto const current = position < 0.5f ? from : to;
+    if (currentSnapshot.exchange(current) != current)
+        notifyChange();
+}
+
+void Snapshots::setMorph(int from, int to)
+{
+    std::vector<MorphValue> values;
+    std::vector<Entry> found;
+
+    // Any edit after this bumps the generation, and the audio thread stops using these pointers
+    instance->setThis();
+    sys_lock();
+    auto const generation = patchGeneration.load();
+    findEntries();
+    found = entries;
+    sys_unlock();
+
+    {
+        ScopedLock lock(snapshotLock);
+        if (isPositiveAndBelow(from, snapshots.size()) && isPositiveAndBelow(to, snapshots.size())) {
+            auto const& a = snapshots[from];
+            auto const& b = snapshots[to];
+            auto const numValues = std::min({ found.size(), a.values.size(), b.values.size() });
+
+            values.reserve(numValues);
+            for (int i = 0; i < numValues; i++) {
+                // The patch changed in between storing the two, or since then
+                if (a.kinds[i] != found[i].kind || b.kinds[i] != found[i].kind)
+                    continue;
+
+                values.push_back({ found[i].object, found[i].kind, a.values[i], b.values[i] - a.values[i], b.values[i] });
+            }
+
+            morphFrom = from;
+            morphTo = to;
+        } else {
+            morphFrom = -1;
+            morphTo = -1;
+        }
+    }
+
+    instance->enqueueFunction([this, values = std::move(values), generation]() mutable {
+        std::swap(morphValues, values);
+        morphGeneration = generation;
+        lastMorphPosition = -1.0f;
+    });
+}
+
+void Snapshots::processMorph(float position)
+{
+    if (morphValues.empty() || position == lastMorphPosition)
+        return;
+
+    sys_lock();
+
+    // Edits happen with pd's lock held, so once we have it the pointers are either all valid or the generation has moved on
+    if (morphGeneration != patchGeneration.load()) {
+        sys_unlock();
+        return;
+    }
+
+    lastMorphPosition = position;
+
+    for (auto const& morph : morphValues) {
+        auto const entry = Entry { morph.object, morph.kind };
+
+        float value;
+        if (morph.kind == Toggle || morph.kind == Radio)
+            value = position < 0.5f ? morph.start : morph.end;
+        else
+            value = morph.start + morph.delta * position;
+
+        if (getValue(entry) != value)
+            pd_float(static_cast<t_pd*>(morph.object), value);
+    }
+
+    sys_unlock();
+}
+
+void Snapshots::patchChanged()
+{
+    patchGeneration++;
+    triggerAsyncUpdate();
+}
+
+void Snapshots::handleAsyncUpdate()
+{
+    int from, to;
+
+    {
+        ScopedLock lock(snapshotLock);
+        from = morphFrom;
+        to = morphTo;
+    }
+
+    if (from >= 0 && to >= 0)
+        setMorph(from, to);
+}
+
+void Snapshots::remove(int index)
+{
+    bool stopMorph;
+
+    {
+        ScopedLock lock(snapshotLock);
+        if (!isPositiveAndBelow(index, snapshots.size()))
+            return;
+
+        snapshots.erase(snapshots.begin() + index);
+
+        // The morph keeps its values, unless one of its snapshots is gone
+        stopMorph = morphFrom == index || morphTo == index;
+        morphFrom -= morphFrom > index;
+        morphTo -= morphTo > index;
+    }
+
+    if (stopMorph)
+        setMorph(-1, -1);
+
+    if (currentSnapshot > index)
+        currentSnapshot--;
+
+    notifyChange();
+}
+
+void Snapshots::clear()
+{
+    {
+        ScopedLock lock(snapshotLock);
+        snapshots.clear();
+    }
+
+    setMorph(-1, -1);
+    currentSnapshot = 0;
+    notifyChange();
+}
+
+int Snapshots::getNumSnapshots() const
+{
+    ScopedLock lock(snapshotLock);
+    return static_cast<int>(snapshots.size());
+}
+
+String Snapshots::getName(int index) const
+{
+    ScopedLock lock(snapshotLock);
+    return isPositiveAndBelow(index, snapshots.size()) ? snapshots[index].name : String();
+}
+
+void Snapshots::setName(int index, String const& name)
+{
+    {
+        ScopedLock lock(snapshotLock);
+        if (!isPositiveAndBelow(index, snapshots.size()))
+            return;
+
+        snapshots[index].name = name;
+    }
+
+    notifyChange();
+}
+
+void Snapshots::write(OutputStream& ostream) const
+{
+    ScopedLock lock(snapshotLock);
+
+    ostream.writeCompressedInt(static_cast<int>(snapshots.size()));
+    ostream.writeCompressedInt(currentSnapshot);
+    ostream.writeCompressedInt(morphFrom + 1);
+    ostream.writeCompressedInt(morphTo + 1);
+
+    for (auto const& snapshot : snapshots) {
+        ostream.writeString(snapshot.name);
+        ostream.writeCompressedInt(static_cast<int>(snapshot.values.size()));
+
+        for (int i = 0; i < snapshot.values.size(); i++) {
+            ostream.writeByte(static_cast<char>(snapshot.kinds[i]));
+            ostream.writeFloat(snapshot.values[i]);
+        }
+    }
+}
+
+void Snapshots::read(InputStream& istream)
+{
+    std::vector<Snapshot> loaded(std::max(0, istream.readCompressedInt()));
+    auto const current = istream.readCompressedInt();
+    auto const from = istream.readCompressedInt() - 1;
+    auto const to = istream.readCompressedInt() - 1;
+
+    for (auto& snapshot : loaded) {
+        snapshot.name = istream.readString();
+
+        auto const numValues = std::max(0, istream.readCompressedInt());
+        snapshot.kinds.resize(numValues);
+        snapshot.values.resize(numValues);
+
+        for (int i = 0; i < numValues; i++) {
+            snapshot.kinds[i] = static_cast<Kind>(istream.readByte());
+            snapshot.values[i] = istream.readFloat();
+        }
+    }
+
+    {
+        ScopedLock lock(snapshotLock);
+        snapshots = std::move(loaded);
+    }
+
+    currentSnapshot = current;
+    setMorph(from, to);
+    notifyChange();
+}
+
+void Snapshots::notifyChange()
+{
+    MessageManager::callAsync([this]() { onChange(); });
+}
+
+} // namespace pd
@@ -0,0 +1,120 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <vector>
+
+namespace pd {
+
+class Instance;
+
+// Stores the values of every toggle, slider, radio, number box and float atom in the open patches, the host sees these as its programs
+// A snapshot is a flat array of values, in the order the GUIs are found in the patches
+// Recalling one sets the values in pd directly in a single tick, only the GUIs whose value changes get a message
+class Snapshots : private AsyncUpdater {
+public:
+    explicit Snapshots(Instance* instance);
+    ~Snapshots() override;
+
+    // Stores the current GUI values at index, adding empty snapshots before it if needed. Not on the audio thread
+    void store(int index, String const& name = String());
+
+    // Sets the GUIs to the values of a snapshot
+    void recall(int index);
+
+    // Sets the GUIs in between two snapshots, sliders, number boxes and atoms move linearly, toggles and radios switch halfway
+    void interpolate(int from, int to, float position);
+
+    // Picks the two snapshots the morph parameter moves between, or stops morphing if either doesn't exist
+    // The GUIs and the differences between them are found here, so a tick only has to add them up. Message thread only
+    void setMorph(int from, int to);
+
+    // Moves the GUIs to a position between the morph snapshots, if it changed since the last tick
+    // Called on the audio thread before the dsp tick, without holding pd's lock
+    void processMorph(float position);
+
+    // Called with pd's lock held when a patch was edited or closed, the morph stops until setMorph has found the GUIs again
+    void patchChanged();
+
+    void remove(int index);
+    void clear();
+
+    int getNumSnapshots() const;
+    int getCurrentSnapshot() const { return currentSnapshot.load(); }
+
+    String getName(int index) const;
+    void setName(int index, String const& name);
+
+    void write(OutputStream& ostream) const;
+    void read(InputStream& istream);
+
+    // Called on the message thread when snapshots were added, removed, renamed or recalled, so the host can update its program list
+    std::function<void()> onChange = []() {};
+
+private:
+    enum Kind : uint8 {
+        Toggle,
+        Slider,
+        Radio,
+        NumberBox,
+        FloatAtom
+    };
+
+    struct Snapshot {
+        String name;
+        std::vector<Kind> kinds;
+        std::vector<float> values;
+    };
+
+    struct Entry {
+        void* object;
+        Kind kind;
+    };
+
+    struct MorphValue {
+        void* object;
+        Kind kind;
+        float start;
+        float delta;
+        float end;
+    };
+
+    static float getValue(Entry const& entry);
+    static void findGuis(void* canvas, std::vector<Entry>& found);
+
+    // Finds the GUIs of the current instance, the caller needs to hold pd's lock
+    void findEntries();
+
+    void notifyChange();
+
+    void handleAsyncUpdate() override;
+
+    Instance* instance;
+
+    std::vector<Snapshot> snapshots;
+    CriticalSection snapshotLock;
+
+    // Only used with pd's lock held, so its memory is reused between recalls
+    std::vector<Entry> entries;
+
+    std::atomic<int> currentSnapshot = 0;
+
+    // Only used on the audio thread, setMorph hands over new values through the command queue
+    std::vector<MorphValue> morphValues;
+    float lastMorphPosition = -1.0f;
+
+    // The GUI pointers in morphValues are only valid while no patch changed since they were found
+    std::atomic<int> patchGeneration = 0;
+    int morphGeneration = 0;
+
+    int morphFrom = -1;
+    int morphTo = -1;
+};
+
+} // namespace pd
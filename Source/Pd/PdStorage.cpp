@@ -16,8 +16,6 @@ extern "C" {
 #include "g_undo.h"
 #include "x_libpd_extra_utils.h"
 #include "x_libpd_multi.h"
-
-void canvas_map(t_canvas* x, t_floatarg f);
 }
 
 namespace pd {
@@ -26,6 +24,8 @@ Storage::Storage(t_glist* patch, Instance* inst)
     : parentPatch(patch)
     , instance(inst)
 {
+    instance->infoStorages.add(this);
+
     instance->getCallbackLock()->enter();
 
     for (t_gobj* y = patch->gl_list; y; y = y->g_next) {
@@ -86,62 +86,140 @@ Storage::Storage(t_glist* patch, Instance* inst)
     instance->getCallbackLock()->exit();
 }
 
+Storage::~Storage()
+{
+    // The patch might already be closed at this point, so pending changes are not written
+    instance->infoStorages.removeFirstMatchingValue(this);
+}
+
 // Function to load state tree from existing patch, only called on init
+// The info is read straight from the binbuf, so the hidden canvas never has to be mapped
 void Storage::loadInfoFromPatch()
 {
     if (!infoObject)
         return;
 
-    // TODO: fix data race
-    auto* previousCanvas = canvas_getcurrent();
-    if (previousCanvas)
-        canvas_unsetcurrent(previousCanvas);
+    auto* binbuf = reinterpret_cast<t_text*>(infoObject)->te_binbuf;
+    int argc = binbuf_getnatom(binbuf);
+    t_atom* argv = binbuf_getvec(binbuf);
+
+    // Compact format: "plugdatainfo b64:<base64 of a compressed binary ValueTree>"
+    if (argc == 2 && argv[1].a_type == A_SYMBOL) {
+        auto encoded = String::fromUTF8(argv[1].a_w.w_symbol->s_name);
+        if (encoded.startsWith(encodedPrefix)) {
+            auto tree = decodeInfo(encoded.substring(encodedPrefix.length()));
+            if (tree.isValid()) {
+                extraInfo = tree;
+                rebuildInfoIndex();
+            } else {
+                std::cerr << "error loading state" << std::endl;
+            }
 
-    // Make sure the canvas has a window to ensure correct behaviour
-    canvas_setcurrent(infoParent);
-    canvas_vis(infoParent, 1);
-    canvas_map(infoParent, 1);
+            return;
+        }
+    }
 
+    // Older patches store the info as XML text
     char* text;
     int size = 0;
-    libpd_get_object_text(infoObject, &text, &size);
+    binbuf_gettext(binbuf, &text, &size);
 
-    // copy state tree from patch
     String content = String::fromUTF8(text, size).fromFirstOccurrenceOf("plugdatainfo ", false, false);
-
-    canvas_unsetcurrent(infoParent);
-
-    // Set parent to be current again
-    canvas_setcurrent(parentPatch);
-    canvas_map(infoParent, 0);
-    canvas_vis(infoParent, 0);
+    freebytes(static_cast<void*>(text), static_cast<size_t>(size) * sizeof(char));
 
     try {
         auto tree = ValueTree::fromXml(content);
 
         if (tree.isValid()) {
             extraInfo = tree;
+            rebuildInfoIndex();
             return;
         }
     } catch (...) {
-        std::cerr << "error loading state" << std::endl;
     }
 
-    canvas_unsetcurrent(parentPatch);
-    if (previousCanvas)
-        canvas_setcurrent(previousCanvas);
+    std::cerr << "error loading state" << std::endl;
 }
 
-// Function to store state tree in pd patch
+void Storage::rebuildInfoIndex()
+{
+    infoById.clear();
+    infoById.reserve(extraInfo.getNumChildren());
+
+    for (auto child : extraInfo)
+        infoById.emplace(child.getProperty("ID").toString(), child);
+}
+
+ValueTree Storage::findInfo(String const& id) const
+{
+    auto [first, last] = infoById.equal_range(id);
+    if (first == last)
+        return {};
+
+    for (auto it = first; it != last; ++it) {
+        if (it->second.getProperty("Updated") == var(true))
+            return it->second;
+    }
+
+    return first->second;
+}
+
+String Storage::encodeInfo(ValueTree const& tree)
+{
+    MemoryOutputStream stream;
+
+    {
+        GZIPCompressorOutputStream compressed(stream);
+        tree.writeToStream(compressed);
+    }
+
+    return stream.getMemoryBlock().toBase64Encoding();
+}
+
+ValueTree Storage::decodeInfo(String const& encoded)
+{
+    MemoryBlock block;
+    if (!block.fromBase64Encoding(encoded))
+        return {};
+
+    MemoryInputStream istream(block, false);
+    GZIPDecompressorInputStream decompressed(istream);
+    return ValueTree::readFromStream(decompressed);
+}
+
+// Serialising the whole tree is expensive, so changes are collected and written once per message loop iteration
 void Storage::storeInfo()
 {
-    if (!infoObject)
+    infoDirty = true;
+    triggerAsyncUpdate();
+}
+
+void Storage::handleAsyncUpdate()
+{
+    flushInfo();
+}
+
+// Function to store state tree in pd patch
+void Storage::flushInfo()
+{
+    cancelPendingUpdate();
+
+    if (!infoObject || !infoDirty)
         return;
 
-    String newname = "plugdatainfo " + extraInfo.toXmlString(XmlElement::TextFormat().singleLine());
+    infoDirty = false;
+
+    // Written as one symbol atom, so pd doesn't have to tokenise the content
+    auto encoded = encodedPrefix + encodeInfo(extraInfo);
+
+    t_atom atoms[2];
+    SETSYMBOL(atoms, gensym("plugdatainfo"));
+    SETSYMBOL(atoms + 1, gensym(encoded.toRawUTF8()));
 
     // This is likely thread safe because nothing else should access this object
-    binbuf_text((reinterpret_cast<t_text*>(infoObject))->te_binbuf, newname.toRawUTF8(), newname.getNumBytesAsUTF8());
+    auto* binbuf = reinterpret_cast<t_text*>(infoObject)->te_binbuf;
+    binbuf_clear(binbuf);
+    binbuf_add(binbuf, 2, atoms);
 }
 
 // Function to change the id of an entry
@@ -152,10 +230,15 @@ void Storage::setInfoId(String const& oldId, String const& newId)
     if (!infoObject)
         return;
 
-    for (auto s : extraInfo) {
-        if (s.getProperty("ID") == oldId && s.getProperty("Updated") == var(false)) {
+    auto [first, last] = infoById.equal_range(oldId);
+    for (auto it = first; it != last; ++it) {
+        auto s = it->second;
+        if (s.getProperty("Updated") == var(false)) {
             s.setProperty("ID", newId, nullptr);
             s.setProperty("Updated", true, nullptr); // Updated flag in case we temporarily need conflicting IDs
+
+            infoById.erase(it);
+            infoById.emplace(newId, s);
             return;
         }
     }
@@ -171,41 +254,76 @@ void Storage::confirmIds()
 // Check if info exists
 bool Storage::hasInfo(String const& id) const
 {
-    auto child = extraInfo.getChildWithProperty("ID", id);
-    return child.isValid();
+    return infoById.count(id) != 0;
 }
 
 // Get info from local state
 String Storage::getInfo(String const& id, String const& property) const
 {
-    return extraInfo.getChildWithProperty("ID", id).getProperty(property).toString();
+    return findInfo(id).getProperty(property).toString();
 }
 
 // Set info to local state
 // Also pushes the change into pd patch
 void Storage::setInfo(String const& id, String const& property, String const& info, bool undoable)
+{
+    // Nothing changes, so there is nothing to undo or to write either
+    if (getInfo(id, property) == info && hasInfo(id))
+        return;
+
+    if (undoable)
+        createUndoAction();
+
+    setInfoProperty(id, property, info);
+    storeInfo();
+}
+
+void Storage::setInfos(String const& property, std::vector<std::pair<String, String>> const& infos)
+{
+    if (infos.empty())
+        return;
+
+    // Only the changed properties end up in the undo transaction
+    bool changed = std::any_of(infos.begin(), infos.end(), [this, &property](auto const& entry) {
+        return !hasInfo(entry.first) || getInfo(entry.first, property) != entry.second;
+    });
+
+    if (!changed)
+        return;
+
+    createUndoAction();
+
+    for (auto const& [id, info] : infos)
+        setInfoProperty(id, property, info);
+
+    storeInfo();
+}
+
+bool Storage::setInfoProperty(String const& id, String const& property, String const& info)
 {
     jassert(property != "Updated" && property != "ID");
 
     auto tree = ValueTree("InfoObj");
 
-    auto existingInfo = extraInfo.getChildWithProperty("ID", id);
+    auto existingInfo = findInfo(id);
     if (existingInfo.isValid()) {
         tree = existingInfo;
     }
 
     if (!existingInfo.isValid()) {
         extraInfo.appendChild(tree, nullptr);
+        infoById.emplace(id, tree);
     }
 
-    if (undoable)
-        createUndoAction();
+    if (existingInfo.isValid() && existingInfo.getProperty(property).toString() == info)
+        return false;
 
     tree.setProperty("ID", id, nullptr);
     tree.setProperty("Updated", false, nullptr);
-    tree.setProperty(property, info, &undoManager);
 
-    storeInfo();
+    // The undo manager records this as a single property change, not a copy of the tree
+    tree.setProperty(property, info, &undoManager);
+    return true;
 }
 
 // Checks if we're at a storage undo event, and applies undo if needed
@@ -260,37 +378,31 @@ void Storage::createUndoAction()
 // We use this to make ignore this object in the GUI
 bool Storage::isInfoParent(t_gobj* obj)
 {
-    const String name = libpd_get_object_class_name(obj);
-    if (name == "graph" || name == "canvas") {
-        auto* glist = pd_checkglist(&obj->g_pd);
-        return isInfoParent(glist);
-    }
+    // Graphs are canvases too
+    if (pd_class(&obj->g_pd) == canvas_class)
+        return isInfoParent(reinterpret_cast<t_glist*>(obj));
 
     return false;
 }
 
 // Checks if the provided object is the GraphOnParent container for our state (passed as t_glist)
+// This runs for every object when looking up indices, so it only looks at the first atom instead of fetching the text
 bool Storage::isInfoParent(t_glist* glist)
 {
     auto* obj = glist->gl_list;
     // Check if the glist has one object (and not more or less)
-    if (obj != nullptr && obj->g_next == nullptr) {
-        char* text;
-        int size;
+    if (obj == nullptr || obj->g_next != nullptr)
+        return false;
 
-        if (String::fromUTF8(libpd_get_object_class_name(&glist->gl_list->g_pd)) != "text")
-            return false;
+    if (pd_class(&obj->g_pd)->c_name != gensym("text"))
+        return false;
 
-        libpd_get_object_text(glist->gl_list, &text, &size);
+    auto* binbuf = reinterpret_cast<t_text*>(obj)->te_binbuf;
+    if (!binbuf || binbuf_getnatom(binbuf) == 0)
+        return false;
 
-        String name = String::fromUTF8(text, size);
-        freebytes(static_cast<void*>(text), static_cast<size_t>(size) * sizeof(char));
-
-        if (name.startsWith("plugdatainfo")) {
-            return true;
-        }
-    }
-    return false;
+    auto* argv = binbuf_getvec(binbuf);
+    return argv->a_type == A_SYMBOL && !strcmp(argv->a_w.w_symbol->s_name, "plugdatainfo");
 }
 
 } // namespace pd
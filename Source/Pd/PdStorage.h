@@ -8,6 +8,7 @@
 #include <JuceHeader.h>
 
 #include <array>
+#include <unordered_map>
 #include <vector>
 
 extern "C" {
@@ -17,7 +18,7 @@ extern "C" {
 namespace pd {
 
 class Instance;
-class Storage {
+class Storage : private AsyncUpdater {
     t_glist* parentPatch = nullptr;
     Instance* instance = nullptr;
 
@@ -29,11 +30,18 @@ public:
 
     Storage() = delete;
 
+    ~Storage() override;
+
     void setInfoId(String const& oldId, String const& newId);
     void confirmIds();
 
     bool hasInfo(String const& id) const;
+
+    // Marks the info as changed, it gets written into the patch once the current gesture has been handled
     void storeInfo();
+
+    // Writes pending changes into the patch right away, call this before the patch gets saved
+    void flushInfo();
     void loadInfoFromPatch();
 
     void undoIfNeeded();
@@ -47,13 +55,34 @@ public:
     String getInfo(String const& id, String const& property) const;
     void setInfo(String const& id, String const& property, String const& info, bool undoable = true);
 
+    // Sets a property for many ids as a single undoable step, the patch storage is only written once
+    void setInfos(String const& property, std::vector<std::pair<String, String>> const& infos);
+
 private:
     void createObject();
+    // Returns false if the property already had this value
+    bool setInfoProperty(String const& id, String const& property, String const& info);
+
+    void handleAsyncUpdate() override;
+
+    static String encodeInfo(ValueTree const& tree);
+    static ValueTree decodeInfo(String const& encoded);
+
+    // Finds the entry for an id without searching the tree, prefers entries that were just renamed
+    ValueTree findInfo(String const& id) const;
+    void rebuildInfoIndex();
+
+    inline static const String encodedPrefix = "b64:";
 
     UndoManager undoManager;
 
     ValueTree extraInfo = ValueTree("plugdatainfo");
 
+    bool infoDirty = false;
+
+    // Ids can temporarily be used twice while connections are being renamed
+    std::unordered_multimap<String, ValueTree> infoById;
+
     friend class Instance;
     friend class Patch;
 };
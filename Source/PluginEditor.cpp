@@ -95,6 +95,10 @@ PlugDataPluginEditor::PlugDataPluginEditor(PlugDataAudioProcessor& p) : AudioPro
     
     zoomScale.referTo(pd.settingsTree.getPropertyAsValue("Zoom", nullptr));
     zoomScale.addListener(this);
+
+    if(!pd.settingsTree.hasProperty("HardwareAcceleration")) pd.settingsTree.setProperty("HardwareAcceleration", false, nullptr);
+    hardwareAcceleration.referTo(pd.settingsTree.getPropertyAsValue("HardwareAcceleration", nullptr));
+    hardwareAcceleration.addListener(this);
     
     addAndMakeVisible(statusbar);
 
@@ -126,15 +130,27 @@ PlugDataPluginEditor::PlugDataPluginEditor(PlugDataAudioProcessor& p) : AudioPro
         if (cnv->patch.getPointer())
         {
             cnv->patch.setCurrent();
+            pd.setUndoCanvas(cnv->patch.getPointer());
         }
 
-        cnv->synchronise();
+        // Canvases of restored sessions only get built once their tab is opened
+        if (!cnv->loadIfNeeded()) cnv->synchronise();
+        cnv->updateColours();
         cnv->updateGuiValues();
         cnv->updateDrawables();
+
+        // The previous tab stopped showing and this one started
+        for (auto* canvas : canvases) canvas->updateShowingState();
         
         updateCommandStatus();
     };
 
+    // Only the visible tabs keep their objects, the others are built again from the patch once they're opened
+    repaintScheduler.addFrameCallback(this, 1.0, [this]() {
+        unloadHiddenCanvases();
+        return false;
+    });
+
     tabbar.setOutline(0);
     addAndMakeVisible(tabbar);
     addAndMakeVisible(sidebar);
@@ -227,23 +243,45 @@ PlugDataPluginEditor::PlugDataPluginEditor(PlugDataAudioProcessor& p) : AudioPro
     updateCommandStatus();
     
     addChildComponent(zoomLabel);
+    addChildComponent(paintProfilerOverlay);
     
+    // Stop updating the GUI while the editor is hidden, and catch up when it comes back
+    repaintScheduler.onVisibilityChange = [this](bool showing) {
+        pd.guiUpdatesPaused = !showing;
+        statusbar.setUpdatesPaused(!showing);
+        if (showing) {
+            pd.receiveGuiUpdate(1);
+            pd.receiveGuiUpdate(2);
+        }
+    };
+
     // Initialise zoom factor
     valueChanged(zoomScale);
+    valueChanged(hardwareAcceleration);
 }
 PlugDataPluginEditor::~PlugDataPluginEditor()
 {
     setConstrainer(nullptr);
 
+    // Paths that are still being searched won't be needed anymore
+    routingPool.removeAllJobs(true, 1000);
+
+    pd.guiUpdatesPaused = true;
+
     pd.settingsTree.removeListener(this);
     zoomScale.removeListener(this);
     theme.removeListener(this);
+    hardwareAcceleration.removeListener(this);
+
+    openGLContext.detach();
     
     pd.lastTab = tabbar.getCurrentTabIndex();
 }
 
 void PlugDataPluginEditor::paint(Graphics& g)
 {
+    PaintProfiler::ScopedMeasurement paintMeasurement(this);
+
     g.setColour(findColour(PlugDataColour::canvasBackgroundColourId));
     g.fillRoundedRectangle(getLocalBounds().toFloat(), Constants::windowCornerRadius);
     
@@ -276,6 +314,18 @@ void PlugDataPluginEditor::paint(Graphics& g)
     g.drawLine(0.0f, toolbarHeight + rounded, static_cast<float>(getWidth()), toolbarHeight + rounded, 1.0f);
 }
 
+// Painted last, after all children have been drawn
+void PlugDataPluginEditor::paintOverChildren(Graphics& g)
+{
+    PaintProfiler::getInstance().endFrame();
+}
+
+// [canvas.vis] objects follow the editor opening and closing, not only the tabs
+void PlugDataPluginEditor::visibilityChanged()
+{
+    for (auto* canvas : canvases) canvas->updateShowingState();
+}
+
 void PlugDataPluginEditor::resized()
 {
     int roundedOffset = wantsRoundedCorners();
@@ -341,6 +391,8 @@ void PlugDataPluginEditor::resized()
     
     zoomLabel.setTopLeftPosition(5, statusbar.getY() - 28);
     zoomLabel.setSize(55, 23);
+
+    paintProfilerOverlay.setBounds(tabbar.getRight() - PaintProfilerOverlay::preferredWidth - 10, tabbar.getY() + 40, PaintProfilerOverlay::preferredWidth, PaintProfilerOverlay::preferredHeight);
     
     if (auto* cnv = getCurrentCanvas())
     {
@@ -498,6 +550,26 @@ Canvas* PlugDataPluginEditor::getCurrentCanvas()
     return nullptr;
 }
 
+void PlugDataPluginEditor::unloadHiddenCanvases()
+{
+    auto now = Time::getMillisecondCounterHiRes();
+
+    // The current tab doesn't show while the window is minimised or hidden, but it's kept anyway
+    auto* currentCanvas = getCurrentCanvas();
+
+    for (auto* cnv : canvases)
+    {
+        if (cnv == currentCanvas || cnv->isShowing())
+        {
+            cnv->lastShownTime = now;
+        }
+        else if (now - cnv->lastShownTime > canvasUnloadTimeout)
+        {
+            cnv->unload();
+        }
+    }
+}
+
 Canvas* PlugDataPluginEditor::getCanvas(int idx)
 {
     if (auto* viewport = dynamic_cast<Viewport*>(tabbar.getTabContentComponent(idx)))
@@ -511,14 +583,14 @@ Canvas* PlugDataPluginEditor::getCanvas(int idx)
     return nullptr;
 }
 
-void PlugDataPluginEditor::addTab(Canvas* cnv, bool deleteWhenClosed)
+void PlugDataPluginEditor::addTab(Canvas* cnv, bool deleteWhenClosed, bool makeCurrent)
 {
     tabbar.addTab(cnv->patch.getTitle(), findColour(ResizableWindow::backgroundColourId), cnv->viewport, true);
     
 
     int tabIdx = tabbar.getNumTabs() - 1;
 
-    tabbar.setCurrentTabIndex(tabIdx);
+    if (makeCurrent) tabbar.setCurrentTabIndex(tabIdx);
     tabbar.setTabBackgroundColour(tabIdx, Colours::transparentBlack);
 
     auto* tabButton = tabbar.getTabbedButtonBar().getTabButton(tabIdx);
@@ -632,6 +704,7 @@ void PlugDataPluginEditor::valueChanged(Value& v)
             {
                 canvas->hideSuggestions();
                 canvas->setTransform(transform);
+                canvas->zoomChanged(scale);
             }
         }
         if(auto* cnv = getCurrentCanvas()) {
@@ -673,6 +746,20 @@ void PlugDataPluginEditor::valueChanged(Value& v)
         pd.setTheme(static_cast<bool>(theme.getValue()));
         getTopLevelComponent()->repaint();
     }
+    // Switch between the software and OpenGL renderer
+    else if (v.refersToSameSourceAs(hardwareAcceleration))
+    {
+        bool enabled = static_cast<bool>(hardwareAcceleration.getValue());
+        
+        if (enabled && !openGLContext.isAttached())
+        {
+            openGLContext.attachTo(*this);
+        }
+        else if (!enabled && openGLContext.isAttached())
+        {
+            openGLContext.detach();
+        }
+    }
 }
 
 void PlugDataPluginEditor::valueTreePropertyChanged(ValueTree& treeWhosePropertyHasChanged, const Identifier& property)
@@ -733,32 +820,22 @@ void PlugDataPluginEditor::updateCommandStatus()
         auto* patchPtr = cnv->patch.getPointer();
         if (!patchPtr) return;
         
-        auto deletionCheck = SafePointer(this);
-        
         bool locked = static_cast<bool>(cnv->locked.getValue());
 
-        // First on pd's thread, get undo status
-        pd.enqueueFunction(
-            [this, patchPtr, isDragging, deletionCheck, locked]() mutable
-            {
-                if(!deletionCheck) return;
-                
-                canUndo = libpd_can_undo(patchPtr) && !isDragging && !locked;
-                canRedo = libpd_can_redo(patchPtr) && !isDragging && !locked;
-
-                // Set button enablement on message thread
-                MessageManager::callAsync(
-                    [this, deletionCheck]() mutable
-                    {
-                        if(!deletionCheck) return;
-                        
-                        toolbarButton(Undo)->setEnabled(canUndo);
-                        toolbarButton(Redo)->setEnabled(canRedo);
-
-                        // Application commands need to be updated when undo state changes
-                        commandStatusChanged();
-                    });
-            });
+        // Pd publishes the undo state of the current canvas, so we don't need to ask for it
+        bool const newCanUndo = pd.canUndo && !isDragging && !locked;
+        bool const newCanRedo = pd.canRedo && !isDragging && !locked;
+
+        toolbarButton(Undo)->setEnabled(newCanUndo);
+        toolbarButton(Redo)->setEnabled(newCanRedo);
+
+        // Application commands need to be updated when undo state changes
+        if (newCanUndo != canUndo || newCanRedo != canRedo)
+        {
+            canUndo = newCanUndo;
+            canRedo = newCanRedo;
+            commandStatusChanged();
+        }
         
         statusbar.lockButton->setEnabled(true);
         statusbar.presentationButton->setEnabled(true);
@@ -1025,6 +1102,14 @@ void PlugDataPluginEditor::getCommandInfo(const CommandID commandID, Application
             result.setActive(true);
             break;
         }
+        case CommandIDs::TogglePaintProfiler:
+        {
+            result.setInfo("Toggle Paint Profiler", "Show how long painting takes for each kind of component", "View", 0);
+            result.addDefaultKeypress(80, ModifierKeys::commandModifier | ModifierKeys::shiftModifier);
+            result.setTicked(paintProfilerOverlay.isActive());
+            result.setActive(true);
+            break;
+        }
             
         case CommandIDs::NewObject:
         {
@@ -1287,14 +1372,7 @@ bool PlugDataPluginEditor::perform(const InvocationInfo& info)
         case CommandIDs::ConnectionPathfind:
         {
             statusbar.connectionStyleButton->setToggleState(true, sendNotification);
-            for (auto* con : cnv->connections)
-            {
-                if (cnv->isSelected(con))
-                {
-                    con->findPath();
-                    con->updatePath();
-                }
-            }
+            cnv->findPaths(cnv->getSelectionOfType<Connection>());
 
             return true;
         }
@@ -1361,6 +1439,12 @@ bool PlugDataPluginEditor::perform(const InvocationInfo& info)
             
             return true;
         }
+        case CommandIDs::TogglePaintProfiler:
+        {
+            paintProfilerOverlay.setActive(!paintProfilerOverlay.isActive());
+            paintProfilerOverlay.toFront(false);
+            return true;
+        }
             
         case CommandIDs::NewArray:
         {
@@ -12,6 +12,8 @@
 #include "Sidebar/Sidebar.h"
 #include "Statusbar.h"
 #include "Tabbar.h"
+#include "Utility/RepaintScheduler.h"
+#include "Utility/PaintProfiler.h"
 
 enum CommandIDs
 {
@@ -65,6 +67,7 @@ enum CommandIDs
     NewNumboxTilde,
     NewOscilloscope,
     NewFunction,
+    TogglePaintProfiler,
     NumItems
 };
 
@@ -119,8 +122,10 @@ class PlugDataPluginEditor : public AudioProcessorEditor, public Value::Listener
     ~PlugDataPluginEditor() override;
 
     void paint(Graphics& g) override;
+    void paintOverChildren(Graphics& g) override;
 
     void resized() override;
+    void visibilityChanged() override;
 
     void mouseWheelMove(const MouseEvent& e, const MouseWheelDetails& wheel) override;
     void mouseMagnify(const MouseEvent& e, float scaleFactor) override;
@@ -138,7 +143,7 @@ class PlugDataPluginEditor : public AudioProcessorEditor, public Value::Listener
     void saveProject(const std::function<void()>& nestedCallback = []() {});
     void saveProjectAs(const std::function<void()>& nestedCallback = []() {});
 
-    void addTab(Canvas* cnv, bool deleteWhenClosed = false);
+    void addTab(Canvas* cnv, bool deleteWhenClosed = false, bool makeCurrent = true);
 
     Canvas* getCurrentCanvas();
     Canvas* getCanvas(int idx);
@@ -149,6 +154,9 @@ class PlugDataPluginEditor : public AudioProcessorEditor, public Value::Listener
 
     void updateCommandStatus();
 
+    // Unloads the canvases of tabs that haven't been shown for a while
+    void unloadHiddenCanvases();
+
     ApplicationCommandTarget* getNextCommandTarget() override;
     void getAllCommands(Array<CommandID>& commands) override;
     void getCommandInfo(const CommandID commandID, ApplicationCommandInfo& result) override;
@@ -171,6 +179,12 @@ class PlugDataPluginEditor : public AudioProcessorEditor, public Value::Listener
 
     AffineTransform transform;
 
+    // Needs to outlive the canvases, their objects unregister from it when they're deleted
+    RepaintScheduler repaintScheduler = RepaintScheduler(this);
+
+    // Routes the connections of all canvases, the jobs only hand their results back through SafePointers
+    ThreadPool routingPool = ThreadPool(2);
+
     TabComponent tabbar;
     OwnedArray<Canvas, CriticalSection> canvases;
     Sidebar sidebar;
@@ -185,6 +199,7 @@ class PlugDataPluginEditor : public AudioProcessorEditor, public Value::Listener
 
     Value hvccMode;
     Value autoconnect;
+    Value hardwareAcceleration;
     
    private:
     
@@ -204,12 +219,20 @@ class PlugDataPluginEditor : public AudioProcessorEditor, public Value::Listener
     TextButton seperators[8];
     
     ZoomLabel zoomLabel;
+
+    PaintProfilerOverlay paintProfilerOverlay;
+
+    // Renders the editor on the GPU when hardware acceleration is enabled
+    OpenGLContext openGLContext;
     
 #if PLUGDATA_STANDALONE && JUCE_MAC
     Rectangle<int> unmaximisedSize;
 #endif
     
     bool isMaximised = false;
+
+    // Time in milliseconds that a tab has to be hidden before its canvas gets unloaded
+    static constexpr double canvasUnloadTimeout = 5 * 60 * 1000.0;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlugDataPluginEditor)
 };
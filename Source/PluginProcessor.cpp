@@ -12,6 +12,7 @@
 #endif
 
 #include <clocale>
+#include <bit>
 #include "PluginProcessor.h"
 
 #include "Canvas.h"
@@ -19,13 +20,89 @@
 #include "LookAndFeel.h"
 
 #include "Utility/PluginParameter.h"
+#include "Utility/RealtimeChecker.h"
+#include "Utility/Tracer.h"
 
 extern "C"
 {
     #include "x_libpd_extra_utils.h"
+    #include "x_libpd_param.h"
     EXTERN char* pd_version;
 }
 
+// Extracts the bundled filesystem on a background thread, so creating a plugin doesn't have to wait for it
+// Abstractions come first, because patches can't be opened without them. The documentation follows after
+struct FilesystemExtractor : public Thread
+{
+    explicit FilesystemExtractor(File const& target) : Thread("Filesystem Extractor"), appDir(target)
+    {
+        startThread();
+    }
+
+    ~FilesystemExtractor() override
+    {
+        stopThread(10000);
+    }
+
+    void run() override
+    {
+        MemoryInputStream binaryFilesystem(BinaryData::Filesystem_zip, BinaryData::Filesystem_zipSize, false);
+        ZipFile zip(binaryFilesystem);
+
+        extractEntries(zip, true);
+        abstractionsExtracted.signal();
+
+        extractEntries(zip, false);
+
+        // Only remove the marker when we weren't interrupted, otherwise we'll extract again on next startup
+        if (!threadShouldExit())
+        {
+            appDir.getChildFile(inProgressMarker).deleteFile();
+        }
+    }
+
+    // The zip stores everything inside "plugdata_version", which becomes the versioned app directory
+    void extractEntries(ZipFile& zip, bool abstractions)
+    {
+        for (int i = 0; i < zip.getNumEntries() && !threadShouldExit(); i++)
+        {
+            auto const* entry = zip.getEntry(i);
+            auto const path = entry->filename.fromFirstOccurrenceOf("plugdata_version/", false, false);
+
+            if (path.isEmpty() || path.startsWith("Abstractions/") != abstractions) continue;
+
+            auto target = appDir.getChildFile(path);
+            if (path.endsWithChar('/'))
+            {
+                target.createDirectory();
+                continue;
+            }
+
+            if (std::unique_ptr<InputStream> input(zip.createStreamForEntry(i)); input)
+            {
+                target.getParentDirectory().createDirectory();
+                target.deleteFile();
+
+                FileOutputStream output(target);
+                output.writeFromInputStream(*input, -1);
+            }
+        }
+    }
+
+    void waitForAbstractions()
+    {
+        abstractionsExtracted.wait();
+    }
+
+    static inline const String inProgressMarker = ".extracting";
+
+    File appDir;
+    WaitableEvent abstractionsExtracted = WaitableEvent(true);
+};
+
+// Shared by all plugin instances in this process
+static std::unique_ptr<FilesystemExtractor> filesystemExtractor;
+
 AudioProcessor::BusesProperties PlugDataAudioProcessor::buildBusesProperties()
 {
     AudioProcessor::BusesProperties busesProperties;
@@ -56,21 +133,30 @@ PlugDataAudioProcessor::PlugDataAudioProcessor()
     std::setlocale(LC_ALL, "C");
 
     // continuityChecker keeps track of whether audio is running and creates a backup scheduler in case it isn't
-    /*
-    continuityChecker.setCallback([this](t_float* in, t_float* out){
+    continuityChecker.setCallback([this](t_sample* in, t_sample* out)
+        {
+            // The host holds the callback lock while processing, if it's busy the host is back
+            if (!getCallbackLock()->tryEnter()) return false;
 
-        if(isNonRealtime()) return;
+            // While suspended, we're in the middle of changing the patches or audio settings
+            if (continuityChecker.isHostRunning() || isSuspended())
+            {
+                getCallbackLock()->exit();
+                return false;
+            }
 
-        if(getCallbackLock()->tryEnter()) {
+            // Like prepareTick, without the host's midi and playhead, which are from the last block it processed
+            setThis();
+            startBlock();
+            sendMessagesFromQueue(true);
+            dispatchOscMessages();
+            sendParameters();
 
-            // Dequeue messages
-            sendMessagesFromQueue();
+            performDSP(in, out);
 
-            libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
-            libpd_process_nodsp();
             getCallbackLock()->exit();
-        }
-    }); */
+            return true;
+        });
 
     parameters.createAndAddParameter(std::make_unique<AudioParameterFloat>(ParameterID("volume", 1), "Volume", NormalisableRange<float>(0.0f, 1.0f, 0.001f, 0.75f, false), 1.0f));
 
@@ -86,7 +172,11 @@ PlugDataAudioProcessor::PlugDataAudioProcessor()
         parameter->addListener(this);
     }
 
+    // Moves all GUIs between the two snapshots picked with [; pd~snapshot morph <from> <to>(
+    parameters.createAndAddParameter(std::make_unique<AudioParameterFloat>(ParameterID("morph", 1), "Snapshot Morph", 0.0f, 1.0f, 0.0f));
+
     volume = parameters.getRawParameterValue("volume");
+    morph = parameters.getRawParameterValue("morph");
 
     // Make sure that the parameter valuetree has a name, to prevent assertion failures
     parameters.replaceState(ValueTree("plugdata"));
@@ -104,21 +194,53 @@ PlugDataAudioProcessor::PlugDataAudioProcessor()
         objectLibrary.initialiseLibrary();
     }
 
-    channelPointers.reserve(32);
+    channelPointers.reserve(maxChannels);
 
     // Set up midi buffers
     midiBufferIn.ensureSize(2048);
     midiBufferOut.ensureSize(2048);
     midiBufferTemp.ensureSize(2048);
-    midiBufferCopy.ensureSize(2048);
 
-    atoms_playhead.reserve(3);
-    atoms_playhead.resize(1);
+    setThis();
+    for (int n = 0; n < numParameters; n++)
+    {
+        parameterSymbols[n] = gensym(("param" + String(n + 1)).toRawUTF8());
+    }
+
+    latencyOutSymbol = gensym("pd~latency~out");
+
+    playheadSymbols = { gensym("playhead"), gensym("playing"), gensym("recording"), gensym("looping"), gensym("edittime"), gensym("framerate"), gensym("bpm"), gensym("lastbar"), gensym("timesig"), gensym("position") };
 
     setCallbackLock(&AudioProcessor::getCallbackLock());
 
+    // The host's program list shows the snapshots
+    snapshots.onChange = [this]()
+    {
+        updateHostDisplay(ChangeDetails().withProgramChanged(true));
+    };
+
     sendMessagesFromQueue();
 
+    // Abstractions that were edited outside of plugdata shouldn't be loaded from the patch cache anymore
+    // The cache also compares modification times, this makes sure it doesn't keep files that won't be used again
+    objectLibrary.patchFileChanged = [this](File const& file)
+    {
+        auto path = file.getFullPathName().replaceCharacter('\\', '/');
+        enqueueFunction([path]()
+            {
+                libpd_patchcache_invalidate(path.isEmpty() ? nullptr : path.toRawUTF8());
+            });
+    };
+
+    // Externals and abstractions that got installed or removed change what object names resolve to
+    objectLibrary.libraryFilesChanged = [this]()
+    {
+        enqueueFunction([]()
+            {
+                libpd_pathcache_invalidate();
+            });
+    };
+
     objectLibrary.appDirChanged = [this]()
     {
         // If we changed the settings from within the app, don't reload
@@ -152,6 +274,7 @@ PlugDataAudioProcessor::PlugDataAudioProcessor()
             }
             
             setTheme(static_cast<bool>(settingsTree.getProperty("Theme")));
+            updateConsoleLogging();
         }
 
         settingsChangedInternally = false;
@@ -170,9 +293,28 @@ PlugDataAudioProcessor::PlugDataAudioProcessor()
         oversampling = static_cast<int>(settingsTree.getProperty("Oversampling"));
     }
 
+    if(settingsTree.hasProperty("OversamplingFilter")) {
+        oversamplingFilter = static_cast<int>(settingsTree.getProperty("OversamplingFilter"));
+    }
+
+    if(settingsTree.hasProperty("PdBlockSize")) {
+        pdBlockSize = static_cast<int>(settingsTree.getProperty("PdBlockSize"));
+    }
+
+    if(settingsTree.hasProperty("SampleAccurateMidi")) {
+        sampleAccurateMidi = static_cast<bool>(settingsTree.getProperty("SampleAccurateMidi"));
+    }
+
+    if(settingsTree.hasProperty("AutoSleep")) {
+        autoSleep = static_cast<bool>(settingsTree.getProperty("AutoSleep"));
+    }
+
     updateSearchPaths();
+    updateConsoleLogging();
+
+    journal.setDirectory(homeDir.getChildFile("Recovery"));
 
-    setLatencySamples(pd::Instance::getBlockSize());
+    setLatency(pdBlockSize);
 
     logMessage("plugdata v" + String(ProjectInfo::versionString));
     logMessage("Based on " + String(pd_version).upToFirstOccurrenceOf("(", false, false));
@@ -188,6 +330,9 @@ PlugDataAudioProcessor::PlugDataAudioProcessor()
 
 PlugDataAudioProcessor::~PlugDataAudioProcessor()
 {
+    // The backup scheduler calls into the processor, which is destroyed before the instance it belongs to
+    continuityChecker.release();
+
     // Save current settings before quitting
     saveSettings();
 }
@@ -197,14 +342,15 @@ PlugDataAudioProcessor::~PlugDataAudioProcessor()
 void PlugDataAudioProcessor::initialiseFilesystem()
 {
     // Check if the abstractions directory exists, if not, unzip it from binaryData
-    if (!homeDir.exists() || !abstractions.exists())
+    // The marker stays in place until the extraction is complete, so an interrupted extraction gets restarted
+    auto const extractionMarker = appDir.getChildFile(FilesystemExtractor::inProgressMarker);
+    if (!filesystemExtractor && (!homeDir.exists() || !abstractions.exists() || extractionMarker.existsAsFile()))
     {
-        MemoryInputStream binaryFilesystem(BinaryData::Filesystem_zip, BinaryData::Filesystem_zipSize, false);
-        auto file = ZipFile(binaryFilesystem);
-        file.uncompressTo(homeDir);
-
         // Create filesystem for this specific version
-        homeDir.getChildFile("plugdata_version").moveFileTo(appDir);
+        appDir.createDirectory();
+        extractionMarker.create();
+
+        filesystemExtractor = std::make_unique<FilesystemExtractor>(appDir);
 
         auto library = homeDir.getChildFile("Library");
         auto deken = homeDir.getChildFile("Deken");
@@ -407,6 +553,9 @@ void PlugDataAudioProcessor::updateSearchPaths()
         libpd_add_to_search_path(path.toRawUTF8());
     }
 
+    // Names that weren't found before might be in one of the new paths
+    libpd_pathcache_invalidate();
+
     getCallbackLock()->exit();
 }
 
@@ -446,26 +595,32 @@ double PlugDataAudioProcessor::getTailLengthSeconds() const
 
 int PlugDataAudioProcessor::getNumPrograms()
 {
-    return 1;  // NB: some hosts don't cope very well if you tell them there are 0 programs,
-    // so this should be at least 1, even if you're not really implementing programs.
+    // NB: some hosts don't cope very well if you tell them there are 0 programs,
+    // so this should be at least 1, even if there are no snapshots
+    return std::max(1, snapshots.getNumSnapshots());
 }
 
 int PlugDataAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return snapshots.getCurrentSnapshot();
 }
 
 void PlugDataAudioProcessor::setCurrentProgram(int index)
 {
+    snapshots.recall(index);
 }
 
 const String PlugDataAudioProcessor::getProgramName(int index)
 {
-    return "Init preset";
+    if (snapshots.getNumSnapshots() == 0)
+        return "Init preset";
+
+    return snapshots.getName(index);
 }
 
 void PlugDataAudioProcessor::changeProgramName(int index, const String& newName)
 {
+    snapshots.setName(index, newName);
 }
 
 void PlugDataAudioProcessor::setOversampling(int amount)
@@ -482,18 +637,204 @@ void PlugDataAudioProcessor::setOversampling(int amount)
     suspendProcessing(false);
 }
 
+void PlugDataAudioProcessor::setOversamplingFilter(int filterType)
+{
+    settingsTree.setProperty("OversamplingFilter", var(filterType), nullptr);
+    saveSettings();
+
+    oversamplingFilter = filterType;
+
+    suspendProcessing(true);
+    prepareToPlay(AudioProcessor::getSampleRate(), AudioProcessor::getBlockSize());
+    suspendProcessing(false);
+}
+
+void PlugDataAudioProcessor::setLatency(int samples)
+{
+    userLatency = samples;
+    updateLatency();
+}
+
+int PlugDataAudioProcessor::getLatency() const
+{
+    return userLatency;
+}
+
+void PlugDataAudioProcessor::updateLatency()
+{
+    // Buffering by the pd blocks, the oversampling filters and whatever the patches declared
+    auto const patchSamples = roundToInt(patchLatency.load() / static_cast<float>(1 << oversampling));
+    auto const total = userLatency + oversamplingLatency + patchSamples;
+
+    if (total != getLatencySamples())
+    {
+        setLatencySamples(total);
+        receiveLatencyQuery();
+    }
+}
+
+void PlugDataAudioProcessor::receivePatchLatency(String const& source, float samples)
+{
+    MessageManager::callAsync([this, source, samples]() mutable
+        {
+            // Sending 0 removes a source again
+            if (samples > 0)
+                patchLatencies[source] = samples;
+            else
+                patchLatencies.erase(source);
+
+            float total = 0.0f;
+            for (auto const& [name, latency] : patchLatencies)
+                total += latency;
+
+            patchLatency = total;
+            updateLatency();
+        });
+}
+
+void PlugDataAudioProcessor::receiveLatencyQuery()
+{
+    t_atom atom;
+    SETFLOAT(&atom, getLatencySamples());
+    enqueueMessage(latencyOutSymbol, &s_float, 1, &atom);
+}
+
+void PlugDataAudioProcessor::receiveRecordMessage(String const& action, String const& file, int bus)
+{
+    MessageManager::callAsync([this, action, file, bus]()
+        {
+            // Relative paths and recordings without a name go to the recordings folder
+            auto const recordings = homeDir.getChildFile("Recordings");
+            auto const target = file.isEmpty() ? File() : recordings.getChildFile(file);
+
+            if (action == "stop")
+            {
+                auto const dropped = recorder.getNumDroppedSamples();
+                recorder.stop(target);
+
+                if (dropped > 0)
+                    logWarning("pd~record: " + String(dropped) + " samples were dropped because the disk couldn't keep up");
+                return;
+            }
+
+            if (action != "start")
+            {
+                logError("pd~record: unknown message " + action);
+                return;
+            }
+
+            int firstChannel = 0;
+            int numChannels = getTotalNumOutputChannels();
+
+            // Taps a single output bus, the channels of the buses follow each other in the buffer
+            if (bus > 0)
+            {
+                auto* outputBus = getBus(false, bus - 1);
+                if (!outputBus || !outputBus->isEnabled())
+                {
+                    logError("pd~record: output bus " + String(bus) + " isn't enabled");
+                    return;
+                }
+
+                firstChannel = outputBus->getChannelIndexInProcessBlockBuffer(0);
+                numChannels = outputBus->getNumberOfChannels();
+            }
+
+            auto const destination = target == File() ? recordings.getChildFile("Recording " + Time::getCurrentTime().formatted("%Y-%m-%d %H.%M.%S") + ".wav") : target;
+            auto const error = recorder.start(destination, AudioProcessor::getSampleRate(), firstChannel, numChannels);
+
+            if (error.isNotEmpty())
+                logError("pd~record: " + error);
+            else
+                logMessage("Recording to " + destination.getFullPathName());
+        });
+}
+
+dsp::Oversampling<t_sample>* PlugDataAudioProcessor::getOversampler(int factor, int numChannels, int maxBlockSize)
+{
+    // Existing oversamplers can only be reused if they were made for the same configuration
+    if (numChannels != oversamplerNumChannels || maxBlockSize != oversamplerBlockSize || oversamplingFilter != oversamplerFilter)
+    {
+        for (auto& cached : oversamplers) cached.reset();
+
+        oversamplerNumChannels = numChannels;
+        oversamplerBlockSize = maxBlockSize;
+        oversamplerFilter = oversamplingFilter;
+    }
+
+    auto& cached = oversamplers[factor];
+    if (!cached)
+    {
+        auto filterType = oversamplingFilter == 0 ? dsp::Oversampling<t_sample>::filterHalfBandPolyphaseIIR : dsp::Oversampling<t_sample>::filterHalfBandFIREquiripple;
+        cached = std::make_unique<dsp::Oversampling<t_sample>>(numChannels, factor, filterType, oversamplingFilter == 2, false);
+        cached->initProcessing(maxBlockSize);
+    }
+    else
+    {
+        cached->reset();
+    }
+
+    return cached.get();
+}
+
+void PlugDataAudioProcessor::setPdBlockSize(int blockSize)
+{
+    settingsTree.setProperty("PdBlockSize", var(blockSize), nullptr);
+    saveSettings();
+
+    pdBlockSize = blockSize;
+
+    // Audio is delayed by at least one pd block
+    if (getLatency() < pdBlockSize)
+    {
+        setLatency(pdBlockSize);
+    }
+
+    suspendProcessing(true);
+    prepareToPlay(AudioProcessor::getSampleRate(), AudioProcessor::getBlockSize());
+    suspendProcessing(false);
+}
+
+void PlugDataAudioProcessor::setSampleAccurateMidi(bool enabled)
+{
+    settingsTree.setProperty("SampleAccurateMidi", var(enabled), nullptr);
+    saveSettings();
+
+    sampleAccurateMidi = enabled;
+}
+
+void PlugDataAudioProcessor::setAutoSleep(bool enabled)
+{
+    settingsTree.setProperty("AutoSleep", var(enabled), nullptr);
+    saveSettings();
+
+    autoSleep = enabled;
+}
+
 void PlugDataAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
     float oversampleFactor = 1 << oversampling;
     auto maxChannels = std::max(getTotalNumInputChannels(), getTotalNumOutputChannels());
 
-    prepareDSP(getTotalNumInputChannels(), getTotalNumOutputChannels(), sampleRate * oversampleFactor, samplesPerBlock * oversampleFactor);
+    prepareDSP(getTotalNumInputChannels(), getTotalNumOutputChannels(), sampleRate * oversampleFactor, samplesPerBlock * oversampleFactor, pdBlockSize);
+
+    oversampler = getOversampler(oversampling, maxChannels, samplesPerBlock);
 
-    oversampler.reset (new dsp::Oversampling<float> (maxChannels, oversampling, dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, false));
+    oversamplingLatency = oversampling > 0 ? roundToInt(oversampler->getLatencyInSamples()) : 0;
+    updateLatency();
 
-    oversampler->initProcessing (samplesPerBlock);
+    // Buses are laid out one after another in the host buffer, disabled buses don't have any channels
+    channelPointers.assign(std::max(getTotalNumInputChannels(), getTotalNumOutputChannels()), nullptr);
+
+#if PD_FLOATSIZE == 64
+    conversionBuffer.setSize(maxChannels, samplesPerBlock);
+#endif
 
     audioAdvancement = 0;
+    stagingBufferOutdated = false;
+    lastPlayheadReceiver = nullptr;
+    silentSamples = 0;
+    sleeping = false;
     const auto blksize = static_cast<size_t>(Instance::getBlockSize());
     const auto numIn = static_cast<size_t>(getTotalNumInputChannels());
     const auto nouts = static_cast<size_t>(getTotalNumOutputChannels());
@@ -510,9 +851,11 @@ void PlugDataAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBloc
     midiByteBuffer[1] = 0;
     midiByteBuffer[2] = 0;
 
+    recorder.prepare(getTotalNumOutputChannels(), samplesPerBlock);
+
     startDSP();
 
-    statusbarSource.prepareToPlay(getTotalNumOutputChannels());
+    statusbarSource.prepareToPlay(getTotalNumOutputChannels(), sampleRate);
 }
 
 void PlugDataAudioProcessor::releaseResources()
@@ -553,33 +896,89 @@ bool PlugDataAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts)
         ninch += nchb;
     }
 
-    return ninch <= 32 && noutch <= 32;
+    return ninch <= maxChannels && noutch <= maxChannels;
 }
 
 
 
 void PlugDataAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
 {
+#if PD_FLOATSIZE == 64
+    conversionBuffer.makeCopyOf(buffer, true);
+    processSamples(conversionBuffer, midiMessages);
+    buffer.makeCopyOf(conversionBuffer, true);
+#else
+    processSamples(buffer, midiMessages);
+#endif
+}
+
+#if PD_FLOATSIZE == 64
+void PlugDataAudioProcessor::processBlock(AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
+{
+    processSamples(buffer, midiMessages);
+}
+#endif
+
+void PlugDataAudioProcessor::processSamples(AudioBuffer<t_sample>& buffer, MidiBuffer& midiMessages)
+{
+    TRACE_ZONE("processBlock");
+    RealtimeChecker::ScopedAudioCallback realtimeCheck(this);
+    StatusbarSource::ScopedLoadMeasurement loadMeasurement(statusbarSource, buffer.getNumSamples());
+
     ScopedNoDenormals noDenormals;
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
-    //continuityChecker.setNonRealtime(isNonRealtime());
-    //continuityChecker.setTimer();
+    continuityChecker.setNonRealtime(isNonRealtime());
+    continuityChecker.audioCallbackStarted();
 
     setThis();
-    
+
+    bool const nonRealtime = isNonRealtime();
+    if (nonRealtime != bouncing)
+    {
+        bouncing = nonRealtime;
+
+        // Catch up on the GUI changes that were skipped during the render
+        if (!nonRealtime)
+        {
+            receiveGuiUpdate(1);
+        }
+    }
+
+    // The host waits for us anyway, so everything that's queued gets applied before rendering
+    if (bouncing)
+    {
+        sendMessagesFromQueue();
+        sendPlayhead();
+    }
+
     for (int i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
     {
         buffer.clear(i, 0, buffer.getNumSamples());
     }
 
-    midiBufferCopy.clear();
-    midiBufferCopy.addEvents(midiMessages, 0, buffer.getNumSamples(), audioAdvancement);
+    statusbarSource.processMidiInput(midiMessages);
+
+    // Any input, midi or message wakes pd up again
+    bool const canSleep = autoSleep && midiMessages.isEmpty() && !hasPendingMessages() && isSilent(buffer, 0, totalNumInputChannels);
+    if (!canSleep)
+    {
+        silentSamples = 0;
+        sleeping = false;
+    }
+    else if (sleeping)
+    {
+        buffer.clear();
+        recorder.process(buffer);
+        if (!guiUpdatesPaused) statusbarSource.processBlock(buffer, midiMessages, totalNumOutputChannels);
+        return;
+    }
 
-    auto targetBlock = dsp::AudioBlock<float>(buffer);
+    auto targetBlock = dsp::AudioBlock<t_sample>(buffer);
     auto blockOut = oversampling > 0 ? oversampler->processSamplesUp(targetBlock) : targetBlock;
 
+    sendParameterRamps(static_cast<int>(blockOut.getNumSamples()));
     process(blockOut, midiMessages);
 
     if(oversampling > 0) {
@@ -587,7 +986,25 @@ void PlugDataAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer
     }
 
     buffer.applyGain(getParameters()[0]->getValue());
-    statusbarSource.processBlock(buffer, midiBufferCopy, midiMessages, totalNumOutputChannels);
+
+    // Once input and output stayed silent for longer than the tail, stop running pd until something happens
+    if (canSleep && isSilent(buffer, 0, totalNumOutputChannels))
+    {
+        silentSamples += buffer.getNumSamples();
+
+        auto const sleepDelay = (static_cast<float>(tailLength.getValue()) + autoSleepDelay) * AudioProcessor::getSampleRate();
+        sleeping = silentSamples > sleepDelay;
+    }
+    else
+    {
+        silentSamples = 0;
+    }
+
+    // Only copies into the recorder's FIFOs, the files are written on its own thread
+    recorder.process(buffer);
+
+    // The levels and midi activity are only shown by the statusbar
+    if (!guiUpdatesPaused) statusbarSource.processBlock(buffer, midiMessages, totalNumOutputChannels);
 
 #if PLUGDATA_STANDALONE
     for(auto* midiOutput : midiOutputs) {
@@ -598,36 +1015,41 @@ void PlugDataAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer
 #endif
 }
 
-void PlugDataAudioProcessor::process(dsp::AudioBlock<float> buffer, MidiBuffer& midiMessages)
+void PlugDataAudioProcessor::process(dsp::AudioBlock<t_sample> buffer, MidiBuffer& midiMessages)
 {
     ScopedNoDenormals noDenormals;
     const int blockSize = Instance::getBlockSize();
     const int numSamples = static_cast<int>(buffer.getNumSamples());
-    const int adv = audioAdvancement >= 64 ? 0 : audioAdvancement;
+    const int adv = audioAdvancement >= blockSize ? 0 : audioAdvancement;
     const int numLeft = blockSize - adv;
     const int numIn = getTotalNumInputChannels();
     const int numOut = getTotalNumOutputChannels();
 
-    channelPointers.clear();
-    for(int ch = 0; ch < std::min<int>(std::max(numIn, numOut), buffer.getNumChannels()); ch++) {
-        channelPointers.push_back(buffer.getChannelPointer(ch));
+    // pd can only read and write the host channels directly when a block is a single tick
+    const bool canProcessDirect = blockSize == libpd_blocksize();
+
+    // The table is sized in prepareToPlay, only the pointers change between callbacks
+    // Every output channel is fully overwritten below, so output-only channels don't need to be cleared first
+    if (channelPointers.size() > buffer.getNumChannels())
+    {
+        channelPointers.resize(buffer.getNumChannels());
+    }
+    for (size_t ch = 0; ch < channelPointers.size(); ch++)
+    {
+        channelPointers[ch] = buffer.getChannelPointer(ch);
     }
 
     const bool midiConsume = acceptsMidi();
     const bool midiProduce = producesMidi();
 
-    auto const maxOuts = std::max(numOut, std::max(numIn, numOut));
-    for (int ch = numIn; ch < maxOuts; ch++)
-    {
-        buffer.getSingleChannelBlock(ch).clear();
-    }
-
     // If the current number of samples in this block
     // is inferior to the number of samples required
     if (numSamples < numLeft)
     {
         // we save the input samples and we output
         // the missing samples of the previous tick.
+        syncStagingBuffer();
+
         for (int j = 0; j < numIn; ++j)
         {
             const int index = j * blockSize + adv;
@@ -663,51 +1085,75 @@ void PlugDataAudioProcessor::process(dsp::AudioBlock<float> buffer, MidiBuffer&
             midiMessages.clear();
         }
 
-        for (int j = 0; j < numIn; ++j)
-        {
-            const int index = j * blockSize + adv;
-            FloatVectorOperations::copy(audioBufferIn.data() + index, channelPointers[j], numLeft);
-        }
-        for (int j = 0; j < numOut; ++j)
-        {
-            const int index = j * blockSize + adv;
-            FloatVectorOperations::copy(channelPointers[j], audioBufferOut.data() + index, numLeft);
-        }
-        if (midiConsume)
+        if (adv == 0 && canProcessDirect)
         {
-            midiBufferIn.addEvents(midiin, 0, numLeft, adv);
+            // The whole tick lies inside the host buffer, so pd can read and write the channels directly
+            if (midiConsume)
+            {
+                midiBufferIn.addEvents(midiin, 0, blockSize, 0);
+            }
+            if (midiProduce)
+            {
+                midiMessages.addEvents(midiBufferOut, 0, blockSize, 0);
+            }
+            processInternalDirect(0);
         }
-        if (midiProduce)
+        else
         {
-            midiMessages.addEvents(midiBufferOut, adv, numLeft, -adv);
-        }
-        audioAdvancement = 0;
-        processInternal();
+            syncStagingBuffer();
 
-        // If there are other DSP ticks that can be
-        // performed, then we do it now.
-        int pos = numLeft;
-        while ((pos + blockSize) <= numSamples)
-        {
             for (int j = 0; j < numIn; ++j)
             {
-                const int index = j * blockSize;
-                FloatVectorOperations::copy(audioBufferIn.data() + index, channelPointers[j] + pos, blockSize);
+                const int index = j * blockSize + adv;
+                FloatVectorOperations::copy(audioBufferIn.data() + index, channelPointers[j], numLeft);
             }
             for (int j = 0; j < numOut; ++j)
             {
-                const int index = j * blockSize;
-                FloatVectorOperations::copy(channelPointers[j] + pos, audioBufferOut.data() + index, blockSize);
+                const int index = j * blockSize + adv;
+                FloatVectorOperations::copy(channelPointers[j], audioBufferOut.data() + index, numLeft);
             }
             if (midiConsume)
             {
-                midiBufferIn.addEvents(midiin, pos, blockSize, 0);
+                midiBufferIn.addEvents(midiin, 0, numLeft, adv);
             }
             if (midiProduce)
             {
-                midiMessages.addEvents(midiBufferOut, 0, blockSize, pos);
+                midiMessages.addEvents(midiBufferOut, adv, numLeft, -adv);
             }
+            audioAdvancement = 0;
             processInternal();
+        }
+
+        // If there are other DSP ticks that can be
+        // performed, then we do it now. These ticks never
+        // straddle the host buffer, so single ticks skip the staging buffers.
+        int pos = numLeft;
+        while ((pos + blockSize) <= numSamples)
+        {
+            if (midiConsume)
+            {
+                midiBufferIn.addEvents(midiin, pos, blockSize, -pos);
+            }
+            if (midiProduce)
+            {
+                midiMessages.addEvents(midiBufferOut, 0, blockSize, pos);
+            }
+            if (canProcessDirect)
+            {
+                processInternalDirect(pos);
+            }
+            else
+            {
+                for (int j = 0; j < numIn; ++j)
+                {
+                    FloatVectorOperations::copy(audioBufferIn.data() + j * blockSize, channelPointers[j] + pos, blockSize);
+                }
+                for (int j = 0; j < numOut; ++j)
+                {
+                    FloatVectorOperations::copy(channelPointers[j] + pos, audioBufferOut.data() + j * blockSize, blockSize);
+                }
+                processInternal();
+            }
             pos += blockSize;
         }
 
@@ -717,6 +1163,8 @@ void PlugDataAudioProcessor::process(dsp::AudioBlock<float> buffer, MidiBuffer&
         const int remaining = numSamples - pos;
         if (remaining > 0)
         {
+            syncStagingBuffer();
+
             for (int j = 0; j < numIn; ++j)
             {
                 const int index = j * blockSize;
@@ -729,7 +1177,7 @@ void PlugDataAudioProcessor::process(dsp::AudioBlock<float> buffer, MidiBuffer&
             }
             if (midiConsume)
             {
-                midiBufferIn.addEvents(midiin, pos, remaining, 0);
+                midiBufferIn.addEvents(midiin, pos, remaining, -pos);
             }
             if (midiProduce)
             {
@@ -740,88 +1188,113 @@ void PlugDataAudioProcessor::process(dsp::AudioBlock<float> buffer, MidiBuffer&
     }
 }
 
-void PlugDataAudioProcessor::sendPlayhead()
+bool PlugDataAudioProcessor::isSilent(AudioBuffer<t_sample> const& buffer, int startChannel, int numChannels)
 {
-    AudioPlayHead* playhead = getPlayHead();
-    if(!playhead) return;
-
-    auto infos = playhead->getPosition();
+    for (int ch = startChannel; ch < std::min(numChannels, buffer.getNumChannels()); ch++)
+    {
+        if (buffer.getMagnitude(ch, 0, buffer.getNumSamples()) > silenceThreshold) return false;
+    }
+
+    return true;
+}
+
+void PlugDataAudioProcessor::sendPlayhead()
+{
+    AudioPlayHead* playhead = getPlayHead();
+    if(!playhead) return;
 
     setThis();
-    if (infos.hasValue())
+
+    // Skip the host query completely when there is no [playhead] in any patch
+    auto* receiver = playheadSymbols.receiver->s_thing;
+    if(!receiver)
     {
-        atoms_playhead[0] = static_cast<float>(infos->getIsPlaying());
-        sendMessage("playhead", "playing", atoms_playhead);
+        lastPlayheadReceiver = nullptr;
+        return;
+    }
 
-        atoms_playhead[0] = static_cast<float>(infos->getIsRecording());
-        sendMessage("playhead", "recording", atoms_playhead);
+    auto infos = playhead->getPosition();
+    if (!infos.hasValue()) return;
 
-        atoms_playhead[0] = static_cast<float>(infos->getIsLooping());
+    // Resend all fields when a receiver gets bound, and every second so that new [playhead] objects get up to date
+    playheadRefreshCountdown -= Instance::getBlockSize();
+    bool const resendAll = receiver != lastPlayheadReceiver || playheadRefreshCountdown <= 0;
+    if(resendAll)
+    {
+        lastPlayheadReceiver = receiver;
+        playheadRefreshCountdown = static_cast<int>(AudioProcessor::getSampleRate());
+    }
 
-        auto loopPoints = infos->getLoopPoints();
-        if(loopPoints.hasValue()) {
-            atoms_playhead.push_back(static_cast<float>(loopPoints->ppqStart));
-            atoms_playhead.push_back(static_cast<float>(loopPoints->ppqEnd));
-        }
-        else {
-            atoms_playhead.push_back(0.0f);
-            atoms_playhead.push_back(0.0f);
-        }
-        sendMessage("playhead", "looping", atoms_playhead);
+    auto& last = lastPlayheadInfo;
+    t_atom atoms[3];
 
-        if(infos->getEditOriginTime().hasValue()) {
-            atoms_playhead.resize(1);
-            atoms_playhead[0] = static_cast<float>(*infos->getEditOriginTime());
-            sendMessage("playhead", "edittime", atoms_playhead);
+    auto send = [this, &atoms](t_symbol* selector, int argc)
+    {
+        // Sending a message can cause the receiver to be removed
+        if(auto* target = playheadSymbols.receiver->s_thing) {
+            pd_typedmess(target, selector, argc, atoms);
         }
+    };
 
-        if(infos->getFrameRate().hasValue()) {
-            atoms_playhead[0] = static_cast<float>(infos->getFrameRate()->getEffectiveRate());
-            sendMessage("playhead", "framerate", atoms_playhead);
-        }
+    if(resendAll || infos->getIsPlaying() != last.getIsPlaying())
+    {
+        SETFLOAT(atoms, static_cast<float>(infos->getIsPlaying()));
+        send(playheadSymbols.playing, 1);
+    }
 
+    if(resendAll || infos->getIsRecording() != last.getIsRecording())
+    {
+        SETFLOAT(atoms, static_cast<float>(infos->getIsRecording()));
+        send(playheadSymbols.recording, 1);
+    }
 
-        if(infos->getBpm().hasValue()) {
-            atoms_playhead[0] = static_cast<float>(*infos->getBpm());
-            sendMessage("playhead", "bpm", atoms_playhead);
-        }
+    if(resendAll || infos->getIsLooping() != last.getIsLooping() || infos->getLoopPoints() != last.getLoopPoints())
+    {
+        auto loopPoints = infos->getLoopPoints();
+        SETFLOAT(atoms, static_cast<float>(infos->getIsLooping()));
+        SETFLOAT(atoms + 1, loopPoints.hasValue() ? static_cast<float>(loopPoints->ppqStart) : 0.0f);
+        SETFLOAT(atoms + 2, loopPoints.hasValue() ? static_cast<float>(loopPoints->ppqEnd) : 0.0f);
+        send(playheadSymbols.looping, 3);
+    }
 
-        if(infos->getPpqPositionOfLastBarStart().hasValue()) {
-            atoms_playhead[0] = static_cast<float>(*infos->getPpqPositionOfLastBarStart());
-            sendMessage("playhead", "lastbar", atoms_playhead);
-        }
+    if(infos->getEditOriginTime().hasValue() && (resendAll || infos->getEditOriginTime() != last.getEditOriginTime()))
+    {
+        SETFLOAT(atoms, static_cast<float>(*infos->getEditOriginTime()));
+        send(playheadSymbols.edittime, 1);
+    }
 
-        if(infos->getTimeSignature().hasValue()) {
-            atoms_playhead[0] = static_cast<float>(infos->getTimeSignature()->numerator);
-            atoms_playhead.push_back(static_cast<float>(infos->getTimeSignature()->denominator));
-            sendMessage("playhead", "timesig", atoms_playhead);
-        }
+    if(infos->getFrameRate().hasValue() && (resendAll || infos->getFrameRate() != last.getFrameRate()))
+    {
+        SETFLOAT(atoms, static_cast<float>(infos->getFrameRate()->getEffectiveRate()));
+        send(playheadSymbols.framerate, 1);
+    }
 
-        if(infos->getPpqPosition().hasValue()) {
+    if(infos->getBpm().hasValue() && (resendAll || infos->getBpm() != last.getBpm()))
+    {
+        SETFLOAT(atoms, static_cast<float>(*infos->getBpm()));
+        send(playheadSymbols.bpm, 1);
+    }
 
-            atoms_playhead[0] = static_cast<float>(*infos->getPpqPosition());
-        }
-        else {
-            atoms_playhead[0] = 0.0f;
-        }
+    if(infos->getPpqPositionOfLastBarStart().hasValue() && (resendAll || infos->getPpqPositionOfLastBarStart() != last.getPpqPositionOfLastBarStart()))
+    {
+        SETFLOAT(atoms, static_cast<float>(*infos->getPpqPositionOfLastBarStart()));
+        send(playheadSymbols.lastbar, 1);
+    }
 
-        if(infos->getTimeInSamples().hasValue()) {
-            atoms_playhead[1] = static_cast<float>(*infos->getTimeInSamples());
-        }
-        else {
-            atoms_playhead[1] = 0.0f;
-        }
+    if(infos->getTimeSignature().hasValue() && (resendAll || infos->getTimeSignature() != last.getTimeSignature()))
+    {
+        SETFLOAT(atoms, static_cast<float>(infos->getTimeSignature()->numerator));
+        SETFLOAT(atoms + 1, static_cast<float>(infos->getTimeSignature()->denominator));
+        send(playheadSymbols.timesig, 2);
+    }
 
-        if(infos->getTimeInSeconds().hasValue()) {
-            atoms_playhead.push_back(static_cast<float>(*infos->getTimeInSeconds()));
-        }
-        else {
-            atoms_playhead.push_back(0.0f);
-        }
+    // The position changes all the time, so it's always sent
+    SETFLOAT(atoms, infos->getPpqPosition().hasValue() ? static_cast<float>(*infos->getPpqPosition()) : 0.0f);
+    SETFLOAT(atoms + 1, infos->getTimeInSamples().hasValue() ? static_cast<float>(*infos->getTimeInSamples()) : 0.0f);
+    SETFLOAT(atoms + 2, infos->getTimeInSeconds().hasValue() ? static_cast<float>(*infos->getTimeInSeconds()) : 0.0f);
+    send(playheadSymbols.position, 3);
 
-        sendMessage("playhead", "position", atoms_playhead);
-        atoms_playhead.resize(1);
-    }
+    last = *infos;
 }
 
 void PlugDataAudioProcessor::messageEnqueued()
@@ -843,66 +1316,64 @@ void PlugDataAudioProcessor::messageEnqueued()
 
 void PlugDataAudioProcessor::sendMidiBuffer()
 {
-    if (acceptsMidi())
+    if (acceptsMidi() && sampleAccurateMidi)
     {
+        // pd receives every event at the logical time of its sample position inside this block
         for (const auto& event : midiBufferIn)
         {
-            auto const message = event.getMessage();
-            if (message.isNoteOn())
-            {
-                sendNoteOn(message.getChannel(), message.getNoteNumber(), message.getVelocity());
-            }
-            else if (message.isNoteOff())
-            {
-                sendNoteOn(message.getChannel(), message.getNoteNumber(), 0);
-            }
-            else if (message.isController())
-            {
-                sendControlChange(message.getChannel(), message.getControllerNumber(), message.getControllerValue());
-            }
-            else if (message.isPitchWheel())
-            {
-                sendPitchBend(message.getChannel(), message.getPitchWheelValue() - 8192);
-            }
-            else if (message.isChannelPressure())
-            {
-                sendAfterTouch(message.getChannel(), message.getChannelPressureValue());
-            }
-            else if (message.isAftertouch())
-            {
-                sendPolyAfterTouch(message.getChannel(), message.getNoteNumber(), message.getAfterTouchValue());
-            }
-            else if (message.isProgramChange())
-            {
-                sendProgramChange(message.getChannel(), message.getProgramChangeNumber());
-            }
-            else if (message.isSysEx())
-            {
-                for (int i = 0; i < message.getSysExDataSize(); ++i)
-                {
-                    sendSysEx(0, static_cast<int>(message.getSysExData()[i]));
-                }
-            }
-            else if (message.isMidiClock() || message.isMidiStart() || message.isMidiStop() || message.isMidiContinue() || message.isActiveSense() || (message.getRawDataSize() == 1 && message.getRawData()[0] == 0xff))
-            {
-                for (int i = 0; i < message.getRawDataSize(); ++i)
-                {
-                    sendSysRealTime(0, static_cast<int>(message.getRawData()[i]));
-                }
-            }
-
-            for (int i = 0; i < message.getRawDataSize(); i++)
-            {
-                sendMidiByte(0, static_cast<int>(message.getRawData()[i]));
-            }
+            scheduleMidi(event.data, event.numBytes, event.samplePosition);
         }
         midiBufferIn.clear();
     }
+    else if (acceptsMidi())
+    {
+        // Everything is received at the start of the block
+        sendMidiMessages(midiBufferIn);
+        midiBufferIn.clear();
+    }
 }
 
 void PlugDataAudioProcessor::processInternal()
+{
+    TRACE_ZONE("processInternal");
+
+    prepareTick();
+
+    // Process audio
+    // All open patches share one pd instance, so they are a single DSP chain that pd has to run serially on this thread
+    // Splitting them over multiple cores would require giving each patch its own pd instance
+    const int blockSize = Instance::getBlockSize();
+    FloatVectorOperations::copy(audioBufferIn.data() + (2 * blockSize), audioBufferOut.data() + (2 * blockSize), (minOut - 2) * blockSize);
+    performDSP(audioBufferIn.data(), audioBufferOut.data());
+}
+
+void PlugDataAudioProcessor::processInternalDirect(int offset)
+{
+    TRACE_ZONE("processInternal");
+
+    prepareTick();
+
+    // Reads the inputs and writes the output of the previous tick straight from/to the host channels
+    const int numChannels = static_cast<int>(channelPointers.size());
+    performDSP(channelPointers.data(), channelPointers.data(), std::min(getTotalNumInputChannels(), numChannels), std::min(getTotalNumOutputChannels(), numChannels), offset);
+
+    // The last output now only lives inside pd, audioBufferOut needs to be updated before it's used again
+    stagingBufferOutdated = true;
+}
+
+void PlugDataAudioProcessor::syncStagingBuffer()
+{
+    if (stagingBufferOutdated)
+    {
+        copyLastOutput(audioBufferOut.data());
+        stagingBufferOutdated = false;
+    }
+}
+
+void PlugDataAudioProcessor::prepareTick()
 {
     setThis();
+    startBlock();
 
     // clear midi out
     if (producesMidi())
@@ -915,14 +1386,15 @@ void PlugDataAudioProcessor::processInternal()
     }
 
     // Dequeue messages
-    sendMessagesFromQueue();
-    sendPlayhead();
+    if (!bouncing)
+    {
+        sendMessagesFromQueue(true);
+        dispatchOscMessages();
+        sendPlayhead();
+    }
     sendMidiBuffer();
     sendParameters();
-
-    // Process audio
-    FloatVectorOperations::copy(audioBufferIn.data() + (2 * 64), audioBufferOut.data() + (2 * 64), (minOut - 2) * 64);
-    performDSP(audioBufferIn.data(), audioBufferOut.data());
+    snapshots.processMorph(morph->load());
 }
 
 bool PlugDataAudioProcessor::hasEditor() const
@@ -936,10 +1408,11 @@ AudioProcessorEditor* PlugDataAudioProcessor::createEditor()
 
     setThis();
 
+    // Only the tab that gets shown builds its objects now, the others wait until they're opened
     for (auto* patch : patches)
     {
-        auto* cnv = editor->canvases.add(new Canvas(*editor, *patch, nullptr));
-        editor->addTab(cnv, true);
+        auto* cnv = editor->canvases.add(new Canvas(*editor, *patch, nullptr, true));
+        editor->addTab(cnv, true, false);
     }
 
     editor->resized();
@@ -947,41 +1420,212 @@ AudioProcessorEditor* PlugDataAudioProcessor::createEditor()
     if(isPositiveAndBelow(lastTab, patches.size())) {
         editor->tabbar.setCurrentTabIndex(lastTab);
     }
+    else if (!patches.isEmpty()) {
+        editor->tabbar.setCurrentTabIndex(patches.size() - 1);
+    }
 
     return editor;
 }
 
-void PlugDataAudioProcessor::getStateInformation(MemoryBlock& destData)
+// Binary state format, older versions started directly with the number of patches
+// Everything after the header is deflate compressed
+static constexpr int stateMagic = 0x50445354;
+static constexpr int stateVersion = 3;
+
+enum PatchChunk
 {
-    MemoryBlock xmlBlock;
+    TextChunk,
+    ArrayChunk,
+    EndChunk
+};
 
-    suspendProcessing(true);  // These functions can be called from any thread, so suspend processing prevent threading issues
+// Parses the values of a "#A onset values... ;" statement, fails if any of the atoms isn't a number
+static bool parseArrayStatement(String const& statement, int& onset, std::vector<t_float>& values)
+{
+    auto tokens = StringArray::fromTokens(statement.fromFirstOccurrenceOf("#A ", false, false).upToLastOccurrenceOf(";", false, false), " \n", "");
+    tokens.removeEmptyStrings();
 
-    setThis();
-    auto stateXml = parameters.copyState().createXml();
+    if (tokens.size() < 2)
+        return false;
 
-    stateXml->setAttribute("Version", PLUGDATA_VERSION);
+    values.clear();
+    for (auto const& token : tokens)
+    {
+        char* end = nullptr;
+        auto value = std::strtod(token.toRawUTF8(), &end);
+        if (end == token.toRawUTF8() || *end != '\0')
+            return false;
 
-    copyXmlToBinary(*stateXml, xmlBlock);
+        values.push_back(static_cast<t_float>(value));
+    }
 
-    // Store pure-data state
-    MemoryOutputStream ostream(destData, false);
+    onset = static_cast<int>(values.front());
+    values.erase(values.begin());
+
+    return true;
+}
+
+// Stores the patch text with array contents in binary, which is a lot smaller than pd's text representation
+static void writePatchContent(OutputStream& ostream, String const& content)
+{
+    String text;
+    std::vector<t_float> values;
+
+    auto* ptr = content.toRawUTF8();
+    auto const* end = ptr + content.getNumBytesAsUTF8();
+
+    while (ptr < end)
+    {
+        // Find the end of this statement, while skipping escaped semicolons
+        auto const* statementEnd = ptr;
+        while (statementEnd < end && !(*statementEnd == ';' && (statementEnd == ptr || statementEnd[-1] != '\\')))
+            statementEnd++;
+
+        while (statementEnd < end && (*statementEnd == ';' || *statementEnd == '\n'))
+            statementEnd++;
+
+        auto statement = String::fromUTF8(ptr, static_cast<int>(statementEnd - ptr));
+        ptr = statementEnd;
+
+        int onset = 0;
+        if (statement.startsWith("#A ") && parseArrayStatement(statement, onset, values))
+        {
+            if (text.isNotEmpty())
+            {
+                ostream.writeByte(TextChunk);
+                ostream.writeString(text);
+                text.clear();
+            }
 
-    ostream.writeInt(patches.size());
+            ostream.writeByte(ArrayChunk);
+            ostream.writeCompressedInt(onset);
+            ostream.writeCompressedInt(static_cast<int>(values.size()));
+            for (auto const value : values)
+            {
+                if constexpr (sizeof(t_float) == 8)
+                    ostream.writeDouble(value);
+                else
+                    ostream.writeFloat(value);
+            }
+        }
+        else
+        {
+            text += statement;
+        }
+    }
+
+    if (text.isNotEmpty())
+    {
+        ostream.writeByte(TextChunk);
+        ostream.writeString(text);
+    }
+
+    ostream.writeByte(EndChunk);
+}
+
+// Arrays are read back with the float size they were stored with, which might not be ours
+static String readPatchContent(InputStream& istream, int floatSize)
+{
+    MemoryOutputStream content;
+    char number[32];
+
+    while (!istream.isExhausted())
+    {
+        auto const type = istream.readByte();
+
+        if (type == TextChunk)
+        {
+            content << istream.readString();
+        }
+        else if (type == ArrayChunk)
+        {
+            auto const onset = istream.readCompressedInt();
+            auto const numValues = istream.readCompressedInt();
+
+            content << "#A " << onset;
+            for (int i = 0; i < numValues; i++)
+            {
+                auto const value = floatSize == 8 ? istream.readDouble() : static_cast<double>(istream.readFloat());
 
+                // Enough digits for the value to come back exactly the same when pd parses it
+                std::snprintf(number, sizeof(number), floatSize == 8 ? " %.17g" : " %.9g", value);
+                content << number;
+            }
+            content << ";\n";
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return content.toString();
+}
+
+void PlugDataAudioProcessor::getStateInformation(MemoryBlock& destData)
+{
+    // Hosts may save very often, so instead of suspending audio we only take a snapshot of the patches in between two dsp blocks
+    // Everything else can be serialised while audio keeps running
+    StringArray contents;
+    StringArray locations;
+
+    // Hosts that save from another thread get the info as it was after the last message loop iteration
+    flushInfoStorage();
+
+    setThis();
+    sys_lock();
     for (auto& patch : patches)
     {
-        ostream.writeString(patch->getCanvasContent());
-        ostream.writeString(patch->getCurrentFile().getFullPathName());
+        contents.add(patch->getCanvasContent());
+        locations.add(patch->getCurrentFile().getFullPathName());
     }
+    sys_unlock();
 
-    ostream.writeInt(getLatencySamples());
-    ostream.writeInt(oversampling);
-    ostream.writeFloat(static_cast<float>(tailLength.getValue()));
-    ostream.writeInt(static_cast<int>(xmlBlock.getSize()));
-    ostream.write(xmlBlock.getData(), xmlBlock.getSize());
+    MemoryOutputStream ostream(destData, false);
 
-    suspendProcessing(false);
+    ostream.writeInt(stateMagic);
+    ostream.writeInt(stateVersion);
+    ostream.writeString(PLUGDATA_VERSION);
+
+    // The float size decides how array values are stored
+    ostream.writeByte(static_cast<char>(sizeof(t_float)));
+
+    {
+        GZIPCompressorOutputStream compressed(ostream, 9);
+
+        compressed.writeCompressedInt(contents.size());
+
+        for (int i = 0; i < contents.size(); i++)
+        {
+            compressed.writeString(locations[i]);
+            compressed.writeInt64(contents[i].hashCode64());
+            writePatchContent(compressed, contents[i]);
+        }
+
+        compressed.writeInt(getLatency());
+        compressed.writeInt(oversampling);
+        compressed.writeFloat(static_cast<float>(tailLength.getValue()));
+        compressed.writeInt(pdBlockSize);
+        compressed.writeInt(oversamplingFilter);
+
+        // Only store parameters that differ from their default, as the distance from the previous one
+        auto const& params = getParameters();
+        int lastIndex = -1;
+
+        for (int i = 0; i < params.size(); i++)
+        {
+            if (params[i]->getValue() != params[i]->getDefaultValue())
+            {
+                compressed.writeCompressedInt(i - lastIndex);
+                compressed.writeFloat(params[i]->getValue());
+                lastIndex = i;
+            }
+        }
+
+        compressed.writeCompressedInt(0);
+
+        snapshots.write(compressed);
+    }
 }
 
 void PlugDataAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
@@ -1002,24 +1646,31 @@ void PlugDataAudioProcessor::setStateInformation(const void* data, int sizeInByt
 
             suspendProcessing(true);
 
-            // Close any opened patches
-            if (auto* editor = dynamic_cast<PlugDataPluginEditor*>(getActiveEditor()))
+            // Patches that are identical to a stored one are kept open, so recalling the same state again is nearly instant
+            Array<pd::Patch*> previousPatches;
+            Array<int64> previousHashes;
+            Array<pd::Patch*> keptPatches;
+
+            for (auto* patch : patches)
             {
-                editor->tabbar.clearTabs();
-                editor->canvases.clear();
+                previousPatches.add(patch);
+                previousHashes.add(patch->getCanvasContent().hashCode64());
             }
 
-            for (auto& patch : patches) patch->close();
-            patches.clear();
-
-            int numPatches = istream.readInt();
-
-            for (int i = 0; i < numPatches; i++)
+            auto restorePatch = [this, &previousPatches, &previousHashes, &keptPatches](String const& state, int64 hash, File const& location)
             {
-                auto state = istream.readString();
-                auto location = File(istream.readString());
+                for (int i = 0; i < previousPatches.size(); i++)
+                {
+                    auto* existing = previousPatches[i];
+                    if (previousHashes[i] == hash && !keptPatches.contains(existing) && existing->getCurrentFile().getFullPathName() == location.getFullPathName())
+                    {
+                        keptPatches.add(existing);
+                        return;
+                    }
+                }
 
                 auto* patch = loadPatch(state);
+                if (!patch) return;
 
                 if ((location.exists() && location.getParentDirectory() == File::getSpecialLocation(File::tempDirectory)) || !location.exists())
                 {
@@ -1033,34 +1684,156 @@ void PlugDataAudioProcessor::setStateInformation(const void* data, int sizeInByt
                     auto parentPath = location.getParentDirectory().getFullPathName();
                     // Add patch path to search path to make sure it finds the externals!
                     libpd_add_to_search_path(parentPath.toRawUTF8());
+
+                    sys_lock();
+                    libpd_pathcache_invalidate();
+                    sys_unlock();
+                }
+            };
+
+            int latency, oversampling;
+            int blockSize = pdBlockSize;
+
+            if (istream.readInt() == stateMagic)
+            {
+                auto version = istream.readInt();
+                istream.readString(); // plugdata version that saved this state
+                auto floatSize = istream.readByte();
+
+                // We can't know what a newer version has stored
+                if (version > stateVersion)
+                {
+                    suspendProcessing(false);
+                    freebytes(copy, sizeInBytes);
+                    return;
+                }
+
+                GZIPDecompressorInputStream compressed(istream);
+
+                int numPatches = compressed.readCompressedInt();
+
+                for (int i = 0; i < numPatches; i++)
+                {
+                    auto location = File(compressed.readString());
+                    auto hash = version >= 2 ? compressed.readInt64() : 0;
+                    auto state = readPatchContent(compressed, floatSize);
+
+                    restorePatch(state, version >= 2 ? hash : state.hashCode64(), location);
+                }
+
+                latency = compressed.readInt();
+                oversampling = compressed.readInt();
+                tailLength = var(compressed.readFloat());
+                blockSize = compressed.readInt();
+                oversamplingFilter = compressed.readInt();
+
+                auto const& params = getParameters();
+                for (auto* param : params)
+                {
+                    param->setValueNotifyingHost(param->getDefaultValue());
+                }
+
+                int index = -1;
+                while (!compressed.isExhausted())
+                {
+                    auto delta = compressed.readCompressedInt();
+                    if (delta <= 0) break;
+
+                    index += delta;
+                    auto value = compressed.readFloat();
+
+                    if (isPositiveAndBelow(index, params.size()))
+                    {
+                        params[index]->setValueNotifyingHost(value);
+                    }
+                }
+
+                if (version >= 3)
+                {
+                    snapshots.read(compressed);
+                }
+                else
+                {
+                    snapshots.clear();
                 }
             }
+            else
+            {
+                istream.setPosition(0);
+
+                int numPatches = istream.readInt();
+
+                for (int i = 0; i < numPatches; i++)
+                {
+                    auto state = istream.readString();
+                    auto location = File(istream.readString());
+
+                    restorePatch(state, state.hashCode64(), location);
+                }
+
+                latency = istream.readInt();
+                oversampling = istream.readInt();
+                auto tail = istream.readFloat();
+                auto xmlSize = istream.readInt();
 
-            auto latency = istream.readInt();
-            auto oversampling = istream.readInt();
-            auto tail = istream.readFloat();
-            auto xmlSize = istream.readInt();
+                tailLength = var(tail);
 
-            tailLength = var(tail);
+                void* xmlData = static_cast<void*>(new char[xmlSize]);
+                istream.read(xmlData, xmlSize);
 
-            void* xmlData = static_cast<void*>(new char[xmlSize]);
-            istream.read(xmlData, xmlSize);
+                std::unique_ptr<XmlElement> xmlState(getXmlFromBinary(xmlData, xmlSize));
 
-            std::unique_ptr<XmlElement> xmlState(getXmlFromBinary(xmlData, xmlSize));
+                // Older versions didn't store the pd block size or oversampling filter
+                if (!istream.isExhausted())
+                {
+                    blockSize = istream.readInt();
+                }
+                if (!istream.isExhausted())
+                {
+                    oversamplingFilter = istream.readInt();
+                }
 
-            auto saveVersion = String("0.6.1");
-            if(xmlState->hasAttribute("Version")) {
-                saveVersion = xmlState->getStringAttribute("Version");
+                if (xmlState) {
+                    if (xmlState->hasTagName(parameters.state.getType())) {
+                        parameters.replaceState(ValueTree::fromXml(*xmlState));
+                    }
+                }
             }
 
-            if (xmlState) {
-                if (xmlState->hasTagName(parameters.state.getType())) {
-                    parameters.replaceState(ValueTree::fromXml(*xmlState));
+            // Close the patches that weren't reused, along with any of their tabs
+            if (auto* editor = dynamic_cast<PlugDataPluginEditor*>(getActiveEditor()))
+            {
+                for (int i = editor->tabbar.getNumTabs() - 1; i >= 0; i--)
+                {
+                    auto* cnv = editor->getCanvas(i);
+                    if (!cnv || !keptPatches.contains(&cnv->patch))
+                    {
+                        editor->canvases.removeObject(cnv);
+                        editor->tabbar.removeTab(i);
+                    }
                 }
             }
 
-            setLatencySamples(latency);
-            setOversampling(oversampling);
+            for (auto* patch : previousPatches)
+            {
+                if (!keptPatches.contains(patch))
+                {
+                    patch->close();
+                    patches.removeObject(patch);
+                }
+            }
+
+            setLatency(latency);
+
+            // A corrupt or foreign state could have any number here, pd can only tick in these
+            if (blockSize == 64 || blockSize == 128 || blockSize == 256 || blockSize == 512)
+            {
+                setPdBlockSize(blockSize);
+            }
+
+            // There are only four oversampling factors and three filters to index
+            oversamplingFilter = std::clamp(oversamplingFilter, 0, 2);
+            setOversampling(std::clamp(oversampling, 0, static_cast<int>(oversamplers.size()) - 1));
 
             suspendProcessing(false);
 
@@ -1071,6 +1844,12 @@ void PlugDataAudioProcessor::setStateInformation(const void* data, int sizeInByt
 
 pd::Patch* PlugDataAudioProcessor::loadPatch(const File& patchFile)
 {
+    // On first startup, the abstractions might still be getting extracted
+    if (filesystemExtractor)
+    {
+        filesystemExtractor->waitForAbstractions();
+    }
+
     // First, check if patch is already opened
     int i = 0;
     for(auto* patch : patches) {
@@ -1097,7 +1876,39 @@ pd::Patch* PlugDataAudioProcessor::loadPatch(const File& patchFile)
     auto newPatch = openPatch(patchFile);
 
     suspendProcessing(false);
-    
+
+    auto* patch = addPatch(newPatch);
+    if (patch)
+    {
+        patch->setCurrentFile(patchFile);
+    }
+
+    return patch;
+}
+
+pd::Patch* PlugDataAudioProcessor::loadPatch(String patchText)
+{
+    if (patchText.isEmpty()) patchText = pd::Instance::defaultPatch;
+
+    if (filesystemExtractor)
+    {
+        filesystemExtractor->waitForAbstractions();
+    }
+
+    // Evaluated straight from memory, this needs no disk access when many instances restore their state
+    // The patch gets a placeholder name in the temp directory, so relative paths still resolve like before
+    suspendProcessing(true);
+
+    auto newPatch = openPatch(patchText, File::getSpecialLocation(File::tempDirectory).getChildFile("Untitled.pd"));
+
+    suspendProcessing(false);
+
+    // Unknown file, since it was never loaded from disk
+    return addPatch(newPatch);
+}
+
+pd::Patch* PlugDataAudioProcessor::addPatch(pd::Patch newPatch)
+{
     if (!newPatch.getPointer())
     {
         logError("Couldn't open patch");
@@ -1105,34 +1916,36 @@ pd::Patch* PlugDataAudioProcessor::loadPatch(const File& patchFile)
     }
 
     auto* patch = patches.add(new pd::Patch(newPatch));
+    journal.open(patch->getPointer());
 
     if (auto* editor = dynamic_cast<PlugDataPluginEditor*>(getActiveEditor()))
     {
-        MessageManager::callAsync([i, patch, _editor = Component::SafePointer(editor)]() mutable {
+        MessageManager::callAsync([patch, _editor = Component::SafePointer(editor)]() mutable {
             if(!_editor) return;
             auto* cnv = _editor->canvases.add(new Canvas(*_editor, *patch, nullptr));
             _editor->addTab(cnv, true);
         });
     }
 
-    patch->setCurrentFile(patchFile);
-
     return patch;
 }
 
-pd::Patch* PlugDataAudioProcessor::loadPatch(String patchText)
+void PlugDataAudioProcessor::recoverPatches()
 {
-    if (patchText.isEmpty()) patchText = pd::Instance::defaultPatch;
-
-    auto patchFile = File::createTempFile(".pd");
-    patchFile.replaceWithText(patchText);
-
-    auto* patch = loadPatch(patchFile);
+    for (auto& [content, location] : journal.recover())
+    {
+        auto* patch = loadPatch(content);
+        if (!patch) continue;
 
-    // Set to unknown file when loading temp patch
-    patch->setCurrentFile(File());
+        // Saving writes to the original file again, unless it was never saved
+        if (location.getParentDirectory() != File::getSpecialLocation(File::tempDirectory))
+        {
+            patch->setCurrentFile(location);
+        }
 
-    return patch;
+        patch->setTitle(location.getFileName().isEmpty() ? String("Untitled Patcher") : location.getFileName());
+        logMessage("Recovered unsaved changes to " + patch->getTitle());
+    }
 }
 
 void PlugDataAudioProcessor::setTheme(bool themeToUse)
@@ -1143,22 +1956,11 @@ void PlugDataAudioProcessor::setTheme(bool themeToUse)
         editor->getTopLevelComponent()->repaint();
         editor->repaint();
 
+        // The other tabs catch up once they're shown
         if (auto* cnv = editor->getCurrentCanvas())
         {
             cnv->viewport->repaint();
-
-            // Some objects with setBufferedToImage need manual repainting
-            for (auto* object : cnv->objects) {
-                
-                object->gui->repaint();
-                
-                // Make sure label colour gets updated
-                if(auto* gui = dynamic_cast<GUIObject*>(object->gui.get())) {
-                    gui->updateLabel();
-                }
-            }
-            for (auto* con : cnv->connections) reinterpret_cast<Component*>(con)->repaint();
-            cnv->repaint();
+            cnv->updateColours();
         }
     }
 }
@@ -1187,37 +1989,37 @@ void PlugDataAudioProcessor::receiveNoteOn(const int channel, const int pitch, c
 {
     if (velocity == 0)
     {
-        midiBufferOut.addEvent(MidiMessage::noteOff(channel, pitch, uint8(0)), audioAdvancement);
+        midiBufferOut.addEvent(MidiMessage::noteOff(channel, pitch, uint8(0)), midiEventPosition);
     }
     else
     {
-        midiBufferOut.addEvent(MidiMessage::noteOn(channel, pitch, static_cast<uint8>(velocity)), audioAdvancement);
+        midiBufferOut.addEvent(MidiMessage::noteOn(channel, pitch, static_cast<uint8>(velocity)), midiEventPosition);
     }
 }
 
 void PlugDataAudioProcessor::receiveControlChange(const int channel, const int controller, const int value)
 {
-    midiBufferOut.addEvent(MidiMessage::controllerEvent(channel, controller, value), audioAdvancement);
+    midiBufferOut.addEvent(MidiMessage::controllerEvent(channel, controller, value), midiEventPosition);
 }
 
 void PlugDataAudioProcessor::receiveProgramChange(const int channel, const int value)
 {
-    midiBufferOut.addEvent(MidiMessage::programChange(channel, value), audioAdvancement);
+    midiBufferOut.addEvent(MidiMessage::programChange(channel, value), midiEventPosition);
 }
 
 void PlugDataAudioProcessor::receivePitchBend(const int channel, const int value)
 {
-    midiBufferOut.addEvent(MidiMessage::pitchWheel(channel, value + 8192), audioAdvancement);
+    midiBufferOut.addEvent(MidiMessage::pitchWheel(channel, value + 8192), midiEventPosition);
 }
 
 void PlugDataAudioProcessor::receiveAftertouch(const int channel, const int value)
 {
-    midiBufferOut.addEvent(MidiMessage::channelPressureChange(channel, value), audioAdvancement);
+    midiBufferOut.addEvent(MidiMessage::channelPressureChange(channel, value), midiEventPosition);
 }
 
 void PlugDataAudioProcessor::receivePolyAftertouch(const int channel, const int pitch, const int value)
 {
-    midiBufferOut.addEvent(MidiMessage::aftertouchChange(channel, pitch, value), audioAdvancement);
+    midiBufferOut.addEvent(MidiMessage::aftertouchChange(channel, pitch, value), midiEventPosition);
 }
 
 void PlugDataAudioProcessor::receiveMidiByte(const int port, const int byte)
@@ -1226,7 +2028,7 @@ void PlugDataAudioProcessor::receiveMidiByte(const int port, const int byte)
     {
         if (byte == 0xf7)
         {
-            midiBufferOut.addEvent(MidiMessage::createSysExMessage(midiByteBuffer, static_cast<int>(midiByteIndex)), audioAdvancement);
+            midiBufferOut.addEvent(MidiMessage::createSysExMessage(midiByteBuffer, static_cast<int>(midiByteIndex)), midiEventPosition);
             midiByteIndex = 0;
             midiByteIsSysex = false;
         }
@@ -1248,7 +2050,7 @@ void PlugDataAudioProcessor::receiveMidiByte(const int port, const int byte)
         midiByteBuffer[midiByteIndex++] = static_cast<uint8>(byte);
         if (midiByteIndex >= 3)
         {
-            midiBufferOut.addEvent(MidiMessage(midiByteBuffer, 3), audioAdvancement);
+            midiBufferOut.addEvent(MidiMessage(midiByteBuffer, 3), midiEventPosition);
             midiByteIndex = 0;
         }
     }
@@ -1258,17 +2060,78 @@ void PlugDataAudioProcessor::receiveMidiByte(const int port, const int byte)
 void PlugDataAudioProcessor::sendParameters()
 {
 #if PLUGDATA_STANDALONE
-    for (int idx = 0; idx < numParameters; idx++)
+    bool locked = false;
+
+    for (size_t word = 0; word < dirtyParameters.size(); word++)
     {
-        float value = standaloneParams[idx].load();
-        if (value != lastParameters[idx])
+        if (dirtyParameters[word].load(std::memory_order_relaxed) == 0) continue;
+
+        auto bits = dirtyParameters[word].exchange(0);
+        while (bits)
         {
-            auto paramID = "param" + String(idx + 1);
-            sendFloat(paramID.toRawUTF8(), value);
+            int const idx = static_cast<int>(word * 64) + std::countr_zero(bits);
+            bits &= bits - 1;
+
+            float value = standaloneParams[idx].load();
+            if (value == lastParameters[idx]) continue;
             lastParameters[idx] = value;
+
+            if (!locked)
+            {
+                sys_lock();
+                locked = true;
+            }
+
+            if (auto* target = parameterSymbols[idx]->s_thing)
+            {
+                pd_float(target, value);
+            }
         }
     }
+
+    if (locked) sys_unlock();
+#endif
+}
+
+#if PLUGDATA_STANDALONE
+void PlugDataAudioProcessor::setStandaloneParameter(int idx, float value)
+{
+    standaloneParams[idx].store(value);
+    dirtyParameters[idx / 64].fetch_or(uint64(1) << (idx % 64));
+    rampedParameters[idx / 64].fetch_or(uint64(1) << (idx % 64));
+}
+#endif
+
+void PlugDataAudioProcessor::sendParameterRamps(int numSamples)
+{
+    bool locked = false;
+
+    for (size_t word = 0; word < rampedParameters.size(); word++)
+    {
+        if (rampedParameters[word].load(std::memory_order_relaxed) == 0) continue;
+
+        auto bits = rampedParameters[word].exchange(0);
+        while (bits)
+        {
+            int const idx = static_cast<int>(word * 64) + std::countr_zero(bits);
+            bits &= bits - 1;
+
+            if (!locked)
+            {
+                RealtimeChecker::checkLock("sys_lock");
+                sys_lock();
+                locked = true;
+            }
+
+#if PLUGDATA_STANDALONE
+            libpd_param_ramp(idx, standaloneParams[idx].load(), numSamples);
+#else
+            libpd_param_ramp(idx, lastParameters[idx].load(), numSamples);
 #endif
+        }
+    }
+
+    if (locked) sys_unlock();
 }
 
 void PlugDataAudioProcessor::performParameterChange(int type, int idx, float value)
@@ -1295,7 +2158,7 @@ void PlugDataAudioProcessor::performParameterChange(int type, int idx, float val
         // Update values in automation panel
         if(lastParameters[idx] == value) return;
         if(auto* editor = dynamic_cast<PlugDataPluginEditor*>(getActiveEditor())) {
-            editor->sidebar.updateAutomationParameters();
+            editor->sidebar.updateAutomationParameter(idx);
         }
         lastParameters[idx] = value;
 #else
@@ -1311,11 +2174,15 @@ void PlugDataAudioProcessor::performParameterChange(int type, int idx, float val
 // Callback when parameter values change
 void PlugDataAudioProcessor::parameterValueChanged (int idx, float value)
 {
-    enqueueFunction([this, idx, value]() mutable {
-        auto paramID = "param" + String(idx);
-        sendFloat(paramID.toRawUTF8(), value);
-        lastParameters[idx - 1] = value;
-    });
+    // Index 0 is the volume parameter
+    lastParameters[idx - 1] = value;
+
+    t_atom atom;
+    SETFLOAT(&atom, value);
+    enqueueMessage(parameterSymbols[idx - 1], &s_float, 1, &atom);
+
+    // [param~] gets the new value as a ramp over the next block
+    rampedParameters[(idx - 1) / 64].fetch_or(uint64(1) << ((idx - 1) % 64));
 }
 
 void PlugDataAudioProcessor::parameterGestureChanged (int parameterIndex, bool gestureIsStarting)
@@ -1337,8 +2204,14 @@ void PlugDataAudioProcessor::receiveDSPState(bool dsp)
 
 void PlugDataAudioProcessor::receiveGuiUpdate(int type)
 {
+    // Nothing is collected while the editor is closed or hidden, it does a full update when it's shown again
+    if(guiUpdatesPaused) return;
+
     callbackType |= (1 << type);
 
+    // Editor updates are collected during an offline render and performed once it's finished
+    if(bouncing) return;
+
     if(!isTimerRunning()) {
 
         startTimer(16);
@@ -1355,6 +2228,22 @@ void PlugDataAudioProcessor::timerCallback()
             if (callbackType & 2 || callbackType & 8)
             {
                 cnv->updateGuiValues();
+
+                // Everything is updated already
+                void* object;
+                while (getNextDirtyObject(object)) { }
+            }
+            else if (callbackType & 16)
+            {
+                std::unordered_set<void*> dirtyObjects;
+
+                void* object;
+                while (getNextDirtyObject(object))
+                {
+                    dirtyObjects.insert(object);
+                }
+
+                cnv->updateGuiValues(dirtyObjects);
             }
             if (callbackType & 4)
             {
@@ -1365,6 +2254,15 @@ void PlugDataAudioProcessor::timerCallback()
         callbackType = 0;
         stopTimer();
     }
+    else {
+        stopTimer();
+    }
+}
+
+void PlugDataAudioProcessor::updateConsoleLogging()
+{
+    bool enabled = settingsTree.hasProperty("LogToFile") && static_cast<bool>(settingsTree.getProperty("LogToFile"));
+    setConsoleLogFile(enabled ? homeDir.getChildFile("Logs").getChildFile("plugdata.log") : File());
 }
 
 void PlugDataAudioProcessor::updateConsole()
@@ -1397,7 +2295,7 @@ void PlugDataAudioProcessor::synchroniseCanvas(void* cnv)
                 {
                     if (canvas->patch.getPointer() == cnv)
                     {
-                        canvas->synchronise();
+                        canvas->synchroniseChanges();
                     }
                 }
             }
@@ -1415,6 +2313,18 @@ void PlugDataAudioProcessor::titleChanged()
     }
 }
 
+void PlugDataAudioProcessor::undoStateChanged()
+{
+    MessageManager::callAsync(
+        [this]() mutable
+        {
+            if (auto* editor = dynamic_cast<PlugDataPluginEditor*>(getActiveEditor()))
+            {
+                editor->updateCommandStatus();
+            }
+        });
+}
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
@@ -12,6 +12,7 @@
 #include "Pd/PdLibrary.h"
 #include "LookAndFeel.h"
 #include "Statusbar.h"
+#include "Utility/AudioRecorder.h"
 
 
 class PlugDataLook;
@@ -26,6 +27,10 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
     static AudioProcessor::BusesProperties buildBusesProperties();
 
     void setOversampling(int amount);
+    void setOversamplingFilter(int filterType);
+    void setPdBlockSize(int blockSize);
+    void setSampleAccurateMidi(bool enabled);
+    void setAutoSleep(bool enabled);
     void prepareToPlay(double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
 
@@ -35,6 +40,15 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
    
     void processBlock(AudioBuffer<float>&, MidiBuffer&) override;
 
+#if PD_FLOATSIZE == 64
+    // pd uses doubles, so the host can pass its buffers without conversion
+    bool supportsDoublePrecisionProcessing() const override
+    {
+        return true;
+    }
+    void processBlock(AudioBuffer<double>&, MidiBuffer&) override;
+#endif
+
     AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
 
@@ -46,6 +60,7 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
     double getTailLengthSeconds() const override;
 
     std::atomic<int> callbackType = 0;
+
     void timerCallback() override;
 
     int getNumPrograms() override;
@@ -69,14 +84,20 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
     void parameterGestureChanged (int parameterIndex, bool gestureIsStarting) override;
     
     void receiveDSPState(bool dsp) override;
+    void receivePatchLatency(String const& source, float samples) override;
+    void receiveLatencyQuery() override;
+    void receiveRecordMessage(String const& action, String const& file, int bus) override;
     void receiveGuiUpdate(int type) override;
 
     void updateConsole() override;
 
+    // Turns writing the console to a log file on or off, depending on the settings
+    void updateConsoleLogging();
+
     void synchroniseCanvas(void* cnv) override;
     void synchroniseAll() override;
     
-    void process(dsp::AudioBlock<float>, MidiBuffer&);
+    void process(dsp::AudioBlock<t_sample>, MidiBuffer&);
 
     void setCallbackLock(const CriticalSection* lock)
     {
@@ -107,14 +128,25 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
     void sendPlayhead();
     void sendParameters();
 
+    // Moves [param~] to the parameter values the host set for this block, over the length of the block
+    void sendParameterRamps(int numSamples);
+
     void messageEnqueued() override;
     void performParameterChange(int type, int idx, float value) override;
 
     pd::Patch* loadPatch(String patch);
     pd::Patch* loadPatch(const File& patch);
 
+    // Adds an opened patch to the patch list and the editor
+    pd::Patch* addPatch(pd::Patch newPatch);
+
+    // Opens the patches that were still open when plugdata or a host crashed, with the edits that weren't saved
+    void recoverPatches();
+
     void titleChanged() override;
 
+    void undoStateChanged() override;
+
     void setTheme(bool themeToUse);
 
     Colour getForegroundColour() override;
@@ -127,8 +159,9 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
 
     int lastUIWidth = 1000, lastUIHeight = 650;
 
-    std::vector<float*> channelPointers;
+    std::vector<t_sample*> channelPointers;
     std::atomic<float>* volume;
+    std::atomic<float>* morph;
 
     ValueTree settingsTree = ValueTree("plugdatasettings");
 
@@ -153,9 +186,30 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
     static inline constexpr int numParameters = 512;
     static inline constexpr int numInputBuses = 16;
     static inline constexpr int numOutputBuses = 16;
+
+    // Total number of channels over all enabled buses, in each direction. Enough for 7th order ambisonics
+    static inline constexpr int maxChannels = 128;
     
     // Zero means no oversampling
     int oversampling = 0;
+
+    // 0: polyphase IIR, 1: FIR equiripple, 2: max quality FIR equiripple
+    int oversamplingFilter = 0;
+
+    // Sets the latency chosen by the user, the latency of the oversampling filters is added on top of it
+    void setLatency(int samples);
+    int getLatency() const;
+
+    // Size of the blocks that pd processes at once, a multiple of pd's 64 sample tick
+    int pdBlockSize = 64;
+
+    // Schedules incoming midi at its sample position instead of sending everything at the start of a block
+    std::atomic<bool> sampleAccurateMidi = false;
+
+    // Stops running pd while the input and output are silent, until audio, midi or a message arrives
+    // Timing objects like [metro] don't advance while pd is asleep
+    std::atomic<bool> autoSleep = false;
+
     int lastTab = -1;
     
     bool settingsChangedInternally = false;
@@ -163,33 +217,128 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
 #if PLUGDATA_STANDALONE
     std::atomic<float> standaloneParams[numParameters] = {0};
     OwnedArray<MidiOutput> midiOutputs;
+
+    // Sets a parameter from the automation panel, it will be sent to pd on the next tick
+    void setStandaloneParameter(int idx, float value);
 #endif
     
    private:
     void processInternal();
+    void processInternalDirect(int offset);
+    void prepareTick();
+    void syncStagingBuffer();
+
+    // Runs in pd's sample type, which is either float or double depending on PD_FLOATSIZE
+    void processSamples(AudioBuffer<t_sample>& buffer, MidiBuffer& midiMessages);
+
+    static bool isSilent(AudioBuffer<t_sample> const& buffer, int startChannel, int numChannels);
+
+    // Seconds of silence after the tail before pd goes to sleep
+    static constexpr float autoSleepDelay = 0.5f;
+    static constexpr float silenceThreshold = 1e-6f;
+    int64 silentSamples = 0;
+    bool sleeping = false;
+
+    // Set while the host renders offline. Messages and the playhead are then handled once per host block instead of every tick, and the editor isn't updated
+    std::atomic<bool> bouncing = false;
     
     int audioAdvancement = 0;
-    std::vector<float> audioBufferIn;
-    std::vector<float> audioBufferOut;
+    bool stagingBufferOutdated = false;
+
+    // Starts the staging buffers on a cache line, pd's block size is a multiple of 64 samples so every channel after the first one does too
+    template<typename T>
+    struct CacheAlignedAllocator {
+        using value_type = T;
+        static constexpr std::align_val_t alignment { 64 };
+
+        CacheAlignedAllocator() = default;
+        template<typename U>
+        CacheAlignedAllocator(CacheAlignedAllocator<U> const&) noexcept { }
+
+        T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), alignment)); }
+        void deallocate(T* p, size_t) noexcept { ::operator delete(p, alignment); }
+
+        template<typename U>
+        bool operator==(CacheAlignedAllocator<U> const&) const noexcept { return true; }
+        template<typename U>
+        bool operator!=(CacheAlignedAllocator<U> const&) const noexcept { return false; }
+    };
+
+    // One block per channel, one after another
+    std::vector<t_sample, CacheAlignedAllocator<t_sample>> audioBufferIn;
+    std::vector<t_sample, CacheAlignedAllocator<t_sample>> audioBufferOut;
+
+#if PD_FLOATSIZE == 64
+    // Used to convert the buffer when the host calls the single precision processBlock
+    AudioBuffer<double> conversionBuffer;
+#endif
 
     MidiBuffer midiBufferIn;
     MidiBuffer midiBufferOut;
     MidiBuffer midiBufferTemp;
-    MidiBuffer midiBufferCopy;
 
     bool midiByteIsSysex = false;
     uint8 midiByteBuffer[512] = {0};
     size_t midiByteIndex = 0;
 
-    std::array<float, numParameters> lastParameters = {0};
+    // Written by the host's automation thread and by pd
+    std::array<std::atomic<float>, numParameters> lastParameters = {};
     std::array<float, numParameters> changeGestureState = {0};
 
-    std::vector<pd::Atom> atoms_playhead;
+    // param1 to param512 receivers, looked up once so automation doesn't need to format strings
+    std::array<t_symbol*, numParameters> parameterSymbols;
+
+#if PLUGDATA_STANDALONE
+    // One bit per parameter that changed since the last tick
+    std::array<std::atomic<uint64>, numParameters / 64> dirtyParameters = {};
+#endif
+
+    // One bit per parameter that changed since the last block, for [param~]
+    std::array<std::atomic<uint64>, numParameters / 64> rampedParameters = {};
+
+    // Looked up once, because sendPlayhead runs on every block
+    struct PlayheadSymbols
+    {
+        t_symbol* receiver;
+        t_symbol* playing;
+        t_symbol* recording;
+        t_symbol* looping;
+        t_symbol* edittime;
+        t_symbol* framerate;
+        t_symbol* bpm;
+        t_symbol* lastbar;
+        t_symbol* timesig;
+        t_symbol* position;
+    };
+
+    PlayheadSymbols playheadSymbols;
+    AudioPlayHead::PositionInfo lastPlayheadInfo;
+    t_pd* lastPlayheadReceiver = nullptr;
+    int playheadRefreshCountdown = 0;
 
     int minIn = 2;
     int minOut = 2;
     
-    std::unique_ptr<dsp::Oversampling<float>> oversampler;
+    // One oversampler per factor, created when first needed and kept until the channel count, block size or filter changes
+    dsp::Oversampling<t_sample>* getOversampler(int factor, int numChannels, int maxBlockSize);
+    void updateLatency();
+
+    std::array<std::unique_ptr<dsp::Oversampling<t_sample>>, 4> oversamplers;
+    dsp::Oversampling<t_sample>* oversampler = nullptr;
+    int oversamplerNumChannels = 0;
+    int oversamplerBlockSize = 0;
+    int oversamplerFilter = 0;
+
+    int userLatency = 64;
+    int oversamplingLatency = 0;
+
+    // Declared by the patches in pd samples, at the oversampled rate
+    std::map<String, float> patchLatencies;
+    std::atomic<float> patchLatency = 0.0f;
+    t_symbol* latencyOutSymbol = nullptr;
+
+    // Records the final output, fed at the end of every block
+    AudioRecorder recorder;
 
     const CriticalSection* audioLock;
     
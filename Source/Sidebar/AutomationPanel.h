@@ -11,12 +11,10 @@ struct AutomationSlider : public Component, public Value::Listener {
     PlugDataAudioProcessor* pd;
     
     AutomationSlider(int idx, PlugDataAudioProcessor* processor)
-        : index(idx), pd(processor)
+        : pd(processor)
     {
         createButton.setName("statusbar:createbutton");
 
-        nameLabel.setText(String(idx + 1), dontSendNotification);
-
         createButton.onClick = [this]() mutable {
             if (auto* editor = dynamic_cast<PlugDataPluginEditor*>(pd->getActiveEditor())) {
                 auto* cnv = editor->getCurrentCanvas();
@@ -34,12 +32,10 @@ struct AutomationSlider : public Component, public Value::Listener {
         slider.setTextBoxStyle(Slider::NoTextBox, false, 45, 13);
 
 #if PLUGDATA_STANDALONE
-        slider.setValue(pd->standaloneParams[index]);
         slider.setRange(0.0f, 1.0f);
-        valueLabel.setText(String(pd->standaloneParams[index], 2), dontSendNotification);
         slider.onValueChange = [this]() mutable {
             float value = slider.getValue();
-            pd->standaloneParams[index] = value;
+            pd->setStandaloneParameter(index, value);
             valueLabel.setText(String(value, 2), dontSendNotification);
         };
 #else
@@ -47,10 +43,6 @@ struct AutomationSlider : public Component, public Value::Listener {
             float value = slider.getValue();
             valueLabel.setText(String(value, 2), dontSendNotification);
         };
-        auto* param = pd->parameters.getParameter("param" + String(index + 1));
-        auto range = param->getNormalisableRange().getRange();
-        attachment = std::make_unique<SliderParameterAttachment>(*param, slider, nullptr);
-        valueLabel.setText(String(param->getValue(), 2), dontSendNotification);
 #endif
         valueLabel.onEditorShow = [this]() mutable {
             if (auto* editor = valueLabel.getCurrentTextEditor()) {
@@ -73,7 +65,34 @@ struct AutomationSlider : public Component, public Value::Listener {
         addAndMakeVisible(slider);
         addAndMakeVisible(valueLabel);
         addAndMakeVisible(createButton);
+
+        setIndex(idx);
     }
+
+    // Rows are reused by the list while scrolling, so they can be moved to another parameter
+    void setIndex(int idx)
+    {
+        index = idx;
+        nameLabel.setText(String(idx + 1), dontSendNotification);
+
+#if PLUGDATA_STANDALONE
+        updateValue();
+#else
+        auto* param = pd->parameters.getParameter("param" + String(index + 1));
+        attachment.reset();
+        attachment = std::make_unique<SliderParameterAttachment>(*param, slider, nullptr);
+        valueLabel.setText(String(param->getValue(), 2), dontSendNotification);
+#endif
+    }
+
+#if PLUGDATA_STANDALONE
+    void updateValue()
+    {
+        float value = pd->standaloneParams[index];
+        slider.setValue(value, dontSendNotification);
+        valueLabel.setText(String(value, 2), dontSendNotification);
+    }
+#endif
     
     ~AutomationSlider() {
         //pd->locked.removeListener(this);
@@ -116,46 +135,51 @@ struct AutomationSlider : public Component, public Value::Listener {
 #endif
 };
 
-struct AutomationComponent : public Component {
-    PlugDataAudioProcessor* pd;
-
-    explicit AutomationComponent(PlugDataAudioProcessor* processor)
+// Only the visible rows exist, the list reuses them for other parameters while scrolling
+struct AutomationPanel : public Component
+    , public ListBoxModel
+    , public ScrollBar::Listener {
+    explicit AutomationPanel(PlugDataAudioProcessor* processor)
         : pd(processor)
     {
-        for (int p = 0; p < PlugDataAudioProcessor::numParameters; p++) {
-            auto* slider = rows.add(new AutomationSlider(p, processor));
-            addAndMakeVisible(slider);
-        }
+        listBox.setModel(this);
+        listBox.setRowHeight(23);
+        listBox.setOutlineThickness(0);
+        listBox.setColour(ListBox::backgroundColourId, Colours::transparentBlack);
+        listBox.getViewport()->setScrollBarsShown(true, false, false, false);
+
+        listBox.getViewport()->getVerticalScrollBar().addListener(this);
+
+        setWantsKeyboardFocus(false);
+        listBox.setWantsKeyboardFocus(false);
+
+        addAndMakeVisible(listBox);
     }
 
-    void resized() override
+    int getNumRows() override
     {
-        int height = 23;
-        int y = 0;
-        for (int p = 0; p < PlugDataAudioProcessor::numParameters; p++) {
-            auto rect = Rectangle<int>(0, y, getWidth(), height);
-            y += height;
-            rows[p]->setBounds(rect);
-        }
+        return PlugDataAudioProcessor::numParameters;
     }
 
-    OwnedArray<AutomationSlider> rows;
-};
-
-struct AutomationPanel : public Component
-    , public ScrollBar::Listener {
-    explicit AutomationPanel(PlugDataAudioProcessor* processor)
-        : sliders(processor)
+    void paintListBoxItem(int rowNumber, Graphics& g, int w, int h, bool rowIsSelected) override
     {
-        viewport.setViewedComponent(&sliders, false);
-        viewport.setScrollBarsShown(true, false, false, false);
+    }
 
-        viewport.getVerticalScrollBar().addListener(this);
+    Component* refreshComponentForRow(int rowNumber, bool isRowSelected, Component* existingComponentToUpdate) override
+    {
+        if (!isPositiveAndBelow(rowNumber, getNumRows())) {
+            delete existingComponentToUpdate;
+            return nullptr;
+        }
 
-        setWantsKeyboardFocus(false);
-        viewport.setWantsKeyboardFocus(false);
+        if (auto* row = dynamic_cast<AutomationSlider*>(existingComponentToUpdate)) {
+            if (row->index != rowNumber)
+                row->setIndex(rowNumber);
+            return row;
+        }
 
-        addAndMakeVisible(viewport);
+        delete existingComponentToUpdate;
+        return new AutomationSlider(rowNumber, pd);
     }
 
     void scrollBarMoved(ScrollBar* scrollBarThatHasMoved, double newRangeStart) override
@@ -167,11 +191,11 @@ struct AutomationPanel : public Component
     {
         g.setColour(findColour(PlugDataColour::toolbarBackgroundColourId));
         g.fillRect(getLocalBounds().withTrimmedLeft(Sidebar::dragbarWidth).withTrimmedBottom(30));
-        g.fillRect(getLocalBounds().withHeight(viewport.getY()));
+        g.fillRect(getLocalBounds().withHeight(listBox.getY()));
 
         g.setColour(findColour(PlugDataColour::sidebarTextColourId));
         g.setFont(14);
-        g.drawFittedText("Parameters", 0, 1, getWidth(), viewport.getY(), Justification::centred, 1);
+        g.drawFittedText("Parameters", 0, 1, getWidth(), listBox.getY(), Justification::centred, 1);
         
         // Background for statusbar part
         g.setColour(findColour(PlugDataColour::toolbarBackgroundColourId));
@@ -183,19 +207,19 @@ struct AutomationPanel : public Component
 
     void resized() override
     {
-        viewport.setBounds(getLocalBounds().withTrimmedTop(28).withTrimmedBottom(30));
-        sliders.setSize(getWidth(), PlugDataAudioProcessor::numParameters * 23);
+        listBox.setBounds(getLocalBounds().withTrimmedTop(28).withTrimmedBottom(30));
     }
 
 #if PLUGDATA_STANDALONE
-    void updateParameters()
+    // Parameters that aren't scrolled into view get their value when their row is created
+    void updateParameter(int index)
     {
-        for (int p = 0; p < PlugDataAudioProcessor::numParameters; p++) {
-            sliders.rows[p]->slider.setValue(sliders.pd->standaloneParams[p]);
+        if (auto* row = dynamic_cast<AutomationSlider*>(listBox.getComponentForRowNumber(index))) {
+            row->updateValue();
         }
     }
 #endif
 
-    Viewport viewport;
-    AutomationComponent sliders;
+    PlugDataAudioProcessor* pd;
+    ListBox listBox;
 };
@@ -4,6 +4,8 @@
  // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
  */
 
+#include <set>
+
 struct Console : public Component {
     explicit Console(pd::Instance* instance)
     {
@@ -88,116 +90,16 @@ struct Console : public Component {
         repaint();
     }
 
-    void paint(Graphics& g) override
-    {
-        // Draw background if we don't have enough messages to fill the panel
-        auto h = 24;
-        auto y = console->getTotalHeight();
-        auto idx = static_cast<int>(console->messages.size());
-        while (y < console->getHeight()) {
-
-            if (y + h > console->getHeight()) {
-                h = console->getHeight() - y;
-            }
-
-            idx++;
-            y += h;
-        }
-    }
-
+    // Only paints the messages that are visible, so the number of messages doesn't affect the GUI
     struct ConsoleComponent : public Component {
-        struct ConsoleMessage : public Component {
-            int idx;
-            ConsoleComponent& console;
-
-            ConsoleMessage(int index, ConsoleComponent& parent)
-                : idx(index)
-                , console(parent)
-            {
-
-                parent.addAndMakeVisible(this);
-            }
-
-            void mouseDown(MouseEvent const& e)
-            {
-                if(!e.mods.isShiftDown() && !e.mods.isCommandDown()) {
-                    console.selectedItems.clear();
-                }
-                
-                console.selectedItems.addIfNotAlreadyThere(SafePointer(this));
-                console.repaint();
-            }
-
-            void paint(Graphics& g)
-            {
-                auto font = Font(Font::getDefaultSansSerifFontName(), 13, 0);
-                g.setFont(font);
-
-                bool isSelected = console.selectedItems.contains(this);
-                
-                bool showMessages = console.buttons[2].getToggleState();
-                bool showErrors = console.buttons[3].getToggleState();
-
-                if(isSelected) {
-                    // Draw selected background
-                    g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
-                    g.fillRoundedRectangle(getLocalBounds().reduced(6, 2).toFloat(), Constants::smallCornerRadius);
-                    
-                    bool connectedOnTop = false;
-                    bool connectedOnBottom = false;
-                    for(auto& item : console.selectedItems) {
-                        
-                        if(!item.getComponent()) return;
-                        // Draw connected on top
-                        if(item->idx == idx - 1)  {
-                            g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
-                            g.fillRect(getLocalBounds().reduced(6, 0).toFloat().withTrimmedBottom(5));
-                            
-                            g.setColour(findColour(PlugDataColour::outlineColourId));
-                            g.drawLine(10, 0, getWidth() - 10, 0);
-                        }
-                        
-                        // Draw connected on bottom
-                        if(item->idx == idx + 1)  {
-                            g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
-                            g.fillRect(getLocalBounds().reduced(6, 0).toFloat().withTrimmedTop(5));
-                        }
-                    }
-                }
-
-                // Get console message
-                auto& [message, type, length] = console.pd->getConsoleMessages()[idx];
-
-                // Check if message type should be visible
-                if ((type == 1 && !showMessages) || (type == 0 && !showErrors)) {
-                    return;
-                }
-
-                // Approximate number of lines from string length and current width
-                auto numLines = getNumLines(console.getWidth(), length);
-
-                auto textColour = findColour(isSelected ? PlugDataColour::sidebarActiveTextColourId : PlugDataColour::sidebarTextColourId);
-                
-                if (type == 1)
-                    textColour = Colours::orange;
-                else if (type == 2)
-                    textColour = Colours::red;
-                
-                // Draw text
-                g.setColour(textColour);
-                g.drawFittedText(message, getLocalBounds().reduced(6, 0).withTrimmedLeft(8), Justification::centredLeft, numLines, 1.0f);
-            }
-        };
-
-        std::deque<std::unique_ptr<ConsoleMessage>> messages;
-
         std::array<TextButton, 5>& buttons;
         Viewport& viewport;
 
         pd::Instance* pd; // instance to get console messages from
 
-        Array<SafePointer<ConsoleMessage>> selectedItems;
-        
+        // Selected messages, by their number in the order they were logged, so they stay stable when old messages get dropped
+        std::set<uint64> selectedItems;
+
         ConsoleComponent(pd::Instance* instance, std::array<TextButton, 5>& b, Viewport& v)
             : buttons(b)
             , viewport(v)
@@ -217,57 +119,30 @@ struct Console : public Component {
         {
             // Copy from console
             if (key == KeyPress('c', ModifierKeys::commandModifier, 0)) {
+                auto& messages = pd->getConsoleMessages();
+
                 String textToCopy;
-                for(auto& item : selectedItems) {
-                    if(!item.getComponent()) continue;
-                    textToCopy += std::get<0>(pd->getConsoleMessages()[item->idx]) + "\n";
+                for (auto& item : selectedItems) {
+                    auto idx = getIndex(item);
+                    if (isPositiveAndBelow(idx, static_cast<int>(messages.size()))) {
+                        textToCopy += std::get<0>(messages[idx]) + "\n";
+                    }
                 }
-                
+
                 textToCopy.trimEnd();
                 SystemClipboard::copyTextToClipboard(textToCopy);
                 return true;
             }
-           
+
             return false;
         }
 
         void update()
         {
-            while (messages.size() > pd->getConsoleMessages().size() || messages.size() >= 800) {
-                messages.pop_front();
-
-                // Make sure we don't trigger a repaint for all messages when the console is full
-                for (int row = 0; row < static_cast<int>(messages.size()); row++) {
-                    messages[row]->idx--;
-                }
-            }
-
-            while (messages.size() < pd->getConsoleMessages().size()) {
-                messages.push_back(std::make_unique<ConsoleMessage>(messages.size(), *this));
-            }
-
-            auto showMessages = buttons[2].getToggleState();
-            auto showErrors = buttons[3].getToggleState();
-
-            int totalHeight = 0;
-            for (int row = 0; row < static_cast<int>(pd->getConsoleMessages().size()); row++) {
-                auto [message, type, length] = pd->getConsoleMessages()[row];
-                auto numLines = getNumLines(getWidth(), length);
-                auto height = numLines * 22 + 4;
-
-                if (messages[row]->idx != row) {
-                    messages[row]->idx = row;
-                    messages[row]->repaint();
-                }
-
-                if ((type == 1 && !showMessages) || (length == 0 && !showErrors))
-                    continue;
-
-                totalHeight += std::max(0, height);
-            }
+            updateLayout();
 
             setSize(getWidth(), std::max<int>(getTotalHeight(), viewport.getHeight()));
-            resized();
+            repaint();
 
             if (buttons[4].getToggleState()) {
                 viewport.setViewPositionProportionately(0.0f, 1.0f);
@@ -276,64 +151,232 @@ struct Console : public Component {
 
         void clear()
         {
-            pd->getConsoleHistory().insert(pd->getConsoleHistory().end(), pd->getConsoleMessages().begin(), pd->getConsoleMessages().end());
-            pd->getConsoleMessages().clear();
+            auto& messages = pd->getConsoleMessages();
+            auto& history = pd->getConsoleHistory();
+
+            for (size_t i = 0; i < messages.size(); i++) {
+                history.push_back(messages[i]);
+            }
+
+            messages.clear();
+            needsFullLayout = true;
             update();
         }
 
         void restore()
         {
-            pd->getConsoleMessages().insert(pd->getConsoleMessages().begin(), pd->getConsoleHistory().begin(), pd->getConsoleHistory().end());
-            pd->getConsoleHistory().clear();
+            auto& messages = pd->getConsoleMessages();
+            auto& history = pd->getConsoleHistory();
+
+            auto restored = pd::Instance::ConsoleMessages(messages.capacity());
+            for (size_t i = 0; i < history.size(); i++) {
+                restored.push_back(history[i]);
+            }
+            for (size_t i = 0; i < messages.size(); i++) {
+                restored.push_back(messages[i]);
+            }
+
+            messages = std::move(restored);
+            history.clear();
+
+            selectedItems.clear();
+            needsFullLayout = true;
             update();
         }
 
         // Get total height of messages, also taking multi-line messages into account
         int getTotalHeight()
         {
-            auto showMessages = buttons[2].getToggleState();
-            auto showErrors = buttons[3].getToggleState();
-
-            auto font = Font(Font::getDefaultSansSerifFontName(), 13, 0);
-            auto totalHeight = 0;
+            if (rowTops.empty())
+                return 0;
 
-            for (auto& [message, type, length] : pd->getConsoleMessages()) {
-                auto numLines = getNumLines(getWidth(), length);
-                auto height = numLines * 22 + 4;
+            return static_cast<int>(getRowTop(rowTops.size() - 1) + getRowHeight(rowTops.size() - 1));
+        }
 
-                if ((type == 1 && !showMessages) || (length == 0 && !showErrors))
-                    continue;
+        void mouseDown(MouseEvent const& e) override
+        {
+            if (!e.mods.isShiftDown() && !e.mods.isCommandDown()) {
+                selectedItems.clear();
+            }
 
-                totalHeight += std::max(0, height);
+            auto row = getRowAt(e.y);
+            if (row >= 0) {
+                selectedItems.insert(getMessageNumber(row));
             }
 
-            return totalHeight;
-        }
-        
-        void mouseDown(const MouseEvent& e) override
-        {
-            selectedItems.clear();
             repaint();
         }
 
         void resized() override
         {
-            int totalHeight = 2;
-            for (int row = 0; row < static_cast<int>(pd->getConsoleMessages().size()); row++) {
-                if (row >= messages.size())
+            if (getWidth() != layoutWidth) {
+                needsFullLayout = true;
+                updateLayout();
+                setSize(getWidth(), std::max<int>(getTotalHeight(), viewport.getHeight()));
+            }
+        }
+
+        void paint(Graphics& g) override
+        {
+            auto& messages = pd->getConsoleMessages();
+            if (rowTops.size() != messages.size())
+                return;
+
+            auto font = Font(Font::getDefaultSansSerifFontName(), 13, 0);
+            g.setFont(font);
+
+            auto clip = g.getClipBounds();
+
+            for (int row = std::max(getRowAt(clip.getY()), 0); row < static_cast<int>(messages.size()); row++) {
+                auto top = static_cast<int>(getRowTop(row));
+                if (top >= clip.getBottom())
                     break;
 
-                auto& [message, type, length] = pd->getConsoleMessages()[row];
+                auto height = getRowHeight(row);
+                if (height == 0)
+                    continue;
+
+                auto& [message, type, length] = messages[row];
+                auto bounds = Rectangle<int>(0, top, getWidth(), height);
+
+                auto number = getMessageNumber(row);
+                bool isSelected = selectedItems.count(number);
+
+                if (isSelected) {
+                    // Draw selected background
+                    g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
+                    g.fillRoundedRectangle(bounds.reduced(6, 2).toFloat(), Constants::smallCornerRadius);
+
+                    // Draw connected on top
+                    if (selectedItems.count(number - 1)) {
+                        g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
+                        g.fillRect(bounds.reduced(6, 0).toFloat().withTrimmedBottom(5));
 
+                        g.setColour(findColour(PlugDataColour::outlineColourId));
+                        g.drawLine(10, top, getWidth() - 10, top);
+                    }
+
+                    // Draw connected on bottom
+                    if (selectedItems.count(number + 1)) {
+                        g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
+                        g.fillRect(bounds.reduced(6, 0).toFloat().withTrimmedTop(5));
+                    }
+                }
+
+                // Approximate number of lines from string length and current width
                 auto numLines = getNumLines(getWidth(), length);
-                auto height = numLines * 22 + 4;
 
-                messages[row]->setBounds(0, totalHeight, getWidth(), height);
+                auto textColour = findColour(isSelected ? PlugDataColour::sidebarActiveTextColourId : PlugDataColour::sidebarTextColourId);
+
+                if (type == 1)
+                    textColour = Colours::orange;
+                else if (type == 2)
+                    textColour = Colours::red;
 
-                totalHeight += height;
+                // Draw text
+                g.setColour(textColour);
+                g.drawFittedText(message, bounds.reduced(6, 0).withTrimmedLeft(8), Justification::centredLeft, numLines, 1.0f);
             }
         }
-        
+
+    private:
+        // Keeps the position of every message, only the new ones need to be laid out after messages are added
+        void updateLayout()
+        {
+            auto& messages = pd->getConsoleMessages();
+
+            bool showErrors = buttons[2].getToggleState();
+            bool showMessages = buttons[3].getToggleState();
+
+            if (showErrors != layoutShowErrors || showMessages != layoutShowMessages) {
+                layoutShowErrors = showErrors;
+                layoutShowMessages = showMessages;
+                needsFullLayout = true;
+            }
+
+            auto numNew = messages.getNumPushed() - numLaidOut;
+
+            // Both buffers have the same capacity, so they drop old entries at the same time
+            size_t firstNew = messages.size() - std::min<uint64>(numNew, messages.size());
+            bool canAppend = !needsFullLayout && numNew <= messages.size() && std::min<uint64>(rowTops.size() + numNew, rowTops.capacity()) == messages.size();
+
+            if (!canAppend) {
+                rowTops = RingBuffer<int64>(messages.capacity());
+                nextRowTop = 0;
+                firstNew = 0;
+                needsFullLayout = false;
+            }
+            // The last message can get longer when repeats of it are counted
+            else if (firstNew > 0 && !rowTops.empty()) {
+                nextRowTop = rowTops.back() + getRowHeight(firstNew - 1);
+            }
+
+            for (auto row = firstNew; row < messages.size(); row++) {
+                rowTops.push_back(nextRowTop);
+                nextRowTop += getRowHeight(row);
+            }
+
+            numLaidOut = messages.getNumPushed();
+            layoutWidth = getWidth();
+        }
+
+        int getRowHeight(size_t row)
+        {
+            auto& [message, type, length] = pd->getConsoleMessages()[row];
+
+            // Check if message type should be visible
+            if ((type != 0 && !layoutShowErrors) || (type == 0 && !layoutShowMessages))
+                return 0;
+
+            auto numLines = getNumLines(getWidth(), length);
+            return std::max(0, numLines * 22 + 4);
+        }
+
+        int64 getRowTop(size_t row)
+        {
+            return rowTops[row] - rowTops.front() + 2;
+        }
+
+        // Returns -1 if there's no message at this height
+        int getRowAt(int y)
+        {
+            int low = 0, high = static_cast<int>(rowTops.size()) - 1, found = -1;
+            while (low <= high) {
+                int mid = (low + high) / 2;
+                if (getRowTop(mid) <= y) {
+                    found = mid;
+                    low = mid + 1;
+                } else {
+                    high = mid - 1;
+                }
+            }
+
+            if (found >= 0 && y >= getRowTop(found) + getRowHeight(found))
+                return -1;
+
+            return found;
+        }
+
+        uint64 getMessageNumber(int row)
+        {
+            auto& messages = pd->getConsoleMessages();
+            return messages.getNumPushed() - messages.size() + row;
+        }
+
+        int getIndex(uint64 messageNumber)
+        {
+            auto& messages = pd->getConsoleMessages();
+            return static_cast<int>(static_cast<int64>(messageNumber) - static_cast<int64>(messages.getNumPushed() - messages.size()));
+        }
+
+        RingBuffer<int64> rowTops = RingBuffer<int64>(pd::Instance::maxConsoleMessages);
+        uint64 numLaidOut = 0;
+        int64 nextRowTop = 0;
+        bool needsFullLayout = true;
+        int layoutWidth = -1;
+        bool layoutShowErrors = true;
+        bool layoutShowMessages = true;
+
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ConsoleComponent)
     };
 
@@ -9,6 +9,7 @@
 // 2. Improve simplicity and efficiency by not using OS file icons (they look bad anyway)
 
 #include "../Utility/FileSystemWatcher.h"
+#include "../Utility/Tracer.h"
 
 
 #if JUCE_WINDOWS
@@ -470,15 +471,183 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DocumentBrowserView)
 };
 
+// List of all patches below a directory, kept and searched on the browser's update thread
+// Search results are delivered in batches on the message thread, a new query cancels the previous one
+class FileSearchIndex : public TimeSliceClient {
+public:
+    // Called with the results of each batch, and once more with finished set when the search is done
+    std::function<void(Array<File> const& wholeWordMatches, Array<File> const& matches, bool finished)> onResults;
+
+    FileSearchIndex(TimeSliceThread& thread)
+        : updateThread(thread)
+    {
+        updateThread.addTimeSliceClient(this);
+    }
+
+    ~FileSearchIndex() override
+    {
+        updateThread.removeTimeSliceClient(this);
+    }
+
+    void setDirectory(File const& newDirectory)
+    {
+        ScopedLock lock(queryLock);
+        if (newDirectory == directory)
+            return;
+
+        directory = newDirectory;
+        rescan();
+    }
+
+    // Call when the contents of the directory changed
+    void rescan()
+    {
+        needsRescan = true;
+        updateThread.moveToFrontOfQueue(this);
+    }
+
+    // Starts a new search, results from earlier searches won't be delivered anymore
+    void search(String const& newQuery)
+    {
+        ScopedLock lock(queryLock);
+        query = newQuery;
+        generation++;
+        updateThread.moveToFrontOfQueue(this);
+    }
+
+    int useTimeSlice() override
+    {
+        TRACE_ZONE("FileSearchIndex");
+
+        if (needsRescan.exchange(false)) {
+            File root;
+            {
+                ScopedLock lock(queryLock);
+                root = directory;
+            }
+
+            std::vector<Entry> newEntries;
+            for (auto const& iter : RangedDirectoryIterator(root, true, "*.pd")) {
+                // Start over if the directory changed again in the meantime
+                if (needsRescan || updateThread.threadShouldExit())
+                    return 0;
+
+                auto file = iter.getFile();
+                newEntries.push_back({ file, file.getFileName(), file.getFileName().toLowerCase().toStdString() });
+            }
+
+            entries = std::move(newEntries);
+
+            // Search the new entries again
+            searchedGeneration = -1;
+        }
+
+        String currentQuery;
+        int currentGeneration;
+        {
+            ScopedLock lock(queryLock);
+            currentQuery = query;
+            currentGeneration = generation;
+        }
+
+        if (currentGeneration != searchedGeneration) {
+            searchedGeneration = currentGeneration;
+            searchPosition = 0;
+        } else if (searchPosition >= entries.size()) {
+            return 500; // Nothing to do
+        }
+
+        if (currentQuery.isEmpty()) {
+            searchPosition = entries.size();
+            return 500;
+        }
+
+        auto const lowercaseQuery = currentQuery.toLowerCase().toStdString();
+        auto const end = std::min(searchPosition + batchSize, entries.size());
+
+        Array<File> wholeWordMatches, matches;
+        for (; searchPosition < end; searchPosition++) {
+            auto const& entry = entries[searchPosition];
+            if (entry.lowercaseName.find(lowercaseQuery) == std::string::npos)
+                continue;
+
+            if (entry.fileName.containsWholeWordIgnoreCase(currentQuery)) {
+                wholeWordMatches.add(entry.file);
+            } else {
+                matches.add(entry.file);
+            }
+        }
+
+        bool const finished = searchPosition >= entries.size();
+        if (!wholeWordMatches.isEmpty() || !matches.isEmpty() || finished) {
+            MessageManager::callAsync([this, weak = WeakReference<FileSearchIndex>(this), wholeWordMatches, matches, finished, currentGeneration]() {
+                if (!weak)
+                    return;
+
+                // Results of a cancelled search
+                {
+                    ScopedLock lock(queryLock);
+                    if (currentGeneration != generation)
+                        return;
+                }
+
+                if (onResults)
+                    onResults(wholeWordMatches, matches, finished);
+            });
+        }
+
+        return finished ? 500 : 0;
+    }
+
+private:
+    struct Entry {
+        File file;
+        String fileName;
+        std::string lowercaseName;
+    };
+
+    static constexpr size_t batchSize = 1024;
+
+    TimeSliceThread& updateThread;
+
+    CriticalSection queryLock;
+    File directory;
+    String query;
+    int generation = 0;
+
+    std::atomic<bool> needsRescan = false;
+
+    // Only used on the update thread
+    std::vector<Entry> entries;
+    size_t searchPosition = 0;
+    int searchedGeneration = -1;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(FileSearchIndex)
+};
+
 class FileSearchComponent : public Component
     , public ListBoxModel
     , public ScrollBar::Listener
     , public KeyListener
 {
 public:
-    FileSearchComponent(DirectoryContentsList& directory)
+    FileSearchComponent(DirectoryContentsList& directory, TimeSliceThread& thread)
         : searchPath(directory)
+        , searchIndex(thread)
     {
+        searchIndex.onResults = [this](Array<File> const& wholeWordMatches, Array<File> const& matches, bool finished) {
+            // Whole word matches go before all other matches
+            for (auto& file : wholeWordMatches)
+                searchResult.insert(numWholeWordMatches++, file);
+
+            searchResult.addArray(matches);
+
+            listBox.updateContent();
+
+            if (listBox.getSelectedRow() == -1)
+                listBox.selectRow(0, true, true);
+        };
+
         listBox.setModel(this);
         listBox.setRowHeight(28);
         listBox.setOutlineThickness(0);
@@ -606,47 +775,26 @@ public:
     void clearSearchResults()
     {
         searchResult.clear();
+        numWholeWordMatches = 0;
     }
 
     void updateResults(String query)
     {
         clearSearchResults();
+        listBox.updateContent();
 
-        if (query.isEmpty())
-            return;
-
-        auto addFile = [this, &query](File const& file) {
-            auto fileName = file.getFileName();
-
-            if (!file.hasFileExtension("pd"))
-                return;
-
-            // Insert in front if the query matches a whole word
-            if (fileName.containsWholeWordIgnoreCase(query)) {
-                searchResult.insert(0, file);
-            }
-            // Insert in back if it contains the query
-            else if (fileName.containsIgnoreCase(query)) {
-                searchResult.add(file);
-            }
-        };
-
-        for (int i = 0; i < searchPath.getNumFiles(); i++) {
-            auto file = searchPath.getFile(i);
-
-            if (file.isDirectory()) {
-                for (auto& child : RangedDirectoryIterator(file, true)) {
-                    addFile(child.getFile());
-                }
-            } else {
-                addFile(file);
-            }
-        }
+        // Results will come in from the update thread
+        searchIndex.setDirectory(searchPath.getDirectory());
+        searchIndex.search(query);
+    }
 
-        listBox.updateContent();
+    // Call when files in the directory changed
+    void rescan()
+    {
+        searchIndex.rescan();
 
-        if (listBox.getSelectedRow() == -1)
-            listBox.selectRow(0, true, true);
+        if (input.getText().isNotEmpty())
+            updateResults(input.getText());
     }
 
     bool hasSelection()
@@ -690,6 +838,8 @@ private:
 
     DirectoryContentsList& searchPath;
     Array<File> searchResult;
+    int numWholeWordMatches = 0;
+    FileSearchIndex searchIndex;
     TextEditor input;
     TextButton closeButton = TextButton(Icons::Clear);
 };
@@ -699,7 +849,7 @@ struct DocumentBrowser : public DocumentBrowserBase
     DocumentBrowser(PlugDataAudioProcessor* processor)
         : DocumentBrowserBase(processor)
         , fileList(directory, this)
-        , searchComponent(directory)
+        , searchComponent(directory, updateThread)
     {
         auto location = File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory).getChildFile("plugdata").getChildFile("Library");
 
@@ -792,6 +942,7 @@ struct DocumentBrowser : public DocumentBrowserBase
     {
         directory.refresh();
         fileList.refresh();
+        searchComponent.rescan();
     }
 
     bool isSearching() override
@@ -6,11 +6,20 @@
 
 #include "../Utility/PropertiesPanel.h"
 
-struct Inspector : public Component {
+// The panel is only built once the inspector is actually on screen, selecting many objects in a row only builds it for the last one
+// Selecting an object with the same parameters as the one before keeps the panel and only points it at the new values
+struct Inspector : public Component
+    , public AsyncUpdater {
 
     PropertiesPanel panel;
     String title;
 
+    ObjectParameters pendingParameters;
+    bool needsUpdate = false;
+
+    Array<PropertiesPanel::Property*> properties; // owned by the panel, in the same order as the parameters
+    String layout;
+
     Inspector()
     {
         addAndMakeVisible(panel);
@@ -31,14 +40,25 @@ struct Inspector : public Component {
     void resized() override
     {
         panel.setBounds(getLocalBounds().withTrimmedTop(28));
+
+        // Expanding the sidebar
+        if (needsUpdate)
+            triggerAsyncUpdate();
+    }
+
+    void visibilityChanged() override
+    {
+        if (needsUpdate)
+            triggerAsyncUpdate();
     }
 
     void setTitle(String const& name)
     {
         title = name;
+        repaint();
     }
 
-    PropertyComponent* createPanel(int type, String const& name, Value* value, std::vector<String>& options)
+    PropertiesPanel::Property* createPanel(int type, String const& name, Value* value, std::vector<String>& options)
     {
         switch (type) {
         case tString:
@@ -61,20 +81,74 @@ struct Inspector : public Component {
     }
 
     void loadParameters(ObjectParameters& params)
+    {
+        pendingParameters = params;
+        needsUpdate = true;
+        triggerAsyncUpdate();
+    }
+
+    void handleAsyncUpdate() override
+    {
+        // Collapsed sidebar, or another panel is showing
+        if (!needsUpdate || !isShowing() || getWidth() <= Sidebar::dragbarWidth)
+            return;
+
+        needsUpdate = false;
+
+        auto newLayout = getLayout(pendingParameters);
+        if (newLayout == layout && properties.size() == pendingParameters.size()) {
+            for (int i = 0; i < properties.size(); i++) {
+                properties[i]->setValue(*std::get<3>(pendingParameters[i]));
+            }
+            return;
+        }
+
+        buildPanel(pendingParameters);
+        layout = newLayout;
+    }
+
+    // The parameters point to values of an object that might get deleted before the inspector is shown again
+    void discardPendingParameters()
+    {
+        cancelPendingUpdate();
+        pendingParameters.clear();
+        needsUpdate = false;
+    }
+
+    // Objects of the same class give the same names, types and options
+    static String getLayout(ObjectParameters& params)
+    {
+        String result;
+        for (auto& [name, type, category, value, options] : params) {
+            result << name << ":" << static_cast<int>(type) << ":" << static_cast<int>(category);
+            for (auto& option : options) {
+                result << ":" << option;
+            }
+            result << ";";
+        }
+        return result;
+    }
+
+    void buildPanel(ObjectParameters& params)
     {
         StringArray names = { "General", "Appearance", "Label", "Extra" };
 
         panel.clear();
 
+        properties.clear();
+        properties.resize(static_cast<int>(params.size()));
+
         for (int i = 0; i < 4; i++) {
             Array<PropertyComponent*> panels;
 
             int idx = 0;
             for (auto& [name, type, category, value, options] : params) {
                 if (static_cast<int>(category) == i) {
-                    panels.add(createPanel(type, name, value, options));
-                    idx++;
+                    auto* property = createPanel(type, name, value, options);
+                    properties.set(idx, property);
+                    panels.add(property);
                 }
+                idx++;
             }
             if (!panels.isEmpty()) {
                 panel.addSection(names[i], panels);
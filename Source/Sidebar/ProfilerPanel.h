@@ -0,0 +1,593 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <m_pd.h>
+#include <x_libpd_extra_utils.h>
+#include <x_libpd_profiler.h>
+#include <g_canvas.h>
+
+#include <unordered_set>
+
+// Lists the objects in the order pd runs them, with their block size and sample rate
+// Points out work that is likely wasted: reblocking inside clones and signal outputs that never reach an output
+class DSPChainView : public Component
+, public TableListBoxModel {
+public:
+    explicit DSPChainView(PlugDataAudioProcessor* instance)
+        : pd(instance)
+    {
+        table.setModel(this);
+        table.setRowHeight(24);
+        table.setOutlineThickness(0);
+        table.setColour(ListBox::backgroundColourId, Colours::transparentBlack);
+        table.getViewport()->setScrollBarsShown(true, false, false, false);
+
+        // The chain order is the only order that makes sense here
+        auto const flags = TableHeaderComponent::visible | TableHeaderComponent::resizable;
+        auto& header = table.getHeader();
+        header.addColumn("#", orderColumn, 30, 25, 50, flags);
+        header.addColumn("Object", objectColumn, 120, 50, -1, flags);
+        header.addColumn("Block", blockColumn, 45, 35, 70, flags);
+        header.addColumn("Rate", rateColumn, 40, 30, 60, flags);
+        header.addColumn("us/block", timeColumn, 60, 40, 90, flags);
+        header.addColumn("Notes", notesColumn, 150, 50, -1, flags);
+        header.setStretchToFitActive(true);
+
+        addAndMakeVisible(table);
+    }
+
+    // Rebuilds the dsp chain to find out its order, the profiler needs to be running
+    void update(pd::Patch* patch)
+    {
+        struct ChainEntry {
+            t_object* object;
+            t_object* parent;
+            int order;
+            int blockSize;
+            t_float sampleRate;
+            double seconds;
+        };
+
+        std::vector<ChainEntry> entries;
+
+        rows.clear();
+
+        pd->setThis();
+        pd->getCallbackLock()->enter();
+
+        libpd_profiler_getchain(&entries, [](void* userdata, t_object* obj, t_object* parent, int order, int blocksize, t_float samplerate, double meanseconds) {
+            static_cast<std::vector<ChainEntry>*>(userdata)->push_back({ obj, parent, order, blocksize, samplerate, meanseconds });
+        });
+
+        std::unordered_set<t_object*> patchObjects;
+        if (patch)
+            collectObjects(patch->getPointer(), patchObjects);
+
+        std::unordered_map<t_object*, t_object*> parents;
+        std::unordered_map<t_object*, int> numChildCanvases;
+        for (auto const& entry : entries) {
+            parents[entry.object] = entry.parent;
+            if (entry.parent && pd_class(&entry.object->ob_pd) == canvas_class)
+                numChildCanvases[entry.parent]++;
+        }
+
+        auto const baseRate = sys_getsr();
+        std::unordered_map<t_object*, bool> usedOutputs;
+
+        for (auto const& entry : entries) {
+            // Only show the current patch, objects inside clones are shown with the clone they belong to
+            auto* topLevel = entry.object;
+            int depth = 0;
+            bool inClone = false;
+            t_object* clone = nullptr;
+            while (parents.count(topLevel) && parents[topLevel]) {
+                topLevel = parents[topLevel];
+                if (String(libpd_get_object_class_name(topLevel)) == "clone") {
+                    inClone = true;
+                    clone = topLevel;
+                }
+                depth++;
+            }
+
+            if (!patchObjects.count(topLevel))
+                continue;
+
+            auto className = String::fromUTF8(libpd_get_object_class_name(entry.object));
+            String text = className;
+            if (libpd_is_text_object(entry.object)) {
+                char* objectText;
+                int len;
+                libpd_get_object_text(entry.object, &objectText, &len);
+                text = String::fromUTF8(objectText, len);
+            }
+
+            StringArray notes;
+
+            if (className == "block~" || className == "switch~") {
+                auto tokens = StringArray::fromTokens(text, false);
+                auto const overlap = std::max(1, tokens[2].getIntValue());
+                auto const upsample = std::max(1, tokens[3].getIntValue());
+
+                if (overlap > 1)
+                    notes.add("overlap " + String(overlap) + ", runs " + String(overlap) + "x as often");
+
+                if (upsample > 1 && inClone)
+                    notes.add("upsampled " + String(upsample) + "x in all " + String(numChildCanvases[clone]) + " clone instances");
+                else if (upsample > 1)
+                    notes.add("upsampled " + String(upsample) + "x");
+            }
+
+            if (obj_nsigoutlets(entry.object) > 0 && !reachesOutput(entry.object, usedOutputs)) {
+                notes.add("result is never used");
+            }
+
+            rows.push_back({ text, depth, entry.order, entry.blockSize, entry.sampleRate > 0 && baseRate > 0 ? entry.sampleRate / baseRate : 0.0, entry.seconds * 1e6, notes.joinIntoString(", ") });
+        }
+
+        pd->getCallbackLock()->exit();
+
+        table.updateContent();
+        table.repaint();
+    }
+
+    int getNumRows() override
+    {
+        return static_cast<int>(rows.size());
+    }
+
+    void paintRowBackground(Graphics& g, int rowNumber, int w, int h, bool rowIsSelected) override
+    {
+        if (rowIsSelected) {
+            g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
+            g.fillRoundedRectangle(4, 2, w - 8, h - 4, Constants::smallCornerRadius);
+        }
+    }
+
+    void paintCell(Graphics& g, int rowNumber, int columnId, int w, int h, bool rowIsSelected) override
+    {
+        if (!isPositiveAndBelow(rowNumber, rows.size()))
+            return;
+
+        auto const& row = rows[rowNumber];
+
+        g.setColour(rowIsSelected ? findColour(PlugDataColour::sidebarActiveTextColourId) : findColour(ComboBox::textColourId));
+        g.setFont(Font(13));
+
+        switch (columnId) {
+        case orderColumn:
+            g.drawText(String(row.order), 0, 0, w - 4, h, Justification::centredRight, true);
+            break;
+        case objectColumn:
+            g.drawText(row.text, 8 + row.depth * 10, 0, w - 8 - row.depth * 10, h, Justification::centredLeft, true);
+            break;
+        case blockColumn:
+            g.drawText(row.blockSize > 0 ? String(row.blockSize) : "-", 0, 0, w - 4, h, Justification::centredRight, true);
+            break;
+        case rateColumn:
+            g.drawText(row.rate > 0.0 ? String(row.rate, 2) + "x" : "-", 0, 0, w - 4, h, Justification::centredRight, true);
+            break;
+        case timeColumn:
+            g.drawText(String(row.microseconds, 1), 0, 0, w - 8, h, Justification::centredRight, true);
+            break;
+        case notesColumn:
+            g.setColour(findColour(PlugDataColour::signalColourId));
+            g.drawText(row.notes, 8, 0, w - 8, h, Justification::centredLeft, true);
+            break;
+        }
+    }
+
+    String getCellTooltip(int rowNumber, int columnId) override
+    {
+        if (columnId == notesColumn && isPositiveAndBelow(rowNumber, rows.size()))
+            return rows[rowNumber].notes;
+
+        return {};
+    }
+
+    void resized() override
+    {
+        table.setBounds(getLocalBounds());
+    }
+
+private:
+    struct Row {
+        String text;
+        int depth;
+        int order;
+        int blockSize;
+        double rate;
+        double microseconds;
+        String notes;
+    };
+
+    enum ColumnIds {
+        orderColumn = 1,
+        objectColumn,
+        blockColumn,
+        rateColumn,
+        timeColumn,
+        notesColumn
+    };
+
+    static void collectObjects(t_canvas* cnv, std::unordered_set<t_object*>& objects)
+    {
+        for (t_gobj* y = cnv->gl_list; y; y = y->g_next) {
+            if (auto* obj = pd_checkobject(&y->g_pd))
+                objects.insert(obj);
+        }
+    }
+
+    // Whether anything connected to this object ends up somewhere: objects without signal outlets, outlet~ and subpatches count as used
+    static bool reachesOutput(t_object* obj, std::unordered_map<t_object*, bool>& visited)
+    {
+        auto it = visited.find(obj);
+        if (it != visited.end())
+            return it->second;
+
+        if (obj_nsigoutlets(obj) == 0 || pd_class(&obj->ob_pd) == canvas_class || String(libpd_get_object_class_name(obj)) == "outlet~") {
+            visited[obj] = true;
+            return true;
+        }
+
+        // Pd doesn't allow signal loops, but control connections can go back, so assume unused until proven otherwise
+        visited[obj] = false;
+
+        for (int n = 0; n < obj_noutlets(obj); n++) {
+            t_outlet* outlet;
+            auto* connection = obj_starttraverseoutlet(obj, &outlet, n);
+            while (connection) {
+                t_object* destination;
+                t_inlet* inlet;
+                int which;
+                connection = obj_nexttraverseoutlet(connection, &destination, &inlet, &which);
+
+                if (reachesOutput(destination, visited)) {
+                    visited[obj] = true;
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    TableListBox table;
+    std::vector<Row> rows;
+
+    PlugDataAudioProcessor* pd;
+};
+
+// Times the perform routines of every object while the panel is open
+// The table lists the objects of the current patch and its subpatches, the objects on the canvas get a heat overlay
+class ProfilerPanel : public Component
+, public TableListBoxModel
+, public Timer {
+public:
+    ProfilerPanel(PlugDataAudioProcessor* instance, PlugDataPluginEditor* pluginEditor) : chainView(instance), pd(instance), editor(pluginEditor)
+    {
+        table.setModel(this);
+        table.setRowHeight(24);
+        table.setOutlineThickness(0);
+        table.setColour(ListBox::backgroundColourId, Colours::transparentBlack);
+        table.getViewport()->setScrollBarsShown(true, false, false, false);
+
+        auto& header = table.getHeader();
+        header.addColumn("Object", objectColumn, 130, 50, -1, TableHeaderComponent::defaultFlags);
+        header.addColumn("CPU %", loadColumn, 55, 40, 80, TableHeaderComponent::defaultFlags);
+        header.addColumn("us/block", timeColumn, 65, 40, 90, TableHeaderComponent::defaultFlags);
+        header.setStretchToFitActive(true);
+        header.setSortColumnId(loadColumn, false);
+
+        addAndMakeVisible(table);
+        addChildComponent(chainView);
+
+        std::array<String, 3> tooltips = { "Show time per object", "Show DSP chain", "Refresh DSP chain" };
+
+        auto i = 0;
+        for (auto& button : buttons) {
+            button.setName("statusbar:profiler");
+            button.setConnectedEdges(12);
+            button.setTooltip(tooltips[i++]);
+            addAndMakeVisible(button);
+        }
+
+        for (int n = 0; n < 2; n++) {
+            buttons[n].setClickingTogglesState(true);
+            buttons[n].setRadioGroupId(1200);
+            buttons[n].onClick = [this]() { showChain(buttons[1].getToggleState()); };
+        }
+
+        buttons[0].setToggleState(true, dontSendNotification);
+        buttons[2].setEnabled(false);
+        buttons[2].onClick = [this]() { updateChain(); };
+    }
+
+    ~ProfilerPanel() override
+    {
+        stopProfiling();
+    }
+
+    void visibilityChanged() override
+    {
+        if (isVisible()) {
+            startProfiling();
+        } else {
+            stopProfiling();
+        }
+    }
+
+    void timerCallback() override
+    {
+        auto const now = Time::getMillisecondCounterHiRes();
+        auto const interval = (now - lastCollect) / 1000.0;
+        lastCollect = now;
+
+        std::unordered_map<void*, std::pair<double, int>> timings;
+        auto* cnv = editor->getCurrentCanvas();
+
+        rows.clear();
+
+        pd->setThis();
+        pd->getCallbackLock()->enter();
+
+        libpd_profiler_collect(&timings, [](void* userdata, t_object* obj, double seconds, int ticks) {
+            (*static_cast<std::unordered_map<void*, std::pair<double, int>>*>(userdata))[obj] = { seconds, ticks };
+        });
+
+        if (cnv && !timings.empty()) {
+            collectRows(cnv->patch, timings, interval);
+        }
+
+        pd->getCallbackLock()->exit();
+
+        if (cnv) {
+            updateHeat(cnv);
+        }
+
+        sortRows();
+        table.updateContent();
+        table.repaint();
+    }
+
+    void paint(Graphics& g) override
+    {
+        g.setColour(findColour(PlugDataColour::sidebarBackgroundColourId));
+        g.fillRect(getLocalBounds().withTrimmedBottom(30));
+    }
+
+    int getNumRows() override
+    {
+        return static_cast<int>(rows.size());
+    }
+
+    void paintRowBackground(Graphics& g, int rowNumber, int w, int h, bool rowIsSelected) override
+    {
+        if (rowIsSelected) {
+            g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
+            g.fillRoundedRectangle(4, 2, w - 8, h - 4, Constants::smallCornerRadius);
+        }
+    }
+
+    void paintCell(Graphics& g, int rowNumber, int columnId, int w, int h, bool rowIsSelected) override
+    {
+        if (!isPositiveAndBelow(rowNumber, rows.size()))
+            return;
+
+        auto const& row = rows[rowNumber];
+
+        g.setColour(rowIsSelected ? findColour(PlugDataColour::sidebarActiveTextColourId) : findColour(ComboBox::textColourId));
+        g.setFont(Font(13));
+
+        switch (columnId) {
+        case objectColumn:
+            g.drawText(row.prefix + row.text, 8, 0, w - 8, h, Justification::centredLeft, true);
+            break;
+        case loadColumn:
+            g.drawText(String(row.load, 2), 0, 0, w - 4, h, Justification::centredRight, true);
+            break;
+        case timeColumn:
+            g.drawText(String(row.microseconds, 1), 0, 0, w - 8, h, Justification::centredRight, true);
+            break;
+        }
+    }
+
+    void sortOrderChanged(int newSortColumnId, bool isForwards) override
+    {
+        sortRows();
+        table.updateContent();
+        table.repaint();
+    }
+
+    void resized() override
+    {
+        auto fb = FlexBox(FlexBox::Direction::row, FlexBox::Wrap::noWrap, FlexBox::AlignContent::flexStart, FlexBox::AlignItems::stretch, FlexBox::JustifyContent::flexStart);
+
+        for (auto& b : buttons) {
+            auto item = FlexItem(b).withMinWidth(8.0f).withMinHeight(8.0f).withMaxHeight(27);
+            item.flexGrow = 1.0f;
+            item.flexShrink = 1.0f;
+            fb.items.add(item);
+        }
+
+        auto bounds = getLocalBounds().toFloat();
+        fb.performLayout(bounds.removeFromBottom(30));
+
+        table.setBounds(bounds.toNearestInt());
+        chainView.setBounds(bounds.toNearestInt());
+    }
+
+private:
+    void showChain(bool shouldShowChain)
+    {
+        table.setVisible(!shouldShowChain);
+        chainView.setVisible(shouldShowChain);
+        buttons[2].setEnabled(shouldShowChain);
+
+        if (shouldShowChain)
+            updateChain();
+    }
+
+    void updateChain()
+    {
+        if (!profiling)
+            return;
+
+        auto* cnv = editor->getCurrentCanvas();
+        chainView.update(cnv ? &cnv->patch : nullptr);
+    }
+
+    struct Row {
+        String text;
+        String prefix;
+        void* topLevel; // the object in the current patch that contains this object
+        double load;
+        double microseconds;
+    };
+
+    enum ColumnIds {
+        objectColumn = 1,
+        loadColumn,
+        timeColumn
+    };
+
+    void startProfiling()
+    {
+        if (profiling)
+            return;
+
+        pd->setThis();
+        pd->getCallbackLock()->enter();
+        libpd_profiler_start();
+        pd->getCallbackLock()->exit();
+
+        profiling = true;
+        lastCollect = Time::getMillisecondCounterHiRes();
+        startTimer(500);
+
+        if (chainView.isVisible())
+            updateChain();
+    }
+
+    void stopProfiling()
+    {
+        if (!profiling)
+            return;
+
+        stopTimer();
+
+        pd->setThis();
+        pd->getCallbackLock()->enter();
+        libpd_profiler_stop();
+        pd->getCallbackLock()->exit();
+
+        profiling = false;
+        rows.clear();
+        table.updateContent();
+
+        for (auto* cnv : editor->canvases) {
+            for (auto* object : cnv->objects) {
+                if (object->profilerHeat != 0.0f) {
+                    object->profilerHeat = 0.0f;
+                    object->repaint();
+                }
+            }
+        }
+    }
+
+    // Same walk as the search panel, objects inside subpatches add up to the subpatch on the canvas
+    void collectRows(pd::Patch& patch, std::unordered_map<void*, std::pair<double, int>> const& timings, double interval, void* topLevelObject = nullptr, String const& prefix = "")
+    {
+        for (auto* object : patch.getObjects()) {
+            void* topLevel = topLevelObject ? topLevelObject : object;
+            auto className = String::fromUTF8(libpd_get_object_class_name(object));
+
+            if (className == "canvas" || className == "graph") {
+                char* objectText;
+                int len;
+                libpd_get_object_text(object, &objectText, &len);
+
+                auto tokens = StringArray::fromTokens(String::fromUTF8(objectText, len), false);
+                auto newPrefix = tokens[0] == "pd" ? tokens[0] + " " + tokens[1] : tokens[0];
+
+                auto subpatch = pd::Patch(object, patch.instance);
+                collectRows(subpatch, timings, interval, topLevel, prefix + newPrefix + " -> ");
+                continue;
+            }
+
+            auto it = timings.find(object);
+            if (it == timings.end())
+                continue;
+
+            String text = className;
+            if (libpd_is_text_object(object)) {
+                char* objectText;
+                int len;
+                libpd_get_object_text(object, &objectText, &len);
+                text = String::fromUTF8(objectText, len);
+            }
+
+            auto const [seconds, ticks] = it->second;
+            rows.push_back({ text, prefix, topLevel, interval > 0.0 ? 100.0 * seconds / interval : 0.0, 1e6 * seconds / ticks });
+        }
+    }
+
+    // The hottest object on the canvas gets the strongest colour
+    void updateHeat(Canvas* cnv)
+    {
+        std::unordered_map<void*, double> loads;
+        double maxLoad = 0.0;
+
+        for (auto const& row : rows) {
+            auto& load = loads[row.topLevel];
+            load += row.load;
+            maxLoad = std::max(maxLoad, load);
+        }
+
+        for (auto* object : cnv->objects) {
+            auto it = loads.find(object->getPointer());
+            auto heat = it != loads.end() && maxLoad > 0.0 ? static_cast<float>(it->second / maxLoad) : 0.0f;
+
+            if (std::abs(heat - object->profilerHeat) > 0.01f) {
+                object->profilerHeat = heat;
+                object->repaint();
+            }
+        }
+    }
+
+    void sortRows()
+    {
+        auto& header = table.getHeader();
+        auto const column = header.getSortColumnId();
+        auto const forwards = header.isSortedForwards();
+
+        auto const lessThan = [column](Row const& a, Row const& b) {
+            switch (column) {
+            case objectColumn:
+                return (a.prefix + a.text).compareNatural(b.prefix + b.text) < 0;
+            case timeColumn:
+                return a.microseconds < b.microseconds;
+            default:
+                return a.load < b.load;
+            }
+        };
+
+        std::sort(rows.begin(), rows.end(), [&lessThan, forwards](Row const& a, Row const& b) {
+            return forwards ? lessThan(a, b) : lessThan(b, a);
+        });
+    }
+
+    TableListBox table;
+    std::vector<Row> rows;
+
+    DSPChainView chainView;
+    std::array<TextButton, 3> buttons = { TextButton(Icons::Sine), TextButton(Icons::Wand), TextButton(Icons::Refresh) };
+
+    double lastCollect = 0.0;
+    bool profiling = false;
+
+    PlugDataAudioProcessor* pd;
+    PlugDataPluginEditor* editor;
+};
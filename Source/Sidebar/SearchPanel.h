@@ -169,6 +169,9 @@ public:
     {
         if(!isVisible()) {
             clearSearchTargets();
+
+            // Not every edit is a structural change, so rebuild the index next time
+            indexedPatch = nullptr;
         }
     }
     
@@ -275,7 +278,8 @@ public:
             return;
         }
         
-        searchResult = searchRecursively(cnv, cnv->patch, query);
+        updateSearchIndex(cnv);
+        searchResult = search(cnv, query);
         
         listBox.updateContent();
         
@@ -290,51 +294,84 @@ public:
     }
     
     
-    static Array<std::tuple<String, String, Object*, void*>> searchRecursively(Canvas* topLevelCanvas, pd::Patch& patch, const String& query, Object* topLevelObject = nullptr, String prefix = "") {
-        
-        auto* instance = patch.instance;
-        
-        Array<std::tuple<String, String, Object*, void*>> result;
-        
-        Array<std::pair<void*, Object*>> subpatches;
-        
-        auto addObject = [&query, &result, &prefix](const String& text, Object* object, void* ptr) {
-            
-            // Insert in front if the query matches a whole word
-            if (text.containsWholeWordIgnoreCase(query)) {
-                result.insert(0, {text, prefix, object, ptr});
-                return true;
+    struct SearchEntry
+    {
+        String text;
+        std::string lowercaseText;
+        String prefix;
+        void* topLevel; // the object in the searched patch that contains this object
+        void* ptr;
+    };
+
+    // Collects the text of every object in the patch tree once, so searching doesn't need to walk pd's patches for every keystroke
+    void updateSearchIndex(Canvas* cnv)
+    {
+        auto changeCount = cnv->pd->getPatchChangeCount();
+        if (indexedPatch == cnv->patch.getPointer() && indexedChangeCount == changeCount) return;
+
+        searchIndex.clear();
+        indexRecursively(cnv->patch, searchIndex);
+
+        indexedPatch = cnv->patch.getPointer();
+        indexedChangeCount = changeCount;
+    }
+
+    Array<std::tuple<String, String, Object*, void*>> search(Canvas* cnv, String const& query)
+    {
+        Array<std::tuple<String, String, Object*, void*>> wholeWordMatches;
+        Array<std::tuple<String, String, Object*, void*>> matches;
+
+        std::unordered_map<void*, Object*> topLevelObjects;
+        for (auto* object : cnv->objects) topLevelObjects[object->getPointer()] = object;
+
+        auto const lowercaseQuery = query.toLowerCase().toStdString();
+
+        for (auto const& entry : searchIndex)
+        {
+            if (entry.lowercaseText.find(lowercaseQuery) == std::string::npos) continue;
+
+            auto it = topLevelObjects.find(entry.topLevel);
+            if (it == topLevelObjects.end()) continue;
+
+            // Show whole word matches first
+            if (entry.text.containsWholeWordIgnoreCase(query))
+            {
+                wholeWordMatches.add({ entry.text, entry.prefix, it->second, entry.ptr });
             }
-            // Insert in back if it contains the query
-            else if (text.containsIgnoreCase(query)) {
-                result.add({text, prefix, object, ptr});
-                return true;
+            else
+            {
+                matches.add({ entry.text, entry.prefix, it->second, entry.ptr });
             }
-            
-            return false;
+        }
+
+        wholeWordMatches.addArray(matches);
+        return wholeWordMatches;
+    }
+
+    static void indexRecursively(pd::Patch& patch, std::vector<SearchEntry>& entries, void* topLevelObject = nullptr, String prefix = "")
+    {
+        auto* instance = patch.instance;
+
+        Array<std::pair<void*, void*>> subpatches;
+
+        auto addObject = [&entries, &prefix](const String& text, void* topLevel, void* ptr) {
+            entries.push_back({ text, text.toLowerCase().toStdString(), prefix, topLevel, ptr });
         };
-        
+
         for(auto* object : patch.getObjects()) {
-            
-            Object* topLevel = topLevelObject;
-            if(topLevelCanvas) {
-                for(auto* obj : topLevelCanvas->objects) {
-                    if(obj->getPointer() == object) {
-                        topLevel = obj;
-                    }
-                }
-            }
-            
+
+            void* topLevel = topLevelObject ? topLevelObject : object;
+
             auto className = String::fromUTF8(libpd_get_object_class_name(object));
-               
+
             if(className == "canvas" || className == "graph") {
                 // Save them for later, so we can put them at the end of the result
                 subpatches.add({object, topLevel});
             }
             else {
-                
+
                 bool isGui = !libpd_is_text_object(object);
-                
+
                 // If it's a gui add the class name
                 if(isGui) {
                     addObject(className, topLevel, object);
@@ -348,20 +385,19 @@ public:
                 }
             }
         }
-        
+
         // Search through subpatches
         for(auto& [object, topLevel] : subpatches)
         {
             auto patch = pd::Patch(object, instance);
-            
+
             char* objectText;
             int len;
             libpd_get_object_text(object, &objectText, &len);
-            
-            addObject(String::fromUTF8(objectText, len), topLevel, object);
- 
+
             auto objTextStr = String::fromUTF8(objectText, len);
-            
+            addObject(objTextStr, topLevel, object);
+
             auto tokens = StringArray::fromTokens(objTextStr, false);
             String newPrefix;
             if(tokens[0] == "pd") {
@@ -370,11 +406,9 @@ public:
             else {
                 newPrefix = tokens[0];
             }
-            
-            result.addArray(searchRecursively(nullptr, patch, query, topLevel, prefix + newPrefix  + " -> "));
+
+            indexRecursively(patch, entries, topLevel, prefix + newPrefix  + " -> ");
         }
-        
-        return result;
     }
 
 
@@ -394,6 +428,10 @@ private:
     ListBox listBox;
     
     Array<std::tuple<String, String, Object*, void*>> searchResult;
+
+    std::vector<SearchEntry> searchIndex;
+    void* indexedPatch = nullptr;
+    int indexedChangeCount = -1;
     TextEditor input;
     TextButton closeButton = TextButton(Icons::Clear);
     
@@ -17,6 +17,7 @@
 #include "DocumentBrowser.h"
 #include "AutomationPanel.h"
 #include "SearchPanel.h"
+#include "ProfilerPanel.h"
 
 Sidebar::Sidebar(PlugDataAudioProcessor* instance, PlugDataPluginEditor* parent)
     : pd(instance)
@@ -27,6 +28,7 @@ Sidebar::Sidebar(PlugDataAudioProcessor* instance, PlugDataPluginEditor* parent)
     browser = new DocumentBrowser(pd);
     automationPanel = new AutomationPanel(pd);
     searchPanel = new SearchPanel(parent);
+    profilerPanel = new ProfilerPanel(pd, parent);
     
     
     addAndMakeVisible(console);
@@ -34,6 +36,7 @@ Sidebar::Sidebar(PlugDataAudioProcessor* instance, PlugDataPluginEditor* parent)
     addChildComponent(browser);
     addChildComponent(automationPanel);
     addChildComponent(searchPanel);
+    addChildComponent(profilerPanel);
     
     browser->setAlwaysOnTop(true);
     
@@ -42,6 +45,7 @@ Sidebar::Sidebar(PlugDataAudioProcessor* instance, PlugDataPluginEditor* parent)
     automationPanel->addMouseListener(this, true);
     inspector->addMouseListener(this, true);
     searchPanel->addMouseListener(this, true);
+    profilerPanel->addMouseListener(this, true);
     
     consoleButton.setTooltip("Open console panel");
     consoleButton.setConnectedEdges(12);
@@ -81,11 +85,22 @@ Sidebar::Sidebar(PlugDataAudioProcessor* instance, PlugDataPluginEditor* parent)
         showPanel(3);
     };
     addAndMakeVisible(searchButton);
+
+    profilerButton.setTooltip("Open DSP profiler");
+    profilerButton.setConnectedEdges(12);
+    profilerButton.setName("statusbar:profiler");
+    profilerButton.setClickingTogglesState(true);
+    profilerButton.onClick = [this]()
+    {
+        showPanel(4);
+    };
+    addAndMakeVisible(profilerButton);
     
     browserButton.setRadioGroupId(1100);
     automationButton.setRadioGroupId(1100);
     consoleButton.setRadioGroupId(1100);
     searchButton.setRadioGroupId(1100);
+    profilerButton.setRadioGroupId(1100);
     
     consoleButton.setToggleState(true, dontSendNotification);
     
@@ -103,13 +118,14 @@ Sidebar::~Sidebar()
     delete browser;
     delete automationPanel;
     delete searchPanel;
+    delete profilerPanel;
 }
 
 void Sidebar::paint(Graphics& g)
 {
     // Makes sure the theme gets updated
     if (automationPanel)
-        automationPanel->viewport.repaint();
+        automationPanel->listBox.repaint();
 
     // Sidebar
     g.setColour(findColour(PlugDataColour::sidebarBackgroundColourId));
@@ -135,18 +151,20 @@ void Sidebar::resized()
     
     auto tabbarBounds = bounds.removeFromTop(28);
     
-    int buttonWidth = getWidth() / 4;
+    int buttonWidth = getWidth() / 5;
     
     consoleButton.setBounds(tabbarBounds.removeFromLeft(buttonWidth));
     browserButton.setBounds(tabbarBounds.removeFromLeft(buttonWidth));
     automationButton.setBounds(tabbarBounds.removeFromLeft(buttonWidth));
     searchButton.setBounds(tabbarBounds.removeFromLeft(buttonWidth));
+    profilerButton.setBounds(tabbarBounds);
 
     browser->setBounds(bounds);
     console->setBounds(bounds);
     inspector->setBounds(bounds);
     automationPanel->setBounds(bounds);
     searchPanel->setBounds(bounds);
+    profilerPanel->setBounds(bounds);
 }
 
 void Sidebar::mouseDown(MouseEvent const& e)
@@ -196,13 +214,14 @@ void Sidebar::showPanel(int panelToShow)
     bool showBrowser = panelToShow == 1;
     bool showAutomation = panelToShow == 2;
     bool showSearch = panelToShow == 3;
+    bool showProfiler = panelToShow == 4;
     
     console->setVisible(showConsole);
     
     browser->setVisible(showBrowser);
     browser->setInterceptsMouseClicks(showBrowser, showBrowser);
     
-    auto buttons = std::vector<TextButton*>{&consoleButton, &browserButton, &automationButton, &searchButton};
+    auto buttons = std::vector<TextButton*>{&consoleButton, &browserButton, &automationButton, &searchButton, &profilerButton};
     
     for(int i = 0; i < buttons.size(); i++) {
         buttons[i]->setToggleState(i == panelToShow, dontSendNotification);
@@ -215,6 +234,9 @@ void Sidebar::showPanel(int panelToShow)
     searchPanel->setVisible(showSearch);
     if(showSearch && !searchWasVisisble) searchPanel->grabFocus();
     searchPanel->setInterceptsMouseClicks(showSearch, showSearch);
+
+    profilerPanel->setVisible(showProfiler);
+    profilerPanel->setInterceptsMouseClicks(showProfiler, showProfiler);
     
     currentPanel = panelToShow;
 }
@@ -226,12 +248,12 @@ bool Sidebar::isShowingBrowser()
 
 
 #if PLUGDATA_STANDALONE
-void Sidebar::updateAutomationParameters()
+void Sidebar::updateAutomationParameter(int index)
 {
     if (automationPanel) {
         // Might be called from audio thread
-        MessageManager::callAsync([this]() { //automationPanel->updateParameters();
-            
+        MessageManager::callAsync([this, index]() {
+            automationPanel->updateParameter(index);
         });
     };
 };
@@ -277,6 +299,7 @@ void Sidebar::showParameters(String const& name, ObjectParameters& params)
         console->setVisible(false);
         browser->setVisible(false);
         searchPanel->setVisible(false);
+        profilerPanel->setVisible(false);
         automationPanel->setVisible(false);
     }
 }
@@ -290,12 +313,14 @@ void Sidebar::showParameters()
         console->setVisible(false);
         browser->setVisible(false);
         searchPanel->setVisible(false);
+        profilerPanel->setVisible(false);
         automationPanel->setVisible(false);
     }
 }
 void Sidebar::hideParameters()
 {
     if (!pinned) {
+        inspector->discardPendingParameters();
         inspector->setVisible(false);
         showPanel(currentPanel);
     }
@@ -12,6 +12,7 @@ struct Inspector;
 struct DocumentBrowser;
 struct AutomationPanel;
 struct SearchPanel;
+struct ProfilerPanel;
 struct PlugDataAudioProcessor;
 
 namespace pd {
@@ -104,7 +105,7 @@ struct Sidebar : public Component {
     void tabChanged();
 
 #if PLUGDATA_STANDALONE
-    void updateAutomationParameters();
+    void updateAutomationParameter(int index);
 #endif
 
     static constexpr int dragbarWidth = 5;
@@ -117,12 +118,14 @@ private:
     TextButton browserButton = TextButton(Icons::Documentation);
     TextButton automationButton = TextButton(Icons::Parameters);
     TextButton searchButton = TextButton(Icons::Search);
+    TextButton profilerButton = TextButton(Icons::Sine);
     
     Console* console;
     Inspector* inspector;
     DocumentBrowser* browser;
     AutomationPanel* automationPanel;
     SearchPanel* searchPanel;
+    ProfilerPanel* profilerPanel;
     
     int currentPanel = 0;
     
@@ -269,6 +269,11 @@ int PlugDataWindow::parseSystemArguments(String const& arguments)
     }
 #endif
 
+    // Patches that were still open when plugdata crashed
+    if(auto* pd = dynamic_cast<PlugDataAudioProcessor*>(getAudioProcessor())) {
+        pd->recoverPatches();
+    }
+
     /* send messages specified with "-send" args */
     for (auto* nl = messagelist; nl; nl = nl->nl_next) {
         t_binbuf* b = binbuf_new();
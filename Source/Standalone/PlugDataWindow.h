@@ -36,6 +36,13 @@ void maximiseLinuxWindow(void* handle);
 
 #include "../Utility/StackShadow.h"
 
+#if JUCE_WINDOWS
+#include "../Utility/WindowsUtils.h"
+#elif JUCE_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 
 // For each OS, we have a different approach to rendering the window shadow
 // macOS:
@@ -180,8 +187,20 @@ public:
     {
         return processorHasPotentialFeedbackLoop;
     }
+    void attachLowLatencySetting(Value const& setting)
+    {
+        lowLatencyMode.referTo(setting);
+        lowLatencyMode.addListener(this);
+        valueChanged(lowLatencyMode);
+    }
+
     void valueChanged(Value& value) override
     {
+        if (value.refersToSameSourceAs(lowLatencyMode)) {
+            threadSetupRequest = static_cast<bool>(value.getValue()) ? promoteThread : restoreThread;
+            return;
+        }
+
         muteInput = static_cast<bool>(value.getValue());
     }
     
@@ -288,6 +307,9 @@ public:
     
     std::unique_ptr<AudioDeviceManager::AudioDeviceSetup> options;
     Array<MidiDeviceInfo> lastMidiDevices;
+
+    // Refers to the "LowLatencyAudio" setting. While it's on, the audio thread runs with realtime priority on its own core
+    Value lowLatencyMode;
     
     std::unique_ptr<FileChooser> stateFileChooser;
 
@@ -331,6 +353,13 @@ private:
                 jassertquiet ((int) storedInputChannels.size()  == numInputChannels);
                 jassertquiet ((int) storedOutputChannels.size() == numOutputChannels);
 
+                // The usual case, the device keeps to the buffer size it reported
+                if (numSamples <= maximumSize)
+                {
+                    inner.audioDeviceIOCallbackWithContext (inputChannelData, numInputChannels, outputChannelData, numOutputChannels, numSamples, context);
+                    return;
+                }
+
                 int position = 0;
 
                 while (position < numSamples)
@@ -386,6 +415,11 @@ private:
                                           int numSamples,
                                           const AudioIODeviceCallbackContext& context) override
     {
+        // Has to run on the audio thread itself
+        if (auto request = threadSetupRequest.exchange(noRequest); request != noRequest) {
+            setAudioThreadRealtime(request == promoteThread);
+        }
+
         if (muteInput) {
             emptyBuffer.clear();
             inputChannelData = emptyBuffer.getArrayOfReadPointers();
@@ -403,9 +437,58 @@ private:
     {
         emptyBuffer.setSize(device->getActiveInputChannels().countNumberOfSetBits(), device->getCurrentBufferSizeSamples());
         emptyBuffer.clear();
+
+        // A new device can come with a new audio thread
+        audioThreadPromoted = false;
+        if (static_cast<bool>(lowLatencyMode.getValue())) {
+            threadSetupRequest = promoteThread;
+        }
         
         player.audioDeviceAboutToStart(device);
     }
+
+    enum ThreadSetupRequest {
+        noRequest,
+        promoteThread,
+        restoreThread
+    };
+
+    std::atomic<int> threadSetupRequest { noRequest };
+
+    // Only touched on the audio thread, so we only undo scheduling changes we made ourselves
+    bool audioThreadPromoted = false;
+
+    // Realtime scheduling and a core of its own for the audio thread, so the rest of the app can't delay it
+    // Drivers that already run their callback in a realtime thread, like CoreAudio or JACK, keep their own scheduling
+    void setAudioThreadRealtime(bool realtime)
+    {
+        auto const numCpus = jlimit(1, 32, SystemStats::getNumCpus());
+        auto const allCpus = numCpus == 32 ? std::numeric_limits<uint32>::max() : (uint32(1) << numCpus) - 1;
+
+        // The last core, the first one usually handles the most interrupts
+        Thread::setCurrentThreadAffinityMask(realtime && numCpus > 1 ? uint32(1) << (numCpus - 1) : allCpus);
+
+#if JUCE_WINDOWS
+        if (realtime || audioThreadPromoted) {
+            setCurrentThreadTimeCritical(realtime);
+            audioThreadPromoted = realtime;
+        }
+#elif JUCE_LINUX
+        int policy = 0;
+        sched_param param {};
+        pthread_getschedparam(pthread_self(), &policy, &param);
+
+        // Stays below JACK's own threads, fails quietly if the user isn't allowed to use realtime priority
+        if (realtime && policy != SCHED_FIFO && policy != SCHED_RR) {
+            param.sched_priority = jmax(sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO) - 10);
+            audioThreadPromoted = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+        } else if (!realtime && audioThreadPromoted) {
+            param.sched_priority = 0;
+            pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+            audioThreadPromoted = false;
+        }
+#endif
+    }
     
     void audioDeviceStopped() override
     {
@@ -527,6 +610,8 @@ public:
         
         // Listen for window style changes
         useNativeWindow.addListener(this);
+
+        pluginHolder->attachLowLatencySetting(settingsTree.getPropertyAsValue("LowLatencyAudio", nullptr));
         
         // Make sure it gets updated on init
         valueChanged(useNativeWindow);
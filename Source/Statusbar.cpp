@@ -17,9 +17,11 @@ struct LevelMeter : public Component, public Timer
     int numChannels = 2;
     StatusbarSource& source;
 
+    static constexpr int updateInterval = 50;
+
     explicit LevelMeter(StatusbarSource& statusbarSource) : source(statusbarSource)
     {
-        startTimerHz(20);
+        startTimer(updateInterval);
     }
 
     void timerCallback() override
@@ -29,11 +31,19 @@ struct LevelMeter : public Component, public Timer
             bool needsRepaint = false;
             for (int ch = 0; ch < numChannels; ch++)
             {
-                auto newLevel = source.level[ch].load();
+                // With more than two channels, even channels are shown on the top row and odd channels on the bottom row
+                float newLevel = 0.0f;
+                for (int i = ch; i < StatusbarSource::maxChannels; i += 2)
+                {
+                    newLevel = std::max(newLevel, source.level[i].load());
+                }
 
                 if (!std::isfinite(newLevel))
                 {
-                    source.level[ch] = 0;
+                    for (auto& channelLevel : source.level)
+                    {
+                        channelLevel = 0.0f;
+                    }
                     blocks[ch] = 0;
                     return;
                 }
@@ -112,9 +122,11 @@ struct MidiBlinker : public Component, public Timer
 {
     StatusbarSource& source;
 
+    static constexpr int updateInterval = 200;
+
     explicit MidiBlinker(StatusbarSource& statusbarSource) : source(statusbarSource)
     {
-        startTimer(200);
+        startTimer(updateInterval);
     }
 
     void paint(Graphics& g) override
@@ -135,26 +147,259 @@ struct MidiBlinker : public Component, public Timer
 
     void timerCallback() override
     {
-        if (source.midiReceived != blinkMidiIn)
+        auto const now = Time::getMillisecondCounter();
+
+        updateBlinker(source.midiReceivedCount, lastReceivedCount, lastMidiIn, blinkMidiIn, now);
+        updateBlinker(source.midiSentCount, lastSentCount, lastMidiOut, blinkMidiOut, now);
+    }
+
+    // Stays lit until there was no activity for 700ms
+    void updateBlinker(uint32 count, uint32& lastCount, uint32& lastActivity, bool& blink, uint32 now)
+    {
+        if (count != lastCount)
         {
-            blinkMidiIn = source.midiReceived;
-            repaint();
+            lastCount = count;
+            lastActivity = now;
         }
-        if (source.midiSent != blinkMidiOut)
+
+        bool const active = now - lastActivity <= 700;
+        if (active != blink)
         {
-            blinkMidiOut = source.midiSent;
+            blink = active;
             repaint();
         }
     }
 
     bool blinkMidiIn = false;
     bool blinkMidiOut = false;
+
+    uint32 lastReceivedCount = 0;
+    uint32 lastSentCount = 0;
+    uint32 lastMidiIn = 0;
+    uint32 lastMidiOut = 0;
+};
+
+// Load histogram of the audio callback and the traffic through pd's message lanes, relative to the moment it was opened or reset
+struct CpuHistogram : public Component, public Timer
+{
+    StatusbarSource& source;
+    pd::Instance& instance;
+
+    CpuHistogram(StatusbarSource& statusbarSource, pd::Instance& pdInstance) : source(statusbarSource), instance(pdInstance)
+    {
+        resetButton.onClick = [this]()
+        {
+            reset();
+        };
+        addAndMakeVisible(resetButton);
+
+        reset();
+        setSize(280, 250);
+        startTimer(250);
+    }
+
+    void reset()
+    {
+        for (int i = 0; i < StatusbarSource::numLoadBins; i++)
+        {
+            baseline[i] = source.loadHistogram[i].load(std::memory_order_relaxed);
+        }
+        baselineXruns = source.xrunCount.load(std::memory_order_relaxed);
+        baselineStats = instance.getMessageStats();
+        instance.resetMessageStatPeaks();
+        repaint();
+    }
+
+    void timerCallback() override
+    {
+        repaint();
+    }
+
+    void paint(Graphics& g) override
+    {
+        uint32 counts[StatusbarSource::numLoadBins];
+        uint64 total = 0;
+        double sum = 0.0;
+        int maxBin = -1;
+
+        for (int i = 0; i < StatusbarSource::numLoadBins; i++)
+        {
+            counts[i] = source.loadHistogram[i].load(std::memory_order_relaxed) - baseline[i];
+            total += counts[i];
+            sum += (i + 0.5) * counts[i];
+            if (counts[i]) maxBin = i;
+        }
+
+        int p99 = 0;
+        for (uint64 cumulative = 0; p99 < StatusbarSource::numLoadBins; p99++)
+        {
+            cumulative += counts[p99];
+            if (cumulative * 100 >= total * 99) break;
+        }
+
+        auto const xruns = source.xrunCount.load(std::memory_order_relaxed) - baselineXruns;
+
+        g.setColour(findColour(ComboBox::textColourId));
+        g.setFont(Font(12));
+
+        auto stats = total ? String::formatted("mean %.1f%%  p99 %d%%  max %d%%", sum / total, p99 + 1, maxBin + 1) : String("no callbacks yet");
+        g.drawText(stats, 8, 4, getWidth() - 16, 16, Justification::centredLeft);
+        g.drawText("xruns: " + String(xruns), 8, 20, getWidth() - 80, 16, Justification::centredLeft);
+
+        // Columns of 4% up to 200%, the line marks where the callback takes as long as the buffer lasts
+        constexpr int binsPerColumn = 4;
+        constexpr int numColumns = StatusbarSource::numLoadBins / binsPerColumn;
+
+        auto const area = Rectangle<float>(8.0f, 44.0f, getWidth() - 16.0f, 76.0f);
+        auto const columnWidth = area.getWidth() / numColumns;
+
+        uint32 columns[numColumns] = {};
+        uint32 highest = 1;
+        for (int i = 0; i < StatusbarSource::numLoadBins; i++)
+        {
+            columns[i / binsPerColumn] += counts[i];
+            highest = std::max(highest, columns[i / binsPerColumn]);
+        }
+
+        g.setColour(findColour(PlugDataColour::levelMeterInactiveColourId));
+        g.fillRect(area);
+
+        for (int i = 0; i < numColumns; i++)
+        {
+            if (!columns[i]) continue;
+
+            // Square root scale, so the rare slow callbacks don't disappear next to the common ones
+            auto const height = std::max(1.0f, area.getHeight() * std::sqrt(static_cast<float>(columns[i]) / highest));
+            g.setColour(i * binsPerColumn < 100 ? findColour(PlugDataColour::levelMeterActiveColourId) : Colours::red);
+            g.fillRect(area.getX() + i * columnWidth, area.getBottom() - height, std::max(1.0f, columnWidth - 1.0f), height);
+        }
+
+        auto const deadline = area.getX() + area.getWidth() * 100.0f / StatusbarSource::numLoadBins;
+        g.setColour(findColour(ComboBox::textColourId));
+        g.drawVerticalLine(roundToInt(deadline), area.getY(), area.getBottom());
+
+        g.setFont(Font(11));
+        g.drawText("0%", area.getX(), area.getBottom() + 2, 40, 14, Justification::left);
+        g.drawText("100%", deadline - 20, area.getBottom() + 2, 40, 14, Justification::centred);
+        g.drawText("200%", area.getRight() - 40, area.getBottom() + 2, 40, 14, Justification::right);
+
+        paintMessageStats(g, area.getBottom() + 24.0f);
+    }
+
+    void paintMessageStats(Graphics& g, float y)
+    {
+        using Stats = pd::Instance::MessageStats;
+        auto const stats = instance.getMessageStats();
+
+        static char const* laneNames[Stats::NumLanes] = { "Commands", "Notifications", "Bulk" };
+        static char const* columnNames[] = { "in", "out", "deferred", "peak" };
+
+        auto const nameWidth = 80.0f;
+        auto const columnWidth = (getWidth() - 16.0f - nameWidth) / 4.0f;
+
+        g.setColour(findColour(ComboBox::textColourId));
+        g.setFont(Font(11));
+
+        for (int column = 0; column < 4; column++)
+        {
+            g.drawText(columnNames[column], Rectangle<float>(8.0f + nameWidth + column * columnWidth, y, columnWidth, 14.0f), Justification::centredRight);
+        }
+
+        for (int lane = 0; lane < Stats::NumLanes; lane++)
+        {
+            uint32 const values[] = {
+                stats.enqueued[lane] - baselineStats.enqueued[lane],
+                stats.dequeued[lane] - baselineStats.dequeued[lane],
+                stats.deferred[lane] - baselineStats.deferred[lane],
+                stats.peakDepth[lane]
+            };
+
+            auto const rowY = y + 14.0f * (lane + 1);
+            g.drawText(laneNames[lane], Rectangle<float>(8.0f, rowY, nameWidth, 14.0f), Justification::centredLeft);
+
+            for (int column = 0; column < 4; column++)
+            {
+                g.drawText(String(values[column]), Rectangle<float>(8.0f + nameWidth + column * columnWidth, rowY, columnWidth, 14.0f), Justification::centredRight);
+            }
+        }
+
+        auto const dropped = String::formatted("dropped updates: %u objects, %u arrays",
+            stats.droppedObjectUpdates - baselineStats.droppedObjectUpdates,
+            stats.droppedArrayChanges - baselineStats.droppedArrayChanges);
+        auto const drain = String::formatted("queue drain: %.0f us, peak %.0f us", stats.lastDrainMicroseconds, stats.peakDrainMicroseconds);
+
+        g.drawText(dropped, Rectangle<float>(8.0f, y + 14.0f * 4.0f + 4.0f, getWidth() - 16.0f, 14.0f), Justification::centredLeft);
+        g.drawText(drain, Rectangle<float>(8.0f, y + 14.0f * 5.0f + 4.0f, getWidth() - 16.0f, 14.0f), Justification::centredLeft);
+    }
+
+    void resized() override
+    {
+        resetButton.setBounds(getWidth() - 68, 20, 60, 20);
+    }
+
+    TextButton resetButton = TextButton("Reset");
+
+    uint32 baseline[StatusbarSource::numLoadBins];
+    uint32 baselineXruns = 0;
+    pd::Instance::MessageStats baselineStats;
+};
+
+// Highest load of the audio callback since the last update, click it to see the histogram
+struct CpuMeter : public Component, public SettableTooltipClient, public Timer
+{
+    StatusbarSource& source;
+    pd::Instance& instance;
+
+    static constexpr int updateInterval = 200;
+
+    CpuMeter(StatusbarSource& statusbarSource, pd::Instance& pdInstance) : source(statusbarSource), instance(pdInstance)
+    {
+        setTooltip("Audio callback load, click for details");
+        startTimer(updateInterval);
+    }
+
+    void paint(Graphics& g) override
+    {
+        g.setColour(findColour(ComboBox::textColourId));
+        g.setFont(Font(11));
+        g.drawText("CPU", getLocalBounds().removeFromLeft(26), Justification::right);
+
+        auto meterRect = Rectangle<float>(32.0f, 8.0f, getWidth() - 34.0f, 3.0f);
+        g.setColour(findColour(PlugDataColour::levelMeterInactiveColourId));
+        g.fillRoundedRectangle(meterRect, 1.0f);
+
+        g.setColour(load < 90.0f ? findColour(PlugDataColour::levelMeterActiveColourId) : Colours::red);
+        g.fillRoundedRectangle(meterRect.withWidth(meterRect.getWidth() * std::min(load, 100.0f) / 100.0f), 1.0f);
+
+        g.setColour(findColour(ComboBox::textColourId));
+        g.setFont(Font(10));
+        g.drawText(String(roundToInt(load)) + "%", 32, 13, getWidth() - 34, 12, Justification::centredLeft);
+    }
+
+    void timerCallback() override
+    {
+        auto const newLoad = source.peakLoad.exchange(0.0f, std::memory_order_relaxed);
+
+        if (roundToInt(newLoad) != roundToInt(load))
+        {
+            load = newLoad;
+            repaint();
+        }
+    }
+
+    void mouseDown(MouseEvent const& e) override
+    {
+        CallOutBox::launchAsynchronously(std::make_unique<CpuHistogram>(source, instance), getScreenBounds(), nullptr);
+    }
+
+    float load = 0.0f;
 };
 
 Statusbar::Statusbar(PlugDataAudioProcessor& processor) : pd(processor)
 {
     levelMeter = new LevelMeter(processor.statusbarSource);
     midiBlinker = new MidiBlinker(processor.statusbarSource);
+    cpuMeter = new CpuMeter(processor.statusbarSource, processor);
 
     setWantsKeyboardFocus(true);
 
@@ -286,6 +531,7 @@ Statusbar::Statusbar(PlugDataAudioProcessor& processor) : pd(processor)
 
     addAndMakeVisible(levelMeter);
     addAndMakeVisible(midiBlinker);
+    addAndMakeVisible(cpuMeter);
 
     levelMeter->toBehind(&volumeSlider);
 
@@ -293,12 +539,13 @@ Statusbar::Statusbar(PlugDataAudioProcessor& processor) : pd(processor)
     
     // Timer to make sure modifier keys are up-to-date...
     // Hoping to find a better solution for this
-    startTimer(150);
+    startTimer(modifierKeysInterval);
 
 }
 
 Statusbar::~Statusbar()
 {
+    delete cpuMeter;
     delete midiBlinker;
     delete levelMeter;
 }
@@ -365,6 +612,7 @@ void Statusbar::resized()
     oversampleSelector.setBounds(position(getHeight(), true) + 3, 0, getHeight(), getHeight());
 
     midiBlinker->setBounds(position(55, true), 0, 55, getHeight());
+    cpuMeter->setBounds(position(60, true), 0, 60, getHeight());
 }
 
 void Statusbar::modifierKeysChanged(const ModifierKeys& modifiers)
@@ -389,83 +637,114 @@ void Statusbar::timerCallback()
     modifierKeysChanged(ModifierKeys::getCurrentModifiers());
 }
 
-StatusbarSource::StatusbarSource()
+void Statusbar::setUpdatesPaused(bool paused)
 {
-    level[0] = 0.0f;
-    level[1] = 0.0f;
-}
+    if (paused)
+    {
+        levelMeter->stopTimer();
+        midiBlinker->stopTimer();
+        cpuMeter->stopTimer();
+        stopTimer();
+        return;
+    }
 
-static bool hasRealEvents(MidiBuffer& buffer)
-{
-    return std::any_of(buffer.begin(), buffer.end(),
-    [](const auto& event){
-        return !event.getMessage().isSysEx();
-    });
+    levelMeter->startTimer(LevelMeter::updateInterval);
+    midiBlinker->startTimer(MidiBlinker::updateInterval);
+    cpuMeter->startTimer(CpuMeter::updateInterval);
+    startTimer(modifierKeysInterval);
 }
 
-void StatusbarSource::processBlock(const AudioBuffer<float>& buffer, MidiBuffer& midiIn, MidiBuffer& midiOut, int channels)
+StatusbarSource::StatusbarSource()
 {
-    const auto* const* channelData = buffer.getArrayOfReadPointers();
-
-    if (channels == 1)
+    for (auto& channelLevel : level)
     {
-        level[1] = 0;
+        channelLevel = 0.0f;
     }
-    else if (channels == 0)
+
+    for (auto& bin : loadHistogram)
     {
-        level[0] = 0;
-        level[1] = 0;
+        bin = 0;
     }
+}
 
-    for (int ch = 0; ch < channels; ch++)
-    {
-        // TODO: this logic for > 2 channels makes no sense!!
-        auto localLevel = level[ch & 1].load();
+StatusbarSource::ScopedLoadMeasurement::ScopedLoadMeasurement(StatusbarSource& statusbarSource, int samples)
+    : source(statusbarSource), numSamples(samples), startTicks(Time::getHighResolutionTicks())
+{
+}
 
-        for (int n = 0; n < buffer.getNumSamples(); n++)
-        {
-            float s = std::abs(channelData[ch][n]);
+StatusbarSource::ScopedLoadMeasurement::~ScopedLoadMeasurement()
+{
+    if (numSamples <= 0) return;
 
-            const float decayFactor = 0.99992f;
+    auto const elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+    auto const load = static_cast<float>(100.0 * elapsed * source.sampleRate / numSamples);
 
-            if (s > localLevel)
-                localLevel = s;
-            else if (localLevel > 0.001f)
-                localLevel *= decayFactor;
-            else
-                localLevel = 0;
-        }
+    auto const bin = std::clamp(static_cast<int>(load), 0, numLoadBins - 1);
+    source.loadHistogram[bin].fetch_add(1, std::memory_order_relaxed);
 
-        level[ch & 1] = localLevel;
+    if (load >= 100.0f)
+    {
+        source.xrunCount.fetch_add(1, std::memory_order_relaxed);
     }
 
-    auto now = Time::getCurrentTime();
+    // Only the audio thread raises it, the statusbar resets it to zero
+    if (load > source.peakLoad.load(std::memory_order_relaxed))
+    {
+        source.peakLoad.store(load, std::memory_order_relaxed);
+    }
+}
 
-    auto hasInEvents = hasRealEvents(midiIn);
-    auto hasOutEvents = hasRealEvents(midiOut);
+static uint32 countRealEvents(MidiBuffer const& buffer)
+{
+    // Only looks at the status byte, sysex doesn't count as activity
+    return static_cast<uint32>(std::count_if(buffer.begin(), buffer.end(),
+    [](const auto& event){
+        return event.data[0] != 0xf0;
+    }));
+}
 
-    if (!hasInEvents && (now - lastMidiIn).inMilliseconds() > 700)
+void StatusbarSource::processMidiInput(MidiBuffer const& midiIn)
+{
+    if (auto const count = countRealEvents(midiIn))
     {
-        midiReceived = false;
+        midiReceivedCount.fetch_add(count, std::memory_order_relaxed);
     }
-    else if (hasInEvents)
+}
+
+template<typename SampleType>
+void StatusbarSource::processBlock(const AudioBuffer<SampleType>& buffer, MidiBuffer const& midiOut, int channels)
+{
+    auto const numSamples = buffer.getNumSamples();
+    auto const numMetered = std::min({ channels, buffer.getNumChannels(), maxChannels });
+
+    // Decaying by a constant factor per sample is the same as decaying by its power once per block
+    auto const decay = static_cast<float>(std::pow(0.99992, numSamples));
+
+    for (int ch = 0; ch < numMetered; ch++)
     {
-        midiReceived = true;
-        lastMidiIn = now;
+        auto const peak = static_cast<float>(buffer.getMagnitude(ch, 0, numSamples));
+        auto const decayed = level[ch].load() * decay;
+
+        auto const localLevel = std::max(peak, decayed);
+        level[ch] = localLevel > 0.001f ? localLevel : 0.0f;
     }
 
-    if (!hasOutEvents && (now - lastMidiOut).inMilliseconds() > 700)
+    for (int ch = numMetered; ch < maxChannels; ch++)
     {
-        midiSent = false;
+        level[ch] = 0.0f;
     }
-    else if (hasOutEvents)
+
+    if (auto const count = countRealEvents(midiOut))
     {
-        midiSent = true;
-        lastMidiOut = now;
+        midiSentCount.fetch_add(count, std::memory_order_relaxed);
     }
 }
 
-void StatusbarSource::prepareToPlay(int nChannels)
+template void StatusbarSource::processBlock<float>(const AudioBuffer<float>&, MidiBuffer const&, int);
+template void StatusbarSource::processBlock<double>(const AudioBuffer<double>&, MidiBuffer const&, int);
+
+void StatusbarSource::prepareToPlay(int nChannels, double newSampleRate)
 {
     numChannels = nChannels;
+    sampleRate = newSampleRate;
 }
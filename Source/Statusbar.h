@@ -9,6 +9,7 @@
 struct Canvas;
 struct LevelMeter;
 struct MidiBlinker;
+struct CpuMeter;
 struct PlugDataAudioProcessor;
 
 struct Statusbar : public Component, public Value::Listener, public Timer
@@ -30,10 +31,14 @@ struct Statusbar : public Component, public Value::Listener, public Timer
     
     void attachToCanvas(Canvas* cnv);
 
+    // Stops polling the meters and modifier keys while the editor isn't on screen
+    void setUpdatesPaused(bool paused);
+
     bool wasLocked = false; // Make sure it doesn't re-lock after unlocking (because cmd is still down)
     
     LevelMeter* levelMeter;
     MidiBlinker* midiBlinker;
+    CpuMeter* cpuMeter;
 
     std::unique_ptr<TextButton> powerButton, lockButton, connectionStyleButton, connectionPathfind, presentationButton, zoomIn, zoomOut, gridButton, themeButton, browserButton, automationButton;
 
@@ -48,6 +53,7 @@ struct Statusbar : public Component, public Value::Listener, public Timer
     Value presentationMode;
 
     static constexpr int statusbarHeight = 30;
+    static constexpr int modifierKeysInterval = 150;
 
     std::unique_ptr<ButtonParameterAttachment> enableAttachment;
     std::unique_ptr<SliderParameterAttachment> volumeAttachment;
@@ -59,16 +65,42 @@ struct StatusbarSource
 {
     StatusbarSource();
 
-    void processBlock(const AudioBuffer<float>& buffer, MidiBuffer& midiIn, MidiBuffer& midiOut, int outChannels);
+    // Counts the incoming events, needs to be called before the midi buffer is replaced with pd's output
+    void processMidiInput(MidiBuffer const& midiIn);
 
-    void prepareToPlay(int numChannels);
+    template<typename SampleType>
+    void processBlock(const AudioBuffer<SampleType>& buffer, MidiBuffer const& midiOut, int outChannels);
 
-    std::atomic<bool> midiReceived = false;
-    std::atomic<bool> midiSent = false;
-    std::atomic<float> level[2] = {0};
+    void prepareToPlay(int numChannels, double sampleRate);
 
-    int numChannels;
+    // Measures the audio callback it lives in against the time its buffer lasts
+    struct ScopedLoadMeasurement
+    {
+        ScopedLoadMeasurement(StatusbarSource& statusbarSource, int numSamples);
+        ~ScopedLoadMeasurement();
+
+        StatusbarSource& source;
+        int numSamples;
+        int64 startTicks;
+    };
+
+    // Number of midi events that passed through, the statusbar polls these to see if there was any activity
+    std::atomic<uint32> midiReceivedCount = 0;
+    std::atomic<uint32> midiSentCount = 0;
 
-    Time lastMidiIn;
-    Time lastMidiOut;
+    // Decaying peak level of every output channel
+    static constexpr int maxChannels = 32;
+    std::atomic<float> level[maxChannels];
+
+    // Histogram of the callback load in percent, the last bin counts everything above it
+    // Callbacks that took longer than their buffer lasts are counted as xruns
+    static constexpr int numLoadBins = 200;
+    std::atomic<uint32> loadHistogram[numLoadBins];
+    std::atomic<uint32> xrunCount = 0;
+
+    // Highest load since the statusbar last took it
+    std::atomic<float> peakLoad = 0.0f;
+
+    int numChannels;
+    double sampleRate = 44100.0;
 };
@@ -0,0 +1,165 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "AudioRecorder.h"
+
+AudioRecorder::AudioRecorder()
+{
+    formatManager.registerBasicFormats();
+}
+
+AudioRecorder::~AudioRecorder()
+{
+    stop();
+    writerThread.stopThread(2000);
+}
+
+void AudioRecorder::prepare(int numChannels, int maxBlockSize)
+{
+    ScopedLock const sl(takesLock);
+    conversionBuffer.setSize(numChannels, maxBlockSize, false, false, true);
+}
+
+String AudioRecorder::start(File const& file, double sampleRate, int firstChannel, int numChannels, int bitDepth)
+{
+    if (numChannels <= 0)
+        return "there are no channels to record";
+
+    auto target = file.hasFileExtension("") ? file.withFileExtension("wav") : file;
+    auto* format = formatManager.findFormatForFileExtension(target.getFileExtension());
+    if (!format)
+        return "unknown audio format " + target.getFileExtension();
+
+    auto bitDepths = format->getPossibleBitDepths();
+    if (!bitDepths.contains(bitDepth) && !bitDepths.isEmpty())
+        bitDepth = bitDepths.getLast();
+
+    // Starting over on the same file replaces the take, the old writer has to finish and close the file before it can be reopened
+    stop(target);
+
+    // Opening the file and writing the header happens here, so the audio thread only ever sees takes that are ready
+    target.getParentDirectory().createDirectory();
+    target.deleteFile();
+
+    auto stream = target.createOutputStream();
+    if (!stream)
+        return "couldn't open " + target.getFullPathName();
+
+    // The writer only takes ownership of the stream when it could be created
+    auto* writer = format->createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(numChannels), bitDepth, {}, 0);
+    if (!writer) {
+        stream.reset();
+        target.deleteFile();
+        return format->getFormatName() + " can't be written with " + String(numChannels) + " channels at " + String(sampleRate) + " Hz";
+    }
+    stream.release();
+
+    if (!writerThread.isThreadRunning())
+        writerThread.startThread();
+
+    auto take = std::make_unique<Take>();
+    take->file = target;
+    take->firstChannel = firstChannel;
+    take->numChannels = numChannels;
+    take->writer = std::make_unique<AudioFormatWriter::ThreadedWriter>(writer, writerThread, roundToInt(sampleRate * bufferSeconds));
+
+    {
+        ScopedLock const sl(takesLock);
+
+        if (takes.empty())
+            droppedSamples = 0;
+        takes.push_back(std::move(take));
+
+        recording = true;
+    }
+
+    return {};
+}
+
+void AudioRecorder::stop(File const& file)
+{
+    auto const target = file == File() || !file.hasFileExtension("") ? file : file.withFileExtension("wav");
+    std::vector<std::unique_ptr<Take>> stopped;
+
+    {
+        ScopedLock const sl(takesLock);
+
+        for (auto it = takes.begin(); it != takes.end();) {
+            if (target == File() || (*it)->file == target) {
+                stopped.push_back(std::move(*it));
+                it = takes.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        recording = !takes.empty();
+    }
+
+    // Deleting a ThreadedWriter writes what's left in its FIFO and closes the file, that can take a while
+    stopped.clear();
+}
+
+bool AudioRecorder::isRecording() const
+{
+    return recording.load(std::memory_order_relaxed);
+}
+
+int64 AudioRecorder::getNumDroppedSamples() const
+{
+    return droppedSamples.load(std::memory_order_relaxed);
+}
+
+void AudioRecorder::process(AudioBuffer<float> const& buffer)
+{
+    if (!recording.load(std::memory_order_relaxed))
+        return;
+
+    write(buffer.getArrayOfReadPointers(), buffer.getNumChannels(), buffer.getNumSamples());
+}
+
+void AudioRecorder::process(AudioBuffer<double> const& buffer)
+{
+    if (!recording.load(std::memory_order_relaxed))
+        return;
+
+    ScopedTryLock const sl(takesLock);
+    if (!sl.isLocked()) {
+        droppedSamples += buffer.getNumSamples();
+        return;
+    }
+
+    auto const numChannels = std::min(buffer.getNumChannels(), conversionBuffer.getNumChannels());
+    auto const numSamples = std::min(buffer.getNumSamples(), conversionBuffer.getNumSamples());
+
+    for (int ch = 0; ch < numChannels; ch++) {
+        auto const* source = buffer.getReadPointer(ch);
+        auto* destination = conversionBuffer.getWritePointer(ch);
+        for (int i = 0; i < numSamples; i++)
+            destination[i] = static_cast<float>(source[i]);
+    }
+
+    write(conversionBuffer.getArrayOfReadPointers(), numChannels, numSamples);
+}
+
+void AudioRecorder::write(float const* const* channels, int numChannels, int numSamples)
+{
+    // The lock is reentrant, so the double version can hold it while converting
+    ScopedTryLock const sl(takesLock);
+    if (!sl.isLocked()) {
+        droppedSamples += numSamples;
+        return;
+    }
+
+    for (auto& take : takes) {
+        // The bus of a take can be gone after the layout changed
+        if (take->firstChannel + take->numChannels > numChannels)
+            continue;
+
+        if (!take->writer->write(channels + take->firstChannel, numSamples))
+            droppedSamples += numSamples;
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Writes the output of the processor to audio files, without touching the disk on the audio thread
+// Every take copies its channels into the FIFO of a ThreadedWriter, a background thread writes them to the file from there
+// A take is the whole output or the channels of one output bus, several can run at once for multitrack recordings
+class AudioRecorder {
+public:
+    AudioRecorder();
+    ~AudioRecorder();
+
+    // Sizes the buffer for converting to float when pd uses doubles. Not on the audio thread
+    void prepare(int numChannels, int maxBlockSize);
+
+    // Starts writing channels [firstChannel, firstChannel + numChannels) of the output to file. Not on the audio thread
+    // The format follows the extension, files without one are written as wav
+    // Returns an empty string when the take was started, or the reason it couldn't be
+    String start(File const& file, double sampleRate, int firstChannel, int numChannels, int bitDepth = 24);
+
+    // Stops the take that writes to file, or all of them when file is empty. Waits until they are written. Not on the audio thread
+    void stop(File const& file = File());
+
+    bool isRecording() const;
+
+    // Samples that didn't fit in a FIFO because the disk couldn't keep up, since the last take was started while none were running
+    int64 getNumDroppedSamples() const;
+
+    // Called with the final output of every audio callback, only copies into the FIFOs
+    // While a take is being started or stopped the block is dropped instead of waiting for it
+    void process(AudioBuffer<float> const& buffer);
+    void process(AudioBuffer<double> const& buffer);
+
+private:
+    struct Take {
+        File file;
+        int firstChannel;
+        int numChannels;
+        std::unique_ptr<AudioFormatWriter::ThreadedWriter> writer;
+    };
+
+    void write(float const* const* channels, int numChannels, int numSamples);
+
+    // Seconds of audio that each FIFO holds, before the disk falling behind makes it drop samples
+    static constexpr double bufferSeconds = 2.0;
+
+    TimeSliceThread writerThread { "Audio Recorder" };
+    AudioFormatManager formatManager;
+
+    std::vector<std::unique_ptr<Take>> takes;
+    CriticalSection takesLock;
+    std::atomic<bool> recording { false };
+
+    AudioBuffer<float> conversionBuffer;
+    std::atomic<int64> droppedSamples { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(AudioRecorder)
+};
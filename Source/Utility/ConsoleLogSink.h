@@ -0,0 +1,109 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+#include <JuceHeader.h>
+
+#include "concurrentqueue.h"
+
+// Writes console messages to a log file on a background thread
+// When the file gets too large it's rotated, only a few of the older files are kept
+class ConsoleLogSink : private Thread {
+public:
+    explicit ConsoleLogSink(File file, int64 maxSize = 8 * 1024 * 1024, int numOldFiles = 4)
+        : Thread("Console Log")
+        , logFile(std::move(file))
+        , maxFileSize(maxSize)
+        , maxOldFiles(numOldFiles)
+    {
+        startThread(1);
+    }
+
+    ~ConsoleLogSink() override
+    {
+        stopThread(2000);
+    }
+
+    File const& getFile() const { return logFile; }
+
+    // Can be called from any thread
+    void write(String const& message, int type)
+    {
+        pendingLines.enqueue(Time::getCurrentTime().formatted("[%Y-%m-%d %H:%M:%S] ") + (type == 2 ? "error: " : type == 1 ? "warning: " : "") + message);
+        notify();
+    }
+
+private:
+    void run() override
+    {
+        while (!threadShouldExit()) {
+            wait(1000);
+            writePendingLines();
+        }
+
+        // Write whatever is left when we get closed
+        writePendingLines();
+    }
+
+    void writePendingLines()
+    {
+        String line;
+        bool wroteAnything = false;
+
+        while (pendingLines.try_dequeue(line)) {
+            if (!stream && !openStream())
+                continue; // Drop lines if we can't write them, otherwise they'd pile up in memory
+
+            *stream << line << newLine;
+            wroteAnything = true;
+
+            if (stream->getPosition() >= maxFileSize) {
+                rotate();
+            }
+        }
+
+        if (wroteAnything && stream) {
+            stream->flush();
+        }
+    }
+
+    bool openStream()
+    {
+        logFile.getParentDirectory().createDirectory();
+
+        stream = std::make_unique<FileOutputStream>(logFile);
+        if (stream->failedToOpen()) {
+            stream.reset();
+            return false;
+        }
+
+        return true;
+    }
+
+    File getOldFile(int idx) const
+    {
+        return logFile.getSiblingFile(logFile.getFileNameWithoutExtension() + "." + String(idx) + logFile.getFileExtension());
+    }
+
+    // plugdata.log becomes plugdata.1.log, plugdata.1.log becomes plugdata.2.log, and so on
+    void rotate()
+    {
+        stream.reset();
+
+        getOldFile(maxOldFiles).deleteFile();
+        for (int i = maxOldFiles - 1; i >= 1; i--) {
+            getOldFile(i).moveFileTo(getOldFile(i + 1));
+        }
+        logFile.moveFileTo(getOldFile(1));
+    }
+
+    File logFile;
+    int64 maxFileSize;
+    int maxOldFiles;
+
+    std::unique_ptr<FileOutputStream> stream;
+    moodycamel::ConcurrentQueue<String> pendingLines;
+};
@@ -6,40 +6,103 @@
 
 #pragma once
 #include <JuceHeader.h>
+#include <unordered_map>
 
+// Measures text like Font::getStringWidthFloat, but from cached glyph advances
+// Printable ASCII gets a full advance and kerning table, other codepoints are measured once on first use
+// Not thread safe: the lazy caches are filled from whichever thread measures
 struct FastStringWidth {
 
-    inline static constexpr uint64_t num_items = 1ul << (sizeof(char) * 8ul);
+    FastStringWidth(Font const& f)
+        : font(f)
+    {
+        for (int i = 0; i < numAscii; i++) {
+            asciiWidths[i] = measure(String::charToString(static_cast<juce_wchar>(i + firstAscii)));
+        }
 
-    std::array<float, num_items> widths;
+        kerning.fill(notMeasured);
+    }
 
-    FastStringWidth(Font font)
+    float getStringWidth(StringRef text) const
     {
-        for (int i = 0; i < num_items; i++) {
-            widths[i] = font.getStringWidth(String(std::string(1, (char)i)));
+        float totalWidth = 0.0f;
+        juce_wchar last = 0;
+
+        for (auto t = text.text; !t.isEmpty();) {
+            auto c = t.getAndAdvance();
+
+            if (isAscii(c)) {
+                totalWidth += asciiWidths[c - firstAscii];
+                if (isAscii(last)) {
+                    totalWidth += getKerning(last, c);
+                }
+            } else {
+                totalWidth += getCodepointWidth(c);
+            }
+
+            last = c;
         }
+
+        return totalWidth;
     }
 
-    float getStringWidth(String text) const
+    Font const& getFont() const
     {
-        float totalWidth = 0.0f;
+        return font;
+    }
 
-        auto* utf8 = text.toRawUTF8();
-        auto numBytes = text.getNumBytesAsUTF8();
+    // Shared measurers per font, for callers that don't want to keep their own. Message thread only
+    static FastStringWidth const& forFont(Font const& font)
+    {
+        static std::unordered_map<String, std::unique_ptr<FastStringWidth>> cache;
 
-        for (int i = 0; i < numBytes; i++) {
-            totalWidth += widths[(int)utf8[i]];
+        auto key = font.toString();
+        auto& measurer = cache[key];
+        if (!measurer) {
+            measurer = std::make_unique<FastStringWidth>(font);
         }
 
-        // In real text, letters are slightly closer together
-        return totalWidth * 0.8f;
+        return *measurer;
+    }
+
+private:
+    static constexpr juce_wchar firstAscii = 32;
+    static constexpr int numAscii = 127 - firstAscii;
+    static constexpr float notMeasured = std::numeric_limits<float>::max();
+
+    static bool isAscii(juce_wchar c)
+    {
+        return c >= firstAscii && c < firstAscii + numAscii;
+    }
+
+    float measure(String const& text) const
+    {
+        return font.getStringWidthFloat(text);
+    }
+
+    float getKerning(juce_wchar first, juce_wchar second) const
+    {
+        auto& pair = kerning[(first - firstAscii) * numAscii + (second - firstAscii)];
+        if (pair == notMeasured) {
+            auto pairWidth = measure(String::charToString(first) + String::charToString(second));
+            pair = pairWidth - asciiWidths[first - firstAscii] - asciiWidths[second - firstAscii];
+        }
+
+        return pair;
+    }
+
+    float getCodepointWidth(juce_wchar c) const
+    {
+        auto it = codepointWidths.find(c);
+        if (it != codepointWidths.end())
+            return it->second;
+
+        return codepointWidths[c] = measure(String::charToString(c));
     }
 
-    /*
-    // some tests
-    const String testString = "The quick brown fox jumps over the lazy dog";
-    void test(Font font) {
-        std::cout << "accuracy:" << getStringWidth(testString) / font.getStringWidthFloat(testString) << std::endl;
+    Font font;
 
-    } */
+    std::array<float, numAscii> asciiWidths;
+    mutable std::array<float, numAscii * numAscii> kerning;
+    mutable std::unordered_map<juce_wchar, float> codepointWidths;
 };
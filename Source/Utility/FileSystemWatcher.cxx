@@ -27,12 +27,55 @@ For more information visit www.rabiensoftware.com
  #include <sys/time.h>
 #endif
 
+#if JUCE_MAC || JUCE_WINDOWS
+static constexpr bool watchesRecursively = true;
+#else
+static constexpr bool watchesRecursively = false;
+#endif
+
+#if defined JUCE_MAC || defined JUCE_WINDOWS || defined JUCE_LINUX
+//==============================================================================
+// Shared by all watchers in the process, it's deleted with the last one. Only used on the message thread
+// Every folder gets one stream, no matter how many watchers added it, and folders inside a recursively watched one get none
+class FileSystemWatcher::Service : private Timer
+{
+public:
+    ~Service() override;
+
+    void addFolder (FileSystemWatcher& watcher, const File& folder);
+    void removeFolder (FileSystemWatcher& watcher, const File& folder);
+    void removeWatcher (FileSystemWatcher& watcher);
+
+    // Called by the streams with every change they saw
+    void fileChanged (const File& file, FileSystemEvent fsEvent);
+
+private:
+    struct Root
+    {
+        File folder;
+        int numUsers = 0;
+        std::unique_ptr<Impl> impl;
+    };
+
+    // Starts the streams of the folders that aren't inside another watched folder, and stops the ones that are now
+    void updateStreams();
+
+    void timerCallback() override;
+
+    std::vector<Root> roots;
+    Array<FileSystemWatcher*> watchers;
+
+    Array<Event> pending;
+    uint32 firstPendingTime = 0;
+};
+#endif
+
 //==============================================================================
 #if JUCE_MAC
 class FileSystemWatcher::Impl
 {
 public:
-    Impl (FileSystemWatcher& o, File f) : owner (o), folder (f)
+    Impl (Service& o, File f) : owner (o), folder (f)
     {
         NSString* newPath = [NSString stringWithUTF8String:folder.getFullPathName().toRawUTF8()];
 
@@ -70,7 +113,6 @@ public:
         ignoreUnused (streamRef, numEvents, eventIds, eventPaths, eventFlags);
 
         Impl* impl = (Impl*)clientCallBackInfo;
-        impl->owner.folderChanged (impl->folder);
 
         char** files = (char**)eventPaths;
 
@@ -91,7 +133,7 @@ public:
         }
     }
 
-    FileSystemWatcher& owner;
+    Service& owner;
     const File folder;
 
     NSArray* paths;
@@ -108,22 +150,7 @@ class FileSystemWatcher::Impl : public Thread,
                                 private AsyncUpdater
 {
 public:
-    struct Event
-    {
-        Event () {}
-        Event (Event& other) = default;
-        Event (Event&& other) = default;
-
-        File file;
-        FileSystemEvent fsEvent;
-
-        bool operator== (const Event& other) const
-        {
-            return file == other.file && fsEvent == other.fsEvent;
-        }
-    };
-
-    Impl (FileSystemWatcher& o, File f)
+    Impl (Service& o, File f)
       : Thread ("FileSystemWatcher::Impl"), owner (o), folder (f)
     {
         fd = inotify_init();
@@ -172,7 +199,9 @@ public:
                 else if (iNotifyEvent->mask & IN_MOVED_FROM)  e.fsEvent = FileSystemEvent::fileRenamedOldName;
                 else if (iNotifyEvent->mask & IN_MOVED_TO)    e.fsEvent = FileSystemEvent::fileRenamedNewName;
                 else if (iNotifyEvent->mask & IN_DELETE)      e.fsEvent = FileSystemEvent::fileDeleted;
+                else                                          e.fsEvent = FileSystemEvent::fileUpdated;
 
+                ScopedLock sl (lock);
 
                 bool duplicateEvent = false;
                 for (auto existing : events)
@@ -197,15 +226,13 @@ public:
     {
         ScopedLock sl (lock);
 
-        owner.folderChanged (folder);
-
         for (auto& e : events)
             owner.fileChanged (e.file, e.fsEvent);
 
         events.clear();
     }
 
-    FileSystemWatcher& owner;
+    Service& owner;
     File folder;
 
     CriticalSection lock;
@@ -222,18 +249,7 @@ class FileSystemWatcher::Impl : private AsyncUpdater,
                                 private Thread
 {
 public:
-    struct Event
-    {
-        File file;
-        FileSystemEvent fsEvent;
-
-        bool operator== (const Event& other) const
-        {
-            return file == other.file && fsEvent == other.fsEvent;
-        }
-    };
-
-    Impl (FileSystemWatcher& o, File f)
+    Impl (Service& o, File f)
       : Thread ("FileSystemWatcher::Impl"), owner (o), folder (f)
     {
         WCHAR path[_MAX_PATH] = {0};
@@ -335,15 +351,13 @@ public:
     {
         ScopedLock sl (lock);
 
-        owner.folderChanged (folder);
-
         for (auto e : events)
             owner.fileChanged (e.file, e.fsEvent);
 
         events.clear();
     }
 
-    FileSystemWatcher& owner;
+    Service& owner;
     const File folder;
 
     CriticalSection lock;
@@ -354,12 +368,121 @@ public:
 #endif
 
 #if defined JUCE_MAC || defined JUCE_WINDOWS || defined JUCE_LINUX
+FileSystemWatcher::Service::~Service()
+{
+    stopTimer();
+    roots.clear();
+}
+
+void FileSystemWatcher::Service::addFolder (FileSystemWatcher& watcher, const File& folder)
+{
+    watchers.addIfNotAlreadyThere (&watcher);
+
+    for (auto& root : roots)
+    {
+        if (root.folder == folder)
+        {
+            root.numUsers++;
+            return;
+        }
+    }
+
+    roots.push_back ({ folder, 1, nullptr });
+    updateStreams();
+}
+
+void FileSystemWatcher::Service::removeFolder (FileSystemWatcher& watcher, const File& folder)
+{
+    ignoreUnused (watcher);
+
+    for (auto it = roots.begin(); it != roots.end(); ++it)
+    {
+        if (it->folder == folder)
+        {
+            // The folders inside it might need a stream of their own now
+            if (--it->numUsers == 0)
+            {
+                roots.erase (it);
+                updateStreams();
+            }
+            break;
+        }
+    }
+}
+
+void FileSystemWatcher::Service::removeWatcher (FileSystemWatcher& watcher)
+{
+    for (auto& folder : watcher.folders)
+        removeFolder (watcher, folder);
+
+    watchers.removeFirstMatchingValue (&watcher);
+}
+
+void FileSystemWatcher::Service::updateStreams()
+{
+    for (auto& root : roots)
+    {
+        bool covered = false;
+
+        if (watchesRecursively)
+        {
+            for (auto& other : roots)
+            {
+                if (&other != &root && root.folder.isAChildOf (other.folder))
+                {
+                    covered = true;
+                    break;
+                }
+            }
+        }
+
+        if (covered)
+            root.impl.reset();
+        else if (! root.impl)
+            root.impl = std::make_unique<Impl> (*this, root.folder);
+    }
+}
+
+void FileSystemWatcher::Service::fileChanged (const File& file, FileSystemEvent fsEvent)
+{
+    Event e { file, fsEvent };
+
+    if (! pending.contains (e))
+        pending.add (std::move (e));
+
+    auto now = Time::getMillisecondCounter();
+    if (! isTimerRunning())
+        firstPendingTime = now;
+
+    // Restarted by every change, so a burst like a library being unpacked arrives as one batch
+    auto remaining = maxDebounceTime - static_cast<int> (now - firstPendingTime);
+    startTimer (jlimit (1, debounceTime, remaining));
+}
+
+void FileSystemWatcher::Service::timerCallback()
+{
+    stopTimer();
+
+    auto events = std::move (pending);
+    pending.clear();
+
+    // A listener of one watcher can delete another one
+    auto current = watchers;
+    for (auto* watcher : current)
+    {
+        if (watchers.contains (watcher))
+            watcher->dispatch (events);
+    }
+}
+
+//==============================================================================
 FileSystemWatcher::FileSystemWatcher()
 {
 }
 
 FileSystemWatcher::~FileSystemWatcher()
 {
+    service->removeWatcher (*this);
 }
 
 void FileSystemWatcher::addFolder (const File& folder)
@@ -367,25 +490,28 @@ void FileSystemWatcher::addFolder (const File& folder)
     // You can only listen to folders that exist
     jassert (folder.isDirectory());
 
-    if ( ! getWatchedFolders().contains (folder))
-        watched.add (new Impl (*this, folder));
+    if (! folders.contains (folder))
+    {
+        folders.add (folder);
+        service->addFolder (*this, folder);
+    }
 }
 
 void FileSystemWatcher::removeFolder (const File& folder)
 {
-    for (int i = watched.size(); --i >= 0;)
+    if (folders.contains (folder))
     {
-        if (watched[i]->folder == folder)
-        {
-            watched.remove (i);
-            break;
-        }
+        folders.removeFirstMatchingValue (folder);
+        service->removeFolder (*this, folder);
     }
 }
 
 void FileSystemWatcher::removeAllFolders()
 {
-    watched.clear();
+    for (auto& folder : folders)
+        service->removeFolder (*this, folder);
+
+    folders.clear();
 }
 
 void FileSystemWatcher::addListener (Listener* newListener)
@@ -398,24 +524,42 @@ void FileSystemWatcher::removeListener (Listener* listener)
     listeners.remove (listener);
 }
 
-void FileSystemWatcher::folderChanged (const File& folder)
+void FileSystemWatcher::dispatch (const Array<Event>& events)
 {
-    listeners.call (&FileSystemWatcher::Listener::folderChanged, folder);
-}
+    Array<File> changedFolders;
+    Array<Event> changes;
 
-void FileSystemWatcher::fileChanged (const File& file, FileSystemEvent fsEvent)
-{
-    listeners.call (&FileSystemWatcher::Listener::fileChanged, file, fsEvent);
+    for (auto& e : events)
+    {
+        for (auto& folder : folders)
+        {
+            // Without recursive streams, changes in subfolders aren't reported even when the subfolder is watched by someone else
+            auto inside = watchesRecursively ? e.file.isAChildOf (folder) : e.file.getParentDirectory() == folder;
+
+            if (inside)
+            {
+                changedFolders.addIfNotAlreadyThere (folder);
+                changes.add (e);
+                break;
+            }
+        }
+    }
+
+    if (changes.isEmpty())
+        return;
+
+    for (auto& folder : changedFolders)
+        listeners.call (&FileSystemWatcher::Listener::folderChanged, folder);
+
+    for (auto& e : changes)
+        listeners.call (&FileSystemWatcher::Listener::fileChanged, e.file, e.fsEvent);
+
+    listeners.call (&FileSystemWatcher::Listener::fsChangeCallback);
 }
 
 Array<File> FileSystemWatcher::getWatchedFolders()
 {
-    Array<File> res;
-
-    for (auto w : watched)
-        res.add (w->folder);
-
-    return res;
+    return folders;
 }
 
 #endif
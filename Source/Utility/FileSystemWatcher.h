@@ -20,6 +20,11 @@ For more information visit www.rabiensoftware.com
     FileSystemWatcher will also recursively watch all subfolders on
     macOS and windows and will not on Linux.
 
+    All watchers in the process share one stream per folder, folders
+    inside a folder that is already watched recursively don't get a
+    stream of their own. Changes are collected over debounceTime and
+    every listener gets the ones inside its folders in one batch.
+
  */
 class FileSystemWatcher {
 public:
@@ -53,33 +58,32 @@ public:
         fileRenamedNewName
     };
 
+    /** Time in milliseconds that changes are collected for before they're sent,
+        restarted by every change but never longer than maxDebounceTime in total */
+    static constexpr int debounceTime = 200;
+    static constexpr int maxDebounceTime = 1000;
+
     //==============================================================================
     /** Receives callbacks from the FileSystemWatcher when a file changes */
-    class Listener : public Timer {
+    class Listener {
     public:
         virtual ~Listener() = default;
 
+        /* Called once for every batch of changes, after the folderChanged and fileChanged
+           calls of that batch */
         virtual void fsChangeCallback() = 0;
 
-        // group changes together
-        void timerCallback()
-        {
-            fsChangeCallback();
-            stopTimer();
-        }
         /* Called when any file in the listened to folder changes with the name of
            the folder that has changed. For example, use this for a file browser that
            needs to refresh any time a file changes */
-        void folderChanged(const File)
+        virtual void folderChanged(const File)
         {
-            startTimer(200);
         }
 
         /* Called for each file that has changed and how it has changed. Use this callback
            if you need to reload a file when it's contents change */
-        void fileChanged(const File, FileSystemEvent)
+        virtual void fileChanged(const File, FileSystemEvent)
         {
-            startTimer(200);
         }
     };
 
@@ -95,13 +99,26 @@ public:
 
 private:
     class Impl;
+    class Service;
+
+    struct Event {
+        File file;
+        FileSystemEvent fsEvent;
 
-    void folderChanged(File const& folder);
-    void fileChanged(File const& file, FileSystemEvent fsEvent);
+        bool operator==(Event const& other) const
+        {
+            return file == other.file && fsEvent == other.fsEvent;
+        }
+    };
+
+    // Called by the service with the batch of all changes, sends the ones inside our folders to the listeners
+    void dispatch(Array<Event> const& events);
 
     ListenerList<Listener> listeners;
 
-    OwnedArray<Impl> watched;
+    Array<File> folders;
+
+    SharedResourcePointer<Service> service;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FileSystemWatcher)
 };
@@ -0,0 +1,217 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+// Overview of the whole patch in the corner of the canvas, clicking or dragging in it moves the view there
+// It's drawn from the object positions and connections in pd instead of the canvas' components, so it also works for canvases that aren't loaded
+// The drawing is cached, moving the view only draws the visible area on top of it
+struct Minimap : public Component
+    , public AsyncUpdater {
+
+    Minimap(Canvas* parent, Viewport* parentViewport)
+        : cnv(parent)
+        , viewport(parentViewport)
+    {
+        setAlwaysOnTop(true);
+        setVisible(false);
+    }
+
+    // Called when objects or connections changed, the geometry is read again once the message loop gets to it
+    void patchChanged()
+    {
+        triggerAsyncUpdate();
+    }
+
+    // Called when the view moved, got zoomed or resized
+    void visibleAreaChanged()
+    {
+        updatePlacement();
+        repaint();
+    }
+
+    void handleAsyncUpdate() override
+    {
+        updateGeometry();
+    }
+
+    void paint(Graphics& g) override
+    {
+        g.setColour(findColour(PlugDataColour::canvasBackgroundColourId).withAlpha(0.9f));
+        g.fillRoundedRectangle(getLocalBounds().toFloat(), Constants::smallCornerRadius);
+
+        g.setColour(findColour(PlugDataColour::outlineColourId));
+        g.drawRoundedRectangle(getLocalBounds().toFloat().reduced(0.5f), Constants::smallCornerRadius, 1.0f);
+
+        if (cachedImage.isNull() || cachedImage.getWidth() != getWidth() || cachedImage.getHeight() != getHeight())
+        {
+            renderImage();
+        }
+
+        g.drawImageAt(cachedImage, 0, 0);
+
+        g.setColour(findColour(PlugDataColour::objectSelectedOutlineColourId));
+        g.drawRect(toMinimap(getVisibleArea()).getIntersection(getLocalBounds().toFloat()), 1.0f);
+    }
+
+    void mouseDown(MouseEvent const& e) override
+    {
+        moveViewTo(e.position);
+    }
+
+    void mouseDrag(MouseEvent const& e) override
+    {
+        moveViewTo(e.position);
+    }
+
+private:
+    // Reads the bounds of all objects and connections from pd, this is the only part that needs pd's lock
+    void updateGeometry()
+    {
+        if (!cnv || !cnv->patch.getPointer())
+            return;
+
+        objectBounds.clear();
+        cables.clear();
+
+        cnv->pd->getCallbackLock()->enter();
+
+        auto* patchPtr = cnv->patch.getPointer();
+        auto pdObjects = cnv->patch.getObjects();
+
+        std::unordered_map<void*, size_t> indices;
+        indices.reserve(pdObjects.size());
+
+        for (auto* obj : pdObjects)
+        {
+            int x = 0, y = 0, w = 0, h = 0;
+            libpd_get_object_bounds(patchPtr, obj, &x, &y, &w, &h);
+
+            indices[obj] = objectBounds.size();
+            objectBounds.push_back(Rectangle<int>(x, y, std::max(w, 1), std::max(h, 1)));
+        }
+
+        // Cables go from the middle of the outlet to the middle of the inlet, exact iolet positions don't matter at this size
+        for (auto& [inno, src, outno, sink] : cnv->patch.getConnections())
+        {
+            auto srcIt = indices.find(&src->te_g);
+            auto sinkIt = indices.find(&sink->te_g);
+            if (srcIt == indices.end() || sinkIt == indices.end())
+                continue;
+
+            auto const& start = objectBounds[srcIt->second];
+            auto const& end = objectBounds[sinkIt->second];
+            auto const numOutlets = static_cast<float>(std::max(obj_noutlets(src), 1));
+            auto const numInlets = static_cast<float>(std::max(obj_ninlets(sink), 1));
+
+            cables.push_back(Line<float>(start.getX() + start.getWidth() * (outno + 0.5f) / numOutlets, start.getBottom(),
+                end.getX() + end.getWidth() * (inno + 0.5f) / numInlets, end.getY()));
+        }
+
+        cnv->pd->getCallbackLock()->exit();
+
+        patchBounds = Rectangle<int>();
+        for (auto const& bounds : objectBounds)
+        {
+            patchBounds = patchBounds.isEmpty() ? bounds : patchBounds.getUnion(bounds);
+        }
+
+        cachedImage = Image();
+        updatePlacement();
+        repaint();
+    }
+
+    // Only shown while part of the patch is out of view
+    void updatePlacement()
+    {
+        if (!cnv || !viewport || patchBounds.isEmpty() || getVisibleArea().contains(patchBounds.toFloat()))
+        {
+            setVisible(false);
+            return;
+        }
+
+        auto const area = patchBounds.toFloat().expanded(margin);
+        auto const scale = std::min(maxSize / area.getWidth(), maxSize / area.getHeight());
+        auto const width = std::max(roundToInt(area.getWidth() * scale), 1);
+        auto const height = std::max(roundToInt(area.getHeight() * scale), 1);
+
+        auto const thickness = viewport->getScrollBarThickness();
+        setBounds(viewport->getWidth() - width - thickness - 8, viewport->getHeight() - height - thickness - 8, width, height);
+        setVisible(true);
+    }
+
+    void renderImage()
+    {
+        cachedImage = Image(Image::ARGB, std::max(getWidth(), 1), std::max(getHeight(), 1), true);
+        Graphics g(cachedImage);
+
+        g.setColour(findColour(PlugDataColour::connectionColourId).withAlpha(0.6f));
+        for (auto const& cable : cables)
+        {
+            auto const start = toMinimap(cable.getStart());
+            auto const end = toMinimap(cable.getEnd());
+            g.drawLine(start.x, start.y, end.x, end.y, 1.0f);
+        }
+
+        g.setColour(findColour(PlugDataColour::objectOutlineColourId));
+        for (auto const& bounds : objectBounds)
+        {
+            auto const rect = toMinimap(bounds.toFloat());
+            g.fillRect(rect.withSize(std::max(rect.getWidth(), 1.0f), std::max(rect.getHeight(), 1.0f)));
+        }
+    }
+
+    // Part of the patch that's in view, in pd's coordinates
+    Rectangle<float> getVisibleArea() const
+    {
+        if (!cnv || !viewport)
+            return {};
+
+        return cnv->getLocalArea(viewport, viewport->getLocalBounds()).toFloat() - cnv->canvasOrigin.toFloat();
+    }
+
+    Rectangle<float> getMappedArea() const
+    {
+        return patchBounds.toFloat().expanded(margin);
+    }
+
+    Point<float> toMinimap(Point<float> point) const
+    {
+        auto const area = getMappedArea();
+        return { (point.x - area.getX()) * getWidth() / area.getWidth(), (point.y - area.getY()) * getHeight() / area.getHeight() };
+    }
+
+    Rectangle<float> toMinimap(Rectangle<float> rect) const
+    {
+        return Rectangle<float>(toMinimap(rect.getTopLeft()), toMinimap(rect.getBottomRight()));
+    }
+
+    void moveViewTo(Point<float> position)
+    {
+        if (!cnv || !viewport || getWidth() == 0 || getHeight() == 0)
+            return;
+
+        auto const area = getMappedArea();
+        auto const patchPosition = Point<float>(area.getX() + position.x * area.getWidth() / getWidth(), area.getY() + position.y * area.getHeight() / getHeight());
+
+        auto const scale = static_cast<float>(cnv->main.zoomScale.getValue());
+        auto pos = (patchPosition + cnv->canvasOrigin.toFloat()) * scale;
+        pos.x -= viewport->getViewWidth() * 0.5f;
+        pos.y -= viewport->getViewHeight() * 0.5f;
+
+        viewport->setViewPosition(pos.roundToInt());
+    }
+
+    Component::SafePointer<Canvas> cnv;
+    Viewport* viewport;
+
+    std::vector<Rectangle<int>> objectBounds;
+    std::vector<Line<float>> cables;
+    Rectangle<int> patchBounds;
+
+    Image cachedImage;
+
+    static constexpr float maxSize = 180.0f;
+    static constexpr float margin = 20.0f;
+};
@@ -138,13 +138,14 @@ Point<int> ObjectGrid::performVerticalSnap(Object* toDrag, Point<int> dragOffset
         return { dragOffset.x, position[0].y };
     }
 
-    for (auto* object : cnv->objects) {
+    // Only objects that vertically overlap the dragged object, plus the tolerance, can snap to it
+    auto dragBounds = toDrag->getBounds().withPosition(toDrag->mouseDownPos + dragOffset).reduced(Object::margin);
+    auto snapArea = viewBounds.getIntersection(viewBounds.withY(dragBounds.getY() - tolerance).withBottom(dragBounds.getBottom() + tolerance).expanded(0, Object::margin));
+
+    for (auto* object : cnv->objectIndex.query(snapArea)) {
         if (cnv->isSelected(object))
             continue; // don't look at selected objects
 
-        if (!viewBounds.intersects(object->getBounds()))
-            continue; // if the object is out of viewport bounds
-
         auto b1 = object->getBounds().reduced(Object::margin);
         auto b2 = toDrag->getBounds().withPosition(toDrag->mouseDownPos + dragOffset).reduced(Object::margin);
 
@@ -221,13 +222,14 @@ Point<int> ObjectGrid::performHorizontalSnap(Object* toDrag, Point<int> dragOffs
         }
     }
 
-    for (auto* object : cnv->objects) {
+    // Only objects that horizontally overlap the dragged object, plus the tolerance, can snap to it
+    auto dragBounds = toDrag->getBounds().withPosition(toDrag->mouseDownPos + dragOffset).reduced(Object::margin);
+    auto snapArea = viewBounds.getIntersection(viewBounds.withX(dragBounds.getX() - tolerance).withRight(dragBounds.getRight() + tolerance).expanded(Object::margin, 0));
+
+    for (auto* object : cnv->objectIndex.query(snapArea)) {
         if (cnv->isSelected(object))
             continue; // don't look at selected objects
 
-        if (!viewBounds.intersects(object->getBounds()))
-            continue; // if the object is out of viewport bounds
-
         auto b1 = object->getBounds().reduced(Object::margin);
         auto b2 = toDrag->getBounds().withPosition(toDrag->mouseDownPos + dragOffset).reduced(Object::margin);
 
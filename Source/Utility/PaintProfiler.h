@@ -0,0 +1,278 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__GNUC__) || defined(__clang__)
+#include <cxxabi.h>
+#endif
+
+// Measures how long painting takes for each kind of component, to find out what makes large patches slow to draw
+// Times are exclusive: the time spent painting an instrumented child is only counted for the child
+// Painting only happens on one thread at a time, so this needs no locking. Does nothing until it's enabled
+class PaintProfiler {
+public:
+    struct ClassStats {
+        String name;
+        double milliseconds = 0.0;
+        int paints = 0;
+    };
+
+    struct FrameStats {
+        int frames = 0;
+        double averageMilliseconds = 0.0;
+        double maxMilliseconds = 0.0;
+        std::vector<ClassStats> classes; // slowest first
+    };
+
+    static PaintProfiler& getInstance()
+    {
+        static PaintProfiler instance;
+        return instance;
+    }
+
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    void setEnabled(bool shouldBeEnabled)
+    {
+        enabled = shouldBeEnabled;
+        reset();
+    }
+
+    // Called at the start of paint. Components whose paint gets skipped because opaque children cover them can still call endPaint
+    void beginPaint(Component const* component, std::type_index type)
+    {
+        if (!enabled)
+            return;
+
+        auto const now = Time::getHighResolutionTicks();
+
+        if (!frameOpen) {
+            frameOpen = true;
+            frameStart = now;
+        }
+
+        stack.push_back({ component, type, now, 0 });
+    }
+
+    void beginPaint(Component const* component)
+    {
+        beginPaint(component, typeid(*component));
+    }
+
+    void endPaint(Component const* component)
+    {
+        if (!enabled || stack.empty() || stack.back().component != component)
+            return;
+
+        auto const entry = stack.back();
+        stack.pop_back();
+
+        auto const elapsed = Time::getHighResolutionTicks() - entry.start;
+
+        auto& stats = classStats[entry.type];
+        stats.first += elapsed - entry.childTicks;
+        stats.second++;
+
+        if (!stack.empty())
+            stack.back().childTicks += elapsed;
+    }
+
+    // Called after the top level component has painted everything
+    void endFrame()
+    {
+        if (!enabled || !frameOpen)
+            return;
+
+        frameOpen = false;
+        stack.clear();
+
+        auto const elapsed = Time::getHighResolutionTicks() - frameStart;
+        frameTicks += elapsed;
+        maxFrameTicks = std::max(maxFrameTicks, elapsed);
+        numFrames++;
+    }
+
+    // Returns the stats since the last call, and starts counting again
+    FrameStats takeStats()
+    {
+        FrameStats result;
+        auto const toMilliseconds = 1000.0 / static_cast<double>(Time::getHighResolutionTicksPerSecond());
+
+        result.frames = numFrames;
+        result.averageMilliseconds = numFrames ? static_cast<double>(frameTicks) * toMilliseconds / numFrames : 0.0;
+        result.maxMilliseconds = static_cast<double>(maxFrameTicks) * toMilliseconds;
+
+        for (auto const& [type, stats] : classStats) {
+            result.classes.push_back({ getClassName(type), static_cast<double>(stats.first) * toMilliseconds, stats.second });
+        }
+
+        std::sort(result.classes.begin(), result.classes.end(), [](ClassStats const& a, ClassStats const& b) {
+            return a.milliseconds > b.milliseconds;
+        });
+
+        reset();
+        return result;
+    }
+
+    // Measures a paint call that has no paintOverChildren to end it
+    struct ScopedMeasurement {
+        explicit ScopedMeasurement(Component const* componentToMeasure)
+            : component(componentToMeasure)
+        {
+            getInstance().beginPaint(component);
+        }
+
+        ~ScopedMeasurement()
+        {
+            getInstance().endPaint(component);
+        }
+
+        Component const* const component;
+    };
+
+private:
+    struct StackEntry {
+        Component const* component;
+        std::type_index type;
+        int64 start;
+        int64 childTicks;
+    };
+
+    void reset()
+    {
+        classStats.clear();
+        numFrames = 0;
+        frameTicks = 0;
+        maxFrameTicks = 0;
+    }
+
+    static String getClassName(std::type_index type)
+    {
+        auto it = classNames.find(type);
+        if (it != classNames.end())
+            return it->second;
+
+        String name = type.name();
+
+#if defined(__GNUC__) || defined(__clang__)
+        int status = 0;
+        if (auto* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status)) {
+            name = String(demangled);
+            std::free(demangled);
+        }
+#else
+        name = name.fromFirstOccurrenceOf(" ", false, false);
+#endif
+
+        classNames[type] = name;
+        return name;
+    }
+
+    bool enabled = false;
+    bool frameOpen = false;
+    int64 frameStart = 0;
+
+    int numFrames = 0;
+    int64 frameTicks = 0;
+    int64 maxFrameTicks = 0;
+
+    std::vector<StackEntry> stack;
+    std::unordered_map<std::type_index, std::pair<int64, int>> classStats;
+
+    static inline std::unordered_map<std::type_index, String> classNames;
+};
+
+// Shows the frame times and the slowest component classes of the last second on top of the editor
+class PaintProfilerOverlay : public Component
+    , public Timer {
+public:
+    PaintProfilerOverlay()
+    {
+        setInterceptsMouseClicks(false, false);
+        setAlwaysOnTop(true);
+    }
+
+    ~PaintProfilerOverlay() override
+    {
+        PaintProfiler::getInstance().setEnabled(false);
+    }
+
+    void setActive(bool shouldBeActive)
+    {
+        PaintProfiler::getInstance().setEnabled(shouldBeActive);
+        setVisible(shouldBeActive);
+
+        if (shouldBeActive) {
+            lastUpdate = Time::getMillisecondCounterHiRes();
+            startTimer(1000);
+        } else {
+            stopTimer();
+        }
+    }
+
+    bool isActive() const
+    {
+        return PaintProfiler::getInstance().isEnabled();
+    }
+
+    void timerCallback() override
+    {
+        auto const now = Time::getMillisecondCounterHiRes();
+        seconds = std::max((now - lastUpdate) / 1000.0, 0.001);
+        lastUpdate = now;
+
+        stats = PaintProfiler::getInstance().takeStats();
+        repaint();
+    }
+
+    void paint(Graphics& g) override
+    {
+        g.setColour(Colours::black.withAlpha(0.75f));
+        g.fillRoundedRectangle(getLocalBounds().toFloat(), 4.0f);
+
+        g.setFont(Font(Font::getDefaultMonospacedFontName(), 12.0f, Font::plain));
+        g.setColour(Colours::white);
+
+        auto bounds = getLocalBounds().reduced(8, 6);
+        auto const lineHeight = 16;
+
+        g.drawText(String(stats.frames / seconds, 1) + " fps, " + String(stats.averageMilliseconds, 2) + " ms avg, " + String(stats.maxMilliseconds, 2) + " ms max", bounds.removeFromTop(lineHeight), Justification::centredLeft);
+
+        g.setColour(Colours::white.withAlpha(0.6f));
+        auto header = bounds.removeFromTop(lineHeight);
+        g.drawText("ms/s", header.removeFromRight(50), Justification::centredRight);
+        g.drawText("paints/s", header.removeFromRight(70), Justification::centredRight);
+        g.drawText("class", header, Justification::centredLeft);
+
+        g.setColour(Colours::white);
+
+        for (int i = 0; i < std::min<int>(maxClasses, stats.classes.size()); i++) {
+            auto const& classStats = stats.classes[i];
+            auto row = bounds.removeFromTop(lineHeight);
+            g.drawText(String(classStats.milliseconds / seconds, 1), row.removeFromRight(50), Justification::centredRight);
+            g.drawText(String(roundToInt(classStats.paints / seconds)), row.removeFromRight(70), Justification::centredRight);
+            g.drawText(classStats.name, row, Justification::centredLeft, true);
+        }
+    }
+
+    static constexpr int maxClasses = 8;
+    static constexpr int preferredWidth = 320;
+    static constexpr int preferredHeight = 12 + 16 * (maxClasses + 2);
+
+private:
+    PaintProfiler::FrameStats stats;
+    double lastUpdate = 0.0;
+    double seconds = 1.0;
+};
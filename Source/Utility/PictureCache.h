@@ -0,0 +1,102 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+#include <JuceHeader.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Decoded images shared by all [pic] objects, keyed by path and modification time
+// Images are decoded on a background thread, together with halved copies for drawing at small zoom levels
+// An image is dropped once no object holds it anymore. Message thread only
+struct PictureCache {
+
+    struct Picture {
+        Image image;
+
+        // Each one half the size of the previous one, the first one is half the size of the image
+        std::vector<Image> mipmaps;
+
+        // Returns the smallest version that still has at least one pixel per screen pixel at this scale
+        Image const& getImageForScale(float scale) const
+        {
+            auto const* best = &image;
+            for (auto& mipmap : mipmaps) {
+                if (scale * image.getWidth() > mipmap.getWidth())
+                    break;
+                best = &mipmap;
+            }
+            return *best;
+        }
+    };
+
+    using PicturePtr = std::shared_ptr<Picture const>;
+
+    static PictureCache& getInstance()
+    {
+        static PictureCache instance;
+        return instance;
+    }
+
+    // Calls onLoaded with the decoded image, right away if it's already cached
+    // The image is invalid if the file couldn't be decoded
+    void load(File const& file, std::function<void(PicturePtr)> onLoaded)
+    {
+        auto key = file.getFullPathName() + "@" + String(file.getLastModificationTime().toMilliseconds());
+
+        if (auto cached = pictures[key].lock()) {
+            onLoaded(cached);
+            return;
+        }
+
+        // Another object already asked for it, so it's being decoded
+        auto& waiting = pending[key];
+        waiting.push_back(std::move(onLoaded));
+        if (waiting.size() > 1)
+            return;
+
+        pool.addJob([this, file, key]() {
+            auto picture = std::make_shared<Picture>();
+            picture->image = ImageFileFormat::loadFrom(file);
+
+            auto width = picture->image.getWidth() / 2;
+            auto height = picture->image.getHeight() / 2;
+            auto const* previous = &picture->image;
+            while (width >= minMipmapSize && height >= minMipmapSize) {
+                picture->mipmaps.push_back(previous->rescaled(width, height, Graphics::highResamplingQuality));
+                previous = &picture->mipmaps.back();
+                width /= 2;
+                height /= 2;
+            }
+
+            MessageManager::callAsync([this, key, picture = PicturePtr(picture)]() {
+                pictures[key] = picture;
+
+                auto callbacks = std::move(pending[key]);
+                pending.erase(key);
+                for (auto& callback : callbacks)
+                    callback(picture);
+
+                // Forget images that aren't used anymore
+                for (auto it = pictures.begin(); it != pictures.end();) {
+                    if (it->second.expired())
+                        it = pictures.erase(it);
+                    else
+                        ++it;
+                }
+            });
+        });
+    }
+
+private:
+    static constexpr int minMipmapSize = 16;
+
+    std::unordered_map<String, std::weak_ptr<Picture const>> pictures;
+    std::unordered_map<String, std::vector<std::function<void(PicturePtr)>>> pending;
+
+    ThreadPool pool = ThreadPool(2);
+};
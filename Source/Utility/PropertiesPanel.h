@@ -32,6 +32,9 @@ struct PropertiesPanel : public PropertyPanel {
         }
 
         void refresh() override {};
+
+        // Points the property at the value of another object with the same parameters, so the inspector can reuse it
+        virtual void setValue(Value& value) {};
     };
 
     struct ComboComponent : public Property {
@@ -48,6 +51,11 @@ struct PropertiesPanel : public PropertyPanel {
             addAndMakeVisible(comboBox);
         }
 
+        void setValue(Value& value) override
+        {
+            comboBox.getSelectedIdAsValue().referTo(value);
+        }
+
         void resized() override
         {
             comboBox.setBounds(getLocalBounds().removeFromRight(getWidth() / (2 - hideLabel)));
@@ -110,6 +118,12 @@ struct PropertiesPanel : public PropertyPanel {
             comboBox.setText(fontName);
         }
 
+        void setValue(Value& value) override
+        {
+            fontValue.referTo(value);
+            comboBox.setText(value.toString(), dontSendNotification);
+        }
+
         void resized() override
         {
             comboBox.setBounds(getLocalBounds().removeFromRight(getWidth() / (2 - hideLabel)));
@@ -151,6 +165,7 @@ struct PropertiesPanel : public PropertyPanel {
     struct BoolComponent : public Property {
         BoolComponent(String const& propertyName, Value& value, std::vector<String> options)
             : Property(propertyName)
+            , options(options)
         {
             toggleButton.setClickingTogglesState(true);
 
@@ -163,7 +178,13 @@ struct PropertiesPanel : public PropertyPanel {
 
             addAndMakeVisible(toggleButton);
 
-            toggleButton.onClick = [this, value, options]() mutable { toggleButton.setButtonText(toggleButton.getToggleState() ? options[1] : options[0]); };
+            toggleButton.onClick = [this]() { toggleButton.setButtonText(toggleButton.getToggleState() ? options[1] : options[0]); };
+        }
+
+        void setValue(Value& value) override
+        {
+            toggleButton.getToggleStateValue().referTo(value);
+            toggleButton.setButtonText(static_cast<bool>(value.getValue()) ? options[1] : options[0]);
         }
 
         void resized() override
@@ -173,6 +194,7 @@ struct PropertiesPanel : public PropertyPanel {
 
     private:
         TextButton toggleButton;
+        std::vector<String> options;
     };
 
     struct ColourComponent : public Property
@@ -229,6 +251,12 @@ struct PropertiesPanel : public PropertyPanel {
             updateColour();
         }
 
+        void setValue(Value& value) override
+        {
+            currentColour.referTo(value);
+            updateColour();
+        }
+
         ~ColourComponent() override = default;
 
         void resized() override
@@ -238,11 +266,11 @@ struct PropertiesPanel : public PropertyPanel {
 
     private:
         TextButton button;
-        Value& currentColour;
+        Value currentColour;
     };
 
     struct RangeComponent : public Property {
-        Value& property;
+        Value property;
 
         DraggableNumber minLabel, maxLabel;
 
@@ -292,6 +320,17 @@ struct PropertiesPanel : public PropertyPanel {
             };
         }
 
+        void setValue(Value& value) override
+        {
+            property.referTo(value);
+
+            min = value.getValue().getArray()->getReference(0);
+            max = value.getValue().getArray()->getReference(1);
+
+            minLabel.setText(String(min), dontSendNotification);
+            maxLabel.setText(String(max), dontSendNotification);
+        }
+
         void resized() override
         {
             auto bounds = getLocalBounds().removeFromRight(getWidth() / (2 - hideLabel));
@@ -303,7 +342,7 @@ struct PropertiesPanel : public PropertyPanel {
     template<typename T>
     struct EditableComponent : public Property {
         std::unique_ptr<Label> label;
-        Value& property;
+        Value property;
 
         EditableComponent(String propertyName, Value& value)
             : Property(propertyName)
@@ -337,6 +376,12 @@ struct PropertiesPanel : public PropertyPanel {
             };
         }
 
+        void setValue(Value& value) override
+        {
+            property.referTo(value);
+            label->getTextValue().referTo(property);
+        }
+
         void resized() override
         {
             label->setBounds(getLocalBounds().removeFromRight(getWidth() / (2 - hideLabel)));
@@ -346,7 +391,7 @@ struct PropertiesPanel : public PropertyPanel {
     struct FilePathComponent : public Property {
         Label label;
         TextButton browseButton = TextButton(Icons::File);
-        Value& property;
+        Value property;
 
         std::unique_ptr<FileChooser> saveChooser;
         
@@ -381,6 +426,12 @@ struct PropertiesPanel : public PropertyPanel {
             };
         }
         
+        void setValue(Value& value) override
+        {
+            property.referTo(value);
+            label.getTextValue().referTo(property);
+        }
+
         void paint(Graphics& g) override {
             
             Property::paint(g);
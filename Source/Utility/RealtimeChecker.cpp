@@ -0,0 +1,112 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "RealtimeChecker.h"
+
+#if PLUGDATA_REALTIME_CHECKS
+
+#include <cstdlib>
+#include <new>
+#include <unordered_set>
+
+#include "Pd/PdInstance.h"
+
+namespace {
+thread_local pd::Instance* currentInstance = nullptr;
+
+// Set while a violation is being reported, so the allocations made by reporting aren't reported again
+thread_local bool isReporting = false;
+
+void* checkedAllocate(std::size_t size)
+{
+    if (RealtimeChecker::isInsideAudioCallback())
+        RealtimeChecker::reportViolation("memory allocation");
+
+    if (auto* ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void checkedFree(void* ptr)
+{
+    if (ptr && RealtimeChecker::isInsideAudioCallback())
+        RealtimeChecker::reportViolation("memory deallocation");
+
+    std::free(ptr);
+}
+}
+
+RealtimeChecker::ScopedAudioCallback::ScopedAudioCallback(pd::Instance* instance)
+    : previousInstance(currentInstance)
+{
+    currentInstance = instance;
+}
+
+RealtimeChecker::ScopedAudioCallback::~ScopedAudioCallback()
+{
+    currentInstance = previousInstance;
+}
+
+bool RealtimeChecker::isInsideAudioCallback()
+{
+    return currentInstance != nullptr && !isReporting;
+}
+
+void RealtimeChecker::reportViolation(char const* description)
+{
+    isReporting = true;
+
+    static SpinLock reportedLock;
+    static std::unordered_set<size_t> reportedTraces;
+
+    auto trace = SystemStats::getStackBacktrace();
+    auto hash = std::hash<std::string>()(trace.toStdString());
+
+    bool isNew;
+    {
+        SpinLock::ScopedLockType lock(reportedLock);
+        isNew = reportedTraces.insert(hash).second;
+    }
+
+    if (isNew) {
+        currentInstance->logWarning("Real-time violation in audio callback: " + String(description) + "\n" + trace);
+    }
+
+    isReporting = false;
+}
+
+void* operator new(std::size_t size)
+{
+    return checkedAllocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return checkedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    checkedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    checkedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    checkedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    checkedFree(ptr);
+}
+
+#endif
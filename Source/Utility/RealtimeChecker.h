@@ -0,0 +1,46 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+#include <JuceHeader.h>
+
+namespace pd {
+class Instance;
+}
+
+// Debug tool that catches allocations and locks inside the audio callback
+// Enabled with the ENABLE_REALTIME_CHECKS cmake option, does nothing otherwise
+// Allocations are caught by replacing the global operator new and delete, so only allocations made from C++ are detected
+struct RealtimeChecker {
+
+#if PLUGDATA_REALTIME_CHECKS
+    // Marks the current thread as running the audio callback while in scope
+    struct ScopedAudioCallback {
+        explicit ScopedAudioCallback(pd::Instance* instance);
+        ~ScopedAudioCallback();
+
+        pd::Instance* const previousInstance;
+    };
+
+    // Call before taking a lock that might be taken on the audio thread
+    static void checkLock(char const* lockName)
+    {
+        if (isInsideAudioCallback())
+            reportViolation(lockName);
+    }
+
+    static bool isInsideAudioCallback();
+
+    // Logs a stack trace to the console, once for every place that causes a violation
+    static void reportViolation(char const* description);
+#else
+    struct ScopedAudioCallback {
+        explicit ScopedAudioCallback(pd::Instance*) {};
+    };
+
+    static void checkLock(char const*) {};
+#endif
+};
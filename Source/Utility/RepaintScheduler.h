@@ -0,0 +1,136 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Collects repaints and periodic updates of object GUIs, and runs them once per display frame
+// Dirty areas of the same component are merged, so a component is repainted at most once per frame
+class RepaintScheduler {
+public:
+    explicit RepaintScheduler(Component* owner)
+        : ownerComponent(owner)
+        , vBlank(owner, [this]() { flush(); })
+    {
+    }
+
+    // Called when the owner gets shown or hidden, nothing is polled or repainted while it's hidden
+    std::function<void(bool)> onVisibilityChange;
+
+    // Marks an area of a component as dirty, it will be repainted on the next frame
+    void repaint(Component* component, Rectangle<int> area)
+    {
+        auto& dirty = dirtyAreas[component];
+        dirty.first = component;
+        dirty.second.add(area);
+    }
+
+    void repaint(Component* component)
+    {
+        repaint(component, component->getLocalBounds());
+    }
+
+    // Calls the callback on a frame, at most the given number of times per second
+    // Replaces the timers that objects would otherwise run for polling and animation
+    // The callback returns whether anything changed: while nothing does, it gets called less and less often
+    // Callbacks of components that aren't showing are skipped, unless they need to find out when that happens
+    void addFrameCallback(Component* owner, double frequency, std::function<bool()> callback, bool onlyWhenShowing = true)
+    {
+        removeFrameCallback(owner);
+
+        auto interval = 1000.0 / std::max(frequency, 0.1);
+        frameCallbacks.push_back({ owner, interval, interval, 0.0, onlyWhenShowing, std::move(callback) });
+    }
+
+    void removeFrameCallback(Component* owner)
+    {
+        frameCallbacks.erase(std::remove_if(frameCallbacks.begin(), frameCallbacks.end(), [owner](FrameCallback const& frameCallback) { return frameCallback.owner == owner; }), frameCallbacks.end());
+    }
+
+private:
+    struct FrameCallback {
+        Component* owner;
+        double interval;
+        double currentInterval;
+        double lastCall;
+        bool onlyWhenShowing;
+        std::function<bool()> callback;
+    };
+
+    // Idle callbacks slow down until they're called this often
+    static constexpr double maxIdleInterval = 500.0;
+
+    void flush()
+    {
+        auto showing = ownerComponent->isShowing();
+        if (showing != wasShowing) {
+            wasShowing = showing;
+            if (onVisibilityChange)
+                onVisibilityChange(showing);
+        }
+
+        if (!showing) {
+            dirtyAreas.clear();
+            return;
+        }
+
+        auto now = Time::getMillisecondCounterHiRes();
+
+        // Callbacks can add or remove other callbacks, so iterate by index over the ones that existed when we started
+        auto numCallbacks = frameCallbacks.size();
+        for (size_t i = 0; i < numCallbacks && i < frameCallbacks.size(); i++) {
+            auto& frameCallback = frameCallbacks[i];
+            if (now - frameCallback.lastCall < frameCallback.currentInterval || (frameCallback.onlyWhenShowing && !frameCallback.owner->isShowing()))
+                continue;
+
+            frameCallback.lastCall = now;
+
+            // Copy it, the callback could remove itself
+            auto callback = frameCallback.callback;
+            auto owner = frameCallback.owner;
+            auto changed = callback();
+
+            // Find it again, the callback could have added or removed callbacks
+            for (auto& current : frameCallbacks) {
+                if (current.owner == owner) {
+                    current.currentInterval = changed ? current.interval : std::min(current.currentInterval * 2.0, std::max(maxIdleInterval, current.interval));
+                    break;
+                }
+            }
+        }
+
+        if (dirtyAreas.empty())
+            return;
+
+        auto toRepaint = std::move(dirtyAreas);
+        dirtyAreas.clear();
+
+        for (auto& [ptr, dirty] : toRepaint) {
+            auto& [component, areas] = dirty;
+            if (!component)
+                continue;
+
+            areas.consolidate();
+            for (auto const& area : areas) {
+                component->repaint(area);
+            }
+        }
+    }
+
+    std::unordered_map<Component*, std::pair<Component::SafePointer<Component>, RectangleList<int>>> dirtyAreas;
+    std::vector<FrameCallback> frameCallbacks;
+
+    Component* ownerComponent;
+    bool wasShowing = false;
+
+    VBlankAttachment vBlank;
+
+    JUCE_DECLARE_NON_COPYABLE(RepaintScheduler)
+};
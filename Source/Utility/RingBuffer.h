@@ -0,0 +1,59 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <vector>
+
+// Fixed capacity list, adding to a full buffer drops the oldest item
+// Storage grows as items are added, so a large capacity costs nothing until it's used
+template<typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t maxItems)
+        : maxSize(maxItems)
+    {
+    }
+
+    void push_back(T item)
+    {
+        if (items.size() < maxSize) {
+            items.push_back(std::move(item));
+        } else {
+            items[start] = std::move(item);
+            start = (start + 1) % maxSize;
+        }
+
+        numPushed++;
+    }
+
+    void clear()
+    {
+        items.clear();
+        start = 0;
+    }
+
+    // Index 0 is the oldest item
+    T& operator[](size_t idx) { return items[(start + idx) % items.size()]; }
+    T const& operator[](size_t idx) const { return items[(start + idx) % items.size()]; }
+
+    T& front() { return (*this)[0]; }
+    T& back() { return (*this)[items.size() - 1]; }
+
+    size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+    size_t capacity() const { return maxSize; }
+
+    // Total number of items ever added, so others can tell how many items are new since they last looked
+    uint64 getNumPushed() const { return numPushed; }
+
+private:
+    std::vector<T> items;
+    size_t start = 0;
+    size_t maxSize;
+    uint64 numPushed = 0;
+};
@@ -0,0 +1,125 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <unordered_map>
+#include <vector>
+
+class Object;
+
+// Uniform grid over the objects of a canvas, so area queries only look at the objects nearby
+// Objects keep it up to date whenever they are moved or resized
+class SpatialIndex {
+public:
+    void update(Object* object, Rectangle<int> bounds)
+    {
+        auto it = objectBounds.find(object);
+        if (it != objectBounds.end()) {
+            if (getCellRange(it->second) == getCellRange(bounds)) {
+                it->second = bounds;
+                return;
+            }
+
+            removeFromCells(object, it->second);
+            it->second = bounds;
+        } else {
+            objectBounds[object] = bounds;
+        }
+
+        auto range = getCellRange(bounds);
+        for (int x = range.getX(); x <= range.getRight(); x++) {
+            for (int y = range.getY(); y <= range.getBottom(); y++) {
+                cells[getCellKey(x, y)].push_back(object);
+            }
+        }
+    }
+
+    void remove(Object* object)
+    {
+        auto it = objectBounds.find(object);
+        if (it == objectBounds.end())
+            return;
+
+        removeFromCells(object, it->second);
+        objectBounds.erase(it);
+    }
+
+    // Returns every object whose bounds intersect the area
+    Array<Object*> query(Rectangle<int> area) const
+    {
+        Array<Object*> result;
+        auto range = getCellRange(area);
+
+        for (int x = range.getX(); x <= range.getRight(); x++) {
+            for (int y = range.getY(); y <= range.getBottom(); y++) {
+                auto cell = cells.find(getCellKey(x, y));
+                if (cell == cells.end())
+                    continue;
+
+                for (auto* object : cell->second) {
+                    auto const& bounds = objectBounds.at(object);
+                    if (!bounds.intersects(area))
+                        continue;
+
+                    // Objects are in every cell they overlap, only report them from the first cell the query shares with them
+                    auto objectRange = getCellRange(bounds);
+                    if (x == std::max(range.getX(), objectRange.getX()) && y == std::max(range.getY(), objectRange.getY())) {
+                        result.add(object);
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+private:
+    static constexpr int cellSize = 128;
+
+    // The range of cells that a rectangle covers, as inclusive cell coordinates
+    static Rectangle<int> getCellRange(Rectangle<int> bounds)
+    {
+        auto x1 = floorDiv(bounds.getX());
+        auto y1 = floorDiv(bounds.getY());
+        auto x2 = floorDiv(bounds.getRight() - 1);
+        auto y2 = floorDiv(bounds.getBottom() - 1);
+
+        return { x1, y1, std::max(x2 - x1, 0), std::max(y2 - y1, 0) };
+    }
+
+    static int floorDiv(int value)
+    {
+        return value >= 0 ? value / cellSize : (value - cellSize + 1) / cellSize;
+    }
+
+    static int64 getCellKey(int x, int y)
+    {
+        return (static_cast<int64>(x) << 32) | static_cast<uint32>(y);
+    }
+
+    void removeFromCells(Object* object, Rectangle<int> bounds)
+    {
+        auto range = getCellRange(bounds);
+        for (int x = range.getX(); x <= range.getRight(); x++) {
+            for (int y = range.getY(); y <= range.getBottom(); y++) {
+                auto cell = cells.find(getCellKey(x, y));
+                if (cell == cells.end())
+                    continue;
+
+                auto& objects = cell->second;
+                objects.erase(std::remove(objects.begin(), objects.end(), object), objects.end());
+
+                if (objects.empty())
+                    cells.erase(cell);
+            }
+        }
+    }
+
+    std::unordered_map<int64, std::vector<Object*>> cells;
+    std::unordered_map<Object*, Rectangle<int>> objectBounds;
+};
@@ -729,31 +729,68 @@ struct StackShadow
         if (radius < 1)
             return;
         
-        auto area = (path.getBounds().getSmallestIntegerContainer() + offset)
-            .expanded (radius + spread + 1)
-            .getIntersection (g.getClipBounds().expanded (radius + spread + 1));
-        
-        if (area.getWidth() < 2 || area.getHeight() < 2)
-            return;
-        
         // spread enlarges or shrinks the path before blurring it
         auto spreadPath = Path (path);
         if (spread != 0)
         {
-            area.expand (spread, spread);
             auto bounds = path.getBounds().expanded (spread);
             spreadPath.scaleToFit (bounds.getX(), bounds.getY(), bounds.getWidth(), bounds.getHeight(), true);
         }
         
-        Image renderedPath (Image::SingleChannel, area.getWidth(), area.getHeight(), true);
+        auto pathArea = spreadPath.getBounds().getSmallestIntegerContainer();
+        auto area = (pathArea + offset).expanded (radius + 1);
         
-        Graphics g2 (renderedPath);
-        g2.setColour (Colours::white);
-        g2.fillPath ((spread != 0) ? spreadPath : path, AffineTransform::translation ((float) (offset.x - area.getX()), (float) (offset.y - area.getY())));
-        applyStackBlur (renderedPath, radius);
+        if (area.getWidth() < 2 || area.getHeight() < 2 || !area.intersects (g.getClipBounds()))
+            return;
+        
+        // Only the shape of the path matters for the blur, so it's cached relative to its own position
+        // That way, moving a shadow around doesn't need a new blur
+        spreadPath.applyTransform (AffineTransform::translation ((float) -pathArea.getX(), (float) -pathArea.getY()));
         
         g.setColour (color);
-        g.drawImageAt (renderedPath, area.getX(), area.getY(), true);
+        g.drawImageAt (getBlurredPath (spreadPath, radius), area.getX(), area.getY(), true);
+    }
+    
+private:
+    
+    // Returns the blurred alpha mask of a path that starts at the origin, reusing recently rendered masks
+    static Image getBlurredPath (const Path& path, int radius)
+    {
+        struct CachedShadow
+        {
+            int64 hash;
+            Image image;
+        };
+        
+        static constexpr size_t maxCachedShadows = 16;
+        static std::vector<CachedShadow> cache;
+        
+        auto hash = (path.toString() + ":" + String (radius)).hashCode64();
+        
+        auto it = std::find_if (cache.begin(), cache.end(), [hash] (const CachedShadow& cached) { return cached.hash == hash; });
+        
+        // Keep the most recently used shadow at the front
+        if (it != cache.end())
+        {
+            std::rotate (cache.begin(), it, it + 1);
+            return cache.front().image;
+        }
+        
+        auto bounds = path.getBounds().getSmallestIntegerContainer().expanded (radius + 1);
+        
+        Image renderedPath (Image::SingleChannel, bounds.getWidth(), bounds.getHeight(), true);
+        
+        Graphics g (renderedPath);
+        g.setColour (Colours::white);
+        g.fillPath (path, AffineTransform::translation ((float) (radius + 1), (float) (radius + 1)));
+        applyStackBlur (renderedPath, radius);
+        
+        if (cache.size() >= maxCachedShadows)
+            cache.pop_back();
+        
+        cache.insert (cache.begin(), { hash, renderedPath });
+        
+        return renderedPath;
     }
     
 };
@@ -379,7 +379,7 @@ private:
         // If there's a space, open arguments panel
         if ((e.getText() + mutableInput).contains(" ")) {
             state = ShowingArguments;
-            auto found = library.getArguments()[typedText.upToFirstOccurrenceOf(" ", false, false)];
+            auto found = library.getArguments(typedText.upToFirstOccurrenceOf(" ", false, false));
             for (int i = 0; i < std::min<int>(buttons.size(), static_cast<int>(found.size())); i++) {
                 auto& [type, description, init] = found[i];
                 buttons[i]->setText(type, description, false);
@@ -402,32 +402,49 @@ private:
             return mutableInput;
         }
 
-        buttons[currentidx]->setToggleState(true, dontSendNotification);
-
         // Update suggestions
-        auto found = library.autocomplete(typedText.toStdString());
-
         // When hvcc mode is enabled, show only hvcc compatible objects
+        std::function<bool(String const&)> filter;
         if(static_cast<bool>(currentBox->cnv->main.hvccMode.getValue())) {
-            std::vector<std::pair<String, bool>> hvccObjectsFound;
-            for(auto& object : found) {
-                if(Object::hvccObjects.contains(object.first)) {
-                    hvccObjectsFound.push_back(object);
-                }
-            }
-            
-            found = hvccObjectsFound;
+            filter = [](String const& name) {
+                return Object::hvccObjects.contains(name);
+            };
         }
-        
+
+        // Get length of user-typed text
+        int textlen = e.getText().substring(0, start).length();
+        bool completeInline = newInput.isNotEmpty() && e.getCaretPosition() == textlen;
+
+        // The text goes in as typed, the inline completion is added once the results are in
+        highlightEnd = 0;
+
+        library.autocompleteAsync(typedText, buttons.size(), filter, [_this = SafePointer(this), typedText, textlen, completeInline](Suggestions&& found) {
+            if (_this) _this->showSuggestions(found, typedText, textlen, completeInline);
+        });
+
+        return mutableInput;
+    }
+
+    // Called with the results of the query for typedText, they're ignored if the text changed in the meantime
+    void showSuggestions(Suggestions const& found, String const& typedText, int textlen, bool completeInline)
+    {
+        if (!currentBox || !openedEditor || openedEditor->getText() != typedText || state == ShowingArguments)
+            return;
+
+        auto& library = currentBox->cnv->pd->objectLibrary;
+
         numOptions = static_cast<int>(found.size());
 
+        // Snapshot of the documentation, this doesn't copy anything
+        auto documentation = library.getDocumentation();
+        auto const& descriptions = documentation->objectDescriptions;
+
         for (int i = 0; i < std::min<int>(buttons.size(), numOptions); i++) {
             auto& [name, autocomplete] = found[i];
 
-            auto descriptions = library.getObjectDescriptions();
-
-            if (descriptions.find(name) != descriptions.end()) {
-                buttons[i]->setText(name, descriptions[name], true);
+            auto description = descriptions.find(name);
+            if (description != descriptions.end()) {
+                buttons[i]->setText(name, description->second, true);
             } else {
                 buttons[i]->setText(name, "", true);
             }
@@ -439,38 +456,32 @@ private:
 
         resized();
 
-        // Get length of user-typed text
-        int textlen = e.getText().substring(0, start).length();
-
         if (found.empty() || textlen == 0) {
             state = Hidden;
             setVisible(false);
-            highlightEnd = 0;
-            return mutableInput;
-        }
-
-        if (newInput.isEmpty() || e.getCaretPosition() != textlen) {
-            highlightEnd = 0;
-            return mutableInput;
+            return;
         }
 
         // Limit it to minimum of the number of buttons and the number of suggestions
         int numButtons = std::min(20, numOptions);
 
         currentidx = (currentidx + numButtons) % numButtons;
+        buttons[currentidx]->setToggleState(true, dontSendNotification);
+
+        state = ShowingObjects;
+        setVisible(true);
 
         // Retrieve best suggestion
         auto const& fullName = found[currentidx].first;
 
-        state = ShowingObjects;
-        if (fullName.length() > textlen) {
-            mutableInput = fullName.substring(textlen);
+        // Only complete inline when the best suggestion continues what was typed
+        if (!completeInline || !fullName.startsWith(typedText) || fullName.length() <= typedText.length()) {
+            return;
         }
 
-        setVisible(true);
         highlightEnd = fullName.length();
-
-        return mutableInput;
+        openedEditor->setText(fullName, dontSendNotification);
+        openedEditor->setHighlightedRegion({ highlightStart, highlightEnd });
     }
 
     enum SugesstionState {
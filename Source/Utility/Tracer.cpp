@@ -0,0 +1,158 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "Tracer.h"
+
+#if PLUGDATA_TRACING
+
+#include <array>
+#include <memory>
+
+namespace {
+struct TraceEvent {
+    char const* name;
+    int64 start;
+    int64 end;
+};
+
+// Only the owning thread writes, the writer never waits for a reader
+struct ThreadBuffer {
+    static constexpr size_t capacity = 1 << 15;
+
+    std::array<TraceEvent, capacity> events;
+    std::atomic<size_t> numWritten = 0;
+
+    String threadName;
+    int threadIndex;
+};
+
+// Buffers outlive their thread, so the events of finished threads can still be written
+struct BufferList {
+    SpinLock lock;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+};
+
+BufferList& getBufferList()
+{
+    static BufferList list;
+    return list;
+}
+
+// Created on the first zone of each thread, so that one allocates
+ThreadBuffer& getThreadBuffer(char const* firstZone)
+{
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [firstZone]() {
+        auto newBuffer = std::make_shared<ThreadBuffer>();
+
+        if (MessageManager::getInstanceWithoutCreating() && MessageManager::getInstanceWithoutCreating()->isThisTheMessageThread()) {
+            newBuffer->threadName = "Message thread";
+        } else if (auto* thread = Thread::getCurrentThread()) {
+            newBuffer->threadName = thread->getThreadName();
+        } else {
+            // Host threads, like the audio thread, are named after the first thing they did
+            newBuffer->threadName = "Thread (" + String(firstZone) + ")";
+        }
+
+        auto& list = getBufferList();
+        SpinLock::ScopedLockType lock(list.lock);
+        newBuffer->threadIndex = static_cast<int>(list.buffers.size()) + 1;
+        list.buffers.push_back(newBuffer);
+
+        return newBuffer;
+    }();
+
+    return *buffer;
+}
+}
+
+Tracer::ScopedZone::ScopedZone(char const* zoneName)
+    : name(zoneName)
+    , start(Time::getHighResolutionTicks())
+{
+}
+
+Tracer::ScopedZone::~ScopedZone()
+{
+    auto const end = Time::getHighResolutionTicks();
+    auto& buffer = getThreadBuffer(name);
+
+    auto const index = buffer.numWritten.load(std::memory_order_relaxed);
+    buffer.events[index % ThreadBuffer::capacity] = { name, start, end };
+    buffer.numWritten.store(index + 1, std::memory_order_release);
+}
+
+bool Tracer::writeTrace(File const& file)
+{
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        auto& list = getBufferList();
+        SpinLock::ScopedLockType lock(list.lock);
+        buffers = list.buffers;
+    }
+
+    struct ThreadEvents {
+        ThreadBuffer* buffer;
+        std::vector<TraceEvent> events;
+    };
+
+    std::vector<ThreadEvents> threads;
+    int64 firstTick = std::numeric_limits<int64>::max();
+
+    for (auto& buffer : buffers) {
+        auto const numWritten = buffer->numWritten.load(std::memory_order_acquire);
+        auto const first = numWritten > ThreadBuffer::capacity ? numWritten - ThreadBuffer::capacity : 0;
+
+        std::vector<TraceEvent> events;
+        events.reserve(numWritten - first);
+        for (auto i = first; i < numWritten; i++) {
+            events.push_back(buffer->events[i % ThreadBuffer::capacity]);
+        }
+
+        // The thread kept writing while this was copied, the oldest events might have been overwritten in the meantime
+        auto const numWrittenAfter = buffer->numWritten.load(std::memory_order_acquire);
+        if (numWrittenAfter > ThreadBuffer::capacity && numWrittenAfter - ThreadBuffer::capacity > first) {
+            auto const numOverwritten = std::min<size_t>(events.size(), numWrittenAfter - ThreadBuffer::capacity - first);
+            events.erase(events.begin(), events.begin() + numOverwritten);
+        }
+
+        for (auto const& event : events) {
+            firstTick = std::min(firstTick, event.start);
+        }
+
+        threads.push_back({ buffer.get(), std::move(events) });
+    }
+
+    auto const ticksToMicroseconds = 1e6 / static_cast<double>(Time::getHighResolutionTicksPerSecond());
+
+    MemoryOutputStream json;
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    auto separator = [&first, &json]() {
+        if (!first)
+            json << ",\n";
+        first = false;
+    };
+
+    for (auto const& thread : threads) {
+        separator();
+        json << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.buffer->threadIndex
+             << ",\"args\":{\"name\":" << JSON::toString(thread.buffer->threadName) << "}}";
+
+        for (auto const& event : thread.events) {
+            separator();
+            json << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.buffer->threadIndex
+                 << ",\"ts\":" << String(static_cast<double>(event.start - firstTick) * ticksToMicroseconds, 3)
+                 << ",\"dur\":" << String(static_cast<double>(event.end - event.start) * ticksToMicroseconds, 3) << "}";
+        }
+    }
+
+    json << "]}\n";
+
+    return file.replaceWithData(json.getData(), json.getDataSize());
+}
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+#include <JuceHeader.h>
+
+// Records how long marked zones take on every thread, to see how the audio, message and worker threads interact
+// Enabled with the ENABLE_TRACING cmake option, TRACE_ZONE does nothing otherwise
+// Each thread writes to its own ring buffer without locking, so only the last events of each thread are kept
+struct Tracer {
+
+#if PLUGDATA_TRACING
+    // Records the time between construction and destruction, the name needs to be a string literal
+    struct ScopedZone {
+        explicit ScopedZone(char const* zoneName);
+        ~ScopedZone();
+
+        char const* const name;
+        int64 const start;
+    };
+
+    // Writes all recorded events in the Chrome trace format, which can be opened in Perfetto or chrome://tracing
+    static bool writeTrace(File const& file);
+#else
+    struct ScopedZone {
+        explicit ScopedZone(char const*) {};
+    };
+
+    static bool writeTrace(File const&) { return false; };
+#endif
+};
+
+#if PLUGDATA_TRACING
+#define TRACE_ZONE(name) Tracer::ScopedZone JUCE_JOIN_MACRO(traceZone, __LINE__)(name)
+#else
+#define TRACE_ZONE(name)
+#endif
@@ -17,6 +17,10 @@
 #include <shlobj.h>
 #include <ShellAPI.h>
 
+// Takes K32GetProcessMemoryInfo from kernel32, so we don't need to link psapi
+#define PSAPI_VERSION 2
+#include <psapi.h>
+
 #include <stdio.h>
 #include <string>
 #include <filesystem>
@@ -107,4 +111,16 @@ bool runAsAdmin(std::string command, std::string parameters, void* hWndPtr) {
     return (bool)retval;
 }
 
+// Working set of the whole process, in bytes
+size_t getResidentMemory() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    
+    return counters.WorkingSetSize;
+}
+
+void setCurrentThreadTimeCritical(bool timeCritical) {
+    SetThreadPriority(GetCurrentThread(), timeCritical ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_NORMAL);
+}
+
 #endif
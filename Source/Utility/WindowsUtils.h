@@ -8,3 +8,7 @@
 void createJunction(std::string from, std::string to);
 void createHardLink(std::string from, std::string to);
 bool runAsAdmin(std::string file, std::string lpParameters, void* hWnd);
+size_t getResidentMemory();
+
+// Gives the calling thread time critical priority, or normal priority again
+void setCurrentThreadTimeCritical(bool timeCritical);
@@ -6,6 +6,10 @@
 
 #include <PluginProcessor.h>
 
+extern "C" {
+#include <s_stuff.h>
+}
+
 
 #include <juce_core/system/juce_TargetPlatform.h>
 #include <Standalone/PlugDataApp.cpp>
@@ -77,3 +81,224 @@ TEST_CASE("Create and delete objects", "[name]")
     
     StopApplicationAfter(1500);
 }
+
+TEST_CASE("Apply journaled edits to a snapshot", "[journal]")
+{
+    SECTION("Objects and connections")
+    {
+        auto snapshot = String("#N canvas 0 50 450 300 12;\n#X obj 10 10 metro 200;\n#X obj 10 50 print;\n#X connect 0 0 1 0;\n");
+        auto lines = StringArray { "add - 2 #X obj 100 100 f, f 5;", "connect - 2 0 1 0", "remove - 0", "move - 0 20 60" };
+
+        CHECK(pd::Journal::applyJournal(snapshot, lines) == "#N canvas 0 50 450 300 12;\n#X obj 20 60 print;\n#X obj 100 100 f, f 5;\n#X connect 1 0 0 0;\n");
+    }
+
+    SECTION("Retyping keeps the connections the new object has iolets for")
+    {
+        auto snapshot = String("#N canvas 0 50 450 300 12;\n#X obj 10 10 t b b;\n#X obj 10 50 print;\n#X obj 60 50 print;\n#X connect 0 0 1 0;\n#X connect 0 1 2 0;\n");
+        auto lines = StringArray { "retype - 0 2 1 1 #X obj 10 10 t b;" };
+
+        CHECK(pd::Journal::applyJournal(snapshot, lines) == "#N canvas 0 50 450 300 12;\n#X obj 10 50 print;\n#X obj 60 50 print;\n#X obj 10 10 t b;\n#X connect 2 0 0 0;\n");
+    }
+
+    SECTION("Subpatches")
+    {
+        auto snapshot = String("#N canvas 0 50 450 300 12;\n#N canvas 0 50 450 300 sub 0;\n#X obj 10 10 inlet;\n#X restore 10 10 pd sub;\n");
+        auto lines = StringArray { "add 0 1 #X obj 30 30 outlet;" };
+
+        CHECK(pd::Journal::applyJournal(snapshot, lines) == "#N canvas 0 50 450 300 12;\n#N canvas 0 50 450 300 sub 0;\n#X obj 10 10 inlet;\n#X obj 30 30 outlet;\n#X restore 10 10 pd sub;\n");
+    }
+
+    SECTION("Escaped semicolons stay inside their message")
+    {
+        auto snapshot = String("#N canvas 0 50 450 300 12;\n#X msg 10 10 \\; pd dsp 1;\n");
+
+        CHECK(pd::Journal::applyJournal(snapshot, {}) == snapshot);
+    }
+
+    SECTION("Nothing after a line that doesn't fit is applied")
+    {
+        auto snapshot = String("#N canvas 0 50 450 300 12;\n#X obj 10 10 print;\n");
+        auto lines = StringArray { "remove - 5", "add - 0 #X obj 0 0 f;" };
+
+        CHECK(pd::Journal::applyJournal(snapshot, lines) == snapshot);
+    }
+}
+
+TEST_CASE("Save and restore the plugin state", "[state]")
+{
+    StartApplication;
+
+    // Shared between the async steps below, as setStateInformation only takes effect on the next message loop iteration
+    auto stored = std::make_shared<MemoryBlock>();
+
+    MessageManager::callAsync([=](){
+        auto& processor = editor->pd;
+
+        processor.loadPatch(String("#N canvas 0 50 450 300 12;\n#N canvas 0 50 450 250 (subpatch) 0;\n#X array statetest 4 float 1;\n#A 0 0.5 1 -1 0.25;\n#X coords 0 1 4 -1 200 140 1 0 0;\n#X restore 20 20 graph;\n"));
+        processor.setPdBlockSize(128);
+
+        auto* param = processor.getParameters()[0];
+        param->setValueNotifyingHost(param->getDefaultValue() > 0.5f ? 0.25f : 0.75f);
+
+        processor.getStateInformation(*stored);
+
+        MemoryInputStream istream(*stored, false);
+
+        REQUIRE(istream.readInt() == 0x50445354);
+        REQUIRE(istream.readInt() == 3);
+        CHECK(istream.readString() == PLUGDATA_VERSION);
+        REQUIRE(istream.readByte() == static_cast<char>(sizeof(t_float)));
+
+        GZIPDecompressorInputStream compressed(istream);
+
+        auto numPatches = compressed.readCompressedInt();
+        REQUIRE(numPatches == processor.patches.size());
+
+        // Skip to the patch we just opened, the array has to be stored as a binary chunk
+        for (int i = 0; i < numPatches; i++)
+        {
+            compressed.readString();
+            CHECK(compressed.readInt64() == processor.patches[i]->getCanvasContent().hashCode64());
+
+            std::vector<double> values;
+            while (true)
+            {
+                auto type = compressed.readByte();
+                if (type == 0)
+                {
+                    CHECK_FALSE(compressed.readString().contains("#A"));
+                }
+                else if (type == 1)
+                {
+                    CHECK(compressed.readCompressedInt() == 0);
+                    auto numValues = compressed.readCompressedInt();
+                    for (int j = 0; j < numValues; j++)
+                        values.push_back(sizeof(t_float) == 8 ? compressed.readDouble() : compressed.readFloat());
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            if (i == numPatches - 1)
+            {
+                CHECK(values == std::vector<double> { 0.5, 1, -1, 0.25 });
+            }
+        }
+
+        CHECK(compressed.readInt() == processor.getLatency());
+        CHECK(compressed.readInt() == processor.oversampling);
+        compressed.readFloat();
+        CHECK(compressed.readInt() == 128);
+        CHECK(compressed.readInt() == processor.oversamplingFilter);
+
+        // Only the parameter we changed is stored, as the distance from the start
+        CHECK(compressed.readCompressedInt() == 1);
+        CHECK(compressed.readFloat() == param->getValue());
+        CHECK(compressed.readCompressedInt() == 0);
+
+        // States from before the binary format started with the number of patches, followed by the patch text and location
+        MemoryBlock legacy;
+        {
+            MemoryOutputStream ostream(legacy, false);
+
+            ostream.writeInt(1);
+            ostream.writeString("#N canvas 0 50 450 300 12;\n#X obj 10 10 print legacy;\n");
+            ostream.writeString("");
+            ostream.writeInt(processor.getLatency());
+            ostream.writeInt(0);
+            ostream.writeFloat(0.0f);
+
+            MemoryBlock xmlBlock;
+            processor.copyXmlToBinary(*processor.parameters.copyState().createXml(), xmlBlock);
+            ostream.writeInt(static_cast<int>(xmlBlock.getSize()));
+            ostream.write(xmlBlock.getData(), xmlBlock.getSize());
+
+            ostream.writeInt(256);
+            ostream.writeInt(1);
+        }
+
+        processor.setStateInformation(legacy.getData(), static_cast<int>(legacy.getSize()));
+
+        MessageManager::callAsync([=](){
+            auto& processor = editor->pd;
+
+            REQUIRE(processor.patches.size() == 1);
+            CHECK(processor.patches[0]->getCanvasContent().contains("print legacy"));
+            CHECK(processor.pdBlockSize == 256);
+            CHECK(processor.oversamplingFilter == 1);
+
+            auto* param = processor.getParameters()[0];
+            auto changedValue = param->getValue();
+            param->setValueNotifyingHost(param->getDefaultValue());
+
+            // Now the array patch isn't open anymore, so restoring it has to go through the binary chunks
+            processor.setStateInformation(stored->getData(), static_cast<int>(stored->getSize()));
+
+            MessageManager::callAsync([=](){
+                auto& processor = editor->pd;
+
+                REQUIRE(processor.patches.size() == numPatches);
+                CHECK(processor.patches.getLast()->getCanvasContent().contains("#A 0 0.5 1 -1 0.25"));
+                CHECK(processor.pdBlockSize == 128);
+                CHECK(processor.getParameters()[0]->getValue() == changedValue);
+            });
+        });
+    });
+
+    StopApplicationAfter(3000);
+}
+
+// Collects the sample positions of the notes that pd sends out
+class MidiPositionInstance : public pd::Instance
+{
+public:
+    MidiPositionInstance() : pd::Instance("midi_position_test")
+    {
+        prepareDSP(0, 2, 44100.0, 64);
+    }
+
+    void receiveNoteOn(int const channel, int const pitch, int const velocity) override
+    {
+        positions.push_back(midiEventPosition);
+    }
+
+    Colour getForegroundColour() override { return {}; }
+    Colour getBackgroundColour() override { return {}; }
+    Colour getTextColour() override { return {}; }
+    Colour getOutlineColour() override { return {}; }
+    void synchroniseAll() override {}
+
+    std::vector<int> positions;
+};
+
+TEST_CASE("Midi sent in between two blocks", "[midi]")
+{
+    StartApplication;
+
+    MessageManager::callAsync([=](){
+        MidiPositionInstance instance;
+        std::vector<t_sample> buffer(2 * 64);
+
+        // Like a [noteout] triggered by a message that was queued while the previous block was performed
+        instance.startBlock();
+        instance.setThis();
+        sys_lock();
+        outmidi_noteon(0, 0, 60, 100);
+        sys_unlock();
+        instance.sendMessagesFromQueue();
+
+        // After the block is performed, and before the next one is started, a note can only go at the end of it
+        instance.performDSP(buffer.data(), buffer.data());
+        instance.setThis();
+        sys_lock();
+        outmidi_noteon(0, 0, 62, 100);
+        sys_unlock();
+        instance.sendMessagesFromQueue();
+
+        CHECK(instance.positions == std::vector<int> { 0, 63 });
+    });
+
+    StopApplicationAfter(1000);
+}